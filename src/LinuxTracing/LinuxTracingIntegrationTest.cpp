@@ -416,6 +416,8 @@ void VerifyOrderOfAllEvents(const std::vector<orbit_grpc_protos::ProducerCapture
         break;
       case orbit_grpc_protos::ProducerCaptureEvent::kGpuQueueSubmission:
         UNREACHABLE();
+      case orbit_grpc_protos::ProducerCaptureEvent::kGpuQuerySlotsExhaustedEvent:
+        UNREACHABLE();
       case orbit_grpc_protos::ProducerCaptureEvent::kModuleUpdateEvent:
         EXPECT_GE(event.module_update_event().timestamp_ns(), previous_event_timestamp_ns);
         previous_event_timestamp_ns = event.module_update_event().timestamp_ns();
@@ -0,0 +1,106 @@
+// Copyright (c) 2021 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <thread>
+#include <vector>
+
+#include "OrbitBase/DeferredDeleter.h"
+
+namespace orbit_base {
+
+namespace {
+
+class CountsDestructions {
+ public:
+  explicit CountsDestructions(int* destruction_count) : destruction_count_{destruction_count} {}
+  ~CountsDestructions() { ++(*destruction_count_); }
+
+ private:
+  int* destruction_count_;
+};
+
+}  // namespace
+
+TEST(DeferredDeleter, DeletesRightAwayWithoutReaders) {
+  int destruction_count = 0;
+  DeferredDeleter deleter;
+  deleter.Retire(std::make_unique<CountsDestructions>(&destruction_count));
+  EXPECT_EQ(destruction_count, 1);
+  EXPECT_EQ(deleter.GetRetiredCount(), 0);
+}
+
+TEST(DeferredDeleter, DefersDeletionWhileReaderIsActive) {
+  int destruction_count = 0;
+  DeferredDeleter deleter;
+  {
+    std::optional<DeferredDeleter::ReaderScope> reader_scope;
+    reader_scope.emplace(&deleter);
+    {
+      DeferredDeleter::ReaderScope nested_reader_scope{&deleter};
+      deleter.Retire(std::make_unique<CountsDestructions>(&destruction_count));
+    }
+    deleter.Retire(std::make_unique<CountsDestructions>(&destruction_count));
+    EXPECT_EQ(destruction_count, 0);
+    EXPECT_EQ(deleter.GetRetiredCount(), 2);
+
+    reader_scope.reset();
+    deleter.TryDeleteRetired();
+    EXPECT_EQ(destruction_count, 2);
+    EXPECT_EQ(deleter.GetRetiredCount(), 0);
+  }
+}
+
+TEST(DeferredDeleter, DeletesOnDestruction) {
+  int destruction_count = 0;
+  {
+    DeferredDeleter deleter;
+    DeferredDeleter::ReaderScope reader_scope{&deleter};
+    deleter.Retire(std::make_unique<CountsDestructions>(&destruction_count));
+    EXPECT_EQ(destruction_count, 0);
+  }
+  EXPECT_EQ(destruction_count, 1);
+}
+
+TEST(DeferredDeleter, ReadersNeverAccessDeletedObjects) {
+  constexpr int kReaderThreadCount = 4;
+  constexpr uint64_t kVersionCount = 10'000;
+  DeferredDeleter deleter;
+  std::atomic<const uint64_t*> current_version = new uint64_t{0};
+  std::atomic<bool> writer_done = false;
+
+  std::vector<std::thread> reader_threads;
+  for (int i = 0; i < kReaderThreadCount; ++i) {
+    reader_threads.emplace_back([&deleter, &current_version, &writer_done] {
+      uint64_t last_version = 0;
+      while (!writer_done) {
+        DeferredDeleter::ReaderScope reader_scope{&deleter};
+        const uint64_t* version = current_version.load();
+        // Versions are published in increasing order and only deleted once unreachable.
+        EXPECT_GE(*version, last_version);
+        last_version = *version;
+      }
+    });
+  }
+
+  for (uint64_t version = 1; version <= kVersionCount; ++version) {
+    std::unique_ptr<const uint64_t> previous_version{current_version.load()};
+    current_version = new uint64_t{version};
+    deleter.Retire(std::move(previous_version));
+  }
+  writer_done = true;
+  for (std::thread& reader_thread : reader_threads) {
+    reader_thread.join();
+  }
+  deleter.TryDeleteRetired();
+  EXPECT_EQ(deleter.GetRetiredCount(), 0);
+  delete current_version.load();
+}
+
+}  // namespace orbit_base
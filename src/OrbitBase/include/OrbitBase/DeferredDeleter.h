@@ -0,0 +1,78 @@
+// Copyright (c) 2021 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef ORBIT_BASE_DEFERRED_DELETER_H_
+#define ORBIT_BASE_DEFERRED_DELETER_H_
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace orbit_base {
+
+// DeferredDeleter allows a writer to replace data that readers access without locks: the writer
+// publishes the new version through an std::atomic pointer and retires the old one, which is only
+// deleted once no reader is active anymore.
+//
+// Readers enter a ReaderScope before loading any pointer to retired-able data, and must not keep
+// such a pointer after leaving the scope. The pointers must be loaded with (the default)
+// std::memory_order_seq_cst, which makes sure that a reader that becomes active after the writer
+// found no active readers also finds the new version.
+//
+// Retire and TryDeleteRetired must only be called by one thread at a time, the writer. Entering a
+// ReaderScope is allowed on any thread, and reader scopes can be nested. If readers are active
+// without interruption, retired objects are only deleted on a later call to TryDeleteRetired, or
+// on destruction.
+class DeferredDeleter {
+ public:
+  class ReaderScope {
+   public:
+    explicit ReaderScope(const DeferredDeleter* deleter) : deleter_{deleter} {
+      deleter_->active_reader_count_.fetch_add(1);
+    }
+    ~ReaderScope() { deleter_->active_reader_count_.fetch_sub(1, std::memory_order_release); }
+
+    ReaderScope(const ReaderScope&) = delete;
+    ReaderScope& operator=(const ReaderScope&) = delete;
+    ReaderScope(ReaderScope&&) = delete;
+    ReaderScope& operator=(ReaderScope&&) = delete;
+
+   private:
+    const DeferredDeleter* deleter_;
+  };
+
+  DeferredDeleter() = default;
+  DeferredDeleter(const DeferredDeleter&) = delete;
+  DeferredDeleter& operator=(const DeferredDeleter&) = delete;
+  DeferredDeleter(DeferredDeleter&&) = delete;
+  DeferredDeleter& operator=(DeferredDeleter&&) = delete;
+
+  // Takes ownership of `object`, which must already be unreachable for new readers, and deletes it
+  // right away if no reader is active.
+  template <typename T>
+  void Retire(std::unique_ptr<T> object) {
+    if (object == nullptr) return;
+    retired_objects_.emplace_back(std::move(object));
+    TryDeleteRetired();
+  }
+
+  void TryDeleteRetired() {
+    if (retired_objects_.empty()) return;
+    if (active_reader_count_.load() == 0) {
+      retired_objects_.clear();
+    }
+  }
+
+  [[nodiscard]] size_t GetRetiredCount() const { return retired_objects_.size(); }
+
+ private:
+  mutable std::atomic<uint32_t> active_reader_count_ = 0;
+  // std::shared_ptr<const void> keeps the deleter of the original type.
+  std::vector<std::shared_ptr<const void>> retired_objects_;
+};
+
+}  // namespace orbit_base
+
+#endif  // ORBIT_BASE_DEFERRED_DELETER_H_
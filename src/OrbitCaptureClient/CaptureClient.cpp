@@ -20,6 +20,8 @@
 #include "OrbitBase/Tracing.h"
 #include "OrbitCaptureClient/CaptureEventProcessor.h"
 #include "OrbitCaptureClient/CaptureListener.h"
+#include "OrbitCaptureClient/EventShard.h"
+#include "OrbitCaptureClient/ShardedCaptureListener.h"
 #include "OrbitClientData/FunctionUtils.h"
 #include "OrbitClientData/ModuleData.h"
 #include "OrbitClientData/ProcessData.h"
@@ -178,11 +180,20 @@ ErrorMessageOr<CaptureListener::CaptureOutcome> CaptureClient::CaptureSync(
     state_ = State::kStarted;
   }
 
-  CaptureEventProcessor event_processor(capture_listener_);
+  // This thread only reads from the gRPC stream, so that the service is never slowed down by the
+  // processing of the events. The responses are decoded on another thread, which in turn hands the
+  // events to one thread per group of events (see ShardedCaptureListener).
+  ShardedCaptureListener sharded_capture_listener{capture_listener_};
+  CaptureEventProcessor event_processor(&sharded_capture_listener);
 
-  capture_listener_->OnCaptureStarted(std::move(process), std::move(selected_functions),
-                                      std::move(selected_tracepoints),
-                                      std::move(frame_track_function_ids));
+  sharded_capture_listener.OnCaptureStarted(std::move(process), std::move(selected_functions),
+                                            std::move(selected_tracepoints),
+                                            std::move(frame_track_function_ids));
+
+  EventShard<CaptureResponse> response_shard{
+      "CaptureDecoder", [&event_processor](CaptureResponse&& response) {
+        event_processor.ProcessEvents(response.capture_events());
+      }};
 
   while (!writes_done_failed_ && !try_abort_) {
     CaptureResponse response;
@@ -192,12 +203,17 @@ ErrorMessageOr<CaptureListener::CaptureOutcome> CaptureClient::CaptureSync(
       read_succeeded = reader_writer_->Read(&response);
     }
     if (read_succeeded) {
-      event_processor.ProcessEvents(response.capture_events());
+      response_shard.Add(std::move(response));
     } else {
       break;
     }
   }
 
+  // All the events received must have reached capture_listener_ before the capture is reported as
+  // finished, and before the next capture can start.
+  response_shard.Stop();
+  sharded_capture_listener.Flush();
+
   ErrorMessageOr<void> finish_result = FinishCapture();
   if (try_abort_) {
     LOG("TryCancel on Capture's gRPC context was called: Read on Capture's gRPC stream failed");
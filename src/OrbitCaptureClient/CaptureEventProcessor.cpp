@@ -27,6 +27,7 @@ using orbit_grpc_protos::CallstackSample;
 using orbit_grpc_protos::ClientCaptureEvent;
 using orbit_grpc_protos::FunctionCall;
 using orbit_grpc_protos::GpuJob;
+using orbit_grpc_protos::GpuQuerySlotsExhaustedEvent;
 using orbit_grpc_protos::GpuQueueSubmission;
 using orbit_grpc_protos::InternedCallstack;
 using orbit_grpc_protos::InternedString;
@@ -76,6 +77,9 @@ void CaptureEventProcessor::ProcessEvent(const ClientCaptureEvent& event) {
     case ClientCaptureEvent::kGpuQueueSubmission:
       ProcessGpuQueueSubmission(event.gpu_queue_submission());
       break;
+    case ClientCaptureEvent::kGpuQuerySlotsExhaustedEvent:
+      ProcessGpuQuerySlotsExhaustedEvent(event.gpu_query_slots_exhausted_event());
+      break;
     case ClientCaptureEvent::kModuleUpdateEvent:
       // TODO (http://b/168797897): Process module update events
       break;
@@ -254,6 +258,17 @@ void CaptureEventProcessor::ProcessGpuQueueSubmission(
   }
 }
 
+void CaptureEventProcessor::ProcessGpuQuerySlotsExhaustedEvent(
+    const GpuQuerySlotsExhaustedEvent& gpu_query_slots_exhausted_event) {
+  // The GPU tracks of such a capture are incomplete, make sure this is visible in the logs.
+  ERROR(
+      "Vulkan layer ran out of timestamp query slots in process %d: dropped %u command buffer and "
+      "%u debug marker timestamps",
+      gpu_query_slots_exhausted_event.pid(),
+      gpu_query_slots_exhausted_event.num_dropped_command_buffer_timestamps(),
+      gpu_query_slots_exhausted_event.num_dropped_debug_marker_timestamps());
+}
+
 void CaptureEventProcessor::ProcessThreadName(const ThreadName& thread_name) {
   // Note: thread_name.pid() is available, but currently dropped.
   capture_listener_->OnThreadName(thread_name.tid(), thread_name.name());
@@ -0,0 +1,133 @@
+// Copyright (c) 2021 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "OrbitCaptureClient/ShardedCaptureListener.h"
+
+#include <type_traits>
+#include <utility>
+#include <variant>
+
+#include "OrbitBase/Logging.h"
+
+using orbit_client_protos::CallstackEvent;
+using orbit_client_protos::FunctionInfo;
+using orbit_client_protos::LinuxAddressInfo;
+using orbit_client_protos::ThreadStateSliceInfo;
+using orbit_client_protos::TimerInfo;
+using orbit_client_protos::TracepointEventInfo;
+
+ShardedCaptureListener::ShardedCaptureListener(CaptureListener* capture_listener)
+    : capture_listener_{capture_listener},
+      timer_shard_{"CaptureTimers",
+                   [this](TimerEvent&& event) { ForwardTimerEvent(std::move(event)); }},
+      sample_shard_{"CaptureSamples",
+                    [this](SampleEvent&& event) { ForwardSampleEvent(std::move(event)); }},
+      thread_state_shard_{"CaptureThreadSt",
+                          [this](ThreadStateSliceInfo&& thread_state_slice) {
+                            capture_listener_->OnThreadStateSlice(std::move(thread_state_slice));
+                          }},
+      tracepoint_shard_{"CaptureTracepts", [this](TracepointEvent&& event) {
+                          ForwardTracepointEvent(std::move(event));
+                        }} {
+  CHECK(capture_listener_ != nullptr);
+}
+
+void ShardedCaptureListener::OnCaptureStarted(
+    ProcessData&& process, absl::flat_hash_map<uint64_t, FunctionInfo> instrumented_functions,
+    TracepointInfoSet selected_tracepoints,
+    absl::flat_hash_set<uint64_t> frame_track_function_ids) {
+  capture_listener_->OnCaptureStarted(std::move(process), std::move(instrumented_functions),
+                                      std::move(selected_tracepoints),
+                                      std::move(frame_track_function_ids));
+}
+
+void ShardedCaptureListener::OnTimer(const TimerInfo& timer_info) {
+  timer_shard_.Add(timer_info);
+}
+
+void ShardedCaptureListener::OnKeyAndString(uint64_t key, std::string str) {
+  capture_listener_->OnKeyAndString(key, std::move(str));
+}
+
+void ShardedCaptureListener::OnUniqueCallStack(CallStack callstack) {
+  sample_shard_.Add(std::move(callstack));
+}
+
+void ShardedCaptureListener::OnCallstackEvent(CallstackEvent callstack_event) {
+  sample_shard_.Add(std::move(callstack_event));
+}
+
+void ShardedCaptureListener::OnThreadName(int32_t thread_id, std::string thread_name) {
+  timer_shard_.Add(ThreadName{thread_id, std::move(thread_name)});
+}
+
+void ShardedCaptureListener::OnThreadStateSlice(ThreadStateSliceInfo thread_state_slice) {
+  thread_state_shard_.Add(std::move(thread_state_slice));
+}
+
+void ShardedCaptureListener::OnAddressInfo(LinuxAddressInfo address_info) {
+  sample_shard_.Add(std::move(address_info));
+}
+
+void ShardedCaptureListener::OnUniqueTracepointInfo(
+    uint64_t key, orbit_grpc_protos::TracepointInfo tracepoint_info) {
+  tracepoint_shard_.Add(UniqueTracepointInfo{key, std::move(tracepoint_info)});
+}
+
+void ShardedCaptureListener::OnTracepointEvent(TracepointEventInfo tracepoint_event_info) {
+  tracepoint_shard_.Add(std::move(tracepoint_event_info));
+}
+
+void ShardedCaptureListener::Flush() {
+  timer_shard_.Flush();
+  sample_shard_.Flush();
+  thread_state_shard_.Flush();
+  tracepoint_shard_.Flush();
+}
+
+void ShardedCaptureListener::ForwardTimerEvent(TimerEvent&& event) {
+  std::visit(
+      [this](auto&& timer_event) {
+        using T = std::decay_t<decltype(timer_event)>;
+        if constexpr (std::is_same_v<T, TimerInfo>) {
+          capture_listener_->OnTimer(timer_event);
+        } else {
+          static_assert(std::is_same_v<T, ThreadName>);
+          capture_listener_->OnThreadName(timer_event.thread_id,
+                                          std::move(timer_event.thread_name));
+        }
+      },
+      std::move(event));
+}
+
+void ShardedCaptureListener::ForwardSampleEvent(SampleEvent&& event) {
+  std::visit(
+      [this](auto&& sample_event) {
+        using T = std::decay_t<decltype(sample_event)>;
+        if constexpr (std::is_same_v<T, CallStack>) {
+          capture_listener_->OnUniqueCallStack(std::move(sample_event));
+        } else if constexpr (std::is_same_v<T, CallstackEvent>) {
+          capture_listener_->OnCallstackEvent(std::move(sample_event));
+        } else {
+          static_assert(std::is_same_v<T, LinuxAddressInfo>);
+          capture_listener_->OnAddressInfo(std::move(sample_event));
+        }
+      },
+      std::move(event));
+}
+
+void ShardedCaptureListener::ForwardTracepointEvent(TracepointEvent&& event) {
+  std::visit(
+      [this](auto&& tracepoint_event) {
+        using T = std::decay_t<decltype(tracepoint_event)>;
+        if constexpr (std::is_same_v<T, UniqueTracepointInfo>) {
+          capture_listener_->OnUniqueTracepointInfo(tracepoint_event.key,
+                                                    std::move(tracepoint_event.tracepoint_info));
+        } else {
+          static_assert(std::is_same_v<T, TracepointEventInfo>);
+          capture_listener_->OnTracepointEvent(std::move(tracepoint_event));
+        }
+      },
+      std::move(event));
+}
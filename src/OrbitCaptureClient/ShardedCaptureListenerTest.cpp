@@ -0,0 +1,205 @@
+// Copyright (c) 2021 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <absl/synchronization/mutex.h>
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "OrbitCaptureClient/CaptureListener.h"
+#include "OrbitCaptureClient/EventShard.h"
+#include "OrbitCaptureClient/ShardedCaptureListener.h"
+#include "OrbitClientData/Callstack.h"
+#include "capture_data.pb.h"
+#include "tracepoint.pb.h"
+
+using orbit_client_protos::CallstackEvent;
+using orbit_client_protos::FunctionInfo;
+using orbit_client_protos::LinuxAddressInfo;
+using orbit_client_protos::ThreadStateSliceInfo;
+using orbit_client_protos::TimerInfo;
+using orbit_client_protos::TracepointEventInfo;
+using orbit_grpc_protos::TracepointInfo;
+using ::testing::ElementsAre;
+using ::testing::ElementsAreArray;
+
+namespace {
+
+// Records the calls of each group of events of ShardedCaptureListener, as a sequence of numbers,
+// together with the threads the calls were made from.
+class RecordingCaptureListener : public CaptureListener {
+ public:
+  void OnCaptureStarted(ProcessData&& /*process*/,
+                        absl::flat_hash_map<uint64_t, FunctionInfo> /*instrumented_functions*/,
+                        TracepointInfoSet /*selected_tracepoints*/,
+                        absl::flat_hash_set<uint64_t> /*frame_track_function_ids*/) override {
+    Record(&capture_started_, 0);
+  }
+  void OnTimer(const TimerInfo& timer_info) override { Record(&timers_, timer_info.start()); }
+  void OnKeyAndString(uint64_t key, std::string /*str*/) override { Record(&strings_, key); }
+  void OnUniqueCallStack(CallStack callstack) override { Record(&samples_, callstack.id()); }
+  void OnCallstackEvent(CallstackEvent callstack_event) override {
+    Record(&samples_, callstack_event.time());
+  }
+  void OnThreadName(int32_t thread_id, std::string /*thread_name*/) override {
+    Record(&timers_, static_cast<uint64_t>(thread_id));
+  }
+  void OnThreadStateSlice(ThreadStateSliceInfo thread_state_slice) override {
+    Record(&thread_states_, thread_state_slice.begin_timestamp_ns());
+  }
+  void OnAddressInfo(LinuxAddressInfo address_info) override {
+    Record(&samples_, address_info.absolute_address());
+  }
+  void OnUniqueTracepointInfo(uint64_t key, TracepointInfo /*tracepoint_info*/) override {
+    Record(&tracepoints_, key);
+  }
+  void OnTracepointEvent(TracepointEventInfo tracepoint_event_info) override {
+    Record(&tracepoints_, tracepoint_event_info.time());
+  }
+
+  struct Calls {
+    std::vector<uint64_t> values;
+    std::vector<std::thread::id> thread_ids;
+  };
+
+  [[nodiscard]] Calls capture_started() const { return Get(&capture_started_); }
+  [[nodiscard]] Calls timers() const { return Get(&timers_); }
+  [[nodiscard]] Calls strings() const { return Get(&strings_); }
+  [[nodiscard]] Calls samples() const { return Get(&samples_); }
+  [[nodiscard]] Calls thread_states() const { return Get(&thread_states_); }
+  [[nodiscard]] Calls tracepoints() const { return Get(&tracepoints_); }
+
+ private:
+  void Record(Calls* calls, uint64_t value) {
+    absl::MutexLock lock{&mutex_};
+    calls->values.push_back(value);
+    calls->thread_ids.push_back(std::this_thread::get_id());
+  }
+
+  [[nodiscard]] Calls Get(const Calls* calls) const {
+    absl::MutexLock lock{&mutex_};
+    return *calls;
+  }
+
+  mutable absl::Mutex mutex_;
+  Calls capture_started_;
+  Calls timers_;
+  Calls strings_;
+  Calls samples_;
+  Calls thread_states_;
+  Calls tracepoints_;
+};
+
+// Expects that all calls were made from the same thread, and returns that thread.
+std::thread::id GetSingleThreadId(const RecordingCaptureListener::Calls& calls) {
+  EXPECT_FALSE(calls.thread_ids.empty());
+  if (calls.thread_ids.empty()) return {};
+  EXPECT_THAT(calls.thread_ids,
+              ElementsAreArray(std::vector<std::thread::id>(calls.thread_ids.size(),
+                                                            calls.thread_ids.front())));
+  return calls.thread_ids.front();
+}
+
+}  // namespace
+
+TEST(EventShard, ConsumesEventsInOrderOnAnotherThread) {
+  absl::Mutex mutex;
+  std::vector<int> consumed;
+  std::vector<std::thread::id> consumer_thread_ids;
+  EventShard<int> shard{"EventShardTest", [&](int&& event) {
+                          absl::MutexLock lock{&mutex};
+                          consumed.push_back(event);
+                          consumer_thread_ids.push_back(std::this_thread::get_id());
+                        }};
+
+  std::vector<int> expected;
+  for (int i = 0; i < 1000; ++i) {
+    shard.Add(int{i});
+    expected.push_back(i);
+  }
+  shard.Flush();
+  {
+    absl::MutexLock lock{&mutex};
+    EXPECT_EQ(consumed, expected);
+    for (std::thread::id thread_id : consumer_thread_ids) {
+      EXPECT_NE(thread_id, std::this_thread::get_id());
+    }
+  }
+
+  shard.Add(1000);
+  expected.push_back(1000);
+  shard.Stop();
+  absl::MutexLock lock{&mutex};
+  EXPECT_EQ(consumed, expected);
+}
+
+TEST(ShardedCaptureListener, ForwardsEachGroupInOrderOnItsOwnThread) {
+  RecordingCaptureListener listener;
+  ShardedCaptureListener sharded_listener{&listener};
+
+  sharded_listener.OnCaptureStarted(ProcessData{}, {}, {}, {});
+  constexpr uint64_t kEventCount = 100;
+  for (uint64_t i = 0; i < kEventCount; ++i) {
+    sharded_listener.OnKeyAndString(i, "string");
+
+    sharded_listener.OnThreadName(static_cast<int32_t>(2 * i), "thread");
+    TimerInfo timer_info;
+    timer_info.set_start(2 * i + 1);
+    sharded_listener.OnTimer(timer_info);
+
+    sharded_listener.OnUniqueCallStack(CallStack{3 * i, {}});
+    CallstackEvent callstack_event;
+    callstack_event.set_time(3 * i + 1);
+    sharded_listener.OnCallstackEvent(callstack_event);
+    LinuxAddressInfo address_info;
+    address_info.set_absolute_address(3 * i + 2);
+    sharded_listener.OnAddressInfo(address_info);
+
+    ThreadStateSliceInfo thread_state_slice;
+    thread_state_slice.set_begin_timestamp_ns(i);
+    sharded_listener.OnThreadStateSlice(thread_state_slice);
+
+    sharded_listener.OnUniqueTracepointInfo(2 * i, TracepointInfo{});
+    TracepointEventInfo tracepoint_event_info;
+    tracepoint_event_info.set_time(2 * i + 1);
+    sharded_listener.OnTracepointEvent(tracepoint_event_info);
+  }
+  sharded_listener.Flush();
+
+  std::vector<uint64_t> expected_once(kEventCount);
+  std::vector<uint64_t> expected_twice(2 * kEventCount);
+  std::vector<uint64_t> expected_thrice(3 * kEventCount);
+  for (uint64_t i = 0; i < 3 * kEventCount; ++i) {
+    if (i < kEventCount) expected_once[i] = i;
+    if (i < 2 * kEventCount) expected_twice[i] = i;
+    expected_thrice[i] = i;
+  }
+
+  EXPECT_THAT(listener.capture_started().values, ElementsAre(0));
+  EXPECT_EQ(listener.strings().values, expected_once);
+  EXPECT_EQ(listener.timers().values, expected_twice);
+  EXPECT_EQ(listener.samples().values, expected_thrice);
+  EXPECT_EQ(listener.thread_states().values, expected_once);
+  EXPECT_EQ(listener.tracepoints().values, expected_twice);
+
+  // OnCaptureStarted and OnKeyAndString are forwarded on the calling thread, every other group on
+  // a thread of its own.
+  const std::thread::id this_thread_id = std::this_thread::get_id();
+  EXPECT_EQ(GetSingleThreadId(listener.capture_started()), this_thread_id);
+  EXPECT_EQ(GetSingleThreadId(listener.strings()), this_thread_id);
+  std::vector<std::thread::id> shard_thread_ids{
+      GetSingleThreadId(listener.timers()), GetSingleThreadId(listener.samples()),
+      GetSingleThreadId(listener.thread_states()), GetSingleThreadId(listener.tracepoints())};
+  for (size_t i = 0; i < shard_thread_ids.size(); ++i) {
+    EXPECT_NE(shard_thread_ids[i], this_thread_id);
+    for (size_t j = i + 1; j < shard_thread_ids.size(); ++j) {
+      EXPECT_NE(shard_thread_ids[i], shard_thread_ids[j]);
+    }
+  }
+}
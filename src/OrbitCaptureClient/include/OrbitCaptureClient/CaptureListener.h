@@ -13,6 +13,9 @@
 #include "absl/container/flat_hash_set.h"
 #include "capture_data.pb.h"
 
+// CaptureClient calls OnCaptureStarted first, then the other methods from several threads, as
+// described in ShardedCaptureListener: the methods for events of the same kind are called in the
+// order of the events, but not necessarily in order with the methods for other kinds of events.
 class CaptureListener {
  public:
   enum class CaptureOutcome { kComplete, kCancelled };
@@ -0,0 +1,89 @@
+// Copyright (c) 2021 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef ORBIT_CAPTURE_CLIENT_EVENT_SHARD_H_
+#define ORBIT_CAPTURE_CLIENT_EVENT_SHARD_H_
+
+#include <absl/synchronization/mutex.h>
+
+#include <functional>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "OrbitBase/Logging.h"
+#include "OrbitBase/ThreadUtils.h"
+
+// Passes the events added with Add to `consumer` on a dedicated thread, in the order in which they
+// were added. The producer only appends to a vector under a mutex, while the consumer thread takes
+// all pending events at once, so that the two hardly ever contend.
+template <typename Event>
+class EventShard {
+ public:
+  explicit EventShard(std::string thread_name, std::function<void(Event&&)> consumer)
+      : consumer_{std::move(consumer)},
+        thread_{[this, thread_name = std::move(thread_name)] { Run(thread_name); }} {}
+
+  EventShard(const EventShard&) = delete;
+  EventShard& operator=(const EventShard&) = delete;
+  EventShard(EventShard&&) = delete;
+  EventShard& operator=(EventShard&&) = delete;
+
+  ~EventShard() { Stop(); }
+
+  void Add(Event&& event) {
+    absl::MutexLock lock{&mutex_};
+    CHECK(!stopping_);
+    events_.push_back(std::move(event));
+  }
+
+  // Blocks until all the events added so far have been consumed.
+  void Flush() {
+    absl::MutexLock lock{&mutex_};
+    mutex_.Await(absl::Condition(this, &EventShard::IsIdle));
+  }
+
+  // Consumes the remaining events and joins the thread. No events can be added afterwards.
+  void Stop() {
+    {
+      absl::MutexLock lock{&mutex_};
+      stopping_ = true;
+    }
+    if (thread_.joinable()) thread_.join();
+  }
+
+ private:
+  [[nodiscard]] bool HasEventsOrIsStopping() const { return !events_.empty() || stopping_; }
+  [[nodiscard]] bool IsIdle() const { return events_.empty() && !consuming_; }
+
+  void Run(const std::string& thread_name) {
+    orbit_base::SetCurrentThreadName(thread_name.c_str());
+    std::vector<Event> events_to_consume;
+    while (true) {
+      {
+        absl::MutexLock lock{&mutex_};
+        consuming_ = false;
+        mutex_.Await(absl::Condition(this, &EventShard::HasEventsOrIsStopping));
+        if (events_.empty()) return;
+        std::swap(events_, events_to_consume);
+        consuming_ = true;
+      }
+      for (Event& event : events_to_consume) {
+        consumer_(std::move(event));
+      }
+      events_to_consume.clear();
+    }
+  }
+
+  std::function<void(Event&&)> consumer_;
+  absl::Mutex mutex_;
+  std::vector<Event> events_ ABSL_GUARDED_BY(mutex_);
+  bool consuming_ ABSL_GUARDED_BY(mutex_) = false;
+  bool stopping_ ABSL_GUARDED_BY(mutex_) = false;
+  // Declared last, as the thread accesses all the other members.
+  std::thread thread_;
+};
+
+#endif  // ORBIT_CAPTURE_CLIENT_EVENT_SHARD_H_
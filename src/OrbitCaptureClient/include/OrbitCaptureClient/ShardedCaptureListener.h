@@ -0,0 +1,84 @@
+// Copyright (c) 2021 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef ORBIT_CAPTURE_CLIENT_SHARDED_CAPTURE_LISTENER_H_
+#define ORBIT_CAPTURE_CLIENT_SHARDED_CAPTURE_LISTENER_H_
+
+#include <absl/container/flat_hash_map.h>
+#include <absl/container/flat_hash_set.h>
+
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <variant>
+
+#include "OrbitCaptureClient/CaptureListener.h"
+#include "OrbitCaptureClient/EventShard.h"
+#include "OrbitClientData/Callstack.h"
+#include "OrbitClientData/ProcessData.h"
+#include "OrbitClientData/TracepointCustom.h"
+#include "capture_data.pb.h"
+#include "tracepoint.pb.h"
+
+// Forwards the calls to another CaptureListener from one thread per group of events, so that the
+// events of different groups are processed in parallel and the caller does not wait for any of
+// them. The groups are:
+// - timers and thread names, as tracks take the name of their thread when they are created;
+// - samples: unique callstacks, callstack events and address infos;
+// - thread state slices;
+// - tracepoint infos and tracepoint events.
+// The calls of each group are forwarded in the order in which they were made. OnCaptureStarted
+// and OnKeyAndString are forwarded immediately on the calling thread, so that a string is always
+// known to the listener before the events that refer to it.
+class ShardedCaptureListener : public CaptureListener {
+ public:
+  explicit ShardedCaptureListener(CaptureListener* capture_listener);
+
+  void OnCaptureStarted(
+      ProcessData&& process,
+      absl::flat_hash_map<uint64_t, orbit_client_protos::FunctionInfo> instrumented_functions,
+      TracepointInfoSet selected_tracepoints,
+      absl::flat_hash_set<uint64_t> frame_track_function_ids) override;
+  void OnTimer(const orbit_client_protos::TimerInfo& timer_info) override;
+  void OnKeyAndString(uint64_t key, std::string str) override;
+  void OnUniqueCallStack(CallStack callstack) override;
+  void OnCallstackEvent(orbit_client_protos::CallstackEvent callstack_event) override;
+  void OnThreadName(int32_t thread_id, std::string thread_name) override;
+  void OnThreadStateSlice(orbit_client_protos::ThreadStateSliceInfo thread_state_slice) override;
+  void OnAddressInfo(orbit_client_protos::LinuxAddressInfo address_info) override;
+  void OnUniqueTracepointInfo(uint64_t key,
+                              orbit_grpc_protos::TracepointInfo tracepoint_info) override;
+  void OnTracepointEvent(orbit_client_protos::TracepointEventInfo tracepoint_event_info) override;
+
+  // Blocks until all the calls made so far have been forwarded.
+  void Flush();
+
+ private:
+  struct ThreadName {
+    int32_t thread_id;
+    std::string thread_name;
+  };
+  struct UniqueTracepointInfo {
+    uint64_t key;
+    orbit_grpc_protos::TracepointInfo tracepoint_info;
+  };
+
+  using TimerEvent = std::variant<orbit_client_protos::TimerInfo, ThreadName>;
+  using SampleEvent = std::variant<CallStack, orbit_client_protos::CallstackEvent,
+                                   orbit_client_protos::LinuxAddressInfo>;
+  using TracepointEvent =
+      std::variant<UniqueTracepointInfo, orbit_client_protos::TracepointEventInfo>;
+
+  void ForwardTimerEvent(TimerEvent&& event);
+  void ForwardSampleEvent(SampleEvent&& event);
+  void ForwardTracepointEvent(TracepointEvent&& event);
+
+  CaptureListener* capture_listener_;
+  EventShard<TimerEvent> timer_shard_;
+  EventShard<SampleEvent> sample_shard_;
+  EventShard<orbit_client_protos::ThreadStateSliceInfo> thread_state_shard_;
+  EventShard<TracepointEvent> tracepoint_shard_;
+};
+
+#endif  // ORBIT_CAPTURE_CLIENT_SHARDED_CAPTURE_LISTENER_H_
@@ -0,0 +1,73 @@
+// Copyright (c) 2021 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "OrbitClientData/AddressRangeIndex.h"
+
+namespace orbit_client_data {
+
+namespace {
+
+AddressRangeIndex<std::string> CreateIndex() {
+  // Deliberately not sorted by start address.
+  return AddressRangeIndex<std::string>{{
+      {0x3000, 0x3fff, "third"},
+      {0x1000, 0x1fff, "first"},
+      {0x2000, 0x2800, "second"},
+  }};
+}
+
+}  // namespace
+
+TEST(AddressRangeIndex, Empty) {
+  AddressRangeIndex<std::string> index;
+  EXPECT_TRUE(index.empty());
+  EXPECT_EQ(index.Find(0), nullptr);
+  EXPECT_EQ(index.Find(0x1000), nullptr);
+  EXPECT_THAT(index.FindAll({0, 0x1000}), testing::ElementsAre(nullptr, nullptr));
+}
+
+TEST(AddressRangeIndex, Find) {
+  AddressRangeIndex<std::string> index = CreateIndex();
+  EXPECT_FALSE(index.empty());
+  EXPECT_EQ(index.size(), 3);
+
+  EXPECT_EQ(index.Find(0), nullptr);
+  EXPECT_EQ(index.Find(0xfff), nullptr);
+
+  ASSERT_NE(index.Find(0x1000), nullptr);
+  EXPECT_EQ(*index.Find(0x1000), "first");
+  ASSERT_NE(index.Find(0x1fff), nullptr);
+  EXPECT_EQ(*index.Find(0x1fff), "first");
+
+  ASSERT_NE(index.Find(0x2800), nullptr);
+  EXPECT_EQ(*index.Find(0x2800), "second");
+  // Between the end of the second and the start of the third range.
+  EXPECT_EQ(index.Find(0x2801), nullptr);
+
+  ASSERT_NE(index.Find(0x3fff), nullptr);
+  EXPECT_EQ(*index.Find(0x3fff), "third");
+  EXPECT_EQ(index.Find(0x4000), nullptr);
+  EXPECT_EQ(index.Find(UINT64_MAX), nullptr);
+}
+
+TEST(AddressRangeIndex, FindAll) {
+  AddressRangeIndex<std::string> index = CreateIndex();
+  const std::vector<uint64_t> addresses{0x1000, 0x1008, 0x2900, 0x2008, 0x2000, 0x3000, 0x1010, 0};
+
+  std::vector<const std::string*> expected;
+  for (uint64_t address : addresses) {
+    expected.push_back(index.Find(address));
+  }
+  EXPECT_EQ(index.FindAll(addresses), expected);
+  EXPECT_TRUE(index.FindAll({}).empty());
+}
+
+}  // namespace orbit_client_data
@@ -6,6 +6,7 @@
 
 #include <absl/container/flat_hash_map.h>
 
+#include <algorithm>
 #include <cstdint>
 #include <utility>
 
@@ -16,146 +17,187 @@
 using orbit_client_protos::CallstackEvent;
 
 void CallstackData::AddCallstackEvent(CallstackEvent callstack_event) {
-  std::lock_guard lock(mutex_);
-  CHECK(unique_callstacks_.contains(callstack_event.callstack_id()));
+  CHECK(HasCallStack(callstack_event.callstack_id()));
+  absl::MutexLock lock(&columns_.writer_mutex());
   RegisterTime(callstack_event.time());
-  callstack_events_by_tid_[callstack_event.thread_id()][callstack_event.time()] =
-      std::move(callstack_event);
+  AddOrReplaceEvent(callstack_event.thread_id(), callstack_event.time(),
+                    callstack_event.callstack_id());
 }
 
 void CallstackData::RegisterTime(uint64_t time) {
-  if (time > max_time_) max_time_ = time;
-  if (time > 0 && time < min_time_) min_time_ = time;
+  // Only the writer modifies the times, so load and store don't need to be a single operation.
+  if (time > max_time_.load(std::memory_order_relaxed)) {
+    max_time_.store(time, std::memory_order_relaxed);
+  }
+  if (time > 0 && time < min_time_.load(std::memory_order_relaxed)) {
+    min_time_.store(time, std::memory_order_relaxed);
+  }
+}
+
+void CallstackData::AddOrReplaceEvent(int32_t tid, uint64_t time, CallstackID callstack_id) {
+  ThreadColumns* columns = columns_.GetOrCreateColumnsOfTid(tid);
+  const size_t size_before = columns->events.size();
+  columns->events.AddOrReplaceEvent(time, callstack_id);
+  if (columns->events.size() > size_before) {
+    columns->sample_counts.AddSample(time);
+    all_threads_sample_counts_.AddSample(time);
+  }
 }
 
 void CallstackData::AddUniqueCallStack(CallStack call_stack) {
-  std::lock_guard lock(mutex_);
   CallstackID id = call_stack.id();
-  unique_callstacks_[id] = std::make_shared<CallStack>(std::move(call_stack));
+  auto unique_callstack = std::make_shared<CallStack>(std::move(call_stack));
+  absl::MutexLock lock(&unique_callstacks_mutex_);
+  // Don't replace a CallStack with the same id: GetCallStack might have returned a pointer to it.
+  unique_callstacks_.try_emplace(id, std::move(unique_callstack));
 }
 
 uint32_t CallstackData::GetCallstackEventsCount() const {
-  std::lock_guard lock(mutex_);
   uint32_t count = 0;
-  for (const auto& tid_and_events : callstack_events_by_tid_) {
-    count += tid_and_events.second.size();
-  }
+  columns_.ForEachColumns([&count](int32_t /*tid*/, const ThreadColumns& columns) {
+    count += columns.events.size();
+  });
   return count;
 }
 
+uint64_t CallstackData::GetCallstackEventsAllocatedBytes() const {
+  uint64_t allocated_bytes = 0;
+  columns_.ForEachColumns([&allocated_bytes](int32_t /*tid*/, const ThreadColumns& columns) {
+    allocated_bytes += columns.events.GetAllocatedBytes();
+  });
+  return allocated_bytes;
+}
+
 std::vector<orbit_client_protos::CallstackEvent> CallstackData::GetCallstackEventsInTimeRange(
     uint64_t time_begin, uint64_t time_end) const {
-  std::lock_guard lock(mutex_);
   std::vector<CallstackEvent> callstack_events;
-  for (const auto& tid_and_events : callstack_events_by_tid_) {
-    const std::map<uint64_t, CallstackEvent>& events = tid_and_events.second;
-    for (auto event_it = events.lower_bound(time_begin); event_it != events.end(); ++event_it) {
-      uint64_t time = event_it->first;
-      if (time < time_end) {
-        callstack_events.push_back(event_it->second);
-      } else {
-        break;
-      }
-    }
+  if (time_begin >= time_end) {
+    return callstack_events;
   }
+  ForEachCallstackEventInTimeRange(
+      time_begin, time_end - 1,
+      [&callstack_events](const CallstackEvent& event) { callstack_events.push_back(event); });
   return callstack_events;
 }
 
 absl::flat_hash_map<int32_t, uint32_t> CallstackData::GetCallstackEventsCountsPerTid() const {
-  std::lock_guard lock(mutex_);
   absl::flat_hash_map<int32_t, uint32_t> counts;
-  for (const auto& tid_and_events : callstack_events_by_tid_) {
-    counts.emplace(tid_and_events.first, tid_and_events.second.size());
-  }
+  columns_.ForEachColumns([&counts](int32_t tid, const ThreadColumns& columns) {
+    counts.emplace(tid, columns.events.size());
+  });
   return counts;
 }
 
 uint32_t CallstackData::GetCallstackEventsOfTidCount(int32_t thread_id) const {
-  std::lock_guard lock(mutex_);
-  const auto& tid_and_events_it = callstack_events_by_tid_.find(thread_id);
-  if (tid_and_events_it == callstack_events_by_tid_.end()) {
-    return 0;
-  }
-  return tid_and_events_it->second.size();
+  uint32_t count = 0;
+  columns_.WithColumnsOfTid(
+      thread_id, [&count](const ThreadColumns& columns) { count = columns.events.size(); });
+  return count;
+}
+
+uint64_t CallstackData::GetCallstackEventsOfTidOutOfOrderModificationCount(
+    int32_t thread_id) const {
+  uint64_t modification_count = 0;
+  columns_.WithColumnsOfTid(thread_id, [&modification_count](const ThreadColumns& columns) {
+    modification_count = columns.events.GetOutOfOrderModificationCount();
+  });
+  return modification_count;
 }
 
 std::vector<CallstackEvent> CallstackData::GetCallstackEventsOfTidInTimeRange(
     int32_t tid, uint64_t time_begin, uint64_t time_end) const {
-  std::lock_guard lock(mutex_);
   std::vector<CallstackEvent> callstack_events;
-
-  auto tid_and_events_it = callstack_events_by_tid_.find(tid);
-  if (tid_and_events_it == callstack_events_by_tid_.end()) {
+  if (time_begin >= time_end) {
     return callstack_events;
   }
-
-  const std::map<uint64_t, CallstackEvent>& events = tid_and_events_it->second;
-  for (auto event_it = events.lower_bound(time_begin); event_it != events.end(); ++event_it) {
-    uint64_t time = event_it->first;
-    if (time < time_end) {
-      callstack_events.push_back(event_it->second);
-    } else {
-      break;
-    }
-  }
+  ForEachCallstackEventOfTidInTimeRange(
+      tid, time_begin, time_end - 1,
+      [&callstack_events](const CallstackEvent& event) { callstack_events.push_back(event); });
   return callstack_events;
 }
 
 void CallstackData::ForEachCallstackEvent(
     const std::function<void(const orbit_client_protos::CallstackEvent&)>& action) const {
-  std::lock_guard lock(mutex_);
-  for (const auto& [unused_tid, events] : callstack_events_by_tid_) {
-    for (const auto& [unused_timestamp, event] : events) {
+  CallstackEvent event;
+  columns_.ForEachColumns([&event, &action](int32_t tid, const ThreadColumns& columns) {
+    event.set_thread_id(tid);
+    columns.events.ForEachEvent([&event, &action](uint64_t timestamp, uint64_t callstack_id) {
+      event.set_time(timestamp);
+      event.set_callstack_id(callstack_id);
       action(event);
-    }
-  }
+    });
+  });
 }
 
 void CallstackData::ForEachCallstackEventInTimeRange(
     uint64_t min_timestamp, uint64_t max_timestamp,
     const std::function<void(const orbit_client_protos::CallstackEvent&)>& action) const {
-  std::lock_guard lock(mutex_);
   CHECK(min_timestamp <= max_timestamp);
-  for (const auto& [unused_tid, events] : callstack_events_by_tid_) {
-    for (auto event_it = events.lower_bound(min_timestamp);
-         event_it != events.upper_bound(max_timestamp); ++event_it) {
-      action(event_it->second);
-    }
-  }
+  columns_.ForEachColumns([&](int32_t tid, const ThreadColumns& columns) {
+    ForEachCallstackEventOfColumnsInTimeRange(tid, columns.events, min_timestamp, max_timestamp,
+                                              action);
+  });
 }
 
 void CallstackData::ForEachCallstackEventOfTidInTimeRange(
     int32_t tid, uint64_t min_timestamp, uint64_t max_timestamp,
     const std::function<void(const orbit_client_protos::CallstackEvent&)>& action) const {
-  std::lock_guard lock(mutex_);
   CHECK(min_timestamp <= max_timestamp);
-  const auto& tid_and_events_it = callstack_events_by_tid_.find(tid);
-  if (tid_and_events_it == callstack_events_by_tid_.end()) {
-    return;
-  }
-  const auto& events = tid_and_events_it->second;
-  for (auto event_it = events.lower_bound(min_timestamp);
-       event_it != events.upper_bound(max_timestamp); ++event_it) {
-    action(event_it->second);
-  }
+  columns_.WithColumnsOfTid(tid, [&](const ThreadColumns& columns) {
+    ForEachCallstackEventOfColumnsInTimeRange(tid, columns.events, min_timestamp, max_timestamp,
+                                              action);
+  });
+}
+
+void CallstackData::ForEachSampleCountInTimeRange(
+    size_t level, uint64_t min_timestamp, uint64_t max_timestamp,
+    const std::function<void(uint64_t, uint32_t)>& action) const {
+  CHECK(min_timestamp <= max_timestamp);
+  all_threads_sample_counts_.ForEachBucketInTimeRange(level, min_timestamp, max_timestamp, action);
+}
+
+void CallstackData::ForEachSampleCountOfTidInTimeRange(
+    int32_t tid, size_t level, uint64_t min_timestamp, uint64_t max_timestamp,
+    const std::function<void(uint64_t, uint32_t)>& action) const {
+  CHECK(min_timestamp <= max_timestamp);
+  columns_.WithColumnsOfTid(tid, [&](const ThreadColumns& columns) {
+    columns.sample_counts.ForEachBucketInTimeRange(level, min_timestamp, max_timestamp, action);
+  });
+}
+
+void CallstackData::ForEachCallstackEventOfColumnsInTimeRange(
+    int32_t tid, const CallstackEventColumns& events, uint64_t min_timestamp,
+    uint64_t max_timestamp,
+    const std::function<void(const orbit_client_protos::CallstackEvent&)>& action) {
+  CallstackEvent event;
+  event.set_thread_id(tid);
+  events.ForEachEventInTimeRange(min_timestamp, max_timestamp,
+                                 [&event, &action](uint64_t timestamp, uint64_t callstack_id) {
+                                   event.set_time(timestamp);
+                                   event.set_callstack_id(callstack_id);
+                                   action(event);
+                                 });
 }
 
 void CallstackData::AddCallStackFromKnownCallstackData(const CallstackEvent& event,
                                                        const CallstackData* known_callstack_data) {
-  std::lock_guard lock(mutex_);
   CallstackID callstack_id = event.callstack_id();
   std::shared_ptr<CallStack> unique_callstack = known_callstack_data->GetCallstackPtr(callstack_id);
   if (unique_callstack == nullptr) {
     return;
   }
 
-  // The insertion only happens if the hash isn't already present.
-  unique_callstacks_.emplace(callstack_id, std::move(unique_callstack));
-  callstack_events_by_tid_[event.thread_id()][event.time()] = CallstackEvent(event);
+  {
+    // The insertion only happens if the hash isn't already present.
+    absl::MutexLock lock(&unique_callstacks_mutex_);
+    unique_callstacks_.emplace(callstack_id, std::move(unique_callstack));
+  }
+  absl::MutexLock lock(&columns_.writer_mutex());
+  AddOrReplaceEvent(event.thread_id(), event.time(), callstack_id);
 }
 
 const CallStack* CallstackData::GetCallStack(CallstackID callstack_id) const {
-  std::lock_guard lock(mutex_);
+  absl::ReaderMutexLock lock(&unique_callstacks_mutex_);
   auto it = unique_callstacks_.find(callstack_id);
   if (it != unique_callstacks_.end()) {
     return it->second.get();
@@ -164,63 +206,73 @@ const CallStack* CallstackData::GetCallStack(CallstackID callstack_id) const {
 }
 
 bool CallstackData::HasCallStack(CallstackID callstack_id) const {
-  std::lock_guard lock(mutex_);
+  absl::ReaderMutexLock lock(&unique_callstacks_mutex_);
   return unique_callstacks_.contains(callstack_id);
 }
 
 void CallstackData::ForEachUniqueCallstack(
     const std::function<void(const CallStack&)>& action) const {
-  std::lock_guard lock(mutex_);
-  for (const auto& it : unique_callstacks_) {
-    action(*it.second);
+  std::vector<std::shared_ptr<CallStack>> unique_callstacks;
+  {
+    absl::ReaderMutexLock lock(&unique_callstacks_mutex_);
+    unique_callstacks.reserve(unique_callstacks_.size());
+    for (const auto& it : unique_callstacks_) {
+      unique_callstacks.push_back(it.second);
+    }
+  }
+  for (const std::shared_ptr<CallStack>& unique_callstack : unique_callstacks) {
+    action(*unique_callstack);
   }
 }
 
 void CallstackData::ForEachFrameInCallstack(uint64_t callstack_id,
                                             const std::function<void(uint64_t)>& action) const {
-  std::lock_guard lock(mutex_);
-  for (uint64_t frame : unique_callstacks_.at(callstack_id)->frames()) {
+  std::shared_ptr<CallStack> unique_callstack = GetCallstackPtr(callstack_id);
+  CHECK(unique_callstack != nullptr);
+  for (uint64_t frame : unique_callstack->frames()) {
     action(frame);
   }
 }
 
 absl::flat_hash_map<CallstackID, std::shared_ptr<CallStack>>
 CallstackData::GetUniqueCallstacksCopy() const {
-  std::lock_guard lock(mutex_);
+  absl::ReaderMutexLock lock(&unique_callstacks_mutex_);
   return unique_callstacks_;
 }
 
 std::shared_ptr<CallStack> CallstackData::GetCallstackPtr(CallstackID callstack_id) const {
+  absl::ReaderMutexLock lock(&unique_callstacks_mutex_);
   auto it = unique_callstacks_.find(callstack_id);
   if (it != unique_callstacks_.end()) {
-    return unique_callstacks_.at(callstack_id);
+    return it->second;
   }
   return nullptr;
 }
 
 void CallstackData::FilterCallstackEventsBasedOnMajorityStart() {
-  std::lock_guard lock(mutex_);
+  absl::MutexLock lock(&columns_.writer_mutex());
+  absl::ReaderMutexLock unique_callstacks_lock(&unique_callstacks_mutex_);
   uint32_t count_before_filtering = GetCallstackEventsCount();
 
-  for (auto& tid_and_events : callstack_events_by_tid_) {
-    std::map<uint64_t, CallstackEvent>& callstack_events = tid_and_events.second;
+  columns_.ForEachMutableColumns([this](int32_t tid, ThreadColumns& columns) {
+    CallstackEventColumns& callstack_events = columns.events;
     const uint64_t count_for_this_thread = callstack_events.size();
 
     // Count the number of occurrences of each outer frame for this thread.
     absl::flat_hash_map<uint64_t, uint64_t> count_by_outer_frame;
-    for (const auto& time_and_event : callstack_events) {
-      const CallstackEvent& event = time_and_event.second;
-      const std::vector<uint64_t>& frames = unique_callstacks_.at(event.callstack_id())->frames();
+    callstack_events.ForEachEvent([this, &count_by_outer_frame](uint64_t /*timestamp*/,
+                                                                uint64_t callstack_id) {
+      const std::vector<uint64_t>& frames = unique_callstacks_.at(callstack_id)->frames();
       if (frames.empty()) {
-        continue;
+        return;
       }
       uint64_t outer_frame = *frames.rbegin();
       ++count_by_outer_frame[outer_frame];
-    }
+    });
 
     // Find the outer frame with the most occurrences.
     if (count_by_outer_frame.empty()) {
-      continue;
+      return;
     }
     uint64_t majority_outer_frame = 0;
     uint64_t majority_outer_frame_count = 0;
@@ -237,26 +289,33 @@ void CallstackData::FilterCallstackEventsBasedOnMajorityStart() {
       ERROR(
           "Skipping filtering CallstackEvents for tid %d: majority outer frame has only %lu "
           "occurrences out of %lu",
-          tid_and_events.first, majority_outer_frame_count, count_for_this_thread);
-      continue;
+          tid, majority_outer_frame_count, count_for_this_thread);
+      return;
     }
 
     // Discard the CallstackEvents whose outer frame doesn't match the (super)majority outer frame.
-    for (auto time_and_event_it = callstack_events.begin();
-         time_and_event_it != callstack_events.end();) {
-      const CallstackEvent& event = time_and_event_it->second;
-      const std::vector<uint64_t>& frames = unique_callstacks_.at(event.callstack_id())->frames();
-      if (frames.empty() || *frames.rbegin() != majority_outer_frame) {
-        time_and_event_it = callstack_events.erase(time_and_event_it);
-      } else {
-        ++time_and_event_it;
-      }
-    }
-  }
+    callstack_events.RemoveEventsIf([this, majority_outer_frame](uint64_t callstack_id) {
+      const std::vector<uint64_t>& frames = unique_callstacks_.at(callstack_id)->frames();
+      return frames.empty() || *frames.rbegin() != majority_outer_frame;
+    });
+    SampleCountHistograms& sample_counts = columns.sample_counts;
+    sample_counts.Clear();
+    callstack_events.ForEachEvent([&sample_counts](uint64_t timestamp, uint64_t /*callstack_id*/) {
+      sample_counts.AddSample(timestamp);
+    });
+  });
 
   uint32_t count_after_filtering = GetCallstackEventsCount();
   CHECK(count_after_filtering <= count_before_filtering);
   uint32_t filtered_out_count = count_before_filtering - count_after_filtering;
+  if (filtered_out_count > 0) {
+    all_threads_sample_counts_.Clear();
+    columns_.ForEachColumns([this](int32_t /*tid*/, const ThreadColumns& columns) {
+      columns.events.ForEachEvent([this](uint64_t timestamp, uint64_t /*callstack_id*/) {
+        all_threads_sample_counts_.AddSample(timestamp);
+      });
+    });
+  }
   LOG("Filtered out %u CallstackEvents of the original %u (%.2f%%), remaining %u",
       filtered_out_count, count_before_filtering,
       100.0f * filtered_out_count / count_before_filtering, count_after_filtering);
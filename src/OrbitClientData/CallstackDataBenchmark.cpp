@@ -0,0 +1,99 @@
+// Copyright (c) 2021 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <benchmark/benchmark.h>
+
+#include <cstdint>
+#include <vector>
+
+#include "OrbitClientData/Callstack.h"
+#include "OrbitClientData/CallstackData.h"
+#include "capture_data.pb.h"
+
+// These benchmarks measure the memory used by the callstack events of a capture, and the time to
+// query a visible time range of them, as the CallstackThreadBars do on every frame.
+
+namespace {
+
+constexpr int32_t kThreadCount = 16;
+constexpr uint64_t kCallstackCount = 1024;
+// One sample per millisecond and thread, as with the default sampling rate.
+constexpr uint64_t kSamplingPeriodNs = 1'000'000;
+
+void AddCallstackEvents(CallstackData* callstack_data, uint64_t event_count_per_thread) {
+  for (uint64_t callstack_id = 0; callstack_id < kCallstackCount; ++callstack_id) {
+    callstack_data->AddUniqueCallStack(CallStack{callstack_id, {callstack_id, 0x10}});
+  }
+  orbit_client_protos::CallstackEvent event;
+  for (uint64_t i = 0; i < event_count_per_thread; ++i) {
+    for (int32_t tid = 0; tid < kThreadCount; ++tid) {
+      event.set_time(i * kSamplingPeriodNs + tid);
+      event.set_thread_id(tid);
+      event.set_callstack_id((i * 7 + tid) % kCallstackCount);
+      callstack_data->AddCallstackEvent(event);
+    }
+  }
+}
+
+void BM_AddCallstackEvents(benchmark::State& state) {
+  const auto event_count_per_thread = static_cast<uint64_t>(state.range(0));
+  uint64_t allocated_bytes = 0;
+  for (auto _ : state) {
+    CallstackData callstack_data;
+    AddCallstackEvents(&callstack_data, event_count_per_thread);
+    allocated_bytes = callstack_data.GetCallstackEventsAllocatedBytes();
+    benchmark::DoNotOptimize(allocated_bytes);
+  }
+  const uint64_t event_count = event_count_per_thread * kThreadCount;
+  state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * event_count));
+  state.counters["bytes_per_event"] =
+      static_cast<double>(allocated_bytes) / static_cast<double>(event_count);
+}
+
+// Visits the events of each thread in a time range, as when drawing the CallstackThreadBars.
+void BM_ForEachCallstackEventOfTidInTimeRange(benchmark::State& state) {
+  constexpr uint64_t kEventCountPerThread = 600'000;
+  const auto visible_event_count_per_thread = static_cast<uint64_t>(state.range(0));
+  CallstackData callstack_data;
+  AddCallstackEvents(&callstack_data, kEventCountPerThread);
+
+  const uint64_t min_timestamp = kEventCountPerThread / 2 * kSamplingPeriodNs;
+  const uint64_t max_timestamp =
+      min_timestamp + visible_event_count_per_thread * kSamplingPeriodNs - 1;
+  uint64_t visited_count = 0;
+  for (auto _ : state) {
+    for (int32_t tid = 0; tid < kThreadCount; ++tid) {
+      callstack_data.ForEachCallstackEventOfTidInTimeRange(
+          tid, min_timestamp, max_timestamp,
+          [&visited_count](const orbit_client_protos::CallstackEvent& /*event*/) {
+            ++visited_count;
+          });
+    }
+  }
+  benchmark::DoNotOptimize(visited_count);
+  state.SetItemsProcessed(static_cast<int64_t>(visited_count));
+}
+
+void BM_GetCallstackEventsInTimeRange(benchmark::State& state) {
+  constexpr uint64_t kEventCountPerThread = 600'000;
+  const auto visible_event_count_per_thread = static_cast<uint64_t>(state.range(0));
+  CallstackData callstack_data;
+  AddCallstackEvents(&callstack_data, kEventCountPerThread);
+
+  const uint64_t time_begin = kEventCountPerThread / 2 * kSamplingPeriodNs;
+  const uint64_t time_end = time_begin + visible_event_count_per_thread * kSamplingPeriodNs;
+  uint64_t returned_count = 0;
+  for (auto _ : state) {
+    std::vector<orbit_client_protos::CallstackEvent> events =
+        callstack_data.GetCallstackEventsInTimeRange(time_begin, time_end);
+    returned_count += events.size();
+  }
+  state.SetItemsProcessed(static_cast<int64_t>(returned_count));
+}
+
+}  // namespace
+
+BENCHMARK(BM_AddCallstackEvents)->Arg(1'000)->Arg(60'000)->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_ForEachCallstackEventOfTidInTimeRange)->Arg(10)->Arg(1'000)->Arg(100'000);
+BENCHMARK(BM_GetCallstackEventsInTimeRange)->Arg(10)->Arg(1'000)->Arg(100'000);
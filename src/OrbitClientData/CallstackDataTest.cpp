@@ -5,9 +5,13 @@
 #include <gmock/gmock.h>
 #include <gtest/gtest.h>
 
+#include <atomic>
 #include <cstdint>
 #include <limits>
+#include <optional>
+#include <thread>
 #include <tuple>
+#include <utility>
 #include <vector>
 
 #include "OrbitClientData/Callstack.h"
@@ -113,3 +117,159 @@ TEST(CallstackData, FilterCallstackEventsBasedOnMajorityStart) {
               testing::Pointwise(CallstackEventEq(),
                                  std::vector<orbit_client_protos::CallstackEvent>{event6, event7}));
 }
+
+TEST(CallstackData, AddingCallStackWithExistingIdKeepsTheFirstOne) {
+  CallstackData callstack_data;
+  const uint64_t cs_id = 12;
+  callstack_data.AddUniqueCallStack(CallStack{cs_id, {0x10, 0x11}});
+  const CallStack* call_stack = callstack_data.GetCallStack(cs_id);
+  ASSERT_NE(call_stack, nullptr);
+
+  callstack_data.AddUniqueCallStack(CallStack{cs_id, {0x20}});
+  EXPECT_EQ(callstack_data.GetCallStack(cs_id), call_stack);
+  EXPECT_THAT(call_stack->frames(), testing::ElementsAre(0x10, 0x11));
+}
+
+TEST(CallstackData, TimeRangeQueries) {
+  CallstackData callstack_data;
+  const uint64_t cs_id = 12;
+  callstack_data.AddUniqueCallStack(CallStack{cs_id, {0x10, 0x11}});
+
+  const int32_t tid1 = 42;
+  const int32_t tid2 = 43;
+  std::vector<orbit_client_protos::CallstackEvent> events;
+  for (uint64_t time : {100, 300, 200}) {
+    orbit_client_protos::CallstackEvent event;
+    event.set_time(time);
+    event.set_thread_id(tid1);
+    event.set_callstack_id(cs_id);
+    callstack_data.AddCallstackEvent(event);
+    events.push_back(event);
+  }
+  orbit_client_protos::CallstackEvent event_of_tid2;
+  event_of_tid2.set_time(200);
+  event_of_tid2.set_thread_id(tid2);
+  event_of_tid2.set_callstack_id(cs_id);
+  callstack_data.AddCallstackEvent(event_of_tid2);
+
+  EXPECT_EQ(callstack_data.GetCallstackEventsCount(), 4);
+  EXPECT_EQ(callstack_data.GetCallstackEventsOfTidCount(tid1), 3);
+  EXPECT_EQ(callstack_data.min_time(), 100);
+  EXPECT_EQ(callstack_data.max_time(), 300);
+
+  // The end of the range is excluded by the Get... methods.
+  EXPECT_THAT(
+      callstack_data.GetCallstackEventsOfTidInTimeRange(tid1, 100, 300),
+      testing::Pointwise(CallstackEventEq(),
+                         std::vector<orbit_client_protos::CallstackEvent>{events[0], events[2]}));
+  EXPECT_TRUE(callstack_data.GetCallstackEventsOfTidInTimeRange(tid1, 200, 200).empty());
+  EXPECT_EQ(callstack_data.GetCallstackEventsInTimeRange(200, 201).size(), 2);
+
+  // ... and included by the ForEach... methods.
+  std::vector<orbit_client_protos::CallstackEvent> visited_events;
+  callstack_data.ForEachCallstackEventOfTidInTimeRange(
+      tid1, 200, 300, [&visited_events](const orbit_client_protos::CallstackEvent& event) {
+        visited_events.push_back(event);
+      });
+  EXPECT_THAT(
+      visited_events,
+      testing::Pointwise(CallstackEventEq(),
+                         std::vector<orbit_client_protos::CallstackEvent>{events[2], events[1]}));
+
+  uint32_t visited_count = 0;
+  callstack_data.ForEachCallstackEventInTimeRange(
+      200, 200, [&visited_count](const orbit_client_protos::CallstackEvent& /*event*/) {
+        ++visited_count;
+      });
+  EXPECT_EQ(visited_count, 2);
+}
+
+TEST(CallstackData, SampleCountsPerTidAndOfAllThreads) {
+  CallstackData callstack_data;
+  const uint64_t cs_id = 12;
+  callstack_data.AddUniqueCallStack(CallStack{cs_id, {0x10, 0x11}});
+
+  const int32_t tid1 = 42;
+  const int32_t tid2 = 43;
+  const uint64_t width = SampleCountHistograms::GetBucketWidthNs(0);
+  auto add_event = [&callstack_data](int32_t tid, uint64_t time) {
+    orbit_client_protos::CallstackEvent event;
+    event.set_time(time);
+    event.set_thread_id(tid);
+    event.set_callstack_id(cs_id);
+    callstack_data.AddCallstackEvent(event);
+  };
+  add_event(tid1, width);
+  add_event(tid1, width + 1);
+  add_event(tid1, 3 * width);
+  add_event(tid2, width + 2);
+  // Replacing an event doesn't count it twice.
+  add_event(tid1, width);
+
+  using Bucket = std::pair<uint64_t, uint32_t>;
+  auto get_buckets = [&callstack_data](std::optional<int32_t> tid, uint64_t min_timestamp,
+                                       uint64_t max_timestamp) {
+    std::vector<Bucket> buckets;
+    auto action = [&buckets](uint64_t bucket_begin, uint32_t count) {
+      buckets.emplace_back(bucket_begin, count);
+    };
+    if (tid.has_value()) {
+      callstack_data.ForEachSampleCountOfTidInTimeRange(tid.value(), 0, min_timestamp,
+                                                        max_timestamp, action);
+    } else {
+      callstack_data.ForEachSampleCountInTimeRange(0, min_timestamp, max_timestamp, action);
+    }
+    return buckets;
+  };
+  const uint64_t max_time = std::numeric_limits<uint64_t>::max();
+  EXPECT_THAT(get_buckets(tid1, 0, max_time),
+              testing::ElementsAre(Bucket{width, 2}, Bucket{3 * width, 1}));
+  EXPECT_THAT(get_buckets(tid2, 0, max_time), testing::ElementsAre(Bucket{width, 1}));
+  EXPECT_THAT(get_buckets(std::nullopt, 0, max_time),
+              testing::ElementsAre(Bucket{width, 3}, Bucket{3 * width, 1}));
+  EXPECT_THAT(get_buckets(std::nullopt, 2 * width, max_time),
+              testing::ElementsAre(Bucket{3 * width, 1}));
+  EXPECT_THAT(get_buckets(44, 0, max_time), testing::IsEmpty());
+}
+
+TEST(CallstackData, ReadersDoNotBlockOnConcurrentWriter) {
+  static constexpr uint64_t kEventCountPerThread = 20'000;
+  constexpr int32_t kThreadCount = 8;
+  CallstackData callstack_data;
+  const uint64_t cs_id = 12;
+  callstack_data.AddUniqueCallStack(CallStack{cs_id, {0x10, 0x11}});
+
+  std::atomic<bool> writer_done = false;
+  std::thread reader_thread([&callstack_data, &writer_done] {
+    while (!writer_done) {
+      uint64_t previous_time = 0;
+      callstack_data.ForEachCallstackEventOfTidInTimeRange(
+          1, 0, std::numeric_limits<uint64_t>::max(),
+          [&callstack_data, &previous_time](const orbit_client_protos::CallstackEvent& event) {
+            EXPECT_GT(event.time(), previous_time);
+            previous_time = event.time();
+            callstack_data.ForEachFrameInCallstack(event.callstack_id(),
+                                                   [](uint64_t frame) { EXPECT_NE(frame, 0); });
+          });
+      // Events are only ever added, so a later query can't return fewer events.
+      const uint32_t previous_count = callstack_data.GetCallstackEventsCount();
+      EXPECT_GE(callstack_data.GetCallstackEventsInTimeRange(0, kEventCountPerThread + 1).size(),
+                previous_count);
+    }
+  });
+
+  orbit_client_protos::CallstackEvent event;
+  event.set_callstack_id(cs_id);
+  for (uint64_t time = 1; time <= kEventCountPerThread; ++time) {
+    for (int32_t tid = 0; tid < kThreadCount; ++tid) {
+      event.set_time(time);
+      event.set_thread_id(tid);
+      callstack_data.AddCallstackEvent(event);
+    }
+  }
+  writer_done = true;
+  reader_thread.join();
+
+  EXPECT_EQ(callstack_data.GetCallstackEventsCount(), kEventCountPerThread * kThreadCount);
+  EXPECT_EQ(callstack_data.GetCallstackEventsCountsPerTid().size(), kThreadCount);
+}
@@ -17,9 +17,27 @@
 using orbit_client_protos::FunctionInfo;
 using orbit_grpc_protos::ModuleInfo;
 
+namespace {
+
+// Returns the number of elements of `sorted_values` that are not greater than `value`. The loop
+// has a fixed number of iterations for a given size and no data-dependent branches, which the
+// compiler turns into conditional moves.
+size_t CountValuesNotGreaterThan(const std::vector<uint64_t>& sorted_values, uint64_t value) {
+  if (sorted_values.empty()) return 0;
+  const uint64_t* base = sorted_values.data();
+  size_t length = sorted_values.size();
+  while (length > 1) {
+    const size_t half = length / 2;
+    base = (base[half] <= value) ? base + half : base;
+    length -= half;
+  }
+  return static_cast<size_t>(base - sorted_values.data()) + (*base <= value ? 1 : 0);
+}
+
+}  // namespace
+
 bool ModuleData::is_loaded() const {
-  absl::MutexLock lock(&mutex_);
-  return is_loaded_;
+  return function_index_.load(std::memory_order_acquire) != nullptr;
 }
 
 void ModuleData::UpdateIfChanged(ModuleInfo info) {
@@ -41,13 +59,11 @@ void ModuleData::UpdateIfChanged(ModuleInfo info) {
 
   LOG("Module %s changed.", file_path());
 
-  if (!is_loaded_) return;
+  if (function_index_.load(std::memory_order_relaxed) == nullptr) return;
 
   LOG("Module %s contained symbols. Because the module changed, those are now removed.",
       file_path());
-  functions_.clear();
-  hash_to_function_map_.clear();
-  is_loaded_ = false;
+  function_index_.store(nullptr, std::memory_order_release);
 }
 
 const orbit_client_protos::FunctionInfo* ModuleData::FindFunctionByRelativeAddress(
@@ -58,36 +74,47 @@ const orbit_client_protos::FunctionInfo* ModuleData::FindFunctionByRelativeAddre
 
 const FunctionInfo* ModuleData::FindFunctionByElfAddress(uint64_t elf_address,
                                                          bool is_exact) const {
-  absl::MutexLock lock(&mutex_);
-  if (functions_.empty()) return nullptr;
+  const FunctionIndex* function_index = function_index_.load(std::memory_order_acquire);
+  if (function_index == nullptr) return nullptr;
+
+  const size_t count = CountValuesNotGreaterThan(function_index->addresses, elf_address);
+  if (count == 0) return nullptr;
+  const size_t index = count - 1;
 
   if (is_exact) {
-    auto it = functions_.find(elf_address);
-    return (it != functions_.end()) ? it->second.get() : nullptr;
+    return function_index->addresses[index] == elf_address ? function_index->functions[index].get()
+                                                           : nullptr;
   }
 
-  auto it = functions_.upper_bound(elf_address);
-  if (it == functions_.begin()) return nullptr;
-
-  --it;
-  FunctionInfo* function = it->second.get();
-  CHECK(function->address() <= elf_address);
-
-  if (function->address() + function->size() < elf_address) return nullptr;
-
-  return function;
+  if (function_index->addresses[index] + function_index->sizes[index] < elf_address) {
+    return nullptr;
+  }
+  return function_index->functions[index].get();
 }
 
 void ModuleData::AddSymbols(const orbit_grpc_protos::ModuleSymbols& module_symbols) {
   absl::MutexLock lock(&mutex_);
-  CHECK(!is_loaded_);
+  CHECK(function_index_.load(std::memory_order_relaxed) == nullptr);
 
+  std::vector<const orbit_grpc_protos::SymbolInfo*> symbol_infos;
+  symbol_infos.reserve(module_symbols.symbol_infos_size());
+  for (const orbit_grpc_protos::SymbolInfo& symbol_info : module_symbols.symbol_infos()) {
+    symbol_infos.push_back(&symbol_info);
+  }
+  // The stable sort keeps the first of multiple symbols at the same address first.
+  std::stable_sort(symbol_infos.begin(), symbol_infos.end(),
+                   [](const orbit_grpc_protos::SymbolInfo* lhs,
+                      const orbit_grpc_protos::SymbolInfo* rhs) {
+                     return lhs->address() < rhs->address();
+                   });
+
+  auto function_index = std::make_unique<FunctionIndex>();
+  function_index->addresses.reserve(symbol_infos.size());
+  function_index->sizes.reserve(symbol_infos.size());
+  function_index->functions.reserve(symbol_infos.size());
   uint32_t address_reuse_counter = 0;
   uint32_t name_reuse_counter = 0;
-  for (const orbit_grpc_protos::SymbolInfo& symbol_info : module_symbols.symbol_infos()) {
-    auto [inserted_it, success_functions] = functions_.try_emplace(
-        symbol_info.address(), function_utils::CreateFunctionInfo(symbol_info, file_path()));
-    FunctionInfo* function = inserted_it->second.get();
+  for (const orbit_grpc_protos::SymbolInfo* symbol_info : symbol_infos) {
     // It happens that the same address has multiple symbol names associated
     // with it. For example: (all the same address)
     // __cxxabiv1::__enum_type_info::~__enum_type_info()
@@ -95,15 +122,23 @@ void ModuleData::AddSymbols(const orbit_grpc_protos::ModuleSymbols& module_symbo
     // __cxxabiv1::__array_type_info::~__array_type_info()
     // __cxxabiv1::__class_type_info::~__class_type_info()
     // __cxxabiv1::__pbase_type_info::~__pbase_type_info()
-    if (success_functions) {
-      const bool success_func_hashes =
-          hash_to_function_map_.try_emplace(function_utils::GetHash(*function), function).second;
-      if (!success_func_hashes) {
-        name_reuse_counter++;
-      }
-    } else {
+    if (!function_index->addresses.empty() &&
+        function_index->addresses.back() == symbol_info->address()) {
       address_reuse_counter++;
+      continue;
     }
+    std::unique_ptr<FunctionInfo> function =
+        function_utils::CreateFunctionInfo(*symbol_info, file_path());
+    const bool success_func_hashes =
+        function_index->hash_to_function_map
+            .try_emplace(function_utils::GetHash(*function), function.get())
+            .second;
+    if (!success_func_hashes) {
+      name_reuse_counter++;
+    }
+    function_index->addresses.push_back(function->address());
+    function_index->sizes.push_back(function->size());
+    function_index->functions.push_back(std::move(function));
   }
   if (address_reuse_counter != 0) {
     LOG("Warning: %d absolute addresses are used by more than one symbol", address_reuse_counter);
@@ -115,29 +150,33 @@ void ModuleData::AddSymbols(const orbit_grpc_protos::ModuleSymbols& module_symbo
         name_reuse_counter);
   }
 
-  is_loaded_ = true;
+  function_index_.store(function_index.get(), std::memory_order_release);
+  function_indices_.push_back(std::move(function_index));
 }
 
 const orbit_client_protos::FunctionInfo* ModuleData::FindFunctionFromHash(uint64_t hash) const {
-  absl::MutexLock lock(&mutex_);
-  return hash_to_function_map_.contains(hash) ? hash_to_function_map_.at(hash) : nullptr;
+  const FunctionIndex* function_index = function_index_.load(std::memory_order_acquire);
+  if (function_index == nullptr) return nullptr;
+  const auto it = function_index->hash_to_function_map.find(hash);
+  return it != function_index->hash_to_function_map.end() ? it->second : nullptr;
 }
 
 const std::vector<const FunctionInfo*> ModuleData::GetFunctions() const {
-  absl::MutexLock lock(&mutex_);
   std::vector<const FunctionInfo*> result;
-  result.reserve(functions_.size());
-  for (const auto& pair : functions_) {
-    result.push_back(pair.second.get());
+  const FunctionIndex* function_index = function_index_.load(std::memory_order_acquire);
+  if (function_index == nullptr) return result;
+  result.reserve(function_index->functions.size());
+  for (const std::unique_ptr<FunctionInfo>& function : function_index->functions) {
+    result.push_back(function.get());
   }
   return result;
 }
 
 std::vector<FunctionInfo> ModuleData::GetOrbitFunctions() const {
-  absl::MutexLock lock(&mutex_);
-  CHECK(is_loaded_);
+  const FunctionIndex* function_index = function_index_.load(std::memory_order_acquire);
+  CHECK(function_index != nullptr);
   std::vector<FunctionInfo> result;
-  for (const auto& [_, function] : functions_) {
+  for (const std::unique_ptr<FunctionInfo>& function : function_index->functions) {
     if (function_utils::IsOrbitFunc(*function)) {
       result.emplace_back(*function);
     }
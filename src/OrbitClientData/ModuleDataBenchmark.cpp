@@ -0,0 +1,118 @@
+// Copyright (c) 2021 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <absl/synchronization/mutex.h>
+#include <benchmark/benchmark.h>
+
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <random>
+#include <vector>
+
+#include "OrbitClientData/FunctionUtils.h"
+#include "OrbitClientData/ModuleData.h"
+#include "capture_data.pb.h"
+#include "module.pb.h"
+#include "symbol.pb.h"
+
+// These benchmarks measure looking up the function that contains an address in a module with 500k
+// symbols, as when post-processing samples, against the std::map under a mutex that ModuleData used
+// before.
+
+namespace {
+
+using orbit_client_protos::FunctionInfo;
+
+constexpr uint64_t kSymbolCount = 500'000;
+constexpr uint64_t kFunctionSize = 0x100;
+constexpr size_t kLookupCount = 1 << 16;
+
+orbit_grpc_protos::ModuleSymbols CreateModuleSymbols() {
+  orbit_grpc_protos::ModuleSymbols module_symbols;
+  for (uint64_t i = 0; i < kSymbolCount; ++i) {
+    orbit_grpc_protos::SymbolInfo* symbol_info = module_symbols.add_symbol_infos();
+    symbol_info->set_name("function");
+    symbol_info->set_address(i * kFunctionSize);
+    symbol_info->set_size(kFunctionSize - 0x10);
+  }
+  return module_symbols;
+}
+
+std::vector<uint64_t> CreateRandomAddresses() {
+  std::mt19937_64 random_engine{0};
+  std::uniform_int_distribution<uint64_t> distribution{0, kSymbolCount * kFunctionSize - 1};
+  std::vector<uint64_t> addresses(kLookupCount);
+  for (uint64_t& address : addresses) {
+    address = distribution(random_engine);
+  }
+  return addresses;
+}
+
+// The implementation of ModuleData::FindFunctionByElfAddress before symbols were frozen into
+// sorted arrays, for non-exact lookups only.
+class MapUnderMutexModule {
+ public:
+  explicit MapUnderMutexModule(const orbit_grpc_protos::ModuleSymbols& module_symbols) {
+    for (const orbit_grpc_protos::SymbolInfo& symbol_info : module_symbols.symbol_infos()) {
+      functions_.try_emplace(symbol_info.address(),
+                             function_utils::CreateFunctionInfo(symbol_info, "/path/to/module"));
+    }
+  }
+
+  [[nodiscard]] const FunctionInfo* FindFunctionByElfAddress(uint64_t elf_address,
+                                                             bool /*is_exact*/) const {
+    absl::MutexLock lock(&mutex_);
+    auto it = functions_.upper_bound(elf_address);
+    if (it == functions_.begin()) return nullptr;
+    --it;
+    const FunctionInfo* function = it->second.get();
+    if (function->address() + function->size() < elf_address) return nullptr;
+    return function;
+  }
+
+ private:
+  mutable absl::Mutex mutex_;
+  std::map<uint64_t, std::unique_ptr<FunctionInfo>> functions_;
+};
+
+const ModuleData& GetModuleData() {
+  static const ModuleData* module_data = [] {
+    auto* module = new ModuleData{orbit_grpc_protos::ModuleInfo{}};
+    module->AddSymbols(CreateModuleSymbols());
+    return module;
+  }();
+  return *module_data;
+}
+
+const MapUnderMutexModule& GetMapUnderMutexModule() {
+  static const MapUnderMutexModule* module = new MapUnderMutexModule{CreateModuleSymbols()};
+  return *module;
+}
+
+template <typename Module>
+void FindFunctionsOfRandomAddresses(benchmark::State& state, const Module& module) {
+  const std::vector<uint64_t> addresses = CreateRandomAddresses();
+  size_t found_count = 0;
+  for (auto _ : state) {
+    for (uint64_t address : addresses) {
+      found_count += module.FindFunctionByElfAddress(address, false) != nullptr ? 1 : 0;
+    }
+  }
+  benchmark::DoNotOptimize(found_count);
+  state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * addresses.size()));
+}
+
+void BM_FindFunctionByElfAddress(benchmark::State& state) {
+  FindFunctionsOfRandomAddresses(state, GetModuleData());
+}
+
+void BM_FindFunctionByElfAddressInMapUnderMutex(benchmark::State& state) {
+  FindFunctionsOfRandomAddresses(state, GetMapUnderMutexModule());
+}
+
+}  // namespace
+
+BENCHMARK(BM_FindFunctionByElfAddress)->ThreadRange(1, 4);
+BENCHMARK(BM_FindFunctionByElfAddressInMapUnderMutex)->ThreadRange(1, 4);
@@ -10,6 +10,7 @@
 
 #include "OrbitClientData/FunctionUtils.h"
 #include "OrbitClientData/ModuleData.h"
+#include "absl/strings/str_format.h"
 #include "capture_data.pb.h"
 #include "module.pb.h"
 #include "symbol.pb.h"
@@ -158,6 +159,59 @@ TEST(ModuleData, FindFunctionByRelativeAddress) {
   }
 }
 
+TEST(ModuleData, FindFunctionByElfAddressWithUnsortedSymbols) {
+  ModuleSymbols symbols;
+  for (uint64_t address : {300u, 100u, 200u, 100u}) {
+    SymbolInfo* symbol = symbols.add_symbol_infos();
+    symbol->set_name(absl::StrFormat("function at %d, #%d", address, symbols.symbol_infos_size()));
+    symbol->set_address(address);
+    symbol->set_size(10);
+  }
+
+  ModuleData module{ModuleInfo{}};
+  module.AddSymbols(symbols);
+
+  // Of multiple symbols at the same address, the first one is kept.
+  std::vector<const FunctionInfo*> functions = module.GetFunctions();
+  ASSERT_EQ(functions.size(), 3);
+  EXPECT_EQ(functions[0]->name(), "function at 100, #2");
+  EXPECT_EQ(functions[1]->address(), 200);
+  EXPECT_EQ(functions[2]->address(), 300);
+
+  EXPECT_EQ(module.FindFunctionByElfAddress(99, false), nullptr);
+  EXPECT_EQ(module.FindFunctionByElfAddress(100, true), functions[0]);
+  EXPECT_EQ(module.FindFunctionByElfAddress(105, false), functions[0]);
+  EXPECT_EQ(module.FindFunctionByElfAddress(111, false), nullptr);
+  EXPECT_EQ(module.FindFunctionByElfAddress(200, false), functions[1]);
+  EXPECT_EQ(module.FindFunctionByElfAddress(205, true), nullptr);
+  EXPECT_EQ(module.FindFunctionByElfAddress(310, false), functions[2]);
+  EXPECT_EQ(module.FindFunctionByElfAddress(311, false), nullptr);
+}
+
+TEST(ModuleData, FunctionsStayValidAfterSymbolsAreRemoved) {
+  ModuleInfo module_info{};
+  module_info.set_build_id("build id");
+  ModuleData module{module_info};
+
+  ModuleSymbols symbols;
+  SymbolInfo* symbol = symbols.add_symbol_infos();
+  symbol->set_name("function");
+  symbol->set_address(100);
+  symbol->set_size(10);
+  module.AddSymbols(symbols);
+  const FunctionInfo* function = module.FindFunctionByElfAddress(100, true);
+  ASSERT_NE(function, nullptr);
+
+  module_info.set_build_id("different build id");
+  module.UpdateIfChanged(module_info);
+  EXPECT_FALSE(module.is_loaded());
+  EXPECT_EQ(module.FindFunctionByElfAddress(100, true), nullptr);
+  EXPECT_EQ(function->name(), "function");
+
+  module.AddSymbols(symbols);
+  EXPECT_NE(module.FindFunctionByElfAddress(100, true), nullptr);
+}
+
 TEST(ModuleData, FindFunctionFromHash) {
   ModuleSymbols symbols;
 
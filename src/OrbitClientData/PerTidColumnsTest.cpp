@@ -0,0 +1,68 @@
+// Copyright (c) 2021 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <absl/synchronization/mutex.h>
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+#include "OrbitClientData/PerTidColumns.h"
+
+namespace {
+
+struct TestColumns {
+  std::vector<uint64_t> values;
+};
+
+}  // namespace
+
+TEST(PerTidColumns, GetOrCreateColumnsOfTidKeepsTheColumnsOfEachThread) {
+  PerTidColumns<TestColumns> per_tid_columns;
+  EXPECT_FALSE(per_tid_columns.HasColumnsOfTid(42));
+
+  absl::MutexLock lock(&per_tid_columns.writer_mutex());
+  TestColumns* columns_of_42 = per_tid_columns.GetOrCreateColumnsOfTid(42);
+  columns_of_42->values.push_back(1);
+  EXPECT_TRUE(per_tid_columns.HasColumnsOfTid(42));
+
+  // Creating the columns of another thread doesn't move the existing ones.
+  TestColumns* columns_of_43 = per_tid_columns.GetOrCreateColumnsOfTid(43);
+  EXPECT_NE(columns_of_43, columns_of_42);
+  EXPECT_EQ(per_tid_columns.GetOrCreateColumnsOfTid(42), columns_of_42);
+
+  std::vector<uint64_t> visited_values;
+  per_tid_columns.WithColumnsOfTid(42, [&visited_values](const TestColumns& columns) {
+    visited_values = columns.values;
+  });
+  EXPECT_THAT(visited_values, testing::ElementsAre(1));
+
+  bool visited_columns_of_44 = false;
+  per_tid_columns.WithColumnsOfTid(44, [&visited_columns_of_44](const TestColumns& /*columns*/) {
+    visited_columns_of_44 = true;
+  });
+  EXPECT_FALSE(visited_columns_of_44);
+}
+
+TEST(PerTidColumns, ForEachColumnsVisitsAllThreads) {
+  PerTidColumns<TestColumns> per_tid_columns;
+  absl::MutexLock lock(&per_tid_columns.writer_mutex());
+  for (int32_t tid : {42, 43, 44}) {
+    per_tid_columns.GetOrCreateColumnsOfTid(tid)->values.push_back(tid);
+  }
+
+  per_tid_columns.ForEachMutableColumns(
+      [](int32_t /*tid*/, TestColumns& columns) { columns.values.push_back(0); });
+
+  std::vector<std::pair<int32_t, std::vector<uint64_t>>> visited;
+  per_tid_columns.ForEachColumns([&visited](int32_t tid, const TestColumns& columns) {
+    visited.emplace_back(tid, columns.values);
+  });
+  EXPECT_THAT(visited, testing::UnorderedElementsAre(
+                           std::make_pair(42, std::vector<uint64_t>{42, 0}),
+                           std::make_pair(43, std::vector<uint64_t>{43, 0}),
+                           std::make_pair(44, std::vector<uint64_t>{44, 0})));
+}
@@ -7,6 +7,7 @@
 #include <absl/container/flat_hash_map.h>
 
 #include <cstdint>
+#include <utility>
 #include <vector>
 
 #include "OrbitBase/Result.h"
@@ -21,44 +22,35 @@ ProcessData::ProcessData() { process_info_.set_pid(-1); }
 
 void ProcessData::UpdateModuleInfos(absl::Span<const orbit_grpc_protos::ModuleInfo> module_infos) {
   module_memory_map_.clear();
-  start_addresses_.clear();
 
+  std::vector<orbit_client_data::AddressRangeIndex<std::pair<std::string, uint64_t>>::Range> ranges;
+  ranges.reserve(module_infos.size());
   for (const auto& module_info : module_infos) {
-    {
-      const auto [it, success] = module_memory_map_.try_emplace(
-          module_info.file_path(),
-          MemorySpace{module_info.address_start(), module_info.address_end()});
-      CHECK(success);
-    }
-    {
-      const auto [it, success] =
-          start_addresses_.try_emplace(module_info.address_start(), module_info.file_path());
-      CHECK(success);
-    }
+    const auto [it, success] = module_memory_map_.try_emplace(
+        module_info.file_path(),
+        MemorySpace{module_info.address_start(), module_info.address_end()});
+    CHECK(success);
+    ranges.push_back({module_info.address_start(), module_info.address_end(),
+                      std::make_pair(module_info.file_path(), module_info.address_start())});
   }
+  // Fails on two modules with the same start address.
+  modules_by_address_ = orbit_client_data::AddressRangeIndex<std::pair<std::string, uint64_t>>{
+      std::move(ranges)};
 }
 
 ErrorMessageOr<std::pair<std::string, uint64_t>> ProcessData::FindModuleByAddress(
     uint64_t absolute_address) const {
-  if (start_addresses_.empty()) {
+  if (modules_by_address_.empty()) {
     return ErrorMessage(absl::StrFormat("Unable to find module for address %016" PRIx64
                                         ": No modules loaded by process %s",
                                         absolute_address, name()));
   }
 
-  ErrorMessage not_found_error =
-      ErrorMessage(absl::StrFormat("Unable to find module for address %016" PRIx64
-                                   ": No module loaded at this address by process %s",
-                                   absolute_address, name()));
-
-  auto it = start_addresses_.upper_bound(absolute_address);
-  if (it == start_addresses_.begin()) return not_found_error;
-
-  --it;
-  const std::string& module_path = it->second;
-  const MemorySpace& memory_space = module_memory_map_.at(module_path);
-  CHECK(absolute_address >= memory_space.start);
-  if (absolute_address > memory_space.end) return not_found_error;
-
-  return std::make_pair(module_path, memory_space.start);
-}
\ No newline at end of file
+  const std::pair<std::string, uint64_t>* module = modules_by_address_.Find(absolute_address);
+  if (module == nullptr) {
+    return ErrorMessage(absl::StrFormat("Unable to find module for address %016" PRIx64
+                                        ": No module loaded at this address by process %s",
+                                        absolute_address, name()));
+  }
+  return *module;
+}
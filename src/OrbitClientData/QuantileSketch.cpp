@@ -0,0 +1,87 @@
+// Copyright (c) 2021 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "OrbitClientData/QuantileSketch.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <memory>
+
+#include "OrbitBase/Logging.h"
+
+namespace orbit_client_data {
+
+QuantileSketch::QuantileSketch(double relative_accuracy) {
+  CHECK(relative_accuracy > 0 && relative_accuracy < 1);
+  gamma_ = (1 + relative_accuracy) / (1 - relative_accuracy);
+  log_gamma_ = std::log(gamma_);
+  block_count_ = GetBucketIndex(std::numeric_limits<uint64_t>::max()) / kBucketsPerBlock + 1;
+  blocks_ = std::make_unique<std::atomic<Block*>[]>(block_count_);
+  for (size_t i = 0; i < block_count_; ++i) {
+    blocks_[i].store(nullptr, std::memory_order_relaxed);
+  }
+}
+
+QuantileSketch::~QuantileSketch() {
+  for (size_t i = 0; i < block_count_; ++i) {
+    delete blocks_[i].load(std::memory_order_relaxed);
+  }
+}
+
+size_t QuantileSketch::GetBucketIndex(uint64_t value) const {
+  return static_cast<size_t>(std::ceil(std::log(static_cast<double>(value)) / log_gamma_));
+}
+
+uint64_t QuantileSketch::GetBucketValue(size_t bucket_index) const {
+  // The value with the same relative distance to both bounds of the bucket.
+  const double value = 2 * std::pow(gamma_, static_cast<double>(bucket_index)) / (gamma_ + 1);
+  return static_cast<uint64_t>(std::llround(value));
+}
+
+void QuantileSketch::Add(uint64_t value) {
+  if (value == 0) {
+    zero_count_.fetch_add(1, std::memory_order_relaxed);
+  } else {
+    const size_t bucket_index = GetBucketIndex(value);
+    std::atomic<Block*>& block_slot = blocks_[bucket_index / kBucketsPerBlock];
+    Block* block = block_slot.load(std::memory_order_acquire);
+    if (block == nullptr) {
+      auto new_block = std::make_unique<Block>();
+      // Another thread might have published a block in the meantime, in which case use that one.
+      if (block_slot.compare_exchange_strong(block, new_block.get(), std::memory_order_acq_rel)) {
+        block = new_block.release();
+      }
+    }
+    (*block)[bucket_index % kBucketsPerBlock].fetch_add(1, std::memory_order_relaxed);
+  }
+  // Increment the count last, so that a reader never expects more values than the buckets hold.
+  count_.fetch_add(1, std::memory_order_release);
+}
+
+uint64_t QuantileSketch::GetQuantile(double quantile) const {
+  const uint64_t count = count_.load(std::memory_order_acquire);
+  if (count == 0) return 0;
+  quantile = std::clamp(quantile, 0.0, 1.0);
+
+  // The rank, counting from 0, of the value at `quantile` among all values in sorted order.
+  const auto rank = static_cast<uint64_t>(quantile * static_cast<double>(count - 1));
+  uint64_t values_not_greater = zero_count_.load(std::memory_order_relaxed);
+  if (rank < values_not_greater) return 0;
+
+  // The counters only grow, so the buckets hold at least `count` values while Add is running.
+  for (size_t block_index = 0; block_index < block_count_; ++block_index) {
+    const Block* block = blocks_[block_index].load(std::memory_order_acquire);
+    if (block == nullptr) continue;
+    for (size_t i = 0; i < kBucketsPerBlock; ++i) {
+      values_not_greater += (*block)[i].load(std::memory_order_relaxed);
+      if (values_not_greater > rank) {
+        return GetBucketValue(block_index * kBucketsPerBlock + i);
+      }
+    }
+  }
+  UNREACHABLE();
+}
+
+}  // namespace orbit_client_data
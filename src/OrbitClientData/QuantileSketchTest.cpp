@@ -0,0 +1,110 @@
+// Copyright (c) 2021 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include "OrbitClientData/QuantileSketch.h"
+
+namespace orbit_client_data {
+
+namespace {
+
+// Expects the estimate to be within the relative accuracy of the exact value at `quantile`, with
+// the same definition of rank as QuantileSketch.
+void ExpectQuantileIsAccurate(const QuantileSketch& sketch, std::vector<uint64_t> values,
+                              double quantile) {
+  std::sort(values.begin(), values.end());
+  const auto rank = static_cast<size_t>(quantile * static_cast<double>(values.size() - 1));
+  const auto exact = static_cast<double>(values[rank]);
+  const auto estimate = static_cast<double>(sketch.GetQuantile(quantile));
+  // Allow for rounding the estimate to an integer.
+  EXPECT_LE(std::abs(estimate - exact), QuantileSketch::kDefaultRelativeAccuracy * exact + 1)
+      << "quantile " << quantile << ": exact " << exact << ", estimate " << estimate;
+}
+
+}  // namespace
+
+TEST(QuantileSketch, Empty) {
+  QuantileSketch sketch;
+  EXPECT_EQ(sketch.count(), 0);
+  EXPECT_EQ(sketch.GetQuantile(0.5), 0);
+}
+
+TEST(QuantileSketch, SingleValue) {
+  QuantileSketch sketch;
+  sketch.Add(1'000'000);
+  EXPECT_EQ(sketch.count(), 1);
+  ExpectQuantileIsAccurate(sketch, {1'000'000}, 0);
+  ExpectQuantileIsAccurate(sketch, {1'000'000}, 0.5);
+  ExpectQuantileIsAccurate(sketch, {1'000'000}, 1);
+}
+
+TEST(QuantileSketch, Zeros) {
+  QuantileSketch sketch;
+  sketch.Add(0);
+  sketch.Add(0);
+  sketch.Add(100);
+  EXPECT_EQ(sketch.count(), 3);
+  EXPECT_EQ(sketch.GetQuantile(0), 0);
+  EXPECT_EQ(sketch.GetQuantile(0.5), 0);
+  ExpectQuantileIsAccurate(sketch, {0, 0, 100}, 1);
+}
+
+TEST(QuantileSketch, WideRangeOfValues) {
+  // Log-uniform values between 1ns and 100s, added in random order, so that buckets are added
+  // both below and above the existing ones.
+  std::mt19937_64 random_engine{0};
+  std::uniform_real_distribution<double> exponent_distribution{0, 11};
+  std::vector<uint64_t> values;
+  QuantileSketch sketch;
+  for (int i = 0; i < 10'000; ++i) {
+    const auto value = static_cast<uint64_t>(std::pow(10.0, exponent_distribution(random_engine)));
+    values.push_back(value);
+    sketch.Add(value);
+  }
+
+  EXPECT_EQ(sketch.count(), values.size());
+  for (double quantile : {0.0, 0.01, 0.25, 0.5, 0.75, 0.9, 0.95, 0.99, 0.999, 1.0}) {
+    ExpectQuantileIsAccurate(sketch, values, quantile);
+  }
+}
+
+TEST(QuantileSketch, GetQuantileWhileAddingValues) {
+  // The values grow, so that new buckets keep being added while the reader queries the sketch.
+  constexpr uint64_t kValueCount = 100'000;
+  QuantileSketch sketch;
+  std::thread writer{[&sketch]() {
+    for (uint64_t value = 1; value <= kValueCount; ++value) {
+      sketch.Add(value * value);
+    }
+  }};
+
+  uint64_t previous_max = 0;
+  while (sketch.count() < kValueCount) {
+    // Values are only added, and they grow, so later estimates are never smaller.
+    const uint64_t median = sketch.GetQuantile(0.5);
+    const uint64_t max = sketch.GetQuantile(1.0);
+    EXPECT_LE(median, max);
+    EXPECT_GE(max, previous_max);
+    previous_max = max;
+  }
+  writer.join();
+
+  std::vector<uint64_t> values;
+  for (uint64_t value = 1; value <= kValueCount; ++value) {
+    values.push_back(value * value);
+  }
+  for (double quantile : {0.0, 0.5, 0.99, 1.0}) {
+    ExpectQuantileIsAccurate(sketch, values, quantile);
+  }
+}
+
+}  // namespace orbit_client_data
@@ -0,0 +1,172 @@
+// Copyright (c) 2021 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "OrbitClientData/SampleCountHistograms.h"
+
+#include <utility>
+
+#include "OrbitBase/Logging.h"
+
+SampleCountHistograms::~SampleCountHistograms() {
+  for (std::atomic<Directory*>& directory_ptr : directories_) {
+    Directory* directory = directory_ptr.load();
+    if (directory == nullptr) continue;
+    for (size_t i = 0; i < directory->size.load(); ++i) {
+      delete directory->chunks[i].load();
+    }
+    delete directory;
+  }
+}
+
+std::optional<size_t> SampleCountHistograms::GetCoarsestLevelNotWiderThan(
+    uint64_t max_bucket_width_ns) {
+  std::optional<size_t> result;
+  for (size_t level = 0; level < kNumLevels && GetBucketWidthNs(level) <= max_bucket_width_ns;
+       ++level) {
+    result = level;
+  }
+  return result;
+}
+
+void SampleCountHistograms::AddSample(uint64_t timestamp_ns) {
+  for (size_t level = 0; level < kNumLevels; ++level) {
+    IncrementBucket(level, timestamp_ns >> GetBucketWidthLog2(level));
+  }
+}
+
+void SampleCountHistograms::Clear() {
+  for (std::atomic<Directory*>& directory_ptr : directories_) {
+    Directory* directory = directory_ptr.load();
+    if (directory == nullptr) continue;
+    directory_ptr.store(nullptr);
+    // Only retire the chunks once they are unreachable for new readers.
+    for (size_t i = 0; i < directory->size.load(); ++i) {
+      deferred_deleter_.Retire(std::unique_ptr<Chunk>{directory->chunks[i].load()});
+    }
+    deferred_deleter_.Retire(std::unique_ptr<Directory>{directory});
+  }
+}
+
+void SampleCountHistograms::IncrementBucket(size_t level, uint64_t bucket) {
+  Directory* directory = directories_[level].load();
+  const size_t chunk_count = directory == nullptr ? 0 : directory->size.load();
+  Chunk* last_chunk = chunk_count == 0 ? nullptr : directory->chunks[chunk_count - 1].load();
+
+  // Samples mostly arrive in order of time, so they fall into the last bucket or into a new one.
+  if (last_chunk == nullptr || bucket > last_chunk->back()) {
+    if (last_chunk != nullptr && last_chunk->size.load() < last_chunk->capacity) {
+      const size_t index = last_chunk->size.load();
+      last_chunk->buckets[index] = bucket;
+      last_chunk->counts[index].store(1, std::memory_order_relaxed);
+      last_chunk->size.store(index + 1, std::memory_order_release);
+    } else {
+      auto chunk = std::make_unique<Chunk>(
+          last_chunk == nullptr ? kMinChunkCapacity
+                                : std::min(2 * last_chunk->capacity, kMaxChunkCapacity));
+      chunk->buckets[0] = bucket;
+      chunk->counts[0].store(1, std::memory_order_relaxed);
+      chunk->size.store(1);
+      AppendChunk(level, std::move(chunk));
+    }
+    return;
+  }
+
+  // The first chunk that ends at or after `bucket`. It exists, as the last chunk does.
+  const size_t chunk_index =
+      std::partition_point(directory->chunks.get(), directory->chunks.get() + chunk_count,
+                           [bucket](const std::atomic<Chunk*>& chunk) {
+                             return chunk.load()->back() < bucket;
+                           }) -
+      directory->chunks.get();
+  CHECK(chunk_index < chunk_count);
+  Chunk* chunk = directory->chunks[chunk_index].load();
+  uint64_t* buckets_end = chunk->buckets.get() + chunk->size.load();
+  uint64_t* bucket_it = std::lower_bound(chunk->buckets.get(), buckets_end, bucket);
+  if (*bucket_it == bucket) {
+    // Only the writer modifies the counts, so load and store don't need to be a single operation.
+    std::atomic<uint32_t>& count = chunk->counts[bucket_it - chunk->buckets.get()];
+    count.store(count.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    return;
+  }
+  InsertBucket(level, chunk_index, bucket);
+}
+
+void SampleCountHistograms::AppendChunk(size_t level, std::unique_ptr<Chunk> chunk) {
+  Directory* directory = directories_[level].load();
+  if (directory != nullptr && directory->size.load() < directory->capacity) {
+    const size_t chunk_count = directory->size.load();
+    directory->chunks[chunk_count].store(chunk.release());
+    directory->size.store(chunk_count + 1, std::memory_order_release);
+    return;
+  }
+
+  // Grow the directory geometrically, so that the copies take amortized O(1) per chunk.
+  const size_t chunk_count = directory == nullptr ? 0 : directory->size.load();
+  auto new_directory = std::make_unique<Directory>(std::max<size_t>(2 * chunk_count, 4));
+  for (size_t i = 0; i < chunk_count; ++i) {
+    new_directory->chunks[i].store(directory->chunks[i].load());
+  }
+  new_directory->chunks[chunk_count].store(chunk.release());
+  new_directory->size.store(chunk_count + 1);
+  directories_[level].store(new_directory.release());
+  deferred_deleter_.Retire(std::unique_ptr<Directory>{directory});
+}
+
+void SampleCountHistograms::InsertBucket(size_t level, size_t chunk_index, uint64_t bucket) {
+  Directory* directory = directories_[level].load();
+  const size_t chunk_count = directory->size.load();
+  Chunk* chunk = directory->chunks[chunk_index].load();
+  const size_t chunk_size = chunk->size.load();
+  const size_t index =
+      std::lower_bound(chunk->buckets.get(), chunk->buckets.get() + chunk_size, bucket) -
+      chunk->buckets.get();
+
+  // Copies the buckets of `chunk` with the new bucket inserted at `index`, from position `begin`
+  // to `end` of the resulting sequence, to the beginning of `destination`.
+  auto copy_with_new_bucket = [chunk, bucket, index](size_t begin, size_t end,
+                                                     Chunk* destination) {
+    for (size_t i = begin; i < end; ++i) {
+      const size_t destination_index = i - begin;
+      if (i == index) {
+        destination->buckets[destination_index] = bucket;
+        destination->counts[destination_index].store(1, std::memory_order_relaxed);
+        continue;
+      }
+      const size_t source_index = i < index ? i : i - 1;
+      destination->buckets[destination_index] = chunk->buckets[source_index];
+      destination->counts[destination_index].store(
+          chunk->counts[source_index].load(std::memory_order_relaxed), std::memory_order_relaxed);
+    }
+    destination->size.store(end - begin);
+  };
+
+  if (chunk_size < kMaxChunkCapacity) {
+    auto new_chunk = std::make_unique<Chunk>(chunk_size < chunk->capacity ? chunk->capacity
+                                                                           : 2 * chunk->capacity);
+    copy_with_new_bucket(0, chunk_size + 1, new_chunk.get());
+    directory->chunks[chunk_index].store(new_chunk.release());
+  } else {
+    // Split the full chunk into two halves, which requires a new directory.
+    const size_t first_half_size = (chunk_size + 1) / 2;
+    auto first_half = std::make_unique<Chunk>(kMaxChunkCapacity);
+    auto second_half = std::make_unique<Chunk>(kMaxChunkCapacity);
+    copy_with_new_bucket(0, first_half_size, first_half.get());
+    copy_with_new_bucket(first_half_size, chunk_size + 1, second_half.get());
+
+    auto new_directory =
+        std::make_unique<Directory>(std::max(directory->capacity, chunk_count + 1));
+    for (size_t i = 0; i < chunk_index; ++i) {
+      new_directory->chunks[i].store(directory->chunks[i].load());
+    }
+    new_directory->chunks[chunk_index].store(first_half.release());
+    new_directory->chunks[chunk_index + 1].store(second_half.release());
+    for (size_t i = chunk_index + 1; i < chunk_count; ++i) {
+      new_directory->chunks[i + 1].store(directory->chunks[i].load());
+    }
+    new_directory->size.store(chunk_count + 1);
+    directories_[level].store(new_directory.release());
+    deferred_deleter_.Retire(std::unique_ptr<Directory>{directory});
+  }
+  deferred_deleter_.Retire(std::unique_ptr<Chunk>{chunk});
+}
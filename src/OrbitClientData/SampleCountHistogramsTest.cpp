@@ -0,0 +1,140 @@
+// Copyright (c) 2021 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <map>
+#include <random>
+#include <utility>
+#include <vector>
+
+#include "OrbitClientData/SampleCountHistograms.h"
+
+namespace {
+
+std::map<uint64_t, uint32_t> GetBucketsInTimeRange(const SampleCountHistograms& histograms,
+                                                   size_t level, uint64_t min_timestamp_ns,
+                                                   uint64_t max_timestamp_ns) {
+  std::map<uint64_t, uint32_t> buckets;
+  uint64_t previous_bucket_begin_ns = 0;
+  histograms.ForEachBucketInTimeRange(
+      level, min_timestamp_ns, max_timestamp_ns,
+      [&buckets, &previous_bucket_begin_ns](uint64_t bucket_begin_ns, uint32_t count) {
+        EXPECT_TRUE(buckets.empty() || bucket_begin_ns > previous_bucket_begin_ns);
+        previous_bucket_begin_ns = bucket_begin_ns;
+        buckets.emplace(bucket_begin_ns, count);
+      });
+  return buckets;
+}
+
+}  // namespace
+
+using ::testing::ElementsAre;
+using ::testing::IsEmpty;
+using ::testing::Pair;
+
+TEST(SampleCountHistograms, GetCoarsestLevelNotWiderThan) {
+  const uint64_t finest_width = SampleCountHistograms::GetBucketWidthNs(0);
+  EXPECT_EQ(SampleCountHistograms::GetBucketWidthNs(1),
+            finest_width << SampleCountHistograms::kFanOutLog2);
+
+  EXPECT_FALSE(SampleCountHistograms::GetCoarsestLevelNotWiderThan(0).has_value());
+  EXPECT_FALSE(SampleCountHistograms::GetCoarsestLevelNotWiderThan(finest_width - 1).has_value());
+  EXPECT_EQ(SampleCountHistograms::GetCoarsestLevelNotWiderThan(finest_width), 0);
+  EXPECT_EQ(SampleCountHistograms::GetCoarsestLevelNotWiderThan(
+                SampleCountHistograms::GetBucketWidthNs(1) - 1),
+            0);
+  EXPECT_EQ(SampleCountHistograms::GetCoarsestLevelNotWiderThan(
+                SampleCountHistograms::GetBucketWidthNs(1)),
+            1);
+  EXPECT_EQ(
+      SampleCountHistograms::GetCoarsestLevelNotWiderThan(std::numeric_limits<uint64_t>::max()),
+      SampleCountHistograms::kNumLevels - 1);
+}
+
+TEST(SampleCountHistograms, CountsSamplesPerBucket) {
+  SampleCountHistograms histograms;
+  const uint64_t width = SampleCountHistograms::GetBucketWidthNs(0);
+  EXPECT_THAT(GetBucketsInTimeRange(histograms, 0, 0, std::numeric_limits<uint64_t>::max()),
+              IsEmpty());
+
+  histograms.AddSample(10 * width);
+  histograms.AddSample(10 * width + 1);
+  histograms.AddSample(12 * width + width / 2);
+  // Out of order, into an existing bucket and into a bucket that did not exist yet.
+  histograms.AddSample(10 * width + 2);
+  histograms.AddSample(11 * width);
+
+  EXPECT_THAT(GetBucketsInTimeRange(histograms, 0, 0, std::numeric_limits<uint64_t>::max()),
+              ElementsAre(Pair(10 * width, 3), Pair(11 * width, 1), Pair(12 * width, 1)));
+  // Buckets that intersect the range are visited.
+  EXPECT_THAT(GetBucketsInTimeRange(histograms, 0, 11 * width - 1, 12 * width),
+              ElementsAre(Pair(10 * width, 3), Pair(11 * width, 1), Pair(12 * width, 1)));
+  EXPECT_THAT(GetBucketsInTimeRange(histograms, 0, 11 * width, 11 * width),
+              ElementsAre(Pair(11 * width, 1)));
+  EXPECT_THAT(GetBucketsInTimeRange(histograms, 1, 0, std::numeric_limits<uint64_t>::max()),
+              ElementsAre(Pair(8 * width, 5)));
+
+  histograms.Clear();
+  EXPECT_THAT(GetBucketsInTimeRange(histograms, 0, 0, std::numeric_limits<uint64_t>::max()),
+              IsEmpty());
+  histograms.AddSample(width);
+  EXPECT_THAT(GetBucketsInTimeRange(histograms, 0, 0, std::numeric_limits<uint64_t>::max()),
+              ElementsAre(Pair(width, 1)));
+}
+
+TEST(SampleCountHistograms, AllLevelsMatchSamplesAddedMostlyInOrder) {
+  SampleCountHistograms histograms;
+  std::vector<uint64_t> timestamps;
+  std::mt19937 random(42);
+  const uint64_t width = SampleCountHistograms::GetBucketWidthNs(0);
+  // Enough buckets to fill several chunks, with gaps that out-of-order samples fall into later.
+  std::uniform_int_distribution<uint64_t> step_distribution(0, 3 * width);
+  std::uniform_int_distribution<uint64_t> late_distribution(0, 8 * width);
+  uint64_t timestamp = 0;
+  for (size_t i = 0; i < 8 * SampleCountHistograms::kMaxChunkCapacity; ++i) {
+    timestamp += step_distribution(random);
+    const uint64_t sample_timestamp =
+        i % 7 == 0 ? timestamp - std::min(timestamp, late_distribution(random)) : timestamp;
+    histograms.AddSample(sample_timestamp);
+    timestamps.push_back(sample_timestamp);
+  }
+
+  for (size_t level = 0; level < SampleCountHistograms::kNumLevels; ++level) {
+    const uint64_t level_width = SampleCountHistograms::GetBucketWidthNs(level);
+    std::map<uint64_t, uint32_t> expected_buckets;
+    for (uint64_t sample_timestamp : timestamps) {
+      ++expected_buckets[sample_timestamp / level_width * level_width];
+    }
+    EXPECT_EQ(GetBucketsInTimeRange(histograms, level, 0, std::numeric_limits<uint64_t>::max()),
+              expected_buckets);
+  }
+}
+
+TEST(SampleCountHistograms, BucketsInsertedBeforeTheLastOneGrowAndSplitChunks) {
+  SampleCountHistograms histograms;
+  const uint64_t width = SampleCountHistograms::GetBucketWidthNs(0);
+  std::map<uint64_t, uint32_t> expected_buckets;
+  // Every other bucket in order, so that the chunks grow up to the maximum capacity.
+  const uint64_t bucket_count = 3 * SampleCountHistograms::kMaxChunkCapacity;
+  for (uint64_t bucket = 0; bucket < bucket_count; bucket += 2) {
+    histograms.AddSample(bucket * width);
+    ++expected_buckets[bucket * width];
+  }
+  // Then the remaining buckets from the last to the first, all into chunks that are already full.
+  for (uint64_t i = 0; i < bucket_count / 2; ++i) {
+    const uint64_t bucket = bucket_count - 1 - 2 * i;
+    histograms.AddSample(bucket * width);
+    ++expected_buckets[bucket * width];
+  }
+
+  EXPECT_EQ(GetBucketsInTimeRange(histograms, 0, 0, std::numeric_limits<uint64_t>::max()),
+            expected_buckets);
+  EXPECT_THAT(GetBucketsInTimeRange(histograms, 0, width, 2 * width),
+              ElementsAre(Pair(width, 1), Pair(2 * width, 1)));
+}
@@ -0,0 +1,55 @@
+// Copyright (c) 2021 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "OrbitClientData/ThreadStateSliceData.h"
+
+#include <absl/synchronization/mutex.h>
+
+using orbit_client_protos::ThreadStateSliceInfo;
+
+void ThreadStateSliceData::AddSlice(const ThreadStateSliceInfo& slice) {
+  absl::MutexLock lock(&columns_.writer_mutex());
+  columns_.GetOrCreateColumnsOfTid(slice.tid())
+      ->AddOrReplaceEvent(slice.end_timestamp_ns(),
+                          SliceBeginAndState{slice.begin_timestamp_ns(), slice.thread_state()});
+}
+
+bool ThreadStateSliceData::HasSlicesOfTid(int32_t tid) const {
+  return columns_.HasColumnsOfTid(tid);
+}
+
+void ThreadStateSliceData::ForEachSlice(
+    const std::function<void(const ThreadStateSliceInfo&)>& action) const {
+  ThreadStateSliceInfo slice;
+  columns_.ForEachColumns([&slice, &action](int32_t tid, const SliceColumns& columns) {
+    slice.set_tid(tid);
+    columns.ForEachEvent([&slice, &action](uint64_t end_timestamp_ns,
+                                           const SliceBeginAndState& begin_and_state) {
+      slice.set_thread_state(begin_and_state.thread_state);
+      slice.set_begin_timestamp_ns(begin_and_state.begin_timestamp_ns);
+      slice.set_end_timestamp_ns(end_timestamp_ns);
+      action(slice);
+    });
+  });
+}
+
+void ThreadStateSliceData::ForEachSliceOfTidIntersectingTimeRange(
+    int32_t tid, uint64_t min_timestamp, uint64_t max_timestamp,
+    const std::function<void(const ThreadStateSliceInfo&)>& action) const {
+  columns_.WithColumnsOfTid(tid, [&](const SliceColumns& columns) {
+    ThreadStateSliceInfo slice;
+    slice.set_tid(tid);
+    // The slices are sorted by their end and don't overlap, so they are also sorted by their begin.
+    columns.ForEachEventFrom(
+        min_timestamp, [max_timestamp, &slice, &action](uint64_t end_timestamp_ns,
+                                                        const SliceBeginAndState& begin_and_state) {
+          if (begin_and_state.begin_timestamp_ns >= max_timestamp) return false;
+          slice.set_thread_state(begin_and_state.thread_state);
+          slice.set_begin_timestamp_ns(begin_and_state.begin_timestamp_ns);
+          slice.set_end_timestamp_ns(end_timestamp_ns);
+          action(slice);
+          return true;
+        });
+  });
+}
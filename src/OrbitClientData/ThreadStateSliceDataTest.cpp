@@ -0,0 +1,103 @@
+// Copyright (c) 2021 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <tuple>
+#include <vector>
+
+#include "OrbitClientData/ThreadStateSliceData.h"
+#include "capture_data.pb.h"
+
+using orbit_client_protos::ThreadStateSliceInfo;
+
+namespace {
+
+MATCHER(ThreadStateSliceInfoEq, "") {
+  const ThreadStateSliceInfo& a = std::get<0>(arg);
+  const ThreadStateSliceInfo& b = std::get<1>(arg);
+  return a.tid() == b.tid() && a.thread_state() == b.thread_state() &&
+         a.begin_timestamp_ns() == b.begin_timestamp_ns() &&
+         a.end_timestamp_ns() == b.end_timestamp_ns();
+}
+
+ThreadStateSliceInfo MakeSlice(int32_t tid, ThreadStateSliceInfo::ThreadState thread_state,
+                               uint64_t begin_timestamp_ns, uint64_t end_timestamp_ns) {
+  ThreadStateSliceInfo slice;
+  slice.set_tid(tid);
+  slice.set_thread_state(thread_state);
+  slice.set_begin_timestamp_ns(begin_timestamp_ns);
+  slice.set_end_timestamp_ns(end_timestamp_ns);
+  return slice;
+}
+
+std::vector<ThreadStateSliceInfo> GetSlicesIntersectingTimeRange(const ThreadStateSliceData& data,
+                                                                 int32_t tid,
+                                                                 uint64_t min_timestamp,
+                                                                 uint64_t max_timestamp) {
+  std::vector<ThreadStateSliceInfo> slices;
+  data.ForEachSliceOfTidIntersectingTimeRange(
+      tid, min_timestamp, max_timestamp,
+      [&slices](const ThreadStateSliceInfo& slice) { slices.push_back(slice); });
+  return slices;
+}
+
+}  // namespace
+
+TEST(ThreadStateSliceData, ForEachSliceOfTidIntersectingTimeRange) {
+  constexpr int32_t kTid = 42;
+  constexpr int32_t kOtherTid = 43;
+  ThreadStateSliceData data;
+  EXPECT_FALSE(data.HasSlicesOfTid(kTid));
+
+  const ThreadStateSliceInfo slice0 = MakeSlice(kTid, ThreadStateSliceInfo::kRunnable, 100, 200);
+  const ThreadStateSliceInfo slice1 = MakeSlice(kTid, ThreadStateSliceInfo::kRunning, 200, 300);
+  const ThreadStateSliceInfo slice2 =
+      MakeSlice(kTid, ThreadStateSliceInfo::kInterruptibleSleep, 300, 400);
+  data.AddSlice(slice0);
+  data.AddSlice(slice2);
+  // Out of order.
+  data.AddSlice(slice1);
+  data.AddSlice(MakeSlice(kOtherTid, ThreadStateSliceInfo::kRunning, 150, 250));
+
+  EXPECT_TRUE(data.HasSlicesOfTid(kTid));
+  EXPECT_TRUE(data.HasSlicesOfTid(kOtherTid));
+  EXPECT_FALSE(data.HasSlicesOfTid(44));
+
+  EXPECT_THAT(GetSlicesIntersectingTimeRange(data, kTid, 0, 1000),
+              testing::Pointwise(ThreadStateSliceInfoEq(),
+                                 std::vector<ThreadStateSliceInfo>{slice0, slice1, slice2}));
+  // Slices that end at the begin of the range are included, slices that begin at its end are not.
+  EXPECT_THAT(GetSlicesIntersectingTimeRange(data, kTid, 200, 300),
+              testing::Pointwise(ThreadStateSliceInfoEq(),
+                                 std::vector<ThreadStateSliceInfo>{slice0, slice1}));
+  EXPECT_THAT(GetSlicesIntersectingTimeRange(data, kTid, 250, 260),
+              testing::Pointwise(ThreadStateSliceInfoEq(),
+                                 std::vector<ThreadStateSliceInfo>{slice1}));
+  EXPECT_TRUE(GetSlicesIntersectingTimeRange(data, kTid, 401, 500).empty());
+  EXPECT_TRUE(GetSlicesIntersectingTimeRange(data, kTid, 0, 100).empty());
+  EXPECT_TRUE(GetSlicesIntersectingTimeRange(data, 44, 0, 1000).empty());
+}
+
+TEST(ThreadStateSliceData, ForEachSliceVisitsTheSlicesOfEachThreadInOrder) {
+  ThreadStateSliceData data;
+  data.AddSlice(MakeSlice(1, ThreadStateSliceInfo::kRunning, 300, 400));
+  data.AddSlice(MakeSlice(2, ThreadStateSliceInfo::kRunnable, 100, 200));
+  data.AddSlice(MakeSlice(1, ThreadStateSliceInfo::kRunnable, 100, 300));
+
+  std::vector<ThreadStateSliceInfo> slices_of_tid1;
+  int slice_count = 0;
+  data.ForEachSlice([&](const ThreadStateSliceInfo& slice) {
+    ++slice_count;
+    if (slice.tid() == 1) slices_of_tid1.push_back(slice);
+  });
+  EXPECT_EQ(slice_count, 3);
+  EXPECT_THAT(slices_of_tid1,
+              testing::Pointwise(ThreadStateSliceInfoEq(),
+                                 std::vector<ThreadStateSliceInfo>{
+                                     MakeSlice(1, ThreadStateSliceInfo::kRunnable, 100, 300),
+                                     MakeSlice(1, ThreadStateSliceInfo::kRunning, 300, 400)}));
+}
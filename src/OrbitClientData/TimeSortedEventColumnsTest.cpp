@@ -0,0 +1,221 @@
+// Copyright (c) 2021 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <limits>
+#include <atomic>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "OrbitClientData/TimeSortedEventColumns.h"
+
+namespace {
+
+using Columns = TimeSortedEventColumns<uint64_t>;
+
+std::vector<std::pair<uint64_t, uint64_t>> GetEventsInTimeRange(
+    const Columns& columns, uint64_t min_timestamp_ns, uint64_t max_timestamp_ns) {
+  std::vector<std::pair<uint64_t, uint64_t>> events;
+  columns.ForEachEventInTimeRange(min_timestamp_ns, max_timestamp_ns,
+                                  [&events](uint64_t timestamp_ns, uint64_t payload) {
+                                    events.emplace_back(timestamp_ns, payload);
+                                  });
+  return events;
+}
+
+std::vector<std::pair<uint64_t, uint64_t>> GetAllEvents(const Columns& columns) {
+  std::vector<std::pair<uint64_t, uint64_t>> events;
+  columns.ForEachEvent([&events](uint64_t timestamp_ns, uint64_t payload) {
+    events.emplace_back(timestamp_ns, payload);
+  });
+  return events;
+}
+
+}  // namespace
+
+using ::testing::ElementsAre;
+using ::testing::IsEmpty;
+using Event = std::pair<uint64_t, uint64_t>;
+
+TEST(TimeSortedEventColumns, IsEmptyInitially) {
+  Columns columns;
+  EXPECT_TRUE(columns.empty());
+  EXPECT_EQ(columns.size(), 0);
+  EXPECT_EQ(columns.GetAllocatedBytes(), 0);
+  EXPECT_THAT(GetEventsInTimeRange(columns, 0, std::numeric_limits<uint64_t>::max()), IsEmpty());
+}
+
+TEST(TimeSortedEventColumns, ForEachEventInTimeRangeIsInclusive) {
+  Columns columns;
+  columns.AddOrReplaceEvent(10, 1);
+  columns.AddOrReplaceEvent(20, 2);
+  columns.AddOrReplaceEvent(30, 3);
+  EXPECT_EQ(columns.size(), 3);
+
+  EXPECT_THAT(GetEventsInTimeRange(columns, 10, 30),
+              ElementsAre(Event{10, 1}, Event{20, 2}, Event{30, 3}));
+  EXPECT_THAT(GetEventsInTimeRange(columns, 11, 29), ElementsAre(Event{20, 2}));
+  EXPECT_THAT(GetEventsInTimeRange(columns, 20, 20), ElementsAre(Event{20, 2}));
+  EXPECT_THAT(GetEventsInTimeRange(columns, 21, 29), IsEmpty());
+  EXPECT_THAT(GetEventsInTimeRange(columns, 0, 9), IsEmpty());
+  EXPECT_THAT(GetEventsInTimeRange(columns, 31, 40), IsEmpty());
+}
+
+TEST(TimeSortedEventColumns, ForEachEventFromStopsWhenActionReturnsFalse) {
+  Columns columns;
+  columns.AddOrReplaceEvent(10, 1);
+  columns.AddOrReplaceEvent(20, 2);
+  columns.AddOrReplaceEvent(30, 3);
+  columns.AddOrReplaceEvent(40, 4);
+
+  std::vector<Event> visited_events;
+  columns.ForEachEventFrom(11, [&visited_events](uint64_t timestamp_ns, uint64_t payload) {
+    visited_events.emplace_back(timestamp_ns, payload);
+    return payload < 3;
+  });
+  EXPECT_THAT(visited_events, ElementsAre(Event{20, 2}, Event{30, 3}));
+}
+
+TEST(TimeSortedEventColumns, AddOrReplaceEventWithSameTimestampReplacesPayload) {
+  Columns columns;
+  columns.AddOrReplaceEvent(10, 1);
+  columns.AddOrReplaceEvent(20, 2);
+  columns.AddOrReplaceEvent(10, 3);
+  columns.AddOrReplaceEvent(20, 4);
+  EXPECT_EQ(columns.size(), 2);
+  EXPECT_THAT(GetAllEvents(columns), ElementsAre(Event{10, 3}, Event{20, 4}));
+}
+
+TEST(TimeSortedEventColumns, TryAddEventKeepsExistingEvent) {
+  Columns columns;
+  EXPECT_TRUE(columns.TryAddEvent(10, 1));
+  EXPECT_TRUE(columns.TryAddEvent(20, 2));
+  EXPECT_FALSE(columns.TryAddEvent(10, 3));
+  EXPECT_FALSE(columns.TryAddEvent(20, 4));
+  EXPECT_TRUE(columns.TryAddEvent(15, 5));
+  EXPECT_EQ(columns.size(), 3);
+  EXPECT_THAT(GetAllEvents(columns), ElementsAre(Event{10, 1}, Event{15, 5}, Event{20, 2}));
+}
+
+TEST(TimeSortedEventColumns, AddsEventsAcrossManyChunks) {
+  constexpr uint64_t kEventCount = 10 * Columns::kMaxChunkCapacity;
+  Columns columns;
+  for (uint64_t i = 0; i < kEventCount; ++i) {
+    columns.AddOrReplaceEvent(2 * i, i);
+  }
+  EXPECT_EQ(columns.size(), kEventCount);
+  EXPECT_GE(columns.GetAllocatedBytes(), kEventCount * 2 * sizeof(uint64_t));
+  // The capacity of the chunks grows with the number of events, so little memory is unused.
+  EXPECT_LE(columns.GetAllocatedBytes(), kEventCount * 2 * sizeof(uint64_t) * 5 / 4);
+
+  std::vector<Event> events = GetAllEvents(columns);
+  ASSERT_EQ(events.size(), kEventCount);
+  for (uint64_t i = 0; i < kEventCount; ++i) {
+    EXPECT_EQ(events[i], (Event{2 * i, i}));
+  }
+
+  // A range that spans the boundaries of several chunks.
+  const uint64_t min_index = Columns::kMaxChunkCapacity - 3;
+  const uint64_t max_index = 3 * Columns::kMaxChunkCapacity + 5;
+  events = GetEventsInTimeRange(columns, 2 * min_index - 1, 2 * max_index + 1);
+  ASSERT_EQ(events.size(), max_index - min_index + 1);
+  for (uint64_t i = 0; i < events.size(); ++i) {
+    EXPECT_EQ(events[i], (Event{2 * (min_index + i), min_index + i}));
+  }
+}
+
+TEST(TimeSortedEventColumns, AddEventsOutOfOrderKeepsEventsSorted) {
+  constexpr uint64_t kEventCount = 3 * Columns::kMaxChunkCapacity;
+  Columns columns;
+  // First add all even timestamps, then all odd timestamps in reverse order, which splits full
+  // chunks.
+  for (uint64_t i = 0; i < kEventCount; i += 2) {
+    columns.AddOrReplaceEvent(i, i);
+  }
+  for (uint64_t i = kEventCount - 1; i < kEventCount; i -= 2) {
+    columns.AddOrReplaceEvent(i, i);
+  }
+  EXPECT_EQ(columns.size(), kEventCount);
+
+  std::vector<Event> events = GetAllEvents(columns);
+  ASSERT_EQ(events.size(), kEventCount);
+  for (uint64_t i = 0; i < kEventCount; ++i) {
+    EXPECT_EQ(events[i], (Event{i, i}));
+  }
+
+  events = GetEventsInTimeRange(columns, 1000, 9000);
+  ASSERT_EQ(events.size(), 8001);
+  EXPECT_EQ(events.front(), (Event{1000, 1000}));
+  EXPECT_EQ(events.back(), (Event{9000, 9000}));
+}
+
+TEST(TimeSortedEventColumns, RemoveEventsIf) {
+  Columns columns;
+  for (uint64_t i = 0; i < 1000; ++i) {
+    columns.AddOrReplaceEvent(i, i % 10);
+  }
+  // Keeps one event out of ten in every chunk.
+  columns.RemoveEventsIf([](uint64_t payload) { return payload != 3; });
+  EXPECT_EQ(columns.size(), 100);
+
+  std::vector<Event> events = GetAllEvents(columns);
+  ASSERT_EQ(events.size(), 100);
+  for (uint64_t i = 0; i < events.size(); ++i) {
+    EXPECT_EQ(events[i], (Event{10 * i + 3, 3}));
+  }
+  EXPECT_THAT(GetEventsInTimeRange(columns, 500, 520), ElementsAre(Event{503, 3}, Event{513, 3}));
+
+  columns.RemoveEventsIf([](uint64_t /*payload*/) { return true; });
+  EXPECT_TRUE(columns.empty());
+  EXPECT_THAT(GetEventsInTimeRange(columns, 0, 1000), IsEmpty());
+
+  columns.AddOrReplaceEvent(42, 1);
+  EXPECT_THAT(GetAllEvents(columns), ElementsAre(Event{42, 1}));
+}
+
+TEST(TimeSortedEventColumns, ReadersObserveSortedEventsWhileWriterModifiesColumns) {
+  static constexpr uint64_t kEventCount = 20 * Columns::kMaxChunkCapacity;
+  constexpr int kReaderThreadCount = 3;
+  Columns columns;
+  std::atomic<bool> writer_done = false;
+
+  std::vector<std::thread> reader_threads;
+  for (int i = 0; i < kReaderThreadCount; ++i) {
+    reader_threads.emplace_back([&columns, &writer_done] {
+      while (!writer_done) {
+        uint64_t previous_timestamp_ns = 0;
+        bool is_first_event = true;
+        columns.ForEachEventInTimeRange(
+            kEventCount / 4, 3 * kEventCount / 4,
+            [&previous_timestamp_ns, &is_first_event](uint64_t timestamp_ns, uint64_t payload) {
+              EXPECT_TRUE(is_first_event || timestamp_ns > previous_timestamp_ns);
+              EXPECT_EQ(payload, timestamp_ns % 2 == 0 ? timestamp_ns : payload % 2);
+              previous_timestamp_ns = timestamp_ns;
+              is_first_event = false;
+            });
+        EXPECT_LE(columns.size(), kEventCount);
+      }
+    });
+  }
+
+  // Appends, inserts out of order, replaces and removes events concurrently to the readers.
+  for (uint64_t i = 0; i < kEventCount; i += 2) {
+    columns.AddOrReplaceEvent(i, i);
+    if (i % 64 == 10) {
+      columns.AddOrReplaceEvent(i - 5, 0);
+      columns.AddOrReplaceEvent(i - 5, 1);
+    }
+  }
+  columns.RemoveEventsIf([](uint64_t payload) { return payload % 4 == 2; });
+  writer_done = true;
+  for (std::thread& reader_thread : reader_threads) {
+    reader_thread.join();
+  }
+
+  EXPECT_EQ(columns.size(), kEventCount / 4 + kEventCount / 64);
+}
@@ -6,6 +6,8 @@
 
 #include <absl/meta/type_traits.h>
 
+#include <algorithm>
+#include <memory>
 #include <utility>
 
 #include "OrbitBase/Logging.h"
@@ -13,101 +15,134 @@
 
 using orbit_client_protos::TracepointEventInfo;
 
+TracepointData::TracepointData() : thread_id_to_tracepoint_columns_{new ColumnsByTid{}} {}
+
+TracepointData::~TracepointData() { delete thread_id_to_tracepoint_columns_.load(); }
+
 void TracepointData::EmplaceTracepointEvent(uint64_t time, uint64_t tracepoint_hash,
                                             int32_t process_id, int32_t thread_id, int32_t cpu,
                                             bool is_same_pid_as_target) {
-  absl::MutexLock lock(&mutex_);
-  num_total_tracepoint_events_++;
-
-  orbit_client_protos::TracepointEventInfo event;
-  event.set_time(time);
   CHECK(HasTracepointKey(tracepoint_hash));
-  event.set_tracepoint_info_key(tracepoint_hash);
-  event.set_tid(thread_id);
-  event.set_pid(process_id);
-  event.set_cpu(cpu);
-
   int32_t insertion_thread_id =
       (is_same_pid_as_target) ? thread_id : orbit_base::kNotTargetProcessTid;
 
-  auto [event_map_iterator, unused_inserted] =
-      thread_id_to_time_to_tracepoint_.try_emplace(insertion_thread_id);
-  auto [unused_iterator, event_inserted] =
-      event_map_iterator->second.try_emplace(time, std::move(event));
+  absl::MutexLock lock(&mutex_);
+  bool event_inserted = GetOrCreateColumnsOfThread(insertion_thread_id)
+                            ->TryAddEvent(time, {tracepoint_hash, thread_id, process_id, cpu});
   if (!event_inserted) {
     ERROR(
         "Tracepoint event was not inserted as there was already an event on this time and "
         "thread.");
+    return;
   }
+  num_total_tracepoint_events_.fetch_add(1, std::memory_order_relaxed);
 }
 
-void TracepointData::ForEachTracepointEvent(
-    const std::function<void(const orbit_client_protos::TracepointEventInfo&)>& action) const {
-  absl::MutexLock lock(&mutex_);
-  for (auto const& entry : thread_id_to_time_to_tracepoint_) {
-    for (auto const& time_to_tracepoint_event : entry.second) {
-      action(time_to_tracepoint_event.second);
-    }
+TracepointData::TracepointEventColumns* TracepointData::GetOrCreateColumnsOfThread(
+    int32_t thread_id) {
+  const ColumnsByTid* columns_by_tid = thread_id_to_tracepoint_columns_.load();
+  auto it = columns_by_tid->find(thread_id);
+  if (it != columns_by_tid->end()) {
+    return it->second;
   }
+
+  TracepointEventColumns* columns =
+      columns_.emplace_back(std::make_unique<TracepointEventColumns>()).get();
+  auto new_columns_by_tid = std::make_unique<ColumnsByTid>(*columns_by_tid);
+  new_columns_by_tid->emplace(thread_id, columns);
+  thread_id_to_tracepoint_columns_.store(new_columns_by_tid.release());
+  deferred_deleter_.Retire(std::unique_ptr<const ColumnsByTid>{columns_by_tid});
+  return columns;
 }
 
 namespace {
+// Returns a callable for the TimeSortedEventColumns that calls `action` with a
+// TracepointEventInfo, which is reused across calls.
+auto MakeTracepointEventAction(
+    TracepointEventInfo* event,
+    const std::function<void(const orbit_client_protos::TracepointEventInfo&)>& action) {
+  return [event, &action](uint64_t time, const auto& payload) {
+    event->set_time(time);
+    event->set_tracepoint_info_key(payload.tracepoint_info_key);
+    event->set_tid(payload.tid);
+    event->set_pid(payload.pid);
+    event->set_cpu(payload.cpu);
+    action(*event);
+  };
+}
+
+template <typename Columns>
 void ForEachTracepointEventInRange(
-    uint64_t min_tick, uint64_t max_tick_exclusive,
-    const std::map<uint64_t, orbit_client_protos::TracepointEventInfo>& time_to_tracepoint_events,
+    uint64_t min_tick, uint64_t max_tick_exclusive, const Columns& tracepoint_events,
     const std::function<void(const orbit_client_protos::TracepointEventInfo&)>& action) {
-  for (auto time_to_tracepoint_event = time_to_tracepoint_events.lower_bound(min_tick);
-       time_to_tracepoint_event != time_to_tracepoint_events.end() &&
-       time_to_tracepoint_event->first < max_tick_exclusive;
-       ++time_to_tracepoint_event) {
-    action(time_to_tracepoint_event->second);
-  }
+  if (min_tick >= max_tick_exclusive) return;
+  TracepointEventInfo event;
+  tracepoint_events.ForEachEventInTimeRange(min_tick, max_tick_exclusive - 1,
+                                            MakeTracepointEventAction(&event, action));
 }
 }  // namespace
 
+void TracepointData::ForEachTracepointEvent(
+    const std::function<void(const orbit_client_protos::TracepointEventInfo&)>& action) const {
+  orbit_base::DeferredDeleter::ReaderScope reader_scope{&deferred_deleter_};
+  TracepointEventInfo event;
+  for (const auto& [unused_thread_id, tracepoint_columns] :
+       *thread_id_to_tracepoint_columns_.load()) {
+    tracepoint_columns->ForEachEvent(MakeTracepointEventAction(&event, action));
+  }
+}
+
 void TracepointData::ForEachTracepointEventOfThreadInTimeRange(
     int32_t thread_id, uint64_t min_tick, uint64_t max_tick_exclusive,
     const std::function<void(const orbit_client_protos::TracepointEventInfo&)>& action) const {
-  absl::MutexLock lock(&mutex_);
+  orbit_base::DeferredDeleter::ReaderScope reader_scope{&deferred_deleter_};
+  const ColumnsByTid& thread_id_to_tracepoint_columns = *thread_id_to_tracepoint_columns_.load();
   if (thread_id == orbit_base::kAllThreadsOfAllProcessesTid) {
-    for (const auto& [unused_thread_id, time_to_tracepoint] : thread_id_to_time_to_tracepoint_) {
-      ForEachTracepointEventInRange(min_tick, max_tick_exclusive, time_to_tracepoint, action);
+    for (const auto& [unused_thread_id, tracepoint_columns] : thread_id_to_tracepoint_columns) {
+      ForEachTracepointEventInRange(min_tick, max_tick_exclusive, *tracepoint_columns, action);
     }
   } else if (thread_id == orbit_base::kAllProcessThreadsTid) {
-    for (const auto& [thread_id, time_to_tracepoint] : thread_id_to_time_to_tracepoint_) {
-      if (thread_id == orbit_base::kNotTargetProcessTid) {
+    for (const auto& [columns_thread_id, tracepoint_columns] : thread_id_to_tracepoint_columns) {
+      if (columns_thread_id == orbit_base::kNotTargetProcessTid) {
         continue;
       }
-      ForEachTracepointEventInRange(min_tick, max_tick_exclusive, time_to_tracepoint, action);
+      ForEachTracepointEventInRange(min_tick, max_tick_exclusive, *tracepoint_columns, action);
     }
   } else {
-    const auto& it = thread_id_to_time_to_tracepoint_.find(thread_id);
-    if (it == thread_id_to_time_to_tracepoint_.end()) {
+    const auto& it = thread_id_to_tracepoint_columns.find(thread_id);
+    if (it == thread_id_to_tracepoint_columns.end()) {
       return;
     }
-    ForEachTracepointEventInRange(min_tick, max_tick_exclusive, it->second, action);
+    ForEachTracepointEventInRange(min_tick, max_tick_exclusive, *it->second, action);
   }
 }
 
 uint32_t TracepointData::GetNumTracepointEventsForThreadId(int32_t thread_id) const {
-  absl::MutexLock lock(&mutex_);
+  orbit_base::DeferredDeleter::ReaderScope reader_scope{&deferred_deleter_};
+  const ColumnsByTid& thread_id_to_tracepoint_columns = *thread_id_to_tracepoint_columns_.load();
+  const uint32_t num_total_tracepoint_events =
+      num_total_tracepoint_events_.load(std::memory_order_relaxed);
   if (thread_id == orbit_base::kAllThreadsOfAllProcessesTid) {
-    return num_total_tracepoint_events_;
+    return num_total_tracepoint_events;
   }
   if (thread_id == orbit_base::kAllProcessThreadsTid) {
     const auto not_target_process_tracepoints_it =
-        thread_id_to_time_to_tracepoint_.find(orbit_base::kNotTargetProcessTid);
-    if (not_target_process_tracepoints_it == thread_id_to_time_to_tracepoint_.end()) {
-      return num_total_tracepoint_events_;
+        thread_id_to_tracepoint_columns.find(orbit_base::kNotTargetProcessTid);
+    if (not_target_process_tracepoints_it == thread_id_to_tracepoint_columns.end()) {
+      return num_total_tracepoint_events;
     }
-    return num_total_tracepoint_events_ - not_target_process_tracepoints_it->second.size();
+    // The two counts are not read atomically together while events are being added.
+    const uint32_t num_not_target_process_tracepoint_events =
+        not_target_process_tracepoints_it->second->size();
+    return num_total_tracepoint_events -
+           std::min(num_total_tracepoint_events, num_not_target_process_tracepoint_events);
   }
 
-  const auto& it = thread_id_to_time_to_tracepoint_.find(thread_id);
-  if (it == thread_id_to_time_to_tracepoint_.end()) {
+  const auto& it = thread_id_to_tracepoint_columns.find(thread_id);
+  if (it == thread_id_to_tracepoint_columns.end()) {
     return 0;
   }
-  return it->second.size();
+  return it->second->size();
 }
 
 bool TracepointData::AddUniqueTracepointInfo(uint64_t key,
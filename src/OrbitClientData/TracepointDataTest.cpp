@@ -6,8 +6,10 @@
 #include <gtest/gtest.h>
 
 #include <algorithm>
+#include <atomic>
 #include <cstdint>
 #include <string>
+#include <thread>
 #include <vector>
 
 #include "OrbitBase/ThreadConstants.h"
@@ -105,3 +107,38 @@ TEST(TracepointData, Get) {
   EXPECT_FALSE(tracepoint_data.GetTracepointInfo(2).category() == "sched" &&
                tracepoint_data.GetTracepointInfo(2).name() == "sched_switch");
 }
+
+TEST(TracepointData, IterationDoesNotBlockOnConcurrentEmplace) {
+  static constexpr uint64_t kEventCount = 50'000;
+  TracepointData tracepoint_data;
+  tracepoint_data.AddUniqueTracepointInfo(1, {});
+
+  std::atomic<bool> writer_done = false;
+  std::thread reader_thread([&tracepoint_data, &writer_done] {
+    while (!writer_done) {
+      uint64_t previous_time = 0;
+      tracepoint_data.ForEachTracepointEventOfThreadInTimeRange(
+          1, 0, kEventCount + 1,
+          [&previous_time](const orbit_client_protos::TracepointEventInfo& event) {
+            EXPECT_GT(event.time(), previous_time);
+            EXPECT_EQ(event.tid(), 1);
+            previous_time = event.time();
+          });
+      EXPECT_LE(tracepoint_data.GetNumTracepointEventsForThreadId(1), kEventCount);
+    }
+  });
+
+  for (uint64_t time = 1; time <= kEventCount; ++time) {
+    tracepoint_data.EmplaceTracepointEvent(time, 1, 0, 1, 0, true);
+    tracepoint_data.EmplaceTracepointEvent(time, 1, 2, 2, 0, false);
+  }
+  writer_done = true;
+  reader_thread.join();
+
+  EXPECT_EQ(tracepoint_data.GetNumTracepointEventsForThreadId(1), kEventCount);
+  EXPECT_EQ(tracepoint_data.GetNumTracepointEventsForThreadId(orbit_base::kAllProcessThreadsTid),
+            kEventCount);
+  EXPECT_EQ(
+      tracepoint_data.GetNumTracepointEventsForThreadId(orbit_base::kAllThreadsOfAllProcessesTid),
+      2 * kEventCount);
+}
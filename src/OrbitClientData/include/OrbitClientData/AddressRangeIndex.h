@@ -0,0 +1,95 @@
+// Copyright (c) 2021 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef ORBIT_CLIENT_DATA_ADDRESS_RANGE_INDEX_H_
+#define ORBIT_CLIENT_DATA_ADDRESS_RANGE_INDEX_H_
+
+#include <absl/types/span.h>
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <numeric>
+#include <utility>
+#include <vector>
+
+#include "OrbitBase/Logging.h"
+
+namespace orbit_client_data {
+
+// Immutable index of non-overlapping address ranges [start, end], both ends included as for the
+// memory map of a process, each associated with a value of type `Value`. Starts and ends are kept
+// in sorted arrays separate from the values, so that a lookup is a binary search over contiguous
+// memory. Build a new index to change the ranges.
+template <typename Value>
+class AddressRangeIndex {
+ public:
+  struct Range {
+    uint64_t start;
+    uint64_t end;
+    Value value;
+  };
+
+  AddressRangeIndex() = default;
+  explicit AddressRangeIndex(std::vector<Range> ranges) {
+    std::vector<size_t> order(ranges.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::sort(order.begin(), order.end(),
+              [&ranges](size_t lhs, size_t rhs) { return ranges[lhs].start < ranges[rhs].start; });
+
+    starts_.reserve(ranges.size());
+    ends_.reserve(ranges.size());
+    values_.reserve(ranges.size());
+    for (size_t index : order) {
+      Range& range = ranges[index];
+      CHECK(starts_.empty() || starts_.back() != range.start);
+      starts_.push_back(range.start);
+      ends_.push_back(range.end);
+      values_.push_back(std::move(range.value));
+    }
+  }
+
+  [[nodiscard]] bool empty() const { return starts_.empty(); }
+  [[nodiscard]] size_t size() const { return starts_.size(); }
+
+  // Returns the value of the range that contains `address`, or nullptr.
+  [[nodiscard]] const Value* Find(uint64_t address) const {
+    const size_t index = FindIndex(address);
+    return index != kNotFound ? &values_[index] : nullptr;
+  }
+
+  // Same as calling Find for each address, but consecutive addresses in the same range, as the
+  // frames of a callstack usually are, only cost one comparison with the range found last.
+  [[nodiscard]] std::vector<const Value*> FindAll(absl::Span<const uint64_t> addresses) const {
+    std::vector<const Value*> result;
+    result.reserve(addresses.size());
+    size_t last_index = kNotFound;
+    for (uint64_t address : addresses) {
+      if (last_index == kNotFound || address < starts_[last_index] || address > ends_[last_index]) {
+        last_index = FindIndex(address);
+      }
+      result.push_back(last_index != kNotFound ? &values_[last_index] : nullptr);
+    }
+    return result;
+  }
+
+ private:
+  static constexpr size_t kNotFound = static_cast<size_t>(-1);
+
+  [[nodiscard]] size_t FindIndex(uint64_t address) const {
+    auto it = std::upper_bound(starts_.begin(), starts_.end(), address);
+    if (it == starts_.begin()) return kNotFound;
+    const auto index = static_cast<size_t>(it - starts_.begin() - 1);
+    if (address > ends_[index]) return kNotFound;
+    return index;
+  }
+
+  std::vector<uint64_t> starts_;
+  std::vector<uint64_t> ends_;
+  std::vector<Value> values_;
+};
+
+}  // namespace orbit_client_data
+
+#endif  // ORBIT_CLIENT_DATA_ADDRESS_RANGE_INDEX_H_
@@ -5,23 +5,32 @@
 #ifndef ORBIT_CORE_CALLSTACK_DATA_H_
 #define ORBIT_CORE_CALLSTACK_DATA_H_
 
+#include <absl/base/thread_annotations.h>
+#include <absl/synchronization/mutex.h>
 #include <stdint.h>
 
+#include <atomic>
 #include <functional>
 #include <limits>
-#include <map>
 #include <memory>
-#include <mutex>
 #include <vector>
 
 #include "Callstack.h"
 #include "CallstackTypes.h"
+#include "PerTidColumns.h"
+#include "SampleCountHistograms.h"
+#include "TimeSortedEventColumns.h"
 #include "absl/container/flat_hash_map.h"
 #include "capture_data.pb.h"
 
+// Thread-safety: the methods that add or remove data can be called from any thread but are
+// serialized among themselves. Reading the callstack events never blocks and is never blocked by
+// the writer, so the UI and the sampling report can query the events while the capture thread adds
+// them. Lookups of unique callstacks take a reader lock only for the duration of the lookup, and
+// the ForEach... methods never hold a lock while calling `action`, so they can be nested.
 class CallstackData {
  public:
-  explicit CallstackData() = default;
+  CallstackData() = default;
 
   CallstackData(const CallstackData& other) = delete;
   CallstackData& operator=(const CallstackData& other) = delete;
@@ -33,18 +42,16 @@ class CallstackData {
   // Assume that callstack_event.callstack_hash is filled correctly and the
   // CallStack with corresponding hash is already in unique_callstacks_
   void AddCallstackEvent(orbit_client_protos::CallstackEvent callstack_event);
+  // Does nothing if a CallStack with the same id was already added.
   void AddUniqueCallStack(CallStack call_stack);
   void AddCallStackFromKnownCallstackData(const orbit_client_protos::CallstackEvent& event,
                                           const CallstackData* known_callstack_data);
 
-  [[nodiscard]] const absl::flat_hash_map<int32_t,
-                                          std::map<uint64_t, orbit_client_protos::CallstackEvent>>&
-  callstack_events_by_tid() const {
-    return callstack_events_by_tid_;
-  }
-
   [[nodiscard]] uint32_t GetCallstackEventsCount() const;
 
+  // Returns the number of bytes allocated to store the callstack events, not the unique callstacks.
+  [[nodiscard]] uint64_t GetCallstackEventsAllocatedBytes() const;
+
   [[nodiscard]] std::vector<orbit_client_protos::CallstackEvent> GetCallstackEventsInTimeRange(
       uint64_t time_begin, uint64_t time_end) const;
 
@@ -52,6 +59,11 @@ class CallstackData {
 
   [[nodiscard]] uint32_t GetCallstackEventsOfTidCount(int32_t thread_id) const;
 
+  // Returns how many times callstack events of the thread were added before its last event,
+  // replaced or removed. See TimeSortedEventColumns::GetOutOfOrderModificationCount.
+  [[nodiscard]] uint64_t GetCallstackEventsOfTidOutOfOrderModificationCount(
+      int32_t thread_id) const;
+
   [[nodiscard]] std::vector<orbit_client_protos::CallstackEvent> GetCallstackEventsOfTidInTimeRange(
       int32_t tid, uint64_t time_begin, uint64_t time_end) const;
 
@@ -66,16 +78,22 @@ class CallstackData {
       int32_t tid, uint64_t min_timestamp, uint64_t max_timestamp,
       const std::function<void(const orbit_client_protos::CallstackEvent&)>& action) const;
 
-  [[nodiscard]] uint64_t max_time() const {
-    std::lock_guard lock(mutex_);
-    return max_time_;
-  }
+  // Calls `action(bucket_begin_ns, count)` for the non-empty buckets of `level` of the sample count
+  // histograms (see SampleCountHistograms) that intersect [min_timestamp, max_timestamp], in order
+  // of time. The counts are the ones of all threads together.
+  void ForEachSampleCountInTimeRange(
+      size_t level, uint64_t min_timestamp, uint64_t max_timestamp,
+      const std::function<void(uint64_t, uint32_t)>& action) const;
+
+  void ForEachSampleCountOfTidInTimeRange(
+      int32_t tid, size_t level, uint64_t min_timestamp, uint64_t max_timestamp,
+      const std::function<void(uint64_t, uint32_t)>& action) const;
 
-  [[nodiscard]] uint64_t min_time() const {
-    std::lock_guard lock(mutex_);
-    return min_time_;
-  }
+  [[nodiscard]] uint64_t max_time() const { return max_time_.load(std::memory_order_relaxed); }
 
+  [[nodiscard]] uint64_t min_time() const { return min_time_.load(std::memory_order_relaxed); }
+
+  // The returned CallStack stays valid for the lifetime of this CallstackData.
   [[nodiscard]] const CallStack* GetCallStack(CallstackID callstack_id) const;
 
   [[nodiscard]] bool HasCallStack(CallstackID callstack_id) const;
@@ -96,17 +114,37 @@ class CallstackData {
  private:
   [[nodiscard]] std::shared_ptr<CallStack> GetCallstackPtr(CallstackID callstack_id) const;
 
-  void RegisterTime(uint64_t time);
-
-  // Use a reentrant mutex so that calls to the ForEach... methods can be nested.
-  // E.g., one might want to nest ForEachCallstackEvent and ForEachFrameInCallstack.
-  mutable std::recursive_mutex mutex_;
-  absl::flat_hash_map<CallstackID, std::shared_ptr<CallStack>> unique_callstacks_;
-  absl::flat_hash_map<int32_t, std::map<uint64_t, orbit_client_protos::CallstackEvent>>
-      callstack_events_by_tid_;
-
-  uint64_t max_time_ = 0;
-  uint64_t min_time_ = std::numeric_limits<uint64_t>::max();
+  using CallstackEventColumns = TimeSortedEventColumns<CallstackID>;
+  // The callstack events of one thread, and how many of them fall into each time bucket.
+  struct ThreadColumns {
+    CallstackEventColumns events;
+    SampleCountHistograms sample_counts;
+  };
+
+  void RegisterTime(uint64_t time) ABSL_EXCLUSIVE_LOCKS_REQUIRED(columns_.writer_mutex());
+
+  // Adds or replaces the event, and only counts it in the sample count histograms if it was added.
+  void AddOrReplaceEvent(int32_t tid, uint64_t time, CallstackID callstack_id)
+      ABSL_EXCLUSIVE_LOCKS_REQUIRED(columns_.writer_mutex());
+
+  // Calls `action` with a CallstackEvent that is reused across calls, as the columns store the
+  // timestamps and callstack ids only.
+  static void ForEachCallstackEventOfColumnsInTimeRange(
+      int32_t tid, const CallstackEventColumns& events, uint64_t min_timestamp,
+      uint64_t max_timestamp,
+      const std::function<void(const orbit_client_protos::CallstackEvent&)>& action);
+
+  PerTidColumns<ThreadColumns> columns_;
+  // The sum of the sample count histograms of all threads, so that the samples of all threads can
+  // be drawn without visiting the histograms of each thread.
+  SampleCountHistograms all_threads_sample_counts_;
+
+  mutable absl::Mutex unique_callstacks_mutex_;
+  absl::flat_hash_map<CallstackID, std::shared_ptr<CallStack>> unique_callstacks_
+      ABSL_GUARDED_BY(unique_callstacks_mutex_);
+
+  std::atomic<uint64_t> max_time_ = 0;
+  std::atomic<uint64_t> min_time_ = std::numeric_limits<uint64_t>::max();
 };
 
 #endif  // ORBIT_CORE_CALLSTACK_DATA_H_
@@ -5,9 +5,9 @@
 #ifndef ORBIT_CLIENT_DATA_MODULE_DATA_H_
 #define ORBIT_CLIENT_DATA_MODULE_DATA_H_
 
+#include <atomic>
 #include <cinttypes>
 #include <cstdint>
-#include <map>
 #include <memory>
 #include <string>
 #include <utility>
@@ -23,8 +23,7 @@
 // Represents information about module on the client
 class ModuleData final {
  public:
-  explicit ModuleData(orbit_grpc_protos::ModuleInfo info)
-      : module_info_(std::move(info)), is_loaded_(false) {}
+  explicit ModuleData(orbit_grpc_protos::ModuleInfo info) : module_info_(std::move(info)) {}
 
   [[nodiscard]] const std::string& name() const { return module_info_.name(); }
   [[nodiscard]] const std::string& file_path() const { return module_info_.file_path(); }
@@ -45,14 +44,25 @@ class ModuleData final {
   [[nodiscard]] std::vector<orbit_client_protos::FunctionInfo> GetOrbitFunctions() const;
 
  private:
+  // The symbols of a module, sorted by address in contiguous arrays, so that lookups are a binary
+  // search over `addresses`. Never modified once published.
+  struct FunctionIndex {
+    std::vector<uint64_t> addresses;
+    std::vector<uint64_t> sizes;
+    std::vector<std::unique_ptr<orbit_client_protos::FunctionInfo>> functions;
+    // TODO(168799822) This is a map of hash to function used for preset loading. Currently presets
+    // are based on a hash of the functions pretty name. This should be changed to not use hashes
+    // anymore.
+    absl::flat_hash_map<uint64_t, const orbit_client_protos::FunctionInfo*> hash_to_function_map;
+  };
+
   mutable absl::Mutex mutex_;
   orbit_grpc_protos::ModuleInfo module_info_;
-  bool is_loaded_;
-  std::map<uint64_t, std::unique_ptr<orbit_client_protos::FunctionInfo>> functions_;
-  // TODO(168799822) This is a map of hash to function used for preset loading. Currently presets
-  // are based on a hash of the functions pretty name. This should be changed to not use hashes
-  // anymore.
-  absl::flat_hash_map<uint64_t, orbit_client_protos::FunctionInfo*> hash_to_function_map_;
+  // Read without locking mutex_. Null as long as no symbols are loaded.
+  std::atomic<const FunctionIndex*> function_index_ = nullptr;
+  // Owns the published index and the ones that were replaced, as readers don't lock and the
+  // FunctionInfo pointers that were handed out must stay valid.
+  std::vector<std::unique_ptr<const FunctionIndex>> function_indices_ ABSL_GUARDED_BY(mutex_);
 };
 
 #endif  // ORBIT_GL_MODULE_DATA_H_
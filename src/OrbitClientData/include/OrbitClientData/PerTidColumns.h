@@ -0,0 +1,105 @@
+// Copyright (c) 2021 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef ORBIT_CLIENT_DATA_PER_TID_COLUMNS_H_
+#define ORBIT_CLIENT_DATA_PER_TID_COLUMNS_H_
+
+#include <absl/base/thread_annotations.h>
+#include <absl/container/flat_hash_map.h>
+#include <absl/synchronization/mutex.h>
+#include <stdint.h>
+
+#include <atomic>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "OrbitBase/DeferredDeleter.h"
+
+// Owns one `Columns` (e.g., TimeSortedEventColumns) per thread, so that a single writer can add
+// threads while readers look them up and iterate over them without blocking.
+//
+// Readers see a published snapshot of the map from thread id to columns. A snapshot is never
+// modified, but replaced as a whole when the columns of a new thread are created, and only deleted
+// once no reader is active anymore. The columns themselves are shared by all snapshots and are
+// never deleted before this object, so the writer can keep adding to them while readers iterate.
+//
+// The writer must hold writer_mutex(), which the owner also uses to serialize its other writes.
+template <typename Columns>
+class PerTidColumns {
+ public:
+  PerTidColumns() : columns_by_tid_{new ColumnsByTid{}} {}
+
+  PerTidColumns(const PerTidColumns& other) = delete;
+  PerTidColumns& operator=(const PerTidColumns& other) = delete;
+  PerTidColumns(PerTidColumns&& other) = delete;
+  PerTidColumns& operator=(PerTidColumns&& other) = delete;
+
+  ~PerTidColumns() { delete columns_by_tid_.load(); }
+
+  [[nodiscard]] absl::Mutex& writer_mutex() ABSL_LOCK_RETURNED(writer_mutex_) {
+    return writer_mutex_;
+  }
+
+  [[nodiscard]] Columns* GetOrCreateColumnsOfTid(int32_t tid)
+      ABSL_EXCLUSIVE_LOCKS_REQUIRED(writer_mutex_) {
+    const ColumnsByTid* columns_by_tid = columns_by_tid_.load();
+    auto it = columns_by_tid->find(tid);
+    if (it != columns_by_tid->end()) {
+      return it->second;
+    }
+
+    Columns* columns = columns_.emplace_back(std::make_unique<Columns>()).get();
+    auto new_columns_by_tid = std::make_unique<ColumnsByTid>(*columns_by_tid);
+    new_columns_by_tid->emplace(tid, columns);
+    columns_by_tid_.store(new_columns_by_tid.release());
+    deferred_deleter_.Retire(std::unique_ptr<const ColumnsByTid>{columns_by_tid});
+    return columns;
+  }
+
+  // Allows the writer to modify the columns of all threads, e.g., to remove events.
+  template <typename Action>
+  void ForEachMutableColumns(Action&& action) ABSL_EXCLUSIVE_LOCKS_REQUIRED(writer_mutex_) {
+    // As the only writer, this can access the current snapshot without a ReaderScope.
+    for (const auto& [tid, columns] : *columns_by_tid_.load()) {
+      action(tid, *columns);
+    }
+  }
+
+  [[nodiscard]] bool HasColumnsOfTid(int32_t tid) const {
+    orbit_base::DeferredDeleter::ReaderScope reader_scope{&deferred_deleter_};
+    return columns_by_tid_.load()->contains(tid);
+  }
+
+  // Calls `action(tid, columns)` for each thread, while the snapshot can't be deleted.
+  template <typename Action>
+  void ForEachColumns(Action&& action) const {
+    orbit_base::DeferredDeleter::ReaderScope reader_scope{&deferred_deleter_};
+    for (const auto& [tid, columns] : *columns_by_tid_.load()) {
+      action(tid, static_cast<const Columns&>(*columns));
+    }
+  }
+
+  // Calls `action(columns)` with the columns of the thread `tid`, if there are any, while the
+  // snapshot can't be deleted.
+  template <typename Action>
+  void WithColumnsOfTid(int32_t tid, Action&& action) const {
+    orbit_base::DeferredDeleter::ReaderScope reader_scope{&deferred_deleter_};
+    const ColumnsByTid* columns_by_tid = columns_by_tid_.load();
+    auto it = columns_by_tid->find(tid);
+    if (it != columns_by_tid->end()) {
+      action(static_cast<const Columns&>(*it->second));
+    }
+  }
+
+ private:
+  using ColumnsByTid = absl::flat_hash_map<int32_t, Columns*>;
+
+  absl::Mutex writer_mutex_;
+  std::vector<std::unique_ptr<Columns>> columns_ ABSL_GUARDED_BY(writer_mutex_);
+  std::atomic<const ColumnsByTid*> columns_by_tid_;
+  orbit_base::DeferredDeleter deferred_deleter_;
+};
+
+#endif  // ORBIT_CLIENT_DATA_PER_TID_COLUMNS_H_
@@ -9,7 +9,6 @@
 #include <inttypes.h>
 #include <stdint.h>
 
-#include <map>
 #include <memory>
 #include <string>
 #include <utility>
@@ -17,6 +16,7 @@
 
 #include "OrbitBase/Logging.h"
 #include "OrbitBase/Result.h"
+#include "OrbitClientData/AddressRangeIndex.h"
 #include "OrbitClientData/ModuleData.h"
 #include "absl/container/flat_hash_map.h"
 #include "absl/container/flat_hash_set.h"
@@ -78,7 +78,8 @@ class ProcessData final {
 
   // This is a map from module_path to the space in memory where that module is loaded
   absl::flat_hash_map<std::string, MemorySpace> module_memory_map_;
-  std::map<uint64_t, const std::string> start_addresses_;
+  // The same memory map indexed by address, with the module path and start address as values.
+  orbit_client_data::AddressRangeIndex<std::pair<std::string, uint64_t>> modules_by_address_;
 };
 
 #endif  // ORBIT_GL_PROCESS_DATA_H_
@@ -0,0 +1,67 @@
+// Copyright (c) 2021 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef ORBIT_CLIENT_DATA_QUANTILE_SKETCH_H_
+#define ORBIT_CLIENT_DATA_QUANTILE_SKETCH_H_
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+
+namespace orbit_client_data {
+
+// Estimates quantiles of a stream of non-negative values, e.g., durations in nanoseconds, in
+// constant time per value and with memory logarithmic in the range of the values, following
+// DDSketch (Masson et al., "DDSketch: A Fast and Fully-Mergeable Quantile Sketch with
+// Relative-Error Guarantees", VLDB 2019).
+//
+// Values are counted in buckets whose bounds grow geometrically, so that every estimate returned
+// by GetQuantile is within `relative_accuracy` of an actual value at that quantile.
+//
+// Thread-safety: Add and GetQuantile can be called concurrently from any thread, e.g., while the
+// capture thread adds the durations of new calls and the UI shows percentiles. The counters of the
+// buckets are allocated in fixed-size blocks that are never moved or freed before the sketch, so a
+// reader never blocks and never observes storage that the writer replaced.
+class QuantileSketch {
+ public:
+  explicit QuantileSketch(double relative_accuracy = kDefaultRelativeAccuracy);
+  ~QuantileSketch();
+
+  QuantileSketch(const QuantileSketch&) = delete;
+  QuantileSketch& operator=(const QuantileSketch&) = delete;
+  QuantileSketch(QuantileSketch&&) = delete;
+  QuantileSketch& operator=(QuantileSketch&&) = delete;
+
+  void Add(uint64_t value);
+
+  [[nodiscard]] uint64_t count() const { return count_.load(std::memory_order_relaxed); }
+
+  // Returns an estimate of the value at `quantile` in [0, 1], e.g., 0.99 for the 99th percentile,
+  // or 0 if no values were added.
+  [[nodiscard]] uint64_t GetQuantile(double quantile) const;
+
+  static constexpr double kDefaultRelativeAccuracy = 0.01;
+
+ private:
+  static constexpr size_t kBucketsPerBlock = 64;
+  using Block = std::array<std::atomic<uint64_t>, kBucketsPerBlock>;
+
+  [[nodiscard]] size_t GetBucketIndex(uint64_t value) const;
+  [[nodiscard]] uint64_t GetBucketValue(size_t bucket_index) const;
+
+  double gamma_;
+  double log_gamma_;
+  std::atomic<uint64_t> count_ = 0;
+  std::atomic<uint64_t> zero_count_ = 0;
+  // Bucket i counts the values in (gamma^(i - 1), gamma^i], as all non-zero values are at least 1.
+  // The blocks of buckets are only allocated when a value falls into them, as a sketch usually
+  // only sees durations within a few orders of magnitude.
+  size_t block_count_;
+  std::unique_ptr<std::atomic<Block*>[]> blocks_;
+};
+
+}  // namespace orbit_client_data
+
+#endif  // ORBIT_CLIENT_DATA_QUANTILE_SKETCH_H_
@@ -0,0 +1,143 @@
+// Copyright (c) 2021 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef ORBIT_CLIENT_DATA_SAMPLE_COUNT_HISTOGRAMS_H_
+#define ORBIT_CLIENT_DATA_SAMPLE_COUNT_HISTOGRAMS_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <memory>
+#include <optional>
+
+#include "OrbitBase/DeferredDeleter.h"
+
+// Counts samples per time bucket, at kNumLevels resolutions: the buckets of level 0 are
+// 2^kFinestBucketWidthLog2 ns wide, and each level's buckets are 2^kFanOutLog2 times wider than
+// the ones of the level below. The histograms are updated as samples are added, so that drawing the
+// samples of a long time range only needs to visit the buckets of the right resolution instead of
+// every sample.
+// Only the non-empty buckets are stored, sorted by time in chunks, so the histograms of threads
+// that are rarely sampled stay small. For the same reason, the chunks of a level start small and
+// each chunk appended at the end has twice the capacity of the previous one, up to
+// kMaxChunkCapacity. Nothing is allocated for a level until it has its first bucket.
+//
+// Thread-safety: same as TimeSortedEventColumns. AddSample and Clear must only be called by one
+// thread at a time (the writer), while ForEachBucketInTimeRange can be called concurrently from any
+// thread and never blocks. The counts of existing buckets are atomics incremented in place, so
+// readers can observe a count that is still being incremented, but never a torn bucket.
+class SampleCountHistograms {
+ public:
+  static constexpr size_t kNumLevels = 4;
+  // About 8.4 ms, the finest resolution for which buckets are typically shared by several samples.
+  static constexpr uint32_t kFinestBucketWidthLog2 = 23;
+  static constexpr uint32_t kFanOutLog2 = 3;
+  static constexpr size_t kMinChunkCapacity = 8;
+  static constexpr size_t kMaxChunkCapacity = 1024;
+
+  SampleCountHistograms() = default;
+  SampleCountHistograms(const SampleCountHistograms&) = delete;
+  SampleCountHistograms& operator=(const SampleCountHistograms&) = delete;
+  SampleCountHistograms(SampleCountHistograms&&) = delete;
+  SampleCountHistograms& operator=(SampleCountHistograms&&) = delete;
+
+  ~SampleCountHistograms();
+
+  [[nodiscard]] static uint64_t GetBucketWidthNs(size_t level) {
+    return uint64_t{1} << GetBucketWidthLog2(level);
+  }
+
+  // Returns the coarsest level whose buckets are at most `max_bucket_width_ns` wide, or
+  // std::nullopt if even the buckets of level 0 are wider.
+  [[nodiscard]] static std::optional<size_t> GetCoarsestLevelNotWiderThan(
+      uint64_t max_bucket_width_ns);
+
+  void AddSample(uint64_t timestamp_ns);
+  void Clear();
+
+  // Calls `action(bucket_begin_ns, count)` for the non-empty buckets of `level` that intersect
+  // [min_timestamp_ns, max_timestamp_ns], in order of time.
+  template <typename Action>
+  void ForEachBucketInTimeRange(size_t level, uint64_t min_timestamp_ns, uint64_t max_timestamp_ns,
+                                Action&& action) const {
+    const uint32_t bucket_width_log2 = GetBucketWidthLog2(level);
+    const uint64_t min_bucket = min_timestamp_ns >> bucket_width_log2;
+    const uint64_t max_bucket = max_timestamp_ns >> bucket_width_log2;
+
+    orbit_base::DeferredDeleter::ReaderScope reader_scope{&deferred_deleter_};
+    const Directory* directory = directories_[level].load();
+    if (directory == nullptr) return;
+    const size_t chunk_count = directory->size.load(std::memory_order_acquire);
+    size_t chunk_index =
+        std::partition_point(directory->chunks.get(), directory->chunks.get() + chunk_count,
+                             [min_bucket](const std::atomic<Chunk*>& chunk) {
+                               return chunk.load()->back() < min_bucket;
+                             }) -
+        directory->chunks.get();
+    bool is_first_chunk = true;
+    for (; chunk_index < chunk_count; ++chunk_index) {
+      const Chunk* chunk = directory->chunks[chunk_index].load();
+      const uint64_t* buckets_begin = chunk->buckets.get();
+      const uint64_t* buckets_end = buckets_begin + chunk->size.load(std::memory_order_acquire);
+      const uint64_t* bucket_it = is_first_chunk
+                                      ? std::lower_bound(buckets_begin, buckets_end, min_bucket)
+                                      : buckets_begin;
+      is_first_chunk = false;
+      for (; bucket_it != buckets_end; ++bucket_it) {
+        if (*bucket_it > max_bucket) return;
+        action(*bucket_it << bucket_width_log2,
+               chunk->counts[bucket_it - buckets_begin].load(std::memory_order_relaxed));
+      }
+    }
+  }
+
+ private:
+  // The buckets are identified by their index, the begin of the bucket divided by its width.
+  struct Chunk {
+    explicit Chunk(size_t chunk_capacity)
+        : buckets{std::make_unique<uint64_t[]>(chunk_capacity)},
+          counts{std::make_unique<std::atomic<uint32_t>[]>(chunk_capacity)},
+          capacity{chunk_capacity} {}
+
+    // Only called on published chunks, which are never empty.
+    [[nodiscard]] uint64_t back() const {
+      return buckets[size.load(std::memory_order_acquire) - 1];
+    }
+
+    std::unique_ptr<uint64_t[]> buckets;
+    std::unique_ptr<std::atomic<uint32_t>[]> counts;
+    // Buckets at indices below `size` are published to readers.
+    std::atomic<size_t> size = 0;
+    const size_t capacity;
+  };
+
+  struct Directory {
+    explicit Directory(size_t directory_capacity)
+        : chunks{std::make_unique<std::atomic<Chunk*>[]>(directory_capacity)},
+          capacity{directory_capacity} {}
+
+    std::unique_ptr<std::atomic<Chunk*>[]> chunks;
+    std::atomic<size_t> size = 0;
+    const size_t capacity;
+  };
+
+  [[nodiscard]] static uint32_t GetBucketWidthLog2(size_t level) {
+    return kFinestBucketWidthLog2 + static_cast<uint32_t>(level) * kFanOutLog2;
+  }
+
+  void IncrementBucket(size_t level, uint64_t bucket);
+  void AppendChunk(size_t level, std::unique_ptr<Chunk> chunk);
+  // Handles buckets that are before the last bucket and not in the histogram yet, by copying the
+  // chunk at `chunk_index`, the first chunk that ends after `bucket`, into a chunk of twice the
+  // capacity if it is full, or into two halves if it is full and already of kMaxChunkCapacity.
+  void InsertBucket(size_t level, size_t chunk_index, uint64_t bucket);
+
+  std::array<std::atomic<Directory*>, kNumLevels> directories_{};
+  orbit_base::DeferredDeleter deferred_deleter_;
+};
+
+#endif  // ORBIT_CLIENT_DATA_SAMPLE_COUNT_HISTOGRAMS_H_
@@ -0,0 +1,60 @@
+// Copyright (c) 2021 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef ORBIT_CLIENT_DATA_THREAD_STATE_SLICE_DATA_H_
+#define ORBIT_CLIENT_DATA_THREAD_STATE_SLICE_DATA_H_
+
+#include <stdint.h>
+
+#include <functional>
+
+#include "PerTidColumns.h"
+#include "TimeSortedEventColumns.h"
+#include "capture_data.pb.h"
+
+// Stores the thread state slices of each thread in TimeSortedEventColumns, keyed by the end of the
+// slices, which is unique as the slices of a thread don't overlap. Only the begin and the state of
+// each slice are stored besides its end, instead of a ThreadStateSliceInfo.
+//
+// Thread-safety: as for CallstackData, AddSlice can be called from any thread but calls are
+// serialized, while reading never blocks and is never blocked by the writer. Readers observe a
+// snapshot of the slices of a thread that can only grow while they iterate over it.
+class ThreadStateSliceData {
+ public:
+  ThreadStateSliceData() = default;
+
+  ThreadStateSliceData(const ThreadStateSliceData& other) = delete;
+  ThreadStateSliceData& operator=(const ThreadStateSliceData& other) = delete;
+  ThreadStateSliceData(ThreadStateSliceData&& other) = delete;
+  ThreadStateSliceData& operator=(ThreadStateSliceData&& other) = delete;
+
+  ~ThreadStateSliceData() = default;
+
+  // A slice with the same end as an existing slice of the same thread replaces it.
+  void AddSlice(const orbit_client_protos::ThreadStateSliceInfo& slice);
+
+  [[nodiscard]] bool HasSlicesOfTid(int32_t tid) const;
+
+  // Calls `action` with a ThreadStateSliceInfo that is reused across calls, for all the slices of
+  // each thread in order of time, one thread after the other.
+  void ForEachSlice(
+      const std::function<void(const orbit_client_protos::ThreadStateSliceInfo&)>& action) const;
+
+  // Calls `action` for the slices of `tid` that end at or after `min_timestamp` and begin before
+  // `max_timestamp`, in order of time.
+  void ForEachSliceOfTidIntersectingTimeRange(
+      int32_t tid, uint64_t min_timestamp, uint64_t max_timestamp,
+      const std::function<void(const orbit_client_protos::ThreadStateSliceInfo&)>& action) const;
+
+ private:
+  struct SliceBeginAndState {
+    uint64_t begin_timestamp_ns;
+    orbit_client_protos::ThreadStateSliceInfo::ThreadState thread_state;
+  };
+  using SliceColumns = TimeSortedEventColumns<SliceBeginAndState>;
+
+  PerTidColumns<SliceColumns> columns_;
+};
+
+#endif  // ORBIT_CLIENT_DATA_THREAD_STATE_SLICE_DATA_H_
@@ -0,0 +1,373 @@
+// Copyright (c) 2021 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef ORBIT_CLIENT_DATA_TIME_SORTED_EVENT_COLUMNS_H_
+#define ORBIT_CLIENT_DATA_TIME_SORTED_EVENT_COLUMNS_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "OrbitBase/DeferredDeleter.h"
+#include "OrbitBase/Logging.h"
+#include "OrbitBase/MakeUniqueForOverwrite.h"
+
+// Stores the events of a single thread as two columns, the timestamps and the payloads, sorted by
+// timestamp. Compared to a std::map of protos, this takes the size of the timestamp and the payload
+// per event instead of a tree node and a proto, and time ranges are located with binary searches
+// over contiguous arrays.
+// The columns are split into chunks, so that appending never moves the events already stored.
+// The capacity of the chunks grows with the number of events, from kMinChunkCapacity for threads
+// with few samples up to kMaxChunkCapacity, which also bounds the cost of out-of-order inserts.
+//
+// Thread-safety: the methods that add or remove events must only be called by one thread at a time
+// (the writer), while the const methods can be called concurrently from any thread (the readers)
+// and never block.
+// Appending to the last chunk writes behind the published size of the chunk, so readers never
+// observe partially written events. All other modifications create new chunks and publish them
+// by replacing the chunk pointer, or the whole chunk directory, with an atomic store. Replaced
+// chunks and directories are deleted once no reader is active anymore (see DeferredDeleter).
+template <typename Payload>
+class TimeSortedEventColumns {
+  static_assert(std::is_trivially_copyable_v<Payload>);
+
+ public:
+  static constexpr size_t kMinChunkCapacity = 64;
+  static constexpr size_t kMaxChunkCapacity = 4096;
+
+  TimeSortedEventColumns() = default;
+  TimeSortedEventColumns(const TimeSortedEventColumns&) = delete;
+  TimeSortedEventColumns& operator=(const TimeSortedEventColumns&) = delete;
+  TimeSortedEventColumns(TimeSortedEventColumns&&) = delete;
+  TimeSortedEventColumns& operator=(TimeSortedEventColumns&&) = delete;
+
+  ~TimeSortedEventColumns() {
+    Directory* directory = directory_.load();
+    if (directory == nullptr) return;
+    for (size_t i = 0; i < directory->size.load(); ++i) {
+      delete directory->chunks[i].load();
+    }
+    delete directory;
+  }
+
+  // Adds the event at `timestamp_ns`, unless there already is an event with the same timestamp, in
+  // which case this returns false. Events are expected to mostly arrive in order of their
+  // timestamps, in which case this is amortized O(1). Otherwise the event is inserted into the
+  // chunk covering its timestamp.
+  bool TryAddEvent(uint64_t timestamp_ns, const Payload& payload) {
+    return AddEvent(timestamp_ns, payload, /*replace_existing=*/false);
+  }
+
+  // Adds the event at `timestamp_ns`, or replaces the payload of the event with the same timestamp.
+  void AddOrReplaceEvent(uint64_t timestamp_ns, const Payload& payload) {
+    AddEvent(timestamp_ns, payload, /*replace_existing=*/true);
+  }
+
+  [[nodiscard]] size_t size() const { return size_.load(std::memory_order_relaxed); }
+  [[nodiscard]] bool empty() const { return size() == 0; }
+
+  // Returns how many times events were inserted before the last event, replaced or removed, i.e.,
+  // modified other than by appending. If this returns the same value before two traversals, the
+  // events up to the last one visited by the first traversal are also visited by the second.
+  [[nodiscard]] uint64_t GetOutOfOrderModificationCount() const {
+    return out_of_order_modification_count_.load(std::memory_order_acquire);
+  }
+
+  // Calls `action(timestamp_ns, payload)` for all events in [min_timestamp_ns, max_timestamp_ns],
+  // in order of their timestamps.
+  template <typename Action>
+  void ForEachEventInTimeRange(uint64_t min_timestamp_ns, uint64_t max_timestamp_ns,
+                               Action&& action) const {
+    ForEachEventFrom(min_timestamp_ns,
+                     [max_timestamp_ns, &action](uint64_t timestamp_ns, const Payload& payload) {
+                       if (timestamp_ns > max_timestamp_ns) return false;
+                       action(timestamp_ns, payload);
+                       return true;
+                     });
+  }
+
+  // Calls `action(timestamp_ns, payload)` for the events at or after `min_timestamp_ns`, in order
+  // of their timestamps, until `action` returns false.
+  template <typename Action>
+  void ForEachEventFrom(uint64_t min_timestamp_ns, Action&& action) const {
+    orbit_base::DeferredDeleter::ReaderScope reader_scope{&deferred_deleter_};
+    const Directory* directory = directory_.load();
+    if (directory == nullptr) return;
+    const size_t chunk_count = directory->size.load(std::memory_order_acquire);
+
+    // The first chunk whose last event is at or after min_timestamp_ns.
+    size_t chunk_index =
+        std::partition_point(directory->chunks.get(), directory->chunks.get() + chunk_count,
+                             [min_timestamp_ns](const std::atomic<Chunk*>& chunk) {
+                               return chunk.load()->back() < min_timestamp_ns;
+                             }) -
+        directory->chunks.get();
+    bool is_first_chunk = true;
+    for (; chunk_index < chunk_count; ++chunk_index) {
+      const Chunk* chunk = directory->chunks[chunk_index].load();
+      const uint64_t* timestamps_begin = chunk->timestamps_ns.get();
+      const uint64_t* timestamps_end =
+          timestamps_begin + chunk->size.load(std::memory_order_acquire);
+      const uint64_t* timestamp_it =
+          is_first_chunk ? std::lower_bound(timestamps_begin, timestamps_end, min_timestamp_ns)
+                         : timestamps_begin;
+      is_first_chunk = false;
+      for (; timestamp_it != timestamps_end; ++timestamp_it) {
+        if (!action(*timestamp_it, chunk->payloads[timestamp_it - timestamps_begin])) return;
+      }
+    }
+  }
+
+  template <typename Action>
+  void ForEachEvent(Action&& action) const {
+    orbit_base::DeferredDeleter::ReaderScope reader_scope{&deferred_deleter_};
+    const Directory* directory = directory_.load();
+    if (directory == nullptr) return;
+    const size_t chunk_count = directory->size.load(std::memory_order_acquire);
+    for (size_t chunk_index = 0; chunk_index < chunk_count; ++chunk_index) {
+      const Chunk* chunk = directory->chunks[chunk_index].load();
+      const size_t chunk_size = chunk->size.load(std::memory_order_acquire);
+      for (size_t i = 0; i < chunk_size; ++i) {
+        action(chunk->timestamps_ns[i], chunk->payloads[i]);
+      }
+    }
+  }
+
+  // Removes the events for which `predicate(payload)` returns true.
+  template <typename Predicate>
+  void RemoveEventsIf(Predicate&& predicate) {
+    Directory* directory = directory_.load();
+    if (directory == nullptr) return;
+    const size_t chunk_count = directory->size.load();
+    auto new_directory = std::make_unique<Directory>(directory->capacity);
+    size_t new_chunk_count = 0;
+    size_t new_size = 0;
+    for (size_t chunk_index = 0; chunk_index < chunk_count; ++chunk_index) {
+      const Chunk* chunk = directory->chunks[chunk_index].load();
+      const size_t chunk_size = chunk->size.load();
+      auto new_chunk = std::make_unique<Chunk>(chunk->capacity);
+      size_t kept_count = 0;
+      for (size_t i = 0; i < chunk_size; ++i) {
+        if (predicate(chunk->payloads[i])) continue;
+        new_chunk->timestamps_ns[kept_count] = chunk->timestamps_ns[i];
+        new_chunk->payloads[kept_count] = chunk->payloads[i];
+        ++kept_count;
+      }
+      new_chunk->size.store(kept_count);
+      new_size += kept_count;
+      // Drop the chunks that became empty, as every chunk needs to cover a time range.
+      if (kept_count > 0) {
+        new_directory->chunks[new_chunk_count++].store(new_chunk.release());
+      }
+    }
+    new_directory->size.store(new_chunk_count);
+    directory_.store(new_directory.release());
+    size_.store(new_size, std::memory_order_relaxed);
+    out_of_order_modification_count_.fetch_add(1, std::memory_order_release);
+
+    // Only retire the old chunks once they are unreachable for new readers.
+    for (size_t chunk_index = 0; chunk_index < chunk_count; ++chunk_index) {
+      deferred_deleter_.Retire(std::unique_ptr<Chunk>{directory->chunks[chunk_index].load()});
+    }
+    deferred_deleter_.Retire(std::unique_ptr<Directory>{directory});
+  }
+
+  // Returns the number of bytes allocated for the columns, including unused capacity.
+  [[nodiscard]] uint64_t GetAllocatedBytes() const {
+    orbit_base::DeferredDeleter::ReaderScope reader_scope{&deferred_deleter_};
+    const Directory* directory = directory_.load();
+    if (directory == nullptr) return 0;
+    uint64_t allocated_bytes = directory->capacity * sizeof(std::atomic<Chunk*>);
+    const size_t chunk_count = directory->size.load(std::memory_order_acquire);
+    for (size_t chunk_index = 0; chunk_index < chunk_count; ++chunk_index) {
+      allocated_bytes +=
+          directory->chunks[chunk_index].load()->capacity * (sizeof(uint64_t) + sizeof(Payload));
+    }
+    return allocated_bytes;
+  }
+
+ private:
+  struct Chunk {
+    explicit Chunk(size_t chunk_capacity)
+        : timestamps_ns{make_unique_for_overwrite<uint64_t[]>(chunk_capacity)},
+          payloads{make_unique_for_overwrite<Payload[]>(chunk_capacity)},
+          capacity{chunk_capacity} {}
+
+    // Only called on published chunks, which are never empty.
+    [[nodiscard]] uint64_t back() const {
+      return timestamps_ns[size.load(std::memory_order_acquire) - 1];
+    }
+
+    std::unique_ptr<uint64_t[]> timestamps_ns;
+    std::unique_ptr<Payload[]> payloads;
+    // Events at indices below `size` are published to readers and never modified.
+    std::atomic<size_t> size = 0;
+    const size_t capacity;
+  };
+
+  // The chunks in order of time. Chunks are appended behind the published size, otherwise the
+  // directory is replaced as a whole.
+  struct Directory {
+    explicit Directory(size_t directory_capacity)
+        : chunks{std::make_unique<std::atomic<Chunk*>[]>(directory_capacity)},
+          capacity{directory_capacity} {}
+
+    std::unique_ptr<std::atomic<Chunk*>[]> chunks;
+    std::atomic<size_t> size = 0;
+    const size_t capacity;
+  };
+
+  bool AddEvent(uint64_t timestamp_ns, const Payload& payload, bool replace_existing) {
+    Directory* directory = directory_.load();
+    Chunk* last_chunk = nullptr;
+    if (directory != nullptr && directory->size.load() > 0) {
+      last_chunk = directory->chunks[directory->size.load() - 1].load();
+      if (timestamp_ns <= last_chunk->back()) {
+        return InsertEvent(timestamp_ns, payload, replace_existing);
+      }
+    }
+
+    if (last_chunk != nullptr && last_chunk->size.load() < last_chunk->capacity) {
+      const size_t index = last_chunk->size.load();
+      last_chunk->timestamps_ns[index] = timestamp_ns;
+      last_chunk->payloads[index] = payload;
+      last_chunk->size.store(index + 1, std::memory_order_release);
+    } else {
+      auto chunk =
+          std::make_unique<Chunk>(std::clamp(size(), kMinChunkCapacity, kMaxChunkCapacity));
+      chunk->timestamps_ns[0] = timestamp_ns;
+      chunk->payloads[0] = payload;
+      chunk->size.store(1);
+      AppendChunk(std::move(chunk));
+    }
+    size_.store(size() + 1, std::memory_order_relaxed);
+    return true;
+  }
+
+  void AppendChunk(std::unique_ptr<Chunk> chunk) {
+    Directory* directory = directory_.load();
+    if (directory != nullptr && directory->size.load() < directory->capacity) {
+      const size_t chunk_count = directory->size.load();
+      directory->chunks[chunk_count].store(chunk.release());
+      directory->size.store(chunk_count + 1, std::memory_order_release);
+      return;
+    }
+
+    // Grow the directory geometrically, so that the copies take amortized O(1) per chunk.
+    const size_t chunk_count = directory == nullptr ? 0 : directory->size.load();
+    auto new_directory = std::make_unique<Directory>(std::max<size_t>(2 * chunk_count, 16));
+    for (size_t i = 0; i < chunk_count; ++i) {
+      new_directory->chunks[i].store(directory->chunks[i].load());
+    }
+    new_directory->chunks[chunk_count].store(chunk.release());
+    new_directory->size.store(chunk_count + 1);
+    directory_.store(new_directory.release());
+    deferred_deleter_.Retire(std::unique_ptr<Directory>{directory});
+  }
+
+  // Handles events that are not after the last event, by copying the chunk they belong to.
+  bool InsertEvent(uint64_t timestamp_ns, const Payload& payload, bool replace_existing) {
+    Directory* directory = directory_.load();
+    const size_t chunk_count = directory->size.load();
+    // The first chunk that ends at or after `timestamp_ns`. It exists, as the last chunk does.
+    const size_t chunk_index =
+        std::partition_point(directory->chunks.get(), directory->chunks.get() + chunk_count,
+                             [timestamp_ns](const std::atomic<Chunk*>& chunk) {
+                               return chunk.load()->back() < timestamp_ns;
+                             }) -
+        directory->chunks.get();
+    CHECK(chunk_index < chunk_count);
+    Chunk* chunk = directory->chunks[chunk_index].load();
+    const size_t chunk_size = chunk->size.load();
+    const size_t index =
+        std::lower_bound(chunk->timestamps_ns.get(), chunk->timestamps_ns.get() + chunk_size,
+                         timestamp_ns) -
+        chunk->timestamps_ns.get();
+    const bool is_replacement = chunk->timestamps_ns[index] == timestamp_ns;
+    if (is_replacement && !replace_existing) {
+      return false;
+    }
+
+    if (is_replacement || chunk_size < chunk->capacity) {
+      auto new_chunk = std::make_unique<Chunk>(chunk->capacity);
+      CopyEvents(*chunk, 0, index, new_chunk.get(), 0);
+      new_chunk->timestamps_ns[index] = timestamp_ns;
+      new_chunk->payloads[index] = payload;
+      const size_t copied_after_index = is_replacement ? index + 1 : index;
+      CopyEvents(*chunk, copied_after_index, chunk_size, new_chunk.get(), index + 1);
+      new_chunk->size.store(is_replacement ? chunk_size : chunk_size + 1);
+      directory->chunks[chunk_index].store(new_chunk.release());
+    } else {
+      // Split the full chunk into two halves, which requires a new directory.
+      const size_t first_half_size = chunk_size / 2;
+      auto first_half = std::make_unique<Chunk>(chunk->capacity);
+      auto second_half = std::make_unique<Chunk>(chunk->capacity);
+      if (index <= first_half_size) {
+        CopyEvents(*chunk, 0, index, first_half.get(), 0);
+        first_half->timestamps_ns[index] = timestamp_ns;
+        first_half->payloads[index] = payload;
+        CopyEvents(*chunk, index, first_half_size, first_half.get(), index + 1);
+        first_half->size.store(first_half_size + 1);
+        CopyEvents(*chunk, first_half_size, chunk_size, second_half.get(), 0);
+        second_half->size.store(chunk_size - first_half_size);
+      } else {
+        CopyEvents(*chunk, 0, first_half_size, first_half.get(), 0);
+        first_half->size.store(first_half_size);
+        const size_t index_in_second_half = index - first_half_size;
+        CopyEvents(*chunk, first_half_size, index, second_half.get(), 0);
+        second_half->timestamps_ns[index_in_second_half] = timestamp_ns;
+        second_half->payloads[index_in_second_half] = payload;
+        CopyEvents(*chunk, index, chunk_size, second_half.get(), index_in_second_half + 1);
+        second_half->size.store(chunk_size - first_half_size + 1);
+      }
+
+      auto new_directory =
+          std::make_unique<Directory>(std::max(directory->capacity, chunk_count + 1));
+      for (size_t i = 0; i < chunk_index; ++i) {
+        new_directory->chunks[i].store(directory->chunks[i].load());
+      }
+      new_directory->chunks[chunk_index].store(first_half.release());
+      new_directory->chunks[chunk_index + 1].store(second_half.release());
+      for (size_t i = chunk_index + 1; i < chunk_count; ++i) {
+        new_directory->chunks[i + 1].store(directory->chunks[i].load());
+      }
+      new_directory->size.store(chunk_count + 1);
+      directory_.store(new_directory.release());
+      deferred_deleter_.Retire(std::unique_ptr<Directory>{directory});
+    }
+
+    deferred_deleter_.Retire(std::unique_ptr<Chunk>{chunk});
+    if (!is_replacement) {
+      size_.store(size() + 1, std::memory_order_relaxed);
+    }
+    out_of_order_modification_count_.fetch_add(1, std::memory_order_release);
+    return true;
+  }
+
+  static void CopyEvents(const Chunk& source, size_t source_begin, size_t source_end,
+                         Chunk* destination, size_t destination_begin) {
+    const size_t count = source_end - source_begin;
+    if (count == 0) return;
+    memcpy(destination->timestamps_ns.get() + destination_begin,
+           source.timestamps_ns.get() + source_begin, count * sizeof(uint64_t));
+    memcpy(destination->payloads.get() + destination_begin, source.payloads.get() + source_begin,
+           count * sizeof(Payload));
+  }
+
+  std::atomic<Directory*> directory_ = nullptr;
+  std::atomic<size_t> size_ = 0;
+  // Incremented after the modified events are published, so that a reader that loads the new value
+  // also sees the modification.
+  std::atomic<uint64_t> out_of_order_modification_count_ = 0;
+  orbit_base::DeferredDeleter deferred_deleter_;
+};
+
+#endif  // ORBIT_CLIENT_DATA_TIME_SORTED_EVENT_COLUMNS_H_
@@ -5,6 +5,7 @@
 #ifndef ORBIT_CORE_TRACEPOINT_EVENT_BUFFER_H_
 #define ORBIT_CORE_TRACEPOINT_EVENT_BUFFER_H_
 
+#include <absl/base/thread_annotations.h>
 #include <absl/container/flat_hash_map.h>
 #include <absl/synchronization/mutex.h>
 
@@ -12,9 +13,11 @@
 #include <cstdint>
 #include <functional>
 #include <limits>
-#include <map>
+#include <memory>
 #include <vector>
 
+#include "OrbitBase/DeferredDeleter.h"
+#include "TimeSortedEventColumns.h"
 #include "capture_data.pb.h"
 #include "tracepoint.pb.h"
 
@@ -30,10 +33,19 @@
  * to compress the wire format of events. The events contain an identifier rather than the full
  * description of the tracepoint they correspond to.
  *
- * Thread-Safety: This class is thread-safe.
+ * Thread-Safety: This class is thread-safe. Adding events is serialized, while iterating over the
+ * events never blocks and is never blocked by adding events (see TimeSortedEventColumns).
  */
 class TracepointData {
  public:
+  TracepointData();
+  ~TracepointData();
+
+  TracepointData(const TracepointData&) = delete;
+  TracepointData& operator=(const TracepointData&) = delete;
+  TracepointData(TracepointData&&) = delete;
+  TracepointData& operator=(TracepointData&&) = delete;
+
   // Assume that the corresponding tracepoint of tracepoint_hash is already in unique_tracepoints_
   void EmplaceTracepointEvent(uint64_t time, uint64_t tracepoint_hash, int32_t process_id,
                               int32_t thread_id, int32_t cpu, bool is_same_pid_as_target);
@@ -56,13 +68,29 @@ class TracepointData {
       const std::function<void(const orbit_client_protos::TracepointInfo&)>& action) const;
 
  private:
-  int32_t num_total_tracepoint_events_ = 0;
+  // The fields of a TracepointEventInfo besides the time.
+  struct TracepointEventPayload {
+    uint64_t tracepoint_info_key;
+    int32_t tid;
+    int32_t pid;
+    int32_t cpu;
+  };
+  using TracepointEventColumns = TimeSortedEventColumns<TracepointEventPayload>;
+  // Published snapshot of the columns of all threads, replaced as a whole when the first event of
+  // a new thread arrives. The columns are owned by `columns_`.
+  using ColumnsByTid = absl::flat_hash_map<int32_t, TracepointEventColumns*>;
+
+  [[nodiscard]] TracepointEventColumns* GetOrCreateColumnsOfThread(int32_t thread_id)
+      ABSL_EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+
+  std::atomic<uint32_t> num_total_tracepoint_events_ = 0;
 
-  mutable absl::Mutex mutex_;
+  absl::Mutex mutex_;
   mutable absl::Mutex unique_tracepoints_mutex_;
 
-  absl::flat_hash_map<int32_t, std::map<uint64_t, orbit_client_protos::TracepointEventInfo> >
-      thread_id_to_time_to_tracepoint_;
+  std::vector<std::unique_ptr<TracepointEventColumns>> columns_ ABSL_GUARDED_BY(mutex_);
+  std::atomic<const ColumnsByTid*> thread_id_to_tracepoint_columns_;
+  orbit_base::DeferredDeleter deferred_deleter_;
   absl::flat_hash_map<uint64_t, orbit_grpc_protos::TracepointInfo> unique_tracepoints_;
 };
 
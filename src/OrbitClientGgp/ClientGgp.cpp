@@ -320,7 +320,7 @@ void ClientGgp::OnTimer(const orbit_client_protos::TimerInfo& timer_info) {
     // For timers, the function must be present in the process
     CHECK(func != nullptr);
     uint64_t elapsed_nanos = timer_info.end() - timer_info.start();
-    GetMutableCaptureData().UpdateFunctionStats(*func, elapsed_nanos);
+    GetMutableCaptureData().UpdateFunctionStats(timer_info.function_id(), elapsed_nanos);
   }
   ProcessTimer(timer_info);
 }
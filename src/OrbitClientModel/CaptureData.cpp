@@ -16,42 +16,64 @@
 using orbit_client_protos::FunctionInfo;
 using orbit_client_protos::FunctionStats;
 using orbit_client_protos::LinuxAddressInfo;
-using orbit_client_protos::ThreadStateSliceInfo;
-
-void CaptureData::ForEachThreadStateSliceIntersectingTimeRange(
-    int32_t thread_id, uint64_t min_timestamp, uint64_t max_timestamp,
-    const std::function<void(const ThreadStateSliceInfo&)>& action) const {
-  absl::MutexLock lock{thread_state_slices_mutex_.get()};
-  auto tid_thread_state_slices_it = thread_state_slices_.find(thread_id);
-  if (tid_thread_state_slices_it == thread_state_slices_.end()) {
-    return;
+
+void CaptureData::InitializeFunctionStats() {
+  uint64_t max_function_id = 0;
+  for (const auto& [function_id, unused_function] : instrumented_functions_) {
+    max_function_id = std::max(max_function_id, function_id);
+  }
+  // Only fall back to a search among the ids if the ids are sparse, e.g., in a corrupted file.
+  const size_t function_count = instrumented_functions_.size();
+  if (max_function_id <= 2 * function_count) {
+    functions_stats_.resize(max_function_id + 1);
+  } else {
+    for (const auto& [function_id, unused_function] : instrumented_functions_) {
+      sparse_function_ids_.push_back(function_id);
+    }
+    std::sort(sparse_function_ids_.begin(), sparse_function_ids_.end());
+    functions_stats_.resize(function_count);
   }
+  functions_duration_sketches_.reserve(functions_stats_.size());
+  for (size_t i = 0; i < functions_stats_.size(); ++i) {
+    functions_duration_sketches_.push_back(std::make_unique<orbit_client_data::QuantileSketch>());
+  }
+}
 
-  const std::vector<ThreadStateSliceInfo>& tid_thread_state_slices =
-      tid_thread_state_slices_it->second;
-  auto slice_it = std::lower_bound(tid_thread_state_slices.begin(), tid_thread_state_slices.end(),
-                                   min_timestamp,
-                                   [](const ThreadStateSliceInfo& slice, uint64_t min_timestamp) {
-                                     return slice.end_timestamp_ns() < min_timestamp;
-                                   });
-  while (slice_it != tid_thread_state_slices.end() &&
-         slice_it->begin_timestamp_ns() < max_timestamp) {
-    action(*slice_it);
-    ++slice_it;
+std::optional<size_t> CaptureData::GetFunctionStatsIndex(uint64_t instrumented_function_id) const {
+  if (sparse_function_ids_.empty()) {
+    if (instrumented_function_id >= functions_stats_.size()) return std::nullopt;
+    return instrumented_function_id;
   }
+  auto it = std::lower_bound(sparse_function_ids_.begin(), sparse_function_ids_.end(),
+                             instrumented_function_id);
+  if (it == sparse_function_ids_.end() || *it != instrumented_function_id) return std::nullopt;
+  return static_cast<size_t>(it - sparse_function_ids_.begin());
 }
 
-const FunctionStats& CaptureData::GetFunctionStatsOrDefault(const FunctionInfo& function) const {
+const FunctionStats& CaptureData::GetFunctionStatsOrDefault(
+    uint64_t instrumented_function_id) const {
   static const FunctionStats kDefaultFunctionStats;
-  auto function_stats_it = functions_stats_.find(function);
-  if (function_stats_it == functions_stats_.end()) {
+  std::optional<size_t> index = GetFunctionStatsIndex(instrumented_function_id);
+  if (!index.has_value()) {
     return kDefaultFunctionStats;
   }
-  return function_stats_it->second;
+  return functions_stats_[index.value()];
+}
+
+const orbit_client_data::QuantileSketch& CaptureData::GetFunctionDurationSketchOrDefault(
+    uint64_t instrumented_function_id) const {
+  static const orbit_client_data::QuantileSketch kDefaultSketch;
+  std::optional<size_t> index = GetFunctionStatsIndex(instrumented_function_id);
+  if (!index.has_value()) {
+    return kDefaultSketch;
+  }
+  return *functions_duration_sketches_[index.value()];
 }
 
-void CaptureData::UpdateFunctionStats(const FunctionInfo& function, uint64_t elapsed_nanos) {
-  FunctionStats& stats = functions_stats_[function];
+void CaptureData::UpdateFunctionStats(uint64_t instrumented_function_id, uint64_t elapsed_nanos) {
+  std::optional<size_t> index = GetFunctionStatsIndex(instrumented_function_id);
+  CHECK(index.has_value());
+  FunctionStats& stats = functions_stats_[index.value()];
   stats.set_count(stats.count() + 1);
   stats.set_total_time_ns(stats.total_time_ns() + elapsed_nanos);
   stats.set_average_time_ns(stats.total_time_ns() / stats.count());
@@ -63,6 +85,8 @@ void CaptureData::UpdateFunctionStats(const FunctionInfo& function, uint64_t ela
   if (stats.min_ns() == 0 || elapsed_nanos < stats.min_ns()) {
     stats.set_min_ns(elapsed_nanos);
   }
+
+  functions_duration_sketches_[index.value()]->Add(elapsed_nanos);
 }
 
 const FunctionInfo* CaptureData::GetInstrumentedFunctionById(uint64_t function_id) const {
@@ -111,7 +135,24 @@ void CaptureData::InsertAddressInfo(LinuxAddressInfo address_info) {
 const std::string CaptureData::kUnknownFunctionOrModuleName{"???"};
 
 const std::string& CaptureData::GetFunctionNameByAddress(uint64_t absolute_address) const {
-  const FunctionInfo* function = FindFunctionByAddress(absolute_address, false);
+  return GetFunctionNameInLoadedModule(loaded_modules_.Find(absolute_address), absolute_address);
+}
+
+std::vector<const std::string*> CaptureData::GetFunctionNamesByAddresses(
+    absl::Span<const uint64_t> absolute_addresses) const {
+  std::vector<const LoadedModule*> loaded_modules = loaded_modules_.FindAll(absolute_addresses);
+  std::vector<const std::string*> function_names;
+  function_names.reserve(absolute_addresses.size());
+  for (size_t i = 0; i < absolute_addresses.size(); ++i) {
+    function_names.push_back(
+        &GetFunctionNameInLoadedModule(loaded_modules[i], absolute_addresses[i]));
+  }
+  return function_names;
+}
+
+const std::string& CaptureData::GetFunctionNameInLoadedModule(const LoadedModule* loaded_module,
+                                                              uint64_t absolute_address) const {
+  const FunctionInfo* function = FindFunctionInLoadedModule(loaded_module, absolute_address, false);
   if (function != nullptr) {
     return function_utils::GetDisplayName(*function);
   }
@@ -145,9 +186,27 @@ std::optional<uint64_t> CaptureData::FindFunctionAbsoluteAddressByAddress(
 }
 
 const std::string& CaptureData::GetModulePathByAddress(uint64_t absolute_address) const {
-  const ModuleData* module_data = FindModuleByAddress(absolute_address);
-  if (module_data != nullptr) {
-    return module_data->file_path();
+  return GetModulePathOfLoadedModule(loaded_modules_.Find(absolute_address), absolute_address);
+}
+
+std::vector<const std::string*> CaptureData::GetModulePathsByAddresses(
+    absl::Span<const uint64_t> absolute_addresses) const {
+  std::vector<const LoadedModule*> loaded_modules = loaded_modules_.FindAll(absolute_addresses);
+  std::vector<const std::string*> module_paths;
+  module_paths.reserve(absolute_addresses.size());
+  for (size_t i = 0; i < absolute_addresses.size(); ++i) {
+    module_paths.push_back(&GetModulePathOfLoadedModule(loaded_modules[i], absolute_addresses[i]));
+  }
+  return module_paths;
+}
+
+const std::string& CaptureData::GetModulePathOfLoadedModule(const LoadedModule* loaded_module,
+                                                            uint64_t absolute_address) const {
+  if (loaded_module != nullptr) {
+    const ModuleData* module_data = GetModuleData(*loaded_module);
+    if (module_data != nullptr) {
+      return module_data->file_path();
+    }
   }
   const auto address_info_it = address_infos_.find(absolute_address);
   if (address_info_it == address_infos_.end()) {
@@ -163,22 +222,45 @@ const std::string& CaptureData::GetModulePathByAddress(uint64_t absolute_address
 
 const FunctionInfo* CaptureData::FindFunctionByAddress(uint64_t absolute_address,
                                                        bool is_exact) const {
-  const auto module_or_error = process_.FindModuleByAddress(absolute_address);
-  if (module_or_error.has_error()) return nullptr;
-  const std::string& module_path = module_or_error.value().first;
-  const uint64_t module_base_address = module_or_error.value().second;
+  return FindFunctionInLoadedModule(loaded_modules_.Find(absolute_address), absolute_address,
+                                    is_exact);
+}
 
-  const ModuleData* module = module_manager_->GetModuleByPath(module_path);
+const FunctionInfo* CaptureData::FindFunctionInLoadedModule(const LoadedModule* loaded_module,
+                                                            uint64_t absolute_address,
+                                                            bool is_exact) const {
+  if (loaded_module == nullptr) return nullptr;
+  const ModuleData* module = GetModuleData(*loaded_module);
   if (module == nullptr) return nullptr;
 
-  const uint64_t relative_address = absolute_address - module_base_address;
+  const uint64_t relative_address = absolute_address - loaded_module->module_base_address;
   return module->FindFunctionByRelativeAddress(relative_address, is_exact);
 }
 
 [[nodiscard]] ModuleData* CaptureData::FindModuleByAddress(uint64_t absolute_address) const {
-  const auto result = process_.FindModuleByAddress(absolute_address);
-  if (result.has_error()) return nullptr;
-  return module_manager_->GetMutableModuleByPath(result.value().first);
+  const LoadedModule* loaded_module = loaded_modules_.Find(absolute_address);
+  if (loaded_module == nullptr) return nullptr;
+  return GetModuleData(*loaded_module);
+}
+
+ModuleData* CaptureData::GetModuleData(const LoadedModule& loaded_module) const {
+  if (loaded_module.module_data != nullptr) return loaded_module.module_data;
+  return module_manager_->GetMutableModuleByPath(loaded_module.module_path);
+}
+
+orbit_client_data::AddressRangeIndex<CaptureData::LoadedModule>
+CaptureData::CreateLoadedModuleIndex(const ProcessData& process,
+                                     orbit_client_data::ModuleManager* module_manager) {
+  // ModuleManager never removes modules, so the pointers resolved here stay valid.
+  std::vector<orbit_client_data::AddressRangeIndex<LoadedModule>::Range> ranges;
+  ranges.reserve(process.GetMemoryMap().size());
+  for (const auto& [module_path, memory_space] : process.GetMemoryMap()) {
+    ModuleData* module_data =
+        module_manager != nullptr ? module_manager->GetMutableModuleByPath(module_path) : nullptr;
+    ranges.push_back({memory_space.start, memory_space.end,
+                      LoadedModule{module_path, memory_space.start, module_data}});
+  }
+  return orbit_client_data::AddressRangeIndex<LoadedModule>{std::move(ranges)};
 }
 
 uint64_t CaptureData::GetAbsoluteAddress(const orbit_client_protos::FunctionInfo& function) const {
@@ -0,0 +1,223 @@
+// Copyright (c) 2021 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <absl/container/flat_hash_map.h>
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "OrbitClientData/ModuleData.h"
+#include "OrbitClientData/ModuleManager.h"
+#include "OrbitClientData/ProcessData.h"
+#include "OrbitClientData/QuantileSketch.h"
+#include "OrbitClientModel/CaptureData.h"
+#include "capture_data.pb.h"
+#include "module.pb.h"
+#include "process.pb.h"
+#include "symbol.pb.h"
+
+using orbit_client_data::ModuleManager;
+using orbit_client_protos::FunctionInfo;
+using orbit_client_protos::LinuxAddressInfo;
+using orbit_grpc_protos::ModuleInfo;
+using orbit_grpc_protos::ModuleSymbols;
+using orbit_grpc_protos::SymbolInfo;
+
+namespace {
+
+// Two modules in the memory map of the process. Only the first one has symbols, the second one is
+// added to the ModuleManager only after the CaptureData was created.
+const std::string kModulePath1 = "/path/to/module1";
+const std::string kModulePath2 = "/path/to/module2";
+constexpr uint64_t kModuleStart1 = 0x10000;
+constexpr uint64_t kModuleEnd1 = 0x1ffff;
+constexpr uint64_t kModuleStart2 = 0x30000;
+constexpr uint64_t kModuleEnd2 = 0x3ffff;
+constexpr uint64_t kLoadBias1 = 0x1000;
+
+// Symbol at relative address 0x100 and 0x200 of the first module, both 0x80 bytes long.
+const std::string kFunctionName1 = "function1";
+const std::string kFunctionName2 = "function2";
+constexpr uint64_t kFunctionAbsoluteAddress1 = kModuleStart1 + 0x100;
+constexpr uint64_t kFunctionAbsoluteAddress2 = kModuleStart1 + 0x200;
+
+// Not in any module, but with a LinuxAddressInfo.
+constexpr uint64_t kUnmappedAddress = 0x20000;
+const std::string kUnmappedFunctionName = "unmapped_function";
+const std::string kUnmappedModulePath = "/path/to/unmapped";
+
+ModuleInfo CreateModuleInfo(const std::string& path, uint64_t start, uint64_t end,
+                            uint64_t load_bias) {
+  ModuleInfo module_info;
+  module_info.set_name(path);
+  module_info.set_file_path(path);
+  module_info.set_address_start(start);
+  module_info.set_address_end(end);
+  module_info.set_load_bias(load_bias);
+  return module_info;
+}
+
+void AddSymbol(ModuleSymbols* module_symbols, const std::string& name, uint64_t elf_address) {
+  SymbolInfo* symbol_info = module_symbols->add_symbol_infos();
+  symbol_info->set_name(name);
+  symbol_info->set_demangled_name(name);
+  symbol_info->set_address(elf_address);
+  symbol_info->set_size(0x80);
+}
+
+class CaptureDataTest : public ::testing::Test {
+ protected:
+  CaptureDataTest() : capture_data_{CreateCaptureData(&module_manager_)} {
+    LinuxAddressInfo address_info;
+    address_info.set_absolute_address(kUnmappedAddress);
+    address_info.set_function_name(kUnmappedFunctionName);
+    address_info.set_module_path(kUnmappedModulePath);
+    capture_data_.InsertAddressInfo(address_info);
+  }
+
+  static CaptureData CreateCaptureData(ModuleManager* module_manager) {
+    const ModuleInfo module_info1 =
+        CreateModuleInfo(kModulePath1, kModuleStart1, kModuleEnd1, kLoadBias1);
+    const ModuleInfo module_info2 = CreateModuleInfo(kModulePath2, kModuleStart2, kModuleEnd2, 0);
+
+    (void)module_manager->AddOrUpdateModules({module_info1});
+    ModuleSymbols module_symbols;
+    AddSymbol(&module_symbols, kFunctionName1, kLoadBias1 + 0x100);
+    AddSymbol(&module_symbols, kFunctionName2, kLoadBias1 + 0x200);
+    module_manager->GetMutableModuleByPath(kModulePath1)->AddSymbols(module_symbols);
+
+    orbit_grpc_protos::ProcessInfo process_info;
+    process_info.set_pid(1);
+    ProcessData process{process_info};
+    process.UpdateModuleInfos({module_info1, module_info2});
+    return CaptureData{std::move(process), module_manager, {}, {}, {}};
+  }
+
+  ModuleManager module_manager_;
+  CaptureData capture_data_;
+};
+
+}  // namespace
+
+TEST_F(CaptureDataTest, FindFunctionByAddress) {
+  const FunctionInfo* function =
+      capture_data_.FindFunctionByAddress(kFunctionAbsoluteAddress1, true);
+  ASSERT_NE(function, nullptr);
+  EXPECT_EQ(function->name(), kFunctionName1);
+
+  EXPECT_EQ(capture_data_.FindFunctionByAddress(kFunctionAbsoluteAddress1 + 8, true), nullptr);
+  function = capture_data_.FindFunctionByAddress(kFunctionAbsoluteAddress2 + 8, false);
+  ASSERT_NE(function, nullptr);
+  EXPECT_EQ(function->name(), kFunctionName2);
+
+  EXPECT_EQ(capture_data_.FindFunctionByAddress(kModuleStart2, false), nullptr);
+  EXPECT_EQ(capture_data_.FindFunctionByAddress(kUnmappedAddress, false), nullptr);
+}
+
+TEST_F(CaptureDataTest, FindModuleByAddress) {
+  ModuleData* module = capture_data_.FindModuleByAddress(kModuleEnd1);
+  ASSERT_NE(module, nullptr);
+  EXPECT_EQ(module->file_path(), kModulePath1);
+
+  EXPECT_EQ(capture_data_.FindModuleByAddress(kUnmappedAddress), nullptr);
+  // The second module is not in the ModuleManager yet.
+  EXPECT_EQ(capture_data_.FindModuleByAddress(kModuleStart2), nullptr);
+
+  (void)module_manager_.AddOrUpdateModules(
+      {CreateModuleInfo(kModulePath2, kModuleStart2, kModuleEnd2, 0)});
+  module = capture_data_.FindModuleByAddress(kModuleStart2);
+  ASSERT_NE(module, nullptr);
+  EXPECT_EQ(module->file_path(), kModulePath2);
+}
+
+TEST_F(CaptureDataTest, GetFunctionNameAndModulePathByAddress) {
+  EXPECT_EQ(capture_data_.GetFunctionNameByAddress(kFunctionAbsoluteAddress1), kFunctionName1);
+  EXPECT_EQ(capture_data_.GetModulePathByAddress(kFunctionAbsoluteAddress1), kModulePath1);
+
+  EXPECT_EQ(capture_data_.GetFunctionNameByAddress(kUnmappedAddress), kUnmappedFunctionName);
+  EXPECT_EQ(capture_data_.GetModulePathByAddress(kUnmappedAddress), kUnmappedModulePath);
+
+  EXPECT_EQ(capture_data_.GetFunctionNameByAddress(kModuleStart2),
+            CaptureData::kUnknownFunctionOrModuleName);
+  EXPECT_EQ(capture_data_.GetModulePathByAddress(kModuleStart2),
+            CaptureData::kUnknownFunctionOrModuleName);
+}
+
+TEST_F(CaptureDataTest, BatchLookupsMatchSingleLookups) {
+  const std::vector<uint64_t> addresses{
+      kFunctionAbsoluteAddress1, kFunctionAbsoluteAddress2 + 8, kFunctionAbsoluteAddress1 + 0x80,
+      kUnmappedAddress,          kModuleStart2,                 0};
+
+  const std::vector<const std::string*> function_names =
+      capture_data_.GetFunctionNamesByAddresses(addresses);
+  const std::vector<const std::string*> module_paths =
+      capture_data_.GetModulePathsByAddresses(addresses);
+  ASSERT_EQ(function_names.size(), addresses.size());
+  ASSERT_EQ(module_paths.size(), addresses.size());
+  for (size_t i = 0; i < addresses.size(); ++i) {
+    EXPECT_EQ(function_names[i], &capture_data_.GetFunctionNameByAddress(addresses[i]));
+    EXPECT_EQ(module_paths[i], &capture_data_.GetModulePathByAddress(addresses[i]));
+  }
+}
+
+TEST(CaptureData, UpdateFunctionStats) {
+  // Sparse ids are looked up differently from dense ids, so test both.
+  for (uint64_t function_id : {1ULL, 1ULL << 40}) {
+    ModuleManager module_manager;
+    absl::flat_hash_map<uint64_t, FunctionInfo> instrumented_functions;
+    instrumented_functions[function_id] = FunctionInfo{};
+    CaptureData capture_data{
+        ProcessData{}, &module_manager, std::move(instrumented_functions), {}, {}};
+
+    capture_data.UpdateFunctionStats(function_id, 100);
+    capture_data.UpdateFunctionStats(function_id, 300);
+
+    const orbit_client_protos::FunctionStats& stats =
+        capture_data.GetFunctionStatsOrDefault(function_id);
+    EXPECT_EQ(stats.count(), 2);
+    EXPECT_EQ(stats.total_time_ns(), 400);
+    EXPECT_EQ(stats.average_time_ns(), 200);
+    EXPECT_EQ(stats.min_ns(), 100);
+    EXPECT_EQ(stats.max_ns(), 300);
+    const orbit_client_data::QuantileSketch& sketch =
+        capture_data.GetFunctionDurationSketchOrDefault(function_id);
+    EXPECT_EQ(sketch.count(), 2);
+    EXPECT_NEAR(sketch.GetQuantile(1.0), 300, 3);
+
+    EXPECT_EQ(capture_data.GetFunctionStatsOrDefault(function_id + 1).count(), 0);
+    EXPECT_EQ(capture_data.GetFunctionDurationSketchOrDefault(function_id + 1).count(), 0);
+  }
+}
+
+TEST(CaptureData, GetFunctionDurationSketchWhileUpdatingFunctionStats) {
+  constexpr uint64_t kFunctionId = 1;
+  constexpr uint64_t kCallCount = 100'000;
+  ModuleManager module_manager;
+  absl::flat_hash_map<uint64_t, FunctionInfo> instrumented_functions;
+  instrumented_functions[kFunctionId] = FunctionInfo{};
+  CaptureData capture_data{
+      ProcessData{}, &module_manager, std::move(instrumented_functions), {}, {}};
+
+  // Like the capture thread during a live capture, while the UI shows the percentiles.
+  std::thread capture_thread{[&capture_data]() {
+    for (uint64_t elapsed_nanos = 1; elapsed_nanos <= kCallCount; ++elapsed_nanos) {
+      capture_data.UpdateFunctionStats(kFunctionId, elapsed_nanos * 1000);
+    }
+  }};
+  const orbit_client_data::QuantileSketch& sketch =
+      capture_data.GetFunctionDurationSketchOrDefault(kFunctionId);
+  while (sketch.count() < kCallCount) {
+    // Durations are only added, and they grow, so the later estimate is never smaller.
+    const uint64_t median = sketch.GetQuantile(0.5);
+    EXPECT_LE(median, sketch.GetQuantile(0.99));
+  }
+  capture_thread.join();
+
+  EXPECT_NEAR(sketch.GetQuantile(1.0), kCallCount * 1000, kCallCount * 1000 / 50);
+}
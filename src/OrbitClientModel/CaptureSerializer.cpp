@@ -102,16 +102,13 @@ CaptureInfo GenerateCaptureInfo(
   capture_info.mutable_thread_names()->insert(capture_data.thread_names().begin(),
                                               capture_data.thread_names().end());
 
-  for (const auto& tid_and_thread_state_slices : capture_data.thread_state_slices()) {
-    // Note that thread state slices are saved in their original order only among the same thread,
-    // but all slices related to the same thread are saved sequentially. This might not be desired
-    // if the capture is opened in a streaming fashion.
-    for (const auto& thread_state_slice : tid_and_thread_state_slices.second) {
-      orbit_client_protos::ThreadStateSliceInfo* added_thread_state_slice =
-          capture_info.add_thread_state_slices();
-      added_thread_state_slice->CopyFrom(thread_state_slice);
-    }
-  }
+  // Note that thread state slices are saved in order of time only among the same thread, but all
+  // slices related to the same thread are saved sequentially. This might not be desired if the
+  // capture is opened in a streaming fashion.
+  capture_data.ForEachThreadStateSlice(
+      [&capture_info](const orbit_client_protos::ThreadStateSliceInfo& thread_state_slice) {
+        capture_info.add_thread_state_slices()->CopyFrom(thread_state_slice);
+      });
 
   capture_info.mutable_address_infos()->Reserve(capture_data.address_infos().size());
   for (const auto& address_info : capture_data.address_infos()) {
@@ -131,8 +128,9 @@ CaptureInfo GenerateCaptureInfo(
     added_address_info->set_module_path(function->loaded_module_path());
   }
 
-  const FunctionInfoMap<FunctionStats>& functions_stats = capture_data.functions_stats();
-  for (const auto& [function, stats] : functions_stats) {
+  for (const auto& [function_id, function] : capture_data.instrumented_functions()) {
+    const FunctionStats& stats = capture_data.GetFunctionStatsOrDefault(function_id);
+    if (stats.count() == 0) continue;
     uint64_t absolute_address = capture_data.GetAbsoluteAddress(function);
     capture_info.mutable_function_stats()->operator[](absolute_address) = stats;
   }
@@ -168,9 +168,9 @@ TEST(CaptureSerializer, GenerateCaptureInfo) {
       tracepoint_event.time(), tracepoint_event.tracepoint_info_key(), tracepoint_event.pid(),
       tracepoint_event.tid(), tracepoint_event.cpu(), true);
 
-  capture_data.UpdateFunctionStats(instrumented_function, 100);
-  capture_data.UpdateFunctionStats(instrumented_function, 110);
-  capture_data.UpdateFunctionStats(instrumented_function, 120);
+  capture_data.UpdateFunctionStats(kInstrumentedFunctionId, 100);
+  capture_data.UpdateFunctionStats(kInstrumentedFunctionId, 110);
+  capture_data.UpdateFunctionStats(kInstrumentedFunctionId, 120);
 
   absl::flat_hash_map<uint64_t, std::string> key_to_string_map;
   key_to_string_map[0] = "a";
@@ -249,7 +249,7 @@ TEST(CaptureSerializer, GenerateCaptureInfo) {
   const FunctionStats& actual_function_stats =
       capture_info.function_stats().at(selected_function_absolute_address);
   const FunctionStats& expected_function_stats =
-      capture_data.GetFunctionStatsOrDefault(instrumented_function);
+      capture_data.GetFunctionStatsOrDefault(kInstrumentedFunctionId);
   EXPECT_EQ(expected_function_stats.count(), actual_function_stats.count());
   EXPECT_EQ(expected_function_stats.total_time_ns(), actual_function_stats.total_time_ns());
   EXPECT_EQ(expected_function_stats.average_time_ns(), actual_function_stats.average_time_ns());
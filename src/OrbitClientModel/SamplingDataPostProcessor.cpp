@@ -4,19 +4,24 @@
 
 #include "OrbitClientModel/SamplingDataPostProcessor.h"
 
-#include <absl/meta/type_traits.h>
+#include <absl/base/thread_annotations.h>
+#include <absl/synchronization/mutex.h>
 
 #include <algorithm>
+#include <atomic>
 #include <cstdint>
-#include <iterator>
+#include <functional>
+#include <limits>
 #include <map>
 #include <memory>
 #include <optional>
 #include <set>
 #include <string>
+#include <thread>
 #include <utility>
 #include <vector>
 
+#include "OrbitBase/Action.h"
 #include "OrbitBase/Logging.h"
 #include "OrbitBase/ThreadConstants.h"
 #include "OrbitClientData/Callstack.h"
@@ -27,143 +32,236 @@
 
 using orbit_client_protos::CallstackEvent;
 using orbit_client_protos::FunctionInfo;
-using orbit_client_protos::LinuxAddressInfo;
 
 namespace orbit_client_model {
 
 namespace {
 
-class SamplingDataPostProcessor {
- public:
-  explicit SamplingDataPostProcessor() = default;
-  SamplingDataPostProcessor& operator=(const SamplingDataPostProcessor& other) = default;
-  SamplingDataPostProcessor(const SamplingDataPostProcessor& other) = default;
+struct ParallelForState {
+  explicit ParallelForState(size_t count) : task_count{count} {}
 
-  SamplingDataPostProcessor(SamplingDataPostProcessor&& other) = default;
-  SamplingDataPostProcessor& operator=(SamplingDataPostProcessor&& other) = default;
-
-  PostProcessedSamplingData ProcessSamples(const CallstackData& callstack_data,
-                                           const CaptureData& capture_data, bool generate_summary);
-
- private:
-  void SortByThreadUsage();
+  const size_t task_count;
+  std::atomic<size_t> next_index = 0;
+  absl::Mutex mutex;
+  size_t completed_count ABSL_GUARDED_BY(mutex) = 0;
+};
 
-  void ResolveCallstacks(const CallstackData& callstack_data, const CaptureData& capture_data);
+bool AllTasksCompleted(ParallelForState* state) ABSL_EXCLUSIVE_LOCKS_REQUIRED(state->mutex) {
+  return state->completed_count == state->task_count;
+}
 
-  void MapAddressToFunctionAddress(uint64_t absolute_address, const CaptureData& capture_data);
+// Calls `task` for each index in [0, task_count). Indices are taken from a shared counter by the
+// calling thread and, if `thread_pool` is not null, by up to one worker per hardware thread. As the
+// calling thread takes part, this also returns when no worker of a busy pool gets to run: workers
+// that start late find no index left and don't touch `task`.
+void ParallelFor(ThreadPool* thread_pool, size_t task_count,
+                 const std::function<void(size_t)>& task) {
+  if (task_count == 0) return;
+  auto state = std::make_shared<ParallelForState>(task_count);
+  auto run_tasks = [state, &task] {
+    size_t completed_count = 0;
+    for (size_t index = state->next_index++; index < state->task_count;
+         index = state->next_index++) {
+      task(index);
+      ++completed_count;
+    }
+    if (completed_count == 0) return;
+    absl::MutexLock lock(&state->mutex);
+    state->completed_count += completed_count;
+  };
+
+  if (thread_pool != nullptr) {
+    const size_t hardware_thread_count = std::max(std::thread::hardware_concurrency(), 1u);
+    const size_t worker_count = std::min(task_count, hardware_thread_count) - 1;
+    for (size_t i = 0; i < worker_count; ++i) {
+      thread_pool->Schedule(CreateAction(run_tasks));
+    }
+  }
+  run_tasks();
 
-  void FillThreadSampleDataSampleReports(const CaptureData& capture_data);
+  absl::MutexLock lock(&state->mutex);
+  state->mutex.Await(absl::Condition(AllTasksCompleted, state.get()));
+}
 
-  // Filled by ProcessSamples.
-  absl::flat_hash_map<ThreadID, ThreadSampleData> thread_id_to_sample_data_;
-  absl::flat_hash_map<CallstackID, CallStack> unique_resolved_callstacks_;
-  absl::flat_hash_map<std::vector<uint64_t>, CallstackID> unique_resolved_callstacks_to_id_;
-  absl::flat_hash_map<CallstackID, CallstackID> original_to_resolved_callstack_;
-  absl::flat_hash_map<uint64_t, std::set<CallstackID>> function_address_to_callstack_;
-  absl::flat_hash_map<uint64_t, uint64_t> exact_address_to_function_address_;
-  absl::flat_hash_map<uint64_t, absl::flat_hash_set<uint64_t>> function_address_to_exact_addresses_;
-  std::vector<ThreadSampleData> sorted_thread_sample_data_;
-};
+void AddCounts(const absl::flat_hash_map<uint64_t, uint32_t>& counts,
+               absl::flat_hash_map<uint64_t, uint32_t>* total_counts) {
+  for (const auto& [key, count] : counts) {
+    (*total_counts)[key] += count;
+  }
+}
 
 }  // namespace
 
+SamplingDataPostProcessor::SamplingDataPostProcessor(const CallstackData* callstack_data,
+                                                     ThreadPool* thread_pool)
+    : callstack_data_{callstack_data}, thread_pool_{thread_pool} {
+  CHECK(callstack_data_ != nullptr);
+}
+
 PostProcessedSamplingData CreatePostProcessedSamplingData(const CallstackData& callstack_data,
                                                           const CaptureData& capture_data,
-                                                          bool generate_summary) {
-  SamplingDataPostProcessor profiler;
-  return profiler.ProcessSamples(callstack_data, capture_data, generate_summary);
+                                                          bool generate_summary,
+                                                          ThreadPool* thread_pool) {
+  SamplingDataPostProcessor processor{&callstack_data, thread_pool};
+  return processor.ProcessSamples(capture_data, generate_summary);
 }
 
-namespace {
-PostProcessedSamplingData SamplingDataPostProcessor::ProcessSamples(
-    const CallstackData& callstack_data, const CaptureData& capture_data, bool generate_summary) {
-  // Unique call stacks and per thread data
-  callstack_data.ForEachCallstackEvent(
-      [this, &callstack_data, generate_summary](const CallstackEvent& event) {
-        CHECK(callstack_data.HasCallStack(event.callstack_id()));
-
-        ThreadSampleData* thread_sample_data = &thread_id_to_sample_data_[event.thread_id()];
-        thread_sample_data->samples_count++;
-        thread_sample_data->callstack_count[event.callstack_id()]++;
-        callstack_data.ForEachFrameInCallstack(event.callstack_id(),
-                                               [&thread_sample_data](uint64_t address) {
-                                                 thread_sample_data->raw_address_count[address]++;
-                                               });
-
-        if (generate_summary) {
-          ThreadSampleData* all_thread_sample_data =
-              &thread_id_to_sample_data_[orbit_base::kAllProcessThreadsTid];
-          all_thread_sample_data->samples_count++;
-          all_thread_sample_data->callstack_count[event.callstack_id()]++;
-          callstack_data.ForEachFrameInCallstack(
-              event.callstack_id(), [&all_thread_sample_data](uint64_t address) {
-                all_thread_sample_data->raw_address_count[address]++;
-              });
-        }
-      });
-
-  ResolveCallstacks(callstack_data, capture_data);
-
-  for (auto& sample_data_it : thread_id_to_sample_data_) {
-    ThreadSampleData* thread_sample_data = &sample_data_it.second;
-
-    // Address count per sample per thread
-    for (const auto& callstack_count_it : thread_sample_data->callstack_count) {
-      const CallstackID callstack_id = callstack_count_it.first;
-      const uint32_t callstack_count = callstack_count_it.second;
-
-      CallstackID resolved_callstack_id = original_to_resolved_callstack_[callstack_id];
-      const CallStack& resolved_callstack = unique_resolved_callstacks_[resolved_callstack_id];
-
-      // exclusive stat
-      thread_sample_data->exclusive_count[resolved_callstack.GetFrame(0)] += callstack_count;
-
-      std::set<uint64_t> unique_addresses;
-      for (uint64_t address : resolved_callstack.frames()) {
-        unique_addresses.insert(address);
-      }
+PostProcessedSamplingData SamplingDataPostProcessor::ProcessSamples(const CaptureData& capture_data,
+                                                                    bool generate_summary) {
+  CountNewSamples();
 
-      for (uint64_t address : unique_addresses) {
-        thread_sample_data->address_count[address] += callstack_count;
-      }
-    }
+  // Callstacks are added before the events that refer to them, so this resolves all callstacks
+  // that were counted.
+  ResolveNewCallstacks(capture_data);
 
-    // sort thread addresses by count
-    for (const auto& address_count_it : thread_sample_data->address_count) {
-      const uint64_t address = address_count_it.first;
-      const uint32_t count = address_count_it.second;
-      thread_sample_data->address_count_sorted.insert(std::make_pair(count, address));
+  std::vector<ThreadSampleCounts*> all_counts;
+  all_counts.reserve(thread_id_to_counts_.size());
+  for (auto& [unused_thread_id, counts] : thread_id_to_counts_) {
+    all_counts.push_back(&counts);
+  }
+  ParallelFor(thread_pool_, all_counts.size(), [this, &all_counts](size_t i) {
+    ThreadSampleCounts* counts = all_counts[i];
+    if (resolved_counts_outdated_) {
+      counts->address_count.clear();
+      counts->exclusive_count.clear();
+      AddResolvedCounts(counts->callstack_count, counts);
+    } else {
+      AddResolvedCounts(counts->new_callstack_count, counts);
+    }
+    counts->new_callstack_count.clear();
+  });
+  resolved_counts_outdated_ = false;
+
+  absl::flat_hash_map<ThreadID, ThreadSampleData> thread_id_to_sample_data;
+  for (const auto& [thread_id, counts] : thread_id_to_counts_) {
+    if (counts.samples_count == 0) continue;
+    ThreadSampleData* thread_sample_data = &thread_id_to_sample_data[thread_id];
+    thread_sample_data->samples_count = counts.samples_count;
+    thread_sample_data->callstack_count = counts.callstack_count;
+    thread_sample_data->raw_address_count = counts.raw_address_count;
+    thread_sample_data->address_count = counts.address_count;
+    thread_sample_data->exclusive_count = counts.exclusive_count;
+
+    if (generate_summary) {
+      ThreadSampleData* all_thread_sample_data =
+          &thread_id_to_sample_data[orbit_base::kAllProcessThreadsTid];
+      all_thread_sample_data->samples_count += counts.samples_count;
+      AddCounts(counts.callstack_count, &all_thread_sample_data->callstack_count);
+      AddCounts(counts.raw_address_count, &all_thread_sample_data->raw_address_count);
+      AddCounts(counts.address_count, &all_thread_sample_data->address_count);
+      AddCounts(counts.exclusive_count, &all_thread_sample_data->exclusive_count);
     }
   }
 
-  FillThreadSampleDataSampleReports(capture_data);
+  // CaptureData is only queried from this thread.
+  DescribeNewFunctions(thread_id_to_sample_data, capture_data);
 
-  SortByThreadUsage();
+  std::vector<ThreadSampleData*> thread_sample_datas;
+  thread_sample_datas.reserve(thread_id_to_sample_data.size());
+  for (auto& [thread_id, thread_sample_data] : thread_id_to_sample_data) {
+    thread_sample_data.thread_id = thread_id;
+    thread_sample_datas.push_back(&thread_sample_data);
+  }
+  ParallelFor(thread_pool_, thread_sample_datas.size(), [this, &thread_sample_datas](size_t i) {
+    FillSampledFunctions(thread_sample_datas[i]);
+  });
 
-  return PostProcessedSamplingData(
-      std::move(thread_id_to_sample_data_), std::move(unique_resolved_callstacks_),
-      std::move(original_to_resolved_callstack_), std::move(function_address_to_callstack_),
-      std::move(function_address_to_exact_addresses_), std::move(sorted_thread_sample_data_));
+  // Sort by thread usage.
+  std::vector<ThreadSampleData> sorted_thread_sample_data;
+  sorted_thread_sample_data.reserve(thread_id_to_sample_data.size());
+  for (const auto& [unused_thread_id, thread_sample_data] : thread_id_to_sample_data) {
+    sorted_thread_sample_data.push_back(thread_sample_data);
+  }
+  std::sort(sorted_thread_sample_data.begin(), sorted_thread_sample_data.end(),
+            [](const ThreadSampleData& a, const ThreadSampleData& b) {
+              return a.samples_count > b.samples_count;
+            });
+
+  return PostProcessedSamplingData(std::move(thread_id_to_sample_data),
+                                   unique_resolved_callstacks_, original_to_resolved_callstack_,
+                                   function_address_to_callstack_,
+                                   function_address_to_exact_addresses_,
+                                   std::move(sorted_thread_sample_data));
 }
 
-void SamplingDataPostProcessor::SortByThreadUsage() {
-  sorted_thread_sample_data_.reserve(thread_id_to_sample_data_.size());
+void SamplingDataPostProcessor::ClearResolvedAddresses() {
+  unique_resolved_callstacks_.clear();
+  unique_resolved_callstacks_to_id_.clear();
+  original_to_resolved_callstack_.clear();
+  function_address_to_callstack_.clear();
+  exact_address_to_function_address_.clear();
+  function_address_to_exact_addresses_.clear();
+  function_address_to_description_.clear();
+  resolved_counts_outdated_ = true;
+}
 
-  for (auto& pair : thread_id_to_sample_data_) {
-    ThreadSampleData& data = pair.second;
-    data.thread_id = pair.first;
-    sorted_thread_sample_data_.push_back(data);
+void SamplingDataPostProcessor::CountNewSamples() {
+  for (const auto& [thread_id, unused_events_count] :
+       callstack_data_->GetCallstackEventsCountsPerTid()) {
+    thread_id_to_counts_.try_emplace(thread_id);
+  }
+  // Collect the pointers once all threads are inserted, as pointers to the values of a
+  // flat_hash_map are not stable.
+  std::vector<std::pair<ThreadID, ThreadSampleCounts*>> threads;
+  threads.reserve(thread_id_to_counts_.size());
+  for (auto& [thread_id, counts] : thread_id_to_counts_) {
+    threads.emplace_back(thread_id, &counts);
+  }
+
+  ParallelFor(thread_pool_, threads.size(), [this, &threads](size_t i) {
+    const auto& [thread_id, counts] = threads[i];
+    CountNewSamplesOfThread(thread_id, counts);
+  });
+}
+
+void SamplingDataPostProcessor::CountNewSamplesOfThread(ThreadID thread_id,
+                                                        ThreadSampleCounts* counts) const {
+  // Read before counting: a modification made while counting might be missed by this call, but
+  // then changes the value for the next call.
+  const uint64_t modification_count =
+      callstack_data_->GetCallstackEventsOfTidOutOfOrderModificationCount(thread_id);
+  if (modification_count != counts->out_of_order_modification_count) {
+    // Events were added before or replaced among the events already counted, or removed.
+    *counts = ThreadSampleCounts{};
   }
 
-  sort(sorted_thread_sample_data_.begin(), sorted_thread_sample_data_.end(),
-       [](const ThreadSampleData& a, const ThreadSampleData& b) {
-         return a.samples_count > b.samples_count;
-       });
+  absl::flat_hash_map<CallstackID, uint32_t> new_callstack_count;
+  uint32_t new_samples_count = 0;
+  uint64_t max_timestamp_ns = counts->max_counted_timestamp_ns;
+  auto count_events_from = [&](uint64_t min_timestamp_ns) {
+    callstack_data_->ForEachCallstackEventOfTidInTimeRange(
+        thread_id, min_timestamp_ns, std::numeric_limits<uint64_t>::max(),
+        [&](const CallstackEvent& event) {
+          ++new_callstack_count[event.callstack_id()];
+          ++new_samples_count;
+          max_timestamp_ns = std::max(max_timestamp_ns, event.time());
+        });
+  };
+
+  if (counts->samples_count == 0) {
+    count_events_from(0);
+  } else if (counts->max_counted_timestamp_ns < std::numeric_limits<uint64_t>::max()) {
+    count_events_from(counts->max_counted_timestamp_ns + 1);
+  }
+
+  for (const auto& [callstack_id, count] : new_callstack_count) {
+    const CallStack* callstack = callstack_data_->GetCallStack(callstack_id);
+    CHECK(callstack != nullptr);
+    counts->callstack_count[callstack_id] += count;
+    for (uint64_t address : callstack->frames()) {
+      counts->raw_address_count[address] += count;
+    }
+  }
+  AddCounts(new_callstack_count, &counts->new_callstack_count);
+  counts->samples_count += new_samples_count;
+  counts->max_counted_timestamp_ns = max_timestamp_ns;
+  counts->out_of_order_modification_count = modification_count;
 }
 
-void SamplingDataPostProcessor::ResolveCallstacks(const CallstackData& callstack_data,
-                                                  const CaptureData& capture_data) {
-  callstack_data.ForEachUniqueCallstack([this, &capture_data](const CallStack& call_stack) {
+void SamplingDataPostProcessor::ResolveNewCallstacks(const CaptureData& capture_data) {
+  callstack_data_->ForEachUniqueCallstack([this, &capture_data](const CallStack& call_stack) {
+    if (original_to_resolved_callstack_.contains(call_stack.id())) return;
+
     // A "resolved callstack" is a callstack where every address is replaced
     // by the start address of the function (if known).
     std::vector<uint64_t> resolved_callstack_data;
@@ -212,40 +310,81 @@ void SamplingDataPostProcessor::MapAddressToFunctionAddress(uint64_t absolute_ad
   function_address_to_exact_addresses_[absolute_function_address].insert(absolute_address);
 }
 
-void SamplingDataPostProcessor::FillThreadSampleDataSampleReports(const CaptureData& capture_data) {
-  for (auto& data : thread_id_to_sample_data_) {
-    ThreadSampleData* thread_sample_data = &data.second;
-    std::vector<SampledFunction>* sampled_functions = &thread_sample_data->sampled_function;
-
-    for (auto sorted_it = thread_sample_data->address_count_sorted.rbegin();
-         sorted_it != thread_sample_data->address_count_sorted.rend(); ++sorted_it) {
-      uint32_t num_occurences = sorted_it->first;
-      uint64_t absolute_address = sorted_it->second;
-      float inclusive_percent = 100.f * num_occurences / thread_sample_data->samples_count;
-
-      SampledFunction function;
-      function.name = capture_data.GetFunctionNameByAddress(absolute_address);
-      function.inclusive = inclusive_percent;
-      function.exclusive = 0.f;
-      auto it = thread_sample_data->exclusive_count.find(absolute_address);
-      if (it != thread_sample_data->exclusive_count.end()) {
-        function.exclusive = 100.f * it->second / thread_sample_data->samples_count;
-      }
-      function.absolute_address = absolute_address;
-      function.module_path = capture_data.GetModulePathByAddress(absolute_address);
+void SamplingDataPostProcessor::AddResolvedCounts(
+    const absl::flat_hash_map<CallstackID, uint32_t>& callstack_count,
+    ThreadSampleCounts* counts) const {
+  std::vector<uint64_t> unique_addresses;
+  for (const auto& [callstack_id, count] : callstack_count) {
+    const auto resolved_callstack_id_it = original_to_resolved_callstack_.find(callstack_id);
+    CHECK(resolved_callstack_id_it != original_to_resolved_callstack_.end());
+    const CallStack& resolved_callstack =
+        unique_resolved_callstacks_.at(resolved_callstack_id_it->second);
+
+    // exclusive stat
+    counts->exclusive_count[resolved_callstack.GetFrame(0)] += count;
+
+    unique_addresses.assign(resolved_callstack.frames().begin(), resolved_callstack.frames().end());
+    std::sort(unique_addresses.begin(), unique_addresses.end());
+    unique_addresses.erase(std::unique(unique_addresses.begin(), unique_addresses.end()),
+                           unique_addresses.end());
+    for (uint64_t address : unique_addresses) {
+      counts->address_count[address] += count;
+    }
+  }
+}
 
+void SamplingDataPostProcessor::DescribeNewFunctions(
+    const absl::flat_hash_map<ThreadID, ThreadSampleData>& thread_id_to_sample_data,
+    const CaptureData& capture_data) {
+  for (const auto& [unused_thread_id, thread_sample_data] : thread_id_to_sample_data) {
+    for (const auto& [absolute_address, unused_count] : thread_sample_data.address_count) {
+      if (function_address_to_description_.contains(absolute_address)) continue;
+
+      FunctionDescription description;
+      description.name = capture_data.GetFunctionNameByAddress(absolute_address);
+      description.module_path = capture_data.GetModulePathByAddress(absolute_address);
       const FunctionInfo* function_info =
           capture_data.FindFunctionByAddress(absolute_address, false);
       if (function_info != nullptr) {
-        function.line = function_info->line();
-        function.file = function_info->file();
+        description.line = function_info->line();
+        description.file = function_info->file();
       }
-
-      sampled_functions->push_back(function);
+      function_address_to_description_.emplace(absolute_address, std::move(description));
     }
   }
 }
 
-}  // namespace
+void SamplingDataPostProcessor::FillSampledFunctions(ThreadSampleData* thread_sample_data) const {
+  // sort thread addresses by count
+  for (const auto& [address, count] : thread_sample_data->address_count) {
+    thread_sample_data->address_count_sorted.insert(std::make_pair(count, address));
+  }
+
+  std::vector<SampledFunction>* sampled_functions = &thread_sample_data->sampled_function;
+  sampled_functions->reserve(thread_sample_data->address_count_sorted.size());
+
+  for (auto sorted_it = thread_sample_data->address_count_sorted.rbegin();
+       sorted_it != thread_sample_data->address_count_sorted.rend(); ++sorted_it) {
+    uint32_t num_occurences = sorted_it->first;
+    uint64_t absolute_address = sorted_it->second;
+    float inclusive_percent = 100.f * num_occurences / thread_sample_data->samples_count;
+
+    const FunctionDescription& description = function_address_to_description_.at(absolute_address);
+    SampledFunction function;
+    function.name = description.name;
+    function.inclusive = inclusive_percent;
+    function.exclusive = 0.f;
+    auto it = thread_sample_data->exclusive_count.find(absolute_address);
+    if (it != thread_sample_data->exclusive_count.end()) {
+      function.exclusive = 100.f * it->second / thread_sample_data->samples_count;
+    }
+    function.absolute_address = absolute_address;
+    function.module_path = description.module_path;
+    function.line = description.line;
+    function.file = description.file;
+
+    sampled_functions->push_back(function);
+  }
+}
 
 }  // namespace orbit_client_model
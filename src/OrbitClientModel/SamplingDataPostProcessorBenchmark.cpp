@@ -0,0 +1,153 @@
+// Copyright (c) 2021 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <absl/time/time.h>
+#include <benchmark/benchmark.h>
+
+#include <cstdint>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "OrbitBase/ThreadPool.h"
+#include "OrbitClientData/Callstack.h"
+#include "OrbitClientData/CallstackData.h"
+#include "OrbitClientData/ModuleManager.h"
+#include "OrbitClientData/PostProcessedSamplingData.h"
+#include "OrbitClientData/ProcessData.h"
+#include "OrbitClientModel/CaptureData.h"
+#include "OrbitClientModel/SamplingDataPostProcessor.h"
+#include "capture_data.pb.h"
+#include "process.pb.h"
+
+// These benchmarks measure the post-processing of the samples of a capture with 10M samples, from
+// scratch and after new samples were added, e.g., during a live capture.
+
+namespace {
+
+constexpr int32_t kThreadCount = 32;
+constexpr uint64_t kSampleCount = 10'000'000;
+constexpr uint64_t kSampleCountPerThread = kSampleCount / kThreadCount;
+constexpr uint64_t kSamplingPeriodNs = 1'000'000;
+constexpr uint64_t kCallstackCount = 10'000;
+constexpr uint64_t kCallstackDepth = 32;
+constexpr uint64_t kFunctionCount = 1'000;
+constexpr uint64_t kAddressCountPerFunction = 4;
+constexpr uint64_t kFunctionSize = 0x100;
+
+class SyntheticCapture {
+ public:
+  SyntheticCapture() : capture_data_{CreateCaptureData(&module_manager_)} {
+    for (uint64_t function = 0; function < kFunctionCount; ++function) {
+      for (uint64_t address = 0; address < kAddressCountPerFunction; ++address) {
+        orbit_client_protos::LinuxAddressInfo address_info;
+        address_info.set_absolute_address(GetAddress(function, address));
+        address_info.set_offset_in_function(address);
+        address_info.set_function_name("function");
+        address_info.set_module_path("/path/to/module");
+        capture_data_.InsertAddressInfo(std::move(address_info));
+      }
+    }
+
+    for (uint64_t callstack_id = 0; callstack_id < kCallstackCount; ++callstack_id) {
+      std::vector<uint64_t> frames;
+      for (uint64_t depth = 0; depth < kCallstackDepth; ++depth) {
+        const uint64_t hash = (callstack_id + 1) * 2654435761 + depth * 40503;
+        frames.push_back(GetAddress(hash % kFunctionCount, hash % kAddressCountPerFunction));
+      }
+      callstack_data_.AddUniqueCallStack(CallStack{callstack_id, std::move(frames)});
+    }
+  }
+
+  void AddSamples(uint64_t sample_count_per_thread) {
+    orbit_client_protos::CallstackEvent event;
+    for (uint64_t i = 0; i < sample_count_per_thread; ++i) {
+      for (int32_t tid = 0; tid < kThreadCount; ++tid) {
+        event.set_time((next_sample_index_ + i) * kSamplingPeriodNs + tid);
+        event.set_thread_id(tid);
+        event.set_callstack_id(((next_sample_index_ + i) * 7 + tid * 131) % kCallstackCount);
+        callstack_data_.AddCallstackEvent(event);
+      }
+    }
+    next_sample_index_ += sample_count_per_thread;
+  }
+
+  [[nodiscard]] const CaptureData& capture_data() const { return capture_data_; }
+  [[nodiscard]] const CallstackData& callstack_data() const { return callstack_data_; }
+
+ private:
+  static CaptureData CreateCaptureData(orbit_client_data::ModuleManager* module_manager) {
+    orbit_grpc_protos::ProcessInfo process_info;
+    process_info.set_pid(1);
+    return CaptureData{ProcessData{process_info}, module_manager, {}, {}, {}};
+  }
+
+  static uint64_t GetAddress(uint64_t function, uint64_t address_in_function) {
+    return (function + 1) * kFunctionSize + address_in_function;
+  }
+
+  orbit_client_data::ModuleManager module_manager_;
+  CaptureData capture_data_;
+  CallstackData callstack_data_;
+  uint64_t next_sample_index_ = 0;
+};
+
+std::unique_ptr<ThreadPool> CreateThreadPoolIfRequested(const benchmark::State& state) {
+  if (state.range(0) == 0) return nullptr;
+  return ThreadPool::Create(1, kThreadCount, absl::Seconds(1));
+}
+
+void BM_CreatePostProcessedSamplingData(benchmark::State& state) {
+  std::unique_ptr<ThreadPool> thread_pool = CreateThreadPoolIfRequested(state);
+  SyntheticCapture capture;
+  capture.AddSamples(kSampleCountPerThread);
+
+  for (auto _ : state) {
+    PostProcessedSamplingData data = orbit_client_model::CreatePostProcessedSamplingData(
+        capture.callstack_data(), capture.capture_data(), /*generate_summary=*/true,
+        thread_pool.get());
+    benchmark::DoNotOptimize(data);
+  }
+  state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * kSampleCount));
+
+  if (thread_pool != nullptr) thread_pool->ShutdownAndWait();
+}
+
+// Post-processes the samples of the last second after all previous samples were post-processed.
+void BM_ProcessNewSamples(benchmark::State& state) {
+  constexpr uint64_t kNewSampleCountPerThread = 1'000;
+  std::unique_ptr<ThreadPool> thread_pool = CreateThreadPoolIfRequested(state);
+  SyntheticCapture capture;
+  capture.AddSamples(kSampleCountPerThread);
+  orbit_client_model::SamplingDataPostProcessor processor{&capture.callstack_data(),
+                                                          thread_pool.get()};
+  benchmark::DoNotOptimize(processor.ProcessSamples(capture.capture_data()));
+
+  for (auto _ : state) {
+    state.PauseTiming();
+    capture.AddSamples(kNewSampleCountPerThread);
+    state.ResumeTiming();
+    PostProcessedSamplingData data = processor.ProcessSamples(capture.capture_data());
+    benchmark::DoNotOptimize(data);
+  }
+  state.SetItemsProcessed(
+      static_cast<int64_t>(state.iterations() * kNewSampleCountPerThread * kThreadCount));
+
+  if (thread_pool != nullptr) thread_pool->ShutdownAndWait();
+}
+
+}  // namespace
+
+BENCHMARK(BM_CreatePostProcessedSamplingData)
+    ->ArgName("thread_pool")
+    ->Arg(0)
+    ->Arg(1)
+    ->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_ProcessNewSamples)
+    ->ArgName("thread_pool")
+    ->Arg(0)
+    ->Arg(1)
+    ->Unit(benchmark::kMillisecond);
+
+BENCHMARK_MAIN();
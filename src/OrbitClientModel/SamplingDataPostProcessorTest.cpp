@@ -0,0 +1,272 @@
+// Copyright (c) 2021 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <absl/strings/str_format.h>
+#include <absl/time/time.h>
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "OrbitBase/ThreadConstants.h"
+#include "OrbitBase/ThreadPool.h"
+#include "OrbitClientData/Callstack.h"
+#include "OrbitClientData/CallstackData.h"
+#include "OrbitClientData/ModuleManager.h"
+#include "OrbitClientData/PostProcessedSamplingData.h"
+#include "OrbitClientData/ProcessData.h"
+#include "OrbitClientModel/CaptureData.h"
+#include "OrbitClientModel/SamplingDataPostProcessor.h"
+#include "capture_data.pb.h"
+#include "process.pb.h"
+
+using orbit_client_data::ModuleManager;
+using orbit_client_protos::CallstackEvent;
+using orbit_client_protos::LinuxAddressInfo;
+using ::testing::Pair;
+using ::testing::UnorderedElementsAre;
+using ::testing::UnorderedElementsAreArray;
+
+namespace orbit_client_model {
+
+namespace {
+
+constexpr int32_t kThreadId1 = 42;
+constexpr int32_t kThreadId2 = 43;
+
+// Two functions: addresses 0x100 and 0x108 are in the first, 0x200 is in the second.
+constexpr uint64_t kFunction1Address = 0x100;
+constexpr uint64_t kFunction2Address = 0x200;
+constexpr uint64_t kInnerAddress1 = 0x108;
+constexpr uint64_t kInnerAddress2 = 0x204;
+
+constexpr CallstackID kCallstackId1 = 1;  // kInnerAddress1 <- kFunction2Address
+constexpr CallstackID kCallstackId2 = 2;  // kFunction1Address <- kFunction2Address
+constexpr CallstackID kCallstackId3 = 3;  // kInnerAddress2 <- kFunction2Address
+constexpr CallstackID kCallstackId4 = 4;  // kFunction2Address <- kFunction1Address
+
+class SamplingDataPostProcessorTest : public ::testing::Test {
+ protected:
+  SamplingDataPostProcessorTest() : capture_data_{CreateCaptureData(&module_manager_)} {
+    AddAddressInfo(kFunction1Address, 0);
+    AddAddressInfo(kInnerAddress1, kInnerAddress1 - kFunction1Address);
+    AddAddressInfo(kFunction2Address, 0);
+
+    callstack_data_.AddUniqueCallStack(
+        CallStack{kCallstackId1, {kInnerAddress1, kFunction2Address}});
+    callstack_data_.AddUniqueCallStack(
+        CallStack{kCallstackId2, {kFunction1Address, kFunction2Address}});
+    callstack_data_.AddUniqueCallStack(
+        CallStack{kCallstackId3, {kInnerAddress2, kFunction2Address}});
+    callstack_data_.AddUniqueCallStack(
+        CallStack{kCallstackId4, {kFunction2Address, kFunction1Address}});
+  }
+
+  static CaptureData CreateCaptureData(ModuleManager* module_manager) {
+    orbit_grpc_protos::ProcessInfo process_info;
+    process_info.set_pid(1);
+    process_info.set_name("process");
+    return CaptureData{ProcessData{process_info}, module_manager, {}, {}, {}};
+  }
+
+  void AddAddressInfo(uint64_t absolute_address, uint64_t offset_in_function) {
+    LinuxAddressInfo address_info;
+    address_info.set_absolute_address(absolute_address);
+    address_info.set_offset_in_function(offset_in_function);
+    address_info.set_function_name(
+        absl::StrFormat("function_%#x", absolute_address - offset_in_function));
+    address_info.set_module_path("/path/to/module");
+    capture_data_.InsertAddressInfo(std::move(address_info));
+  }
+
+  void AddCallstackEvent(uint64_t time, int32_t thread_id, CallstackID callstack_id) {
+    CallstackEvent event;
+    event.set_time(time);
+    event.set_thread_id(thread_id);
+    event.set_callstack_id(callstack_id);
+    callstack_data_.AddCallstackEvent(std::move(event));
+  }
+
+  ModuleManager module_manager_;
+  CaptureData capture_data_;
+  CallstackData callstack_data_;
+};
+
+void ExpectSameThreadSampleData(const PostProcessedSamplingData& actual,
+                                const PostProcessedSamplingData& expected) {
+  ASSERT_EQ(actual.GetThreadSampleData().size(), expected.GetThreadSampleData().size());
+  for (const ThreadSampleData& expected_data : expected.GetThreadSampleData()) {
+    const ThreadSampleData* actual_data =
+        actual.GetThreadSampleDataByThreadId(expected_data.thread_id);
+    ASSERT_NE(actual_data, nullptr);
+    EXPECT_EQ(actual_data->samples_count, expected_data.samples_count);
+    EXPECT_EQ(actual_data->callstack_count, expected_data.callstack_count);
+    EXPECT_EQ(actual_data->raw_address_count, expected_data.raw_address_count);
+    EXPECT_EQ(actual_data->address_count, expected_data.address_count);
+    EXPECT_EQ(actual_data->exclusive_count, expected_data.exclusive_count);
+    // The order of addresses with the same count is unspecified.
+    EXPECT_THAT(actual_data->address_count_sorted,
+                UnorderedElementsAreArray(expected_data.address_count_sorted));
+    EXPECT_EQ(actual_data->sampled_function.size(), expected_data.sampled_function.size());
+  }
+}
+
+}  // namespace
+
+TEST_F(SamplingDataPostProcessorTest, CountsSamplesPerThreadAndFunction) {
+  AddCallstackEvent(1, kThreadId1, kCallstackId1);
+  AddCallstackEvent(2, kThreadId1, kCallstackId2);
+  AddCallstackEvent(3, kThreadId1, kCallstackId1);
+  AddCallstackEvent(4, kThreadId2, kCallstackId3);
+
+  PostProcessedSamplingData data =
+      CreatePostProcessedSamplingData(callstack_data_, capture_data_, /*generate_summary=*/true);
+
+  ASSERT_EQ(data.GetThreadSampleData().size(), 3);
+  // Sorted by number of samples.
+  EXPECT_EQ(data.GetThreadSampleData()[0].thread_id, orbit_base::kAllProcessThreadsTid);
+  EXPECT_EQ(data.GetThreadSampleData()[1].thread_id, kThreadId1);
+  EXPECT_EQ(data.GetThreadSampleData()[2].thread_id, kThreadId2);
+
+  const ThreadSampleData* thread_1_data = data.GetThreadSampleDataByThreadId(kThreadId1);
+  ASSERT_NE(thread_1_data, nullptr);
+  EXPECT_EQ(thread_1_data->samples_count, 3);
+  EXPECT_THAT(thread_1_data->callstack_count,
+              UnorderedElementsAre(Pair(kCallstackId1, 2), Pair(kCallstackId2, 1)));
+  EXPECT_THAT(thread_1_data->raw_address_count,
+              UnorderedElementsAre(Pair(kInnerAddress1, 2), Pair(kFunction1Address, 1),
+                                   Pair(kFunction2Address, 3)));
+  EXPECT_THAT(thread_1_data->exclusive_count, UnorderedElementsAre(Pair(kFunction1Address, 3)));
+  EXPECT_THAT(thread_1_data->address_count,
+              UnorderedElementsAre(Pair(kFunction1Address, 3), Pair(kFunction2Address, 3)));
+  ASSERT_EQ(thread_1_data->sampled_function.size(), 2);
+  EXPECT_EQ(thread_1_data->sampled_function[0].inclusive, 100.f);
+
+  const ThreadSampleData* thread_2_data = data.GetThreadSampleDataByThreadId(kThreadId2);
+  ASSERT_NE(thread_2_data, nullptr);
+  // kInnerAddress2 has no address info, so it is a function of its own.
+  EXPECT_THAT(thread_2_data->exclusive_count, UnorderedElementsAre(Pair(kInnerAddress2, 1)));
+
+  const ThreadSampleData* summary = data.GetSummary();
+  ASSERT_NE(summary, nullptr);
+  EXPECT_EQ(summary->samples_count, 4);
+  EXPECT_THAT(summary->address_count,
+              UnorderedElementsAre(Pair(kFunction1Address, 3), Pair(kFunction2Address, 4),
+                                   Pair(kInnerAddress2, 1)));
+
+  EXPECT_EQ(data.GetResolvedCallstack(kCallstackId1).id(),
+            data.GetResolvedCallstack(kCallstackId2).id());
+  EXPECT_EQ(data.GetCountOfFunction(kFunction1Address), 3);
+}
+
+TEST_F(SamplingDataPostProcessorTest, DoesNotGenerateSummaryIfNotRequested) {
+  AddCallstackEvent(1, kThreadId1, kCallstackId1);
+
+  PostProcessedSamplingData data =
+      CreatePostProcessedSamplingData(callstack_data_, capture_data_, /*generate_summary=*/false);
+
+  EXPECT_EQ(data.GetThreadSampleData().size(), 1);
+  EXPECT_EQ(data.GetSummary(), nullptr);
+}
+
+TEST_F(SamplingDataPostProcessorTest, IncrementalProcessingMatchesProcessingFromScratch) {
+  std::unique_ptr<ThreadPool> thread_pool = ThreadPool::Create(1, 4, absl::Seconds(1));
+  SamplingDataPostProcessor processor{&callstack_data_, thread_pool.get()};
+
+  AddCallstackEvent(10, kThreadId1, kCallstackId1);
+  AddCallstackEvent(11, kThreadId2, kCallstackId2);
+  ExpectSameThreadSampleData(processor.ProcessSamples(capture_data_),
+                             CreatePostProcessedSamplingData(callstack_data_, capture_data_));
+
+  // Appended events.
+  AddCallstackEvent(20, kThreadId1, kCallstackId2);
+  AddCallstackEvent(21, kThreadId1, kCallstackId3);
+  ExpectSameThreadSampleData(processor.ProcessSamples(capture_data_),
+                             CreatePostProcessedSamplingData(callstack_data_, capture_data_));
+
+  // An event earlier than the events of the thread already counted.
+  AddCallstackEvent(5, kThreadId1, kCallstackId3);
+  AddCallstackEvent(30, kThreadId2, kCallstackId1);
+  PostProcessedSamplingData data = processor.ProcessSamples(capture_data_);
+  ExpectSameThreadSampleData(data, CreatePostProcessedSamplingData(callstack_data_, capture_data_));
+  EXPECT_EQ(data.GetThreadSampleDataByThreadId(kThreadId1)->samples_count, 4);
+
+  // Nothing new.
+  ExpectSameThreadSampleData(processor.ProcessSamples(capture_data_),
+                             CreatePostProcessedSamplingData(callstack_data_, capture_data_));
+
+  thread_pool->ShutdownAndWait();
+}
+
+TEST_F(SamplingDataPostProcessorTest, RecountsThreadsWithRemovedEvents) {
+  SamplingDataPostProcessor processor{&callstack_data_};
+  AddCallstackEvent(1, kThreadId1, kCallstackId1);
+  AddCallstackEvent(2, kThreadId1, kCallstackId1);
+  AddCallstackEvent(3, kThreadId1, kCallstackId4);
+  EXPECT_EQ(processor.ProcessSamples(capture_data_).GetSummary()->samples_count, 3);
+
+  // Removes the event with an outermost frame different from the majority's.
+  callstack_data_.FilterCallstackEventsBasedOnMajorityStart();
+
+  PostProcessedSamplingData data = processor.ProcessSamples(capture_data_);
+  EXPECT_EQ(data.GetSummary()->samples_count, 2);
+  ExpectSameThreadSampleData(data, CreatePostProcessedSamplingData(callstack_data_, capture_data_));
+}
+
+TEST_F(SamplingDataPostProcessorTest, CountsLateEventsWhenAsManyEventsWereRemoved) {
+  SamplingDataPostProcessor processor{&callstack_data_};
+  AddCallstackEvent(10, kThreadId1, kCallstackId1);
+  AddCallstackEvent(20, kThreadId1, kCallstackId1);
+  AddCallstackEvent(30, kThreadId1, kCallstackId4);
+  EXPECT_EQ(processor.ProcessSamples(capture_data_).GetSummary()->samples_count, 3);
+
+  // The thread has as many events as were counted, but not the same ones.
+  callstack_data_.FilterCallstackEventsBasedOnMajorityStart();
+  AddCallstackEvent(5, kThreadId1, kCallstackId2);
+
+  PostProcessedSamplingData data = processor.ProcessSamples(capture_data_);
+  EXPECT_THAT(data.GetThreadSampleDataByThreadId(kThreadId1)->callstack_count,
+              UnorderedElementsAre(Pair(kCallstackId1, 2), Pair(kCallstackId2, 1)));
+  ExpectSameThreadSampleData(data, CreatePostProcessedSamplingData(callstack_data_, capture_data_));
+}
+
+TEST_F(SamplingDataPostProcessorTest, RecountsThreadsWithReplacedEvents) {
+  SamplingDataPostProcessor processor{&callstack_data_};
+  AddCallstackEvent(10, kThreadId1, kCallstackId1);
+  AddCallstackEvent(20, kThreadId1, kCallstackId1);
+  EXPECT_EQ(processor.ProcessSamples(capture_data_).GetSummary()->samples_count, 2);
+
+  // Replaces the callstack of the last event.
+  AddCallstackEvent(20, kThreadId1, kCallstackId2);
+
+  PostProcessedSamplingData data = processor.ProcessSamples(capture_data_);
+  EXPECT_THAT(data.GetThreadSampleDataByThreadId(kThreadId1)->callstack_count,
+              UnorderedElementsAre(Pair(kCallstackId1, 1), Pair(kCallstackId2, 1)));
+  ExpectSameThreadSampleData(data, CreatePostProcessedSamplingData(callstack_data_, capture_data_));
+}
+
+TEST_F(SamplingDataPostProcessorTest, ClearResolvedAddressesUsesNewAddressInfos) {
+  SamplingDataPostProcessor processor{&callstack_data_};
+  AddCallstackEvent(1, kThreadId1, kCallstackId3);
+  EXPECT_THAT(processor.ProcessSamples(capture_data_).GetSummary()->exclusive_count,
+              UnorderedElementsAre(Pair(kInnerAddress2, 1)));
+
+  AddAddressInfo(kInnerAddress2, kInnerAddress2 - kFunction2Address);
+  // Resolved addresses are memoized...
+  EXPECT_THAT(processor.ProcessSamples(capture_data_).GetSummary()->exclusive_count,
+              UnorderedElementsAre(Pair(kInnerAddress2, 1)));
+
+  // ...until they are cleared.
+  processor.ClearResolvedAddresses();
+  PostProcessedSamplingData data = processor.ProcessSamples(capture_data_);
+  EXPECT_THAT(data.GetSummary()->exclusive_count,
+              UnorderedElementsAre(Pair(kFunction2Address, 1)));
+  ASSERT_EQ(data.GetSummary()->sampled_function.size(), 1);
+  EXPECT_EQ(data.GetSummary()->sampled_function[0].name, "function_0x200");
+}
+
+}  // namespace orbit_client_model
@@ -8,6 +8,7 @@
 #include <absl/container/flat_hash_map.h>
 #include <absl/container/flat_hash_set.h>
 #include <absl/synchronization/mutex.h>
+#include <absl/types/span.h>
 
 #include <algorithm>
 #include <chrono>
@@ -21,6 +22,7 @@
 #include <vector>
 
 #include "OrbitBase/Logging.h"
+#include "OrbitClientData/AddressRangeIndex.h"
 #include "OrbitClientData/Callstack.h"
 #include "OrbitClientData/CallstackData.h"
 #include "OrbitClientData/FunctionInfoSet.h"
@@ -28,6 +30,8 @@
 #include "OrbitClientData/ModuleManager.h"
 #include "OrbitClientData/PostProcessedSamplingData.h"
 #include "OrbitClientData/ProcessData.h"
+#include "OrbitClientData/QuantileSketch.h"
+#include "OrbitClientData/ThreadStateSliceData.h"
 #include "OrbitClientData/TracepointCustom.h"
 #include "OrbitClientData/TracepointData.h"
 #include "capture_data.pb.h"
@@ -43,12 +47,16 @@ class CaptureData {
       absl::flat_hash_set<uint64_t> frame_track_function_ids)
       : process_(std::move(process)),
         module_manager_(module_manager),
+        loaded_modules_{CreateLoadedModuleIndex(process_, module_manager_)},
         instrumented_functions_{std::move(instrumented_functions)},
         selected_tracepoints_{std::move(selected_tracepoints)},
         callstack_data_(std::make_unique<CallstackData>()),
         selection_callstack_data_(std::make_unique<CallstackData>()),
         tracepoint_data_(std::make_unique<TracepointData>()),
-        frame_track_function_ids_(std::move(frame_track_function_ids)) {}
+        thread_state_slice_data_(std::make_unique<ThreadStateSliceData>()),
+        frame_track_function_ids_(std::move(frame_track_function_ids)) {
+    InitializeFunctionStats();
+  }
 
   // We can not copy the unique_ptr, so we can not copy this object.
   CaptureData& operator=(const CaptureData& other) = delete;
@@ -96,6 +104,13 @@ class CaptureData {
   [[nodiscard]] const orbit_client_protos::FunctionInfo* FindFunctionByAddress(
       uint64_t absolute_address, bool is_exact) const;
   [[nodiscard]] ModuleData* FindModuleByAddress(uint64_t absolute_address) const;
+
+  // Batch versions of the lookups above, e.g., for all the frames of a callstack at once. The
+  // returned pointers are never null and refer to the same strings that the lookups above return.
+  [[nodiscard]] std::vector<const std::string*> GetFunctionNamesByAddresses(
+      absl::Span<const uint64_t> absolute_addresses) const;
+  [[nodiscard]] std::vector<const std::string*> GetModulePathsByAddresses(
+      absl::Span<const uint64_t> absolute_addresses) const;
   [[nodiscard]] uint64_t GetAbsoluteAddress(
       const orbit_client_protos::FunctionInfo& function) const;
 
@@ -115,37 +130,38 @@ class CaptureData {
     thread_names_.insert_or_assign(thread_id, std::move(thread_name));
   }
 
-  [[nodiscard]] const absl::flat_hash_map<int32_t,
-                                          std::vector<orbit_client_protos::ThreadStateSliceInfo>>&
-  thread_state_slices() const {
-    return thread_state_slices_;
-  }
-
   [[nodiscard]] bool HasThreadStatesForThread(int32_t tid) const {
-    absl::MutexLock lock{thread_state_slices_mutex_.get()};
-    return thread_state_slices_.count(tid) > 0;
+    return thread_state_slice_data_->HasSlicesOfTid(tid);
   }
 
   void AddThreadStateSlice(orbit_client_protos::ThreadStateSliceInfo state_slice) {
-    absl::MutexLock lock{thread_state_slices_mutex_.get()};
-    thread_state_slices_[state_slice.tid()].emplace_back(std::move(state_slice));
+    thread_state_slice_data_->AddSlice(state_slice);
+  }
+
+  // Iterates over the thread state slices of all threads, one thread after the other.
+  void ForEachThreadStateSlice(
+      const std::function<void(const orbit_client_protos::ThreadStateSliceInfo&)>& action) const {
+    thread_state_slice_data_->ForEachSlice(action);
   }
 
-  // Allows the caller to iterate `action` over all the thread state slices of the specified thread
-  // in the time range while holding for the whole time the internal mutex, acquired only once.
+  // Iterates `action` over the thread state slices of the specified thread in the time range,
+  // without blocking the thread that adds slices (see ThreadStateSliceData).
   void ForEachThreadStateSliceIntersectingTimeRange(
       int32_t thread_id, uint64_t min_timestamp, uint64_t max_timestamp,
-      const std::function<void(const orbit_client_protos::ThreadStateSliceInfo&)>& action) const;
-
-  [[nodiscard]] const FunctionInfoMap<orbit_client_protos::FunctionStats>& functions_stats() const {
-    return functions_stats_;
+      const std::function<void(const orbit_client_protos::ThreadStateSliceInfo&)>& action) const {
+    thread_state_slice_data_->ForEachSliceOfTidIntersectingTimeRange(thread_id, min_timestamp,
+                                                                     max_timestamp, action);
   }
 
+  // The statistics of the calls to an instrumented function, by the id of the function.
   [[nodiscard]] const orbit_client_protos::FunctionStats& GetFunctionStatsOrDefault(
-      const orbit_client_protos::FunctionInfo& function) const;
+      uint64_t instrumented_function_id) const;
+  // Allows estimating percentiles of the durations of the calls to an instrumented function. The
+  // sketch can be queried while UpdateFunctionStats is called on another thread.
+  [[nodiscard]] const orbit_client_data::QuantileSketch& GetFunctionDurationSketchOrDefault(
+      uint64_t instrumented_function_id) const;
 
-  void UpdateFunctionStats(const orbit_client_protos::FunctionInfo& function,
-                           uint64_t elapsed_nanos);
+  void UpdateFunctionStats(uint64_t instrumented_function_id, uint64_t elapsed_nanos);
 
   [[nodiscard]] const CallstackData* GetCallstackData() const { return callstack_data_.get(); };
 
@@ -220,8 +236,31 @@ class CaptureData {
   }
 
  private:
+  struct LoadedModule {
+    std::string module_path;
+    uint64_t module_base_address;
+    // Null if the module was not in the ModuleManager yet when this object was created.
+    ModuleData* module_data;
+  };
+
+  [[nodiscard]] static orbit_client_data::AddressRangeIndex<LoadedModule> CreateLoadedModuleIndex(
+      const ProcessData& process, orbit_client_data::ModuleManager* module_manager);
+  [[nodiscard]] ModuleData* GetModuleData(const LoadedModule& loaded_module) const;
+  void InitializeFunctionStats();
+  [[nodiscard]] std::optional<size_t> GetFunctionStatsIndex(
+      uint64_t instrumented_function_id) const;
+  [[nodiscard]] const orbit_client_protos::FunctionInfo* FindFunctionInLoadedModule(
+      const LoadedModule* loaded_module, uint64_t absolute_address, bool is_exact) const;
+  [[nodiscard]] const std::string& GetFunctionNameInLoadedModule(const LoadedModule* loaded_module,
+                                                                 uint64_t absolute_address) const;
+  [[nodiscard]] const std::string& GetModulePathOfLoadedModule(const LoadedModule* loaded_module,
+                                                               uint64_t absolute_address) const;
+
   ProcessData process_;
   orbit_client_data::ModuleManager* module_manager_;
+  // The modules in the memory map of process_, which does not change after construction, indexed
+  // by address.
+  orbit_client_data::AddressRangeIndex<LoadedModule> loaded_modules_;
   absl::flat_hash_map<uint64_t, orbit_client_protos::FunctionInfo> instrumented_functions_;
 
   TracepointInfoSet selected_tracepoints_;
@@ -237,13 +276,16 @@ class CaptureData {
 
   absl::flat_hash_map<uint64_t, orbit_client_protos::LinuxAddressInfo> address_infos_;
 
-  FunctionInfoMap<orbit_client_protos::FunctionStats> functions_stats_;
+  // Indexed by instrumented function id if the ids are dense, as when assigned by the client when
+  // starting a capture, or else by the position of the id in sparse_function_ids_.
+  std::vector<orbit_client_protos::FunctionStats> functions_stats_;
+  // The sketches are read by the UI while UpdateFunctionStats adds to them, see QuantileSketch.
+  std::vector<std::unique_ptr<orbit_client_data::QuantileSketch>> functions_duration_sketches_;
+  std::vector<uint64_t> sparse_function_ids_;
 
   absl::flat_hash_map<int32_t, std::string> thread_names_;
 
-  absl::flat_hash_map<int32_t, std::vector<orbit_client_protos::ThreadStateSliceInfo>>
-      thread_state_slices_;  // For each thread, assume sorted by timestamp and not overlapping.
-  mutable std::unique_ptr<absl::Mutex> thread_state_slices_mutex_ = std::make_unique<absl::Mutex>();
+  std::unique_ptr<ThreadStateSliceData> thread_state_slice_data_;
 
   std::chrono::system_clock::time_point capture_start_time_ = std::chrono::system_clock::now();
 
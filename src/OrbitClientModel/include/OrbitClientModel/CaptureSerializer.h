@@ -57,7 +57,8 @@ void Save(google::protobuf::io::CodedOutputStream* coded_output, const CaptureDa
 
   // Timers
   for (auto it = timers_iterator_begin; it != timers_iterator_end; ++it) {
-    WriteMessage(&(*it), coded_output);
+    const orbit_client_protos::TimerInfo& timer_info = *it;
+    WriteMessage(&timer_info, coded_output);
   }
 }
 
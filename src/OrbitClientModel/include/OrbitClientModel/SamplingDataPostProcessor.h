@@ -5,14 +5,103 @@
 #ifndef ORBIT_CLIENT_MODEL_SAMPLING_DATA_POST_PROCESSOR_H_
 #define ORBIT_CLIENT_MODEL_SAMPLING_DATA_POST_PROCESSOR_H_
 
+#include <cstdint>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "OrbitBase/ThreadPool.h"
+#include "OrbitClientData/Callstack.h"
 #include "OrbitClientData/CallstackData.h"
+#include "OrbitClientData/CallstackTypes.h"
 #include "OrbitClientData/PostProcessedSamplingData.h"
 #include "OrbitClientModel/CaptureData.h"
+#include "absl/container/flat_hash_map.h"
+#include "absl/container/flat_hash_set.h"
 
 namespace orbit_client_model {
+
+// Post-processes the callstack events of one CallstackData, which must outlive this object.
+//
+// The per-thread sample counts are kept between calls to ProcessSamples, so that only the callstack
+// events added since the previous call are counted, e.g., while a capture is still running. If
+// events of a thread were removed, replaced, or added with a timestamp not later than its last
+// event, which CallstackData keeps track of per thread, the counts of that thread are recomputed
+// from scratch. The resolution of sampled addresses to functions is memoized as well, until
+// ClearResolvedAddresses is called.
+//
+// Counting and aggregating samples is partitioned by thread across `thread_pool`, if not null.
+// ProcessSamples must not be called concurrently on the same object.
+class SamplingDataPostProcessor {
+ public:
+  explicit SamplingDataPostProcessor(const CallstackData* callstack_data,
+                                     ThreadPool* thread_pool = nullptr);
+
+  SamplingDataPostProcessor(const SamplingDataPostProcessor& other) = delete;
+  SamplingDataPostProcessor& operator=(const SamplingDataPostProcessor& other) = delete;
+  SamplingDataPostProcessor(SamplingDataPostProcessor&& other) = default;
+  SamplingDataPostProcessor& operator=(SamplingDataPostProcessor&& other) = default;
+
+  [[nodiscard]] PostProcessedSamplingData ProcessSamples(const CaptureData& capture_data,
+                                                         bool generate_summary = true);
+
+  // Forgets how addresses were resolved to functions, e.g., because symbols were loaded since.
+  void ClearResolvedAddresses();
+
+ private:
+  struct ThreadSampleCounts {
+    absl::flat_hash_map<CallstackID, uint32_t> callstack_count;
+    absl::flat_hash_map<uint64_t, uint32_t> raw_address_count;
+    uint32_t samples_count = 0;
+    uint64_t max_counted_timestamp_ns = 0;
+    // CallstackData::GetCallstackEventsOfTidOutOfOrderModificationCount when the counts were last
+    // updated.
+    uint64_t out_of_order_modification_count = 0;
+    // The counts of callstacks counted since the counts of resolved callstacks below were updated.
+    absl::flat_hash_map<CallstackID, uint32_t> new_callstack_count;
+    absl::flat_hash_map<uint64_t, uint32_t> address_count;
+    absl::flat_hash_map<uint64_t, uint32_t> exclusive_count;
+  };
+
+  struct FunctionDescription {
+    std::string name;
+    std::string module_path;
+    std::string file;
+    int line = 0;
+  };
+
+  void CountNewSamples();
+  void CountNewSamplesOfThread(ThreadID thread_id, ThreadSampleCounts* counts) const;
+  void ResolveNewCallstacks(const CaptureData& capture_data);
+  void MapAddressToFunctionAddress(uint64_t absolute_address, const CaptureData& capture_data);
+  void AddResolvedCounts(const absl::flat_hash_map<CallstackID, uint32_t>& callstack_count,
+                         ThreadSampleCounts* counts) const;
+  void DescribeNewFunctions(
+      const absl::flat_hash_map<ThreadID, ThreadSampleData>& thread_id_to_sample_data,
+      const CaptureData& capture_data);
+  void FillSampledFunctions(ThreadSampleData* thread_sample_data) const;
+
+  const CallstackData* callstack_data_;
+  ThreadPool* thread_pool_;
+
+  // Kept across calls to ProcessSamples.
+  absl::flat_hash_map<ThreadID, ThreadSampleCounts> thread_id_to_counts_;
+
+  // Memoized until ClearResolvedAddresses is called.
+  absl::flat_hash_map<CallstackID, CallStack> unique_resolved_callstacks_;
+  absl::flat_hash_map<std::vector<uint64_t>, CallstackID> unique_resolved_callstacks_to_id_;
+  absl::flat_hash_map<CallstackID, CallstackID> original_to_resolved_callstack_;
+  absl::flat_hash_map<uint64_t, std::set<CallstackID>> function_address_to_callstack_;
+  absl::flat_hash_map<uint64_t, uint64_t> exact_address_to_function_address_;
+  absl::flat_hash_map<uint64_t, absl::flat_hash_set<uint64_t>> function_address_to_exact_addresses_;
+  absl::flat_hash_map<uint64_t, FunctionDescription> function_address_to_description_;
+  bool resolved_counts_outdated_ = false;
+};
+
 PostProcessedSamplingData CreatePostProcessedSamplingData(const CallstackData& callstack_data,
                                                           const CaptureData& capture_data,
-                                                          bool generate_summary = true);
+                                                          bool generate_summary = true,
+                                                          ThreadPool* thread_pool = nullptr);
 }  // namespace orbit_client_model
 
 #endif  // ORBIT_CLIENT_MODEL_SAMPLING_DATA_POST_PROCESSOR_H_
@@ -25,6 +25,7 @@
 #include <cstdint>
 #include <exception>
 #include <memory>
+#include <optional>
 #include <outcome.hpp>
 #include <ratio>
 #include <string>
@@ -222,8 +223,7 @@ void OrbitApp::OnCaptureStarted(ProcessData&& process,
 void OrbitApp::OnCaptureComplete() {
   GetMutableCaptureData().FilterBrokenCallstacks();
   PostProcessedSamplingData post_processed_sampling_data =
-      orbit_client_model::CreatePostProcessedSamplingData(*GetCaptureData().GetCallstackData(),
-                                                          GetCaptureData());
+      PostProcessCaptureSamples(/*symbols_changed=*/false);
 
   main_thread_executor_->Schedule(
       [this, sampling_profiler = std::move(post_processed_sampling_data)]() mutable {
@@ -274,7 +274,7 @@ void OrbitApp::OnTimer(const TimerInfo& timer_info) {
   CaptureData& capture_data = GetMutableCaptureData();
   const FunctionInfo& func = capture_data.instrumented_functions().at(timer_info.function_id());
   uint64_t elapsed_nanos = timer_info.end() - timer_info.start();
-  capture_data.UpdateFunctionStats(func, elapsed_nanos);
+  capture_data.UpdateFunctionStats(timer_info.function_id(), elapsed_nanos);
   GetMutableTimeGraph()->ProcessTimer(timer_info, &func);
   frame_track_online_processor_.ProcessTimer(timer_info, func);
 }
@@ -994,6 +994,10 @@ void OrbitApp::ClearCapture() {
   if (capture_window_ != nullptr) {
     capture_window_->ClearTimeGraph();
   }
+  {
+    absl::MutexLock lock(&sampling_data_post_processor_mutex_);
+    sampling_data_post_processor_.reset();
+  }
   capture_data_.reset();
 
   string_manager_.Clear();
@@ -1009,6 +1013,18 @@ void OrbitApp::ClearCapture() {
   FireRefreshCallbacks();
 }
 
+PostProcessedSamplingData OrbitApp::PostProcessCaptureSamples(bool symbols_changed) {
+  absl::MutexLock lock(&sampling_data_post_processor_mutex_);
+  if (sampling_data_post_processor_ == nullptr) {
+    sampling_data_post_processor_ =
+        std::make_unique<orbit_client_model::SamplingDataPostProcessor>(
+            GetCaptureData().GetCallstackData(), thread_pool_.get());
+  } else if (symbols_changed) {
+    sampling_data_post_processor_->ClearResolvedAddresses();
+  }
+  return sampling_data_post_processor_->ProcessSamples(GetCaptureData());
+}
+
 void OrbitApp::ToggleDrawHelp() {
   if (capture_window_ != nullptr) {
     capture_window_->ToggleDrawHelp();
@@ -1717,22 +1733,21 @@ const TextBox* OrbitApp::selected_text_box() const { return data_manager_->selec
 
 void OrbitApp::SelectTextBox(const TextBox* text_box) {
   data_manager_->set_selected_text_box(text_box);
-  const TimerInfo* timer_info = text_box ? &text_box->GetTimerInfo() : nullptr;
+  std::optional<TimerInfo> timer_info;
+  if (text_box != nullptr) timer_info = text_box->GetTimerInfo();
   uint64_t function_id =
-      timer_info ? timer_info->function_id() : orbit_grpc_protos::kInvalidFunctionId;
+      timer_info.has_value() ? timer_info->function_id() : orbit_grpc_protos::kInvalidFunctionId;
   data_manager_->set_highlighted_function_id(function_id);
   CHECK(timer_selected_callback_);
-  timer_selected_callback_(timer_info);
+  timer_selected_callback_(timer_info.has_value() ? &timer_info.value() : nullptr);
 }
 
 void OrbitApp::DeselectTextBox() { data_manager_->set_selected_text_box(nullptr); }
 
 uint64_t OrbitApp::GetFunctionIdToHighlight() const {
   const TextBox* selected_textbox = selected_text_box();
-  const TimerInfo* selected_timer_info =
-      selected_textbox ? &selected_textbox->GetTimerInfo() : nullptr;
   uint64_t selected_function_id =
-      selected_timer_info ? selected_timer_info->function_id() : highlighted_function_id();
+      selected_textbox ? selected_textbox->GetFunctionId() : highlighted_function_id();
 
   // Highlighting of manually instrumented scopes is not yet supported.
   const FunctionInfo* function_info = GetInstrumentedFunction(selected_function_id);
@@ -1757,7 +1772,8 @@ void OrbitApp::SelectCallstackEvents(const std::vector<CallstackEvent>& selected
   bool generate_summary = thread_id == orbit_base::kAllProcessThreadsTid;
   PostProcessedSamplingData processed_sampling_data =
       orbit_client_model::CreatePostProcessedSamplingData(
-          *GetCaptureData().GetSelectionCallstackData(), GetCaptureData(), generate_summary);
+          *GetCaptureData().GetSelectionCallstackData(), GetCaptureData(), generate_summary,
+          thread_pool_.get());
 
   SetSelectionTopDownView(processed_sampling_data, GetCaptureData());
   SetSelectionBottomUpView(processed_sampling_data, GetCaptureData());
@@ -1775,8 +1791,7 @@ void OrbitApp::UpdateAfterSymbolLoading() {
 
   if (sampling_report_ != nullptr) {
     PostProcessedSamplingData post_processed_sampling_data =
-        orbit_client_model::CreatePostProcessedSamplingData(*capture_data.GetCallstackData(),
-                                                            capture_data);
+        PostProcessCaptureSamples(/*symbols_changed=*/true);
     sampling_report_->UpdateReport(post_processed_sampling_data,
                                    capture_data.GetCallstackData()->GetUniqueCallstacksCopy());
     GetMutableCaptureData().set_post_processed_sampling_data(post_processed_sampling_data);
@@ -1791,7 +1806,8 @@ void OrbitApp::UpdateAfterSymbolLoading() {
   PostProcessedSamplingData selection_post_processed_sampling_data =
       orbit_client_model::CreatePostProcessedSamplingData(*capture_data.GetSelectionCallstackData(),
                                                           capture_data,
-                                                          selection_report_->has_summary());
+                                                          selection_report_->has_summary(),
+                                                          thread_pool_.get());
 
   SetSelectionTopDownView(selection_post_processed_sampling_data, capture_data);
   SetSelectionBottomUpView(selection_post_processed_sampling_data, capture_data);
@@ -1952,7 +1968,7 @@ void OrbitApp::AddFrameTrack(uint64_t instrumented_function_id) {
   // track actually has hits in the capture data. Otherwise we can end up in inconsistent
   // states where "empty" frame tracks exist in the capture data (which would also be
   // serialized).
-  const FunctionStats& stats = GetCaptureData().GetFunctionStatsOrDefault(*function);
+  const FunctionStats& stats = GetCaptureData().GetFunctionStatsOrDefault(instrumented_function_id);
   if (stats.count() > 1) {
     frame_track_online_processor_.AddFrameTrack(instrumented_function_id);
     GetMutableCaptureData().EnableFrameTrack(instrumented_function_id);
@@ -2021,7 +2037,7 @@ void OrbitApp::AddFrameTrackTimers(uint64_t instrumented_function_id) {
   const FunctionInfo* function =
       GetCaptureData().GetInstrumentedFunctionById(instrumented_function_id);
   CHECK(function != nullptr);
-  const FunctionStats& stats = GetCaptureData().GetFunctionStatsOrDefault(*function);
+  const FunctionStats& stats = GetCaptureData().GetFunctionStatsOrDefault(instrumented_function_id);
   if (stats.count() == 0) {
     return;
   }
@@ -2035,8 +2051,8 @@ void OrbitApp::AddFrameTrackTimers(uint64_t instrumented_function_id) {
     for (const TimerBlock& block : *chain) {
       for (uint64_t i = 0; i < block.size(); ++i) {
         const TextBox& box = block[i];
-        if (box.GetTimerInfo().function_id() == instrumented_function_id) {
-          all_start_times.push_back(box.GetTimerInfo().start());
+        if (box.GetFunctionId() == instrumented_function_id) {
+          all_start_times.push_back(box.Start());
         }
       }
     }
@@ -7,6 +7,7 @@
 
 #include <absl/container/flat_hash_map.h>
 #include <absl/container/flat_hash_set.h>
+#include <absl/synchronization/mutex.h>
 #include <absl/types/span.h>
 #include <grpc/impl/codegen/connectivity_state.h>
 #include <grpcpp/channel.h>
@@ -59,6 +60,7 @@
 #include "OrbitClientData/TracepointCustom.h"
 #include "OrbitClientData/UserDefinedCaptureData.h"
 #include "OrbitClientModel/CaptureData.h"
+#include "OrbitClientModel/SamplingDataPostProcessor.h"
 #include "OrbitClientServices/CrashManager.h"
 #include "OrbitClientServices/ProcessManager.h"
 #include "OrbitClientServices/TracepointServiceClient.h"
@@ -446,6 +448,9 @@ class OrbitApp final : public DataViewFactory, public CaptureListener {
   void OnCaptureCancelled();
   void OnCaptureComplete();
 
+  // Post-processes the samples of the capture, only counting those added since the previous call.
+  [[nodiscard]] PostProcessedSamplingData PostProcessCaptureSamples(bool symbols_changed);
+
   void RequestUpdatePrimitives();
 
   std::atomic<bool> capture_loading_cancellation_requested_ = false;
@@ -521,6 +526,11 @@ class OrbitApp final : public DataViewFactory, public CaptureListener {
   //  Currently, it is not properly synchronized (and thus it can't live at DataManager).
   std::optional<CaptureData> capture_data_;
 
+  // Keeps the sample counts of capture_data_ between the post-processings of its samples.
+  absl::Mutex sampling_data_post_processor_mutex_;
+  std::unique_ptr<orbit_client_model::SamplingDataPostProcessor> sampling_data_post_processor_
+      ABSL_GUARDED_BY(sampling_data_post_processor_mutex_);
+
   orbit_gl::FrameTrackOnlineProcessor frame_track_online_processor_;
 
   const orbit_base::CrashHandler* crash_handler_;
@@ -48,7 +48,7 @@ AsyncTrack::AsyncTrack(TimeGraph* time_graph, TimeGraphLayout* layout, const std
   // Orbit.h. Use it to retrieve the module from which the manually instrumented scope originated.
   const FunctionInfo* func =
       capture_data_
-          ? capture_data_->GetInstrumentedFunctionById(text_box->GetTimerInfo().function_id())
+          ? capture_data_->GetInstrumentedFunctionById(text_box->GetFunctionId())
           : nullptr;
   CHECK(func || timer_info.type() == TimerInfo::kIntrospection);
   std::string module_name =
@@ -64,7 +64,7 @@ AsyncTrack::AsyncTrack(TimeGraph* time_graph, TimeGraphLayout* layout, const std
       "<b>Time:</b> %s",
       function_name, module_name,
       GetPrettyTime(
-          TicksToDuration(text_box->GetTimerInfo().start(), text_box->GetTimerInfo().end())));
+          TicksToDuration(text_box->Start(), text_box->End())));
 }
 
 void AsyncTrack::UpdateBoxHeight() {
@@ -94,29 +94,25 @@ void AsyncTrack::OnTimer(const orbit_client_protos::TimerInfo& timer_info) {
 }
 
 void AsyncTrack::SetTimesliceText(const TimerInfo& timer_info, double elapsed_us, float min_x,
-                                  float z_offset, TextBox* text_box) {
+                                  float z_offset, const Vec2& box_pos, const Vec2& box_size) {
   std::string time = GetPrettyTime(absl::Microseconds(elapsed_us));
-  text_box->SetElapsedTimeTextLength(time.length());
 
   orbit_api::Event event = ManualInstrumentationManager::ApiEventFromTimerInfo(timer_info);
   const uint64_t event_id = event.data;
   std::string name = app_->GetManualInstrumentationManager()->GetString(event_id);
   std::string text = absl::StrFormat("%s %s", name, time.c_str());
-  text_box->SetText(text);
 
   const Color kTextWhite(255, 255, 255, 255);
-  const Vec2& box_pos = text_box->GetPos();
-  const Vec2& box_size = text_box->GetSize();
   float pos_x = std::max(box_pos[0], min_x);
   float max_size = box_pos[0] + box_size[0] - pos_x;
-  text_renderer_->AddTextTrailingCharsPrioritized(
-      text_box->GetText().c_str(), pos_x, text_box->GetPos()[1] + layout_->GetTextOffset(),
-      GlCanvas::kZValueBox + z_offset, kTextWhite, text_box->GetElapsedTimeTextLength(),
-      layout_->CalculateZoomedFontSize(), max_size);
+  time_graph_->GetPrimitivesTextRenderer()->AddTextTrailingCharsPrioritized(
+      text.c_str(), pos_x, box_pos[1] + layout_->GetTextOffset(), GlCanvas::kZValueBox + z_offset,
+      kTextWhite, time.length(), layout_->CalculateZoomedFontSize(), max_size);
 }
 
 Color AsyncTrack::GetTimerColor(const TimerInfo& timer_info, bool is_selected,
-                                bool is_highlighted) const {
+                                bool is_highlighted,
+                                const internal::DrawData& draw_data) const {
   const Color kInactiveColor(100, 100, 100, 255);
   const Color kSelectionColor(0, 128, 255, 255);
   if (is_highlighted) {
@@ -125,7 +121,7 @@ Color AsyncTrack::GetTimerColor(const TimerInfo& timer_info, bool is_selected,
   if (is_selected) {
     return kSelectionColor;
   }
-  if (!IsTimerActive(timer_info)) {
+  if (!IsTimerActive(timer_info, draw_data)) {
     return kInactiveColor;
   }
 
@@ -35,9 +35,10 @@ class AsyncTrack final : public TimerTrack {
 
  protected:
   void SetTimesliceText(const orbit_client_protos::TimerInfo& timer, double elapsed_us, float min_x,
-                        float z_offset, TextBox* text_box) override;
+                        float z_offset, const Vec2& box_pos, const Vec2& box_size) override;
   [[nodiscard]] Color GetTimerColor(const orbit_client_protos::TimerInfo& timer_info,
-                                    bool is_selected, bool is_highlighted) const override;
+                                    bool is_selected, bool is_highlighted,
+                                    const internal::DrawData& draw_data) const override;
 
   // Used for determining what row can receive a new timer with no overlap.
   absl::flat_hash_map<uint32_t, uint64_t> max_span_time_by_depth_;
@@ -0,0 +1,173 @@
+// Copyright (c) 2021 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef ORBIT_GL_BACKGROUND_FRAME_GENERATOR_H_
+#define ORBIT_GL_BACKGROUND_FRAME_GENERATOR_H_
+
+#include <absl/synchronization/mutex.h>
+
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <string>
+#include <thread>
+#include <utility>
+
+#include "OrbitBase/Logging.h"
+#include "OrbitBase/ThreadUtils.h"
+
+// Generates frames on a dedicated thread, double buffered: the front frame is the last complete
+// frame and is only accessed by the thread that draws, while the next frame is generated into the
+// back frame. A complete back frame becomes the front frame on the next call to
+// SwapFramesIfReady, and no other frame is generated until then.
+//
+// Requesting a new frame replaces the request that was not started yet, and cancels the generation
+// in progress, as its result would already be outdated. So that frames are still completed while
+// new ones keep being requested, e.g., while panning, a generation that follows a canceled one is
+// not canceled itself.
+template <typename Frame>
+class BackgroundFrameGenerator {
+ public:
+  using IsCanceledFunction = std::function<bool()>;
+  // Generates the content of `frame`, which holds the content of an older frame. Should return
+  // early when `is_canceled` returns true, in which case the frame is discarded.
+  using GenerateFunction = std::function<void(Frame* frame, const IsCanceledFunction& is_canceled)>;
+
+  explicit BackgroundFrameGenerator(std::string thread_name, std::unique_ptr<Frame> front_frame,
+                                    std::unique_ptr<Frame> back_frame)
+      : front_frame_{std::move(front_frame)},
+        back_frame_{std::move(back_frame)},
+        thread_{[this, thread_name = std::move(thread_name)] { Run(thread_name); }} {
+    CHECK(front_frame_ != nullptr);
+    CHECK(back_frame_ != nullptr);
+  }
+
+  BackgroundFrameGenerator(const BackgroundFrameGenerator&) = delete;
+  BackgroundFrameGenerator& operator=(const BackgroundFrameGenerator&) = delete;
+  BackgroundFrameGenerator(BackgroundFrameGenerator&&) = delete;
+  BackgroundFrameGenerator& operator=(BackgroundFrameGenerator&&) = delete;
+
+  ~BackgroundFrameGenerator() { Stop(); }
+
+  void RequestFrame(GenerateFunction generate) {
+    absl::MutexLock lock{&mutex_};
+    CHECK(!stopping_);
+    pending_generate_ = std::move(generate);
+    if (generating_ && generation_is_cancelable_) is_canceled_ = true;
+  }
+
+  // Cancels the generation in progress, as RequestFrame does, without requesting another frame.
+  void CancelGeneration() {
+    absl::MutexLock lock{&mutex_};
+    if (generating_ && generation_is_cancelable_) is_canceled_ = true;
+  }
+
+  // Returns whether no frame is generated nor requested. Until the next call to RequestFrame or
+  // RunExclusively, no generation starts, so the thread that requests the frames can then change
+  // what the generation reads.
+  [[nodiscard]] bool IsIdle() const {
+    absl::MutexLock lock{&mutex_};
+    return !generating_ && pending_generate_ == nullptr;
+  }
+
+  // Swaps the front and the back frame if the back frame is complete. Returns whether it did.
+  bool SwapFramesIfReady() {
+    absl::MutexLock lock{&mutex_};
+    if (!back_frame_is_ready_) return false;
+    std::swap(front_frame_, back_frame_);
+    back_frame_is_ready_ = false;
+    return true;
+  }
+
+  [[nodiscard]] bool IsFrameReady() const {
+    absl::MutexLock lock{&mutex_};
+    return back_frame_is_ready_;
+  }
+
+  [[nodiscard]] Frame& GetFrontFrame() { return *front_frame_; }
+
+  // Calls `function` on the calling thread while no frame is generated: the generation in progress,
+  // if any, is canceled and requested again, and no generation starts until `function` returns.
+  // Use this to access what the generation reads, or the back frame, from the calling thread.
+  void RunExclusively(const std::function<void(Frame* front_frame, Frame* back_frame)>& function) {
+    {
+      absl::MutexLock lock{&mutex_};
+      CHECK(!paused_);
+      paused_ = true;
+      if (generating_) {
+        is_canceled_ = true;
+        if (pending_generate_ == nullptr) pending_generate_ = current_generate_;
+      }
+      mutex_.Await(absl::Condition(this, &BackgroundFrameGenerator::IsNotGenerating));
+    }
+    function(front_frame_.get(), back_frame_.get());
+    absl::MutexLock lock{&mutex_};
+    paused_ = false;
+  }
+
+  // Cancels the generation in progress and joins the thread. No frames can be requested afterwards.
+  void Stop() {
+    {
+      absl::MutexLock lock{&mutex_};
+      stopping_ = true;
+      is_canceled_ = true;
+    }
+    if (thread_.joinable()) thread_.join();
+  }
+
+ private:
+  [[nodiscard]] bool IsNotGenerating() const { return !generating_; }
+  [[nodiscard]] bool CanStartGenerationOrIsStopping() const {
+    return stopping_ || (pending_generate_ != nullptr && !paused_ && !back_frame_is_ready_);
+  }
+
+  void Run(const std::string& thread_name) {
+    orbit_base::SetCurrentThreadName(thread_name.c_str());
+    const IsCanceledFunction is_canceled = [this] { return is_canceled_.load(); };
+    while (true) {
+      Frame* frame = nullptr;
+      {
+        absl::MutexLock lock{&mutex_};
+        mutex_.Await(
+            absl::Condition(this, &BackgroundFrameGenerator::CanStartGenerationOrIsStopping));
+        if (stopping_) return;
+        current_generate_ = std::move(pending_generate_);
+        pending_generate_ = nullptr;
+        generating_ = true;
+        generation_is_cancelable_ = !previous_generation_was_canceled_;
+        is_canceled_ = false;
+        frame = back_frame_.get();
+      }
+
+      current_generate_(frame, is_canceled);
+
+      absl::MutexLock lock{&mutex_};
+      generating_ = false;
+      previous_generation_was_canceled_ = is_canceled_;
+      back_frame_is_ready_ = !is_canceled_;
+      current_generate_ = nullptr;
+    }
+  }
+
+  mutable absl::Mutex mutex_;
+  // Only accessed by the thread that draws, apart from the swap.
+  std::unique_ptr<Frame> front_frame_;
+  // Only accessed by the generation thread while generating_ is true.
+  std::unique_ptr<Frame> back_frame_;
+  GenerateFunction pending_generate_ ABSL_GUARDED_BY(mutex_);
+  // Only written by the generation thread, with the mutex held.
+  GenerateFunction current_generate_;
+  bool generating_ ABSL_GUARDED_BY(mutex_) = false;
+  bool generation_is_cancelable_ ABSL_GUARDED_BY(mutex_) = true;
+  bool previous_generation_was_canceled_ ABSL_GUARDED_BY(mutex_) = false;
+  bool back_frame_is_ready_ ABSL_GUARDED_BY(mutex_) = false;
+  bool paused_ ABSL_GUARDED_BY(mutex_) = false;
+  bool stopping_ ABSL_GUARDED_BY(mutex_) = false;
+  // Read without the mutex by the generation, to return early.
+  std::atomic<bool> is_canceled_{false};
+  // Declared last, as the thread accesses all the other members.
+  std::thread thread_;
+};
+
+#endif  // ORBIT_GL_BACKGROUND_FRAME_GENERATOR_H_
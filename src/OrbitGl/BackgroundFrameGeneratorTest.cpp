@@ -0,0 +1,203 @@
+// Copyright (c) 2021 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <absl/synchronization/notification.h>
+#include <absl/time/clock.h>
+#include <absl/time/time.h>
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <memory>
+
+#include "BackgroundFrameGenerator.h"
+
+namespace {
+
+struct Frame {
+  int value = 0;
+};
+
+using Generator = BackgroundFrameGenerator<Frame>;
+
+std::unique_ptr<Generator> CreateGenerator() {
+  return std::make_unique<Generator>("TestFrames", std::make_unique<Frame>(),
+                                     std::make_unique<Frame>());
+}
+
+Generator::GenerateFunction SetValue(int value) {
+  return [value](Frame* frame, const Generator::IsCanceledFunction& /*is_canceled*/) {
+    frame->value = value;
+  };
+}
+
+void WaitForFrame(Generator* generator) {
+  while (!generator->IsFrameReady()) {
+    absl::SleepFor(absl::Milliseconds(1));
+  }
+}
+
+}  // namespace
+
+TEST(BackgroundFrameGenerator, CompleteFrameBecomesFrontFrameOnSwap) {
+  auto generator = CreateGenerator();
+  EXPECT_FALSE(generator->SwapFramesIfReady());
+
+  generator->RequestFrame(SetValue(1));
+  WaitForFrame(generator.get());
+  EXPECT_EQ(generator->GetFrontFrame().value, 0);
+  EXPECT_TRUE(generator->SwapFramesIfReady());
+  EXPECT_EQ(generator->GetFrontFrame().value, 1);
+  EXPECT_FALSE(generator->SwapFramesIfReady());
+  EXPECT_EQ(generator->GetFrontFrame().value, 1);
+}
+
+TEST(BackgroundFrameGenerator, NoFrameIsGeneratedUntilTheCompleteOneIsSwapped) {
+  auto generator = CreateGenerator();
+  generator->RequestFrame(SetValue(1));
+  WaitForFrame(generator.get());
+
+  std::atomic<bool> second_frame_generated{false};
+  generator->RequestFrame(
+      [&second_frame_generated](Frame* frame, const Generator::IsCanceledFunction& /*unused*/) {
+        frame->value = 2;
+        second_frame_generated = true;
+      });
+  absl::SleepFor(absl::Milliseconds(20));
+  EXPECT_FALSE(second_frame_generated);
+
+  EXPECT_TRUE(generator->SwapFramesIfReady());
+  EXPECT_EQ(generator->GetFrontFrame().value, 1);
+  WaitForFrame(generator.get());
+  EXPECT_TRUE(second_frame_generated);
+  EXPECT_TRUE(generator->SwapFramesIfReady());
+  EXPECT_EQ(generator->GetFrontFrame().value, 2);
+}
+
+TEST(BackgroundFrameGenerator, RequestCancelsGenerationInProgress) {
+  auto generator = CreateGenerator();
+  absl::Notification first_generation_started;
+  std::atomic<bool> first_generation_canceled{false};
+  generator->RequestFrame([&](Frame* frame, const Generator::IsCanceledFunction& is_canceled) {
+    frame->value = 1;
+    first_generation_started.Notify();
+    while (!is_canceled()) {
+      absl::SleepFor(absl::Milliseconds(1));
+    }
+    first_generation_canceled = true;
+  });
+  first_generation_started.WaitForNotification();
+
+  generator->RequestFrame(SetValue(2));
+  WaitForFrame(generator.get());
+  EXPECT_TRUE(first_generation_canceled);
+  EXPECT_TRUE(generator->SwapFramesIfReady());
+  EXPECT_EQ(generator->GetFrontFrame().value, 2);
+}
+
+TEST(BackgroundFrameGenerator, GenerationFollowingCanceledOneIsNotCanceled) {
+  auto generator = CreateGenerator();
+  absl::Notification first_generation_started;
+  generator->RequestFrame([&](Frame* /*frame*/, const Generator::IsCanceledFunction& is_canceled) {
+    first_generation_started.Notify();
+    while (!is_canceled()) {
+      absl::SleepFor(absl::Milliseconds(1));
+    }
+  });
+  first_generation_started.WaitForNotification();
+
+  absl::Notification second_generation_started;
+  absl::Notification third_frame_requested;
+  std::atomic<bool> second_generation_canceled{false};
+  generator->RequestFrame([&](Frame* frame, const Generator::IsCanceledFunction& is_canceled) {
+    second_generation_started.Notify();
+    third_frame_requested.WaitForNotification();
+    second_generation_canceled = is_canceled();
+    frame->value = 2;
+  });
+  second_generation_started.WaitForNotification();
+  generator->RequestFrame(SetValue(3));
+  third_frame_requested.Notify();
+
+  WaitForFrame(generator.get());
+  EXPECT_FALSE(second_generation_canceled);
+  EXPECT_TRUE(generator->SwapFramesIfReady());
+  EXPECT_EQ(generator->GetFrontFrame().value, 2);
+
+  // The request that came in the meantime is still served.
+  WaitForFrame(generator.get());
+  EXPECT_TRUE(generator->SwapFramesIfReady());
+  EXPECT_EQ(generator->GetFrontFrame().value, 3);
+}
+
+TEST(BackgroundFrameGenerator, RunExclusivelyRestartsGenerationInProgress) {
+  auto generator = CreateGenerator();
+  absl::Notification generation_started;
+  std::atomic<int> num_generations{0};
+  std::atomic<bool> generating{false};
+  generator->RequestFrame([&](Frame* frame, const Generator::IsCanceledFunction& is_canceled) {
+    generating = true;
+    // Only the first generation waits to be canceled.
+    if (++num_generations == 1) {
+      generation_started.Notify();
+      while (!is_canceled()) {
+        absl::SleepFor(absl::Milliseconds(1));
+      }
+    }
+    frame->value = num_generations;
+    generating = false;
+  });
+  generation_started.WaitForNotification();
+
+  generator->RunExclusively([&](Frame* front_frame, Frame* back_frame) {
+    EXPECT_FALSE(generating);
+    EXPECT_EQ(front_frame, &generator->GetFrontFrame());
+    EXPECT_NE(back_frame, front_frame);
+    front_frame->value = -1;
+  });
+  EXPECT_EQ(generator->GetFrontFrame().value, -1);
+
+  WaitForFrame(generator.get());
+  EXPECT_EQ(num_generations, 2);
+  EXPECT_TRUE(generator->SwapFramesIfReady());
+  EXPECT_EQ(generator->GetFrontFrame().value, 2);
+}
+
+TEST(BackgroundFrameGenerator, StopCancelsGenerationInProgress) {
+  auto generator = CreateGenerator();
+  absl::Notification generation_started;
+  std::atomic<bool> generation_canceled{false};
+  generator->RequestFrame([&](Frame* /*frame*/, const Generator::IsCanceledFunction& is_canceled) {
+    generation_started.Notify();
+    while (!is_canceled()) {
+      absl::SleepFor(absl::Milliseconds(1));
+    }
+    generation_canceled = true;
+  });
+  generation_started.WaitForNotification();
+
+  generator->Stop();
+  EXPECT_TRUE(generation_canceled);
+  EXPECT_FALSE(generator->IsFrameReady());
+}
+
+TEST(BackgroundFrameGenerator, IsIdleOnceCanceledGenerationReturns) {
+  auto generator = CreateGenerator();
+  EXPECT_TRUE(generator->IsIdle());
+
+  absl::Notification generation_started;
+  generator->RequestFrame([&](Frame* /*frame*/, const Generator::IsCanceledFunction& is_canceled) {
+    generation_started.Notify();
+    while (!is_canceled()) {
+      absl::SleepFor(absl::Milliseconds(1));
+    }
+  });
+  generation_started.WaitForNotification();
+  EXPECT_FALSE(generator->IsIdle());
+
+  generator->CancelGeneration();
+  while (!generator->IsIdle()) {
+    absl::SleepFor(absl::Milliseconds(1));
+  }
+  EXPECT_FALSE(generator->IsFrameReady());
+}
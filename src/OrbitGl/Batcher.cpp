@@ -6,19 +6,120 @@
 
 #include <GteVector.h>
 #include <GteVector2.h>
+#include <absl/base/casts.h>
 #include <math.h>
 #include <stddef.h>
 
+#include <algorithm>
+#include <iterator>
+
 #include "CoreUtils.h"
 #include "OpenGl.h"
 #include "OrbitBase/Logging.h"
 #include "OrbitBase/Tracing.h"
 
+namespace {
+bool IsLayerRangeBefore(const LayeredPrimitiveBuffer::LayerRange& range, float layer) {
+  return range.layer < layer;
+}
+
+// Appends the primitives of `source` to `destination`, adding `element_id_offset` to the element id
+// of the picking ids that refer to the user data of the Batcher.
+void AppendPrimitiveBuffer(const PrimitiveBuffer& source, size_t vertices_per_primitive,
+                           uint32_t element_id_offset, PrimitiveBuffer* destination) {
+  destination->vertices.insert(destination->vertices.end(), source.vertices.begin(),
+                               source.vertices.end());
+  destination->colors.insert(destination->colors.end(), source.colors.begin(),
+                             source.colors.end());
+  destination->layers.insert(destination->layers.end(), source.layers.begin(),
+                             source.layers.end());
+  if (element_id_offset == 0) {
+    destination->picking_colors.insert(destination->picking_colors.end(),
+                                       source.picking_colors.begin(), source.picking_colors.end());
+    return;
+  }
+
+  destination->picking_colors.reserve(destination->picking_colors.size() +
+                                      source.picking_colors.size());
+  // All the vertices of a primitive have the same picking color.
+  for (size_t i = 0; i < source.picking_colors.size(); i += vertices_per_primitive) {
+    const Color& color = source.picking_colors[i];
+    PickingId id = PickingId::FromPixelValue(
+        absl::bit_cast<uint32_t>(std::array<uint8_t, 4>{color[0], color[1], color[2], color[3]}));
+    Color picking_color = color;
+    if (id.type == PickingType::kLine || id.type == PickingType::kBox ||
+        id.type == PickingType::kTriangle) {
+      picking_color = PickingId::ToColor(id.type, id.element_id + element_id_offset, id.batcher_id);
+    }
+    for (size_t v = 0; v < vertices_per_primitive; ++v) {
+      destination->picking_colors.push_back(picking_color);
+    }
+  }
+}
+}  // namespace
+
+void LayeredPrimitiveBuffer::SortByLayer(const PrimitiveBuffer& buffer,
+                                         size_t vertices_per_primitive) {
+  primitives.Reset();
+  layer_ranges.clear();
+  if (buffer.size() == 0) return;
+
+  // There are only a handful of layers, so we do a counting sort: find the layers and the number
+  // of primitives in each of them, then copy each primitive at the next position of its layer.
+  auto it = layer_ranges.end();
+  for (float layer : buffer.layers) {
+    // Consecutive primitives are usually in the same layer.
+    if (it == layer_ranges.end() || it->layer != layer) {
+      it = std::lower_bound(layer_ranges.begin(), layer_ranges.end(), layer, IsLayerRangeBefore);
+      if (it == layer_ranges.end() || it->layer != layer) {
+        it = layer_ranges.insert(it, LayerRange{layer, 0, 0});
+      }
+    }
+    ++it->end;
+  }
+  // Until here, `end` holds the number of primitives of the layer.
+  size_t begin = 0;
+  for (LayerRange& range : layer_ranges) {
+    size_t count = range.end;
+    range.begin = begin;
+    range.end = begin;
+    begin += count;
+  }
+
+  const size_t num_vertices = buffer.vertices.size();
+  primitives.vertices.resize(num_vertices);
+  primitives.colors.resize(num_vertices);
+  primitives.picking_colors.resize(num_vertices);
+  primitives.layers.resize(buffer.size());
+  auto range = layer_ranges.begin();
+  for (size_t i = 0; i < buffer.size(); ++i) {
+    float layer = buffer.layers[i];
+    if (range->layer != layer) {
+      range = std::lower_bound(layer_ranges.begin(), layer_ranges.end(), layer, IsLayerRangeBefore);
+    }
+    size_t destination = range->end++;
+    primitives.layers[destination] = layer;
+    size_t source_vertex = i * vertices_per_primitive;
+    size_t destination_vertex = destination * vertices_per_primitive;
+    for (size_t v = 0; v < vertices_per_primitive; ++v) {
+      primitives.vertices[destination_vertex + v] = buffer.vertices[source_vertex + v];
+      primitives.colors[destination_vertex + v] = buffer.colors[source_vertex + v];
+      primitives.picking_colors[destination_vertex + v] = buffer.picking_colors[source_vertex + v];
+    }
+  }
+}
+
+const LayeredPrimitiveBuffer::LayerRange* LayeredPrimitiveBuffer::GetLayerRange(float layer) const {
+  auto it = std::lower_bound(layer_ranges.begin(), layer_ranges.end(), layer, IsLayerRangeBefore);
+  if (it == layer_ranges.end() || it->layer != layer) return nullptr;
+  return &*it;
+}
+
 void Batcher::AddLine(Vec2 from, Vec2 to, float z, const Color& color,
-                      std::unique_ptr<PickingUserData> user_data) {
+                      const PickingUserData& user_data) {
   Color picking_color = PickingId::ToColor(PickingType::kLine, user_data_.size(), batcher_id_);
 
-  AddLine(from, to, z, color, picking_color, std::move(user_data));
+  AddLine(from, to, z, color, picking_color, user_data);
 }
 
 void Batcher::AddLine(Vec2 from, Vec2 to, float z, const Color& color,
@@ -27,12 +128,12 @@ void Batcher::AddLine(Vec2 from, Vec2 to, float z, const Color& color,
 
   Color picking_color = picking_manager_->GetPickableColor(pickable, batcher_id_);
 
-  AddLine(from, to, z, color, picking_color, nullptr);
+  AddLine(from, to, z, color, picking_color, PickingUserData());
 }
 
 void Batcher::AddVerticalLine(Vec2 pos, float size, float z, const Color& color,
-                              std::unique_ptr<PickingUserData> user_data) {
-  AddLine(pos, pos + Vec2(0, size), z, color, std::move(user_data));
+                              const PickingUserData& user_data) {
+  AddLine(pos, pos + Vec2(0, size), z, color, user_data);
 }
 
 void Batcher::AddVerticalLine(Vec2 pos, float size, float z, const Color& color,
@@ -41,33 +142,31 @@ void Batcher::AddVerticalLine(Vec2 pos, float size, float z, const Color& color,
 
   Color picking_color = picking_manager_->GetPickableColor(pickable, batcher_id_);
 
-  AddLine(pos, pos + Vec2(0, size), z, color, picking_color, nullptr);
+  AddLine(pos, pos + Vec2(0, size), z, color, picking_color, PickingUserData());
 }
 
 void Batcher::AddLine(Vec2 from, Vec2 to, float z, const Color& color, const Color& picking_color,
-                      std::unique_ptr<PickingUserData> user_data) {
-  Line line;
-  line.start_point = Vec3(floorf(from[0]), floorf(from[1]), z);
-  line.end_point = Vec3(floorf(to[0]), floorf(to[1]), z);
-  auto& buffer = primitive_buffers_by_layer_[z];
-
-  buffer.line_buffer.lines_.push_back(line);
-  buffer.line_buffer.colors_.push_back_n(color, 2);
-  buffer.line_buffer.picking_colors_.push_back_n(picking_color, 2);
-  user_data_.push_back(std::move(user_data));
+                      const PickingUserData& user_data) {
+  lines_.vertices.emplace_back(floorf(from[0]), floorf(from[1]), z);
+  lines_.vertices.emplace_back(floorf(to[0]), floorf(to[1]), z);
+  lines_.colors.insert(lines_.colors.end(), 2, color);
+  lines_.picking_colors.insert(lines_.picking_colors.end(), 2, picking_color);
+  lines_.layers.push_back(z);
+  layered_buffers_up_to_date_ = false;
+  user_data_.push_back(user_data);
 }
 
 void Batcher::AddBox(const Box& box, const std::array<Color, 4>& colors,
-                     std::unique_ptr<PickingUserData> user_data) {
+                     const PickingUserData& user_data) {
   Color picking_color = PickingId::ToColor(PickingType::kBox, user_data_.size(), batcher_id_);
-  AddBox(box, colors, picking_color, std::move(user_data));
+  AddBox(box, colors, picking_color, user_data);
 }
 
 void Batcher::AddBox(const Box& box, const Color& color,
-                     std::unique_ptr<PickingUserData> user_data) {
+                     const PickingUserData& user_data) {
   std::array<Color, 4> colors;
   Fill(colors, color);
-  AddBox(box, colors, std::move(user_data));
+  AddBox(box, colors, user_data);
 }
 
 void Batcher::AddBox(const Box& box, const Color& color, std::shared_ptr<Pickable> pickable) {
@@ -77,26 +176,26 @@ void Batcher::AddBox(const Box& box, const Color& color, std::shared_ptr<Pickabl
   std::array<Color, 4> colors;
   Fill(colors, color);
 
-  AddBox(box, colors, picking_color, nullptr);
+  AddBox(box, colors, picking_color, PickingUserData());
 }
 
 void Batcher::AddShadedBox(Vec2 pos, Vec2 size, float z, const Color& color) {
-  AddShadedBox(pos, size, z, color, std::unique_ptr<PickingUserData>(),
+  AddShadedBox(pos, size, z, color, PickingUserData(),
                ShadingDirection::kLeftToRight);
 }
 
 void Batcher::AddShadedBox(Vec2 pos, Vec2 size, float z, const Color& color,
                            ShadingDirection shading_direction) {
-  AddShadedBox(pos, size, z, color, std::unique_ptr<PickingUserData>(), shading_direction);
+  AddShadedBox(pos, size, z, color, PickingUserData(), shading_direction);
 }
 
 void Batcher::AddShadedBox(Vec2 pos, Vec2 size, float z, const Color& color,
-                           std::unique_ptr<PickingUserData> user_data,
+                           const PickingUserData& user_data,
                            ShadingDirection shading_direction) {
   std::array<Color, 4> colors;
   GetBoxGradientColors(color, &colors, shading_direction);
   Box box(pos, size, z);
-  AddBox(box, colors, std::move(user_data));
+  AddBox(box, colors, user_data);
 }
 
 static std::vector<Triangle> GetUnitArcTriangles(float angle_0, float angle_1, uint32_t num_sides) {
@@ -184,29 +283,26 @@ void Batcher::AddShadedBox(Vec2 pos, Vec2 size, float z, const Color& color,
   GetBoxGradientColors(color, &colors, shading_direction);
   Color picking_color = picking_manager_->GetPickableColor(pickable, batcher_id_);
   Box box(pos, size, z);
-  AddBox(box, colors, picking_color, nullptr);
+  AddBox(box, colors, picking_color, PickingUserData());
 }
 
 void Batcher::AddBox(const Box& box, const std::array<Color, 4>& colors, const Color& picking_color,
-                     std::unique_ptr<PickingUserData> user_data) {
-  Box rounded_box = box;
-  for (size_t v = 0; v < 4; ++v) {
-    rounded_box.vertices[v][0] = floorf(rounded_box.vertices[v][0]);
-    rounded_box.vertices[v][1] = floorf(rounded_box.vertices[v][1]);
+                     const PickingUserData& user_data) {
+  for (const Vec3& vertex : box.vertices) {
+    boxes_.vertices.emplace_back(floorf(vertex[0]), floorf(vertex[1]), vertex[2]);
   }
-  float layer_z_value = rounded_box.vertices[0][2];
-  auto& buffer = primitive_buffers_by_layer_[layer_z_value];
-  buffer.box_buffer.boxes_.push_back(rounded_box);
-  buffer.box_buffer.colors_.push_back(colors);
-  buffer.box_buffer.picking_colors_.push_back_n(picking_color, 4);
-  user_data_.push_back(std::move(user_data));
+  boxes_.colors.insert(boxes_.colors.end(), colors.begin(), colors.end());
+  boxes_.picking_colors.insert(boxes_.picking_colors.end(), 4, picking_color);
+  boxes_.layers.push_back(box.vertices[0][2]);
+  layered_buffers_up_to_date_ = false;
+  user_data_.push_back(user_data);
 }
 
 void Batcher::AddTriangle(const Triangle& triangle, const Color& color,
-                          std::unique_ptr<PickingUserData> user_data) {
+                          const PickingUserData& user_data) {
   Color picking_color = PickingId::ToColor(PickingType::kTriangle, user_data_.size(), batcher_id_);
 
-  AddTriangle(triangle, color, picking_color, std::move(user_data));
+  AddTriangle(triangle, color, picking_color, user_data);
 }
 
 void Batcher::AddTriangle(const Triangle& triangle, const Color& color,
@@ -215,45 +311,42 @@ void Batcher::AddTriangle(const Triangle& triangle, const Color& color,
 
   Color picking_color = picking_manager_->GetPickableColor(pickable, batcher_id_);
 
-  AddTriangle(triangle, color, picking_color, nullptr);
+  AddTriangle(triangle, color, picking_color, PickingUserData());
 }
 
 void Batcher::AddTriangle(const Triangle& triangle, const Color& color, const Color& picking_color,
-                          std::unique_ptr<PickingUserData> user_data) {
+                          const PickingUserData& user_data) {
   std::array<Color, 3> colors;
   colors.fill(color);
-  AddTriangle(triangle, colors, picking_color, std::move(user_data));
+  AddTriangle(triangle, colors, picking_color, user_data);
 }
 
 // Draw a shaded trapezium with two sides parallel to the x-axis or y-axis.
 void Batcher::AddShadedTrapezium(const Vec3& top_left, const Vec3& bottom_left,
                                  const Vec3& bottom_right, const Vec3& top_right,
-                                 const Color& color, std::unique_ptr<PickingUserData> user_data,
+                                 const Color& color, const PickingUserData& user_data,
                                  ShadingDirection shading_direction) {
   std::array<Color, 4> colors;  // top_left, bottom_left, bottom_right, top_right.
   GetBoxGradientColors(color, &colors, shading_direction);
   Color picking_color = PickingId::ToColor(PickingType::kTriangle, user_data_.size(), batcher_id_);
   Triangle triangle_1{top_left, bottom_left, top_right};
   std::array<Color, 3> colors_1{colors[0], colors[1], colors[2]};
-  AddTriangle(triangle_1, colors_1, picking_color, std::make_unique<PickingUserData>(*user_data));
+  AddTriangle(triangle_1, colors_1, picking_color, user_data);
   Triangle triangle_2{bottom_left, bottom_right, top_right};
   std::array<Color, 3> colors_2{colors[1], colors[2], colors[3]};
-  AddTriangle(triangle_2, colors_2, picking_color, std::move(user_data));
+  AddTriangle(triangle_2, colors_2, picking_color, user_data);
 }
 
 void Batcher::AddTriangle(const Triangle& triangle, const std::array<Color, 3>& colors,
-                          const Color& picking_color, std::unique_ptr<PickingUserData> user_data) {
-  Triangle rounded_tri = triangle;
-  for (auto& vertice : rounded_tri.vertices) {
-    vertice[0] = floorf(vertice[0]);
-    vertice[1] = floorf(vertice[1]);
+                          const Color& picking_color, const PickingUserData& user_data) {
+  for (const Vec3& vertex : triangle.vertices) {
+    triangles_.vertices.emplace_back(floorf(vertex[0]), floorf(vertex[1]), vertex[2]);
   }
-  float layer_z_value = rounded_tri.vertices[0][2];
-  auto& buffer = primitive_buffers_by_layer_[layer_z_value];
-  buffer.triangle_buffer.triangles_.push_back(rounded_tri);
-  buffer.triangle_buffer.colors_.push_back(colors);
-  buffer.triangle_buffer.picking_colors_.push_back_n(picking_color, 3);
-  user_data_.push_back(std::move(user_data));
+  triangles_.colors.insert(triangles_.colors.end(), colors.begin(), colors.end());
+  triangles_.picking_colors.insert(triangles_.picking_colors.end(), 3, picking_color);
+  triangles_.layers.push_back(triangle.vertices[0][2]);
+  layered_buffers_up_to_date_ = false;
+  user_data_.push_back(user_data);
 }
 
 void Batcher::AddCircle(Vec2 position, float radius, float z, Color color) {
@@ -288,7 +381,7 @@ const PickingUserData* Batcher::GetUserData(PickingId id) const {
     case PickingType::kTriangle:
     case PickingType::kLine:
       CHECK(id.element_id < user_data_.size());
-      return user_data_[id.element_id].get();
+      return &user_data_[id.element_id];
     case PickingType::kPickable:
       return nullptr;
     case PickingType::kCount:
@@ -348,27 +441,69 @@ void Batcher::GetBoxGradientColors(const Color& color, std::array<Color, 4>* col
 }
 
 void Batcher::ResetElements() {
-  for (auto& [unused_layer, buffer] : primitive_buffers_by_layer_) {
-    buffer.Reset();
-  }
+  lines_.Reset();
+  boxes_.Reset();
+  triangles_.Reset();
+  layered_buffers_up_to_date_ = false;
 }
 
 void Batcher::StartNewFrame() {
   ResetElements();
   user_data_.clear();
+  tooltip_callbacks_.clear();
+}
+
+void Batcher::MergeFrom(Batcher* other) {
+  CHECK(other != this);
+  CHECK(other->batcher_id_ == batcher_id_);
+  const auto element_id_offset = static_cast<uint32_t>(user_data_.size());
+  AppendPrimitiveBuffer(other->lines_, 2, element_id_offset, &lines_);
+  AppendPrimitiveBuffer(other->boxes_, 4, element_id_offset, &boxes_);
+  AppendPrimitiveBuffer(other->triangles_, 3, element_id_offset, &triangles_);
+  layered_buffers_up_to_date_ = false;
+
+  user_data_.insert(user_data_.end(), other->user_data_.begin(), other->user_data_.end());
+  // The user data points to the callbacks, which are moved without being reallocated.
+  std::move(other->tooltip_callbacks_.begin(), other->tooltip_callbacks_.end(),
+            std::back_inserter(tooltip_callbacks_));
+  other->StartNewFrame();
+}
+
+const TooltipCallback* Batcher::AddTooltipCallback(TooltipCallback callback) {
+  tooltip_callbacks_.push_back(std::make_unique<TooltipCallback>(std::move(callback)));
+  return tooltip_callbacks_.back().get();
+}
+
+void Batcher::SortPrimitivesByLayer() const {
+  if (layered_buffers_up_to_date_) return;
+  layered_lines_.SortByLayer(lines_, 2);
+  layered_boxes_.SortByLayer(boxes_, 4);
+  layered_triangles_.SortByLayer(triangles_, 3);
+  layered_buffers_up_to_date_ = true;
 }
 
 std::vector<float> Batcher::GetLayers() const {
+  SortPrimitivesByLayer();
   std::vector<float> layers;
-  for (auto& [layer, _] : primitive_buffers_by_layer_) {
-    layers.push_back(layer);
+  for (const LayeredPrimitiveBuffer* buffer :
+       {&layered_lines_, &layered_boxes_, &layered_triangles_}) {
+    for (const LayeredPrimitiveBuffer::LayerRange& range : buffer->layer_ranges) {
+      layers.push_back(range.layer);
+    }
   }
+  std::sort(layers.begin(), layers.end());
+  layers.erase(std::unique(layers.begin(), layers.end()), layers.end());
   return layers;
 };
 
 void Batcher::DrawLayer(float layer, bool picking) const {
   ORBIT_SCOPE_FUNCTION;
-  if (!primitive_buffers_by_layer_.count(layer)) return;
+  SortPrimitivesByLayer();
+  if (layered_lines_.GetLayerRange(layer) == nullptr &&
+      layered_boxes_.GetLayerRange(layer) == nullptr &&
+      layered_triangles_.GetLayerRange(layer) == nullptr) {
+    return;
+  }
   glPushAttrib(GL_ENABLE_BIT | GL_COLOR_BUFFER_BIT);
   if (picking) {
     glDisable(GL_BLEND);
@@ -391,65 +526,32 @@ void Batcher::DrawLayer(float layer, bool picking) const {
 }
 
 void Batcher::Draw(bool picking) const {
-  for (auto& [layer, unused_buffer] : primitive_buffers_by_layer_) {
+  for (float layer : GetLayers()) {
     DrawLayer(layer, picking);
   }
 }
 
-void Batcher::DrawBoxBuffer(float layer, bool picking) const {
-  auto& box_buffer = primitive_buffers_by_layer_.at(layer).box_buffer;
-  const Block<Box, BoxBuffer::NUM_BOXES_PER_BLOCK>* box_block = box_buffer.boxes_.root();
-  const Block<Color, BoxBuffer::NUM_BOXES_PER_BLOCK * 4>* color_block;
-
-  color_block = !picking ? box_buffer.colors_.root() : box_buffer.picking_colors_.root();
-
-  while (box_block != nullptr) {
-    if (auto num_elems = box_block->size()) {
-      glVertexPointer(3, GL_FLOAT, sizeof(Vec3), box_block->data());
-      glColorPointer(4, GL_UNSIGNED_BYTE, sizeof(Color), color_block->data());
-      glDrawArrays(GL_QUADS, 0, num_elems * 4);
-    }
+static void DrawLayeredPrimitiveBuffer(const LayeredPrimitiveBuffer& buffer, float layer,
+                                       bool picking, GLenum mode, size_t vertices_per_primitive) {
+  const LayeredPrimitiveBuffer::LayerRange* range = buffer.GetLayerRange(layer);
+  if (range == nullptr) return;
+  const size_t first_vertex = range->begin * vertices_per_primitive;
+  const size_t num_vertices = (range->end - range->begin) * vertices_per_primitive;
+  const std::vector<Color>& colors =
+      !picking ? buffer.primitives.colors : buffer.primitives.picking_colors;
+  glVertexPointer(3, GL_FLOAT, sizeof(Vec3), buffer.primitives.vertices.data() + first_vertex);
+  glColorPointer(4, GL_UNSIGNED_BYTE, sizeof(Color), colors.data() + first_vertex);
+  glDrawArrays(mode, 0, static_cast<GLsizei>(num_vertices));
+}
 
-    box_block = box_block->next();
-    color_block = color_block->next();
-  }
+void Batcher::DrawBoxBuffer(float layer, bool picking) const {
+  DrawLayeredPrimitiveBuffer(layered_boxes_, layer, picking, GL_QUADS, 4);
 }
 
 void Batcher::DrawLineBuffer(float layer, bool picking) const {
-  auto& line_buffer = primitive_buffers_by_layer_.at(layer).line_buffer;
-  const Block<Line, LineBuffer::NUM_LINES_PER_BLOCK>* line_block = line_buffer.lines_.root();
-  const Block<Color, LineBuffer::NUM_LINES_PER_BLOCK * 2>* color_block;
-
-  color_block = !picking ? line_buffer.colors_.root() : line_buffer.picking_colors_.root();
-
-  while (line_block != nullptr) {
-    if (auto num_elems = line_block->size()) {
-      glVertexPointer(3, GL_FLOAT, sizeof(Vec3), line_block->data());
-      glColorPointer(4, GL_UNSIGNED_BYTE, sizeof(Color), color_block->data());
-      glDrawArrays(GL_LINES, 0, num_elems * 2);
-    }
-
-    line_block = line_block->next();
-    color_block = color_block->next();
-  }
+  DrawLayeredPrimitiveBuffer(layered_lines_, layer, picking, GL_LINES, 2);
 }
 
 void Batcher::DrawTriangleBuffer(float layer, bool picking) const {
-  auto& triangle_buffer = primitive_buffers_by_layer_.at(layer).triangle_buffer;
-  const Block<Triangle, TriangleBuffer::NUM_TRIANGLES_PER_BLOCK>* triangle_block =
-      triangle_buffer.triangles_.root();
-  const Block<Color, TriangleBuffer::NUM_TRIANGLES_PER_BLOCK * 3>* color_block;
-
-  color_block = !picking ? triangle_buffer.colors_.root() : triangle_buffer.picking_colors_.root();
-
-  while (triangle_block != nullptr) {
-    if (int num_elems = triangle_block->size()) {
-      glVertexPointer(3, GL_FLOAT, sizeof(Vec3), triangle_block->data());
-      glColorPointer(4, GL_UNSIGNED_BYTE, sizeof(Color), color_block->data());
-      glDrawArrays(GL_TRIANGLES, 0, num_elems * 3);
-    }
-
-    triangle_block = triangle_block->next();
-    color_block = color_block->next();
-  }
+  DrawLayeredPrimitiveBuffer(layered_triangles_, layer, picking, GL_TRIANGLES, 3);
 }
@@ -6,6 +6,7 @@
 #define ORBIT_GL_BATCHER_H_
 
 #include <math.h>
+#include <stddef.h>
 #include <stdint.h>
 
 #include <algorithm>
@@ -13,76 +14,73 @@
 #include <functional>
 #include <memory>
 #include <string>
-#include <unordered_map>
 #include <utility>
 #include <vector>
 
-#include "BlockChain.h"
 #include "CoreMath.h"
 #include "Geometry.h"
 #include "PickingManager.h"
 #include "TextBox.h"
 
-using TooltipCallback = std::function<std::string(PickingId)>;
+class Batcher;
 
-struct PickingUserData {
-  TextBox* text_box_;
-  TooltipCallback generate_tooltip_;
-  const void* custom_data_ = nullptr;
-
-  explicit PickingUserData(TextBox* text_box = nullptr, TooltipCallback generate_tooltip = nullptr)
-      : text_box_(text_box), generate_tooltip_(std::move(generate_tooltip)) {}
-};
-
-struct LineBuffer {
-  void Reset() {
-    lines_.Reset();
-    colors_.Reset();
-    picking_colors_.Reset();
-  }
+// Generates the tooltip of the primitive with the given picking id, which is looked up in the given
+// Batcher: the one the primitive is drawn from. This differs from the one it was added to when that
+// one was merged into another (see Batcher::MergeFrom).
+using TooltipCallback = std::function<std::string(const Batcher&, PickingId)>;
 
-  static const int NUM_LINES_PER_BLOCK = 64 * 1024;
-  BlockChain<Line, NUM_LINES_PER_BLOCK> lines_;
-  BlockChain<Color, 2 * NUM_LINES_PER_BLOCK> colors_;
-  BlockChain<Color, 2 * NUM_LINES_PER_BLOCK> picking_colors_;
+// What a primitive added to a Batcher represents, used for picking and to generate its tooltip.
+// It is stored by value in a per-frame table indexed by the element id of the primitive, so it does
+// not own anything. The tooltip callback is shared by all the primitives of a track and stored once
+// per frame by the Batcher (see Batcher::AddTooltipCallback). It is only called for the primitive
+// that is hovered, and can use `custom_id_` to find the element the primitive represents, e.g., the
+// callstack of a sample.
+struct PickingUserData {
+  const TextBox* text_box_;
+  const TooltipCallback* generate_tooltip_;
+  uint64_t custom_id_;
+
+  explicit PickingUserData(const TextBox* text_box = nullptr,
+                           const TooltipCallback* generate_tooltip = nullptr,
+                           uint64_t custom_id = 0)
+      : text_box_(text_box), generate_tooltip_(generate_tooltip), custom_id_(custom_id) {}
 };
 
-struct BoxBuffer {
+// The primitives of one kind (lines, boxes or triangles) added to a Batcher during a frame, in the
+// order in which they were added: each primitive has a fixed number of consecutive vertices, as
+// many colors and picking colors, and one layer. The vectors are cleared but keep their capacity
+// between frames, so that adding primitives hardly ever allocates once the first frames are drawn.
+struct PrimitiveBuffer {
   void Reset() {
-    boxes_.Reset();
-    colors_.Reset();
-    picking_colors_.Reset();
+    vertices.clear();
+    colors.clear();
+    picking_colors.clear();
+    layers.clear();
   }
 
-  static const int NUM_BOXES_PER_BLOCK = 64 * 1024;
-  BlockChain<Box, NUM_BOXES_PER_BLOCK> boxes_;
-  BlockChain<Color, 4 * NUM_BOXES_PER_BLOCK> colors_;
-  BlockChain<Color, 4 * NUM_BOXES_PER_BLOCK> picking_colors_;
-};
-
-struct TriangleBuffer {
-  void Reset() {
-    triangles_.Reset();
-    colors_.Reset();
-    picking_colors_.Reset();
-  }
+  [[nodiscard]] size_t size() const { return layers.size(); }
 
-  static const int NUM_TRIANGLES_PER_BLOCK = 64 * 1024;
-  BlockChain<Triangle, NUM_TRIANGLES_PER_BLOCK> triangles_;
-  BlockChain<Color, 3 * NUM_TRIANGLES_PER_BLOCK> colors_;
-  BlockChain<Color, 3 * NUM_TRIANGLES_PER_BLOCK> picking_colors_;
+  std::vector<Vec3> vertices;
+  std::vector<Color> colors;
+  std::vector<Color> picking_colors;
+  std::vector<float> layers;
 };
 
-struct PrimitiveBuffers {
-  void Reset() {
-    line_buffer.Reset();
-    box_buffer.Reset();
-    triangle_buffer.Reset();
-  }
-
-  LineBuffer line_buffer;
-  BoxBuffer box_buffer;
-  TriangleBuffer triangle_buffer;
+// The primitives of a PrimitiveBuffer sorted by layer, keeping their relative order within each
+// layer, together with the range [begin, end) of primitives of each layer in increasing order of
+// layer. This is what is submitted for drawing, with one draw call per layer.
+struct LayeredPrimitiveBuffer {
+  struct LayerRange {
+    float layer;
+    size_t begin;
+    size_t end;
+  };
+
+  void SortByLayer(const PrimitiveBuffer& buffer, size_t vertices_per_primitive);
+  [[nodiscard]] const LayerRange* GetLayerRange(float layer) const;
+
+  PrimitiveBuffer primitives;
+  std::vector<LayerRange> layer_ranges;
 };
 
 enum class ShadingDirection { kLeftToRight, kRightToLeft, kTopToBottom, kBottomToTop };
@@ -95,6 +93,10 @@ into layers formed by equal z-coordinates. Each layer can then be drawn seperate
 Batcher::DrawLayer(), or all layers can be drawn at once in their correct order using
 Batcher::Draw():
 
+There is one buffer per kind of primitive for all layers. The primitives are only sorted by layer,
+once, when the frame is first drawn, and each layer is drawn with one draw call per kind of
+primitive.
+
 NOTE: The Batcher assumes x/y coordinates are in pixels and will automatically round those
 down to the next integer in all Batcher::AddXXX methods. This fixes the issue of primitives
 "jumping" around when their coordinates are changed slightly.
@@ -117,24 +119,24 @@ class Batcher {
   Batcher(Batcher&&) = delete;
 
   void AddLine(Vec2 from, Vec2 to, float z, const Color& color,
-               std::unique_ptr<PickingUserData> user_data = nullptr);
+               const PickingUserData& user_data = PickingUserData());
   void AddVerticalLine(Vec2 pos, float size, float z, const Color& color,
-                       std::unique_ptr<PickingUserData> user_data = nullptr);
+                       const PickingUserData& user_data = PickingUserData());
   void AddLine(Vec2 from, Vec2 to, float z, const Color& color, std::shared_ptr<Pickable> pickable);
   void AddVerticalLine(Vec2 pos, float size, float z, const Color& color,
                        std::shared_ptr<Pickable> pickable);
 
   void AddBox(const Box& box, const std::array<Color, 4>& colors,
-              std::unique_ptr<PickingUserData> user_data = nullptr);
+              const PickingUserData& user_data = PickingUserData());
   void AddBox(const Box& box, const Color& color,
-              std::unique_ptr<PickingUserData> user_data = nullptr);
+              const PickingUserData& user_data = PickingUserData());
   void AddBox(const Box& box, const Color& color, std::shared_ptr<Pickable> pickable);
 
   void AddShadedBox(Vec2 pos, Vec2 size, float z, const Color& color);
   void AddShadedBox(Vec2 pos, Vec2 size, float z, const Color& color,
                     ShadingDirection shading_direction);
   void AddShadedBox(Vec2 pos, Vec2 size, float z, const Color& color,
-                    std::unique_ptr<PickingUserData> user_data,
+                    const PickingUserData& user_data,
                     ShadingDirection shading_direction = ShadingDirection::kLeftToRight);
   void AddShadedBox(Vec2 pos, Vec2 size, float z, const Color& color,
                     std::shared_ptr<Pickable> pickable,
@@ -148,10 +150,10 @@ class Batcher {
   void AddBottomRightRoundedCorner(Vec2 pos, float radius, float z, const Color& color);
 
   void AddTriangle(const Triangle& triangle, const Color& color,
-                   std::unique_ptr<PickingUserData> user_data = nullptr);
+                   const PickingUserData& user_data = PickingUserData());
   void AddShadedTrapezium(const Vec3& top_left, const Vec3& bottom_left, const Vec3& bottom_right,
                           const Vec3& top_right, const Color& color,
-                          std::unique_ptr<PickingUserData> user_data = nullptr,
+                          const PickingUserData& user_data = PickingUserData(),
                           ShadingDirection shading_direction = ShadingDirection::kLeftToRight);
   void AddTriangle(const Triangle& triangle, const Color& color,
                    std::shared_ptr<Pickable> pickable);
@@ -164,9 +166,24 @@ class Batcher {
   void ResetElements();
   void StartNewFrame();
 
+  // Appends the primitives, the user data and the tooltip callbacks of `other`, which must have the
+  // same BatcherId, and starts a new frame in `other`. The picking ids of the appended primitives
+  // are offset so that they still refer to their own user data. This allows to add primitives to
+  // several Batchers in parallel and to draw them all from one.
+  void MergeFrom(Batcher* other);
+
+  [[nodiscard]] size_t GetNumLines() const { return lines_.size(); }
+  [[nodiscard]] size_t GetNumBoxes() const { return boxes_.size(); }
+  [[nodiscard]] size_t GetNumTriangles() const { return triangles_.size(); }
+
+  [[nodiscard]] BatcherId GetBatcherId() const { return batcher_id_; }
   [[nodiscard]] PickingManager* GetPickingManager() const { return picking_manager_; }
   void SetPickingManager(PickingManager* picking_manager) { picking_manager_ = picking_manager; }
 
+  // Stores `callback` until the next frame is started, and returns the pointer to pass to the
+  // PickingUserData of all the primitives that use it.
+  [[nodiscard]] const TooltipCallback* AddTooltipCallback(TooltipCallback callback);
+
   [[nodiscard]] const PickingUserData* GetUserData(PickingId id) const;
   [[nodiscard]] PickingUserData* GetUserData(PickingId id);
 
@@ -179,24 +196,35 @@ class Batcher {
   void DrawBoxBuffer(float layer, bool picking) const;
   void DrawTriangleBuffer(float layer, bool picking) const;
 
+  // Updates the buffers sorted by layer if primitives were added or removed since the last call.
+  void SortPrimitivesByLayer() const;
+
   void GetBoxGradientColors(const Color& color, std::array<Color, 4>* colors,
                             ShadingDirection shading_direction = ShadingDirection::kLeftToRight);
 
   void AddLine(Vec2 from, Vec2 to, float z, const Color& color, const Color& picking_color,
-               std::unique_ptr<PickingUserData> user_data = nullptr);
+               const PickingUserData& user_data = PickingUserData());
   void AddBox(const Box& box, const std::array<Color, 4>& colors, const Color& picking_color,
-              std::unique_ptr<PickingUserData> user_data = nullptr);
+              const PickingUserData& user_data = PickingUserData());
   void AddTriangle(const Triangle& triangle, const Color& color, const Color& picking_color,
-                   std::unique_ptr<PickingUserData> user_data = nullptr);
+                   const PickingUserData& user_data = PickingUserData());
   void AddTriangle(const Triangle& triangle, const std::array<Color, 3>& colors,
                    const Color& picking_color,
-                   std::unique_ptr<PickingUserData> user_data = nullptr);
+                   const PickingUserData& user_data = PickingUserData());
 
   BatcherId batcher_id_;
   PickingManager* picking_manager_;
-  std::unordered_map<float, PrimitiveBuffers> primitive_buffers_by_layer_;
+  PrimitiveBuffer lines_;
+  PrimitiveBuffer boxes_;
+  PrimitiveBuffer triangles_;
+
+  mutable LayeredPrimitiveBuffer layered_lines_;
+  mutable LayeredPrimitiveBuffer layered_boxes_;
+  mutable LayeredPrimitiveBuffer layered_triangles_;
+  mutable bool layered_buffers_up_to_date_ = true;
 
-  std::vector<std::unique_ptr<PickingUserData>> user_data_;
+  std::vector<PickingUserData> user_data_;
+  std::vector<std::unique_ptr<TooltipCallback>> tooltip_callbacks_;
 
   std::vector<Vec2> circle_points;
 };
@@ -0,0 +1,81 @@
+// Copyright (c) 2021 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <benchmark/benchmark.h>
+
+#include <cstdint>
+#include <string>
+
+#include "Batcher.h"
+#include "CoreMath.h"
+#include "Geometry.h"
+#include "PickingManager.h"
+
+// These benchmarks measure adding primitives to a Batcher and sorting them by layer for drawing,
+// as done every frame for the visible timers, which does not require an OpenGL context.
+
+namespace {
+
+constexpr int kNumPrimitivesPerFrame = 100'000;
+constexpr int kNumLayers = 4;
+const Color kColor(100, 181, 246, 255);
+
+float GetLayer(int i) { return static_cast<float>(i % kNumLayers); }
+
+Vec2 GetPos(int i) { return Vec2(static_cast<float>(i % 1920), static_cast<float>(i % 1080)); }
+
+void BM_AddBox(benchmark::State& state) {
+  Batcher batcher(BatcherId::kTimeGraph);
+  for (auto _ : state) {
+    batcher.StartNewFrame();
+    for (int i = 0; i < kNumPrimitivesPerFrame; ++i) {
+      batcher.AddBox(Box(GetPos(i), Vec2(10.f, 20.f), GetLayer(i)), kColor);
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * kNumPrimitivesPerFrame);
+}
+
+void BM_AddShadedBox(benchmark::State& state) {
+  Batcher batcher(BatcherId::kTimeGraph);
+  for (auto _ : state) {
+    batcher.StartNewFrame();
+    for (int i = 0; i < kNumPrimitivesPerFrame; ++i) {
+      batcher.AddShadedBox(GetPos(i), Vec2(10.f, 20.f), GetLayer(i), kColor);
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * kNumPrimitivesPerFrame);
+}
+
+void BM_AddShadedBoxWithUserData(benchmark::State& state) {
+  Batcher batcher(BatcherId::kTimeGraph);
+  for (auto _ : state) {
+    batcher.StartNewFrame();
+    const TooltipCallback* tooltip_callback = batcher.AddTooltipCallback(
+        [](const Batcher& /*batcher*/, PickingId /*id*/) { return std::string(); });
+    for (int i = 0; i < kNumPrimitivesPerFrame; ++i) {
+      batcher.AddShadedBox(GetPos(i), Vec2(10.f, 20.f), GetLayer(i), kColor,
+                           PickingUserData(nullptr, tooltip_callback, i));
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * kNumPrimitivesPerFrame);
+}
+
+void BM_AddVerticalLineAndSortByLayer(benchmark::State& state) {
+  Batcher batcher(BatcherId::kTimeGraph);
+  for (auto _ : state) {
+    batcher.StartNewFrame();
+    for (int i = 0; i < kNumPrimitivesPerFrame; ++i) {
+      batcher.AddVerticalLine(GetPos(i), 20.f, GetLayer(i), kColor);
+    }
+    benchmark::DoNotOptimize(batcher.GetLayers());
+  }
+  state.SetItemsProcessed(state.iterations() * kNumPrimitivesPerFrame);
+}
+
+}  // namespace
+
+BENCHMARK(BM_AddBox);
+BENCHMARK(BM_AddShadedBox);
+BENCHMARK(BM_AddShadedBoxWithUserData);
+BENCHMARK(BM_AddVerticalLineAndSortByLayer);
@@ -14,7 +14,6 @@
 #include <vector>
 
 #include "Batcher.h"
-#include "BlockChain.h"
 #include "CoreMath.h"
 #include "CoreUtils.h"
 #include "Geometry.h"
@@ -42,55 +41,24 @@ class MockBatcher : public Batcher {
   // buffers. Only a single color per element will be appended
   // (start point for line, first vertex for triangle and box)
   void Draw(bool picking = false) const override {
-    for (auto& [unused_layer, buffer] : primitive_buffers_by_layer_) {
-      if (picking) {
-        for (auto it = buffer.line_buffer.picking_colors_.begin();
-             it != buffer.line_buffer.picking_colors_.end();) {
-          drawn_line_colors_.push_back(*it);
-          ++it;
-          ++it;
-        }
-        for (auto it = buffer.triangle_buffer.picking_colors_.begin();
-             it != buffer.triangle_buffer.picking_colors_.end();) {
-          drawn_triangle_colors_.push_back(*it);
-          ++it;
-          ++it;
-          ++it;
-        }
-        for (auto it = buffer.box_buffer.picking_colors_.begin();
-             it != buffer.box_buffer.picking_colors_.end();) {
-          drawn_box_colors_.push_back(*it);
-          ++it;
-          ++it;
-          ++it;
-          ++it;
-        }
-      } else {
-        for (auto it = buffer.line_buffer.colors_.begin();
-             it != buffer.line_buffer.colors_.end();) {
-          drawn_line_colors_.push_back(*it);
-          ++it;
-          ++it;
-        }
-        for (auto it = buffer.triangle_buffer.colors_.begin();
-             it != buffer.triangle_buffer.colors_.end();) {
-          drawn_triangle_colors_.push_back(*it);
-          ++it;
-          ++it;
-          ++it;
-        }
-        for (auto it = buffer.box_buffer.colors_.begin(); it != buffer.box_buffer.colors_.end();) {
-          drawn_box_colors_.push_back(*it);
-          ++it;
-          ++it;
-          ++it;
-          ++it;
-        }
+    SortPrimitivesByLayer();
+    AppendDrawnColors(layered_lines_, 2, picking, &drawn_line_colors_);
+    AppendDrawnColors(layered_triangles_, 3, picking, &drawn_triangle_colors_);
+    AppendDrawnColors(layered_boxes_, 4, picking, &drawn_box_colors_);
+  }
+
+ private:
+  static void AppendDrawnColors(const LayeredPrimitiveBuffer& buffer, size_t vertices_per_primitive,
+                                bool picking, std::vector<Color>* drawn_colors) {
+    const std::vector<Color>& colors =
+        picking ? buffer.primitives.picking_colors : buffer.primitives.colors;
+    for (const LayeredPrimitiveBuffer::LayerRange& range : buffer.layer_ranges) {
+      for (size_t i = range.begin; i < range.end; ++i) {
+        drawn_colors->push_back(colors[i * vertices_per_primitive]);
       }
     }
   }
 
- private:
   mutable std::vector<Color> drawn_line_colors_;
   mutable std::vector<Color> drawn_triangle_colors_;
   mutable std::vector<Color> drawn_box_colors_;
@@ -137,39 +105,60 @@ TEST(Batcher, PickingElementsDrawing) {
   ExpectDraw(batcher, 0, 0, 0);
 }
 
-template <typename T>
-void ExpectCustomDataEq(const MockBatcher& batcher, const Color& rendered_color, const T& value) {
+TEST(Batcher, ElementsAreDrawnByIncreasingLayer) {
+  MockBatcher batcher(BatcherId::kUi);
+  const Color kRed(255, 0, 0, 255);
+  const Color kGreen(0, 255, 0, 255);
+  const Color kBlue(0, 0, 255, 255);
+
+  batcher.AddBox(Box(Vec2(0, 0), Vec2(1, 1), 2.f), kRed);
+  batcher.AddBox(Box(Vec2(0, 0), Vec2(1, 1), 1.f), kGreen);
+  batcher.AddBox(Box(Vec2(0, 0), Vec2(1, 1), 2.f), kBlue);
+  batcher.AddLine(Vec2(0, 0), Vec2(1, 0), 3.f, kRed);
+  EXPECT_EQ(batcher.GetNumBoxes(), 3);
+  EXPECT_EQ(batcher.GetNumLines(), 1);
+  EXPECT_EQ(batcher.GetNumTriangles(), 0);
+  EXPECT_EQ(batcher.GetLayers(), (std::vector<float>{1.f, 2.f, 3.f}));
+
+  ExpectDraw(batcher, 1, 0, 3);
+  // Elements of the same layer are drawn in the order in which they were added.
+  EXPECT_EQ(batcher.GetDrawnBoxColors(), (std::vector<Color>{kGreen, kRed, kBlue}));
+
+  // Elements added after drawing are drawn in the next call.
+  batcher.AddBox(Box(Vec2(0, 0), Vec2(1, 1), 0.f), kBlue);
+  ExpectDraw(batcher, 1, 0, 4);
+  EXPECT_EQ(batcher.GetDrawnBoxColors(), (std::vector<Color>{kBlue, kGreen, kRed, kBlue}));
+
+  batcher.StartNewFrame();
+  EXPECT_TRUE(batcher.GetLayers().empty());
+  ExpectDraw(batcher, 0, 0, 0);
+}
+
+void ExpectCustomIdEq(const MockBatcher& batcher, const Color& rendered_color, uint64_t value) {
   PickingId id = MockRenderPickingColor(rendered_color);
   const PickingUserData* rendered_data = batcher.GetUserData(id);
-  EXPECT_NE(rendered_data, nullptr);
-  EXPECT_NE(rendered_data->custom_data_, nullptr);
-  EXPECT_EQ(*static_cast<const T*>(rendered_data->custom_data_), value);
+  ASSERT_NE(rendered_data, nullptr);
+  EXPECT_EQ(rendered_data->custom_id_, value);
 }
 
 TEST(Batcher, PickingSimpleElements) {
   MockBatcher batcher(BatcherId::kUi);
 
-  std::string line_custom_data = "line custom data";
-  auto line_user_data = std::make_unique<PickingUserData>();
-  line_user_data->custom_data_ = &line_custom_data;
-
-  std::string triangle_custom_data = "triangle custom data";
-  auto triangle_user_data = std::make_unique<PickingUserData>();
-  triangle_user_data->custom_data_ = &triangle_custom_data;
+  constexpr uint64_t kLineCustomId = 42;
+  constexpr uint64_t kTriangleCustomId = 43;
+  constexpr uint64_t kBoxCustomId = 44;
 
-  std::string box_custom_data = "box custom data";
-  auto box_user_data = std::make_unique<PickingUserData>();
-  box_user_data->custom_data_ = &box_custom_data;
-
-  batcher.AddLine(Vec2(0, 0), Vec2(1, 0), 0, Color(255, 255, 255, 255), std::move(line_user_data));
+  batcher.AddLine(Vec2(0, 0), Vec2(1, 0), 0, Color(255, 255, 255, 255),
+                  PickingUserData(nullptr, nullptr, kLineCustomId));
   batcher.AddTriangle(Triangle(Vec3(0, 0, 0), Vec3(0, 1, 0), Vec3(1, 0, 0)), Color(0, 255, 0, 255),
-                      std::move(triangle_user_data));
-  batcher.AddBox(Box(Vec2(0, 0), Vec2(1, 1), 0), Color(255, 0, 0, 255), std::move(box_user_data));
+                      PickingUserData(nullptr, nullptr, kTriangleCustomId));
+  batcher.AddBox(Box(Vec2(0, 0), Vec2(1, 1), 0), Color(255, 0, 0, 255),
+                 PickingUserData(nullptr, nullptr, kBoxCustomId));
 
   batcher.Draw(true);
-  ExpectCustomDataEq(batcher, batcher.GetDrawnLineColors()[0], line_custom_data);
-  ExpectCustomDataEq(batcher, batcher.GetDrawnTriangleColors()[0], triangle_custom_data);
-  ExpectCustomDataEq(batcher, batcher.GetDrawnBoxColors()[0], box_custom_data);
+  ExpectCustomIdEq(batcher, batcher.GetDrawnLineColors()[0], kLineCustomId);
+  ExpectCustomIdEq(batcher, batcher.GetDrawnTriangleColors()[0], kTriangleCustomId);
+  ExpectCustomIdEq(batcher, batcher.GetDrawnBoxColors()[0], kBoxCustomId);
 }
 
 void ExpectPickableEq(const MockBatcher& batcher, const Color& rendered_color, PickingManager& pm,
@@ -202,36 +191,30 @@ TEST(Batcher, PickingPickables) {
 TEST(Batcher, MultipleDrawCalls) {
   MockBatcher batcher(BatcherId::kUi);
 
-  std::string line_custom_data = "line custom data";
-  auto line_user_data = std::make_unique<PickingUserData>();
-  line_user_data->custom_data_ = &line_custom_data;
-
-  std::string triangle_custom_data = "triangle custom data";
-  auto triangle_user_data = std::make_unique<PickingUserData>();
-  triangle_user_data->custom_data_ = &triangle_custom_data;
+  constexpr uint64_t kLineCustomId = 42;
+  constexpr uint64_t kTriangleCustomId = 43;
+  constexpr uint64_t kBoxCustomId = 44;
 
-  std::string box_custom_data = "box custom data";
-  auto box_user_data = std::make_unique<PickingUserData>();
-  box_user_data->custom_data_ = &box_custom_data;
-
-  batcher.AddLine(Vec2(0, 0), Vec2(1, 0), 0, Color(255, 255, 255, 255), std::move(line_user_data));
+  batcher.AddLine(Vec2(0, 0), Vec2(1, 0), 0, Color(255, 255, 255, 255),
+                  PickingUserData(nullptr, nullptr, kLineCustomId));
   batcher.AddTriangle(Triangle(Vec3(0, 0, 0), Vec3(0, 1, 0), Vec3(1, 0, 0)), Color(0, 255, 0, 255),
-                      std::move(triangle_user_data));
-  batcher.AddBox(Box(Vec2(0, 0), Vec2(1, 1), 0), Color(255, 0, 0, 255), std::move(box_user_data));
+                      PickingUserData(nullptr, nullptr, kTriangleCustomId));
+  batcher.AddBox(Box(Vec2(0, 0), Vec2(1, 1), 0), Color(255, 0, 0, 255),
+                 PickingUserData(nullptr, nullptr, kBoxCustomId));
 
   batcher.Draw(true);
 
   auto line_color = batcher.GetDrawnLineColors()[0];
   auto triangle_color = batcher.GetDrawnTriangleColors()[0];
   auto box_color = batcher.GetDrawnBoxColors()[0];
-  ExpectCustomDataEq(batcher, line_color, line_custom_data);
-  ExpectCustomDataEq(batcher, triangle_color, triangle_custom_data);
-  ExpectCustomDataEq(batcher, box_color, box_custom_data);
+  ExpectCustomIdEq(batcher, line_color, kLineCustomId);
+  ExpectCustomIdEq(batcher, triangle_color, kTriangleCustomId);
+  ExpectCustomIdEq(batcher, box_color, kBoxCustomId);
 
   batcher.ResetElements();
-  ExpectCustomDataEq(batcher, line_color, line_custom_data);
-  ExpectCustomDataEq(batcher, triangle_color, triangle_custom_data);
-  ExpectCustomDataEq(batcher, box_color, box_custom_data);
+  ExpectCustomIdEq(batcher, line_color, kLineCustomId);
+  ExpectCustomIdEq(batcher, triangle_color, kTriangleCustomId);
+  ExpectCustomIdEq(batcher, box_color, kBoxCustomId);
 
   batcher.StartNewFrame();
   PickingId id = MockRenderPickingColor(line_color);
@@ -244,4 +227,98 @@ TEST(Batcher, MultipleDrawCalls) {
   UNUSED(rendered_data);
 }
 
-}  // namespace
\ No newline at end of file
+TEST(Batcher, TooltipCallbacksAreSharedAndLiveForOneFrame) {
+  MockBatcher batcher(BatcherId::kUi);
+
+  const TooltipCallback* tooltip_callback =
+      batcher.AddTooltipCallback([](const Batcher& picked_batcher, PickingId id) {
+        return std::to_string(picked_batcher.GetUserData(id)->custom_id_);
+      });
+  ASSERT_NE(tooltip_callback, nullptr);
+  batcher.AddBox(Box(Vec2(0, 0), Vec2(1, 1), 0), Color(255, 0, 0, 255),
+                 PickingUserData(nullptr, tooltip_callback, 1));
+  batcher.AddBox(Box(Vec2(0, 0), Vec2(1, 1), 0), Color(0, 255, 0, 255),
+                 PickingUserData(nullptr, tooltip_callback, 2));
+
+  batcher.Draw(true);
+  ASSERT_EQ(batcher.GetDrawnBoxColors().size(), 2);
+  for (const Color& color : batcher.GetDrawnBoxColors()) {
+    PickingId id = MockRenderPickingColor(color);
+    const PickingUserData* user_data = batcher.GetUserData(id);
+    ASSERT_NE(user_data, nullptr);
+    EXPECT_EQ(user_data->generate_tooltip_, tooltip_callback);
+    EXPECT_EQ((*user_data->generate_tooltip_)(batcher, id), std::to_string(user_data->custom_id_));
+  }
+}
+
+TEST(Batcher, MergedElementsKeepTheirUserDataAndTooltipCallbacks) {
+  PickingManager pm;
+  MockBatcher batcher(BatcherId::kUi, &pm);
+  MockBatcher other_batcher(BatcherId::kUi, &pm);
+  std::shared_ptr<PickableMock> pickable = std::make_shared<PickableMock>();
+
+  constexpr uint64_t kBoxCustomId = 42;
+  constexpr uint64_t kOtherBoxCustomId = 43;
+  constexpr uint64_t kOtherLineCustomId = 44;
+
+  batcher.AddBox(Box(Vec2(0, 0), Vec2(1, 1), 1), Color(255, 0, 0, 255),
+                 PickingUserData(nullptr, nullptr, kBoxCustomId));
+  const TooltipCallback* tooltip_callback =
+      other_batcher.AddTooltipCallback([](const Batcher& /*picked_batcher*/, PickingId /*id*/) {
+        return std::string("tooltip");
+      });
+  other_batcher.AddBox(Box(Vec2(0, 0), Vec2(1, 1), 0), Color(0, 255, 0, 255),
+                       PickingUserData(nullptr, tooltip_callback, kOtherBoxCustomId));
+  other_batcher.AddLine(Vec2(0, 0), Vec2(1, 0), 0, Color(255, 255, 255, 255),
+                        PickingUserData(nullptr, nullptr, kOtherLineCustomId));
+  other_batcher.AddTriangle(Triangle(Vec3(0, 0, 0), Vec3(0, 1, 0), Vec3(1, 0, 0)),
+                            Color(0, 255, 0, 255), pickable);
+
+  batcher.MergeFrom(&other_batcher);
+  ExpectDraw(other_batcher, 0, 0, 0);
+
+  batcher.Draw(true);
+  // The boxes are drawn by increasing layer.
+  ASSERT_EQ(batcher.GetDrawnBoxColors().size(), 2);
+  ExpectCustomIdEq(batcher, batcher.GetDrawnBoxColors()[0], kOtherBoxCustomId);
+  ExpectCustomIdEq(batcher, batcher.GetDrawnBoxColors()[1], kBoxCustomId);
+  ExpectCustomIdEq(batcher, batcher.GetDrawnLineColors()[0], kOtherLineCustomId);
+  ExpectPickableEq(batcher, batcher.GetDrawnTriangleColors()[0], pm, pickable);
+
+  const PickingUserData* user_data =
+      batcher.GetUserData(MockRenderPickingColor(batcher.GetDrawnBoxColors()[0]));
+  ASSERT_NE(user_data, nullptr);
+  ASSERT_EQ(user_data->generate_tooltip_, tooltip_callback);
+  EXPECT_EQ((*user_data->generate_tooltip_)(batcher, PickingId{}), "tooltip");
+}
+
+TEST(Batcher, TooltipCallbacksLookUpTheUserDataInTheBatcherTheyAreCalledWith) {
+  MockBatcher batcher(BatcherId::kUi);
+  MockBatcher other_batcher(BatcherId::kUi);
+
+  constexpr uint64_t kBoxCustomId = 42;
+  constexpr uint64_t kOtherBoxCustomId = 43;
+
+  batcher.AddBox(Box(Vec2(0, 0), Vec2(1, 1), 0), Color(255, 0, 0, 255),
+                 PickingUserData(nullptr, nullptr, kBoxCustomId));
+  const TooltipCallback* tooltip_callback =
+      other_batcher.AddTooltipCallback([](const Batcher& picked_batcher, PickingId id) {
+        const PickingUserData* user_data = picked_batcher.GetUserData(id);
+        return user_data == nullptr ? std::string() : std::to_string(user_data->custom_id_);
+      });
+  other_batcher.AddBox(Box(Vec2(0, 0), Vec2(1, 1), 1), Color(0, 255, 0, 255),
+                       PickingUserData(nullptr, tooltip_callback, kOtherBoxCustomId));
+
+  // After the merge, the picking id of the box of `other_batcher` is offset and `other_batcher` is
+  // empty, so the callback has to use the Batcher the box is picked from.
+  batcher.MergeFrom(&other_batcher);
+  batcher.Draw(true);
+  ASSERT_EQ(batcher.GetDrawnBoxColors().size(), 2);
+  const PickingId id = MockRenderPickingColor(batcher.GetDrawnBoxColors()[1]);
+  const PickingUserData* user_data = batcher.GetUserData(id);
+  ASSERT_NE(user_data, nullptr);
+  ASSERT_EQ(user_data->generate_tooltip_, tooltip_callback);
+  EXPECT_EQ((*user_data->generate_tooltip_)(batcher, id), std::to_string(kOtherBoxCustomId));
+}
+
+}  // namespace
@@ -90,14 +90,17 @@ static void AddCallstackToTopDownThread(CallTreeThread* thread_node,
                                         const CallStack& resolved_callstack,
                                         uint64_t callstack_sample_count,
                                         const CaptureData& capture_data) {
+  const std::vector<uint64_t>& frames = resolved_callstack.frames();
+  const std::vector<const std::string*> function_names =
+      capture_data.GetFunctionNamesByAddresses(frames);
+  const std::vector<const std::string*> module_paths =
+      capture_data.GetModulePathsByAddresses(frames);
+
   CallTreeNode* current_thread_or_function = thread_node;
-  for (auto frame_it = resolved_callstack.frames().crbegin();
-       frame_it != resolved_callstack.frames().crend(); ++frame_it) {
-    uint64_t frame = *frame_it;
-    const std::string& function_name = capture_data.GetFunctionNameByAddress(frame);
-    const std::string& module_path = capture_data.GetModulePathByAddress(frame);
-    CallTreeFunction* function_node =
-        GetOrCreateFunctionNode(current_thread_or_function, frame, function_name, module_path);
+  for (size_t i = frames.size(); i > 0; --i) {
+    const uint64_t frame = frames[i - 1];
+    CallTreeFunction* function_node = GetOrCreateFunctionNode(
+        current_thread_or_function, frame, *function_names[i - 1], *module_paths[i - 1]);
     function_node->IncreaseSampleCount(callstack_sample_count);
     current_thread_or_function = function_node;
   }
@@ -151,12 +154,16 @@ std::unique_ptr<CallTreeView> CallTreeView::CreateTopDownViewFromSamplingProfile
 [[nodiscard]] static CallTreeNode* AddReversedCallstackToBottomUpViewAndReturnLastFunction(
     CallTreeView* bottom_up_view, const CallStack& resolved_callstack,
     uint64_t callstack_sample_count, const CaptureData& capture_data) {
+  const std::vector<uint64_t>& frames = resolved_callstack.frames();
+  const std::vector<const std::string*> function_names =
+      capture_data.GetFunctionNamesByAddresses(frames);
+  const std::vector<const std::string*> module_paths =
+      capture_data.GetModulePathsByAddresses(frames);
+
   CallTreeNode* current_node = bottom_up_view;
-  for (uint64_t frame : resolved_callstack.frames()) {
-    const std::string& function_name = capture_data.GetFunctionNameByAddress(frame);
-    const std::string& module_path = capture_data.GetModulePathByAddress(frame);
+  for (size_t i = 0; i < frames.size(); ++i) {
     CallTreeFunction* function_node =
-        GetOrCreateFunctionNode(current_node, frame, function_name, module_path);
+        GetOrCreateFunctionNode(current_node, frames[i], *function_names[i], *module_paths[i]);
     function_node->IncreaseSampleCount(callstack_sample_count);
     current_node = function_node;
   }
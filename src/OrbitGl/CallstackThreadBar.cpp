@@ -8,7 +8,9 @@
 #include <stddef.h>
 
 #include <algorithm>
+#include <limits>
 #include <memory>
+#include <optional>
 #include <utility>
 #include <vector>
 
@@ -21,6 +23,7 @@
 #include "OrbitBase/ThreadConstants.h"
 #include "OrbitClientData/Callstack.h"
 #include "OrbitClientData/CallstackData.h"
+#include "OrbitClientData/SampleCountHistograms.h"
 #include "OrbitClientModel/CaptureData.h"
 #include "PickingManager.h"
 #include "TimeGraph.h"
@@ -100,28 +103,49 @@ void CallstackThreadBar::UpdatePrimitives(Batcher* batcher, uint64_t min_tick, u
   const Color kGreenSelection(0, 255, 0, 255);
   CHECK(capture_data_ != nullptr);
 
-  if (!picking) {
-    // Sampling Events
-    auto action_on_callstack_events = [=](const orbit_client_protos::CallstackEvent& event) {
-      const uint64_t time = event.time();
-      CHECK(time >= min_tick && time <= max_tick);
-      Vec2 pos(time_graph_->GetWorldFromTick(time), pos_[1]);
-      batcher->AddVerticalLine(pos, -track_height, z, kWhite);
-    };
+  // Samples that fall into the same pixel column are drawn over each other, so only the first
+  // sample of each column is drawn. The events of each thread are visited in order of time.
+  const TimeGraphView& view = time_graph_->GetPrimitivesView();
+  const uint64_t ticks_per_pixel =
+      std::max<uint64_t>((max_tick - min_tick) / std::max(view.screen_width, 1), 1);
+  uint64_t last_drawn_column = std::numeric_limits<uint64_t>::max();
+  auto is_in_last_drawn_column = [min_tick, ticks_per_pixel, &last_drawn_column](uint64_t time) {
+    const uint64_t column = (time - min_tick) / ticks_per_pixel;
+    if (column == last_drawn_column) return true;
+    last_drawn_column = column;
+    return false;
+  };
 
-    if (thread_id_ == orbit_base::kAllProcessThreadsTid) {
-      capture_data_->GetCallstackData()->ForEachCallstackEventInTimeRange(
-          min_tick, max_tick, action_on_callstack_events);
+  if (!picking) {
+    // When zoomed out so far that the buckets of the sample count histograms are not wider than a
+    // pixel, the density of the samples is drawn instead of the samples themselves.
+    std::optional<size_t> level =
+        SampleCountHistograms::GetCoarsestLevelNotWiderThan(ticks_per_pixel);
+    if (level.has_value()) {
+      DrawSampleDensity(batcher, min_tick, max_tick, ticks_per_pixel, level.value(), z);
     } else {
-      capture_data_->GetCallstackData()->ForEachCallstackEventOfTidInTimeRange(
-          thread_id_, min_tick, max_tick, action_on_callstack_events);
+      // Sampling Events
+      auto action_on_callstack_events = [&](const orbit_client_protos::CallstackEvent& event) {
+        const uint64_t time = event.time();
+        CHECK(time >= min_tick && time <= max_tick);
+        if (is_in_last_drawn_column(time)) return;
+        Vec2 pos(view.GetWorldFromTick(time), pos_[1]);
+        batcher->AddVerticalLine(pos, -track_height, z, kWhite);
+      };
+      if (thread_id_ == orbit_base::kAllProcessThreadsTid) {
+        capture_data_->GetCallstackData()->ForEachCallstackEventInTimeRange(
+            min_tick, max_tick, action_on_callstack_events);
+      } else {
+        capture_data_->GetCallstackData()->ForEachCallstackEventOfTidInTimeRange(
+            thread_id_, min_tick, max_tick, action_on_callstack_events);
+      }
     }
 
     // Draw selected events
     std::array<Color, 2> selected_color;
     Fill(selected_color, kGreenSelection);
     for (const CallstackEvent& event : time_graph_->GetSelectedCallstackEvents(thread_id_)) {
-      Vec2 pos(time_graph_->GetWorldFromTick(event.time()), pos_[1]);
+      Vec2 pos(view.GetWorldFromTick(event.time()), pos_[1]);
       batcher->AddVerticalLine(pos, -track_height, z, kGreenSelection);
     }
   } else {
@@ -129,17 +153,17 @@ void CallstackThreadBar::UpdatePrimitives(Batcher* batcher, uint64_t min_tick, u
     // cause samples to overlap
     constexpr const float kPickingBoxWidth = 9.0f;
     constexpr const float kPickingBoxOffset = (kPickingBoxWidth - 1.0f) / 2.0f;
+    const TooltipCallback* tooltip_callback = batcher->AddTooltipCallback(
+        [this](const Batcher& batcher, PickingId id) { return GetSampleTooltip(batcher, id); });
 
-    auto action_on_callstack_events = [=](const orbit_client_protos::CallstackEvent& event) {
+    auto action_on_callstack_events = [&](const orbit_client_protos::CallstackEvent& event) {
       const uint64_t time = event.time();
       CHECK(time >= min_tick && time <= max_tick);
-      Vec2 pos(time_graph_->GetWorldFromTick(time) - kPickingBoxOffset, pos_[1] - track_height + 1);
+      if (is_in_last_drawn_column(time)) return;
+      Vec2 pos(view.GetWorldFromTick(time) - kPickingBoxOffset, pos_[1] - track_height + 1);
       Vec2 size(kPickingBoxWidth, track_height);
-      auto user_data = std::make_unique<PickingUserData>(
-          nullptr,
-          [this, batcher](PickingId id) -> std::string { return GetSampleTooltip(*batcher, id); });
-      user_data->custom_data_ = &event;
-      batcher->AddShadedBox(pos, size, z, kGreenSelection, std::move(user_data));
+      batcher->AddShadedBox(pos, size, z, kGreenSelection,
+                            PickingUserData(nullptr, tooltip_callback, event.callstack_id()));
     };
     if (thread_id_ == orbit_base::kAllProcessThreadsTid) {
       capture_data_->GetCallstackData()->ForEachCallstackEventInTimeRange(
@@ -151,6 +175,41 @@ void CallstackThreadBar::UpdatePrimitives(Batcher* batcher, uint64_t min_tick, u
   }
 }
 
+void CallstackThreadBar::DrawSampleDensity(Batcher* batcher, uint64_t min_tick, uint64_t max_tick,
+                                           uint64_t ticks_per_pixel, size_t level, float z) {
+  // The buckets are at most one pixel wide, so each bucket is counted in the pixel column of its
+  // center.
+  const uint64_t bucket_width = SampleCountHistograms::GetBucketWidthNs(level);
+  std::vector<uint32_t> counts_per_column((max_tick - min_tick) / ticks_per_pixel + 1, 0);
+  auto add_to_column = [&](uint64_t bucket_begin, uint32_t count) {
+    const uint64_t bucket_center = std::clamp(bucket_begin + bucket_width / 2, min_tick, max_tick);
+    counts_per_column[(bucket_center - min_tick) / ticks_per_pixel] += count;
+  };
+  if (thread_id_ == orbit_base::kAllProcessThreadsTid) {
+    capture_data_->GetCallstackData()->ForEachSampleCountInTimeRange(level, min_tick, max_tick,
+                                                                     add_to_column);
+  } else {
+    capture_data_->GetCallstackData()->ForEachSampleCountOfTidInTimeRange(
+        thread_id_, level, min_tick, max_tick, add_to_column);
+  }
+
+  // The height of the bars is relative to the column with the most samples, but even columns with
+  // a single sample stay visible.
+  constexpr float kMinDensityBarHeightFraction = 0.2f;
+  const Color kWhite(255, 255, 255, 255);
+  const float track_height = layout_->GetEventTrackHeight();
+  const uint32_t max_count = *std::max_element(counts_per_column.begin(), counts_per_column.end());
+  for (size_t column = 0; column < counts_per_column.size(); ++column) {
+    const uint32_t count = counts_per_column[column];
+    if (count == 0) continue;
+    const uint64_t time = std::min(min_tick + column * ticks_per_pixel, max_tick);
+    const float height_fraction = std::max(
+        static_cast<float>(count) / static_cast<float>(max_count), kMinDensityBarHeightFraction);
+    Vec2 pos(time_graph_->GetPrimitivesView().GetWorldFromTick(time), pos_[1] - track_height);
+    batcher->AddVerticalLine(pos, track_height * height_fraction, z, kWhite);
+  }
+}
+
 void CallstackThreadBar::OnRelease() {
   CaptureViewElement::OnRelease();
   SelectCallstacks();
@@ -223,16 +282,15 @@ std::string CallstackThreadBar::FormatCallstackForTooltip(const CallStack& calls
 std::string CallstackThreadBar::GetSampleTooltip(const Batcher& batcher, PickingId id) const {
   static const std::string unknown_return_text = "Function call information missing";
 
-  auto user_data = batcher.GetUserData(id);
-  if (user_data == nullptr || user_data->custom_data_ == nullptr) {
+  const PickingUserData* user_data = batcher.GetUserData(id);
+  if (user_data == nullptr) {
     return unknown_return_text;
   }
 
   CHECK(capture_data_ != nullptr);
   const CallstackData* callstack_data = capture_data_->GetCallstackData();
-  const auto* callstack_event = static_cast<const CallstackEvent*>(user_data->custom_data_);
 
-  uint64_t callstack_id = callstack_event->callstack_id();
+  uint64_t callstack_id = user_data->custom_id_;
   const CallStack* callstack = callstack_data->GetCallStack(callstack_id);
   if (callstack == nullptr) {
     return unknown_return_text;
@@ -49,6 +49,11 @@ class CallstackThreadBar : public ThreadBar {
 
   [[nodiscard]] std::string GetSampleTooltip(const Batcher& batcher, PickingId id) const;
 
+  // Draws one bar per pixel column, with a height that depends on the number of samples in it, from
+  // `level` of the sample count histograms.
+  void DrawSampleDensity(Batcher* batcher, uint64_t min_tick, uint64_t max_tick,
+                         uint64_t ticks_per_pixel, size_t level, float z);
+
   Color color_;
 };
 
@@ -238,12 +238,10 @@ void CaptureWindow::SelectTextBox(const TextBox* text_box) {
   if (text_box == nullptr) return;
 
   app_->SelectTextBox(text_box);
-  app_->set_selected_thread_id(text_box->GetTimerInfo().thread_id());
-
-  const TimerInfo& timer_info = text_box->GetTimerInfo();
+  app_->set_selected_thread_id(text_box->GetThreadId());
 
   if (double_clicking_) {
-    time_graph_->Zoom(timer_info);
+    time_graph_->Zoom(text_box->GetTimerInfo());
   }
 }
 
@@ -264,16 +262,21 @@ void CaptureWindow::Hover(int x, int y) {
       tooltip = pickable->GetTooltip();
     }
   } else {
-    PickingUserData* user_data = batcher.GetUserData(pick_id);
+    const PickingUserData* user_data = batcher.GetUserData(pick_id);
 
     if (user_data && user_data->generate_tooltip_) {
-      tooltip = user_data->generate_tooltip_(pick_id);
+      tooltip = (*user_data->generate_tooltip_)(batcher, pick_id);
     }
   }
 
   app_->SendTooltipToUi(tooltip);
 }
 
+bool CaptureWindow::IsRedrawNeeded() const {
+  // The time graph also needs a redraw when new primitives are ready to be drawn.
+  return GlCanvas::IsRedrawNeeded() || (time_graph_ != nullptr && time_graph_->IsRedrawNeeded());
+}
+
 void CaptureWindow::PreRender() {
   // TODO: Move to GlCanvas?
   if (is_mouse_over_ && can_hover_ && hover_timer_.ElapsedMillis() > hover_delay_ms_) {
@@ -775,8 +778,10 @@ void CaptureWindow::RenderImGuiDebugUI() {
       IMGUI_VAR_TO_TEXT(time_graph_->GetTimeWindowUs());
       const CaptureData* capture_data = time_graph_->GetCaptureData();
       if (capture_data != nullptr) {
-        IMGUI_VAR_TO_TEXT(capture_data->GetCallstackData()->callstack_events_by_tid().size());
-        IMGUI_VAR_TO_TEXT(capture_data->GetCallstackData()->GetCallstackEventsCount());
+        const CallstackData* callstack_data = capture_data->GetCallstackData();
+        IMGUI_VAR_TO_TEXT(callstack_data->GetCallstackEventsCountsPerTid().size());
+        IMGUI_VAR_TO_TEXT(callstack_data->GetCallstackEventsCount());
+        IMGUI_VAR_TO_TEXT(callstack_data->GetCallstackEventsAllocatedBytes());
       }
     }
   }
@@ -53,6 +53,7 @@ class CaptureWindow : public GlCanvas {
   void RenderText(float layer) override;
   void PreRender() override;
   void PostRender() override;
+  [[nodiscard]] bool IsRedrawNeeded() const override;
   void Resize(int width, int height) override;
   void RenderHelpUi();
   void RenderTimeBar();
@@ -5,6 +5,7 @@
 #include "DataManager.h"
 
 #include <absl/container/flat_hash_set.h>
+#include <absl/synchronization/mutex.h>
 
 #include <utility>
 
@@ -27,41 +28,45 @@ void DataManager::DeselectFunction(const FunctionInfo& function) {
 
 void DataManager::set_visible_function_ids(absl::flat_hash_set<uint64_t> visible_function_ids) {
   CHECK(std::this_thread::get_id() == main_thread_id_);
+  absl::MutexLock lock(&view_state_mutex_);
   visible_function_ids_ = std::move(visible_function_ids);
 }
 
 void DataManager::set_highlighted_function_id(uint64_t highlighted_function_id) {
   CHECK(std::this_thread::get_id() == main_thread_id_);
+  absl::MutexLock lock(&view_state_mutex_);
   highlighted_function_id_ = highlighted_function_id;
 }
 
 void DataManager::set_selected_thread_id(int32_t thread_id) {
   CHECK(std::this_thread::get_id() == main_thread_id_);
+  absl::MutexLock lock(&view_state_mutex_);
   selected_thread_id_ = thread_id;
 }
 
 bool DataManager::IsFunctionVisible(uint64_t function_id) const {
-  CHECK(std::this_thread::get_id() == main_thread_id_);
+  absl::MutexLock lock(&view_state_mutex_);
   return visible_function_ids_.contains(function_id);
 }
 
 uint64_t DataManager::highlighted_function_id() const {
-  CHECK(std::this_thread::get_id() == main_thread_id_);
+  absl::MutexLock lock(&view_state_mutex_);
   return highlighted_function_id_;
 }
 
 int32_t DataManager::selected_thread_id() const {
-  CHECK(std::this_thread::get_id() == main_thread_id_);
+  absl::MutexLock lock(&view_state_mutex_);
   return selected_thread_id_;
 }
 
 const TextBox* DataManager::selected_text_box() const {
-  CHECK(std::this_thread::get_id() == main_thread_id_);
+  absl::MutexLock lock(&view_state_mutex_);
   return selected_text_box_;
 }
 
 void DataManager::set_selected_text_box(const TextBox* text_box) {
   CHECK(std::this_thread::get_id() == main_thread_id_);
+  absl::MutexLock lock(&view_state_mutex_);
   selected_text_box_ = text_box;
 }
 
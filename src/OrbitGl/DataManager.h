@@ -7,6 +7,7 @@
 
 #include <absl/container/flat_hash_set.h>
 #include <absl/container/node_hash_map.h>
+#include <absl/synchronization/mutex.h>
 
 #include <cstdint>
 #include <thread>
@@ -23,7 +24,9 @@
 // This class is responsible for storing and
 // navigating data on the client side. Note that
 // every method of this class should be called
-// on the main thread.
+// on the main thread, except for the getters of the
+// state the tracks read while updating their
+// primitives, which happens on other threads.
 
 class DataManager final {
  public:
@@ -84,13 +87,17 @@ class DataManager final {
  private:
   const std::thread::id main_thread_id_;
   FunctionInfoSet selected_functions_;
-  absl::flat_hash_set<uint64_t> visible_function_ids_;
-  uint64_t highlighted_function_id_ = orbit_grpc_protos::kInvalidFunctionId;
+
+  // Only modified on the main thread, but read by the tracks while updating their primitives.
+  mutable absl::Mutex view_state_mutex_;
+  absl::flat_hash_set<uint64_t> visible_function_ids_ ABSL_GUARDED_BY(view_state_mutex_);
+  uint64_t highlighted_function_id_ ABSL_GUARDED_BY(view_state_mutex_) =
+      orbit_grpc_protos::kInvalidFunctionId;
 
   TracepointInfoSet selected_tracepoints_;
 
-  int32_t selected_thread_id_ = -1;
-  const TextBox* selected_text_box_ = nullptr;
+  int32_t selected_thread_id_ ABSL_GUARDED_BY(view_state_mutex_) = -1;
+  const TextBox* selected_text_box_ ABSL_GUARDED_BY(view_state_mutex_) = nullptr;
 
   // DataManager needs a copy of this so that we can persist user choices like frame tracks between
   // captures.
@@ -102,7 +102,8 @@ float FrameTrack::GetTextBoxHeight(const TimerInfo& timer_info) const {
 }
 
 Color FrameTrack::GetTimerColor(const orbit_client_protos::TimerInfo& timer_info,
-                                bool /*is_selected*/, bool /*is_highlighted*/) const {
+                                bool /*is_selected*/, bool /*is_highlighted*/,
+                                const internal::DrawData& /*draw_data*/) const {
   Vec4 min_color(76.f, 175.f, 80.f, 255.f);
   Vec4 max_color(63.f, 81.f, 181.f, 255.f);
   Vec4 warn_color(244.f, 67.f, 54.f, 255.f);
@@ -158,24 +159,16 @@ void FrameTrack::OnTimer(const TimerInfo& timer_info) {
 }
 
 void FrameTrack::SetTimesliceText(const TimerInfo& timer_info, double elapsed_us, float min_x,
-                                  float z_offset, TextBox* text_box) {
-  if (text_box->GetText().empty()) {
-    std::string time = GetPrettyTime(absl::Microseconds(elapsed_us));
-    text_box->SetElapsedTimeTextLength(time.length());
-
-    std::string text = absl::StrFormat("Frame #%u: %s", timer_info.user_data_key(), time.c_str());
-    text_box->SetText(text);
-  }
+                                  float z_offset, const Vec2& box_pos, const Vec2& box_size) {
+  std::string time = GetPrettyTime(absl::Microseconds(elapsed_us));
+  std::string text = absl::StrFormat("Frame #%u: %s", timer_info.user_data_key(), time.c_str());
 
   const Color kTextWhite(255, 255, 255, 255);
-  const Vec2& box_pos = text_box->GetPos();
-  const Vec2& box_size = text_box->GetSize();
   float pos_x = std::max(box_pos[0], min_x);
   float max_size = box_pos[0] + box_size[0] - pos_x;
-  text_renderer_->AddTextTrailingCharsPrioritized(
-      text_box->GetText().c_str(), pos_x, text_box->GetPos()[1] + layout_->GetTextOffset(),
-      GlCanvas::kZValueBox + z_offset, kTextWhite, text_box->GetElapsedTimeTextLength(),
-      layout_->CalculateZoomedFontSize(), max_size);
+  time_graph_->GetPrimitivesTextRenderer()->AddTextTrailingCharsPrioritized(
+      text.c_str(), pos_x, box_pos[1] + layout_->GetTextOffset(), GlCanvas::kZValueBox + z_offset,
+      kTextWhite, time.length(), layout_->CalculateZoomedFontSize(), max_size);
 }
 
 std::string FrameTrack::GetTooltip() const {
@@ -224,8 +217,7 @@ std::string FrameTrack::GetBoxTooltip(const Batcher& batcher, PickingId id) cons
       "<b>Frame time:</b> %s",
       function_name, kHeightCapAverageMultipleUint64, function_name,
       function_utils::GetLoadedModuleName(function_), text_box->GetTimerInfo().user_data_key(),
-      GetPrettyTime(
-          TicksToDuration(text_box->GetTimerInfo().start(), text_box->GetTimerInfo().end())));
+      GetPrettyTime(TicksToDuration(text_box->Start(), text_box->End())));
 }
 
 void FrameTrack::Draw(GlCanvas* canvas, PickingMode picking_mode, float z_offset) {
@@ -40,7 +40,7 @@ class FrameTrack : public TimerTrack {
   [[nodiscard]] float GetHeaderHeight() const override;
 
   void SetTimesliceText(const orbit_client_protos::TimerInfo& timer, double elapsed_us, float min_x,
-                        float z_offset, TextBox* text_box) override;
+                        float z_offset, const Vec2& box_pos, const Vec2& box_size) override;
   [[nodiscard]] std::string GetTooltip() const override;
   [[nodiscard]] std::string GetBoxTooltip(const Batcher& batcher, PickingId id) const override;
 
@@ -52,7 +52,8 @@ class FrameTrack : public TimerTrack {
 
  protected:
   [[nodiscard]] Color GetTimerColor(const orbit_client_protos::TimerInfo& timer_info,
-                                    bool is_selected, bool is_highlighted) const override;
+                                    bool is_selected, bool is_highlighted,
+                                    const internal::DrawData& draw_data) const override;
   [[nodiscard]] float GetHeight() const override;
 
  private:
@@ -301,11 +301,7 @@ void GlCanvas::Prepare2DViewport(int top_left_x, int top_left_y, int bottom_righ
   glMatrixMode(GL_PROJECTION);
   glLoadIdentity();
 
-  world_width_ = static_cast<float>(screen_width_);
-  world_height_ = static_cast<float>(screen_height_);
-
-  if (world_width_ <= 0) world_width_ = 1.f;
-  if (world_height_ <= 0) world_height_ = 1.f;
+  UpdateWorldSize();
 
   glOrtho(world_top_left_x_, world_top_left_x_ + world_width_, world_top_left_y_ - world_height_,
           world_top_left_y_, -1, 1);
@@ -313,6 +309,16 @@ void GlCanvas::Prepare2DViewport(int top_left_x, int top_left_y, int bottom_righ
   glLoadIdentity();
 }
 
+// The world has the size of the screen, so that one world unit is one pixel. Also updated on
+// resize, so that the world size is known before anything is rendered.
+void GlCanvas::UpdateWorldSize() {
+  world_width_ = static_cast<float>(screen_width_);
+  world_height_ = static_cast<float>(screen_height_);
+
+  if (world_width_ <= 0) world_width_ = 1.f;
+  if (world_height_ <= 0) world_height_ = 1.f;
+}
+
 void GlCanvas::PrepareScreenSpaceViewport() {
   ORBIT_SCOPE_FUNCTION;
   glViewport(0, 0, GetWidth(), GetHeight());
@@ -439,6 +445,7 @@ void GlCanvas::Render(int width, int height) {
 void GlCanvas::Resize(int width, int height) {
   screen_width_ = width;
   screen_height_ = height;
+  UpdateWorldSize();
   RequestRedraw();
 }
 
@@ -216,6 +216,8 @@ class GlCanvas {
   std::vector<RenderCallback> render_callbacks_;
 
  private:
+  void UpdateWorldSize();
+
   [[nodiscard]] virtual std::unique_ptr<orbit_accessibility::AccessibleWidgetBridge>
   CreateAccessibilityInterface();
 };
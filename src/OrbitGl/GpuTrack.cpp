@@ -68,7 +68,6 @@ std::string MapGpuTimelineToTrackLabel(std::string_view timeline) {
 GpuTrack::GpuTrack(TimeGraph* time_graph, TimeGraphLayout* layout, uint64_t timeline_hash,
                    OrbitApp* app, const CaptureData* capture_data)
     : TimerTrack(time_graph, layout, app, capture_data) {
-  text_renderer_ = time_graph->GetTextRenderer();
   timeline_hash_ = timeline_hash;
   string_manager_ = app->GetStringManager();
 
@@ -95,18 +94,20 @@ void GpuTrack::OnTimer(const orbit_client_protos::TimerInfo& timer_info) {
   TimerTrack::OnTimer(timer_info);
 }
 
-bool GpuTrack::IsTimerActive(const TimerInfo& timer_info) const {
-  bool is_same_tid_as_selected = timer_info.thread_id() == app_->selected_thread_id();
+bool GpuTrack::IsTimerActive(const TimerInfo& timer_info,
+                             const internal::DrawData& draw_data) const {
+  bool is_same_tid_as_selected = timer_info.thread_id() == draw_data.selected_thread_id;
   // We do not properly track the PID for GPU jobs and we still want to show
   // all jobs as active when no thread is selected, so this logic is a bit
   // different than SchedulerTrack::IsTimerActive.
-  bool no_thread_selected = app_->selected_thread_id() == orbit_base::kAllProcessThreadsTid;
+  bool no_thread_selected = draw_data.selected_thread_id == orbit_base::kAllProcessThreadsTid;
 
   return is_same_tid_as_selected || no_thread_selected;
 }
 
 Color GpuTrack::GetTimerColor(const TimerInfo& timer_info, bool is_selected,
-                              bool is_highlighted) const {
+                              bool is_highlighted,
+                              const internal::DrawData& draw_data) const {
   const Color kInactiveColor(100, 100, 100, 255);
   const Color kSelectionColor(0, 128, 255, 255);
   if (is_highlighted) {
@@ -115,18 +116,15 @@ Color GpuTrack::GetTimerColor(const TimerInfo& timer_info, bool is_selected,
   if (is_selected) {
     return kSelectionColor;
   }
-  if (!IsTimerActive(timer_info)) {
+  if (!IsTimerActive(timer_info, draw_data)) {
     return kInactiveColor;
   }
   if (timer_info.has_color()) {
-    CHECK(timer_info.color().red() < 256);
-    CHECK(timer_info.color().green() < 256);
-    CHECK(timer_info.color().blue() < 256);
-    CHECK(timer_info.color().alpha() < 256);
-    return Color(static_cast<uint8_t>(timer_info.color().red()),
-                 static_cast<uint8_t>(timer_info.color().green()),
-                 static_cast<uint8_t>(timer_info.color().blue()),
-                 static_cast<uint8_t>(timer_info.color().alpha()));
+    // As in TextBox, only keep the low byte of each channel instead of trusting the capture.
+    return Color(static_cast<uint8_t>(timer_info.color().red() & 0xff),
+                 static_cast<uint8_t>(timer_info.color().green() & 0xff),
+                 static_cast<uint8_t>(timer_info.color().blue() & 0xff),
+                 static_cast<uint8_t>(timer_info.color().alpha() & 0xff));
   }
   if (timer_info.type() == TimerInfo::kGpuDebugMarker) {
     std::string marker_text = string_manager_->Get(timer_info.user_data_key()).value_or("");
@@ -201,30 +199,22 @@ bool GpuTrack::TimerFilter(const TimerInfo& timer_info) const {
 }
 
 void GpuTrack::SetTimesliceText(const TimerInfo& timer_info, double elapsed_us, float min_x,
-                                float z_offset, TextBox* text_box) {
-  if (text_box->GetText().empty()) {
-    std::string time = GetPrettyTime(absl::Microseconds(elapsed_us));
+                                float z_offset, const Vec2& box_pos, const Vec2& box_size) {
+  std::string time = GetPrettyTime(absl::Microseconds(elapsed_us));
 
-    text_box->SetElapsedTimeTextLength(time.length());
-
-    CHECK(timer_info.type() == TimerInfo::kGpuActivity ||
-          timer_info.type() == TimerInfo::kGpuCommandBuffer ||
-          timer_info.type() == TimerInfo::kGpuDebugMarker);
+  CHECK(timer_info.type() == TimerInfo::kGpuActivity ||
+        timer_info.type() == TimerInfo::kGpuCommandBuffer ||
+        timer_info.type() == TimerInfo::kGpuDebugMarker);
 
-    std::string text = absl::StrFormat(
-        "%s  %s", string_manager_->Get(timer_info.user_data_key()).value_or(""), time.c_str());
-    text_box->SetText(text);
-  }
+  std::string text = absl::StrFormat(
+      "%s  %s", string_manager_->Get(timer_info.user_data_key()).value_or(""), time.c_str());
 
   const Color kTextWhite(255, 255, 255, 255);
-  const Vec2& box_pos = text_box->GetPos();
-  const Vec2& box_size = text_box->GetSize();
   float pos_x = std::max(box_pos[0], min_x);
   float max_size = box_pos[0] + box_size[0] - pos_x;
-  text_renderer_->AddTextTrailingCharsPrioritized(
-      text_box->GetText().c_str(), pos_x, text_box->GetPos()[1] + layout_->GetTextOffset(),
-      GlCanvas::kZValueBox + z_offset, kTextWhite, text_box->GetElapsedTimeTextLength(),
-      layout_->CalculateZoomedFontSize(), max_size);
+  time_graph_->GetPrimitivesTextRenderer()->AddTextTrailingCharsPrioritized(
+      text.c_str(), pos_x, box_pos[1] + layout_->GetTextOffset(), GlCanvas::kZValueBox + z_offset,
+      kTextWhite, time.length(), layout_->CalculateZoomedFontSize(), max_size);
 }
 
 std::string GpuTrack::GetTooltip() const {
@@ -244,7 +234,7 @@ float GpuTrack::GetHeight() const {
 }
 
 const TextBox* GpuTrack::GetLeft(const TextBox* text_box) const {
-  const TimerInfo& timer_info = text_box->GetTimerInfo();
+  const TimerInfo timer_info = text_box->GetTimerInfo();
   uint64_t timeline_hash = timer_info.user_data_key();
   if (timeline_hash == timeline_hash_) {
     std::shared_ptr<TimerChain> timers = GetTimers(timer_info.depth());
@@ -254,7 +244,7 @@ const TextBox* GpuTrack::GetLeft(const TextBox* text_box) const {
 }
 
 const TextBox* GpuTrack::GetRight(const TextBox* text_box) const {
-  const TimerInfo& timer_info = text_box->GetTimerInfo();
+  const TimerInfo timer_info = text_box->GetTimerInfo();
   uint64_t timeline_hash = timer_info.user_data_key();
   if (timeline_hash == timeline_hash_) {
     std::shared_ptr<TimerChain> timers = GetTimers(timer_info.depth());
@@ -265,26 +255,26 @@ const TextBox* GpuTrack::GetRight(const TextBox* text_box) const {
 
 std::string GpuTrack::GetBoxTooltip(const Batcher& batcher, PickingId id) const {
   const TextBox* text_box = batcher.GetTextBox(id);
-  if (!text_box || text_box->GetTimerInfo().type() == TimerInfo::kCoreActivity) {
+  if (!text_box || text_box->GetType() == TimerInfo::kCoreActivity) {
     return "";
   }
 
-  std::string gpu_stage =
-      string_manager_->Get(text_box->GetTimerInfo().user_data_key()).value_or("");
+  const TimerInfo timer_info = text_box->GetTimerInfo();
+  std::string gpu_stage = string_manager_->Get(timer_info.user_data_key()).value_or("");
   if (gpu_stage == kSwQueueString) {
-    return GetSwQueueTooltip(text_box->GetTimerInfo());
+    return GetSwQueueTooltip(timer_info);
   }
   if (gpu_stage == kHwQueueString) {
-    return GetHwQueueTooltip(text_box->GetTimerInfo());
+    return GetHwQueueTooltip(timer_info);
   }
   if (gpu_stage == kHwExecutionString) {
-    return GetHwExecutionTooltip(text_box->GetTimerInfo());
+    return GetHwExecutionTooltip(timer_info);
   }
   if (gpu_stage == kCmdBufferString) {
-    return GetCommandBufferTooltip(text_box->GetTimerInfo());
+    return GetCommandBufferTooltip(timer_info);
   }
-  if (text_box->GetTimerInfo().type() == TimerInfo::kGpuDebugMarker) {
-    return GetDebugMarkerTooltip(text_box->GetTimerInfo());
+  if (timer_info.type() == TimerInfo::kGpuDebugMarker) {
+    return GetDebugMarkerTooltip(timer_info);
   }
 
   return "";
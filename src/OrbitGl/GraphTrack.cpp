@@ -24,11 +24,7 @@ GraphTrack::GraphTrack(TimeGraph* time_graph, TimeGraphLayout* layout, std::stri
 
 void GraphTrack::UpdatePrimitives(Batcher* batcher, uint64_t min_tick, uint64_t max_tick,
                                   PickingMode picking_mode, float z_offset) {
-  GlCanvas* canvas = time_graph_->GetCanvas();
-
-  float track_width = canvas->GetWorldWidth();
-  SetSize(track_width, GetHeight());
-  pos_[0] = canvas->GetWorldTopLeftX();
+  const TimeGraphView& view = time_graph_->GetPrimitivesView();
 
   Color color = GetBackgroundColor();
   const Color kLineColor(0, 128, 255, 128);
@@ -42,63 +38,68 @@ void GraphTrack::UpdatePrimitives(Batcher* batcher, uint64_t min_tick, uint64_t
 
   const bool picking = picking_mode != PickingMode::kNone;
   if (!picking) {
-    double time_range = static_cast<double>(max_tick - min_tick);
-    if (values_.size() < 2 || time_range == 0) return;
-
-    auto it = values_.upper_bound(min_tick);
-    if (it == values_.end()) return;
-    if (it != values_.begin()) --it;
-    uint64_t previous_time = it->first;
-    double last_normalized_value = (it->second - min_) * inv_value_range_;
+    absl::MutexLock lock(&mutex_);
+    if (values_.size() < 2 || max_tick <= min_tick) return;
+
+    // The graph starts at the last value at or before min_tick, and ends with the first value
+    // after max_tick.
+    size_t index = values_.UpperBound(min_tick);
+    if (index == values_.size()) return;
+    if (index != 0) --index;
+    const size_t end_index = std::min(values_.UpperBound(max_tick) + 1, values_.size());
+
     constexpr float kDotRadius = 2.f;
-    float base_y = pos_[1] - size_[1];
-    float y1 = 0;
-    DrawSquareDot(batcher,
-                  Vec2(time_graph_->GetWorldFromTick(previous_time),
-                       base_y + static_cast<float>(last_normalized_value) * size_[1]),
-                  kDotRadius, dot_z, kDotColor);
-
-    for (++it; it != values_.end(); ++it) {
-      if (previous_time > max_tick) break;
-      uint64_t time = it->first;
-      double normalized_value = (it->second - min_) * inv_value_range_;
-      float x0 = time_graph_->GetWorldFromTick(previous_time);
-      float x1 = time_graph_->GetWorldFromTick(time);
-      float y0 = base_y + static_cast<float>(last_normalized_value) * size_[1];
-      y1 = base_y + static_cast<float>(normalized_value) * size_[1];
-      batcher->AddLine(Vec2(x0, y0), Vec2(x1, y0), graph_z, kLineColor);
-      batcher->AddLine(Vec2(x1, y0), Vec2(x1, y1), graph_z, kLineColor);
-      DrawSquareDot(batcher, Vec2(x1, y1), kDotRadius, dot_z, kDotColor);
-
-      previous_time = time;
-      last_normalized_value = normalized_value;
+    float previous_x = view.GetWorldFromTick(values_.GetTime(index));
+    float previous_y = GetValueY(values_.GetValue(index));
+    DrawSquareDot(batcher, Vec2(previous_x, previous_y), kDotRadius, dot_z, kDotColor);
+
+    // The values in the same pixel column are drawn as one vertical line, spanning their minimum
+    // and maximum, and one dot for the last of them. This bounds the number of primitives by the
+    // number of pixels, whatever the number of values in range.
+    const uint64_t ticks_per_pixel =
+        std::max<uint64_t>((max_tick - min_tick) / std::max(view.screen_width, 1), 1);
+    for (++index; index < end_index;) {
+      // Only the first value can be at or before min_tick.
+      const uint64_t time = values_.GetTime(index);
+      const uint64_t column_end_tick =
+          min_tick + ((time - min_tick) / ticks_per_pixel + 1) * ticks_per_pixel;
+      const size_t column_end_index = std::min(values_.UpperBound(column_end_tick - 1), end_index);
+      const TimeSeries::Envelope envelope = values_.GetEnvelope(index, column_end_index);
+
+      float x = view.GetWorldFromTick(time);
+      float min_y = std::min(previous_y, GetValueY(envelope.min));
+      float max_y = std::max(previous_y, GetValueY(envelope.max));
+      float last_y = GetValueY(envelope.last);
+      batcher->AddLine(Vec2(previous_x, previous_y), Vec2(x, previous_y), graph_z, kLineColor);
+      batcher->AddLine(Vec2(x, min_y), Vec2(x, max_y), graph_z, kLineColor);
+      DrawSquareDot(batcher, Vec2(x, last_y), kDotRadius, dot_z, kDotColor);
+
+      previous_x = x;
+      previous_y = last_y;
+      index = column_end_index;
     }
 
-    if (!values_.empty()) {
-      float x0 = time_graph_->GetWorldFromTick(previous_time);
-      float x1 = time_graph_->GetWorldFromTick(max_tick);
-      batcher->AddLine(Vec2(x0, y1), Vec2(x1, y1), graph_z, kLineColor);
-    }
+    float max_x = view.GetWorldFromTick(max_tick);
+    batcher->AddLine(Vec2(previous_x, previous_y), Vec2(max_x, previous_y), graph_z, kLineColor);
   }
 }
 
 void GraphTrack::Draw(GlCanvas* canvas, PickingMode picking_mode, float z_offset) {
   Track::Draw(canvas, picking_mode, z_offset);
-  if (values_.empty() || picking_mode != PickingMode::kNone) {
-    return;
-  }
+  if (picking_mode != PickingMode::kNone) return;
+
+  absl::MutexLock lock(&mutex_);
+  if (values_.empty()) return;
 
   // Draw label
   uint64_t current_mouse_time_ns = time_graph_->GetCurrentMouseTimeNs();
-  auto previous_point = GetPreviousValueAndTime(current_mouse_time_ns);
+  auto previous_point = values_.GetPreviousValueAndTime(current_mouse_time_ns);
 
-  double value =
-      previous_point.has_value() ? previous_point.value().second : values_.begin()->second;
-  uint64_t first_time = values_.begin()->first;
+  double value = previous_point.has_value() ? previous_point.value().second : values_.GetValue(0);
+  uint64_t first_time = values_.GetTime(0);
   uint64_t label_time = std::max(current_mouse_time_ns, first_time);
   float point_x = time_graph_->GetWorldFromTick(label_time);
-  double normalized_value = (value - min_) * inv_value_range_;
-  float point_y = pos_[1] - size_[1] * (1.f - static_cast<float>(normalized_value));
+  float point_y = GetValueY(value);
   const Color kBlack(0, 0, 0, 255);
   const Color kWhite(255, 255, 255, 255);
   float text_z = GlCanvas::kZValueEvent + z_offset;
@@ -147,7 +148,8 @@ void GraphTrack::DrawLabel(GlCanvas* canvas, Vec2 target_pos, const std::string&
 }
 
 void GraphTrack::AddValue(double value, uint64_t time) {
-  values_[time] = value;
+  absl::MutexLock lock(&mutex_);
+  values_.AddValue(time, value);
   max_ = std::max(max_, value);
   min_ = std::min(min_, value);
   value_range_ = max_ - min_;
@@ -157,12 +159,18 @@ void GraphTrack::AddValue(double value, uint64_t time) {
 
 std::optional<std::pair<uint64_t, double> > GraphTrack::GetPreviousValueAndTime(
     uint64_t time) const {
-  auto iterator_lower = values_.upper_bound(time);
-  if (iterator_lower == values_.begin()) {
-    return {};
-  }
-  --iterator_lower;
-  return *iterator_lower;
+  absl::MutexLock lock(&mutex_);
+  return values_.GetPreviousValueAndTime(time);
+}
+
+bool GraphTrack::IsEmpty() const {
+  absl::MutexLock lock(&mutex_);
+  return values_.empty();
+}
+
+float GraphTrack::GetValueY(double value) const {
+  double normalized_value = (value - min_) * inv_value_range_;
+  return pos_[1] - size_[1] + static_cast<float>(normalized_value) * size_[1];
 }
 
 float GraphTrack::GetHeight() const {
@@ -5,10 +5,10 @@
 #ifndef ORBIT_GL_GRAPH_TRACK_H_
 #define ORBIT_GL_GRAPH_TRACK_H_
 
+#include <absl/synchronization/mutex.h>
 #include <stdint.h>
 
 #include <limits>
-#include <map>
 #include <optional>
 #include <string>
 #include <utility>
@@ -16,6 +16,7 @@
 #include "Batcher.h"
 #include "CoreMath.h"
 #include "PickingManager.h"
+#include "TimeSeries.h"
 #include "Timer.h"
 #include "Track.h"
 
@@ -33,17 +34,21 @@ class GraphTrack : public Track {
   void AddValue(double value, uint64_t time);
   [[nodiscard]] std::optional<std::pair<uint64_t, double> > GetPreviousValueAndTime(
       uint64_t time) const;
-  [[nodiscard]] bool IsEmpty() const override { return values_.empty(); }
+  [[nodiscard]] bool IsEmpty() const override;
 
  protected:
   void DrawSquareDot(Batcher* batcher, Vec2 center, float radius, float z, const Color& color);
   void DrawLabel(GlCanvas* canvas, Vec2 target_pos, const std::string& text,
                  const Color& text_color, const Color& font_color, float z);
-  std::map<uint64_t, double> values_;
-  double min_ = std::numeric_limits<double>::max();
-  double max_ = std::numeric_limits<double>::lowest();
-  double value_range_ = 0;
-  double inv_value_range_ = 0;
+  [[nodiscard]] float GetValueY(double value) const ABSL_EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+
+  // Values are added while capturing, and read while updating the primitives.
+  mutable absl::Mutex mutex_;
+  TimeSeries values_ ABSL_GUARDED_BY(mutex_);
+  double min_ ABSL_GUARDED_BY(mutex_) = std::numeric_limits<double>::max();
+  double max_ ABSL_GUARDED_BY(mutex_) = std::numeric_limits<double>::lowest();
+  double value_range_ ABSL_GUARDED_BY(mutex_) = 0;
+  double inv_value_range_ ABSL_GUARDED_BY(mutex_) = 0;
 };
 
 #endif  // ORBIT_GL_GRAPH_TRACK_H_
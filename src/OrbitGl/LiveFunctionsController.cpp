@@ -25,8 +25,8 @@ std::pair<uint64_t, uint64_t> ComputeMinMaxTime(
   uint64_t min_time = std::numeric_limits<uint64_t>::max();
   uint64_t max_time = std::numeric_limits<uint64_t>::min();
   for (auto& text_box : text_boxes) {
-    min_time = std::min(min_time, text_box.second->GetTimerInfo().start());
-    max_time = std::max(max_time, text_box.second->GetTimerInfo().start());
+    min_time = std::min(min_time, text_box.second->Start());
+    max_time = std::max(max_time, text_box.second->Start());
   }
   return std::make_pair(min_time, max_time);
 }
@@ -39,8 +39,8 @@ uint64_t AbsDiff(uint64_t a, uint64_t b) {
 }
 
 const TextBox* ClosestTo(uint64_t point, const TextBox* box_a, const TextBox* box_b) {
-  uint64_t a_diff = AbsDiff(point, box_a->GetTimerInfo().start());
-  uint64_t b_diff = AbsDiff(point, box_b->GetTimerInfo().start());
+  uint64_t a_diff = AbsDiff(point, box_a->Start());
+  uint64_t b_diff = AbsDiff(point, box_b->Start());
   if (a_diff <= b_diff) {
     return box_a;
   }
@@ -69,9 +69,9 @@ const TextBox* SnapToClosestStart(const TimeGraph* time_graph, uint64_t function
   // marker of 'box'. In this case, the closest box can be any of two boxes:
   // 'box' or the next one. It cannot be any box before 'box' because we are
   // using the start marker to measure the distance.
-  if (box->GetTimerInfo().start() <= center) {
+  if (box->Start() <= center) {
     const TextBox* next_box =
-        time_graph->FindNextFunctionCall(function_id, box->GetTimerInfo().end());
+        time_graph->FindNextFunctionCall(function_id, box->End());
     if (!next_box) {
       return box;
     }
@@ -82,7 +82,7 @@ const TextBox* SnapToClosestStart(const TimeGraph* time_graph, uint64_t function
   // The center is to the left of 'box', so the closest box is either 'box' or
   // the next box to the left of the center.
   const TextBox* previous_box =
-      time_graph->FindPreviousFunctionCall(function_id, box->GetTimerInfo().start());
+      time_graph->FindPreviousFunctionCall(function_id, box->Start());
 
   if (!previous_box) {
     return box;
@@ -111,12 +111,12 @@ bool LiveFunctionsController::OnAllNextButton() {
     uint64_t function_id = it.second;
     const TextBox* current_box = current_textboxes_.find(it.first)->second;
     const TextBox* box =
-        app_->GetTimeGraph()->FindNextFunctionCall(function_id, current_box->GetTimerInfo().end());
+        app_->GetTimeGraph()->FindNextFunctionCall(function_id, current_box->End());
     if (box == nullptr) {
       return false;
     }
-    if (box->GetTimerInfo().start() < min_timestamp) {
-      min_timestamp = box->GetTimerInfo().start();
+    if (box->Start() < min_timestamp) {
+      min_timestamp = box->Start();
       id_with_min_timestamp = it.first;
     }
     next_boxes.insert(std::make_pair(it.first, box));
@@ -137,12 +137,12 @@ bool LiveFunctionsController::OnAllPreviousButton() {
     uint64_t function_id = it.second;
     const TextBox* current_box = current_textboxes_.find(it.first)->second;
     const TextBox* box = app_->GetTimeGraph()->FindPreviousFunctionCall(
-        function_id, current_box->GetTimerInfo().end());
+        function_id, current_box->End());
     if (box == nullptr) {
       return false;
     }
-    if (box->GetTimerInfo().start() < min_timestamp) {
-      min_timestamp = box->GetTimerInfo().start();
+    if (box->Start() < min_timestamp) {
+      min_timestamp = box->Start();
       id_with_min_timestamp = it.first;
     }
     next_boxes.insert(std::make_pair(it.first, box));
@@ -157,7 +157,7 @@ bool LiveFunctionsController::OnAllPreviousButton() {
 
 void LiveFunctionsController::OnNextButton(uint64_t id) {
   const TextBox* text_box = app_->GetTimeGraph()->FindNextFunctionCall(
-      iterator_id_to_function_id_[id], current_textboxes_[id]->GetTimerInfo().end());
+      iterator_id_to_function_id_[id], current_textboxes_[id]->End());
   // If text_box is nullptr, then we have reached the right end of the timeline.
   if (text_box != nullptr) {
     current_textboxes_[id] = text_box;
@@ -167,7 +167,7 @@ void LiveFunctionsController::OnNextButton(uint64_t id) {
 }
 void LiveFunctionsController::OnPreviousButton(uint64_t id) {
   const TextBox* text_box = app_->GetTimeGraph()->FindPreviousFunctionCall(
-      iterator_id_to_function_id_[id], current_textboxes_[id]->GetTimerInfo().end());
+      iterator_id_to_function_id_[id], current_textboxes_[id]->End());
   // If text_box is nullptr, then we have reached the left end of the timeline.
   if (text_box != nullptr) {
     current_textboxes_[id] = text_box;
@@ -200,7 +200,7 @@ void LiveFunctionsController::AddIterator(uint64_t function_id, const FunctionIn
   // If no box is currently selected or the selected box is a different
   // function, we search for the closest box to the current center of the
   // screen.
-  if (!box || box->GetTimerInfo().function_id() != function_id) {
+  if (!box || box->GetFunctionId() != function_id) {
     box = SnapToClosestStart(app_->GetTimeGraph(), function_id);
   }
 
@@ -216,7 +216,7 @@ void LiveFunctionsController::AddIterator(uint64_t function_id, const FunctionIn
 uint64_t LiveFunctionsController::GetStartTime(uint64_t index) const {
   const auto& it = current_textboxes_.find(index);
   if (it != current_textboxes_.end()) {
-    return it->second->GetTimerInfo().start();
+    return it->second->Start();
   }
   return GetCaptureMin();
 }
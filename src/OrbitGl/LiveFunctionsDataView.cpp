@@ -60,6 +60,9 @@ const std::vector<DataView::Column>& LiveFunctionsDataView::GetColumns() {
     columns[kColumnTimeAvg] = {"Avg", .075f, SortingOrder::kDescending};
     columns[kColumnTimeMin] = {"Min", .075f, SortingOrder::kDescending};
     columns[kColumnTimeMax] = {"Max", .075f, SortingOrder::kDescending};
+    columns[kColumnTimeP50] = {"p50", .075f, SortingOrder::kDescending};
+    columns[kColumnTimeP95] = {"p95", .075f, SortingOrder::kDescending};
+    columns[kColumnTimeP99] = {"p99", .075f, SortingOrder::kDescending};
     columns[kColumnModule] = {"Module", .1f, SortingOrder::kAscending};
     columns[kColumnAddress] = {"Address", .0f, SortingOrder::kAscending};
     return columns;
@@ -67,6 +70,19 @@ const std::vector<DataView::Column>& LiveFunctionsDataView::GetColumns() {
   return columns;
 }
 
+double LiveFunctionsDataView::GetPercentileOfColumn(int column) {
+  switch (column) {
+    case kColumnTimeP50:
+      return 0.5;
+    case kColumnTimeP95:
+      return 0.95;
+    case kColumnTimeP99:
+      return 0.99;
+    default:
+      UNREACHABLE();
+  }
+}
+
 std::string LiveFunctionsDataView::GetValue(int row, int column) {
   if (!app_->HasCaptureData()) {
     return "";
@@ -75,8 +91,10 @@ std::string LiveFunctionsDataView::GetValue(int row, int column) {
     return "";
   }
 
+  const uint64_t function_id = GetInstrumentedFunctionId(row);
   const FunctionInfo& function = GetInstrumentedFunction(row);
-  const FunctionStats& stats = app_->GetCaptureData().GetFunctionStatsOrDefault(function);
+  const CaptureData& capture_data = app_->GetCaptureData();
+  const FunctionStats& stats = capture_data.GetFunctionStatsOrDefault(function_id);
 
   switch (column) {
     case kColumnSelected:
@@ -93,12 +111,16 @@ std::string LiveFunctionsDataView::GetValue(int row, int column) {
       return GetPrettyTime(absl::Nanoseconds(stats.min_ns()));
     case kColumnTimeMax:
       return GetPrettyTime(absl::Nanoseconds(stats.max_ns()));
+    case kColumnTimeP50:
+    case kColumnTimeP95:
+    case kColumnTimeP99:
+      return GetPrettyTime(absl::Nanoseconds(
+          capture_data.GetFunctionDurationSketchOrDefault(function_id)
+              .GetQuantile(GetPercentileOfColumn(column))));
     case kColumnModule:
       return function.loaded_module_path();
-    case kColumnAddress: {
-      const CaptureData& capture_data = app_->GetCaptureData();
+    case kColumnAddress:
       return absl::StrFormat("0x%llx", capture_data.GetAbsoluteAddress(function));
-    }
     default:
       return "";
   }
@@ -132,13 +154,11 @@ void LiveFunctionsDataView::OnSelect(const std::vector<int>& rows) {
   [&](uint64_t a, uint64_t b) {                                                            \
     return orbit_core::Compare(functions.at(a).Member, functions.at(b).Member, ascending); \
   }
-#define ORBIT_STAT_SORT(Member)                                            \
-  [&](uint64_t a, uint64_t b) {                                            \
-    const FunctionStats& stats_a =                                         \
-        app_->GetCaptureData().GetFunctionStatsOrDefault(functions.at(a)); \
-    const FunctionStats& stats_b =                                         \
-        app_->GetCaptureData().GetFunctionStatsOrDefault(functions.at(b)); \
-    return orbit_core::Compare(stats_a.Member, stats_b.Member, ascending); \
+#define ORBIT_STAT_SORT(Member)                                                         \
+  [&](uint64_t a, uint64_t b) {                                                         \
+    const FunctionStats& stats_a = app_->GetCaptureData().GetFunctionStatsOrDefault(a); \
+    const FunctionStats& stats_b = app_->GetCaptureData().GetFunctionStatsOrDefault(b); \
+    return orbit_core::Compare(stats_a.Member, stats_b.Member, ascending);              \
   }
 #define ORBIT_CUSTOM_FUNC_SORT(Func)                                                     \
   [&](uint64_t a, uint64_t b) {                                                          \
@@ -177,6 +197,18 @@ void LiveFunctionsDataView::DoSort() {
     case kColumnTimeMax:
       sorter = ORBIT_STAT_SORT(max_ns());
       break;
+    case kColumnTimeP50:
+    case kColumnTimeP95:
+    case kColumnTimeP99: {
+      const CaptureData& capture_data = app_->GetCaptureData();
+      const double percentile = GetPercentileOfColumn(sorting_column_);
+      sorter = [&capture_data, percentile, ascending](uint64_t a, uint64_t b) {
+        return orbit_core::Compare(
+            capture_data.GetFunctionDurationSketchOrDefault(a).GetQuantile(percentile),
+            capture_data.GetFunctionDurationSketchOrDefault(b).GetQuantile(percentile), ascending);
+      };
+      break;
+    }
     case kColumnModule:
       sorter = ORBIT_CUSTOM_FUNC_SORT(function_utils::GetLoadedModuleName);
       break;
@@ -226,7 +258,7 @@ std::vector<std::string> LiveFunctionsDataView::GetContextMenu(
       enable_source_code = absl::GetFlag(FLAGS_enable_source_code_view);
     }
 
-    const FunctionStats& stats = capture_data.GetFunctionStatsOrDefault(selected_function);
+    const FunctionStats& stats = capture_data.GetFunctionStatsOrDefault(instrumented_function_id);
     // We need at least one function call to a function so that adding iterators makes sense.
     enable_iterator |= stats.count() > 0;
 
@@ -258,8 +290,8 @@ std::vector<std::string> LiveFunctionsDataView::GetContextMenu(
   // For now, these actions only make sense when one function is selected,
   // so we don't show them otherwise.
   if (selected_indices.size() == 1) {
-    const FunctionInfo& function = GetInstrumentedFunction(selected_indices[0]);
-    const FunctionStats& stats = capture_data.GetFunctionStatsOrDefault(function);
+    const FunctionStats& stats =
+        capture_data.GetFunctionStatsOrDefault(GetInstrumentedFunctionId(selected_indices[0]));
     if (stats.count() > 0) {
       menu.insert(menu.end(), {kMenuActionJumpToFirst, kMenuActionJumpToLast, kMenuActionJumpToMin,
                                kMenuActionJumpToMax});
@@ -329,7 +361,7 @@ void LiveFunctionsDataView::OnContextMenu(const std::string& action, int menu_in
       uint64_t instrumented_function_id = GetInstrumentedFunctionId(i);
       const FunctionInfo& instrumented_function = GetInstrumentedFunction(i);
       const FunctionStats& stats =
-          app_->GetCaptureData().GetFunctionStatsOrDefault(instrumented_function);
+          app_->GetCaptureData().GetFunctionStatsOrDefault(instrumented_function_id);
       if (stats.count() > 0) {
         live_functions_->AddIterator(instrumented_function_id, &instrumented_function);
         if (metrics_uploader_ != nullptr) {
@@ -450,14 +482,14 @@ std::pair<TextBox*, TextBox*> LiveFunctionsDataView::GetMinMax(uint64_t function
     for (auto& block : *chain) {
       for (size_t i = 0; i < block.size(); i++) {
         TextBox& box = block[i];
-        if (box.GetTimerInfo().function_id() == function_id) {
-          uint64_t elapsed_nanos = box.GetTimerInfo().end() - box.GetTimerInfo().start();
+        if (box.GetFunctionId() == function_id) {
+          uint64_t elapsed_nanos = box.End() - box.Start();
           if (min_box == nullptr ||
-              elapsed_nanos < (min_box->GetTimerInfo().end() - min_box->GetTimerInfo().start())) {
+              elapsed_nanos < (min_box->End() - min_box->Start())) {
             min_box = &box;
           }
           if (max_box == nullptr ||
-              elapsed_nanos > (max_box->GetTimerInfo().end() - max_box->GetTimerInfo().start())) {
+              elapsed_nanos > (max_box->End() - max_box->Start())) {
             max_box = &box;
           }
         }
@@ -55,6 +55,8 @@ class LiveFunctionsDataView : public DataView {
   [[nodiscard]] const orbit_client_protos::FunctionInfo& GetInstrumentedFunction(
       uint32_t row) const;
   [[nodiscard]] std::pair<TextBox*, TextBox*> GetMinMax(uint64_t function_id) const;
+  // Returns the percentile of the call durations shown in one of the kColumnTimeP* columns.
+  [[nodiscard]] static double GetPercentileOfColumn(int column);
 
   absl::flat_hash_map<uint64_t, orbit_client_protos::FunctionInfo> functions_;
 
@@ -69,6 +71,9 @@ class LiveFunctionsDataView : public DataView {
     kColumnTimeAvg,
     kColumnTimeMin,
     kColumnTimeMax,
+    kColumnTimeP50,
+    kColumnTimeP95,
+    kColumnTimeP99,
     kColumnModule,
     kColumnAddress,
     kNumColumns
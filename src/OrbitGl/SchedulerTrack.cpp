@@ -44,25 +44,27 @@ float SchedulerTrack::GetHeight() const {
          layout_->GetTrackBottomMargin();
 }
 
-bool SchedulerTrack::IsTimerActive(const TimerInfo& timer_info) const {
-  bool is_same_tid_as_selected = timer_info.thread_id() == app_->selected_thread_id();
+bool SchedulerTrack::IsTimerActive(const TimerInfo& timer_info,
+                                   const internal::DrawData& draw_data) const {
+  bool is_same_tid_as_selected = timer_info.thread_id() == draw_data.selected_thread_id;
   CHECK(capture_data_ != nullptr);
   int32_t capture_process_id = capture_data_->process_id();
   bool is_same_pid_as_target =
       capture_process_id == 0 || capture_process_id == timer_info.process_id();
 
-  return is_same_tid_as_selected || (app_->selected_thread_id() == -1 && is_same_pid_as_target);
+  return is_same_tid_as_selected || (draw_data.selected_thread_id == -1 && is_same_pid_as_target);
 }
 
 Color SchedulerTrack::GetTimerColor(const TimerInfo& timer_info, bool is_selected,
-                                    bool is_highlighted) const {
+                                    bool is_highlighted,
+                                    const internal::DrawData& draw_data) const {
   if (is_highlighted) {
     return TimerTrack::kHighlightColor;
   }
   if (is_selected) {
     return kSelectionColor;
   }
-  if (!IsTimerActive(timer_info)) {
+  if (!IsTimerActive(timer_info, draw_data)) {
     return kInactiveColor;
   }
   return TimeGraph::GetThreadColor(timer_info.thread_id());
@@ -87,15 +89,14 @@ std::string SchedulerTrack::GetBoxTooltip(const Batcher& batcher, PickingId id)
   }
 
   CHECK(capture_data_ != nullptr);
+  const TimerInfo timer_info = text_box->GetTimerInfo();
   return absl::StrFormat(
       "<b>CPU Core activity</b><br/>"
       "<br/>"
       "<b>Core:</b> %d<br/>"
       "<b>Process:</b> %s [%d]<br/>"
       "<b>Thread:</b> %s [%d]<br/>",
-      text_box->GetTimerInfo().processor(),
-      capture_data_->GetThreadName(text_box->GetTimerInfo().process_id()),
-      text_box->GetTimerInfo().process_id(),
-      capture_data_->GetThreadName(text_box->GetTimerInfo().thread_id()),
-      text_box->GetTimerInfo().thread_id());
+      timer_info.processor(), capture_data_->GetThreadName(timer_info.process_id()),
+      timer_info.process_id(), capture_data_->GetThreadName(timer_info.thread_id()),
+      timer_info.thread_id());
 }
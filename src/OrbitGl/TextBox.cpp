@@ -0,0 +1,53 @@
+// Copyright (c) 2021 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "TextBox.h"
+
+using orbit_client_protos::TimerInfo;
+
+TextBox::TextBox(const TimerInfo& timer_info)
+    : start_{timer_info.start()},
+      end_{timer_info.end()},
+      function_id_{timer_info.function_id()},
+      user_data_key_{timer_info.user_data_key()},
+      timeline_hash_{timer_info.timeline_hash()},
+      callstack_id_{timer_info.callstack_id()},
+      registers_{timer_info.registers().begin(), timer_info.registers().end()},
+      process_id_{timer_info.process_id()},
+      thread_id_{timer_info.thread_id()},
+      processor_{timer_info.processor()},
+      depth_{timer_info.depth()},
+      type_{static_cast<uint8_t>(timer_info.type())},
+      has_color_{timer_info.has_color()} {
+  if (has_color_) {
+    // Captures loaded from a file can contain anything: only keep the low byte of each channel.
+    const orbit_client_protos::Color& color = timer_info.color();
+    color_ = (color.red() & 0xff) << 24 | (color.green() & 0xff) << 16 |
+             (color.blue() & 0xff) << 8 | (color.alpha() & 0xff);
+  }
+}
+
+TimerInfo TextBox::GetTimerInfo() const {
+  TimerInfo timer_info;
+  timer_info.set_start(start_);
+  timer_info.set_end(end_);
+  timer_info.set_process_id(process_id_);
+  timer_info.set_thread_id(thread_id_);
+  timer_info.set_depth(depth_);
+  timer_info.set_type(GetType());
+  timer_info.set_processor(processor_);
+  timer_info.set_callstack_id(callstack_id_);
+  timer_info.set_function_id(function_id_);
+  timer_info.set_user_data_key(user_data_key_);
+  timer_info.set_timeline_hash(timeline_hash_);
+  *timer_info.mutable_registers() = {registers_.begin(), registers_.end()};
+  if (has_color_) {
+    orbit_client_protos::Color* color = timer_info.mutable_color();
+    color->set_red(color_ >> 24);
+    color->set_green((color_ >> 16) & 0xff);
+    color->set_blue((color_ >> 8) & 0xff);
+    color->set_alpha(color_ & 0xff);
+  }
+  return timer_info;
+}
@@ -5,49 +5,50 @@
 #ifndef ORBIT_GL_TEXT_BOX_H_
 #define ORBIT_GL_TEXT_BOX_H_
 
-#include <utility>
+#include <cstdint>
+#include <vector>
 
-#include "CoreMath.h"
 #include "capture_data.pb.h"
 
-class TextRenderer;
-
+// A timer as stored in the TimerChains of the tracks. As there can be tens of millions of timers
+// in a capture, a TextBox only keeps the fields of the TimerInfo it was created from, in a compact
+// form: the TimerInfo is materialized on demand by GetTimerInfo, e.g., for tooltips, selection
+// and serialization. Its position on screen and its text are computed while drawing.
 class TextBox {
  public:
-  TextBox() : pos_(Vec2::Zero()), size_(Vec2(100.f, 10.f)) {}
-  TextBox(const Vec2& pos, const Vec2& size, std::string text = "")
-      : pos_(pos), size_(size), text_(std::move(text)) {}
-
-  void SetSize(const Vec2& size) { size_ = size; }
-  void SetPos(const Vec2& pos) { pos_ = pos; }
-
-  const Vec2& GetSize() const { return size_; }
-  const Vec2& GetPos() const { return pos_; }
+  TextBox() = default;
+  explicit TextBox(const orbit_client_protos::TimerInfo& timer_info);
 
-  const std::string& GetText() const { return text_; }
-  void SetText(std::string text) { text_ = std::move(text); }
+  [[nodiscard]] orbit_client_protos::TimerInfo GetTimerInfo() const;
 
-  void SetTimerInfo(const orbit_client_protos::TimerInfo& timer_info) {
-    if (timer_info.end() == 0 && timer_info.start() == 0) {
-      return;
-    }
-    timer_info_ = timer_info;
+  // Start() and End() are required in order to be used as node in a ScopeTree.
+  uint64_t Start() const { return start_; }
+  uint64_t End() const { return end_; }
+
+  [[nodiscard]] uint64_t GetFunctionId() const { return function_id_; }
+  [[nodiscard]] int32_t GetThreadId() const { return thread_id_; }
+  [[nodiscard]] uint32_t GetDepth() const { return depth_; }
+  [[nodiscard]] orbit_client_protos::TimerInfo::Type GetType() const {
+    return static_cast<orbit_client_protos::TimerInfo::Type>(type_);
   }
-  const orbit_client_protos::TimerInfo& GetTimerInfo() const { return timer_info_; }
-
-  void SetElapsedTimeTextLength(size_t length) { elapsed_time_text_length_ = length; }
-  size_t GetElapsedTimeTextLength() const { return elapsed_time_text_length_; }
 
-  // Start() and End() are required in order to be used as node in a ScopeTree.
-  uint64_t Start() const { return timer_info_.start(); }
-  uint64_t End() const { return timer_info_.end(); }
-
- protected:
-  Vec2 pos_;
-  Vec2 size_;
-  std::string text_;
-  orbit_client_protos::TimerInfo timer_info_;
-  size_t elapsed_time_text_length_ = 0;
+ private:
+  uint64_t start_ = 0;
+  uint64_t end_ = 0;
+  uint64_t function_id_ = 0;
+  uint64_t user_data_key_ = 0;
+  uint64_t timeline_hash_ = 0;
+  uint64_t callstack_id_ = 0;
+  // Only set for timers that record the arguments of the function, e.g., manual instrumentation.
+  std::vector<uint64_t> registers_;
+  int32_t process_id_ = 0;
+  int32_t thread_id_ = 0;
+  int32_t processor_ = 0;
+  uint32_t depth_ = 0;
+  // Red, green, blue and alpha, one byte each, from the most significant byte.
+  uint32_t color_ = 0;
+  uint8_t type_ = orbit_client_protos::TimerInfo::kNone;
+  bool has_color_ = false;
 };
 
 #endif  // ORBIT_GL_TEXT_BOX_H_
@@ -0,0 +1,70 @@
+// Copyright (c) 2021 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <google/protobuf/util/message_differencer.h>
+#include <gtest/gtest.h>
+
+#include "TextBox.h"
+#include "capture_data.pb.h"
+
+using google::protobuf::util::MessageDifferencer;
+using orbit_client_protos::TimerInfo;
+
+TEST(TextBox, GetTimerInfoReturnsTheTimerInfoItWasCreatedFrom) {
+  TimerInfo timer_info;
+  timer_info.set_start(100);
+  timer_info.set_end(200);
+  timer_info.set_process_id(1);
+  timer_info.set_thread_id(2);
+  timer_info.set_depth(3);
+  timer_info.set_type(TimerInfo::kGpuDebugMarker);
+  timer_info.set_processor(4);
+  timer_info.set_callstack_id(5);
+  timer_info.set_function_id(6);
+  timer_info.set_user_data_key(7);
+  timer_info.set_timeline_hash(8);
+  for (uint64_t i = 0; i < 6; ++i) {
+    timer_info.add_registers(i * 0x1000);
+  }
+  timer_info.mutable_color()->set_red(255);
+  timer_info.mutable_color()->set_green(128);
+  timer_info.mutable_color()->set_blue(1);
+  timer_info.mutable_color()->set_alpha(0);
+
+  TextBox text_box(timer_info);
+  EXPECT_EQ(text_box.Start(), 100);
+  EXPECT_EQ(text_box.End(), 200);
+  EXPECT_EQ(text_box.GetThreadId(), 2);
+  EXPECT_EQ(text_box.GetDepth(), 3);
+  EXPECT_EQ(text_box.GetType(), TimerInfo::kGpuDebugMarker);
+  EXPECT_EQ(text_box.GetFunctionId(), 6);
+  EXPECT_TRUE(MessageDifferencer::Equals(text_box.GetTimerInfo(), timer_info));
+}
+
+TEST(TextBox, GetTimerInfoWithoutColorAndRegisters) {
+  TimerInfo timer_info;
+  timer_info.set_start(1);
+  timer_info.set_end(2);
+  timer_info.set_function_id(3);
+
+  TimerInfo actual_timer_info = TextBox(timer_info).GetTimerInfo();
+  EXPECT_FALSE(actual_timer_info.has_color());
+  EXPECT_EQ(actual_timer_info.registers_size(), 0);
+  EXPECT_TRUE(MessageDifferencer::Equals(actual_timer_info, timer_info));
+}
+
+TEST(TextBox, ColorChannelsOutOfRangeAreMasked) {
+  TimerInfo timer_info;
+  timer_info.mutable_color()->set_red(0x1ff);
+  timer_info.mutable_color()->set_green(0x280);
+  timer_info.mutable_color()->set_blue(0xffffff01);
+  timer_info.mutable_color()->set_alpha(256);
+
+  TimerInfo actual_timer_info = TextBox(timer_info).GetTimerInfo();
+  ASSERT_TRUE(actual_timer_info.has_color());
+  EXPECT_EQ(actual_timer_info.color().red(), 0xff);
+  EXPECT_EQ(actual_timer_info.color().green(), 0x80);
+  EXPECT_EQ(actual_timer_info.color().blue(), 0x01);
+  EXPECT_EQ(actual_timer_info.color().alpha(), 0);
+}
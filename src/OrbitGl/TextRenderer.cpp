@@ -4,6 +4,7 @@
 
 #include "TextRenderer.h"
 
+#include <absl/strings/string_view.h>
 #include <float.h>
 #include <freetype-gl/shader.h>
 #include <freetype-gl/vector.h>
@@ -25,12 +26,6 @@
 #include "OrbitBase/Logging.h"
 #include "OrbitBase/Tracing.h"
 
-struct vertex_t {
-  float x, y, z;     // position
-  float s, t;        // texture
-  float r, g, b, a;  // color
-};
-
 bool TextRenderer::draw_outline_ = false;
 
 TextRenderer::TextRenderer()
@@ -58,18 +53,8 @@ TextRenderer::~TextRenderer() {
 void TextRenderer::Init() {
   if (initialized_) return;
 
-  int atlas_size = 2 * 1024;
-  texture_atlas_ = texture_atlas_new(atlas_size, atlas_size, 1);
-
+  LoadFonts();
   const auto exe_dir = orbit_base::GetExecutableDir();
-  const auto font_file_name = (exe_dir / "fonts" / "Vera.ttf").string();
-
-  for (int i = 1; i <= 100; i += 1) {
-    fonts_by_size_[i] = texture_font_new_from_file(texture_atlas_, i, font_file_name.c_str());
-  }
-
-  pen_.x = 0;
-  pen_.y = 0;
 
   glGenTextures(1, &texture_atlas_->id);
   glBindTexture(GL_TEXTURE_2D, texture_atlas_->id);
@@ -97,8 +82,23 @@ void TextRenderer::Init() {
   initialized_ = true;
 }
 
+// Adding and measuring text only needs the fonts and the texture atlas in memory, not the OpenGL
+// texture, so that text can be laid out before Init is called from the thread of the context.
+void TextRenderer::LoadFonts() {
+  if (!fonts_by_size_.empty()) return;
+
+  int atlas_size = 2 * 1024;
+  texture_atlas_ = texture_atlas_new(atlas_size, atlas_size, 1);
+
+  const auto font_file_name = (orbit_base::GetExecutableDir() / "fonts" / "Vera.ttf").string();
+
+  for (int i = 1; i <= 100; i += 1) {
+    fonts_by_size_[i] = texture_font_new_from_file(texture_atlas_, i, font_file_name.c_str());
+  }
+}
+
 texture_font_t* TextRenderer::GetFont(uint32_t size) {
-  CHECK(!fonts_by_size_.empty());
+  LoadFonts();
   if (fonts_by_size_.count(size) == 0) {
     auto iterator_next = fonts_by_size_.upper_bound(size);
     // If there isn't that font_size in the map, we will search for the next one or previous one
@@ -127,6 +127,7 @@ texture_glyph_t* TextRenderer::MaybeLoadAndGetGlyph(texture_font_t* font, const
 
 void TextRenderer::RenderLayer(Batcher* /*batcher*/, float layer) {
   ORBIT_SCOPE_FUNCTION;
+  absl::MutexLock lock(&mutex_);
   if (vertex_buffers_by_layer_.count(layer) == 0) return;
   auto& buffer = vertex_buffers_by_layer_.at(layer);
 
@@ -182,6 +183,7 @@ void TextRenderer::RenderLayer(Batcher* /*batcher*/, float layer) {
 
 void TextRenderer::RenderDebug(Batcher* batcher) {
   if (!draw_outline_) return;
+  absl::MutexLock lock(&mutex_);
   for (auto& [unused_layer, buffer] : vertex_buffers_by_layer_) {
     DrawOutline(batcher, buffer);
   }
@@ -196,9 +198,9 @@ void TextRenderer::DrawOutline(Batcher* batcher, vertex_buffer_t* vertex_buffer)
     GLuint i1 = *static_cast<const GLuint*>(vector_get(vertex_buffer->indices, i + 1));
     GLuint i2 = *static_cast<const GLuint*>(vector_get(vertex_buffer->indices, i + 2));
 
-    vertex_t v0 = *static_cast<const vertex_t*>(vector_get(vertex_buffer->vertices, i0));
-    vertex_t v1 = *static_cast<const vertex_t*>(vector_get(vertex_buffer->vertices, i1));
-    vertex_t v2 = *static_cast<const vertex_t*>(vector_get(vertex_buffer->vertices, i2));
+    GlyphVertex v0 = *static_cast<const GlyphVertex*>(vector_get(vertex_buffer->vertices, i0));
+    GlyphVertex v1 = *static_cast<const GlyphVertex*>(vector_get(vertex_buffer->vertices, i1));
+    GlyphVertex v2 = *static_cast<const GlyphVertex*>(vector_get(vertex_buffer->vertices, i2));
 
     // TODO: This should be pickable??
     batcher->AddLine(Vec2(v0.x, v0.y), Vec2(v1.x, v1.y), GlCanvas::kZValueSlider, color);
@@ -207,8 +209,58 @@ void TextRenderer::DrawOutline(Batcher* batcher, vertex_buffer_t* vertex_buffer)
   }
 }
 
+const TextRenderer::GlyphRun& TextRenderer::GetGlyphRun(texture_font_t* font, const char* text) {
+  absl::flat_hash_map<std::string, GlyphRun>& glyph_runs = glyph_runs_by_font_[font];
+  auto it = glyph_runs.find(absl::string_view(text));
+  if (it != glyph_runs.end()) return it->second;
+
+  if (num_glyph_runs_ >= kMaxNumGlyphRuns) {
+    for (auto& [unused_font, font_glyph_runs] : glyph_runs_by_font_) {
+      font_glyph_runs.clear();
+    }
+    num_glyph_runs_ = 0;
+  }
+
+  GlyphRun glyph_run;
+  float pen_x = 0.f;
+  float pen_y = 0.f;
+  bool is_first_line = true;
+  float first_line_width = 0.f;
+  const size_t text_length = strlen(text);
+  for (size_t i = 0; i < text_length; ++i) {
+    const bool is_line_break = text[i] == '\n';
+    // Only the glyph of the first line break is needed, as it counts in the size of the first line.
+    if (!is_line_break || is_first_line) {
+      texture_glyph_t* glyph = MaybeLoadAndGetGlyph(font, text + i);
+      if (glyph != nullptr) {
+        float kerning = (i == 0) ? 0.0f : texture_glyph_get_kerning(glyph, text + i - 1);
+        if (is_first_line) {
+          first_line_width += kerning + glyph->advance_x;
+          glyph_run.first_line_height = std::max(glyph_run.first_line_height, glyph->offset_y);
+        }
+        if (!is_line_break) {
+          pen_x += kerning;
+          glyph_run.glyphs.push_back({glyph, pen_x + static_cast<float>(glyph->offset_x),
+                                      pen_y + static_cast<float>(glyph->offset_y), i});
+          pen_x += glyph->advance_x;
+        }
+      }
+    }
+
+    if (is_line_break) {
+      is_first_line = false;
+      pen_x = 0.f;
+      pen_y -= font->height;
+    }
+  }
+  glyph_run.first_line_width = static_cast<int>(ceil(first_line_width));
+
+  ++num_glyph_runs_;
+  return glyph_runs.emplace(text, std::move(glyph_run)).first->second;
+}
+
 void TextRenderer::AddTextInternal(texture_font_t* font, const char* text, const vec4& color,
-                                   vec2* pen, float max_size, float z, vec2* out_text_pos,
+                                   const vec2& pen, float max_size, float z, vec2* out_text_pos,
                                    vec2* out_text_size) {
   float r = color.red;
   float g = color.green;
@@ -222,51 +274,49 @@ void TextRenderer::AddTextInternal(texture_font_t* font, const char* text, const
   float min_y = FLT_MAX;
   float max_y = -FLT_MAX;
   constexpr std::array<GLuint, 6> kIndices = {0, 1, 2, 0, 2, 3};
-  vec2 initial_pen = *pen;
 
-  for (size_t i = 0; i < strlen(text); ++i) {
-    if (text[i] == '\n') {
-      pen->x = initial_pen.x;
-      pen->y -= font->height;
-      continue;
+  text_vertices_.clear();
+  text_indices_.clear();
+  for (const GlyphRun::PositionedGlyph& positioned_glyph : GetGlyphRun(font, text).glyphs) {
+    const texture_glyph_t* glyph = positioned_glyph.glyph;
+    float x0 = floorf(pen.x + positioned_glyph.x);
+    float y0 = floorf(pen.y + positioned_glyph.y);
+    float x1 = floorf(x0 + glyph->width);
+    float y1 = floorf(y0 - glyph->height);
+
+    float s0 = glyph->s0;
+    float t0 = glyph->t0;
+    float s1 = glyph->s1;
+    float t1 = glyph->t1;
+
+    min_x = std::min(min_x, x0);
+    max_x = std::max(max_x, x1);
+    min_y = std::min(min_y, y1);
+    max_y = std::max(max_y, y0);
+
+    str_width = max_x - min_x;
+
+    if (str_width > max_width) {
+      break;
     }
 
-    texture_glyph_t* glyph = MaybeLoadAndGetGlyph(font, text + i);
-    if (glyph != nullptr) {
-      float kerning = (i == 0) ? 0.0f : texture_glyph_get_kerning(glyph, text + i - 1);
-      pen->x += kerning;
-
-      float x0 = floorf(pen->x + glyph->offset_x);
-      float y0 = floorf(pen->y + glyph->offset_y);
-      float x1 = floorf(x0 + glyph->width);
-      float y1 = floorf(y0 - glyph->height);
-
-      float s0 = glyph->s0;
-      float t0 = glyph->t0;
-      float s1 = glyph->s1;
-      float t1 = glyph->t1;
-
-      vertex_t vertices[4] = {{x0, y0, z, s0, t0, r, g, b, a},
-                              {x0, y1, z, s0, t1, r, g, b, a},
-                              {x1, y1, z, s1, t1, r, g, b, a},
-                              {x1, y0, z, s1, t0, r, g, b, a}};
-
-      min_x = std::min(min_x, x0);
-      max_x = std::max(max_x, x1);
-      min_y = std::min(min_y, y1);
-      max_y = std::max(max_y, y0);
-
-      str_width = max_x - min_x;
+    const auto first_vertex_index = static_cast<GLuint>(text_vertices_.size());
+    text_vertices_.push_back({x0, y0, z, s0, t0, r, g, b, a});
+    text_vertices_.push_back({x0, y1, z, s0, t1, r, g, b, a});
+    text_vertices_.push_back({x1, y1, z, s1, t1, r, g, b, a});
+    text_vertices_.push_back({x1, y0, z, s1, t0, r, g, b, a});
+    for (GLuint index : kIndices) {
+      text_indices_.push_back(first_vertex_index + index);
+    }
+  }
 
-      if (str_width > max_width) {
-        break;
-      }
-      if (!vertex_buffers_by_layer_.count(z)) {
-        vertex_buffers_by_layer_[z] = vertex_buffer_new("vertex:3f,tex_coord:2f,color:4f");
-      }
-      vertex_buffer_push_back(vertex_buffers_by_layer_.at(z), vertices, 4, kIndices.data(), 6);
-      pen->x += glyph->advance_x;
+  // The glyphs of the text are pushed at once, as one item of the vertex buffer.
+  if (!text_vertices_.empty()) {
+    if (!vertex_buffers_by_layer_.count(z)) {
+      vertex_buffers_by_layer_[z] = vertex_buffer_new("vertex:3f,tex_coord:2f,color:4f");
     }
+    vertex_buffer_push_back(vertex_buffers_by_layer_.at(z), text_vertices_.data(),
+                            text_vertices_.size(), text_indices_.data(), text_indices_.size());
   }
 
   if (out_text_pos) {
@@ -283,18 +333,27 @@ void TextRenderer::AddTextInternal(texture_font_t* font, const char* text, const
 void TextRenderer::AddText(const char* text, float x, float y, float z, const Color& color,
                            uint32_t font_size, float max_size, bool right_justified,
                            Vec2* out_text_pos, Vec2* out_text_size) {
+  absl::MutexLock lock(&mutex_);
+  AddTextLocked(text, x, y, z, color, font_size, max_size, right_justified, out_text_pos,
+                out_text_size);
+}
+
+void TextRenderer::AddTextLocked(const char* text, float x, float y, float z, const Color& color,
+                                 uint32_t font_size, float max_size, bool right_justified,
+                                 Vec2* out_text_pos, Vec2* out_text_size) {
   if (!font_size) return;
-  ToScreenSpace(x, y, pen_.x, pen_.y);
+  vec2 pen;
+  ToScreenSpace(x, y, pen.x, pen.y);
 
   if (right_justified) {
     max_size = FLT_MAX;
     int string_width = GetStringWidthScreenSpace(text, font_size);
-    pen_.x -= string_width;
+    pen.x -= string_width;
   }
 
   vec2 out_screen_pos;
   vec2 out_screen_size;
-  AddTextInternal(GetFont(font_size), text, ColorToVec4(color), &pen_, max_size, z, &out_screen_pos,
+  AddTextInternal(GetFont(font_size), text, ColorToVec4(color), pen, max_size, z, &out_screen_pos,
                   &out_screen_size);
   if (out_text_pos) {
     float inv_y = canvas_->GetHeight() - out_screen_pos.y;
@@ -311,47 +370,33 @@ float TextRenderer::AddTextTrailingCharsPrioritized(const char* text, float x, f
                                                     const Color& color,
                                                     size_t trailing_chars_length,
                                                     uint32_t font_size, float max_size) {
-  if (!initialized_) {
-    Init();
-  }
-
-  float temp_pen_x = ToScreenSpace(x);
+  absl::MutexLock lock(&mutex_);
+  float pen_x = ToScreenSpace(x);
   float max_width = max_size == -1.f ? FLT_MAX : ToScreenSpace(max_size);
   float string_width = 0.f;
   int min_x = INT_MAX;
   int max_x = -INT_MAX;
 
   const size_t text_length = strlen(text);
-  texture_font_t* font = GetFont(font_size);
-  size_t i;
-  for (i = 0; i < text_length; ++i) {
-    texture_glyph_t* glyph = MaybeLoadAndGetGlyph(font, text + i);
-    if (glyph != nullptr) {
-      float kerning = 0.0f;
-      if (i > 0) {
-        kerning = texture_glyph_get_kerning(glyph, text + i - 1);
-      }
-      temp_pen_x += kerning;
-      int x0 = static_cast<int>(temp_pen_x + glyph->offset_x);
-      int x1 = static_cast<int>(x0 + glyph->width);
-
-      min_x = std::min(min_x, x0);
-      max_x = std::max(max_x, x1);
-      string_width = float(max_x - min_x);
-
-      if (string_width > max_width) {
-        break;
-      }
-
-      temp_pen_x += glyph->advance_x;
+  const GlyphRun& glyph_run = GetGlyphRun(GetFont(font_size), text);
+  size_t fitting_chars_count = text_length;
+  for (const GlyphRun::PositionedGlyph& positioned_glyph : glyph_run.glyphs) {
+    int x0 = static_cast<int>(pen_x + positioned_glyph.x);
+    int x1 = static_cast<int>(x0 + positioned_glyph.glyph->width);
+
+    min_x = std::min(min_x, x0);
+    max_x = std::max(max_x, x1);
+    string_width = float(max_x - min_x);
+
+    if (string_width > max_width) {
+      fitting_chars_count = positioned_glyph.char_index;
+      break;
     }
   }
 
   // TODO: Technically, we'd want the size of "... <TIME>" + remaining
   // characters
 
-  auto fitting_chars_count = i;
-
   static const char* kEllipsisText = "... ";
   static const size_t kEllipsisTextLen = strlen(kEllipsisText);
   static const size_t kLeadingCharsCount = 1;
@@ -361,8 +406,10 @@ float TextRenderer::AddTextTrailingCharsPrioritized(const char* text, float x, f
                            (fitting_chars_count > (trailing_chars_length + kEllipsisBufferSize));
 
   if (!use_ellipsis_text) {
-    AddText(text, x, y, z, color, font_size, max_size);
-    return GetStringWidth(text, font_size);
+    const float text_width = canvas_->ScreenToWorldWidth(glyph_run.first_line_width);
+    AddTextLocked(text, x, y, z, color, font_size, max_size, /*right_justified=*/false,
+                  /*out_text_pos=*/nullptr, /*out_text_size=*/nullptr);
+    return text_width;
   }
 
   auto leading_char_count = fitting_chars_count - (trailing_chars_length + kEllipsisTextLen);
@@ -373,58 +420,35 @@ float TextRenderer::AddTextTrailingCharsPrioritized(const char* text, float x, f
   auto time_position = text_length - trailing_chars_length;
   modified_text.append(&text[time_position], trailing_chars_length);
 
-  AddText(modified_text.c_str(), x, y, z, color, font_size, max_size);
-  return GetStringWidth(modified_text.c_str(), font_size);
+  AddTextLocked(modified_text.c_str(), x, y, z, color, font_size, max_size,
+                /*right_justified=*/false, /*out_text_pos=*/nullptr, /*out_text_size=*/nullptr);
+  return GetStringWidthLocked(modified_text.c_str(), font_size);
 }
 
 float TextRenderer::GetStringWidth(const char* text, uint32_t font_size) {
+  absl::MutexLock lock(&mutex_);
+  return GetStringWidthLocked(text, font_size);
+}
+
+float TextRenderer::GetStringWidthLocked(const char* text, uint32_t font_size) {
   return canvas_->ScreenToWorldWidth(GetStringWidthScreenSpace(text, font_size));
 }
 
 float TextRenderer::GetStringHeight(const char* text, uint32_t font_size) {
+  absl::MutexLock lock(&mutex_);
   return canvas_->ScreenToWorldHeight(GetStringHeightScreenSpace(text, font_size));
 }
 
 int TextRenderer::GetStringWidthScreenSpace(const char* text, uint32_t font_size) {
-  float string_width = 0;
-
-  std::size_t len = strlen(text);
-  for (std::size_t i = 0; i < len; ++i) {
-    texture_font_t* font = GetFont(font_size);
-    texture_glyph_t* glyph = MaybeLoadAndGetGlyph(font, text + i);
-    if (glyph != nullptr) {
-      float kerning = 0.0f;
-      if (i > 0) {
-        kerning = texture_glyph_get_kerning(glyph, text + i - 1);
-      }
-
-      string_width += kerning;
-      string_width += glyph->advance_x;
-    }
-
-    // Only return width of first line.
-    if (text[i] == '\n') break;
-  }
-
-  return static_cast<int>(ceil(string_width));
+  return GetGlyphRun(GetFont(font_size), text).first_line_width;
 }
 
 int TextRenderer::GetStringHeightScreenSpace(const char* text, uint32_t font_size) {
-  int max_height = 0.f;
-  texture_font_t* font = GetFont(font_size);
-  for (std::size_t i = 0; i < strlen(text); ++i) {
-    texture_glyph_t* glyph = MaybeLoadAndGetGlyph(font, text + i);
-    if (glyph != nullptr) {
-      max_height = std::max(max_height, glyph->offset_y);
-    }
-
-    // Only return height of first line.
-    if (text[i] == '\n') break;
-  }
-  return max_height;
+  return GetGlyphRun(GetFont(font_size), text).first_line_height;
 }
 
 std::vector<float> TextRenderer::GetLayers() const {
+  absl::MutexLock lock(&mutex_);
   std::vector<float> layers;
   for (auto& [layer, unused_buffer] : vertex_buffers_by_layer_) {
     layers.push_back(layer);
@@ -447,8 +471,7 @@ float TextRenderer::ToScreenSpace(float width) {
 }
 
 void TextRenderer::Clear() {
-  pen_.x = 0.f;
-  pen_.y = 0.f;
+  absl::MutexLock lock(&mutex_);
   for (auto& [unused_layer, buffer] : vertex_buffers_by_layer_) {
     vertex_buffer_clear(buffer);
   }
@@ -6,6 +6,8 @@
 #define ORBIT_GL_TEXT_RENDERER_H_
 
 #include <GteVector.h>
+#include <absl/container/flat_hash_map.h>
+#include <absl/synchronization/mutex.h>
 #include <freetype-gl/mat4.h>
 #include <freetype-gl/texture-atlas.h>
 #include <freetype-gl/texture-font.h>
@@ -14,6 +16,7 @@
 #include <stdint.h>
 
 #include <map>
+#include <string>
 #include <unordered_map>
 #include <vector>
 
@@ -29,6 +32,9 @@ struct texture_font_t;
 
 class GlCanvas;
 
+// Adding text and measuring strings can be done from several threads at the same time, e.g., by
+// the tracks that update their primitives in parallel. Init and the rendering have to be called
+// from the thread that owns the OpenGL context.
 class TextRenderer {
  public:
   explicit TextRenderer();
@@ -56,20 +62,67 @@ class TextRenderer {
   static void SetDrawOutline(bool value) { draw_outline_ = value; }
 
  protected:
-  void AddTextInternal(texture_font_t* font, const char* text, const vec4& color, vec2* pen,
+  // The glyphs of a string laid out with one font, positioned relative to the pen position the
+  // string starts at, so that the string can be added anywhere without looking up its glyphs.
+  struct GlyphRun {
+    struct PositionedGlyph {
+      texture_glyph_t* glyph;
+      // Top left corner of the glyph, before rounding down to the pixel.
+      float x;
+      float y;
+      // Index in the string of the character the glyph is for.
+      size_t char_index;
+    };
+
+    std::vector<PositionedGlyph> glyphs;
+    // Size of the first line in screen space, as returned by Get(Width|Height)ScreenSpace.
+    int first_line_width = 0;
+    int first_line_height = 0;
+  };
+
+  // The methods below require mutex_ to be held, as they access the fonts, the texture atlas and
+  // the vertex buffers.
+  void AddTextLocked(const char* text, float x, float y, float z, const Color& color,
+                     uint32_t font_size, float max_size, bool right_justified,
+                     Vec2* out_text_pos, Vec2* out_text_size) ABSL_EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+  [[nodiscard]] float GetStringWidthLocked(const char* text, uint32_t font_size)
+      ABSL_EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+  [[nodiscard]] const GlyphRun& GetGlyphRun(texture_font_t* font, const char* text)
+      ABSL_EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+  void AddTextInternal(texture_font_t* font, const char* text, const vec4& color, const vec2& pen,
                        float max_size = -1.f, float z = -0.01f, vec2* out_text_pos = nullptr,
-                       vec2* out_text_size = nullptr);
+                       vec2* out_text_size = nullptr) ABSL_EXCLUSIVE_LOCKS_REQUIRED(mutex_);
 
   void ToScreenSpace(float x, float y, float& o_x, float& o_y);
   [[nodiscard]] float ToScreenSpace(float width);
-  [[nodiscard]] int GetStringWidthScreenSpace(const char* text, uint32_t font_size);
-  [[nodiscard]] int GetStringHeightScreenSpace(const char* text, uint32_t font_size);
+  [[nodiscard]] int GetStringWidthScreenSpace(const char* text, uint32_t font_size)
+      ABSL_EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+  [[nodiscard]] int GetStringHeightScreenSpace(const char* text, uint32_t font_size)
+      ABSL_EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+  void LoadFonts();
   [[nodiscard]] texture_font_t* GetFont(uint32_t size);
   [[nodiscard]] texture_glyph_t* MaybeLoadAndGetGlyph(texture_font_t* self, const char* character);
 
   void DrawOutline(Batcher* batcher, vertex_buffer_t* buffer);
 
+  // Timer labels mostly stay the same from one frame to the next, so the glyph runs are cached
+  // until there are too many of them.
+  static constexpr size_t kMaxNumGlyphRuns = 1 << 15;
+
+  [[nodiscard]] size_t GetNumGlyphRuns() const ABSL_EXCLUSIVE_LOCKS_REQUIRED(mutex_) {
+    return num_glyph_runs_;
+  }
+
+  mutable absl::Mutex mutex_;
+
  private:
+  // Vertex layout of the vertex buffers: position, texture coordinates and color.
+  struct GlyphVertex {
+    float x, y, z;
+    float s, t;
+    float r, g, b, a;
+  };
+
   texture_atlas_t* texture_atlas_;
   // Indicates when a change to the texture atlas occurred so that we have to reupload the
   // texture data. Only freetype-gl's texture_font_load_glyph modifies the texture atlas,
@@ -77,12 +130,18 @@ class TextRenderer {
   bool texture_atlas_changed_;
   std::unordered_map<float, vertex_buffer_t*> vertex_buffers_by_layer_;
   std::map<uint32_t, texture_font_t*> fonts_by_size_;
+  absl::flat_hash_map<const texture_font_t*, absl::flat_hash_map<std::string, GlyphRun>>
+      glyph_runs_by_font_;
+  size_t num_glyph_runs_ = 0;
+  // The vertices and indices of the glyphs of the text being added, pushed to the vertex buffer of
+  // its layer at once. Kept between calls to not allocate them for every text.
+  std::vector<GlyphVertex> text_vertices_;
+  std::vector<GLuint> text_indices_;
   GlCanvas* canvas_;
   GLuint shader_;
   mat4 model_;
   mat4 view_;
   mat4 projection_;
-  vec2 pen_;
   bool initialized_;
   static bool draw_outline_;
 };
@@ -0,0 +1,108 @@
+// Copyright (c) 2021 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <absl/strings/str_format.h>
+#include <benchmark/benchmark.h>
+
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+#include "CoreMath.h"
+#include "GlCanvas.h"
+#include "OrbitBase/ExecutablePath.h"
+#include "TextRenderer.h"
+
+// These benchmarks measure laying out the labels of timers with a TextRenderer, which only needs
+// the fonts next to the executable and no OpenGL context, as the text is not rendered.
+
+namespace {
+
+constexpr int kNumLabelsPerFrame = 100'000;
+// Fewer than the glyph runs the TextRenderer caches.
+constexpr int kNumRepeatedLabels = 10'000;
+constexpr uint32_t kFontSize = 14;
+constexpr float kMaxLabelWidth = 200.f;
+const Color kColor(255, 255, 255, 255);
+
+[[nodiscard]] bool AreFontsAvailable() {
+  return std::filesystem::exists(orbit_base::GetExecutableDir() / "fonts" / "Vera.ttf");
+}
+
+// Labels as drawn on timers: a function name followed by a duration, of which the duration is kept
+// when the label is elided.
+[[nodiscard]] std::vector<std::string> CreateTimerLabels(int num_labels) {
+  std::vector<std::string> labels;
+  labels.reserve(num_labels);
+  for (int i = 0; i < num_labels; ++i) {
+    labels.push_back(absl::StrFormat("synthetic::Function%d(int, float) %d.%03d ms", i % 16,
+                                     i / 1000, i % 1000));
+  }
+  return labels;
+}
+
+[[nodiscard]] float GetX(int i) { return static_cast<float>(i * 97 % 1920); }
+
+[[nodiscard]] float GetY(int i) { return static_cast<float>(i % 1080); }
+
+void AddTimerLabels(benchmark::State& state, const std::vector<std::string>& labels) {
+  if (!AreFontsAvailable()) {
+    state.SkipWithError("The fonts are not next to the executable.");
+    return;
+  }
+  GlCanvas canvas;
+  canvas.Resize(1920, 1080);
+  TextRenderer text_renderer;
+  text_renderer.SetCanvas(&canvas);
+
+  size_t label_index = 0;
+  for (auto _ : state) {
+    text_renderer.Clear();
+    for (int i = 0; i < kNumLabelsPerFrame; ++i) {
+      const std::string& label = labels[label_index];
+      label_index = (label_index + 1) % labels.size();
+      benchmark::DoNotOptimize(text_renderer.AddTextTrailingCharsPrioritized(
+          label.c_str(), GetX(i), GetY(i), 0.f, kColor, /*trailing_chars_length=*/8, kFontSize,
+          kMaxLabelWidth));
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * kNumLabelsPerFrame);
+}
+
+// The labels of the timers of one frame mostly were in the previous frame too, so their glyph runs
+// are cached.
+void BM_AddRepeatedTimerLabels(benchmark::State& state) {
+  AddTimerLabels(state, CreateTimerLabels(kNumRepeatedLabels));
+}
+
+// More different labels than the glyph runs cache holds, as when zooming changes the durations.
+void BM_AddNewTimerLabels(benchmark::State& state) {
+  AddTimerLabels(state, CreateTimerLabels(2 * kNumLabelsPerFrame));
+}
+
+void BM_GetStringWidth(benchmark::State& state) {
+  if (!AreFontsAvailable()) {
+    state.SkipWithError("The fonts are not next to the executable.");
+    return;
+  }
+  GlCanvas canvas;
+  canvas.Resize(1920, 1080);
+  TextRenderer text_renderer;
+  text_renderer.SetCanvas(&canvas);
+  const std::vector<std::string> labels = CreateTimerLabels(kNumRepeatedLabels);
+
+  for (auto _ : state) {
+    for (const std::string& label : labels) {
+      benchmark::DoNotOptimize(text_renderer.GetStringWidth(label.c_str(), kFontSize));
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * kNumRepeatedLabels);
+}
+
+}  // namespace
+
+BENCHMARK(BM_AddRepeatedTimerLabels);
+BENCHMARK(BM_AddNewTimerLabels);
+BENCHMARK(BM_GetStringWidth);
@@ -0,0 +1,118 @@
+// Copyright (c) 2021 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <absl/strings/str_format.h>
+#include <absl/synchronization/mutex.h>
+#include <gtest/gtest.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include <filesystem>
+#include <string>
+
+#include "GlCanvas.h"
+#include "OrbitBase/ExecutablePath.h"
+#include "TextRenderer.h"
+
+namespace {
+
+constexpr uint32_t kFontSize = 14;
+
+[[nodiscard]] bool AreFontsAvailable() {
+  return std::filesystem::exists(orbit_base::GetExecutableDir() / "fonts" / "Vera.ttf");
+}
+
+class GlyphRunsTextRenderer : public TextRenderer {
+ public:
+  using TextRenderer::GlyphRun;
+  using TextRenderer::kMaxNumGlyphRuns;
+
+  [[nodiscard]] const GlyphRun* GetGlyphRun(const std::string& text, uint32_t font_size) {
+    absl::MutexLock lock(&mutex_);
+    return &TextRenderer::GetGlyphRun(GetFont(font_size), text.c_str());
+  }
+
+  [[nodiscard]] size_t GetNumGlyphRuns() {
+    absl::MutexLock lock(&mutex_);
+    return TextRenderer::GetNumGlyphRuns();
+  }
+
+  // Fills the cache up to kMaxNumGlyphRuns with runs of texts other than the ones of the tests.
+  void FillGlyphRuns() {
+    for (size_t i = GetNumGlyphRuns(); i < kMaxNumGlyphRuns; ++i) {
+      (void)GetGlyphRun(absl::StrFormat("#%d", i), kFontSize);
+    }
+  }
+};
+
+}  // namespace
+
+TEST(TextRenderer, GetGlyphRunReturnsTheCachedRunForTheSameText) {
+  if (!AreFontsAvailable()) GTEST_SKIP();
+  GlyphRunsTextRenderer text_renderer;
+
+  const GlyphRunsTextRenderer::GlyphRun* glyph_run = text_renderer.GetGlyphRun("abc", kFontSize);
+  EXPECT_EQ(glyph_run->glyphs.size(), 3);
+  EXPECT_EQ(text_renderer.GetNumGlyphRuns(), 1);
+
+  EXPECT_EQ(text_renderer.GetGlyphRun("abc", kFontSize), glyph_run);
+  EXPECT_EQ(text_renderer.GetNumGlyphRuns(), 1);
+
+  EXPECT_NE(text_renderer.GetGlyphRun("abcd", kFontSize), glyph_run);
+  EXPECT_NE(text_renderer.GetGlyphRun("abc", kFontSize + 1), glyph_run);
+  EXPECT_EQ(text_renderer.GetNumGlyphRuns(), 3);
+}
+
+TEST(TextRenderer, GlyphRunsAreClearedWhenTheCacheIsFull) {
+  if (!AreFontsAvailable()) GTEST_SKIP();
+  GlyphRunsTextRenderer text_renderer;
+
+  const GlyphRunsTextRenderer::GlyphRun* glyph_run = text_renderer.GetGlyphRun("abc", kFontSize);
+  text_renderer.FillGlyphRuns();
+  EXPECT_EQ(text_renderer.GetNumGlyphRuns(), GlyphRunsTextRenderer::kMaxNumGlyphRuns);
+
+  // A full cache still returns the runs it holds.
+  EXPECT_EQ(text_renderer.GetGlyphRun("abc", kFontSize), glyph_run);
+  EXPECT_EQ(text_renderer.GetNumGlyphRuns(), GlyphRunsTextRenderer::kMaxNumGlyphRuns);
+
+  // A new text evicts all the runs, then is the only one in the cache.
+  (void)text_renderer.GetGlyphRun("def", kFontSize);
+  EXPECT_EQ(text_renderer.GetNumGlyphRuns(), 1);
+  (void)text_renderer.GetGlyphRun("def", kFontSize);
+  EXPECT_EQ(text_renderer.GetNumGlyphRuns(), 1);
+
+  // The evicted run is laid out again.
+  EXPECT_EQ(text_renderer.GetGlyphRun("abc", kFontSize)->glyphs.size(), 3);
+  EXPECT_EQ(text_renderer.GetNumGlyphRuns(), 2);
+}
+
+TEST(TextRenderer, StringSizeIsTheSameForCachedAndUncachedGlyphRuns) {
+  if (!AreFontsAvailable()) GTEST_SKIP();
+  GlCanvas canvas;
+  canvas.Resize(1920, 1080);
+  GlyphRunsTextRenderer text_renderer;
+  text_renderer.SetCanvas(&canvas);
+  const char* text = "synthetic::Function(int, float) 1.234 ms\nsecond line";
+
+  const float uncached_width = text_renderer.GetStringWidth(text, kFontSize);
+  const float uncached_height = text_renderer.GetStringHeight(text, kFontSize);
+  EXPECT_GT(uncached_width, 0.f);
+  EXPECT_GT(uncached_height, 0.f);
+  EXPECT_EQ(text_renderer.GetNumGlyphRuns(), 1);
+
+  EXPECT_EQ(text_renderer.GetStringWidth(text, kFontSize), uncached_width);
+  EXPECT_EQ(text_renderer.GetStringHeight(text, kFontSize), uncached_height);
+  EXPECT_EQ(text_renderer.GetNumGlyphRuns(), 1);
+
+  // Laid out again after the eviction, and by a renderer that never cached it.
+  text_renderer.FillGlyphRuns();
+  (void)text_renderer.GetGlyphRun("def", kFontSize);
+  EXPECT_EQ(text_renderer.GetStringWidth(text, kFontSize), uncached_width);
+  EXPECT_EQ(text_renderer.GetNumGlyphRuns(), 2);
+
+  TextRenderer other_text_renderer;
+  other_text_renderer.SetCanvas(&canvas);
+  EXPECT_EQ(other_text_renderer.GetStringWidth(text, kFontSize), uncached_width);
+  EXPECT_EQ(other_text_renderer.GetStringHeight(text, kFontSize), uncached_height);
+}
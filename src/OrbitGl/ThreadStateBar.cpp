@@ -6,7 +6,10 @@
 
 #include <absl/strings/str_format.h>
 
+#include <algorithm>
+#include <array>
 #include <memory>
+#include <optional>
 #include <utility>
 
 #include "App.h"
@@ -140,79 +143,88 @@ static std::string GetThreadStateDescription(ThreadStateSliceInfo::ThreadState s
   }
 }
 
-std::string ThreadStateBar::GetThreadStateSliceTooltip(Batcher* batcher, PickingId id) const {
-  auto user_data = batcher->GetUserData(id);
-  if (user_data == nullptr || user_data->custom_data_ == nullptr) {
+std::string ThreadStateBar::GetThreadStateSliceTooltip(const Batcher& batcher,
+                                                       PickingId id) const {
+  const PickingUserData* user_data = batcher.GetUserData(id);
+  if (user_data == nullptr) {
     return "";
   }
 
-  const auto* thread_state_slice =
-      static_cast<const ThreadStateSliceInfo*>(user_data->custom_data_);
+  const auto thread_state = static_cast<ThreadStateSliceInfo::ThreadState>(user_data->custom_id_);
   return absl::StrFormat(
       "<b>%s</b><br/>"
       "<i>Thread state</i><br/>"
       "<br/>"
       "%s",
-      GetThreadStateName(thread_state_slice->thread_state()),
-      GetThreadStateDescription(thread_state_slice->thread_state()));
+      GetThreadStateName(thread_state), GetThreadStateDescription(thread_state));
 }
 
 void ThreadStateBar::UpdatePrimitives(Batcher* batcher, uint64_t min_tick, uint64_t max_tick,
                                       PickingMode picking_mode, float z_offset) {
   ThreadBar::UpdatePrimitives(batcher, min_tick, max_tick, picking_mode, z_offset);
 
-  const GlCanvas* canvas = time_graph_->GetCanvas();
+  const TimeGraphView& view = time_graph_->GetPrimitivesView();
 
-  const auto time_window_ns = static_cast<uint64_t>(1000 * time_graph_->GetTimeWindowUs());
-  const uint64_t pixel_delta_ns = time_window_ns / canvas->GetWidth();
-  const uint64_t min_time_graph_ns = time_graph_->GetTickFromUs(time_graph_->GetMinTimeUs());
+  const auto time_window_ns = static_cast<uint64_t>(1000 * view.time_window_us);
+  const uint64_t pixel_delta_ns = time_window_ns / view.screen_width;
+  const uint64_t min_time_graph_ns = view.GetMinTick();
   const float pixel_width_in_world_coords =
-      canvas->GetWorldWidth() / static_cast<float>(canvas->GetWidth());
+      view.world_width / static_cast<float>(view.screen_width);
 
-  uint64_t ignore_until_ns = 0;
+  const TooltipCallback* tooltip_callback = batcher->AddTooltipCallback(
+      [this](const Batcher& batcher, PickingId id) {
+        return GetThreadStateSliceTooltip(batcher, id);
+      });
+
+  // Consecutive slices that are not wider than a pixel are coalesced into one box per pixel
+  // column, with the color of the state the thread spent the most time in within these slices.
+  // Similar to TimerTrack::UpdatePrimitives, this avoids drawing many boxes over each other.
+  const uint64_t column_width_ns = std::max<uint64_t>(pixel_delta_ns, 1);
+  std::optional<uint64_t> coalesced_column;
+  std::array<uint64_t, ThreadStateSliceInfo::ThreadState_ARRAYSIZE> coalesced_durations_by_state{};
+  auto draw_coalesced_slices = [&]() {
+    if (!coalesced_column.has_value()) return;
+    const auto dominant_state = static_cast<ThreadStateSliceInfo::ThreadState>(
+        std::max_element(coalesced_durations_by_state.begin(),
+                         coalesced_durations_by_state.end()) -
+        coalesced_durations_by_state.begin());
+    const uint64_t column_begin_ns = min_time_graph_ns + *coalesced_column * column_width_ns;
+    // Use AddBox instead of AddVerticalLine as otherwise the tops of Boxes and lines wouldn't be
+    // properly aligned.
+    Box box({view.GetWorldFromTick(column_begin_ns), pos_[1]},
+            {pixel_width_in_world_coords, -size_[1]}, GlCanvas::kZValueEvent + z_offset);
+    batcher->AddBox(box, GetThreadStateColor(dominant_state),
+                    PickingUserData(nullptr, tooltip_callback, dominant_state));
+    coalesced_column.reset();
+    coalesced_durations_by_state.fill(0);
+  };
 
   CHECK(capture_data_ != nullptr);
   capture_data_->ForEachThreadStateSliceIntersectingTimeRange(
       thread_id_, min_tick, max_tick, [&](const ThreadStateSliceInfo& slice) {
-        if (slice.end_timestamp_ns() <= ignore_until_ns) {
-          // Reduce overdraw by not drawing slices whose entire width would only draw over a
-          // previous slice. Similar to TimerTrack::UpdatePrimitives.
+        const uint64_t duration_ns = slice.end_timestamp_ns() - slice.begin_timestamp_ns();
+        if (duration_ns <= pixel_delta_ns) {
+          // Slices before the start of the time graph are counted in its first column.
+          const uint64_t column =
+              (std::max(slice.begin_timestamp_ns(), min_time_graph_ns) - min_time_graph_ns) /
+              column_width_ns;
+          if (coalesced_column != column) {
+            draw_coalesced_slices();
+            coalesced_column = column;
+          }
+          // Empty slices still count, so that the dominant state is one of the coalesced ones.
+          coalesced_durations_by_state[slice.thread_state()] += std::max<uint64_t>(duration_ns, 1);
           return;
         }
 
-        const float x0 = time_graph_->GetWorldFromTick(slice.begin_timestamp_ns());
-        const float x1 = time_graph_->GetWorldFromTick(slice.end_timestamp_ns());
-        const float width = x1 - x0;
-
-        const Vec2 pos{x0, pos_[1]};
-        const Vec2 size{width, -size_[1]};
-
-        const Color color = GetThreadStateColor(slice.thread_state());
-
-        auto user_data = std::make_unique<PickingUserData>(nullptr, [&, batcher](PickingId id) {
-          return GetThreadStateSliceTooltip(batcher, id);
-        });
-        user_data->custom_data_ = &slice;
-
-        if (slice.end_timestamp_ns() - slice.begin_timestamp_ns() > pixel_delta_ns) {
-          Box box(pos, size, GlCanvas::kZValueEvent + z_offset);
-          batcher->AddBox(box, color, std::move(user_data));
-        } else {
-          // Make this slice cover an entire pixel and don't draw subsequent slices that would
-          // coincide with the same pixel.
-          // Use AddBox instead of AddVerticalLine as otherwise the tops of Boxes and lines wouldn't
-          // be properly aligned.
-          Box box(pos, {pixel_width_in_world_coords, size[1]}, GlCanvas::kZValueEvent + z_offset);
-          batcher->AddBox(box, color, std::move(user_data));
-
-          if (pixel_delta_ns != 0) {
-            ignore_until_ns =
-                min_time_graph_ns +
-                (slice.begin_timestamp_ns() - min_time_graph_ns) / pixel_delta_ns * pixel_delta_ns +
-                pixel_delta_ns;
-          }
-        }
+        draw_coalesced_slices();
+        const float x0 = view.GetWorldFromTick(slice.begin_timestamp_ns());
+        const float x1 = view.GetWorldFromTick(slice.end_timestamp_ns());
+        Box box({x0, pos_[1]}, {x1 - x0, -size_[1]}, GlCanvas::kZValueEvent + z_offset);
+        batcher->AddBox(box, GetThreadStateColor(slice.thread_state()),
+                        PickingUserData(nullptr, tooltip_callback, slice.thread_state()));
       });
+  draw_coalesced_slices();
 }
 
 void ThreadStateBar::OnPick(int x, int y) {
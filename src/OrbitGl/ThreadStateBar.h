@@ -36,7 +36,7 @@ class ThreadStateBar final : public ThreadBar {
   [[nodiscard]] bool IsEmpty() const override;
 
  private:
-  std::string GetThreadStateSliceTooltip(Batcher* batcher, PickingId id) const;
+  std::string GetThreadStateSliceTooltip(const Batcher& batcher, PickingId id) const;
 };
 
 }  // namespace orbit_gl
@@ -75,18 +75,16 @@ void ThreadTrack::InitializeNameAndLabel(int32_t thread_id) {
 }
 
 const TextBox* ThreadTrack::GetLeft(const TextBox* text_box) const {
-  const TimerInfo& timer_info = text_box->GetTimerInfo();
-  if (timer_info.thread_id() == thread_id_) {
-    std::shared_ptr<TimerChain> timers = GetTimers(timer_info.depth());
+  if (text_box->GetThreadId() == thread_id_) {
+    std::shared_ptr<TimerChain> timers = GetTimers(text_box->GetDepth());
     if (timers) return timers->GetElementBefore(text_box);
   }
   return nullptr;
 }
 
 const TextBox* ThreadTrack::GetRight(const TextBox* text_box) const {
-  const TimerInfo& timer_info = text_box->GetTimerInfo();
-  if (timer_info.thread_id() == thread_id_) {
-    std::shared_ptr<TimerChain> timers = GetTimers(timer_info.depth());
+  if (text_box->GetThreadId() == thread_id_) {
+    std::shared_ptr<TimerChain> timers = GetTimers(text_box->GetDepth());
     if (timers) return timers->GetElementAfter(text_box);
   }
   return nullptr;
@@ -94,23 +92,23 @@ const TextBox* ThreadTrack::GetRight(const TextBox* text_box) const {
 
 std::string ThreadTrack::GetBoxTooltip(const Batcher& batcher, PickingId id) const {
   const TextBox* text_box = batcher.GetTextBox(id);
-  if (!text_box || text_box->GetTimerInfo().type() == TimerInfo::kCoreActivity) {
+  if (!text_box || text_box->GetType() == TimerInfo::kCoreActivity) {
     return "";
   }
+  const TimerInfo timer_info = text_box->GetTimerInfo();
 
   const FunctionInfo* func =
-      capture_data_
-          ? capture_data_->GetInstrumentedFunctionById(text_box->GetTimerInfo().function_id())
-          : nullptr;
+      capture_data_ ? capture_data_->GetInstrumentedFunctionById(timer_info.function_id())
+                    : nullptr;
 
   if (!func) {
-    return text_box->GetText();
+    return GetTimesliceText(timer_info,
+                            GetPrettyTime(TicksToDuration(timer_info.start(), timer_info.end())));
   }
 
   std::string function_name;
   bool is_manual = func->orbit_type() == orbit_client_protos::FunctionInfo::kOrbitTimerStart;
   if (is_manual) {
-    const TimerInfo& timer_info = text_box->GetTimerInfo();
     auto api_event = ManualInstrumentationManager::ApiEventFromTimerInfo(timer_info);
     function_name = api_event.name;
   } else {
@@ -124,11 +122,11 @@ std::string ThreadTrack::GetBoxTooltip(const Batcher& batcher, PickingId id) con
       "<b>Module:</b> %s<br/>"
       "<b>Time:</b> %s",
       function_name, is_manual ? "manual" : "dynamic", function_utils::GetLoadedModuleName(*func),
-      GetPrettyTime(
-          TicksToDuration(text_box->GetTimerInfo().start(), text_box->GetTimerInfo().end())));
+      GetPrettyTime(TicksToDuration(timer_info.start(), timer_info.end())));
 }
 
-bool ThreadTrack::IsTimerActive(const TimerInfo& timer_info) const {
+bool ThreadTrack::IsTimerActive(const TimerInfo& timer_info,
+                                const internal::DrawData& /*draw_data*/) const {
   return timer_info.type() == TimerInfo::kIntrospection ||
          app_->IsFunctionVisible(timer_info.function_id());
 }
@@ -158,7 +156,8 @@ bool ThreadTrack::IsTrackSelected() const {
 }
 
 Color ThreadTrack::GetTimerColor(const TimerInfo& timer_info, bool is_selected,
-                                 bool is_highlighted) const {
+                                 bool is_highlighted,
+                                 const internal::DrawData& draw_data) const {
   const Color kInactiveColor(100, 100, 100, 255);
   const Color kSelectionColor(0, 128, 255, 255);
   if (is_highlighted) {
@@ -167,7 +166,7 @@ Color ThreadTrack::GetTimerColor(const TimerInfo& timer_info, bool is_selected,
   if (is_selected) {
     return kSelectionColor;
   }
-  if (!IsTimerActive(timer_info)) {
+  if (!IsTimerActive(timer_info, draw_data)) {
     return kInactiveColor;
   }
 
@@ -236,28 +235,30 @@ void ThreadTrack::UpdateMinMaxTimestamps() {
   max_time_ = std::max(max_time_.load(), capture_data_->GetCallstackData()->max_time());
 }
 
+void ThreadTrack::UpdateLayout() {
+  TimerTrack::UpdateLayout();
+  UpdatePositionOfSubtracks();
+
+  const float track_width = time_graph_->GetCanvas()->GetWorldWidth();
+  thread_state_bar_->SetSize(track_width, layout_->GetThreadStateTrackHeight());
+  event_bar_->SetSize(track_width, layout_->GetEventTrackHeight());
+  tracepoint_bar_->SetSize(track_width, layout_->GetEventTrackHeight());
+}
+
 void ThreadTrack::Draw(GlCanvas* canvas, PickingMode picking_mode, float z_offset) {
   TimerTrack::Draw(canvas, picking_mode, z_offset);
 
   UpdateMinMaxTimestamps();
-  UpdatePositionOfSubtracks();
-
-  const float thread_state_track_height = layout_->GetThreadStateTrackHeight();
-  const float event_track_height = layout_->GetEventTrackHeight();
-  const float tracepoint_track_height = layout_->GetEventTrackHeight();
 
   if (!thread_state_bar_->IsEmpty()) {
-    thread_state_bar_->SetSize(canvas->GetWorldWidth(), thread_state_track_height);
     thread_state_bar_->Draw(canvas, picking_mode, z_offset);
   }
 
   if (!event_bar_->IsEmpty()) {
-    event_bar_->SetSize(canvas->GetWorldWidth(), event_track_height);
     event_bar_->Draw(canvas, picking_mode, z_offset);
   }
 
   if (!tracepoint_bar_->IsEmpty()) {
-    tracepoint_bar_->SetSize(canvas->GetWorldWidth(), tracepoint_track_height);
     tracepoint_bar_->Draw(canvas, picking_mode, z_offset);
   }
 }
@@ -269,8 +270,6 @@ void ThreadTrack::OnPick(int x, int y) {
 
 void ThreadTrack::UpdatePrimitives(Batcher* batcher, uint64_t min_tick, uint64_t max_tick,
                                    PickingMode picking_mode, float z_offset) {
-  UpdatePositionOfSubtracks();
-
   if (!thread_state_bar_->IsEmpty()) {
     thread_state_bar_->UpdatePrimitives(batcher, min_tick, max_tick, picking_mode, z_offset);
   }
@@ -307,47 +306,41 @@ void ThreadTrack::SetTrackColor(Color color) {
   tracepoint_bar_->SetColor(color);
 }
 
-void ThreadTrack::SetTimesliceText(const TimerInfo& timer_info, double elapsed_us, float min_x,
-                                   float z_offset, TextBox* text_box) {
-  if (text_box->GetText().empty()) {
-    std::string time = GetPrettyTime(absl::Microseconds(elapsed_us));
-    text_box->SetElapsedTimeTextLength(time.length());
-
-    const FunctionInfo* func = app_->GetInstrumentedFunction(timer_info.function_id());
-    if (func) {
-      std::string extra_info = GetExtraInfo(timer_info);
-      std::string name;
-      if (func->orbit_type() == FunctionInfo::kOrbitTimerStart) {
-        auto api_event = ManualInstrumentationManager::ApiEventFromTimerInfo(timer_info);
-        name = api_event.name;
-      } else {
-        name = function_utils::GetDisplayName(*func);
-      }
-
-      std::string text = absl::StrFormat("%s %s %s", name, extra_info.c_str(), time.c_str());
-
-      text_box->SetText(text);
-    } else if (timer_info.type() == TimerInfo::kIntrospection) {
+std::string ThreadTrack::GetTimesliceText(const TimerInfo& timer_info,
+                                          const std::string& time) const {
+  const FunctionInfo* func = app_->GetInstrumentedFunction(timer_info.function_id());
+  if (func) {
+    std::string extra_info = GetExtraInfo(timer_info);
+    std::string name;
+    if (func->orbit_type() == FunctionInfo::kOrbitTimerStart) {
       auto api_event = ManualInstrumentationManager::ApiEventFromTimerInfo(timer_info);
-      std::string text = absl::StrFormat("%s %s", api_event.name, time.c_str());
-      text_box->SetText(text);
+      name = api_event.name;
     } else {
-      ERROR(
-          "Unexpected case in ThreadTrack::SetTimesliceText, function=\"%s\", "
-          "type=%d",
-          func->name(), static_cast<int>(timer_info.type()));
+      name = function_utils::GetDisplayName(*func);
     }
+
+    return absl::StrFormat("%s %s %s", name, extra_info.c_str(), time.c_str());
   }
+  if (timer_info.type() == TimerInfo::kIntrospection) {
+    auto api_event = ManualInstrumentationManager::ApiEventFromTimerInfo(timer_info);
+    return absl::StrFormat("%s %s", api_event.name, time.c_str());
+  }
+  ERROR("Unexpected case in ThreadTrack::GetTimesliceText, function_id=%u, type=%d",
+        timer_info.function_id(), static_cast<int>(timer_info.type()));
+  return "";
+}
+
+void ThreadTrack::SetTimesliceText(const TimerInfo& timer_info, double elapsed_us, float min_x,
+                                   float z_offset, const Vec2& box_pos, const Vec2& box_size) {
+  std::string time = GetPrettyTime(absl::Microseconds(elapsed_us));
+  std::string text = GetTimesliceText(timer_info, time);
 
   const Color kTextWhite(255, 255, 255, 255);
-  const Vec2& box_pos = text_box->GetPos();
-  const Vec2& box_size = text_box->GetSize();
   float pos_x = std::max(box_pos[0], min_x);
   float max_size = box_pos[0] + box_size[0] - pos_x;
-  text_renderer_->AddTextTrailingCharsPrioritized(
-      text_box->GetText().c_str(), pos_x, text_box->GetPos()[1] + layout_->GetTextOffset(),
-      GlCanvas::kZValueBox + z_offset, kTextWhite, text_box->GetElapsedTimeTextLength(),
-      layout_->CalculateZoomedFontSize(), max_size);
+  time_graph_->GetPrimitivesTextRenderer()->AddTextTrailingCharsPrioritized(
+      text.c_str(), pos_x, box_pos[1] + layout_->GetTextOffset(), GlCanvas::kZValueBox + z_offset,
+      kTextWhite, time.length(), layout_->CalculateZoomedFontSize(), max_size);
 }
 
 std::string ThreadTrack::GetTooltip() const {
@@ -45,19 +45,25 @@ class ThreadTrack final : public TimerTrack {
   void SetTrackColor(Color color);
   [[nodiscard]] bool IsEmpty() const override;
 
+  void UpdateLayout() override;
   void UpdatePrimitives(Batcher* batcher, uint64_t min_tick, uint64_t max_tick,
                         PickingMode picking_mode, float z_offset = 0) override;
 
   [[nodiscard]] std::vector<CaptureViewElement*> GetVisibleChildren() override;
 
  protected:
-  [[nodiscard]] bool IsTimerActive(const orbit_client_protos::TimerInfo& timer) const override;
+  [[nodiscard]] bool IsTimerActive(const orbit_client_protos::TimerInfo& timer,
+                                   const internal::DrawData& draw_data) const override;
   [[nodiscard]] bool IsTrackSelected() const override;
 
   [[nodiscard]] Color GetTimerColor(const orbit_client_protos::TimerInfo& timer, bool is_selected,
-                                    bool is_highlighted) const override;
+                                    bool is_highlighted,
+                                    const internal::DrawData& draw_data) const override;
+  // Returns the text of a timer, ending with its duration `time`.
+  [[nodiscard]] std::string GetTimesliceText(const orbit_client_protos::TimerInfo& timer,
+                                             const std::string& time) const;
   void SetTimesliceText(const orbit_client_protos::TimerInfo& timer, double elapsed_us, float min_x,
-                        float z_offset, TextBox* text_box) override;
+                        float z_offset, const Vec2& box_pos, const Vec2& box_size) override;
   [[nodiscard]] std::string GetBoxTooltip(const Batcher& batcher, PickingId id) const override;
 
   [[nodiscard]] float GetHeight() const override;
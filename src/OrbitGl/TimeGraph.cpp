@@ -44,12 +44,14 @@ TimeGraph::TimeGraph(OrbitApp* app, TextRenderer* text_renderer, GlCanvas* canva
     : text_renderer_{text_renderer},
       canvas_{canvas},
       accessibility_(this),
-      batcher_(BatcherId::kTimeGraph),
+      picking_frame_(canvas),
       capture_data_{capture_data},
-      app_{app} {
+      app_{app},
+      primitives_generator_("TimeGraphPrims", std::make_unique<PrimitivesFrame>(canvas),
+                            std::make_unique<PrimitivesFrame>(canvas)) {
   text_renderer_->SetCanvas(canvas);
-  text_renderer_static_.SetCanvas(canvas);
-  batcher_.SetPickingManager(&canvas->GetPickingManager());
+  drawn_frame_ = &primitives_generator_.GetFrontFrame();
+  updated_frame_ = drawn_frame_;
   track_manager_ = std::make_unique<TrackManager>(this, &GetLayout(), app, capture_data);
 
   async_timer_info_listener_ =
@@ -62,9 +64,15 @@ TimeGraph::TimeGraph(OrbitApp* app, TextRenderer* text_renderer, GlCanvas* canva
 }
 
 TimeGraph::~TimeGraph() {
+  primitives_generator_.Stop();
   manual_instrumentation_manager_->RemoveAsyncTimerListener(async_timer_info_listener_.get());
 }
 
+TimeGraph::PrimitivesFrame::PrimitivesFrame(GlCanvas* canvas) : batcher(BatcherId::kTimeGraph) {
+  batcher.SetPickingManager(&canvas->GetPickingManager());
+  text_renderer.SetCanvas(canvas);
+}
+
 double GNumHistorySeconds = 2.f;
 
 void TimeGraph::UpdateCaptureMinMaxTimestamps() {
@@ -153,9 +161,13 @@ void TimeGraph::VerticalZoom(float zoom_value, float mouse_relative_position) {
 
   canvas_->UpdateWorldTopLeftY(new_world_top_left_y);
 
-  // Finally, we have to scale every item in the layout.
-  const float old_scale = layout_.GetScale();
-  layout_.SetScale(old_scale / ratio);
+  // Finally, we have to scale every item in the layout, which the primitives are computed from.
+  primitives_generator_.RunExclusively(
+      [this, ratio](PrimitivesFrame* /*front_frame*/, PrimitivesFrame* /*back_frame*/) {
+        const float old_scale = layout_.GetScale();
+        layout_.SetScale(old_scale / ratio);
+      });
+  RequestUpdatePrimitives();
 }
 
 void TimeGraph::SetMinMax(double min_time_us, double max_time_us) {
@@ -427,24 +439,45 @@ std::vector<std::shared_ptr<TimerChain>> TimeGraph::GetAllSerializableTimerChain
   return chains;
 }
 
-float TimeGraph::GetWorldFromTick(uint64_t time) const {
-  if (time_window_us_ > 0) {
-    double start = TicksToMicroseconds(capture_min_timestamp_, time) - min_time_us_;
-    double normalized_start = start / time_window_us_;
-    auto pos = float(world_start_x_ + normalized_start * world_width_);
+float TimeGraphView::GetWorldFromTick(uint64_t time) const {
+  if (time_window_us > 0) {
+    double start = TicksToMicroseconds(capture_min_timestamp, time) - min_time_us;
+    double normalized_start = start / time_window_us;
+    auto pos = float(world_start_x + normalized_start * world_width);
     return pos;
   }
 
   return 0;
 }
 
+double TimeGraphView::GetUsFromTick(uint64_t time) const {
+  return TicksToMicroseconds(capture_min_timestamp, time) - min_time_us;
+}
+
+uint64_t TimeGraphView::GetTickFromUs(double micros) const {
+  auto nanos = static_cast<uint64_t>(1000 * micros);
+  return capture_min_timestamp + nanos;
+}
+
+TimeGraphView TimeGraph::GetView() const {
+  TimeGraphView view;
+  view.capture_min_timestamp = capture_min_timestamp_;
+  view.min_time_us = min_time_us_;
+  view.max_time_us = max_time_us_;
+  view.time_window_us = time_window_us_;
+  view.world_start_x = world_start_x_;
+  view.world_width = world_width_;
+  view.screen_width = canvas_ != nullptr ? canvas_->GetWidth() : 0;
+  return view;
+}
+
+float TimeGraph::GetWorldFromTick(uint64_t time) const { return GetView().GetWorldFromTick(time); }
+
 float TimeGraph::GetWorldFromUs(double micros) const {
   return GetWorldFromTick(GetTickFromUs(micros));
 }
 
-double TimeGraph::GetUsFromTick(uint64_t time) const {
-  return TicksToMicroseconds(capture_min_timestamp_, time) - min_time_us_;
-}
+double TimeGraph::GetUsFromTick(uint64_t time) const { return GetView().GetUsFromTick(time); }
 
 uint64_t TimeGraph::GetTickFromWorld(float world_x) const {
   double ratio =
@@ -453,10 +486,7 @@ uint64_t TimeGraph::GetTickFromWorld(float world_x) const {
   return capture_min_timestamp_ + time_span_ns;
 }
 
-uint64_t TimeGraph::GetTickFromUs(double micros) const {
-  auto nanos = static_cast<uint64_t>(1000 * micros);
-  return capture_min_timestamp_ + nanos;
-}
+uint64_t TimeGraph::GetTickFromUs(double micros) const { return GetView().GetTickFromUs(micros); }
 
 void TimeGraph::GetWorldMinMax(float& min, float& max) const {
   min = GetWorldFromTick(capture_min_timestamp_);
@@ -466,7 +496,7 @@ void TimeGraph::GetWorldMinMax(float& min, float& max) const {
 void TimeGraph::Select(const TextBox* text_box) {
   CHECK(text_box != nullptr);
   app_->SelectTextBox(text_box);
-  const TimerInfo& timer_info = text_box->GetTimerInfo();
+  const TimerInfo timer_info = text_box->GetTimerInfo();
   HorizontallyMoveIntoView(VisibilityType::kPartlyVisible, timer_info);
   VerticallyMoveIntoView(timer_info);
 }
@@ -478,13 +508,17 @@ const TextBox* TimeGraph::FindPreviousFunctionCall(uint64_t function_id, uint64_
   std::vector<std::shared_ptr<TimerChain>> chains = GetAllThreadTrackTimerChains();
   for (auto& chain : chains) {
     if (!chain) continue;
-    for (const auto& block : *chain) {
-      if (!block.Intersects(previous_box_time, current_time)) continue;
-      for (uint64_t i = 0; i < block.size(); i++) {
-        const TextBox& box = block[i];
-        auto box_time = box.GetTimerInfo().end();
-        if ((box.GetTimerInfo().function_id() == function_id) &&
-            (!thread_id || thread_id.value() == box.GetTimerInfo().thread_id()) &&
+    // Walk the blocks backwards, until no timer in the remaining blocks can end after the best
+    // candidate found so far.
+    for (const TimerBlock* block = chain->FindLastBlockStartingBefore(current_time);
+         block != nullptr && block->GetMaxEndSoFar() > previous_box_time;
+         block = block->GetPrevious()) {
+      if (!block->Intersects(previous_box_time, current_time)) continue;
+      for (uint64_t i = 0; i < block->size(); i++) {
+        const TextBox& box = (*block)[i];
+        auto box_time = box.End();
+        if ((box.GetFunctionId() == function_id) &&
+            (!thread_id || thread_id.value() == box.GetThreadId()) &&
             (box_time < current_time) && (previous_box_time < box_time)) {
           previous_box = &box;
           previous_box_time = box_time;
@@ -502,13 +536,19 @@ const TextBox* TimeGraph::FindNextFunctionCall(uint64_t function_id, uint64_t cu
   std::vector<std::shared_ptr<TimerChain>> chains = GetAllThreadTrackTimerChains();
   for (auto& chain : chains) {
     if (!chain) continue;
-    for (const auto& block : *chain) {
+    // All the timers in the blocks before the one we start from end at or before current_time.
+    for (TimerChainIterator it = chain->FindFirstBlockEndingAtOrAfter(current_time + 1);
+         it != chain->end(); ++it) {
+      const TimerBlock& block = *it;
+      // If the timers are sorted by start, no timer in the following blocks ends earlier than the
+      // best candidate found so far.
+      if (chain->IsSortedByStart() && block.size() > 0 && block[0].Start() > next_box_time) break;
       if (!block.Intersects(current_time, next_box_time)) continue;
       for (uint64_t i = 0; i < block.size(); i++) {
         const TextBox& box = block[i];
-        auto box_time = box.GetTimerInfo().end();
-        if ((box.GetTimerInfo().function_id() == function_id) &&
-            (!thread_id || thread_id.value() == box.GetTimerInfo().thread_id()) &&
+        auto box_time = box.End();
+        if ((box.GetFunctionId() == function_id) &&
+            (!thread_id || thread_id.value() == box.GetThreadId()) &&
             (box_time > current_time) && (next_box_time > box_time)) {
           next_box = &box;
           next_box_time = box_time;
@@ -524,31 +564,36 @@ void TimeGraph::RequestUpdatePrimitives() {
   RequestRedraw();
 }
 
-// UpdatePrimitives updates all the drawable track timers in the timegraph's batcher
-void TimeGraph::UpdatePrimitives(PickingMode picking_mode) {
+// UpdatePrimitives updates all the drawable track timers in the batcher of `frame`, returning early
+// if `is_canceled` returns true.
+void TimeGraph::UpdatePrimitives(
+    PrimitivesFrame* frame, PickingMode picking_mode, const TimeGraphView& view,
+    const TrackManager::TracksAndZOffsets& tracks_and_z_offsets,
+    const BackgroundFrameGenerator<PrimitivesFrame>::IsCanceledFunction& is_canceled) {
   ORBIT_SCOPE_FUNCTION;
   CHECK(app_->GetStringManager() != nullptr);
 
-  batcher_.StartNewFrame();
-  text_renderer_static_.Clear();
+  updated_frame_ = frame;
+  frame->view = view;
+  frame->batcher.StartNewFrame();
+  frame->text_renderer.Clear();
 
-  if (capture_data_) {
-    capture_min_timestamp_ =
-        std::min(capture_min_timestamp_, capture_data_->GetCallstackData()->min_time());
-    capture_max_timestamp_ =
-        std::max(capture_max_timestamp_, capture_data_->GetCallstackData()->max_time());
-  }
-
-  time_window_us_ = max_time_us_ - min_time_us_;
-  world_start_x_ = canvas_->GetWorldTopLeftX();
-  world_width_ = canvas_->GetWorldWidth();
-  uint64_t min_tick = GetTickFromUs(min_time_us_);
-  uint64_t max_tick = GetTickFromUs(max_time_us_);
-
-  track_manager_->SortTracks();
-  track_manager_->UpdateMovingTrackSorting();
-  track_manager_->UpdateTracks(&batcher_, min_tick, max_tick, picking_mode);
+  track_manager_->UpdateTrackPrimitives(&frame->batcher, tracks_and_z_offsets, view.GetMinTick(),
+                                        view.GetMaxTick(), picking_mode, is_canceled);
+}
 
+void TimeGraph::RequestPrimitivesFrameIfIdle() {
+  if (!primitives_generator_.IsIdle()) {
+    // The frame in progress is outdated. Once it returns, IsRedrawNeeded returns true.
+    primitives_generator_.CancelGeneration();
+    return;
+  }
+  primitives_generator_.RequestFrame(
+      [this, view = GetView(), tracks_and_z_offsets = track_manager_->LayOutTracks()](
+          PrimitivesFrame* frame,
+          const BackgroundFrameGenerator<PrimitivesFrame>::IsCanceledFunction& is_canceled) {
+        UpdatePrimitives(frame, PickingMode::kNone, view, tracks_and_z_offsets, is_canceled);
+      });
   update_primitives_requested_ = false;
 }
 
@@ -567,28 +612,61 @@ void TimeGraph::SelectCallstacks(float world_start, float world_end, int32_t thr
           : capture_data_->GetCallstackData()->GetCallstackEventsOfTidInTimeRange(thread_id, t0,
                                                                                   t1);
 
-  selected_callstack_events_per_thread_.clear();
-  for (CallstackEvent& event : selected_callstack_events) {
-    selected_callstack_events_per_thread_[event.thread_id()].emplace_back(event);
-    selected_callstack_events_per_thread_[orbit_base::kAllProcessThreadsTid].emplace_back(event);
-  }
+  // The selected callstack events are drawn by the tracks while their primitives are updated.
+  primitives_generator_.RunExclusively([this, &selected_callstack_events](
+                                           PrimitivesFrame* /*front_frame*/,
+                                           PrimitivesFrame* /*back_frame*/) {
+    selected_callstack_events_per_thread_.clear();
+    for (CallstackEvent& event : selected_callstack_events) {
+      selected_callstack_events_per_thread_[event.thread_id()].emplace_back(event);
+      selected_callstack_events_per_thread_[orbit_base::kAllProcessThreadsTid].emplace_back(event);
+    }
+  });
 
   app_->SelectCallstackEvents(selected_callstack_events, thread_id);
 
   RequestUpdatePrimitives();
 }
 
-const std::vector<CallstackEvent>& TimeGraph::GetSelectedCallstackEvents(int32_t tid) {
-  return selected_callstack_events_per_thread_[tid];
+const std::vector<CallstackEvent>& TimeGraph::GetSelectedCallstackEvents(int32_t tid) const {
+  static const std::vector<CallstackEvent> kNoEvents;
+  auto it = selected_callstack_events_per_thread_.find(tid);
+  return it != selected_callstack_events_per_thread_.end() ? it->second : kNoEvents;
 }
 
 void TimeGraph::Draw(GlCanvas* canvas, PickingMode picking_mode) {
   ORBIT_SCOPE("TimeGraph::Draw");
   current_mouse_time_ns_ = GetTickFromWorld(canvas_->GetMouseX());
 
+  if (!primitives_frames_initialized_) {
+    // Initializing a text renderer requires the OpenGL context of this thread.
+    primitives_generator_.RunExclusively([](PrimitivesFrame* front_frame,
+                                            PrimitivesFrame* back_frame) {
+      front_frame->text_renderer.Init();
+      back_frame->text_renderer.Init();
+    });
+    picking_frame_.text_renderer.Init();
+    primitives_frames_initialized_ = true;
+  }
+
   const bool picking = picking_mode != PickingMode::kNone;
-  if ((!picking && update_primitives_requested_) || picking) {
-    UpdatePrimitives(picking_mode);
+  if (picking || update_primitives_requested_) {
+    UpdateTimeWindow();
+  }
+
+  if (picking) {
+    primitives_generator_.RunExclusively(
+        [this, picking_mode](PrimitivesFrame* /*front_frame*/, PrimitivesFrame* /*back_frame*/) {
+          UpdatePrimitives(&picking_frame_, picking_mode, GetView(),
+                           track_manager_->LayOutTracks());
+        });
+    drawn_frame_ = &picking_frame_;
+  } else {
+    primitives_generator_.SwapFramesIfReady();
+    if (update_primitives_requested_) {
+      RequestPrimitivesFrameIfIdle();
+    }
+    drawn_frame_ = &primitives_generator_.GetFrontFrame();
   }
 
   DrawTracks(canvas, picking_mode);
@@ -597,6 +675,30 @@ void TimeGraph::Draw(GlCanvas* canvas, PickingMode picking_mode) {
   redraw_requested_ = false;
 }
 
+void TimeGraph::UpdateTimeWindow() {
+  if (capture_data_) {
+    capture_min_timestamp_ =
+        std::min(capture_min_timestamp_, capture_data_->GetCallstackData()->min_time());
+    capture_max_timestamp_ =
+        std::max(capture_max_timestamp_, capture_data_->GetCallstackData()->max_time());
+  }
+
+  time_window_us_ = max_time_us_ - min_time_us_;
+  world_start_x_ = canvas_->GetWorldTopLeftX();
+  world_width_ = canvas_->GetWorldWidth();
+}
+
+void TimeGraph::UpdatePrimitivesSynchronously() {
+  UpdateTimeWindow();
+  primitives_generator_.RunExclusively(
+      [this](PrimitivesFrame* front_frame, PrimitivesFrame* /*back_frame*/) {
+        UpdatePrimitives(front_frame, PickingMode::kNone, GetView(),
+                         track_manager_->LayOutTracks());
+      });
+  drawn_frame_ = &primitives_generator_.GetFrontFrame();
+  update_primitives_requested_ = false;
+}
+
 namespace {
 
 [[nodiscard]] std::string GetLabelBetweenIterators(const FunctionInfo& function_a,
@@ -663,7 +765,7 @@ void TimeGraph::DrawOverlay(GlCanvas* canvas, PickingMode picking_mode) {
   std::sort(boxes.begin(), boxes.end(),
             [](const std::pair<uint64_t, const TextBox*>& box_a,
                const std::pair<uint64_t, const TextBox*>& box_b) -> bool {
-              return box_a.second->GetTimerInfo().start() < box_b.second->GetTimerInfo().start();
+              return box_a.second->Start() < box_b.second->Start();
             });
 
   // We will need the world x coordinates for the timers multiple times, so
@@ -681,9 +783,7 @@ void TimeGraph::DrawOverlay(GlCanvas* canvas, PickingMode picking_mode) {
 
   // Draw lines for iterators.
   for (const auto& box : boxes) {
-    const TimerInfo& timer_info = box.second->GetTimerInfo();
-
-    double start_us = GetUsFromTick(timer_info.start());
+    double start_us = GetUsFromTick(box.second->Start());
     double normalized_start = start_us * inv_time_window;
     auto world_timer_x = static_cast<float>(world_start_x + normalized_start * world_width);
 
@@ -691,7 +791,7 @@ void TimeGraph::DrawOverlay(GlCanvas* canvas, PickingMode picking_mode) {
     x_coords.push_back(pos[0]);
 
     canvas->GetBatcher()->AddVerticalLine(pos, -world_height, GlCanvas::kZValueOverlay,
-                                          GetThreadColor(timer_info.thread_id()));
+                                          GetThreadColor(box.second->GetThreadId()));
   }
 
   // Draw boxes with timings between iterators.
@@ -786,9 +886,9 @@ void TimeGraph::JumpToNeighborBox(const TextBox* from, JumpDirection jump_direct
   if (!from) {
     return;
   }
-  auto function_id = from->GetTimerInfo().function_id();
-  auto current_time = from->GetTimerInfo().end();
-  auto thread_id = from->GetTimerInfo().thread_id();
+  auto function_id = from->GetFunctionId();
+  auto current_time = from->End();
+  auto thread_id = from->GetThreadId();
   if (jump_direction == JumpDirection::kPrevious) {
     switch (jump_scope) {
       case JumpScope::kSameDepth:
@@ -844,7 +944,7 @@ void TimeGraph::UpdateRightMargin(float margin) {
 
 const TextBox* TimeGraph::FindPrevious(const TextBox* from) {
   CHECK(from);
-  const TimerInfo& timer_info = from->GetTimerInfo();
+  const TimerInfo timer_info = from->GetTimerInfo();
   if (timer_info.type() == TimerInfo::kGpuActivity) {
     return track_manager_->GetOrCreateGpuTrack(timer_info.timeline_hash())->GetLeft(from);
   }
@@ -853,7 +953,7 @@ const TextBox* TimeGraph::FindPrevious(const TextBox* from) {
 
 const TextBox* TimeGraph::FindNext(const TextBox* from) {
   CHECK(from);
-  const TimerInfo& timer_info = from->GetTimerInfo();
+  const TimerInfo timer_info = from->GetTimerInfo();
   if (timer_info.type() == TimerInfo::kGpuActivity) {
     return track_manager_->GetOrCreateGpuTrack(timer_info.timeline_hash())->GetRight(from);
   }
@@ -862,7 +962,7 @@ const TextBox* TimeGraph::FindNext(const TextBox* from) {
 
 const TextBox* TimeGraph::FindTop(const TextBox* from) {
   CHECK(from);
-  const TimerInfo& timer_info = from->GetTimerInfo();
+  const TimerInfo timer_info = from->GetTimerInfo();
   if (timer_info.type() == TimerInfo::kGpuActivity) {
     return track_manager_->GetOrCreateGpuTrack(timer_info.timeline_hash())->GetUp(from);
   }
@@ -871,7 +971,7 @@ const TextBox* TimeGraph::FindTop(const TextBox* from) {
 
 const TextBox* TimeGraph::FindDown(const TextBox* from) {
   CHECK(from);
-  const TimerInfo& timer_info = from->GetTimerInfo();
+  const TimerInfo timer_info = from->GetTimerInfo();
   if (timer_info.type() == TimerInfo::kGpuActivity) {
     return track_manager_->GetOrCreateGpuTrack(timer_info.timeline_hash())->GetDown(from);
   }
@@ -880,7 +980,7 @@ const TextBox* TimeGraph::FindDown(const TextBox* from) {
 
 void TimeGraph::DrawText(GlCanvas* canvas, float layer) {
   if (draw_text_) {
-    text_renderer_static_.RenderLayer(canvas->GetBatcher(), layer);
+    drawn_frame_->text_renderer.RenderLayer(canvas->GetBatcher(), layer);
   }
 }
 
@@ -16,6 +16,7 @@
 #include <vector>
 
 #include "AccessibleTimeGraph.h"
+#include "BackgroundFrameGenerator.h"
 #include "Batcher.h"
 #include "CallstackThreadBar.h"
 #include "CoreMath.h"
@@ -34,6 +35,25 @@
 
 class OrbitApp;
 
+// The time range and the world extents the primitives of the tracks are computed for. A copy is
+// taken when a frame is requested, as zooming, panning and resizing keep changing them on the UI
+// thread while the primitives are computed on other threads.
+struct TimeGraphView {
+  [[nodiscard]] uint64_t GetMinTick() const { return GetTickFromUs(min_time_us); }
+  [[nodiscard]] uint64_t GetMaxTick() const { return GetTickFromUs(max_time_us); }
+  [[nodiscard]] float GetWorldFromTick(uint64_t time) const;
+  [[nodiscard]] double GetUsFromTick(uint64_t time) const;
+  [[nodiscard]] uint64_t GetTickFromUs(double micros) const;
+
+  uint64_t capture_min_timestamp = 0;
+  double min_time_us = 0;
+  double max_time_us = 0;
+  double time_window_us = 0;
+  float world_start_x = 0;
+  float world_width = 0;
+  int screen_width = 0;
+};
+
 class TimeGraph {
  public:
   explicit TimeGraph(OrbitApp* app, TextRenderer* text_renderer, GlCanvas* canvas,
@@ -46,9 +66,13 @@ class TimeGraph {
   void DrawText(GlCanvas* canvas, float layer);
 
   void RequestUpdatePrimitives();
-  void UpdatePrimitives(PickingMode picking_mode);
+  // Updates the primitives of the current view on the calling thread into the frame that is drawn
+  // next, instead of on the background thread, without drawing them. This doesn't require an
+  // OpenGL context, e.g., to measure the update of the primitives offscreen.
+  void UpdatePrimitivesSynchronously();
   void SelectCallstacks(float world_start, float world_end, int32_t thread_id);
-  const std::vector<orbit_client_protos::CallstackEvent>& GetSelectedCallstackEvents(int32_t tid);
+  [[nodiscard]] const std::vector<orbit_client_protos::CallstackEvent>& GetSelectedCallstackEvents(
+      int32_t tid) const;
 
   void ProcessTimer(const orbit_client_protos::TimerInfo& timer_info,
                     const orbit_client_protos::FunctionInfo* function);
@@ -64,6 +88,7 @@ class TimeGraph {
   [[nodiscard]] uint64_t GetTickFromUs(double micros) const;
   [[nodiscard]] double GetUsFromTick(uint64_t time) const;
   [[nodiscard]] double GetTimeWindowUs() const { return time_window_us_; }
+  [[nodiscard]] TimeGraphView GetView() const;
   void GetWorldMinMax(float& min, float& max) const;
   void UpdateCaptureMinMaxTimestamps();
 
@@ -101,7 +126,10 @@ class TimeGraph {
   [[nodiscard]] double GetCaptureTimeSpanUs() const;
   [[nodiscard]] double GetCurrentTimeSpanUs() const;
   void RequestRedraw();
-  [[nodiscard]] bool IsRedrawNeeded() const { return redraw_requested_; }
+  [[nodiscard]] bool IsRedrawNeeded() const {
+    return redraw_requested_ || primitives_generator_.IsFrameReady() ||
+           (update_primitives_requested_ && primitives_generator_.IsIdle());
+  }
   void SetThreadFilter(const std::string& filter);
 
   [[nodiscard]] bool IsFullyVisible(uint64_t min, uint64_t max) const;
@@ -109,9 +137,16 @@ class TimeGraph {
   [[nodiscard]] bool IsVisible(VisibilityType vis_type, uint64_t min, uint64_t max) const;
 
   [[nodiscard]] int GetNumDrawnTextBoxes() { return num_drawn_text_boxes_; }
-  [[nodiscard]] TextRenderer* GetTextRenderer() { return &text_renderer_static_; }
+  // The text renderer and the batcher of the primitives that were drawn last.
+  [[nodiscard]] TextRenderer* GetTextRenderer() { return &drawn_frame_->text_renderer; }
+  [[nodiscard]] Batcher& GetBatcher() { return drawn_frame_->batcher; }
+  // The text renderer the tracks add their text to while their primitives are updated.
+  [[nodiscard]] TextRenderer* GetPrimitivesTextRenderer() {
+    return &updated_frame_->text_renderer;
+  }
+  // The view the tracks compute their primitives for while their primitives are updated.
+  [[nodiscard]] const TimeGraphView& GetPrimitivesView() const { return updated_frame_->view; }
   [[nodiscard]] GlCanvas* GetCanvas() { return canvas_; }
-  [[nodiscard]] Batcher& GetBatcher() { return batcher_; }
   [[nodiscard]] uint32_t GetNumTimers() const;
   [[nodiscard]] std::vector<std::shared_ptr<TimerChain>> GetAllTimerChains() const;
   [[nodiscard]] std::vector<std::shared_ptr<TimerChain>> GetAllThreadTrackTimerChains() const;
@@ -180,7 +215,29 @@ class TimeGraph {
                          const orbit_client_protos::TimerInfo& timer_info);
 
  private:
-  TextRenderer text_renderer_static_;
+  // The primitives of the tracks for one view of the time graph.
+  struct PrimitivesFrame {
+    explicit PrimitivesFrame(GlCanvas* canvas);
+
+    Batcher batcher;
+    TextRenderer text_renderer;
+    TimeGraphView view;
+  };
+
+  // Updates the time range and the world extents the primitives are computed for.
+  void UpdateTimeWindow();
+  // Lays out the tracks and requests their primitives for the current view, if no frame is
+  // generated. Otherwise, the generation in progress is canceled, and this has to be called again
+  // once the generator is idle.
+  void RequestPrimitivesFrameIfIdle();
+  // Updates the primitives of `tracks_and_z_offsets`, which have been laid out on the UI thread,
+  // for `view`. Runs on the background thread, or on the UI thread while the background thread is
+  // paused.
+  void UpdatePrimitives(PrimitivesFrame* frame, PickingMode picking_mode, const TimeGraphView& view,
+                        const TrackManager::TracksAndZOffsets& tracks_and_z_offsets,
+                        const BackgroundFrameGenerator<PrimitivesFrame>::IsCanceledFunction&
+                            is_canceled = [] { return false; });
+
   TextRenderer* text_renderer_ = nullptr;
   GlCanvas* canvas_ = nullptr;
   int num_drawn_text_boxes_ = 0;
@@ -216,7 +273,16 @@ class TimeGraph {
 
   bool draw_text_ = true;
 
-  Batcher batcher_;
+  // The primitives are updated on a background thread, while the last complete frame is drawn.
+  // The tracks are laid out on the drawing thread while no primitives are updated, and each request
+  // carries a copy of the view and of the laid out tracks. Picking needs the primitives of the
+  // current view, so for picking they are updated on the drawing thread into picking_frame_. Other
+  // changes to what the tracks read while updating their primitives, e.g., the selected callstacks,
+  // go through primitives_generator_.RunExclusively.
+  PrimitivesFrame picking_frame_;
+  PrimitivesFrame* drawn_frame_ = nullptr;
+  PrimitivesFrame* updated_frame_ = nullptr;
+  bool primitives_frames_initialized_ = false;
 
   // TODO(b/174655559): Use absl's mutex here.
   mutable std::recursive_mutex mutex_;
@@ -231,6 +297,9 @@ class TimeGraph {
   const CaptureData* capture_data_ = nullptr;
 
   OrbitApp* app_ = nullptr;
+
+  // Declared last, as its thread accesses the other members.
+  BackgroundFrameGenerator<PrimitivesFrame> primitives_generator_;
 };
 
 #endif  // ORBIT_GL_TIME_GRAPH_H_
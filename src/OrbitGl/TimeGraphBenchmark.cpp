@@ -0,0 +1,316 @@
+// Copyright (c) 2021 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <absl/container/flat_hash_map.h>
+#include <absl/container/flat_hash_set.h>
+#include <absl/strings/str_format.h>
+#include <benchmark/benchmark.h>
+
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "App.h"
+#include "Batcher.h"
+#include "CaptureWindow.h"
+#include "CodeReport.h"
+#include "MainWindowInterface.h"
+#include "OrbitBase/ExecutablePath.h"
+#include "OrbitClientData/Callstack.h"
+#include "OrbitClientData/ModuleManager.h"
+#include "OrbitClientData/ProcessData.h"
+#include "OrbitClientModel/CaptureData.h"
+#include "TextRenderer.h"
+#include "ThreadTrack.h"
+#include "TimeGraph.h"
+#include "TrackManager.h"
+#include "capture_data.pb.h"
+#include "process.pb.h"
+
+// These benchmarks measure updating the primitives of the time graph of a synthetic capture while
+// zooming and panning, and preparing them for drawing, without an OpenGL context: the primitives
+// and the text are laid out on the CPU, only the OpenGL calls that draw them are left out. Text
+// requires the fonts next to the executable, as for the client.
+
+using orbit_client_protos::CallstackEvent;
+using orbit_client_protos::FunctionInfo;
+using orbit_client_protos::ThreadStateSliceInfo;
+using orbit_client_protos::TimerInfo;
+
+namespace {
+
+constexpr int32_t kPid = 42;
+constexpr uint64_t kCaptureDurationNs = 10'000'000'000;
+constexpr int kScreenWidth = 1920;
+constexpr int kScreenHeight = 1080;
+constexpr int8_t kNumCores = 16;
+
+// Each thread runs for kRunningNs out of every kSchedulingPeriodNs, during which it is sampled
+// every kSamplingPeriodNs.
+constexpr uint64_t kSchedulingPeriodNs = 10'000'000;
+constexpr uint64_t kRunningNs = 4'000'000;
+constexpr uint64_t kSamplingPeriodNs = 2'000'000;
+
+// The first threads also call instrumented functions: every kTopLevelTimerPeriodNs, a timer with
+// two nested timers at each depth below, down to kNumTimerDepths.
+constexpr int kNumThreadsWithTimers = 4;
+constexpr uint64_t kTopLevelTimerPeriodNs = 2'000'000;
+constexpr uint32_t kNumTimerDepths = 3;
+constexpr uint64_t kNumFunctions = 16;
+
+constexpr uint64_t kCallstackId = 1;
+
+class NoOpMainWindow : public orbit_gl::MainWindowInterface {
+ public:
+  void ShowTooltip(std::string_view /*message*/) override {}
+  void ShowSourceCode(const std::filesystem::path& /*file_path*/, size_t /*line_number*/,
+                      std::optional<std::unique_ptr<CodeReport>> /*code_report*/) override {}
+};
+
+[[nodiscard]] bool AreFontsAvailable() {
+  return std::filesystem::exists(orbit_base::GetExecutableDir() / "fonts" / "Vera.ttf");
+}
+
+[[nodiscard]] int32_t GetTid(int thread_index) { return kPid + 1 + thread_index; }
+
+// A capture of `num_threads` threads of process kPid, shown in the time graph of a CaptureWindow
+// the size of a full HD screen, which is never rendered.
+class SyntheticCapture {
+ public:
+  explicit SyntheticCapture(int num_threads);
+
+  [[nodiscard]] TimeGraph* time_graph() { return capture_window_->GetTimeGraph(); }
+
+  // Adds the time spent updating the primitives of the current view and preparing them for drawing
+  // to `update_seconds` and `draw_preparation_seconds`.
+  void UpdateFrame(double* update_seconds, double* draw_preparation_seconds);
+
+ private:
+  void AddTimersOfThread(int32_t tid, uint64_t start_ns, uint64_t duration_ns, uint32_t depth,
+                         uint64_t* function_id);
+
+  orbit_client_data::ModuleManager module_manager_;
+  NoOpMainWindow main_window_;
+  std::unique_ptr<OrbitApp> app_;
+  std::unique_ptr<CaptureWindow> capture_window_;
+  absl::flat_hash_map<uint64_t, FunctionInfo> functions_;
+};
+
+SyntheticCapture::SyntheticCapture(int num_threads)
+    : app_{std::make_unique<OrbitApp>(&main_window_, /*main_thread_executor=*/nullptr,
+                                      /*crash_handler=*/nullptr)},
+      capture_window_{std::make_unique<CaptureWindow>(app_.get())} {
+  absl::flat_hash_set<uint64_t> function_ids;
+  for (uint64_t function_id = 1; function_id <= kNumFunctions; ++function_id) {
+    FunctionInfo function;
+    function.set_name(absl::StrFormat("Function%u", function_id));
+    function.set_pretty_name(absl::StrFormat("synthetic::Function%u(int, float)", function_id));
+    function.set_loaded_module_path("/path/to/synthetic_module");
+    functions_.emplace(function_id, function);
+    function_ids.insert(function_id);
+  }
+
+  orbit_grpc_protos::ProcessInfo process_info;
+  process_info.set_pid(kPid);
+  process_info.set_name("synthetic_process");
+  app_->SetCaptureData(
+      CaptureData{ProcessData{process_info}, &module_manager_, functions_, {}, {}});
+  app_->SetVisibleFunctionIds(std::move(function_ids));
+  CaptureData& capture_data = app_->GetMutableCaptureData();
+  capture_data.AddUniqueCallStack(CallStack{kCallstackId, {0x1000, 0x2000, 0x3000}});
+  for (int thread_index = 0; thread_index < num_threads; ++thread_index) {
+    capture_data.AddOrAssignThreadName(GetTid(thread_index),
+                                       absl::StrFormat("worker-%d", thread_index));
+  }
+
+  capture_window_->CreateTimeGraph(&capture_data);
+  capture_window_->Resize(kScreenWidth, kScreenHeight);
+  TimeGraph* time_graph = capture_window_->GetTimeGraph();
+
+  for (int thread_index = 0; thread_index < num_threads; ++thread_index) {
+    const int32_t tid = GetTid(thread_index);
+    // Offset the threads, so that they don't all run and get sampled at the same time.
+    const uint64_t offset_ns = static_cast<uint64_t>(thread_index) * 37'000 % kSchedulingPeriodNs;
+    for (uint64_t period_start_ns = offset_ns;
+         period_start_ns + kSchedulingPeriodNs <= kCaptureDurationNs;
+         period_start_ns += kSchedulingPeriodNs) {
+      const uint64_t running_end_ns = period_start_ns + kRunningNs;
+      TimerInfo scheduling_slice;
+      scheduling_slice.set_start(period_start_ns);
+      scheduling_slice.set_end(running_end_ns);
+      scheduling_slice.set_process_id(kPid);
+      scheduling_slice.set_thread_id(tid);
+      scheduling_slice.set_processor(thread_index % kNumCores);
+      scheduling_slice.set_depth(scheduling_slice.processor());
+      scheduling_slice.set_type(TimerInfo::kCoreActivity);
+      time_graph->ProcessTimer(scheduling_slice, nullptr);
+
+      ThreadStateSliceInfo running_slice;
+      running_slice.set_tid(tid);
+      running_slice.set_thread_state(ThreadStateSliceInfo::kRunning);
+      running_slice.set_begin_timestamp_ns(period_start_ns);
+      running_slice.set_end_timestamp_ns(running_end_ns);
+      capture_data.AddThreadStateSlice(running_slice);
+      ThreadStateSliceInfo sleeping_slice;
+      sleeping_slice.set_tid(tid);
+      sleeping_slice.set_thread_state(ThreadStateSliceInfo::kInterruptibleSleep);
+      sleeping_slice.set_begin_timestamp_ns(running_end_ns);
+      sleeping_slice.set_end_timestamp_ns(period_start_ns + kSchedulingPeriodNs);
+      capture_data.AddThreadStateSlice(sleeping_slice);
+
+      for (uint64_t sample_ns = period_start_ns; sample_ns < running_end_ns;
+           sample_ns += kSamplingPeriodNs) {
+        CallstackEvent event;
+        event.set_time(sample_ns);
+        event.set_callstack_id(kCallstackId);
+        event.set_thread_id(tid);
+        capture_data.AddCallstackEvent(event);
+      }
+    }
+  }
+
+  for (int thread_index = 0; thread_index < std::min(num_threads, kNumThreadsWithTimers);
+       ++thread_index) {
+    uint64_t function_id = 0;
+    for (uint64_t start_ns = 0; start_ns + kTopLevelTimerPeriodNs <= kCaptureDurationNs;
+         start_ns += kTopLevelTimerPeriodNs) {
+      AddTimersOfThread(GetTid(thread_index), start_ns, kTopLevelTimerPeriodNs * 3 / 4, 0,
+                        &function_id);
+    }
+  }
+
+  time_graph->UpdateCaptureMinMaxTimestamps();
+  time_graph->SetMinMax(0, time_graph->GetCaptureTimeSpanUs());
+}
+
+void SyntheticCapture::AddTimersOfThread(int32_t tid, uint64_t start_ns, uint64_t duration_ns,
+                                         uint32_t depth, uint64_t* function_id) {
+  *function_id = *function_id % kNumFunctions + 1;
+  TimerInfo timer;
+  timer.set_start(start_ns);
+  timer.set_end(start_ns + duration_ns);
+  timer.set_process_id(kPid);
+  timer.set_thread_id(tid);
+  timer.set_depth(depth);
+  timer.set_function_id(*function_id);
+  timer.set_type(TimerInfo::kNone);
+  time_graph()->ProcessTimer(timer, &functions_.at(*function_id));
+
+  if (depth + 1 == kNumTimerDepths) return;
+  const uint64_t child_duration_ns = duration_ns * 2 / 5;
+  AddTimersOfThread(tid, start_ns, child_duration_ns, depth + 1, function_id);
+  AddTimersOfThread(tid, start_ns + duration_ns / 2, child_duration_ns, depth + 1, function_id);
+}
+
+void SyntheticCapture::UpdateFrame(double* update_seconds, double* draw_preparation_seconds) {
+  using Clock = std::chrono::steady_clock;
+  const Clock::time_point start = Clock::now();
+  time_graph()->UpdatePrimitivesSynchronously();
+  const Clock::time_point updated = Clock::now();
+  // Sorting the primitives by layer is what drawing them does before the OpenGL calls.
+  benchmark::DoNotOptimize(time_graph()->GetBatcher().GetLayers());
+  benchmark::DoNotOptimize(time_graph()->GetTextRenderer()->GetLayers());
+  const Clock::time_point prepared = Clock::now();
+  *update_seconds += std::chrono::duration<double>(updated - start).count();
+  *draw_preparation_seconds += std::chrono::duration<double>(prepared - updated).count();
+}
+
+void SetFrameCounters(benchmark::State& state, double update_seconds,
+                      double draw_preparation_seconds) {
+  state.counters["update_ms"] =
+      benchmark::Counter(update_seconds * 1000.0, benchmark::Counter::kAvgIterations);
+  state.counters["draw_preparation_ms"] =
+      benchmark::Counter(draw_preparation_seconds * 1000.0, benchmark::Counter::kAvgIterations);
+}
+
+// Zooms in towards the middle of the view by 40 steps of the mouse wheel, then out again, updating
+// the primitives after each step.
+void BM_ZoomTimeGraph(benchmark::State& state) {
+  if (!AreFontsAvailable()) {
+    state.SkipWithError("The fonts are not next to the executable.");
+    return;
+  }
+  SyntheticCapture capture(static_cast<int>(state.range(0)));
+  constexpr int kNumZoomSteps = 40;
+  int step = 0;
+  double update_seconds = 0.0;
+  double draw_preparation_seconds = 0.0;
+  for (auto _ : state) {
+    const float zoom_value = step < kNumZoomSteps ? -1.f : 1.f;
+    capture.time_graph()->ZoomTime(zoom_value, 0.5);
+    step = (step + 1) % (2 * kNumZoomSteps);
+    capture.UpdateFrame(&update_seconds, &draw_preparation_seconds);
+  }
+  SetFrameCounters(state, update_seconds, draw_preparation_seconds);
+}
+
+// Pans a view of 1% of the capture by a tenth of the screen per step, back and forth across the
+// whole capture, updating the primitives after each step.
+void BM_PanTimeGraph(benchmark::State& state) {
+  if (!AreFontsAvailable()) {
+    state.SkipWithError("The fonts are not next to the executable.");
+    return;
+  }
+  SyntheticCapture capture(static_cast<int>(state.range(0)));
+  TimeGraph* time_graph = capture.time_graph();
+  time_graph->SetMinMax(0, time_graph->GetCaptureTimeSpanUs() / 100);
+  constexpr int kPanStepPixels = kScreenWidth / 10;
+  int direction = -1;
+  double update_seconds = 0.0;
+  double draw_preparation_seconds = 0.0;
+  for (auto _ : state) {
+    if (time_graph->GetMinTimeUs() <= 0.0) {
+      direction = -1;
+    } else if (time_graph->GetMaxTimeUs() >= time_graph->GetCaptureTimeSpanUs()) {
+      direction = 1;
+    }
+    time_graph->PanTime(0, direction * kPanStepPixels, kScreenWidth, time_graph->GetMinTimeUs());
+    capture.UpdateFrame(&update_seconds, &draw_preparation_seconds);
+  }
+  SetFrameCounters(state, update_seconds, draw_preparation_seconds);
+}
+
+// Updates the primitives of one thread track with timers, with 1 / state.range(0) of the capture
+// visible. Only the timers are updated, not the bars of the thread.
+void BM_UpdateTimerTrackPrimitives(benchmark::State& state) {
+  if (!AreFontsAvailable()) {
+    state.SkipWithError("The fonts are not next to the executable.");
+    return;
+  }
+  SyntheticCapture capture(1);
+  TimeGraph* time_graph = capture.time_graph();
+  const double visible_time_us =
+      time_graph->GetCaptureTimeSpanUs() / static_cast<double>(state.range(0));
+  const double min_time_us = (time_graph->GetCaptureTimeSpanUs() - visible_time_us) / 2;
+  time_graph->SetMinMax(min_time_us, min_time_us + visible_time_us);
+  // Lays out the tracks for the view.
+  time_graph->UpdatePrimitivesSynchronously();
+
+  ThreadTrack* track = time_graph->GetTrackManager()->GetOrCreateThreadTrack(GetTid(0));
+  const uint64_t min_tick = time_graph->GetTickFromUs(time_graph->GetMinTimeUs());
+  const uint64_t max_tick = time_graph->GetTickFromUs(time_graph->GetMaxTimeUs());
+  Batcher batcher(BatcherId::kTimeGraph);
+  TextRenderer* text_renderer = time_graph->GetPrimitivesTextRenderer();
+  for (auto _ : state) {
+    batcher.StartNewFrame();
+    text_renderer->Clear();
+    track->TimerTrack::UpdatePrimitives(&batcher, min_tick, max_tick, PickingMode::kNone);
+  }
+}
+
+}  // namespace
+
+BENCHMARK(BM_ZoomTimeGraph)->Arg(16)->Arg(256)->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_PanTimeGraph)->Arg(16)->Arg(256)->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_UpdateTimerTrackPrimitives)
+    ->Arg(1)
+    ->Arg(64)
+    ->Arg(4096)
+    ->Unit(benchmark::kMicrosecond);
@@ -0,0 +1,188 @@
+// Copyright (c) 2021 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "TimeSeries.h"
+
+#include <algorithm>
+#include <limits>
+
+#include "OrbitBase/Logging.h"
+
+void TimeSeries::AddValue(uint64_t time, double value) {
+  if (size_ == 0 || time > GetTime(size_ - 1)) {
+    Append(time, value);
+    return;
+  }
+
+  size_t index = UpperBound(time);
+  if (index > 0 && GetTime(index - 1) == time) {
+    chunks_[(index - 1) / kChunkSize].values[(index - 1) % kChunkSize] = value;
+    UpdateLevelsFrom(index - 1);
+    return;
+  }
+  Insert(index, time, value);
+}
+
+size_t TimeSeries::UpperBound(uint64_t time) const {
+  // Chunks are never empty.
+  auto chunk_it = std::partition_point(chunks_.begin(), chunks_.end(), [time](const Chunk& chunk) {
+    return chunk.times.back() <= time;
+  });
+  if (chunk_it == chunks_.end()) return size_;
+  auto time_it = std::upper_bound(chunk_it->times.begin(), chunk_it->times.end(), time);
+  return static_cast<size_t>(chunk_it - chunks_.begin()) * kChunkSize +
+         static_cast<size_t>(time_it - chunk_it->times.begin());
+}
+
+TimeSeries::Envelope TimeSeries::GetEnvelope(size_t begin, size_t end) const {
+  CHECK(begin < end);
+  CHECK(end <= size_);
+  Envelope envelope{std::numeric_limits<double>::max(), std::numeric_limits<double>::lowest(),
+                    GetValue(end - 1)};
+  auto add_to_envelope = [this, &envelope](size_t level, size_t index) {
+    envelope.min = std::min(envelope.min, GetMin(level, index));
+    envelope.max = std::max(envelope.max, GetMax(level, index));
+  };
+
+  // Climb the pyramid: at each level, only the groups at the borders of the range that are not
+  // entirely in it are visited, as the others are visited as one group of the level above.
+  size_t level = 0;
+  while (begin < end && level < levels_.size()) {
+    for (; begin < end && begin % kFanOut != 0; ++begin) {
+      add_to_envelope(level, begin);
+    }
+    for (; begin < end && end % kFanOut != 0; --end) {
+      add_to_envelope(level, end - 1);
+    }
+    begin /= kFanOut;
+    end /= kFanOut;
+    ++level;
+  }
+  for (; begin < end; ++begin) {
+    add_to_envelope(level, begin);
+  }
+  return envelope;
+}
+
+std::optional<std::pair<uint64_t, double>> TimeSeries::GetPreviousValueAndTime(
+    uint64_t time) const {
+  size_t index = UpperBound(time);
+  if (index == 0) return std::nullopt;
+  return std::make_pair(GetTime(index - 1), GetValue(index - 1));
+}
+
+void TimeSeries::Append(uint64_t time, double value) {
+  if (size_ % kChunkSize == 0) {
+    Chunk& chunk = chunks_.emplace_back();
+    chunk.times.reserve(kChunkSize);
+    chunk.values.reserve(kChunkSize);
+  }
+  Chunk& chunk = chunks_.back();
+  chunk.times.push_back(time);
+  chunk.values.push_back(value);
+  ++size_;
+  AddToLevels(value);
+}
+
+void TimeSeries::Insert(size_t index, uint64_t time, double value) {
+  CHECK(index < size_);
+  if (size_ % kChunkSize == 0) {
+    Chunk& chunk = chunks_.emplace_back();
+    chunk.times.reserve(kChunkSize);
+    chunk.values.reserve(kChunkSize);
+  }
+
+  // Insert the value in its chunk, and move the last value of each full chunk to the beginning of
+  // the next one, so that all chunks but the last one stay full.
+  uint64_t carried_time = time;
+  double carried_value = value;
+  size_t position = index % kChunkSize;
+  for (size_t chunk_index = index / kChunkSize; chunk_index < chunks_.size(); ++chunk_index) {
+    Chunk& chunk = chunks_[chunk_index];
+    if (chunk.times.size() < kChunkSize) {
+      chunk.times.insert(chunk.times.begin() + position, carried_time);
+      chunk.values.insert(chunk.values.begin() + position, carried_value);
+      break;
+    }
+
+    const uint64_t last_time = chunk.times.back();
+    const double last_value = chunk.values.back();
+    chunk.times.pop_back();
+    chunk.values.pop_back();
+    chunk.times.insert(chunk.times.begin() + position, carried_time);
+    chunk.values.insert(chunk.values.begin() + position, carried_value);
+    carried_time = last_time;
+    carried_value = last_value;
+    position = 0;
+  }
+  ++size_;
+  UpdateLevelsFrom(index);
+}
+
+void TimeSeries::AddToLevels(double value) {
+  const size_t index = size_ - 1;
+  size_t group_size = kFanOut;
+  for (Level& level : levels_) {
+    const size_t group = index / group_size;
+    if (group == level.min.size()) {
+      level.min.push_back(value);
+      level.max.push_back(value);
+    } else {
+      level.min[group] = std::min(level.min[group], value);
+      level.max[group] = std::max(level.max[group], value);
+    }
+    group_size *= kFanOut;
+  }
+  AddLevelsIfNeeded();
+}
+
+void TimeSeries::UpdateLevelsFrom(size_t index) {
+  size_t first_group = index;
+  for (size_t level = 1; level <= levels_.size(); ++level) {
+    first_group /= kFanOut;
+    UpdateLevel(level, first_group);
+  }
+  AddLevelsIfNeeded();
+}
+
+void TimeSeries::UpdateLevel(size_t level, size_t first_group) {
+  CHECK(level >= 1);
+  CHECK(level <= levels_.size());
+  const size_t lower_level_size = GetLevelSize(level - 1);
+  const size_t group_count = (lower_level_size + kFanOut - 1) / kFanOut;
+  Level& groups = levels_[level - 1];
+  groups.min.resize(group_count);
+  groups.max.resize(group_count);
+  for (size_t group = first_group; group < group_count; ++group) {
+    double min = std::numeric_limits<double>::max();
+    double max = std::numeric_limits<double>::lowest();
+    const size_t end = std::min((group + 1) * kFanOut, lower_level_size);
+    for (size_t index = group * kFanOut; index < end; ++index) {
+      min = std::min(min, GetMin(level - 1, index));
+      max = std::max(max, GetMax(level - 1, index));
+    }
+    groups.min[group] = min;
+    groups.max[group] = max;
+  }
+}
+
+void TimeSeries::AddLevelsIfNeeded() {
+  // Levels are added until the top level has at most kFanOut groups.
+  while (GetLevelSize(levels_.size()) > kFanOut) {
+    levels_.emplace_back();
+    UpdateLevel(levels_.size(), 0);
+  }
+}
+
+double TimeSeries::GetMin(size_t level, size_t index) const {
+  return level == 0 ? GetValue(index) : levels_[level - 1].min[index];
+}
+
+double TimeSeries::GetMax(size_t level, size_t index) const {
+  return level == 0 ? GetValue(index) : levels_[level - 1].max[index];
+}
+
+size_t TimeSeries::GetLevelSize(size_t level) const {
+  return level == 0 ? size_ : levels_[level - 1].min.size();
+}
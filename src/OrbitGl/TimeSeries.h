@@ -0,0 +1,89 @@
+// Copyright (c) 2021 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef ORBIT_GL_TIME_SERIES_H_
+#define ORBIT_GL_TIME_SERIES_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <utility>
+#include <vector>
+
+// Values sorted by time, with at most one value per time, as drawn by a GraphTrack. Tracks of
+// counters sampled at a high frequency hold millions of values, so they are stored in two columns,
+// times and values, split into chunks of kChunkSize values, so that adding values never moves the
+// values that are already stored.
+//
+// In addition, the minimum and maximum value of each group of kFanOut consecutive values is kept,
+// and of each group of kFanOut consecutive groups, and so on. This envelope pyramid allows to get
+// the minimum and maximum of any range of values in a logarithmic number of steps, so that a graph
+// can be drawn with one vertical line per pixel column, whatever the number of values in it.
+//
+// Values are expected to be mostly added in order of time. Adding a value before the last one is
+// supported, but costs linear time.
+class TimeSeries {
+ public:
+  // The minimum, maximum and last value of a range of values.
+  struct Envelope {
+    double min;
+    double max;
+    double last;
+  };
+
+  static constexpr size_t kChunkSize = 4096;
+  static constexpr size_t kFanOut = 16;
+
+  // Adds `value` at `time`, replacing the value that was there, if any.
+  void AddValue(uint64_t time, double value);
+
+  [[nodiscard]] size_t size() const { return size_; }
+  [[nodiscard]] bool empty() const { return size_ == 0; }
+  [[nodiscard]] uint64_t GetTime(size_t index) const {
+    return chunks_[index / kChunkSize].times[index % kChunkSize];
+  }
+  [[nodiscard]] double GetValue(size_t index) const {
+    return chunks_[index / kChunkSize].values[index % kChunkSize];
+  }
+
+  // Returns the index of the first value after `time`, or size() if there is none.
+  [[nodiscard]] size_t UpperBound(uint64_t time) const;
+  // Returns the envelope of the values with index in [begin, end), which must not be empty.
+  [[nodiscard]] Envelope GetEnvelope(size_t begin, size_t end) const;
+  // Returns the time and value of the last value at or before `time`, if any.
+  [[nodiscard]] std::optional<std::pair<uint64_t, double>> GetPreviousValueAndTime(
+      uint64_t time) const;
+
+ private:
+  struct Chunk {
+    std::vector<uint64_t> times;
+    std::vector<double> values;
+  };
+
+  // The minimum and maximum of the groups of values of one level of the pyramid. Level 0 are the
+  // values themselves, so the groups of level l hold kFanOut^l values and are stored in
+  // levels_[l - 1]. The last group of a level can be incomplete.
+  struct Level {
+    std::vector<double> min;
+    std::vector<double> max;
+  };
+
+  void Append(uint64_t time, double value);
+  void Insert(size_t index, uint64_t time, double value);
+  void AddToLevels(double value);
+  // Recomputes the groups of all levels that contain the values from `index` on.
+  void UpdateLevelsFrom(size_t index);
+  // Recomputes the groups of `level`, which is at least 1, from `first_group` on.
+  void UpdateLevel(size_t level, size_t first_group);
+  void AddLevelsIfNeeded();
+  [[nodiscard]] double GetMin(size_t level, size_t index) const;
+  [[nodiscard]] double GetMax(size_t level, size_t index) const;
+  [[nodiscard]] size_t GetLevelSize(size_t level) const;
+
+  std::vector<Chunk> chunks_;
+  size_t size_ = 0;
+  std::vector<Level> levels_;
+};
+
+#endif  // ORBIT_GL_TIME_SERIES_H_
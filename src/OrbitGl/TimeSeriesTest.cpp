@@ -0,0 +1,117 @@
+// Copyright (c) 2021 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <map>
+#include <random>
+#include <utility>
+
+#include "TimeSeries.h"
+
+namespace {
+
+void ExpectSameValues(const TimeSeries& series, const std::map<uint64_t, double>& expected) {
+  ASSERT_EQ(series.size(), expected.size());
+  size_t index = 0;
+  for (const auto& [time, value] : expected) {
+    EXPECT_EQ(series.GetTime(index), time);
+    EXPECT_EQ(series.GetValue(index), value);
+    ++index;
+  }
+}
+
+void ExpectEnvelopeOfRange(const TimeSeries& series, size_t begin, size_t end) {
+  double min = series.GetValue(begin);
+  double max = series.GetValue(begin);
+  for (size_t i = begin; i < end; ++i) {
+    min = std::min(min, series.GetValue(i));
+    max = std::max(max, series.GetValue(i));
+  }
+  TimeSeries::Envelope envelope = series.GetEnvelope(begin, end);
+  EXPECT_EQ(envelope.min, min) << "[" << begin << ", " << end << ")";
+  EXPECT_EQ(envelope.max, max) << "[" << begin << ", " << end << ")";
+  EXPECT_EQ(envelope.last, series.GetValue(end - 1));
+}
+
+}  // namespace
+
+TEST(TimeSeries, Empty) {
+  TimeSeries series;
+  EXPECT_TRUE(series.empty());
+  EXPECT_EQ(series.size(), 0);
+  EXPECT_EQ(series.UpperBound(42), 0);
+  EXPECT_FALSE(series.GetPreviousValueAndTime(42).has_value());
+}
+
+TEST(TimeSeries, ValuesAreSortedByTimeAndReplacedAtTheSameTime) {
+  TimeSeries series;
+  std::map<uint64_t, double> expected;
+  std::mt19937 random(42);
+  std::uniform_int_distribution<uint64_t> time_distribution(0, 3 * TimeSeries::kChunkSize);
+  std::uniform_real_distribution<double> value_distribution(-100.0, 100.0);
+
+  // Mostly in order, as when capturing, with some values added before the last one.
+  uint64_t time = 0;
+  for (size_t i = 0; i < 2 * TimeSeries::kChunkSize; ++i) {
+    time += 2;
+    uint64_t value_time = i % 10 == 0 ? time_distribution(random) : time;
+    double value = value_distribution(random);
+    series.AddValue(value_time, value);
+    expected[value_time] = value;
+  }
+  ExpectSameValues(series, expected);
+}
+
+TEST(TimeSeries, UpperBoundAndPreviousValue) {
+  TimeSeries series;
+  for (uint64_t i = 1; i <= 3 * TimeSeries::kChunkSize; ++i) {
+    series.AddValue(10 * i, static_cast<double>(i));
+  }
+
+  EXPECT_EQ(series.UpperBound(0), 0);
+  EXPECT_EQ(series.UpperBound(10), 1);
+  EXPECT_EQ(series.UpperBound(15), 1);
+  EXPECT_EQ(series.UpperBound(10 * TimeSeries::kChunkSize), TimeSeries::kChunkSize);
+  EXPECT_EQ(series.UpperBound(10 * TimeSeries::kChunkSize + 1), TimeSeries::kChunkSize);
+  EXPECT_EQ(series.UpperBound(30 * TimeSeries::kChunkSize), series.size());
+
+  EXPECT_FALSE(series.GetPreviousValueAndTime(9).has_value());
+  auto previous = series.GetPreviousValueAndTime(10 * TimeSeries::kChunkSize + 9);
+  ASSERT_TRUE(previous.has_value());
+  EXPECT_EQ(previous->first, 10 * TimeSeries::kChunkSize);
+  EXPECT_EQ(previous->second, static_cast<double>(TimeSeries::kChunkSize));
+  previous = series.GetPreviousValueAndTime(std::numeric_limits<uint64_t>::max());
+  ASSERT_TRUE(previous.has_value());
+  EXPECT_EQ(previous->first, 30 * TimeSeries::kChunkSize);
+}
+
+TEST(TimeSeries, EnvelopeIsMinMaxAndLastOfRange) {
+  TimeSeries series;
+  std::mt19937 random(42);
+  std::uniform_real_distribution<double> value_distribution(-100.0, 100.0);
+  constexpr uint64_t kNumValues = 10'000;
+  for (uint64_t time = 0; time < kNumValues; ++time) {
+    series.AddValue(2 * time, value_distribution(random));
+  }
+  // Values added before the last one and replaced values update the envelopes.
+  series.AddValue(1001, 1000.0);
+  series.AddValue(20, -1000.0);
+  series.AddValue(4000, 2000.0);
+
+  ExpectEnvelopeOfRange(series, 0, series.size());
+  ExpectEnvelopeOfRange(series, 0, 1);
+  ExpectEnvelopeOfRange(series, series.size() - 1, series.size());
+  std::uniform_int_distribution<size_t> index_distribution(0, series.size() - 1);
+  for (int i = 0; i < 1000; ++i) {
+    size_t begin = index_distribution(random);
+    size_t end = index_distribution(random) + 1;
+    if (begin >= end) std::swap(begin, end);
+    if (begin == end) ++end;
+    ExpectEnvelopeOfRange(series, begin, end);
+  }
+}
@@ -13,6 +13,8 @@ void TimerBlock::Add(const TextBox& item) {
   if (size_ == kBlockSize) {
     if (next_ == nullptr) {
       next_ = new TimerBlock(chain_, this);
+      absl::MutexLock lock(&chain_->blocks_mutex_);
+      chain_->blocks_.push_back(next_);
     }
 
     chain_->current_ = next_;
@@ -23,16 +25,62 @@ void TimerBlock::Add(const TextBox& item) {
 
   CHECK(size_ < kBlockSize);
   data_[size_] = item;
+  uint64_t& group_max_end = group_max_end_[size_ / kGroupSize];
+  group_max_end = std::max(item.End(), group_max_end);
   ++size_;
   ++chain_->num_items_;
-  min_timestamp_ = std::min(item.GetTimerInfo().start(), min_timestamp_);
-  max_timestamp_ = std::max(item.GetTimerInfo().end(), max_timestamp_);
+  min_timestamp_ = std::min(item.Start(), min_timestamp_);
+  max_timestamp_ = std::max(item.End(), max_timestamp_);
+  max_start_so_far_ = std::max(item.Start(), max_start_so_far_);
+  max_end_so_far_ = std::max(item.End(), max_end_so_far_);
+  if (item.Start() < chain_->last_start_) chain_->is_sorted_by_start_ = false;
+  chain_->last_start_ = item.Start();
 }
 
 bool TimerBlock::Intersects(uint64_t min, uint64_t max) const {
   return (min <= max_timestamp_ && max >= min_timestamp_);
 }
 
+uint64_t TimerBlock::FindFirstEndingAtOrAfter(uint64_t index, uint64_t time) const {
+  if (index >= size_ || max_timestamp_ < time) return size_;
+
+  // First look at the remaining timers of the group that contains `index`, then skip the groups
+  // whose timers all end before `time`.
+  uint64_t group = index / kGroupSize;
+  uint64_t group_end = std::min((group + 1) * kGroupSize, size_);
+  for (uint64_t i = index; i < group_end; ++i) {
+    if (data_[i].End() >= time) return i;
+  }
+  for (++group; group * kGroupSize < size_; ++group) {
+    if (group_max_end_[group] < time) continue;
+    group_end = std::min((group + 1) * kGroupSize, size_);
+    for (uint64_t i = group * kGroupSize; i < group_end; ++i) {
+      if (data_[i].End() >= time) return i;
+    }
+  }
+  return size_;
+}
+
+uint64_t TimerBlock::FindNextTimerToDraw(uint64_t index, uint64_t min_time,
+                                         uint64_t max_ignore) const {
+  if (chain_->IsSortedByStart()) {
+    return FindFirstEndingAtOrAfter(index + 1, std::max(min_time, max_ignore + 1));
+  }
+  return FindFirstEndingAtOrAfter(index + 1, min_time);
+}
+
+const TextBox* TimerBlock::GetTimerBefore(uint64_t index) const {
+  if (index > 0) return &data_[index - 1];
+  if (prev_ != nullptr && prev_->size_ > 0) return &prev_->data_[prev_->size_ - 1];
+  return nullptr;
+}
+
+const TextBox* TimerBlock::GetTimerAfter(uint64_t index) const {
+  if (index + 1 < size_) return &data_[index + 1];
+  if (next_ != nullptr && next_->size_ > 0) return &next_->data_[0];
+  return nullptr;
+}
+
 TimerChain::~TimerChain() {
   // Find last block in chain
   while (current_->next_) current_ = current_->next_;
@@ -46,22 +94,77 @@ TimerChain::~TimerChain() {
 }
 
 TimerBlock* TimerChain::GetBlockContaining(const TextBox* element) const {
-  TimerBlock* block = root_;
-  while (block) {
+  auto contains_element = [element](const TimerBlock* block) {
     uint32_t size = block->size_;
-    if (size != 0) {
-      TextBox* begin = &block->data_[0];
-      TextBox* end = &block->data_[size - 1];
-      if (begin <= element && end >= element) {
-        return block;
-      }
+    return size != 0 && &block->data_[0] <= element && &block->data_[size - 1] >= element;
+  };
+
+  if (is_sorted_by_start_) {
+    // The element is in the first block that has a timer starting at or after it, or in one of the
+    // following blocks if several timers have the same start timestamp.
+    absl::MutexLock lock(&blocks_mutex_);
+    auto it = std::partition_point(
+        blocks_.begin(), blocks_.end(),
+        [element](const TimerBlock* block) { return block->max_start_so_far_ < element->Start(); });
+    for (; it != blocks_.end(); ++it) {
+      if (contains_element(*it)) return *it;
     }
+    return nullptr;
+  }
+
+  TimerBlock* block = root_;
+  while (block) {
+    if (contains_element(block)) return block;
     block = block->next_;
   }
 
   return nullptr;
 }
 
+const TextBox* TimerChain::FindFirstStartingAfter(uint64_t time) const {
+  const TimerBlock* block = nullptr;
+  {
+    absl::MutexLock lock(&blocks_mutex_);
+    // As max_start_so_far_ is non-decreasing along the chain, the first timer starting after `time`
+    // is in the first block for which it exceeds `time`.
+    auto it = std::partition_point(
+        blocks_.begin(), blocks_.end(),
+        [time](const TimerBlock* block) { return block->max_start_so_far_ <= time; });
+    if (it == blocks_.end()) return nullptr;
+    block = *it;
+  }
+
+  const TextBox* begin = &block->data_[0];
+  const TextBox* end = begin + block->size_;
+  if (is_sorted_by_start_) {
+    const TextBox* text_box = std::partition_point(
+        begin, end, [time](const TextBox& text_box) { return text_box.Start() <= time; });
+    return text_box != end ? text_box : nullptr;
+  }
+  const TextBox* text_box = std::find_if(
+      begin, end, [time](const TextBox& text_box) { return text_box.Start() > time; });
+  return text_box != end ? text_box : nullptr;
+}
+
+TimerChainIterator TimerChain::FindFirstBlockEndingAtOrAfter(uint64_t time) {
+  absl::MutexLock lock(&blocks_mutex_);
+  auto it = std::partition_point(blocks_.begin(), blocks_.end(), [time](const TimerBlock* block) {
+    return block->max_end_so_far_ < time;
+  });
+  return TimerChainIterator(it != blocks_.end() ? *it : nullptr);
+}
+
+const TimerBlock* TimerChain::FindLastBlockStartingBefore(uint64_t time) const {
+  absl::MutexLock lock(&blocks_mutex_);
+  if (!is_sorted_by_start_) return blocks_.back();
+  // All the timers after the first block that has a timer starting at or after `time` also start
+  // at or after `time`.
+  auto it = std::partition_point(blocks_.begin(), blocks_.end(), [time](const TimerBlock* block) {
+    return block->max_start_so_far_ < time;
+  });
+  return it != blocks_.end() ? *it : blocks_.back();
+}
+
 TextBox* TimerChain::GetElementAfter(const TextBox* element) const {
   auto block = GetBlockContaining(element);
   if (block) {
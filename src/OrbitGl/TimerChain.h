@@ -10,8 +10,10 @@
 #include <cstdint>
 #include <iosfwd>
 #include <limits>
+#include <vector>
 
 #include "TextBox.h"
+#include "absl/synchronization/mutex.h"
 
 static constexpr int kBlockSize = 1024;
 class TimerChain;
@@ -22,6 +24,11 @@ class TimerChain;
 // entire block by using the Intersects(t_min, t_max) method. This effectively
 // tests if any of the timers stored in this block intersects with the [t_min,
 // t_max] interval.
+// In addition, the block keeps the maximum end timestamp of each group of kGroupSize consecutive
+// timers, which allows skipping all the timers that end before a given time, e.g., the timers that
+// fall into a pixel column that has already been drawn, in a bounded number of steps. Finally, it
+// keeps the maximum start and end timestamps of the timers in this block and all previous blocks,
+// which are monotonic along the chain and therefore allow TimerChain to binary search its blocks.
 class TimerBlock {
   friend class TimerChain;
   friend class TimerChainIterator;
@@ -33,7 +40,10 @@ class TimerBlock {
         chain_(chain),
         size_(0),
         min_timestamp_(std::numeric_limits<uint64_t>::max()),
-        max_timestamp_(std::numeric_limits<uint64_t>::min()) {}
+        max_timestamp_(std::numeric_limits<uint64_t>::min()),
+        max_start_so_far_(prev != nullptr ? prev->max_start_so_far_ : 0),
+        max_end_so_far_(prev != nullptr ? prev->max_end_so_far_ : 0),
+        group_max_end_{} {}
 
   // Adds an item to the block. If capacity of this block is reached, a new
   // blocked is allocated and the item is added to the new block.
@@ -44,6 +54,27 @@ class TimerBlock {
   // that have so far been added to this block.
   bool Intersects(uint64_t min, uint64_t max) const;
 
+  // Returns the index of the first timer at or after `index` that ends at or after `time`, or
+  // size() if there is no such timer in this block.
+  [[nodiscard]] uint64_t FindFirstEndingAtOrAfter(uint64_t index, uint64_t time) const;
+
+  // Returns the index of the next timer after `index` that ends at or after `min_time` and that
+  // still needs to be drawn, given that a line was drawn up to `max_ignore` for a timer at or
+  // before `index`, or size() if there is none. The timers that end by `max_ignore` are only
+  // skipped if the chain is sorted by start, as only then do they all start inside the pixel
+  // column of that line. Otherwise, they might start before it, e.g., for GPU timers.
+  [[nodiscard]] uint64_t FindNextTimerToDraw(uint64_t index, uint64_t min_time,
+                                             uint64_t max_ignore) const;
+
+  // Return the timer preceding, respectively following, the timer at `index` in the chain, which
+  // might be in the previous or next block, or nullptr if there is none.
+  [[nodiscard]] const TextBox* GetTimerBefore(uint64_t index) const;
+  [[nodiscard]] const TextBox* GetTimerAfter(uint64_t index) const;
+
+  [[nodiscard]] const TimerBlock* GetPrevious() const { return prev_; }
+  // Returns the maximum end timestamp of the timers in this block and in all previous blocks.
+  [[nodiscard]] uint64_t GetMaxEndSoFar() const { return max_end_so_far_; }
+
   uint64_t size() const { return size_; }
 
   TextBox& operator[](std::size_t idx) { return data_[idx]; }
@@ -59,6 +90,11 @@ class TimerBlock {
 
   uint64_t min_timestamp_;
   uint64_t max_timestamp_;
+  uint64_t max_start_so_far_;
+  uint64_t max_end_so_far_;
+
+  static constexpr uint64_t kGroupSize = 32;
+  uint64_t group_max_end_[kBlockSize / kGroupSize];
 };
 
 // TimerChainIterator iterates over all *blocks* of the chain, not the
@@ -96,6 +132,10 @@ class TimerChainIterator {
 // is a difference compared with BlockChain in how the iterators work: Here,
 // the iterator runs over blocks, in BlockChain the iterator runs over the
 // individually stored elements.
+// In addition, TimerChain keeps a directory of its blocks, so that seeking to a timestamp takes a
+// binary search over the blocks, followed by a binary search inside the block when the timers were
+// added in order of start timestamp, which is the case for all timers at the same depth of a
+// thread track. Otherwise, the search inside the block is linear.
 class TimerChain {
   friend class TimerBlock;
 
@@ -103,6 +143,7 @@ class TimerChain {
   TimerChain() : num_blocks_(1), num_items_(0) {
     root_ = new TimerBlock(this, nullptr);
     current_ = root_;
+    blocks_.push_back(root_);
   }
 
   ~TimerChain();
@@ -117,6 +158,21 @@ class TimerChain {
 
   [[nodiscard]] TextBox* GetElementBefore(const TextBox* element) const;
 
+  // Returns the first timer, in the order in which timers were added, that starts after `time`, or
+  // nullptr if there is none.
+  [[nodiscard]] const TextBox* FindFirstStartingAfter(uint64_t time) const;
+
+  // Returns an iterator to the first block containing a timer that ends at or after `time`. All
+  // the timers in the previous blocks end before `time`.
+  [[nodiscard]] TimerChainIterator FindFirstBlockEndingAtOrAfter(uint64_t time);
+
+  // Returns the last block that can contain a timer starting before `time`: all the timers in the
+  // following blocks start at or after `time`.
+  [[nodiscard]] const TimerBlock* FindLastBlockStartingBefore(uint64_t time) const;
+
+  // Whether the timers were added in non-decreasing order of start timestamp.
+  [[nodiscard]] bool IsSortedByStart() const { return is_sorted_by_start_; }
+
   [[nodiscard]] TimerChainIterator begin() { return TimerChainIterator(root_); }
 
   [[nodiscard]] TimerChainIterator end() { return TimerChainIterator(nullptr); }
@@ -126,6 +182,11 @@ class TimerChain {
   TimerBlock* current_;
   uint64_t num_blocks_;
   uint64_t num_items_;
+  uint64_t last_start_ = 0;
+  std::atomic<bool> is_sorted_by_start_{true};
+
+  mutable absl::Mutex blocks_mutex_;
+  std::vector<TimerBlock*> blocks_ ABSL_GUARDED_BY(blocks_mutex_);
 };
 
 #endif  // ORBIT_GL_TIMER_CHAIN_H_
@@ -0,0 +1,189 @@
+// Copyright (c) 2021 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+#include "TextBox.h"
+#include "TimerChain.h"
+#include "capture_data.pb.h"
+
+using orbit_client_protos::TimerInfo;
+
+namespace {
+
+TextBox MakeTextBox(uint64_t start, uint64_t end) {
+  TimerInfo timer_info;
+  timer_info.set_start(start);
+  timer_info.set_end(end);
+  return TextBox(timer_info);
+}
+
+}  // namespace
+
+TEST(TimerBlock, FindFirstEndingAtOrAfter) {
+  TimerChain chain;
+  // Timers [10 * i, 10 * i + 5] for the first block.
+  for (uint64_t i = 0; i < kBlockSize; ++i) {
+    chain.push_back(MakeTextBox(10 * i, 10 * i + 5));
+  }
+  const TimerBlock& block = *chain.begin();
+  ASSERT_EQ(block.size(), kBlockSize);
+
+  EXPECT_EQ(block.FindFirstEndingAtOrAfter(0, 0), 0);
+  EXPECT_EQ(block.FindFirstEndingAtOrAfter(0, 5), 0);
+  EXPECT_EQ(block.FindFirstEndingAtOrAfter(0, 6), 1);
+  EXPECT_EQ(block.FindFirstEndingAtOrAfter(3, 6), 3);
+  EXPECT_EQ(block.FindFirstEndingAtOrAfter(0, 5000), 500);
+  EXPECT_EQ(block.FindFirstEndingAtOrAfter(600, 5000), 600);
+  EXPECT_EQ(block.FindFirstEndingAtOrAfter(0, 10 * (kBlockSize - 1) + 5), kBlockSize - 1);
+  EXPECT_EQ(block.FindFirstEndingAtOrAfter(0, 10 * (kBlockSize - 1) + 6), kBlockSize);
+  EXPECT_EQ(block.FindFirstEndingAtOrAfter(kBlockSize, 0), kBlockSize);
+}
+
+TEST(TimerBlock, FindFirstEndingAtOrAfterWithUnsortedEnds) {
+  TimerChain chain;
+  // A long timer in the middle of short ones, as can happen with overlapping timers.
+  for (uint64_t i = 0; i < 100; ++i) {
+    chain.push_back(MakeTextBox(i, i == 40 ? 1000 : i + 1));
+  }
+  const TimerBlock& block = *chain.begin();
+
+  EXPECT_EQ(block.FindFirstEndingAtOrAfter(0, 500), 40);
+  EXPECT_EQ(block.FindFirstEndingAtOrAfter(41, 500), 100);
+  EXPECT_EQ(block.FindFirstEndingAtOrAfter(41, 80), 79);
+}
+
+TEST(TimerBlock, FindNextTimerToDrawSkipsTimersInDrawnPixelColumnIfSortedByStart) {
+  TimerChain chain;
+  for (uint64_t start : {0, 100, 120, 200}) {
+    chain.push_back(MakeTextBox(start, start + 5));
+  }
+  ASSERT_TRUE(chain.IsSortedByStart());
+  const TimerBlock& block = *chain.begin();
+
+  // A line was drawn for the timer at index 1 in a pixel column that ends at 150.
+  EXPECT_EQ(block.FindNextTimerToDraw(1, 0, 150), 3);
+  EXPECT_EQ(block.FindNextTimerToDraw(1, 0, 110), 2);
+  EXPECT_EQ(block.FindNextTimerToDraw(1, 210, 0), 4);
+}
+
+TEST(TimerBlock, FindNextTimerToDrawDoesNotSkipTimersInDrawnPixelColumnIfNotSortedByStart) {
+  TimerChain chain;
+  // The timer at index 2 starts before the one at index 1, but ends in its pixel column.
+  for (uint64_t start : {0, 100, 20, 200}) {
+    chain.push_back(MakeTextBox(start, start == 20 ? 130 : start + 5));
+  }
+  ASSERT_FALSE(chain.IsSortedByStart());
+  const TimerBlock& block = *chain.begin();
+
+  EXPECT_EQ(block.FindNextTimerToDraw(1, 0, 150), 2);
+  EXPECT_EQ(block.FindNextTimerToDraw(2, 0, 150), 3);
+  // Timers that end before the visible range are still skipped.
+  EXPECT_EQ(block.FindNextTimerToDraw(0, 150, 0), 3);
+}
+
+TEST(TimerBlock, GetTimerBeforeAndAfter) {
+  TimerChain chain;
+  for (uint64_t i = 0; i < kBlockSize + 1; ++i) {
+    chain.push_back(MakeTextBox(i, i + 1));
+  }
+  TimerChainIterator it = chain.begin();
+  const TimerBlock& first_block = *it;
+  ++it;
+  const TimerBlock& second_block = *it;
+  ASSERT_EQ(second_block.size(), 1);
+
+  EXPECT_EQ(first_block.GetTimerBefore(0), nullptr);
+  EXPECT_EQ(first_block.GetTimerBefore(1), &first_block[0]);
+  EXPECT_EQ(first_block.GetTimerAfter(0), &first_block[1]);
+  EXPECT_EQ(first_block.GetTimerAfter(kBlockSize - 1), &second_block[0]);
+  EXPECT_EQ(second_block.GetTimerBefore(0), &first_block[kBlockSize - 1]);
+  EXPECT_EQ(second_block.GetTimerAfter(0), nullptr);
+}
+
+TEST(TimerChain, FindFirstStartingAfter) {
+  TimerChain chain;
+  EXPECT_EQ(chain.FindFirstStartingAfter(0), nullptr);
+
+  constexpr uint64_t kTimerCount = 3 * kBlockSize + 10;
+  for (uint64_t i = 0; i < kTimerCount; ++i) {
+    chain.push_back(MakeTextBox(10 * i, 10 * i + 5));
+  }
+  EXPECT_TRUE(chain.IsSortedByStart());
+
+  for (uint64_t time : std::vector<uint64_t>{0, 5, 10, 10239, 10240, 10241, 20475, 30000}) {
+    const TextBox* text_box = chain.FindFirstStartingAfter(time);
+    ASSERT_NE(text_box, nullptr);
+    EXPECT_EQ(text_box->Start(), (time / 10 + 1) * 10);
+  }
+  EXPECT_EQ(chain.FindFirstStartingAfter(10 * (kTimerCount - 1)), nullptr);
+}
+
+TEST(TimerChain, FindFirstStartingAfterWithUnsortedTimers) {
+  TimerChain chain;
+  for (uint64_t i = 0; i < 2 * kBlockSize; ++i) {
+    // Swap the starts of each pair of timers.
+    uint64_t start = 10 * (i % 2 == 0 ? i + 1 : i - 1);
+    chain.push_back(MakeTextBox(start, start + 5));
+  }
+  EXPECT_FALSE(chain.IsSortedByStart());
+
+  const TextBox* text_box = chain.FindFirstStartingAfter(1000);
+  ASSERT_NE(text_box, nullptr);
+  EXPECT_EQ(text_box->Start(), 1010);
+  text_box = chain.FindFirstStartingAfter(1005);
+  ASSERT_NE(text_box, nullptr);
+  EXPECT_EQ(text_box->Start(), 1010);
+  text_box = chain.FindFirstStartingAfter(1010);
+  ASSERT_NE(text_box, nullptr);
+  EXPECT_EQ(text_box->Start(), 1030);
+}
+
+TEST(TimerChain, FindBlocks) {
+  TimerChain chain;
+  for (uint64_t i = 0; i < 3 * kBlockSize; ++i) {
+    chain.push_back(MakeTextBox(10 * i, 10 * i + 5));
+  }
+  TimerChainIterator it = chain.begin();
+  const TimerBlock* first_block = &*it;
+  ++it;
+  const TimerBlock* second_block = &*it;
+  ++it;
+  const TimerBlock* third_block = &*it;
+
+  EXPECT_EQ(&*chain.FindFirstBlockEndingAtOrAfter(0), first_block);
+  EXPECT_EQ(&*chain.FindFirstBlockEndingAtOrAfter(10 * (kBlockSize - 1) + 5), first_block);
+  EXPECT_EQ(&*chain.FindFirstBlockEndingAtOrAfter(10 * (kBlockSize - 1) + 6), second_block);
+  EXPECT_EQ(&*chain.FindFirstBlockEndingAtOrAfter(10 * (2 * kBlockSize)), third_block);
+  EXPECT_TRUE(chain.FindFirstBlockEndingAtOrAfter(10 * (3 * kBlockSize)) == chain.end());
+
+  EXPECT_EQ(chain.FindLastBlockStartingBefore(0), first_block);
+  EXPECT_EQ(chain.FindLastBlockStartingBefore(10 * kBlockSize), second_block);
+  EXPECT_EQ(chain.FindLastBlockStartingBefore(10 * kBlockSize + 1), second_block);
+  EXPECT_EQ(chain.FindLastBlockStartingBefore(std::numeric_limits<uint64_t>::max()), third_block);
+}
+
+TEST(TimerChain, GetElementBeforeAndAfter) {
+  TimerChain chain;
+  for (uint64_t i = 0; i < 2 * kBlockSize; ++i) {
+    chain.push_back(MakeTextBox(i, i + 1));
+  }
+  TimerChainIterator it = chain.begin();
+  const TimerBlock& first_block = *it;
+  ++it;
+  const TimerBlock& second_block = *it;
+
+  EXPECT_EQ(chain.GetElementBefore(&first_block[0]), nullptr);
+  EXPECT_EQ(chain.GetElementAfter(&first_block[0]), &first_block[1]);
+  EXPECT_EQ(chain.GetElementAfter(&first_block[kBlockSize - 1]), &second_block[0]);
+  EXPECT_EQ(chain.GetElementBefore(&second_block[0]), &first_block[kBlockSize - 1]);
+  EXPECT_EQ(chain.GetElementAfter(&second_block[kBlockSize - 1]), nullptr);
+
+  TextBox other;
+  EXPECT_EQ(chain.GetElementAfter(&other), nullptr);
+}
@@ -8,6 +8,7 @@
 #include <stdint.h>
 
 #include <memory>
+#include <utility>
 #include <vector>
 
 #include "TextBox.h"
@@ -31,13 +32,23 @@ class TimerInfosIterator {
 
   TimerInfosIterator& operator++();
 
-  const orbit_client_protos::TimerInfo& operator*() const {
+  // The TimerInfo is materialized from the compact TextBox, so it is returned by value.
+  orbit_client_protos::TimerInfo operator*() const {
     return (*blocks_it_)[timer_index_].GetTimerInfo();
   }
 
-  const orbit_client_protos::TimerInfo* operator->() const {
-    return &(*blocks_it_)[timer_index_].GetTimerInfo();
-  }
+  // Holds the materialized TimerInfo for the duration of the member access through `->`.
+  class TimerInfoArrowProxy {
+   public:
+    explicit TimerInfoArrowProxy(orbit_client_protos::TimerInfo timer_info)
+        : timer_info_(std::move(timer_info)) {}
+    const orbit_client_protos::TimerInfo* operator->() const { return &timer_info_; }
+
+   private:
+    orbit_client_protos::TimerInfo timer_info_;
+  };
+
+  TimerInfoArrowProxy operator->() const { return TimerInfoArrowProxy(**this); }
 
   bool operator==(const TimerInfosIterator& other) const {
     return chains_it_ == other.chains_it_ && blocks_it_ == other.blocks_it_ &&
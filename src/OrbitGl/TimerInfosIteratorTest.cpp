@@ -22,18 +22,16 @@ using orbit_client_protos::TimerInfo;
 TEST(TimerInfosIterator, Access) {
   std::vector<std::shared_ptr<TimerChain>> chains;
   std::shared_ptr<TimerChain> chain = std::make_shared<TimerChain>();
-  TextBox box;
   TimerInfo timer;
   timer.set_function_id(1);
-  // Need to set the end, as SetTimerInfo will refuse that timer otherwise.
   timer.set_end(1);
-  box.SetTimerInfo(timer);
+  TextBox box(timer);
   chain->push_back(box);
   chains.push_back(chain);
 
   // Just validate setting worked as expected
   EXPECT_EQ(1, timer.function_id());
-  EXPECT_EQ(1, box.GetTimerInfo().function_id());
+  EXPECT_EQ(1, box.GetFunctionId());
 
   // Now create an iterator and test to access it
   TimerInfosIterator it(chains.begin(), chains.end());
@@ -44,12 +42,10 @@ TEST(TimerInfosIterator, Access) {
 TEST(TimerInfosIterator, Copy) {
   std::vector<std::shared_ptr<TimerChain>> chains;
   std::shared_ptr<TimerChain> chain = std::make_shared<TimerChain>();
-  TextBox box;
   TimerInfo timer;
   timer.set_function_id(1);
-  // Need to set the end, as SetTimerInfo will refuse that timer otherwise.
   timer.set_end(1);
-  box.SetTimerInfo(timer);
+  TextBox box(timer);
   chain->push_back(box);
   chains.push_back(chain);
 
@@ -77,12 +73,10 @@ TEST(TimerInfosIterator, Copy) {
 TEST(TimerInfosIterator, Move) {
   std::vector<std::shared_ptr<TimerChain>> chains;
   std::shared_ptr<TimerChain> chain = std::make_shared<TimerChain>();
-  TextBox box;
   TimerInfo timer;
   timer.set_function_id(1);
-  // Need to set the end, as SetTimerInfo will refuse that timer otherwise.
   timer.set_end(1);
-  box.SetTimerInfo(timer);
+  TextBox box(timer);
   chain->push_back(box);
   chains.push_back(chain);
 
@@ -102,11 +96,10 @@ TEST(TimerInfosIterator, Move) {
 TEST(TimerInfosIterator, Equality) {
   std::vector<std::shared_ptr<TimerChain>> chains;
   std::shared_ptr<TimerChain> chain = std::make_shared<TimerChain>();
-  TextBox box;
   TimerInfo timer;
   timer.set_function_id(1);
   timer.set_end(1);
-  box.SetTimerInfo(timer);
+  TextBox box(timer);
   chain->push_back(box);
   chains.push_back(chain);
 
@@ -153,12 +146,11 @@ TEST(TimerInfosIterator, ForEachLarge) {
   for (size_t chain_count = 0; chain_count < 12; ++chain_count) {
     std::shared_ptr<TimerChain> chain = std::make_shared<TimerChain>();
     for (size_t box_count = 0; box_count < max_timers; ++box_count) {
-      TextBox box;
       TimerInfo timer;
       timer.set_function_id(count);
       timer.set_start(count);
       timer.set_end(count + 1);
-      box.SetTimerInfo(timer);
+      TextBox box(timer);
       chain->push_back(box);
       expected.push_back(count);
       ++count;
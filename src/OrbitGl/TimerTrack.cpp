@@ -31,21 +31,14 @@ const Color TimerTrack::kHighlightColor = Color(100, 181, 246, 255);
 
 TimerTrack::TimerTrack(TimeGraph* time_graph, TimeGraphLayout* layout, OrbitApp* app,
                        const CaptureData* capture_data)
-    : Track(time_graph, layout, capture_data), app_{app} {
-  text_renderer_ = time_graph->GetTextRenderer();
-}
-
-void TimerTrack::Draw(GlCanvas* canvas, PickingMode picking_mode, float z_offset) {
-  float track_height = GetHeight();
-  float track_width = canvas->GetWorldWidth();
-
-  SetPos(canvas->GetWorldTopLeftX(), pos_[1]);
-  SetSize(track_width, track_height);
+    : Track(time_graph, layout, capture_data), app_{app} {}
 
-  Track::Draw(canvas, picking_mode, z_offset);
+void TimerTrack::UpdateLayout() {
+  Track::UpdateLayout();
+  UpdateBoxHeight();
 }
 
-std::string TimerTrack::GetExtraInfo(const TimerInfo& timer_info) {
+std::string TimerTrack::GetExtraInfo(const TimerInfo& timer_info) const {
   std::string info;
   static bool show_return_value = absl::GetFlag(FLAGS_show_return_values);
   if (show_return_value && timer_info.type() == TimerInfo::kNone) {
@@ -90,19 +83,21 @@ bool TimerTrack::DrawTimer(const TextBox* prev_text_box, const TextBox* next_tex
   CHECK(min_ignore != nullptr);
   CHECK(max_ignore != nullptr);
   if (current_text_box == nullptr) return false;
-  const TimerInfo& current_timer_info = current_text_box->GetTimerInfo();
-  if (draw_data.min_tick > current_timer_info.end() ||
-      draw_data.max_tick < current_timer_info.start()) {
+  if (draw_data.min_tick > current_text_box->End() ||
+      draw_data.max_tick < current_text_box->Start()) {
     return false;
   }
-  if (current_timer_info.start() >= *min_ignore && current_timer_info.end() <= *max_ignore)
+  if (current_text_box->Start() >= *min_ignore && current_text_box->End() <= *max_ignore) {
     return false;
+  }
+  // Only the timers that pass the checks above are materialized.
+  const TimerInfo current_timer_info = current_text_box->GetTimerInfo();
   if (!TimerFilter(current_timer_info)) return false;
 
   UpdateDepth(current_timer_info.depth() + 1);
-  double start_us = time_graph_->GetUsFromTick(current_timer_info.start());
+  double start_us = draw_data.view->GetUsFromTick(current_timer_info.start());
   double start_or_prev_end_us = start_us;
-  double end_us = time_graph_->GetUsFromTick(current_timer_info.end());
+  double end_us = draw_data.view->GetUsFromTick(current_timer_info.end());
   double end_or_next_start_us = end_us;
 
   float world_timer_y = GetYFromTimer(current_timer_info);
@@ -111,18 +106,17 @@ bool TimerTrack::DrawTimer(const TextBox* prev_text_box, const TextBox* next_tex
   // Check if the previous timer overlaps with the current one, and if so draw the overlap
   // as triangles rather than as overlapping rectangles.
   if (prev_text_box != nullptr) {
-    const TimerInfo& prev_timer_info = prev_text_box->GetTimerInfo();
     // TODO(b/179985943): Turn this back into a check.
-    if (prev_timer_info.start() < current_timer_info.start()) {
+    if (prev_text_box->Start() < current_timer_info.start()) {
       // Note, that for timers that are completely inside the previous one, we will keep drawing
       // them above each other, as a proper solution would require us to keep a list of all
       // prev. intersecting timers. Further, we also compare the type, as for the Gpu timers,
       // timers of different type but same depth are drawn below each other (and thus do not
       // overlap).
-      if (prev_timer_info.end() > current_timer_info.start() &&
-          prev_timer_info.end() <= current_timer_info.end() &&
-          prev_timer_info.type() == current_timer_info.type()) {
-        start_or_prev_end_us = time_graph_->GetUsFromTick(prev_timer_info.end());
+      if (prev_text_box->End() > current_timer_info.start() &&
+          prev_text_box->End() <= current_timer_info.end() &&
+          prev_text_box->GetType() == current_timer_info.type()) {
+        start_or_prev_end_us = draw_data.view->GetUsFromTick(prev_text_box->End());
       }
     }
   }
@@ -130,17 +124,16 @@ bool TimerTrack::DrawTimer(const TextBox* prev_text_box, const TextBox* next_tex
   // Check if the next timer overlaps with the current one, and if so draw the overlap
   // as triangles rather than as overlapping rectangles.
   if (next_text_box != nullptr) {
-    const TimerInfo& next_timer_info = next_text_box->GetTimerInfo();
     // TODO(b/179985943): Turn this back into a check.
-    if (current_timer_info.start() < next_timer_info.start()) {
+    if (current_timer_info.start() < next_text_box->Start()) {
       // Note, that for timers that are completely inside the next one, we will keep drawing
       // them above each other, as a proper solution would require us to keep a list of all
       // upcoming intersecting timers. We also compare the type, as for the Gpu timers, timers
       // of different type but same depth are drawn below each other (and thus do not overlap).
-      if (current_timer_info.end() > next_timer_info.start() &&
-          current_timer_info.end() <= next_timer_info.end() &&
-          next_timer_info.type() == current_timer_info.type()) {
-        end_or_next_start_us = time_graph_->GetUsFromTick(next_timer_info.start());
+      if (current_timer_info.end() > next_text_box->Start() &&
+          current_timer_info.end() <= next_text_box->End() &&
+          next_text_box->GetType() == current_timer_info.type()) {
+        end_or_next_start_us = draw_data.view->GetUsFromTick(next_text_box->Start());
       }
     }
   }
@@ -156,18 +149,15 @@ bool TimerTrack::DrawTimer(const TextBox* prev_text_box, const TextBox* next_tex
     double text_x_end_us = end_or_next_start_us + (.25 * right_overlap_width_us);
 
     bool is_visible_width = ((text_x_end_us - text_x_start_us) * draw_data.inv_time_window *
-                             draw_data.canvas->GetWidth()) > 1;
+                             draw_data.view->screen_width) > 1;
     WorldXInfo world_x_info = ToWorldX(text_x_start_us, text_x_end_us, draw_data.inv_time_window,
                                        draw_data.world_start_x, draw_data.world_width);
 
     if (is_visible_width) {
       Vec2 pos(world_x_info.world_x_start, world_timer_y);
       Vec2 size(world_x_info.world_x_width, GetTextBoxHeight(current_timer_info));
-      current_text_box->SetPos(pos);
-      current_text_box->SetSize(size);
-
       SetTimesliceText(current_timer_info, elapsed_us, draw_data.world_start_x, draw_data.z_offset,
-                       current_text_box);
+                       pos, size);
     }
   }
 
@@ -177,9 +167,9 @@ bool TimerTrack::DrawTimer(const TextBox* prev_text_box, const TextBox* next_tex
   bool is_highlighted = !is_selected && function_id != orbit_grpc_protos::kInvalidFunctionId &&
                         function_id == draw_data.highlighted_function_id;
 
-  Color color = GetTimerColor(current_timer_info, is_selected, is_highlighted);
+  Color color = GetTimerColor(current_timer_info, is_selected, is_highlighted, draw_data);
 
-  bool is_visible_width = elapsed_us * draw_data.inv_time_window * draw_data.canvas->GetWidth() > 1;
+  bool is_visible_width = elapsed_us * draw_data.inv_time_window * draw_data.view->screen_width > 1;
 
   if (is_visible_width) {
     WorldXInfo world_x_info_left_overlap =
@@ -199,24 +189,18 @@ bool TimerTrack::DrawTimer(const TextBox* prev_text_box, const TextBox* next_tex
     Vec3 bottom_right(
         world_x_info_right_overlap.world_x_start + world_x_info_right_overlap.world_x_width,
         world_timer_y, draw_data.z);
-    Batcher* batcher = draw_data.batcher;
     draw_data.batcher->AddShadedTrapezium(
         top_left, bottom_left, bottom_right, top_right, color,
-        std::make_unique<PickingUserData>(current_text_box, [&, batcher](PickingId id) {
-          return this->GetBoxTooltip(*batcher, id);
-        }));
+        PickingUserData(current_text_box, draw_data.tooltip_callback));
 
   } else {
-    Batcher* batcher = draw_data.batcher;
-    auto user_data = std::make_unique<PickingUserData>(
-        current_text_box, [&, batcher](PickingId id) { return this->GetBoxTooltip(*batcher, id); });
-
     WorldXInfo world_x_info = ToWorldX(start_us, end_us, draw_data.inv_time_window,
                                        draw_data.world_start_x, draw_data.world_width);
 
     Vec2 pos(world_x_info.world_x_start, world_timer_y);
-    draw_data.batcher->AddVerticalLine(pos, GetTextBoxHeight(current_timer_info), draw_data.z,
-                                       color, std::move(user_data));
+    draw_data.batcher->AddVerticalLine(
+        pos, GetTextBoxHeight(current_timer_info), draw_data.z, color,
+        PickingUserData(current_text_box, draw_data.tooltip_callback));
     // For lines, we can ignore the entire pixel into which this event
     // falls. We align this precisely on the pixel x-coordinate of the
     // current line being drawn (in ticks). If pixel_delta_in_ticks is
@@ -236,9 +220,7 @@ bool TimerTrack::DrawTimer(const TextBox* prev_text_box, const TextBox* next_tex
 
 void TimerTrack::UpdatePrimitives(Batcher* batcher, uint64_t min_tick, uint64_t max_tick,
                                   PickingMode /*picking_mode*/, float z_offset) {
-  UpdateBoxHeight();
-
-  visible_timer_count_ = 0;
+  int visible_timer_count = 0;
 
   internal::DrawData draw_data{};
   draw_data.min_tick = min_tick;
@@ -246,67 +228,61 @@ void TimerTrack::UpdatePrimitives(Batcher* batcher, uint64_t min_tick, uint64_t
   draw_data.z_offset = z_offset;
 
   draw_data.batcher = batcher;
-  draw_data.canvas = time_graph_->GetCanvas();
+  draw_data.tooltip_callback = batcher->AddTooltipCallback(
+      [this](const Batcher& batcher, PickingId id) { return GetBoxTooltip(batcher, id); });
+  draw_data.view = &time_graph_->GetPrimitivesView();
 
-  draw_data.world_start_x = draw_data.canvas->GetWorldTopLeftX();
-  draw_data.world_width = draw_data.canvas->GetWorldWidth();
-  draw_data.inv_time_window = 1.0 / time_graph_->GetTimeWindowUs();
+  draw_data.world_start_x = draw_data.view->world_start_x;
+  draw_data.world_width = draw_data.view->world_width;
+  draw_data.inv_time_window = 1.0 / draw_data.view->time_window_us;
   draw_data.is_collapsed = collapse_toggle_->IsCollapsed();
 
   draw_data.z = GlCanvas::kZValueBox + z_offset;
 
   std::vector<std::shared_ptr<TimerChain>> chains_by_depth = GetTimers();
   draw_data.selected_textbox = app_->selected_text_box();
+  draw_data.selected_thread_id = app_->selected_thread_id();
   draw_data.highlighted_function_id = app_->GetFunctionIdToHighlight();
 
   // We minimize overdraw when drawing lines for small events by discarding
   // events that would just draw over an already drawn line. When zoomed in
   // enough that all events are drawn as boxes, this has no effect. When zoomed
   // out, many events will be discarded quickly.
-  uint64_t time_window_ns = static_cast<uint64_t>(1000 * time_graph_->GetTimeWindowUs());
-  draw_data.pixel_delta_in_ticks = time_window_ns / draw_data.canvas->GetWidth();
-  draw_data.min_timegraph_tick = time_graph_->GetTickFromUs(time_graph_->GetMinTimeUs());
+  uint64_t time_window_ns = static_cast<uint64_t>(1000 * draw_data.view->time_window_us);
+  draw_data.pixel_delta_in_ticks = time_window_ns / draw_data.view->screen_width;
+  draw_data.min_timegraph_tick = draw_data.view->GetMinTick();
 
   for (auto& chain : chains_by_depth) {
     if (!chain) continue;
-    // In order to draw overlaps correctly, we need for every text box to be drawn (current),
-    // its previous and next text box. In order to avoid looking ahead for the next text (which is
-    // error-prone), we are doing just one traversal of the text boxes, while keeping track of the
-    // previous two timers, thus the currents iteration value being the "next" textbox.
-    // Note: This will require us to draw the last timer after the traversal of the text boxes.
-    // Also note: The draw method will take care of nullptr's being passed into (first iteration).
-    TextBox* prev_text_box = nullptr;
-    TextBox* current_text_box = nullptr;
-    TextBox* next_text_box = nullptr;
-
     // We have to reset this when we go to the next depth, as otherwise we
     // would miss drawing events that should be drawn.
     uint64_t min_ignore = std::numeric_limits<uint64_t>::max();
     uint64_t max_ignore = std::numeric_limits<uint64_t>::min();
-    for (TimerBlock& block : *chain) {
+    // All the timers in the blocks before the one we start from end before min_tick.
+    for (TimerChainIterator it = chain->FindFirstBlockEndingAtOrAfter(min_tick); it != chain->end();
+         ++it) {
+      TimerBlock& block = *it;
+      // If the timers are sorted by start, no following block intersects the range either.
+      if (chain->IsSortedByStart() && block.size() > 0 && block[0].Start() > max_tick) break;
       if (!block.Intersects(min_tick, max_tick)) continue;
 
-      for (size_t k = 0; k < block.size(); ++k) {
-        // The current index (k) points to the "next" text box and we want to draw the text box from
-        // the previous iteration ("current").
-        next_text_box = &block[k];
-
-        if (DrawTimer(prev_text_box, next_text_box, draw_data, current_text_box, &min_ignore,
-                      &max_ignore)) {
-          ++visible_timer_count_;
+      // Instead of visiting every timer of the block, we jump from one timer to the next one that
+      // ends after the start of the visible range and, if the chain is sorted by start, after the
+      // pixel column that was last drawn as a line. This makes the number of iterations depend on
+      // the number of drawn primitives, which is bounded by the number of pixel columns when
+      // zoomed out, rather than on the number of timers. In order to draw overlaps correctly,
+      // DrawTimer also needs the neighbors of the timer in the chain, even if those are not drawn
+      // themselves.
+      for (uint64_t k = block.FindFirstEndingAtOrAfter(0, min_tick); k < block.size();
+           k = block.FindNextTimerToDraw(k, min_tick, max_ignore)) {
+        if (DrawTimer(block.GetTimerBefore(k), block.GetTimerAfter(k), draw_data, &block[k],
+                      &min_ignore, &max_ignore)) {
+          ++visible_timer_count;
         }
-
-        prev_text_box = current_text_box;
-        current_text_box = next_text_box;
       }
     }
-    // We still need to draw the last timer.
-    next_text_box = nullptr;
-    if (DrawTimer(prev_text_box, next_text_box, draw_data, current_text_box, &min_ignore,
-                  &max_ignore)) {
-      ++visible_timer_count_;
-    }
   }
+  visible_timer_count_ = visible_timer_count;
 }
 
 void TimerTrack::OnTimer(const TimerInfo& timer_info) {
@@ -318,8 +294,7 @@ void TimerTrack::OnTimer(const TimerInfo& timer_info) {
     process_id_ = timer_info.process_id();
   }
 
-  TextBox text_box(Vec2(0, 0), Vec2(0, 0), "");
-  text_box.SetTimerInfo(timer_info);
+  TextBox text_box(timer_info);
 
   std::shared_ptr<TimerChain> timer_chain = timers_[timer_info.depth()];
   if (timer_chain == nullptr) {
@@ -358,37 +333,16 @@ std::vector<std::shared_ptr<TimerChain>> TimerTrack::GetTimers() const {
 const TextBox* TimerTrack::GetFirstAfterTime(uint64_t time, uint32_t depth) const {
   std::shared_ptr<TimerChain> chain = GetTimers(depth);
   if (chain == nullptr) return nullptr;
-
-  // TODO: do better than linear search...
-  for (TimerChainIterator it = chain->begin(); it != chain->end(); ++it) {
-    for (size_t k = 0; k < it->size(); ++k) {
-      const TextBox& text_box = (*it)[k];
-      if (text_box.GetTimerInfo().start() > time) {
-        return &text_box;
-      }
-    }
-  }
-  return nullptr;
+  return chain->FindFirstStartingAfter(time);
 }
 
 const TextBox* TimerTrack::GetFirstBeforeTime(uint64_t time, uint32_t depth) const {
   std::shared_ptr<TimerChain> chain = GetTimers(depth);
   if (chain == nullptr) return nullptr;
 
-  const TextBox* text_box = nullptr;
-
-  // TODO: do better than linear search...
-  for (TimerChainIterator it = chain->begin(); it != chain->end(); ++it) {
-    for (size_t k = 0; k < it->size(); ++k) {
-      const TextBox& box = (*it)[k];
-      if (box.GetTimerInfo().start() > time) {
-        return text_box;
-      }
-      text_box = &box;
-    }
-  }
-
-  return nullptr;
+  const TextBox* first_after_time = chain->FindFirstStartingAfter(time);
+  if (first_after_time == nullptr) return nullptr;
+  return chain->GetElementBefore(first_after_time);
 }
 
 std::shared_ptr<TimerChain> TimerTrack::GetTimers(uint32_t depth) const {
@@ -399,13 +353,11 @@ std::shared_ptr<TimerChain> TimerTrack::GetTimers(uint32_t depth) const {
 }
 
 const TextBox* TimerTrack::GetUp(const TextBox* text_box) const {
-  const TimerInfo& timer_info = text_box->GetTimerInfo();
-  return GetFirstBeforeTime(timer_info.start(), timer_info.depth() - 1);
+  return GetFirstBeforeTime(text_box->Start(), text_box->GetDepth() - 1);
 }
 
 const TextBox* TimerTrack::GetDown(const TextBox* text_box) const {
-  const TimerInfo& timer_info = text_box->GetTimerInfo();
-  return GetFirstAfterTime(timer_info.start(), timer_info.depth() + 1);
+  return GetFirstAfterTime(text_box->Start(), text_box->GetDepth() + 1);
 }
 
 std::vector<std::shared_ptr<TimerChain>> TimerTrack::GetAllChains() const {
@@ -13,6 +13,7 @@
 #include <string>
 #include <vector>
 
+#include "Batcher.h"
 #include "BlockChain.h"
 #include "CallstackThreadBar.h"
 #include "CoreMath.h"
@@ -28,6 +29,7 @@
 
 class OrbitApp;
 class TextRenderer;
+struct TimeGraphView;
 
 namespace internal {
 struct DrawData {
@@ -37,9 +39,11 @@ struct DrawData {
   uint64_t pixel_delta_in_ticks;
   uint64_t min_timegraph_tick;
   Batcher* batcher;
-  GlCanvas* canvas;
+  const TooltipCallback* tooltip_callback;
+  const TimeGraphView* view;
   const TextBox* selected_textbox;
   double inv_time_window;
+  int32_t selected_thread_id;
   float world_start_x;
   float world_width;
   float z_offset;
@@ -55,18 +59,18 @@ class TimerTrack : public Track {
   ~TimerTrack() override = default;
 
   // Pickable
-  void Draw(GlCanvas* canvas, PickingMode picking_mode, float z_offset = 0) override;
   virtual void OnTimer(const orbit_client_protos::TimerInfo& timer_info);
   [[nodiscard]] std::string GetTooltip() const override;
 
   // Track
   void UpdatePrimitives(Batcher* batcher, uint64_t min_tick, uint64_t max_tick,
                         PickingMode /*picking_mode*/, float z_offset = 0) override;
+  void UpdateLayout() override;
   [[nodiscard]] Type GetType() const override { return kTimerTrack; }
 
   [[nodiscard]] std::vector<std::shared_ptr<TimerChain>> GetTimers() const override;
   [[nodiscard]] uint32_t GetDepth() const { return depth_; }
-  [[nodiscard]] std::string GetExtraInfo(const orbit_client_protos::TimerInfo& timer);
+  [[nodiscard]] std::string GetExtraInfo(const orbit_client_protos::TimerInfo& timer) const;
 
   [[nodiscard]] const TextBox* GetFirstAfterTime(uint64_t time, uint32_t depth) const;
   [[nodiscard]] const TextBox* GetFirstBeforeTime(uint64_t time, uint32_t depth) const;
@@ -95,12 +99,13 @@ class TimerTrack : public Track {
   [[nodiscard]] int GetVisiblePrimitiveCount() const override { return visible_timer_count_; }
 
  protected:
-  [[nodiscard]] virtual bool IsTimerActive(
-      const orbit_client_protos::TimerInfo& /*timer_info*/) const {
+  [[nodiscard]] virtual bool IsTimerActive(const orbit_client_protos::TimerInfo& /*timer_info*/,
+                                           const internal::DrawData& /*draw_data*/) const {
     return true;
   }
   [[nodiscard]] virtual Color GetTimerColor(const orbit_client_protos::TimerInfo& timer_info,
-                                            bool is_selected, bool is_highlighted) const = 0;
+                                            bool is_selected, bool is_highlighted,
+                                            const internal::DrawData& draw_data) const = 0;
   [[nodiscard]] virtual bool TimerFilter(
       const orbit_client_protos::TimerInfo& /*timer_info*/) const {
     return true;
@@ -111,18 +116,22 @@ class TimerTrack : public Track {
                                uint64_t* min_ignore, uint64_t* max_ignore);
 
   void UpdateDepth(uint32_t depth) {
-    if (depth > depth_) depth_ = depth;
+    uint32_t current_depth = depth_;
+    while (depth > current_depth && !depth_.compare_exchange_weak(current_depth, depth)) {
+    }
   }
   [[nodiscard]] std::shared_ptr<TimerChain> GetTimers(uint32_t depth) const;
 
+  // Draws the text of a timer whose box is drawn at `box_pos` with size `box_size`.
   virtual void SetTimesliceText(const orbit_client_protos::TimerInfo& /*timer*/,
                                 double /*elapsed_us*/, float /*min_x*/, float /*z_offset*/,
-                                TextBox* /*text_box*/) {}
-  TextRenderer* text_renderer_ = nullptr;
-  uint32_t depth_ = 0;
+                                const Vec2& /*box_pos*/, const Vec2& /*box_size*/) {}
+  // Also raised while the primitives are updated, off the UI thread.
+  std::atomic<uint32_t> depth_ = 0;
   mutable absl::Mutex mutex_;
   std::map<int, std::shared_ptr<TimerChain>> timers_;
-  int visible_timer_count_ = 0;
+  // Written when the primitives are updated, off the UI thread.
+  std::atomic<int> visible_timer_count_ = 0;
 
   [[nodiscard]] virtual std::string GetBoxTooltip(const Batcher& batcher, PickingId id) const;
   float GetHeight() const override;
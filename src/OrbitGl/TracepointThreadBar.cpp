@@ -62,6 +62,7 @@ void TracepointThreadBar::UpdatePrimitives(Batcher* batcher, uint64_t min_tick,
   const Color kGrey(128, 128, 128, 255);
 
   CHECK(capture_data_ != nullptr);
+  const TimeGraphView& view = time_graph_->GetPrimitivesView();
 
   if (!picking) {
     capture_data_->ForEachTracepointEventOfThreadInTimeRange(
@@ -69,7 +70,7 @@ void TracepointThreadBar::UpdatePrimitives(Batcher* batcher, uint64_t min_tick,
         [&](const orbit_client_protos::TracepointEventInfo& tracepoint) {
           uint64_t time = tracepoint.time();
           float radius = track_height / 4;
-          Vec2 pos(time_graph_->GetWorldFromTick(time), pos_[1]);
+          Vec2 pos(view.GetWorldFromTick(time), pos_[1]);
           if (thread_id_ == orbit_base::kAllThreadsOfAllProcessesTid) {
             const Color color = tracepoint.pid() == capture_data_->process_id() ? kGrey : kWhite;
             batcher->AddVerticalLine(pos, -track_height, z, color);
@@ -85,35 +86,39 @@ void TracepointThreadBar::UpdatePrimitives(Batcher* batcher, uint64_t min_tick,
   } else {
     constexpr float kPickingBoxWidth = 9.0f;
     constexpr float kPickingBoxOffset = kPickingBoxWidth / 2.0f;
+    const TooltipCallback* tooltip_callback =
+        batcher->AddTooltipCallback([this](const Batcher& batcher, PickingId id) {
+          return GetTracepointTooltip(batcher, id);
+        });
 
+    picked_tracepoint_events_.clear();
     capture_data_->ForEachTracepointEventOfThreadInTimeRange(
         thread_id_, min_tick, max_tick,
         [&](const orbit_client_protos::TracepointEventInfo& tracepoint) {
           uint64_t time = tracepoint.time();
-          Vec2 pos(time_graph_->GetWorldFromTick(time) - kPickingBoxOffset,
-                   pos_[1] - track_height + 1);
+          Vec2 pos(view.GetWorldFromTick(time) - kPickingBoxOffset, pos_[1] - track_height + 1);
           Vec2 size(kPickingBoxWidth, track_height);
-          auto user_data =
-              std::make_unique<PickingUserData>(nullptr, [&, batcher](PickingId id) -> std::string {
-                return GetTracepointTooltip(batcher, id);
-              });
-          user_data->custom_data_ = &tracepoint;
-          batcher->AddShadedBox(pos, size, z, kWhite, std::move(user_data));
+          batcher->AddShadedBox(
+              pos, size, z, kWhite,
+              PickingUserData(nullptr, tooltip_callback, picked_tracepoint_events_.size()));
+          picked_tracepoint_events_.push_back(tracepoint);
         });
   }
 }
 
-std::string TracepointThreadBar::GetTracepointTooltip(Batcher* batcher, PickingId id) const {
-  auto user_data = batcher->GetUserData(id);
-  CHECK(user_data && user_data->custom_data_);
+std::string TracepointThreadBar::GetTracepointTooltip(const Batcher& batcher,
+                                                      PickingId id) const {
+  const PickingUserData* user_data = batcher.GetUserData(id);
+  CHECK(user_data != nullptr);
 
-  const auto* tracepoint_event_info =
-      static_cast<const orbit_client_protos::TracepointEventInfo*>(user_data->custom_data_);
+  // Events of several threads can have the same time, so the picked event is looked up by index.
+  CHECK(capture_data_ != nullptr);
+  CHECK(user_data->custom_id_ < picked_tracepoint_events_.size());
+  const orbit_client_protos::TracepointEventInfo* tracepoint_event_info =
+      &picked_tracepoint_events_[user_data->custom_id_];
 
   uint64_t tracepoint_info_key = tracepoint_event_info->tracepoint_info_key();
 
-  CHECK(capture_data_ != nullptr);
-
   TracepointInfo tracepoint_info = capture_data_->GetTracepointInfo(tracepoint_info_key);
 
   if (thread_id_ == orbit_base::kAllThreadsOfAllProcessesTid) {
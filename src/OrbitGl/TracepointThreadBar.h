@@ -8,8 +8,10 @@
 #include <stdint.h>
 
 #include <string>
+#include <vector>
 
 #include "ThreadBar.h"
+#include "capture_data.pb.h"
 
 namespace orbit_gl {
 
@@ -29,9 +31,13 @@ class TracepointThreadBar : public ThreadBar {
   void SetColor(const Color& color) { color_ = color; }
 
  private:
-  std::string GetTracepointTooltip(Batcher* batcher, PickingId id) const;
+  std::string GetTracepointTooltip(const Batcher& batcher, PickingId id) const;
 
   Color color_;
+  // The events with a picking box in the last picking frame, in the order in which their boxes
+  // were added: the custom id of the PickingUserData of a box is the index of its event. Only
+  // updated when picking, which doesn't run concurrently with tooltips or other updates.
+  std::vector<orbit_client_protos::TracepointEventInfo> picked_tracepoint_events_;
 };
 
 }  // namespace orbit_gl
@@ -152,13 +152,6 @@ void Track::Draw(GlCanvas* canvas, PickingMode picking_mode, float z_offset) {
                     track_z);
   }
 
-  // Collapse toggle state management.
-  if (!this->IsCollapsible()) {
-    collapse_toggle_->SetState(TriangleToggle::State::kInactive);
-  } else if (collapse_toggle_->IsInactive()) {
-    collapse_toggle_->ResetToInitialState();
-  }
-
   // Draw collapsing triangle.
   float button_offset = layout_->GetCollapseButtonOffset();
   float toggle_y_pos = pos_[1] + half_label_height;
@@ -185,6 +178,19 @@ void Track::Draw(GlCanvas* canvas, PickingMode picking_mode, float z_offset) {
 void Track::UpdatePrimitives(Batcher* /*batcher*/, uint64_t /*t_min*/, uint64_t /*t_max*/,
                              PickingMode /*  picking_mode*/, float /*z_offset*/) {}
 
+void Track::UpdateLayout() {
+  // Collapse toggle state management.
+  if (!this->IsCollapsible()) {
+    collapse_toggle_->SetState(TriangleToggle::State::kInactive);
+  } else if (collapse_toggle_->IsInactive()) {
+    collapse_toggle_->ResetToInitialState();
+  }
+
+  const GlCanvas* canvas = time_graph_->GetCanvas();
+  SetPos(canvas->GetWorldTopLeftX(), pos_[1]);
+  SetSize(canvas->GetWorldWidth(), GetHeight());
+}
+
 void Track::SetPinned(bool value) { pinned_ = value; }
 
 Color Track::GetBackgroundColor() const {
@@ -47,6 +47,9 @@ class Track : public orbit_gl::CaptureViewElement, public std::enable_shared_fro
 
   void UpdatePrimitives(Batcher* batcher, uint64_t min_tick, uint64_t max_tick,
                         PickingMode picking_mode, float z_offset = 0) override;
+  // Updates the extents of the track and of what it contains, once its vertical position is set.
+  // Called on the UI thread while no primitives are updated, as the primitives depend on them.
+  virtual void UpdateLayout();
   void OnDrag(int x, int y) override;
 
   [[nodiscard]] virtual Type GetType() const = 0;
@@ -10,12 +10,15 @@
 #include <absl/strings/match.h>
 #include <absl/strings/str_format.h>
 #include <absl/strings/str_split.h>
+#include <absl/synchronization/mutex.h>
 #include <stdlib.h>
 
 #include <algorithm>
+#include <atomic>
 #include <cstdint>
 #include <optional>
 #include <string_view>
+#include <thread>
 #include <tuple>
 #include <type_traits>
 #include <utility>
@@ -24,7 +27,9 @@
 #include "CoreMath.h"
 #include "CoreUtils.h"
 #include "GlCanvas.h"
+#include "OrbitBase/Action.h"
 #include "OrbitBase/ThreadConstants.h"
+#include "OrbitBase/ThreadPool.h"
 #include "OrbitClientData/CallstackData.h"
 #include "OrbitClientModel/CaptureData.h"
 #include "TimeGraph.h"
@@ -32,6 +37,24 @@
 
 using orbit_client_protos::FunctionInfo;
 
+namespace {
+
+struct ParallelTrackUpdateState {
+  explicit ParallelTrackUpdateState(size_t count) : track_count{count} {}
+
+  const size_t track_count;
+  std::atomic<size_t> next_index = 0;
+  absl::Mutex mutex;
+  size_t completed_count ABSL_GUARDED_BY(mutex) = 0;
+};
+
+bool AllTracksCompleted(ParallelTrackUpdateState* state)
+    ABSL_EXCLUSIVE_LOCKS_REQUIRED(state->mutex) {
+  return state->completed_count == state->track_count;
+}
+
+}  // namespace
+
 TrackManager::TrackManager(TimeGraph* time_graph, TimeGraphLayout* layout, OrbitApp* app,
                            const CaptureData* capture_data)
     : time_graph_(time_graph), layout_(layout), capture_data_{capture_data}, app_{app} {
@@ -55,6 +78,11 @@ std::vector<ThreadTrack*> TrackManager::GetThreadTracks() const {
   return tracks;
 }
 
+std::vector<Track*> TrackManager::GetVisibleTracks() const {
+  std::lock_guard<std::recursive_mutex> lock(mutex_);
+  return visible_tracks_;
+}
+
 std::vector<FrameTrack*> TrackManager::GetFrameTracks() const {
   std::lock_guard<std::recursive_mutex> lock(mutex_);
   std::vector<FrameTrack*> tracks;
@@ -107,8 +135,8 @@ void TrackManager::SortTracks() {
     }
 
     // Thread tracks.
-    std::vector<ThreadTrack*> sorted_thread_tracks = GetSortedThreadTracks();
-    for (ThreadTrack* thread_track : sorted_thread_tracks) {
+    SortThreadTracks();
+    for (ThreadTrack* thread_track : sorted_thread_tracks_) {
       if (!thread_track->IsEmpty()) {
         all_processes_sorted_tracks.push_back(thread_track);
       }
@@ -127,73 +155,112 @@ void TrackManager::SortTracks() {
       }
     }
 
-    // Clear before repopulating.
-    sorted_tracks_.clear();
+    std::vector<Track*> sorted_tracks;
 
     // Scheduler track.
     if (!scheduler_track_->IsEmpty()) {
-      sorted_tracks_.push_back(scheduler_track_.get());
+      sorted_tracks.push_back(scheduler_track_.get());
     }
 
     // For now, "external_pid_tracks" should only contain
     // introspection tracks. Display them on top.
-    Append(sorted_tracks_, external_pid_tracks);
-    Append(sorted_tracks_, capture_pid_tracks);
+    Append(sorted_tracks, external_pid_tracks);
+    Append(sorted_tracks, capture_pid_tracks);
 
     last_thread_reorder_.Restart();
 
-    UpdateFilteredTrackList();
+    // The visible tracks only need to be filtered again if the tracks or their labels changed.
+    bool labels_changed = false;
+    for (const Track* track : sorted_tracks) {
+      labels_changed |= UpdateLowerCaseLabel(track);
+    }
+    if (sorted_tracks != sorted_tracks_ || labels_changed) {
+      sorted_tracks_ = std::move(sorted_tracks);
+      UpdateFilteredTrackList();
+    }
   }
   sorting_invalidated_ = false;
 }
 
 void TrackManager::SetFilter(const std::string& filter) {
-  filter_ = absl::AsciiStrToLower(filter);
-  UpdateFilteredTrackList();
+  std::lock_guard<std::recursive_mutex> lock(mutex_);
+  std::string lower_case_filter = absl::AsciiStrToLower(filter);
+  if (lower_case_filter == filter_) return;
+
+  std::vector<std::string> filter_tokens =
+      absl::StrSplit(lower_case_filter, ' ', absl::SkipWhitespace());
+  // A track matches the filter if its label contains any of the tokens. If each new token contains
+  // the previous token at the same position, as when typing, the tracks that didn't match the
+  // previous filter can't match the new one, so only the visible tracks need to be filtered.
+  bool is_refinement = filter_tokens_.empty() || filter_tokens.size() == filter_tokens_.size();
+  for (size_t i = 0; is_refinement && i < filter_tokens_.size(); ++i) {
+    is_refinement = absl::StrContains(filter_tokens[i], filter_tokens_[i]);
+  }
+
+  filter_ = std::move(lower_case_filter);
+  filter_tokens_ = std::move(filter_tokens);
+  if (is_refinement) {
+    visible_tracks_ = GetTracksMatchingFilter(visible_tracks_);
+  } else {
+    UpdateFilteredTrackList();
+  }
 }
 
 void TrackManager::UpdateFilteredTrackList() {
-  if (filter_.empty()) {
-    visible_tracks_ = sorted_tracks_;
-    return;
-  }
+  visible_tracks_ = GetTracksMatchingFilter(sorted_tracks_);
+}
 
-  visible_tracks_.clear();
-  std::vector<std::string> filters = absl::StrSplit(filter_, ' ', absl::SkipWhitespace());
-  for (const auto& track : sorted_tracks_) {
-    std::string lower_case_label = absl::AsciiStrToLower(track->GetLabel());
-    for (auto& filter : filters) {
-      if (absl::StrContains(lower_case_label, filter)) {
-        visible_tracks_.push_back(track);
+std::vector<Track*> TrackManager::GetTracksMatchingFilter(const std::vector<Track*>& tracks) {
+  if (filter_tokens_.empty()) return tracks;
+
+  std::vector<Track*> matching_tracks;
+  for (Track* track : tracks) {
+    UpdateLowerCaseLabel(track);
+    const std::string& lower_case_label = lower_case_labels_.at(track).lower_case_label;
+    for (const std::string& filter_token : filter_tokens_) {
+      if (absl::StrContains(lower_case_label, filter_token)) {
+        matching_tracks.push_back(track);
         break;
       }
     }
   }
+  return matching_tracks;
+}
+
+bool TrackManager::UpdateLowerCaseLabel(const Track* track) {
+  const std::string& label = track->GetLabel();
+  auto it = lower_case_labels_.find(track);
+  if (it != lower_case_labels_.end() && it->second.label == label) return false;
+  lower_case_labels_.insert_or_assign(track, LowerCaseLabel{label, absl::AsciiStrToLower(label)});
+  return true;
 }
 
-std::vector<ThreadTrack*> TrackManager::GetSortedThreadTracks() {
-  std::vector<ThreadTrack*> sorted_tracks;
-  absl::flat_hash_map<ThreadTrack*, uint32_t> num_events_by_track;
+void TrackManager::SortThreadTracks() {
   const CallstackData* callstack_data = capture_data_ ? capture_data_->GetCallstackData() : nullptr;
 
-  for (auto& [tid, track] : thread_tracks_) {
-    if (tid == orbit_base::kAllProcessThreadsTid) {
-      continue;  // "kAllProcessThreadsTid" is handled separately.
-    }
-    sorted_tracks.push_back(track.get());
-    uint32_t num_events = callstack_data ? callstack_data->GetCallstackEventsOfTidCount(tid) : 0;
-    num_events_by_track[track.get()] = num_events;
+  // The counts are read once per track, as they keep growing while capturing. Both are maintained
+  // as the events arrive, by the tracks and by CallstackData, so reading them is cheap.
+  using SortKey = std::tuple<uint32_t, uint32_t>;
+  std::vector<std::pair<SortKey, ThreadTrack*>> keys_and_tracks;
+  keys_and_tracks.reserve(sorted_thread_tracks_.size());
+  for (ThreadTrack* track : sorted_thread_tracks_) {
+    uint32_t num_events =
+        callstack_data ? callstack_data->GetCallstackEventsOfTidCount(track->GetThreadId()) : 0;
+    keys_and_tracks.emplace_back(SortKey{track->GetNumTimers(), num_events}, track);
   }
 
   // Tracks with instrumented timers appear first, ordered by descending order of timers.
   // The remaining tracks appear after, ordered by descending order of callstack events.
-  std::sort(sorted_tracks.begin(), sorted_tracks.end(),
-            [&num_events_by_track](ThreadTrack* a, ThreadTrack* b) {
-              return std::make_tuple(a->GetNumTimers(), num_events_by_track[a]) >
-                     std::make_tuple(b->GetNumTimers(), num_events_by_track[b]);
-            });
-
-  return sorted_tracks;
+  // Tracks with the same counts keep their relative order, so that they don't swap places.
+  auto by_descending_key = [](const std::pair<SortKey, ThreadTrack*>& a,
+                              const std::pair<SortKey, ThreadTrack*>& b) {
+    return a.first > b.first;
+  };
+  if (std::is_sorted(keys_and_tracks.begin(), keys_and_tracks.end(), by_descending_key)) return;
+  std::stable_sort(keys_and_tracks.begin(), keys_and_tracks.end(), by_descending_key);
+  for (size_t i = 0; i < keys_and_tracks.size(); ++i) {
+    sorted_thread_tracks_[i] = keys_and_tracks[i].second;
+  }
 }
 
 void TrackManager::UpdateMovingTrackSorting() {
@@ -206,6 +273,7 @@ void TrackManager::UpdateMovingTrackSorting() {
   // Note: We do an O(n) search for the correct position in the sorted_tracks_ array which
   // could be optimized, but this is not worth the effort for the limited number of tracks.
 
+  std::lock_guard<std::recursive_mutex> lock(mutex_);
   int moving_track_previous_position = FindMovingTrackIndex();
 
   if (moving_track_previous_position != -1) {
@@ -259,14 +327,19 @@ int TrackManager::FindMovingTrackIndex() {
   return -1;
 }
 
-void TrackManager::UpdateTracks(Batcher* batcher, uint64_t min_tick, uint64_t max_tick,
-                                PickingMode picking_mode) {
+TrackManager::TracksAndZOffsets TrackManager::LayOutTracks() {
+  SortTracks();
+  UpdateMovingTrackSorting();
+
+  const std::vector<Track*> visible_tracks = GetVisibleTracks();
+  TracksAndZOffsets tracks_and_z_offsets;
+  tracks_and_z_offsets.reserve(visible_tracks.size());
   // Make sure track tab fits in the viewport.
   float current_y = -layout_->GetSchedulerTrackOffset() - layout_->GetTrackTabHeight();
   float pinned_tracks_height = 0.f;
 
-  // Draw pinned tracks
-  for (auto& track : visible_tracks_) {
+  // Lay out pinned tracks
+  for (auto& track : visible_tracks) {
     if (!track->IsPinned()) {
       continue;
     }
@@ -277,14 +350,15 @@ void TrackManager::UpdateTracks(Batcher* batcher, uint64_t min_tick, uint64_t ma
                                             layout_->GetTopMargin() -
                                             layout_->GetSchedulerTrackOffset());
     }
-    track->UpdatePrimitives(batcher, min_tick, max_tick, picking_mode, z_offset);
+    track->UpdateLayout();
+    tracks_and_z_offsets.emplace_back(track->shared_from_this(), z_offset);
     const float height = (track->GetHeight() + layout_->GetSpaceBetweenTracks());
     current_y -= height;
     pinned_tracks_height += height;
   }
 
-  // Draw unpinned tracks
-  for (auto& track : visible_tracks_) {
+  // Lay out unpinned tracks
+  for (auto& track : visible_tracks) {
     if (track->IsPinned()) {
       continue;
     }
@@ -293,12 +367,70 @@ void TrackManager::UpdateTracks(Batcher* batcher, uint64_t min_tick, uint64_t ma
     if (!track->IsMoving()) {
       track->SetPos(track->GetPos()[0], current_y);
     }
-    track->UpdatePrimitives(batcher, min_tick, max_tick, picking_mode, z_offset);
+    track->UpdateLayout();
+    tracks_and_z_offsets.emplace_back(track->shared_from_this(), z_offset);
     current_y -= (track->GetHeight() + layout_->GetSpaceBetweenTracks());
   }
 
   // Tracks are drawn from 0 (top) to negative y-coordinates.
   tracks_total_height_ = std::abs(current_y);
+  return tracks_and_z_offsets;
+}
+
+// Tracks are taken from a shared counter by the calling thread, which adds their primitives to
+// `batcher`, and by up to one worker of the thread pool of the app per hardware thread, each adding
+// them to its own Batcher, which is then merged into `batcher`. As the calling thread takes part,
+// this also returns when no worker of a busy pool gets to run: workers that start late find no
+// track left and don't touch their Batcher.
+void TrackManager::UpdateTrackPrimitives(Batcher* batcher,
+                                         const TracksAndZOffsets& tracks_and_z_offsets,
+                                         uint64_t min_tick, uint64_t max_tick,
+                                         PickingMode picking_mode,
+                                         const std::function<bool()>& is_canceled) {
+  if (tracks_and_z_offsets.empty()) return;
+  auto state = std::make_shared<ParallelTrackUpdateState>(tracks_and_z_offsets.size());
+  auto update_tracks = [state, &tracks_and_z_offsets, min_tick, max_tick, picking_mode,
+                        &is_canceled](Batcher* track_batcher) {
+    size_t completed_count = 0;
+    for (size_t index = state->next_index++; index < state->track_count;
+         index = state->next_index++) {
+      // The remaining tracks still have to be completed, but are not updated once canceled.
+      if (!is_canceled()) {
+        const auto& [track, z_offset] = tracks_and_z_offsets[index];
+        track->UpdatePrimitives(track_batcher, min_tick, max_tick, picking_mode, z_offset);
+      }
+      ++completed_count;
+    }
+    if (completed_count == 0) return;
+    absl::MutexLock lock(&state->mutex);
+    state->completed_count += completed_count;
+  };
+
+  ThreadPool* thread_pool = app_ != nullptr ? app_->GetThreadPool() : nullptr;
+  size_t worker_count = 0;
+  if (thread_pool != nullptr) {
+    const size_t hardware_thread_count = std::max(std::thread::hardware_concurrency(), 1u);
+    worker_count = std::min(tracks_and_z_offsets.size(), hardware_thread_count) - 1;
+  }
+  while (worker_batchers_.size() < worker_count) {
+    worker_batchers_.push_back(
+        std::make_unique<Batcher>(batcher->GetBatcherId(), batcher->GetPickingManager()));
+  }
+  for (size_t i = 0; i < worker_count; ++i) {
+    Batcher* worker_batcher = worker_batchers_[i].get();
+    worker_batcher->SetPickingManager(batcher->GetPickingManager());
+    thread_pool->Schedule(
+        CreateAction([update_tracks, worker_batcher] { update_tracks(worker_batcher); }));
+  }
+  update_tracks(batcher);
+
+  {
+    absl::MutexLock lock(&state->mutex);
+    state->mutex.Await(absl::Condition(AllTracksCompleted, state.get()));
+  }
+  for (size_t i = 0; i < worker_count; ++i) {
+    batcher->MergeFrom(worker_batchers_[i].get());
+  }
 }
 
 void TrackManager::AddTrack(const std::shared_ptr<Track>& track) {
@@ -308,7 +440,11 @@ void TrackManager::AddTrack(const std::shared_ptr<Track>& track) {
 
 void TrackManager::RemoveFrameTrack(uint64_t function_id) {
   std::lock_guard<std::recursive_mutex> lock(mutex_);
-  frame_tracks_.erase(function_id);
+  auto track_it = frame_tracks_.find(function_id);
+  if (track_it != frame_tracks_.end()) {
+    lower_case_labels_.erase(track_it->second.get());
+    frame_tracks_.erase(track_it);
+  }
   sorting_invalidated_ = true;
   // We need to do SortTracks again to have visible_tracks_ updated
   SortTracks();
@@ -332,6 +468,10 @@ ThreadTrack* TrackManager::GetOrCreateThreadTrack(int32_t tid) {
     track = std::make_shared<ThreadTrack>(time_graph_, layout_, tid, app_, capture_data_);
     AddTrack(track);
     thread_tracks_[tid] = track;
+    // "kAllProcessThreadsTid" is handled separately.
+    if (tid != orbit_base::kAllProcessThreadsTid) {
+      sorted_thread_tracks_.push_back(track.get());
+    }
   }
   return track.get();
 }
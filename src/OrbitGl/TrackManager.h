@@ -5,17 +5,21 @@
 #ifndef ORBIT_GL_TRACK_MANAGER_H_
 #define ORBIT_GL_TRACK_MANAGER_H_
 
+#include <absl/container/flat_hash_map.h>
 #include <stdint.h>
 #include <stdlib.h>
 
+#include <functional>
 #include <map>
 #include <memory>
 #include <mutex>
 #include <string>
 #include <unordered_map>
+#include <utility>
 #include <vector>
 
 #include "AsyncTrack.h"
+#include "Batcher.h"
 #include "FrameTrack.h"
 #include "GpuTrack.h"
 #include "GraphTrack.h"
@@ -34,11 +38,15 @@ class Timegraph;
 // and sorting).
 class TrackManager {
  public:
+  // Visible tracks, in the order they are laid out, with the z-offsets their primitives are updated
+  // with. The tracks are owned, so that the ones removed in the meantime can still be updated.
+  using TracksAndZOffsets = std::vector<std::pair<std::shared_ptr<Track>, float>>;
+
   explicit TrackManager(TimeGraph* time_graph, TimeGraphLayout* layout, OrbitApp* app,
                         const CaptureData* capture_data);
 
   [[nodiscard]] std::vector<Track*> GetAllTracks() const;
-  [[nodiscard]] std::vector<Track*> GetVisibleTracks() const { return visible_tracks_; }
+  [[nodiscard]] std::vector<Track*> GetVisibleTracks() const;
   [[nodiscard]] std::vector<ThreadTrack*> GetThreadTracks() const;
   [[nodiscard]] std::vector<FrameTrack*> GetFrameTracks() const;
 
@@ -49,8 +57,14 @@ class TrackManager {
   void SortTracks();
   void SetFilter(const std::string& filter);
 
-  void UpdateTracks(Batcher* batcher, uint64_t min_tick, uint64_t max_tick,
-                    PickingMode picking_mode);
+  // Sorts and lays out the visible tracks. Called on the UI thread while no primitives are updated,
+  // as the primitives are computed from the layout.
+  [[nodiscard]] TracksAndZOffsets LayOutTracks();
+  // Updates the primitives of tracks that have been laid out, in parallel on the thread pool of the
+  // app, returning early if `is_canceled` returns true. Only one update runs at once.
+  void UpdateTrackPrimitives(Batcher* batcher, const TracksAndZOffsets& tracks_and_z_offsets,
+                             uint64_t min_tick, uint64_t max_tick, PickingMode picking_mode,
+                             const std::function<bool()>& is_canceled = [] { return false; });
   [[nodiscard]] float GetTracksTotalHeight() const { return tracks_total_height_; }
 
   SchedulerTrack* GetOrCreateSchedulerTrack();
@@ -68,8 +82,11 @@ class TrackManager {
 
  private:
   void UpdateFilteredTrackList();
+  [[nodiscard]] std::vector<Track*> GetTracksMatchingFilter(const std::vector<Track*>& tracks);
+  // Returns whether the label of `track` changed since its lower case label was cached.
+  bool UpdateLowerCaseLabel(const Track* track);
   [[nodiscard]] int FindMovingTrackIndex();
-  [[nodiscard]] std::vector<ThreadTrack*> GetSortedThreadTracks();
+  void SortThreadTracks();
 
   mutable std::recursive_mutex mutex_;
 
@@ -94,9 +111,27 @@ class TrackManager {
   bool sorting_invalidated_ = false;
   Timer last_thread_reorder_;
 
+  // All thread tracks except the process track, in the order of the last sort. Sorting again while
+  // capturing mostly finds them still in order, as the counts they are sorted by only grow.
+  std::vector<ThreadTrack*> sorted_thread_tracks_;
+
   std::string filter_;
+  std::vector<std::string> filter_tokens_;
+  // Only updated when the tracks or the filter change.
   std::vector<Track*> visible_tracks_;
 
+  // The lower case labels of the sorted tracks the filter is matched against, together with the
+  // label they were computed from, as a few tracks change their label while capturing.
+  struct LowerCaseLabel {
+    std::string label;
+    std::string lower_case_label;
+  };
+  absl::flat_hash_map<const Track*, LowerCaseLabel> lower_case_labels_;
+
+  // The Batchers the workers of the thread pool add the primitives of the tracks to, before they
+  // are merged into the Batcher passed to UpdateTrackPrimitives.
+  std::vector<std::unique_ptr<Batcher>> worker_batchers_;
+
   float tracks_total_height_ = 0.0f;
   const CaptureData* capture_data_ = nullptr;
 
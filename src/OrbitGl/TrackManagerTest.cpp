@@ -0,0 +1,180 @@
+// Copyright (c) 2021 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <absl/strings/ascii.h>
+#include <absl/strings/match.h>
+#include <absl/strings/str_split.h>
+#include <gtest/gtest.h>
+#include <stdint.h>
+
+#include <filesystem>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "App.h"
+#include "CodeReport.h"
+#include "GlCanvas.h"
+#include "MainWindowInterface.h"
+#include "OrbitClientData/ModuleManager.h"
+#include "OrbitClientData/ProcessData.h"
+#include "OrbitClientModel/CaptureData.h"
+#include "TextRenderer.h"
+#include "ThreadTrack.h"
+#include "TimeGraph.h"
+#include "Track.h"
+#include "TrackManager.h"
+#include "capture_data.pb.h"
+#include "process.pb.h"
+
+using orbit_client_protos::TimerInfo;
+
+namespace {
+
+constexpr int32_t kPid = 42;
+
+class NoOpMainWindow : public orbit_gl::MainWindowInterface {
+ public:
+  void ShowTooltip(std::string_view /*message*/) override {}
+  void ShowSourceCode(const std::filesystem::path& /*file_path*/, size_t /*line_number*/,
+                      std::optional<std::unique_ptr<CodeReport>> /*code_report*/) override {}
+};
+
+// The tracks of a TimeGraph that is never rendered, of a capture of process kPid.
+class TrackManagerTest : public testing::Test {
+ protected:
+  TrackManagerTest()
+      : app_{&main_window_, /*main_thread_executor=*/nullptr, /*crash_handler=*/nullptr} {
+    orbit_grpc_protos::ProcessInfo process_info;
+    process_info.set_pid(kPid);
+    process_info.set_name("test_process");
+    app_.SetCaptureData(CaptureData{ProcessData{process_info}, &module_manager_, {}, {}, {}});
+    time_graph_ =
+        std::make_unique<TimeGraph>(&app_, &text_renderer_, &canvas_, &app_.GetCaptureData());
+  }
+
+  [[nodiscard]] TrackManager* track_manager() { return time_graph_->GetTrackManager(); }
+
+  // Adds `num_timers` timers to the thread track of `tid`, creating the track with the label
+  // "<thread_name> [<tid>]" if it doesn't exist yet.
+  ThreadTrack* AddTimers(int32_t tid, const std::string& thread_name, int num_timers) {
+    app_.GetMutableCaptureData().AddOrAssignThreadName(tid, thread_name);
+    for (int i = 0; i < num_timers; ++i) {
+      TimerInfo timer;
+      timer.set_start(next_timestamp_ns_);
+      timer.set_end(next_timestamp_ns_ + 5);
+      next_timestamp_ns_ += 10;
+      timer.set_process_id(kPid);
+      timer.set_thread_id(tid);
+      timer.set_type(TimerInfo::kNone);
+      time_graph_->ProcessTimer(timer, nullptr);
+    }
+    return track_manager()->GetOrCreateThreadTrack(tid);
+  }
+
+ private:
+  orbit_client_data::ModuleManager module_manager_;
+  NoOpMainWindow main_window_;
+  OrbitApp app_;
+  GlCanvas canvas_;
+  TextRenderer text_renderer_;
+  std::unique_ptr<TimeGraph> time_graph_;
+  uint64_t next_timestamp_ns_ = 0;
+};
+
+// The tracks of `tracks` whose label contains any of the space separated tokens of `filter`,
+// ignoring the case.
+[[nodiscard]] std::vector<Track*> FilterTracks(const std::vector<Track*>& tracks,
+                                               const std::string& filter) {
+  std::vector<std::string> tokens =
+      absl::StrSplit(absl::AsciiStrToLower(filter), ' ', absl::SkipWhitespace());
+  if (tokens.empty()) return tracks;
+  std::vector<Track*> matching_tracks;
+  for (Track* track : tracks) {
+    const std::string lower_case_label = absl::AsciiStrToLower(track->GetLabel());
+    for (const std::string& token : tokens) {
+      if (absl::StrContains(lower_case_label, token)) {
+        matching_tracks.push_back(track);
+        break;
+      }
+    }
+  }
+  return matching_tracks;
+}
+
+}  // namespace
+
+TEST_F(TrackManagerTest, NarrowingTheFilterGivesTheSameTracksAsFilteringAll) {
+  AddTimers(1, "RenderThread", 1);
+  AddTimers(2, "render_worker", 1);
+  AddTimers(3, "AudioMixer", 1);
+  AddTimers(4, "Worker-1", 1);
+  AddTimers(5, "worker-2", 1);
+  AddTimers(6, "Main", 1);
+  track_manager()->SortTracks();
+  const std::vector<Track*> all_tracks = track_manager()->GetVisibleTracks();
+  ASSERT_EQ(all_tracks.size(), 6);
+
+  // Typing narrows the filter, while adding, removing or changing a token doesn't.
+  for (const char* filter :
+       {"r", "re", "REN", "rend", "rend a", "rend au", "rend aud", "rend", "worker", "worker-",
+        "worker-1", "worker-2", "main", "", "m", "mai 1", "a"}) {
+    track_manager()->SetFilter(filter);
+    EXPECT_EQ(track_manager()->GetVisibleTracks(), FilterTracks(all_tracks, filter))
+        << "filter: \"" << filter << "\"";
+  }
+}
+
+TEST_F(TrackManagerTest, ChangingTheLabelOfATrackChangesWhetherItMatchesTheFilter) {
+  ThreadTrack* first_track = AddTimers(1, "first", 1);
+  ThreadTrack* second_track = AddTimers(2, "second", 1);
+  track_manager()->SortTracks();
+
+  track_manager()->SetFilter("renamed");
+  EXPECT_TRUE(track_manager()->GetVisibleTracks().empty());
+
+  // Filtering again matches the new label, not the cached lower case label of the old one.
+  first_track->SetLabel("Renamed [1]");
+  track_manager()->SetFilter("rename");
+  EXPECT_EQ(track_manager()->GetVisibleTracks(), std::vector<Track*>{first_track});
+
+  // So does sorting again, even if the sorted tracks stay the same: the new track is empty, so it
+  // is not shown.
+  second_track->SetLabel("RENAMED too [2]");
+  (void)track_manager()->GetOrCreateThreadTrack(3);
+  track_manager()->SortTracks();
+  EXPECT_EQ(track_manager()->GetVisibleTracks(),
+            (std::vector<Track*>{first_track, second_track}));
+
+  first_track->SetLabel("first [1]");
+  track_manager()->SetFilter("renamed too");
+  EXPECT_EQ(track_manager()->GetVisibleTracks(), std::vector<Track*>{second_track});
+}
+
+TEST_F(TrackManagerTest, ThreadTracksWithTheSameCountsKeepTheirOrderWhenTracksAreAdded) {
+  ThreadTrack* first_track = AddTimers(1, "first", 2);
+  ThreadTrack* second_track = AddTimers(2, "second", 1);
+  ThreadTrack* third_track = AddTimers(3, "third", 1);
+  ThreadTrack* fourth_track = AddTimers(4, "fourth", 1);
+  track_manager()->SortTracks();
+  EXPECT_EQ(track_manager()->GetVisibleTracks(),
+            (std::vector<Track*>{first_track, second_track, third_track, fourth_track}));
+
+  // A new track with the same count goes after the tracks that were sorted before.
+  ThreadTrack* fifth_track = AddTimers(5, "fifth", 1);
+  track_manager()->SortTracks();
+  EXPECT_EQ(
+      track_manager()->GetVisibleTracks(),
+      (std::vector<Track*>{first_track, second_track, third_track, fourth_track, fifth_track}));
+
+  // Tracks with more timers move up, the others keep their order.
+  AddTimers(4, "fourth", 2);
+  ThreadTrack* sixth_track = AddTimers(6, "sixth", 2);
+  track_manager()->SortTracks();
+  EXPECT_EQ(track_manager()->GetVisibleTracks(),
+            (std::vector<Track*>{fourth_track, first_track, sixth_track, second_track,
+                                 third_track, fifth_track}));
+}
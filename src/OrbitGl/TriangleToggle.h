@@ -5,6 +5,7 @@
 #ifndef ORBIT_GL_TRIANGLE_TOGGLE_H_
 #define ORBIT_GL_TRIANGLE_TOGGLE_H_
 
+#include <atomic>
 #include <functional>
 #include <memory>
 
@@ -42,7 +43,8 @@ class TriangleToggle : public orbit_gl::CaptureViewElement,
   bool IsInactive() const { return state_ == State::kInactive; }
 
  private:
-  State state_ = State::kInactive;
+  // Read by the tracks while their primitives are updated off the UI thread.
+  std::atomic<State> state_ = State::kInactive;
   State initial_state_ = State::kInactive;
   StateChangeHandler handler_;
   float size_ = 10.f;
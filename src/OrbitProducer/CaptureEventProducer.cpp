@@ -10,10 +10,12 @@
 #include <chrono>
 
 #include "OrbitBase/Logging.h"
+#include "ProducerSideChannel/FileDescriptorPassing.h"
 
 using orbit_grpc_protos::ProducerSideService;
 using orbit_grpc_protos::ReceiveCommandsAndSendEventsRequest;
 using orbit_grpc_protos::ReceiveCommandsAndSendEventsResponse;
+using orbit_producer_side_channel::SharedMemoryRingBuffer;
 
 namespace orbit_producer {
 
@@ -107,6 +109,76 @@ bool CaptureEventProducer::NotifyAllEventsSent() {
   return write_succeeded;
 }
 
+SharedMemoryRingBuffer* CaptureEventProducer::GetAnnouncedSharedMemoryBuffer() {
+  uint64_t connection_id;
+  uint64_t offer_id;
+  std::optional<SharedMemoryBufferOffer> offer;
+  {
+    absl::MutexLock lock{&shared_memory_buffer_offer_mutex_};
+    connection_id = connection_id_;
+    offer_id = shared_memory_buffer_offer_id_;
+    offer = shared_memory_buffer_offer_;
+  }
+  if (!offer.has_value() || shared_memory_buffer_failed_offer_id_ == offer_id) {
+    return nullptr;
+  }
+
+  if (shared_memory_buffer_ == nullptr) {
+    if (shared_memory_buffer_creation_failed_) {
+      return nullptr;
+    }
+    constexpr uint64_t kSharedMemoryBufferDataSize = 16 * 1024 * 1024;
+    ErrorMessageOr<std::unique_ptr<SharedMemoryRingBuffer>> buffer_or_error =
+        SharedMemoryRingBuffer::Create(kSharedMemoryBufferDataSize);
+    if (buffer_or_error.has_error()) {
+      ERROR("Creating shared memory buffer, falling back to gRPC: %s",
+            buffer_or_error.error().message());
+      shared_memory_buffer_creation_failed_ = true;
+      return nullptr;
+    }
+    shared_memory_buffer_ = std::move(buffer_or_error.value());
+  }
+
+  if (shared_memory_buffer_announced_offer_id_ == offer_id) {
+    return shared_memory_buffer_.get();
+  }
+
+  if (shared_memory_buffer_cleared_connection_id_ != connection_id) {
+    // This is a new connection: drop what a previous connection might have left unread.
+    shared_memory_buffer_->ReadAvailableRecords([](uint32_t /*type*/, const uint8_t* /*payload*/,
+                                                   uint32_t /*payload_size*/) {});
+    shared_memory_buffer_cleared_connection_id_ = connection_id;
+  }
+
+  ErrorMessageOr<void> pass_result = orbit_producer_side_channel::ConnectAndSendFileDescriptor(
+      offer->socket_path, offer->token, shared_memory_buffer_->GetFileDescriptor());
+  if (pass_result.has_error()) {
+    ERROR("Passing shared memory buffer to ProducerSideService, falling back to gRPC: %s",
+          pass_result.error().message());
+    shared_memory_buffer_failed_offer_id_ = offer_id;
+    return nullptr;
+  }
+
+  orbit_grpc_protos::ReceiveCommandsAndSendEventsRequest buffer_created_request;
+  buffer_created_request.mutable_shared_memory_buffer_created()->set_token(offer->token);
+  bool write_succeeded;
+  {
+    absl::ReaderMutexLock lock{&context_and_stream_mutex_};
+    if (stream_ == nullptr) {
+      ERROR("Sending SharedMemoryBufferCreated to ProducerSideService: not connected");
+      return nullptr;
+    }
+    write_succeeded = stream_->Write(buffer_created_request);
+  }
+  if (!write_succeeded) {
+    ERROR("Sending SharedMemoryBufferCreated to ProducerSideService");
+    return nullptr;
+  }
+  LOG("Sent SharedMemoryBufferCreated to ProducerSideService");
+  shared_memory_buffer_announced_offer_id_ = offer_id;
+  return shared_memory_buffer_.get();
+}
+
 void CaptureEventProducer::ConnectAndReceiveCommandsThread() {
   CHECK(producer_side_service_stub_ != nullptr);
 
@@ -125,6 +197,12 @@ void CaptureEventProducer::ConnectAndReceiveCommandsThread() {
       context_ = std::make_unique<grpc::ClientContext>();
       stream_ = producer_side_service_stub_->ReceiveCommandsAndSendEvents(context_.get());
     }
+    {
+      absl::MutexLock lock{&shared_memory_buffer_offer_mutex_};
+      shared_memory_buffer_offer_.reset();
+      ++connection_id_;
+      ++shared_memory_buffer_offer_id_;
+    }
 
     if (stream_ == nullptr) {
       ERROR(
@@ -183,6 +261,18 @@ void CaptureEventProducer::ConnectAndReceiveCommandsThread() {
       switch (response.command_case()) {
         case ReceiveCommandsAndSendEventsResponse::kStartCaptureCommand: {
           LOG("ProducerSideService sent StartCaptureCommand");
+          {
+            const auto& start_capture_command = response.start_capture_command();
+            absl::MutexLock lock{&shared_memory_buffer_offer_mutex_};
+            if (start_capture_command.shared_memory_buffer_socket_path().empty()) {
+              shared_memory_buffer_offer_.reset();
+            } else {
+              shared_memory_buffer_offer_ =
+                  SharedMemoryBufferOffer{start_capture_command.shared_memory_buffer_socket_path(),
+                                          start_capture_command.shared_memory_buffer_token()};
+            }
+            ++shared_memory_buffer_offer_id_;
+          }
           if (last_command_ == ReceiveCommandsAndSendEventsResponse::kCaptureFinishedCommand) {
             last_command_ = ReceiveCommandsAndSendEventsResponse::kStartCaptureCommand;
             OnCaptureStart(response.start_capture_command().capture_options());
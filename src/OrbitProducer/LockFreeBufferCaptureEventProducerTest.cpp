@@ -2,12 +2,17 @@
 // Use of this source code is governed by a BSD-style license that can be
 // found in the LICENSE file.
 
+#include <absl/strings/str_format.h>
 #include <gmock/gmock.h>
 #include <google/protobuf/arena.h>
 #include <grpcpp/server_impl.h>
 #include <grpcpp/support/channel_arguments.h>
 #include <gtest/gtest.h>
 #include <stdint.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
 
 #include <chrono>
 #include <memory>
@@ -17,8 +22,12 @@
 #include <utility>
 #include <vector>
 
+#include "OrbitBase/File.h"
 #include "OrbitProducer/FakeProducerSideService.h"
 #include "OrbitProducer/LockFreeBufferCaptureEventProducer.h"
+#include "ProducerSideChannel/FileDescriptorPassing.h"
+#include "ProducerSideChannel/SharedMemoryRecords.h"
+#include "ProducerSideChannel/SharedMemoryRingBuffer.h"
 #include "capture.pb.h"
 #include "grpcpp/grpcpp.h"
 
@@ -35,6 +44,22 @@ class LockFreeBufferCaptureEventProducerImpl
   }
 };
 
+// Listens on a Unix domain socket like OrbitService does to receive the memfd of the buffer.
+orbit_base::unique_fd ListenOnUnixDomainSocket(const std::string& socket_path) {
+  sockaddr_un address{};
+  address.sun_family = AF_UNIX;
+  strncpy(address.sun_path, socket_path.c_str(), sizeof(address.sun_path) - 1);
+  orbit_base::unique_fd listening_socket{socket(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0)};
+  if (!listening_socket.valid()) return {};
+  unlink(socket_path.c_str());
+  if (bind(listening_socket.get(), reinterpret_cast<const sockaddr*>(&address),
+           sizeof(address)) != 0 ||
+      listen(listening_socket.get(), 1) != 0) {
+    return {};
+  }
+  return listening_socket;
+}
+
 class LockFreeBufferCaptureEventProducerTest : public ::testing::Test {
  protected:
   void SetUp() override {
@@ -130,6 +155,88 @@ TEST_F(LockFreeBufferCaptureEventProducerTest, EnqueueIntermediateEventIfCapturi
   EXPECT_FALSE(buffer_producer_->EnqueueIntermediateEventIfCapturing([] { return ""; }));
 }
 
+TEST_F(LockFreeBufferCaptureEventProducerTest, EventsAreWrittenToSharedMemoryBufferIfSupported) {
+  const std::string socket_path =
+      absl::StrFormat("/tmp/orbit-lock-free-buffer-capture-event-producer-test-%d", getpid());
+  orbit_base::unique_fd listening_socket = ListenOnUnixDomainSocket(socket_path);
+  ASSERT_TRUE(listening_socket.valid());
+
+  static constexpr uint64_t kToken = 0x0123456789abcdef;
+  std::unique_ptr<orbit_producer_side_channel::SharedMemoryRingBuffer> service_buffer;
+  auto receive_buffer = [&listening_socket, &service_buffer](uint64_t token) {
+    EXPECT_EQ(token, kToken);
+    // The producer has passed the memfd before announcing the buffer.
+    orbit_base::unique_fd connection{
+        accept4(listening_socket.get(), nullptr, nullptr, SOCK_CLOEXEC)};
+    ASSERT_TRUE(connection.valid());
+    auto received_or_error = orbit_producer_side_channel::ReceiveFileDescriptor(connection.get());
+    ASSERT_FALSE(received_or_error.has_error());
+    EXPECT_EQ(received_or_error.value().token, kToken);
+    auto buffer_or_error =
+        orbit_producer_side_channel::SharedMemoryRingBuffer::OpenFromFileDescriptor(
+            std::move(received_or_error.value().fd));
+    ASSERT_FALSE(buffer_or_error.has_error());
+    service_buffer = std::move(buffer_or_error.value());
+  };
+  EXPECT_CALL(*fake_service_, OnSharedMemoryBufferCreatedReceived)
+      .Times(1)
+      .WillOnce(receive_buffer);
+  EXPECT_CALL(*fake_service_, OnCaptureEventsReceived).Times(0);
+  EXPECT_CALL(*fake_service_, OnAllEventsSentReceived).Times(0);
+
+  fake_service_->SendStartCaptureCommand(orbit_grpc_protos::CaptureOptions{}, socket_path, kToken);
+  std::this_thread::sleep_for(kWaitMessagesSentDuration);
+  EXPECT_TRUE(buffer_producer_->IsCapturing());
+
+  EXPECT_TRUE(buffer_producer_->EnqueueIntermediateEventIfCapturing([] { return ""; }));
+  EXPECT_TRUE(buffer_producer_->EnqueueIntermediateEventIfCapturing([] { return ""; }));
+  std::this_thread::sleep_for(kWaitMessagesSentDuration);
+
+  ::testing::Mock::VerifyAndClearExpectations(&*fake_service_);
+  ASSERT_NE(service_buffer, nullptr);
+
+  uint64_t record_count = service_buffer->ReadAvailableRecords(
+      [](uint32_t type, const uint8_t* /*payload*/, uint32_t /*payload_size*/) {
+        EXPECT_EQ(type, static_cast<uint32_t>(orbit_producer_side_channel::SharedMemoryRecordType::
+                                                  kSerializedProducerCaptureEvent));
+      });
+  EXPECT_EQ(record_count, 2);
+
+  EXPECT_CALL(*fake_service_, OnCaptureEventsReceived).Times(0);
+  EXPECT_CALL(*fake_service_, OnAllEventsSentReceived).Times(1);
+  fake_service_->SendStopCaptureCommand();
+  std::this_thread::sleep_for(kWaitMessagesSentDuration);
+
+  ::testing::Mock::VerifyAndClearExpectations(&*fake_service_);
+  fake_service_->SendCaptureFinishedCommand();
+  std::this_thread::sleep_for(kWaitMessagesSentDuration);
+
+  // The buffer is announced again for every capture.
+  service_buffer.reset();
+  EXPECT_CALL(*fake_service_, OnSharedMemoryBufferCreatedReceived)
+      .Times(1)
+      .WillOnce(receive_buffer);
+  EXPECT_CALL(*fake_service_, OnCaptureEventsReceived).Times(0);
+  fake_service_->SendStartCaptureCommand(orbit_grpc_protos::CaptureOptions{}, socket_path, kToken);
+  std::this_thread::sleep_for(kWaitMessagesSentDuration);
+  EXPECT_TRUE(buffer_producer_->EnqueueIntermediateEventIfCapturing([] { return ""; }));
+  std::this_thread::sleep_for(kWaitMessagesSentDuration);
+
+  ::testing::Mock::VerifyAndClearExpectations(&*fake_service_);
+  ASSERT_NE(service_buffer, nullptr);
+  EXPECT_EQ(service_buffer->ReadAvailableRecords(
+                [](uint32_t /*type*/, const uint8_t* /*payload*/, uint32_t /*payload_size*/) {}),
+            1);
+
+  EXPECT_CALL(*fake_service_, OnAllEventsSentReceived).Times(1);
+  fake_service_->SendStopCaptureCommand();
+  std::this_thread::sleep_for(kWaitMessagesSentDuration);
+
+  ::testing::Mock::VerifyAndClearExpectations(&*fake_service_);
+  fake_service_->SendCaptureFinishedCommand();
+  unlink(socket_path.c_str());
+}
+
 TEST_F(LockFreeBufferCaptureEventProducerTest, EnqueueIntermediateEvent) {
   EXPECT_FALSE(buffer_producer_->IsCapturing());
 
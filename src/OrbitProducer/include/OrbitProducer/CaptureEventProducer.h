@@ -10,8 +10,11 @@
 
 #include <atomic>
 #include <memory>
+#include <optional>
+#include <string>
 #include <thread>
 
+#include "ProducerSideChannel/SharedMemoryRingBuffer.h"
 #include "absl/synchronization/mutex.h"
 #include "capture.pb.h"
 #include "grpcpp/grpcpp.h"
@@ -61,6 +64,19 @@ class CaptureEventProducer {
   // they have sent all their CaptureEvents after the capture has been stopped.
   [[nodiscard]] bool NotifyAllEventsSent();
 
+  // If the ProducerSideService offered the shared memory transport with the last
+  // StartCaptureCommand, this method returns the SharedMemoryRingBuffer into which subclasses can
+  // write records (see ProducerSideChannel/SharedMemoryRecords.h) instead of calling
+  // SendCaptureEvents. Otherwise, or if the buffer couldn't be set up, it returns nullptr.
+  // The buffer is created on the first call. Once per capture, its memfd is passed to the service
+  // through the Unix domain socket specified in the StartCaptureCommand, and then the buffer is
+  // announced on the gRPC stream: the service only polls the buffer between the announcement and
+  // AllEventsSent.
+  // As this writes to the gRPC stream, it must be called from the same thread that calls
+  // SendCaptureEvents and NotifyAllEventsSent.
+  [[nodiscard]] orbit_producer_side_channel::SharedMemoryRingBuffer*
+  GetAnnouncedSharedMemoryBuffer();
+
  private:
   void ConnectAndReceiveCommandsThread();
 
@@ -81,6 +97,25 @@ class CaptureEventProducer {
   absl::Mutex shutdown_requested_mutex_;
 
   std::atomic<uint64_t> reconnection_delay_ms_ = 4000;
+
+  // These are written by ConnectAndReceiveCommandsThread.
+  struct SharedMemoryBufferOffer {
+    std::string socket_path;
+    uint64_t token;
+  };
+  uint64_t connection_id_ ABSL_GUARDED_BY(shared_memory_buffer_offer_mutex_) = 0;
+  // Incremented on every new connection and on every StartCaptureCommand.
+  uint64_t shared_memory_buffer_offer_id_ ABSL_GUARDED_BY(shared_memory_buffer_offer_mutex_) = 0;
+  std::optional<SharedMemoryBufferOffer> shared_memory_buffer_offer_
+      ABSL_GUARDED_BY(shared_memory_buffer_offer_mutex_);
+  absl::Mutex shared_memory_buffer_offer_mutex_;
+
+  // These are only accessed by the thread calling GetAnnouncedSharedMemoryBuffer.
+  std::unique_ptr<orbit_producer_side_channel::SharedMemoryRingBuffer> shared_memory_buffer_;
+  bool shared_memory_buffer_creation_failed_ = false;
+  uint64_t shared_memory_buffer_cleared_connection_id_ = 0;
+  uint64_t shared_memory_buffer_announced_offer_id_ = 0;
+  uint64_t shared_memory_buffer_failed_offer_id_ = 0;
 };
 
 }  // namespace orbit_producer
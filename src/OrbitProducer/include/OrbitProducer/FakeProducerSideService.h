@@ -5,6 +5,10 @@
 #ifndef ORBIT_PRODUCER_FAKE_PRODUCER_SIDE_SERVICE_H_
 #define ORBIT_PRODUCER_FAKE_PRODUCER_SIDE_SERVICE_H_
 
+#include <stdint.h>
+
+#include <string>
+
 #include "grpcpp/grpcpp.h"
 #include "producer_side_services.grpc.pb.h"
 
@@ -40,6 +44,9 @@ class FakeProducerSideService : public orbit_grpc_protos::ProducerSideService::S
         case orbit_grpc_protos::ReceiveCommandsAndSendEventsRequest::kAllEventsSent:
           OnAllEventsSentReceived();
           break;
+        case orbit_grpc_protos::ReceiveCommandsAndSendEventsRequest::kSharedMemoryBufferCreated:
+          OnSharedMemoryBufferCreatedReceived(request.shared_memory_buffer_created().token());
+          break;
         case orbit_grpc_protos::ReceiveCommandsAndSendEventsRequest::EVENT_NOT_SET:
           break;
       }
@@ -50,11 +57,17 @@ class FakeProducerSideService : public orbit_grpc_protos::ProducerSideService::S
     return grpc::Status::OK;
   }
 
-  void SendStartCaptureCommand(orbit_grpc_protos::CaptureOptions capture_options) {
+  void SendStartCaptureCommand(orbit_grpc_protos::CaptureOptions capture_options,
+                               std::string shared_memory_buffer_socket_path = "",
+                               uint64_t shared_memory_buffer_token = 0) {
     ASSERT_NE(stream_, nullptr);
     orbit_grpc_protos::ReceiveCommandsAndSendEventsResponse command;
     *command.mutable_start_capture_command()->mutable_capture_options() =
         std::move(capture_options);
+    command.mutable_start_capture_command()->set_shared_memory_buffer_socket_path(
+        std::move(shared_memory_buffer_socket_path));
+    command.mutable_start_capture_command()->set_shared_memory_buffer_token(
+        shared_memory_buffer_token);
     bool written = stream_->Write(command);
     EXPECT_TRUE(written);
   }
@@ -90,6 +103,7 @@ class FakeProducerSideService : public orbit_grpc_protos::ProducerSideService::S
   MOCK_METHOD(void, OnCaptureEventsReceived,
               (const std::vector<orbit_grpc_protos::ProducerCaptureEvent>& events), ());
   MOCK_METHOD(void, OnAllEventsSentReceived, (), ());
+  MOCK_METHOD(void, OnSharedMemoryBufferCreatedReceived, (uint64_t token), ());
 
  private:
   grpc::ServerContext* context_ = nullptr;
@@ -11,6 +11,8 @@
 #include "OrbitBase/MakeUniqueForOverwrite.h"
 #include "OrbitBase/ThreadUtils.h"
 #include "OrbitProducer/CaptureEventProducer.h"
+#include "ProducerSideChannel/SharedMemoryRecords.h"
+#include "ProducerSideChannel/SharedMemoryRingBuffer.h"
 #include "concurrentqueue.h"
 
 namespace orbit_producer {
@@ -28,6 +30,10 @@ namespace orbit_producer {
 // ProducerCaptureEvents are then built from IntermediateEventT in TranslateIntermediateEvent, which
 // subclasses need to implement.
 //
+// When ProducerSideService offers the shared memory transport, events are instead written to a
+// SharedMemoryRingBuffer with WriteIntermediateEventToSharedMemoryBuffer, which subclasses can
+// override to write fixed-layout records instead of serialized ProducerCaptureEvents.
+//
 // In particular, when hundreds of thousands of events are produced per second, it is recommended
 // that IntermediateEventT not be a protobuf or another type that involves heap allocations, as the
 // cost of dynamic allocations and de-allocations can add up quickly.
@@ -95,6 +101,34 @@ class LockFreeBufferCaptureEventProducer : public CaptureEventProducer {
   [[nodiscard]] virtual orbit_grpc_protos::ProducerCaptureEvent* TranslateIntermediateEvent(
       IntermediateEventT&& intermediate_event, google::protobuf::Arena* arena) = 0;
 
+  // This method is used instead of TranslateIntermediateEvent when the events are sent through the
+  // shared memory buffer. Subclasses can override it to write `intermediate_event` as one of the
+  // fixed-layout records in ProducerSideChannel/SharedMemoryRecords.h, so that no protobuf is built
+  // nor serialized in the producer. The default implementation writes the ProducerCaptureEvent
+  // returned by TranslateIntermediateEvent as a kSerializedProducerCaptureEvent record.
+  virtual void WriteIntermediateEventToSharedMemoryBuffer(
+      IntermediateEventT&& intermediate_event,
+      orbit_producer_side_channel::SharedMemoryRingBuffer* shared_memory_buffer,
+      google::protobuf::Arena* arena) {
+    orbit_grpc_protos::ProducerCaptureEvent* capture_event =
+        TranslateIntermediateEvent(std::move(intermediate_event), arena);
+    const size_t payload_size = capture_event->ByteSizeLong();
+    if (payload_size > shared_memory_buffer->GetMaxPayloadSize()) {
+      ERROR("ProducerCaptureEvent of %u bytes is too large for the shared memory buffer",
+            payload_size);
+      return;
+    }
+    uint8_t* payload = shared_memory_buffer->AllocateRecord(
+        static_cast<uint32_t>(
+            orbit_producer_side_channel::SharedMemoryRecordType::kSerializedProducerCaptureEvent),
+        payload_size);
+    if (payload == nullptr) {
+      return;
+    }
+    capture_event->SerializeWithCachedSizesToArray(payload);
+    shared_memory_buffer->CommitRecord();
+  }
+
  private:
   void ForwarderThread() {
     orbit_base::SetCurrentThreadName("ForwarderThread");
@@ -130,20 +164,42 @@ class LockFreeBufferCaptureEventProducer : public CaptureEventProducer {
              current_status == ProducerStatus::kShouldNotifyAllEventsSent) &&
             dequeued_event_count > 0) {
           google::protobuf::Arena arena{arena_options};
-          auto* send_request = google::protobuf::Arena::CreateMessage<
-              orbit_grpc_protos::ReceiveCommandsAndSendEventsRequest>(&arena);
-          auto* capture_events =
-              send_request->mutable_buffered_capture_events()->mutable_capture_events();
-          capture_events->Reserve(dequeued_event_count);
-
-          for (size_t i = 0; i < dequeued_event_count; ++i) {
-            capture_events->AddAllocated(
-                TranslateIntermediateEvent(std::move(dequeued_events[i]), &arena));
-          }
 
-          if (!SendCaptureEvents(*send_request)) {
-            ERROR("Forwarding %lu CaptureEvents", dequeued_event_count);
-            break;
+          orbit_producer_side_channel::SharedMemoryRingBuffer* shared_memory_buffer =
+              GetAnnouncedSharedMemoryBuffer();
+          if (shared_memory_buffer != nullptr) {
+            const uint64_t dropped_record_count_before =
+                shared_memory_buffer->GetDroppedRecordCount();
+            for (size_t i = 0; i < dequeued_event_count; ++i) {
+              WriteIntermediateEventToSharedMemoryBuffer(std::move(dequeued_events[i]),
+                                                         shared_memory_buffer, &arena);
+              // Don't keep the Arena growing for the whole batch of events.
+              if (arena.SpaceUsed() > kArenaInitialBlockSize) {
+                arena.Reset();
+              }
+            }
+            const uint64_t dropped_record_count =
+                shared_memory_buffer->GetDroppedRecordCount() - dropped_record_count_before;
+            if (dropped_record_count > 0) {
+              ERROR("Dropped %u CaptureEvents as the shared memory buffer was full",
+                    dropped_record_count);
+            }
+          } else {
+            auto* send_request = google::protobuf::Arena::CreateMessage<
+                orbit_grpc_protos::ReceiveCommandsAndSendEventsRequest>(&arena);
+            auto* capture_events =
+                send_request->mutable_buffered_capture_events()->mutable_capture_events();
+            capture_events->Reserve(dequeued_event_count);
+
+            for (size_t i = 0; i < dequeued_event_count; ++i) {
+              capture_events->AddAllocated(
+                  TranslateIntermediateEvent(std::move(dequeued_events[i]), &arena));
+            }
+
+            if (!SendCaptureEvents(*send_request)) {
+              ERROR("Forwarding %lu CaptureEvents", dequeued_event_count);
+              break;
+            }
           }
         }
 
@@ -0,0 +1,121 @@
+// Copyright (c) 2021 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "GpuQueueSubmissionEvent.h"
+
+#include <string.h>
+
+#include "OrbitBase/Logging.h"
+
+namespace orbit_vulkan_layer {
+
+using orbit_producer_side_channel::GpuCommandBufferRecord;
+using orbit_producer_side_channel::GpuDebugMarkerRecord;
+using orbit_producer_side_channel::GpuQueueSubmissionMetaInfoRecord;
+using orbit_producer_side_channel::GpuQueueSubmissionRecord;
+using orbit_producer_side_channel::SharedMemoryRecordType;
+using orbit_producer_side_channel::SharedMemoryRingBuffer;
+
+namespace {
+
+void FillMetaInfo(const GpuQueueSubmissionMetaInfoRecord& record,
+                  orbit_grpc_protos::GpuQueueSubmissionMetaInfo* meta_info) {
+  meta_info->set_pid(record.pid);
+  meta_info->set_tid(record.tid);
+  meta_info->set_pre_submission_cpu_timestamp(record.pre_submission_cpu_timestamp);
+  meta_info->set_post_submission_cpu_timestamp(record.post_submission_cpu_timestamp);
+}
+
+template <typename T>
+void CopyRecordsAndAdvance(const std::vector<T>& records, uint8_t** address) {
+  if (records.empty()) {
+    return;
+  }
+  memcpy(*address, records.data(), records.size() * sizeof(T));
+  *address += records.size() * sizeof(T);
+}
+
+}  // namespace
+
+void FillGpuQueueSubmissionProto(const GpuQueueSubmissionEvent& event,
+                                 orbit_grpc_protos::GpuQueueSubmission* submission) {
+  FillMetaInfo(event.meta_info, submission->mutable_meta_info());
+  submission->set_num_begin_markers(event.num_begin_markers);
+
+  submission->mutable_submit_infos()->Reserve(event.command_buffer_counts.size());
+  auto command_buffer_it = event.command_buffers.begin();
+  for (uint32_t command_buffer_count : event.command_buffer_counts) {
+    orbit_grpc_protos::GpuSubmitInfo* submit_info = submission->add_submit_infos();
+    submit_info->mutable_command_buffers()->Reserve(command_buffer_count);
+    for (uint32_t i = 0; i < command_buffer_count; ++i) {
+      CHECK(command_buffer_it != event.command_buffers.end());
+      orbit_grpc_protos::GpuCommandBuffer* command_buffer = submit_info->add_command_buffers();
+      command_buffer->set_begin_gpu_timestamp_ns(command_buffer_it->begin_gpu_timestamp_ns);
+      command_buffer->set_end_gpu_timestamp_ns(command_buffer_it->end_gpu_timestamp_ns);
+      ++command_buffer_it;
+    }
+  }
+  CHECK(command_buffer_it == event.command_buffers.end());
+
+  submission->mutable_completed_markers()->Reserve(event.completed_markers.size());
+  for (const GpuDebugMarkerRecord& marker_record : event.completed_markers) {
+    orbit_grpc_protos::GpuDebugMarker* marker = submission->add_completed_markers();
+    if ((marker_record.flags & GpuDebugMarkerRecord::kHasBeginMarker) != 0) {
+      FillMetaInfo(marker_record.begin_meta_info,
+                   marker->mutable_begin_marker()->mutable_meta_info());
+      marker->mutable_begin_marker()->set_gpu_timestamp_ns(marker_record.begin_gpu_timestamp_ns);
+    }
+    marker->set_end_gpu_timestamp_ns(marker_record.end_gpu_timestamp_ns);
+    marker->set_text_key(marker_record.text_key);
+    marker->set_depth(marker_record.depth);
+    if ((marker_record.flags & GpuDebugMarkerRecord::kHasColor) != 0) {
+      marker->mutable_color()->set_red(marker_record.color_red);
+      marker->mutable_color()->set_green(marker_record.color_green);
+      marker->mutable_color()->set_blue(marker_record.color_blue);
+      marker->mutable_color()->set_alpha(marker_record.color_alpha);
+    }
+  }
+}
+
+bool WriteGpuQueueSubmissionRecord(const GpuQueueSubmissionEvent& event,
+                                   SharedMemoryRingBuffer* shared_memory_buffer) {
+  GpuQueueSubmissionRecord record{};
+  record.meta_info = event.meta_info;
+  record.num_begin_markers = event.num_begin_markers;
+  record.num_submit_infos = static_cast<uint32_t>(event.command_buffer_counts.size());
+  record.num_command_buffers = static_cast<uint32_t>(event.command_buffers.size());
+  record.num_completed_markers = static_cast<uint32_t>(event.completed_markers.size());
+
+  const uint64_t payload_size = orbit_producer_side_channel::GetGpuQueueSubmissionPayloadSize(
+      record.num_submit_infos, record.num_command_buffers, record.num_completed_markers);
+  if (payload_size > shared_memory_buffer->GetMaxPayloadSize()) {
+    ERROR("Record of %u bytes is too large for the shared memory buffer", payload_size);
+    return false;
+  }
+  uint8_t* payload = shared_memory_buffer->AllocateRecord(
+      static_cast<uint32_t>(SharedMemoryRecordType::kGpuQueueSubmission),
+      static_cast<uint32_t>(payload_size));
+  if (payload == nullptr) {
+    return false;
+  }
+
+  // All parts of the event are arrays of fixed-layout records already, so each is a single copy.
+  uint8_t* address = payload;
+  memcpy(address, &record, sizeof(record));
+  address += sizeof(record);
+  const uint64_t counts_size =
+      orbit_producer_side_channel::GetGpuQueueSubmissionCommandBufferCountsSize(
+          record.num_submit_infos);
+  memset(address, 0, counts_size);
+  uint8_t* counts_address = address;
+  CopyRecordsAndAdvance(event.command_buffer_counts, &counts_address);
+  address += counts_size;
+  CopyRecordsAndAdvance(event.command_buffers, &address);
+  CopyRecordsAndAdvance(event.completed_markers, &address);
+
+  shared_memory_buffer->CommitRecord();
+  return true;
+}
+
+}  // namespace orbit_vulkan_layer
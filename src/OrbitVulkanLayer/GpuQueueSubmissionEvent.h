@@ -0,0 +1,56 @@
+// Copyright (c) 2021 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef ORBIT_VULKAN_LAYER_GPU_QUEUE_SUBMISSION_EVENT_H_
+#define ORBIT_VULKAN_LAYER_GPU_QUEUE_SUBMISSION_EVENT_H_
+
+#include <stdint.h>
+
+#include <vector>
+
+#include "ProducerSideChannel/SharedMemoryRecords.h"
+#include "ProducerSideChannel/SharedMemoryRingBuffer.h"
+#include "capture.pb.h"
+
+namespace orbit_vulkan_layer {
+
+// Flat representation of a `GpuQueueSubmission`, used as intermediate event between the
+// `SubmissionTracker` and the `VulkanLayerProducer`. It consists of the fixed-layout records of
+// the shared memory transport, so it can be created without building any protobuf, and the text
+// of debug markers is only referenced through the key of the interned string.
+// The `GpuQueueSubmission` proto is only built from it on the thread that forwards the events
+// (see `FillGpuQueueSubmissionProto`), unless the record is written to shared memory as is (see
+// `WriteGpuQueueSubmissionRecord`).
+struct GpuQueueSubmissionEvent {
+  orbit_producer_side_channel::GpuQueueSubmissionMetaInfoRecord meta_info{};
+  int32_t num_begin_markers = 0;
+  // The number of command buffers of each submit info. The command buffers of all submit infos
+  // are stored in `command_buffers`, in the order of the submit infos.
+  std::vector<uint32_t> command_buffer_counts;
+  std::vector<orbit_producer_side_channel::GpuCommandBufferRecord> command_buffers;
+  std::vector<orbit_producer_side_channel::GpuDebugMarkerRecord> completed_markers;
+
+  // Clears the event while keeping the capacity of the vectors, such that the event can be reused
+  // without allocating.
+  void Clear() {
+    meta_info = {};
+    num_begin_markers = 0;
+    command_buffer_counts.clear();
+    command_buffers.clear();
+    completed_markers.clear();
+  }
+};
+
+void FillGpuQueueSubmissionProto(const GpuQueueSubmissionEvent& event,
+                                 orbit_grpc_protos::GpuQueueSubmission* submission);
+
+// Writes `event` as a kGpuQueueSubmission record. Returns false if the record could not be written,
+// either because it is too large or because the buffer is full.
+bool WriteGpuQueueSubmissionRecord(
+    const GpuQueueSubmissionEvent& event,
+    orbit_producer_side_channel::SharedMemoryRingBuffer* shared_memory_buffer);
+
+}  // namespace orbit_vulkan_layer
+
+#endif  // ORBIT_VULKAN_LAYER_GPU_QUEUE_SUBMISSION_EVENT_H_
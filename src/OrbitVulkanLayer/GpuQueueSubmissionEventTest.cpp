@@ -0,0 +1,162 @@
+// Copyright (c) 2021 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <gtest/gtest.h>
+#include <string.h>
+
+#include <memory>
+#include <vector>
+
+#include "GpuQueueSubmissionEvent.h"
+#include "ProducerSideChannel/SharedMemoryRecords.h"
+#include "ProducerSideChannel/SharedMemoryRingBuffer.h"
+
+namespace orbit_vulkan_layer {
+
+using orbit_producer_side_channel::GpuCommandBufferRecord;
+using orbit_producer_side_channel::GpuDebugMarkerRecord;
+using orbit_producer_side_channel::GpuQueueSubmissionRecord;
+using orbit_producer_side_channel::SharedMemoryRecordType;
+using orbit_producer_side_channel::SharedMemoryRingBuffer;
+
+namespace {
+
+GpuQueueSubmissionEvent CreateEvent() {
+  GpuQueueSubmissionEvent event;
+  event.meta_info = {1, 2, 3, 4};
+  event.num_begin_markers = 1;
+  event.command_buffer_counts = {2, 0, 1};
+  event.command_buffers = {{10, 11}, {12, 13}, {0, 14}};
+
+  GpuDebugMarkerRecord marker_with_begin{};
+  marker_with_begin.flags = GpuDebugMarkerRecord::kHasBeginMarker | GpuDebugMarkerRecord::kHasColor;
+  marker_with_begin.begin_meta_info = {5, 6, 7, 8};
+  marker_with_begin.begin_gpu_timestamp_ns = 20;
+  marker_with_begin.end_gpu_timestamp_ns = 21;
+  marker_with_begin.text_key = 42;
+  marker_with_begin.depth = 1;
+  marker_with_begin.color_red = 0.25f;
+  marker_with_begin.color_green = 0.5f;
+  marker_with_begin.color_blue = 0.75f;
+  marker_with_begin.color_alpha = 1.f;
+
+  GpuDebugMarkerRecord marker_without_begin{};
+  marker_without_begin.end_gpu_timestamp_ns = 22;
+  marker_without_begin.text_key = 43;
+
+  event.completed_markers = {marker_with_begin, marker_without_begin};
+  return event;
+}
+
+}  // namespace
+
+TEST(GpuQueueSubmissionEvent, FillGpuQueueSubmissionProto) {
+  GpuQueueSubmissionEvent event = CreateEvent();
+  orbit_grpc_protos::GpuQueueSubmission submission;
+  FillGpuQueueSubmissionProto(event, &submission);
+
+  EXPECT_EQ(submission.meta_info().pid(), 1);
+  EXPECT_EQ(submission.meta_info().tid(), 2);
+  EXPECT_EQ(submission.meta_info().pre_submission_cpu_timestamp(), 3);
+  EXPECT_EQ(submission.meta_info().post_submission_cpu_timestamp(), 4);
+  EXPECT_EQ(submission.num_begin_markers(), 1);
+
+  ASSERT_EQ(submission.submit_infos_size(), 3);
+  ASSERT_EQ(submission.submit_infos(0).command_buffers_size(), 2);
+  EXPECT_EQ(submission.submit_infos(0).command_buffers(0).begin_gpu_timestamp_ns(), 10);
+  EXPECT_EQ(submission.submit_infos(0).command_buffers(0).end_gpu_timestamp_ns(), 11);
+  EXPECT_EQ(submission.submit_infos(0).command_buffers(1).begin_gpu_timestamp_ns(), 12);
+  EXPECT_EQ(submission.submit_infos(0).command_buffers(1).end_gpu_timestamp_ns(), 13);
+  EXPECT_EQ(submission.submit_infos(1).command_buffers_size(), 0);
+  ASSERT_EQ(submission.submit_infos(2).command_buffers_size(), 1);
+  EXPECT_EQ(submission.submit_infos(2).command_buffers(0).begin_gpu_timestamp_ns(), 0);
+  EXPECT_EQ(submission.submit_infos(2).command_buffers(0).end_gpu_timestamp_ns(), 14);
+
+  ASSERT_EQ(submission.completed_markers_size(), 2);
+  const orbit_grpc_protos::GpuDebugMarker& marker_with_begin = submission.completed_markers(0);
+  ASSERT_TRUE(marker_with_begin.has_begin_marker());
+  EXPECT_EQ(marker_with_begin.begin_marker().meta_info().pid(), 5);
+  EXPECT_EQ(marker_with_begin.begin_marker().meta_info().tid(), 6);
+  EXPECT_EQ(marker_with_begin.begin_marker().meta_info().pre_submission_cpu_timestamp(), 7);
+  EXPECT_EQ(marker_with_begin.begin_marker().meta_info().post_submission_cpu_timestamp(), 8);
+  EXPECT_EQ(marker_with_begin.begin_marker().gpu_timestamp_ns(), 20);
+  EXPECT_EQ(marker_with_begin.end_gpu_timestamp_ns(), 21);
+  EXPECT_EQ(marker_with_begin.text_key(), 42);
+  EXPECT_EQ(marker_with_begin.depth(), 1);
+  ASSERT_TRUE(marker_with_begin.has_color());
+  EXPECT_EQ(marker_with_begin.color().red(), 0.25f);
+  EXPECT_EQ(marker_with_begin.color().green(), 0.5f);
+  EXPECT_EQ(marker_with_begin.color().blue(), 0.75f);
+  EXPECT_EQ(marker_with_begin.color().alpha(), 1.f);
+
+  const orbit_grpc_protos::GpuDebugMarker& marker_without_begin = submission.completed_markers(1);
+  EXPECT_FALSE(marker_without_begin.has_begin_marker());
+  EXPECT_FALSE(marker_without_begin.has_color());
+  EXPECT_EQ(marker_without_begin.end_gpu_timestamp_ns(), 22);
+  EXPECT_EQ(marker_without_begin.text_key(), 43);
+  EXPECT_EQ(marker_without_begin.depth(), 0);
+}
+
+TEST(GpuQueueSubmissionEvent, ClearKeepsCapacity) {
+  GpuQueueSubmissionEvent event = CreateEvent();
+  const size_t command_buffers_capacity = event.command_buffers.capacity();
+  const size_t completed_markers_capacity = event.completed_markers.capacity();
+  event.Clear();
+
+  EXPECT_EQ(event.num_begin_markers, 0);
+  EXPECT_TRUE(event.command_buffer_counts.empty());
+  EXPECT_TRUE(event.command_buffers.empty());
+  EXPECT_TRUE(event.completed_markers.empty());
+  EXPECT_EQ(event.command_buffers.capacity(), command_buffers_capacity);
+  EXPECT_EQ(event.completed_markers.capacity(), completed_markers_capacity);
+}
+
+TEST(GpuQueueSubmissionEvent, WriteGpuQueueSubmissionRecord) {
+  auto buffer_or_error = SharedMemoryRingBuffer::Create(64 * 1024);
+  ASSERT_FALSE(buffer_or_error.has_error()) << buffer_or_error.error().message();
+  std::unique_ptr<SharedMemoryRingBuffer> buffer = std::move(buffer_or_error.value());
+
+  GpuQueueSubmissionEvent event = CreateEvent();
+  ASSERT_TRUE(WriteGpuQueueSubmissionRecord(event, buffer.get()));
+
+  std::vector<uint8_t> actual_payload;
+  uint32_t actual_type = 0;
+  EXPECT_EQ(buffer->ReadAvailableRecords(
+                [&](uint32_t type, const uint8_t* payload, uint32_t payload_size) {
+                  actual_type = type;
+                  actual_payload.assign(payload, payload + payload_size);
+                }),
+            1);
+  EXPECT_EQ(actual_type, static_cast<uint32_t>(SharedMemoryRecordType::kGpuQueueSubmission));
+  ASSERT_EQ(actual_payload.size(),
+            orbit_producer_side_channel::GetGpuQueueSubmissionPayloadSize(3, 3, 2));
+
+  GpuQueueSubmissionRecord record;
+  memcpy(&record, actual_payload.data(), sizeof(record));
+  EXPECT_EQ(record.meta_info.pid, 1);
+  EXPECT_EQ(record.meta_info.post_submission_cpu_timestamp, 4);
+  EXPECT_EQ(record.num_begin_markers, 1);
+  EXPECT_EQ(record.num_submit_infos, 3);
+  EXPECT_EQ(record.num_command_buffers, 3);
+  EXPECT_EQ(record.num_completed_markers, 2);
+
+  const uint8_t* address = actual_payload.data() + sizeof(record);
+  std::vector<uint32_t> command_buffer_counts(3);
+  memcpy(command_buffer_counts.data(), address, 3 * sizeof(uint32_t));
+  EXPECT_EQ(command_buffer_counts, event.command_buffer_counts);
+  address += orbit_producer_side_channel::GetGpuQueueSubmissionCommandBufferCountsSize(3);
+
+  GpuCommandBufferRecord last_command_buffer;
+  memcpy(&last_command_buffer, address + 2 * sizeof(GpuCommandBufferRecord),
+         sizeof(GpuCommandBufferRecord));
+  EXPECT_EQ(last_command_buffer.end_gpu_timestamp_ns, 14);
+  address += 3 * sizeof(GpuCommandBufferRecord);
+
+  GpuDebugMarkerRecord last_marker;
+  memcpy(&last_marker, address + sizeof(GpuDebugMarkerRecord), sizeof(GpuDebugMarkerRecord));
+  EXPECT_EQ(last_marker.text_key, 43);
+  EXPECT_EQ(last_marker.end_gpu_timestamp_ns, 22);
+}
+
+}  // namespace orbit_vulkan_layer
@@ -7,16 +7,26 @@
 
 #include <absl/container/flat_hash_map.h>
 #include <absl/container/flat_hash_set.h>
+#include <absl/hash/hash.h>
 #include <absl/synchronization/mutex.h>
 #include <vulkan/vulkan.h>
 
-#include <functional>
-#include <queue>
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <deque>
+#include <limits>
+#include <memory>
+#include <optional>
 #include <stack>
+#include <string>
+#include <string_view>
 
+#include "GpuQueueSubmissionEvent.h"
 #include "OrbitBase/Logging.h"
 #include "OrbitBase/Profiling.h"
 #include "OrbitBase/ThreadUtils.h"
+#include "ProducerSideChannel/SharedMemoryRecords.h"
 #include "VulkanLayerProducer.h"
 
 namespace orbit_vulkan_layer {
@@ -36,9 +46,14 @@ namespace orbit_vulkan_layer {
  * See also `DispatchTable` (for vulkan dispatch), `TimerQueryPool` (to manage the timestamp slots),
  * and `DeviceManager` (to retrieve device properties).
  *
- * Thread-Safety: This class is internally synchronized (using read/write locks), and can be
- * safely accessed from different threads. This is needed, as in Vulkan submits and command buffer
- * modifications can happen from multiple threads.
+ * Thread-Safety: This class is internally synchronized, and can be safely accessed from different
+ * threads. This is needed, as in Vulkan submits and command buffer modifications can happen from
+ * multiple threads. Engines typically record command buffers on many threads in parallel, so we
+ * avoid a global lock: Vulkan requires the application to externally synchronize the recording
+ * into a command buffer as well as the submissions to a queue. Therefore, the state of each command
+ * buffer and the state of each queue have their own lock, which is in practice only contended by
+ * `OnCaptureFinished` and `CompleteSubmits`, respectively. The maps from handles to these states
+ * are sharded and only locked for writing when command buffers or queues are added or removed.
  */
 template <class DispatchTable, class DeviceManager, class TimerQueryPool>
 class SubmissionTracker : public VulkanLayerProducer::CaptureStatusListener {
@@ -105,12 +120,12 @@ class SubmissionTracker : public VulkanLayerProducer::CaptureStatusListener {
 
   // Identifies a particular debug marker region that has been submitted via `vkQueueSubmit`.
   // Note that we only store the state into `QueueSubmission`, if at that time we have a value for
-  // the end_info. Beside the information about the begin/end, it also stores the label name, color
-  // and the depth of the marker.
+  // the end_info. Beside the information about the begin/end, it also stores the key of the
+  // interned label, the color and the depth of the marker.
   struct SubmittedMarkerSlice {
     std::optional<SubmittedMarker> begin_info;
     SubmittedMarker end_info;
-    std::string label_name;
+    uint64_t label_key;
     Color color;
     size_t depth;
   };
@@ -162,58 +177,71 @@ class SubmissionTracker : public VulkanLayerProducer::CaptureStatusListener {
   // markers will be discarded. If set to to std::numeric_limits<uint32_t>::max(), no debug marker
   // will be discarded.
   void SetMaxLocalMarkerDepthPerCommandBuffer(uint32_t max_local_marker_depth_per_command_buffer) {
-    max_local_marker_depth_per_command_buffer_ = max_local_marker_depth_per_command_buffer;
+    max_local_marker_depth_per_command_buffer_.store(max_local_marker_depth_per_command_buffer,
+                                                     std::memory_order_relaxed);
   }
 
   void TrackCommandBuffers(VkDevice device, VkCommandPool pool,
                            const VkCommandBuffer* command_buffers, uint32_t count) {
-    absl::WriterMutexLock lock(&mutex_);
-    auto associated_cbs_it = pool_to_command_buffers_.find(pool);
-    if (associated_cbs_it == pool_to_command_buffers_.end()) {
-      associated_cbs_it = pool_to_command_buffers_.try_emplace(pool).first;
+    {
+      absl::MutexLock lock(&command_pools_mutex_);
+      absl::flat_hash_set<VkCommandBuffer>& associated_command_buffers =
+          pool_to_command_buffers_[pool];
+      for (uint32_t i = 0; i < count; ++i) {
+        associated_command_buffers.insert(command_buffers[i]);
+      }
     }
     for (uint32_t i = 0; i < count; ++i) {
-      VkCommandBuffer cb = command_buffers[i];
-      associated_cbs_it->second.insert(cb);
-      command_buffer_to_device_[cb] = device;
+      VkCommandBuffer command_buffer = command_buffers[i];
+      CommandBufferShard& shard = GetCommandBufferShard(command_buffer);
+      absl::WriterMutexLock lock(&shard.mutex);
+      shard.command_buffers.try_emplace(command_buffer,
+                                        std::make_unique<TrackedCommandBuffer>(device));
     }
   }
 
   void UntrackCommandBuffers(VkDevice device, VkCommandPool pool,
                              const VkCommandBuffer* command_buffers, uint32_t count) {
-    absl::WriterMutexLock lock(&mutex_);
-    CHECK(pool_to_command_buffers_.contains(pool));
-    absl::flat_hash_set<VkCommandBuffer>& associated_command_buffers =
-        pool_to_command_buffers_.at(pool);
+    {
+      absl::MutexLock lock(&command_pools_mutex_);
+      CHECK(pool_to_command_buffers_.contains(pool));
+      absl::flat_hash_set<VkCommandBuffer>& associated_command_buffers =
+          pool_to_command_buffers_.at(pool);
+      for (uint32_t i = 0; i < count; ++i) {
+        associated_command_buffers.erase(command_buffers[i]);
+      }
+      if (associated_command_buffers.empty()) {
+        pool_to_command_buffers_.erase(pool);
+      }
+    }
+
     for (uint32_t i = 0; i < count; ++i) {
       VkCommandBuffer command_buffer = command_buffers[i];
-      associated_command_buffers.erase(command_buffer);
+      std::unique_ptr<TrackedCommandBuffer> tracked_command_buffer;
+      {
+        CommandBufferShard& shard = GetCommandBufferShard(command_buffer);
+        absl::WriterMutexLock lock(&shard.mutex);
+        auto node = shard.command_buffers.extract(command_buffer);
+        CHECK(!node.empty());
+        tracked_command_buffer = std::move(node.mapped());
+      }
+      CHECK(tracked_command_buffer->device == device);
 
       // vkFreeCommandBuffers (and thus this method) can be also called on command bufers in
       // "recording" or executable state and has similar effect as vkResetCommandBuffer has.
-      // In `OnCaptureFinished`, we reset all the timer slots left in `command_buffer_to_state_`.
-      // If we would not reset them here and clear the state, we would try to reset those command
-      // buffers there. However, the mapping to the device (which is needed) would be missing.
-      if (command_buffer_to_state_.contains(command_buffer)) {
-        // Note: This will "rollback" the slot indices (rather then actually resetting them on the
-        // Gpu). This is fine, as we remove the command buffer state right after submission. Thus,
-        // There can not be a value in the respective slot.
-        ResetCommandBufferUnsafe(command_buffer);
-
-        command_buffer_to_state_.erase(command_buffer);
-      }
-
-      CHECK(command_buffer_to_device_.contains(command_buffer));
-      CHECK(command_buffer_to_device_.at(command_buffer) == device);
-      command_buffer_to_device_.erase(command_buffer);
-    }
-    if (associated_command_buffers.empty()) {
-      pool_to_command_buffers_.erase(pool);
+      // In `OnCaptureFinished`, we reset all the timer slots of the tracked command buffers. As we
+      // stop tracking this command buffer, we need to take care of its slots here.
+      // Note: This will "rollback" the slot indices (rather then actually resetting them on the
+      // Gpu). This is fine, as we remove the command buffer state right after submission. Thus,
+      // There can not be a value in the respective slot.
+      absl::MutexLock lock(&tracked_command_buffer->mutex);
+      ResetCommandBufferLocked(tracked_command_buffer.get());
     }
   }
 
   void MarkCommandBufferBegin(VkCommandBuffer command_buffer) {
-    absl::WriterMutexLock lock(&mutex_);
+    TrackedCommandBuffer* tracked_command_buffer = GetTrackedCommandBuffer(command_buffer);
+    absl::MutexLock lock(&tracked_command_buffer->mutex);
     // Even when we are not capturing we create state for this command buffer to allow the
     // debug marker tracking. In order to compute the correct depth of a debug marker and being able
     // to match an "end" marker with the corresponding "begin" marker, we maintain a stack of all
@@ -222,34 +250,35 @@ class SubmissionTracker : public VulkanLayerProducer::CaptureStatusListener {
     // state here that allows us to store the debug markers into it and maintain that stack on
     // submission. We will not write timestamps in this case and thus don't store any information
     // other than the debug markers then.
-    {
-      if (command_buffer_to_state_.contains(command_buffer)) {
-        // We end up in this case, if we have used the command buffer before and want to write new
-        // commands to it without resetting the command buffer. Per specification,
-        // "vkBeginCommandBuffer" does also reset the command buffer, in addition to putting it
-        // into the executable state.
-        ResetCommandBufferUnsafe(command_buffer);
-      }
-      command_buffer_to_state_[command_buffer] = {};
+    if (tracked_command_buffer->state.has_value()) {
+      // We end up in this case, if we have used the command buffer before and want to write new
+      // commands to it without resetting the command buffer. Per specification,
+      // "vkBeginCommandBuffer" does also reset the command buffer, in addition to putting it
+      // into the executable state.
+      ResetCommandBufferLocked(tracked_command_buffer);
     }
-    if (!is_capturing_) {
+    tracked_command_buffer->state.emplace();
+
+    if (!is_capturing_.load()) {
       return;
     }
 
     uint32_t slot_index;
-    if (RecordTimestamp(command_buffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, &slot_index)) {
-      CHECK(command_buffer_to_state_.contains(command_buffer));
-      command_buffer_to_state_.at(command_buffer).command_buffer_begin_slot_index =
+    if (RecordTimestamp(command_buffer, tracked_command_buffer->device,
+                        VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, &slot_index,
+                        &num_dropped_command_buffer_timestamps_)) {
+      tracked_command_buffer->state->command_buffer_begin_slot_index =
           std::make_optional(slot_index);
     }
   }
 
   void MarkCommandBufferEnd(VkCommandBuffer command_buffer) {
-    absl::WriterMutexLock lock(&mutex_);
-    if (!is_capturing_) {
+    TrackedCommandBuffer* tracked_command_buffer = GetTrackedCommandBuffer(command_buffer);
+    absl::MutexLock lock(&tracked_command_buffer->mutex);
+    if (!is_capturing_.load()) {
       return;
     }
-    if (!command_buffer_to_state_.contains(command_buffer)) {
+    if (!tracked_command_buffer->state.has_value()) {
       ERROR_ONCE(
           "Calling vkEndCommandBuffer on a command buffer that is in the initial state "
           "(i.e. either freshly allocated or reset with vkResetCommandBuffer).");
@@ -257,67 +286,71 @@ class SubmissionTracker : public VulkanLayerProducer::CaptureStatusListener {
     }
 
     uint32_t slot_index;
-    if (RecordTimestamp(command_buffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, &slot_index)) {
-      // MarkCommandBufferBegin/End are called from within the same submit, and as the
-      // `MarkCommandBufferBegin` will always insert the state, we can assume that it is there.
-      CHECK(command_buffer_to_state_.contains(command_buffer));
-      CommandBufferState& command_buffer_state = command_buffer_to_state_.at(command_buffer);
-      command_buffer_state.command_buffer_end_slot_index = std::make_optional(slot_index);
+    if (RecordTimestamp(command_buffer, tracked_command_buffer->device,
+                        VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, &slot_index,
+                        &num_dropped_command_buffer_timestamps_)) {
+      tracked_command_buffer->state->command_buffer_end_slot_index = std::make_optional(slot_index);
     }
   }
 
   void MarkDebugMarkerBegin(VkCommandBuffer command_buffer, const char* text, Color color) {
-    absl::WriterMutexLock lock(&mutex_);
     // It is ensured by the Vulkan spec. that `text` must not be nullptr.
     CHECK(text != nullptr);
-    bool marker_depth_exceeds_maximum;
-    {
-      if (!command_buffer_to_state_.contains(command_buffer)) {
-        ERROR_ONCE(
-            "Calling vkCmdDebugMarkerBeginEXT/vkCmdBeginDebugUtilsLabelEXT on a command buffer "
-            "that is in the initial state (i.e. either freshly allocated or reset with "
-            "vkResetCommandBuffer).");
-        return;
+    TrackedCommandBuffer* tracked_command_buffer = GetTrackedCommandBuffer(command_buffer);
+    absl::MutexLock lock(&tracked_command_buffer->mutex);
+    if (!tracked_command_buffer->state.has_value()) {
+      ERROR_ONCE(
+          "Calling vkCmdDebugMarkerBeginEXT/vkCmdBeginDebugUtilsLabelEXT on a command buffer "
+          "that is in the initial state (i.e. either freshly allocated or reset with "
+          "vkResetCommandBuffer).");
+      return;
+    }
+    CommandBufferState& state = tracked_command_buffer->state.value();
+    ++state.local_marker_stack_size;
+    bool marker_depth_exceeds_maximum =
+        state.local_marker_stack_size >
+        max_local_marker_depth_per_command_buffer_.load(std::memory_order_relaxed);
+    const bool is_capturing = is_capturing_.load();
+    Marker marker{.type = MarkerType::kDebugMarkerBegin,
+                  .color = color,
+                  .cut_off = marker_depth_exceeds_maximum};
+    // The label of a marker that is cut off is never needed. Otherwise, only copy the label if it
+    // can't be interned yet, see `Marker`.
+    if (!marker_depth_exceeds_maximum) {
+      if (is_capturing) {
+        marker.label_key = InternMarkerLabel(text);
+      } else {
+        marker.label_name = text;
       }
-      CHECK(command_buffer_to_state_.contains(command_buffer));
-      CommandBufferState& state = command_buffer_to_state_.at(command_buffer);
-      ++state.local_marker_stack_size;
-      marker_depth_exceeds_maximum =
-          state.local_marker_stack_size > max_local_marker_depth_per_command_buffer_;
-      Marker marker{.type = MarkerType::kDebugMarkerBegin,
-                    .label_name = std::string(text),
-                    .color = color,
-                    .cut_off = marker_depth_exceeds_maximum};
-      state.markers.emplace_back(std::move(marker));
-    }
-
-    if (!is_capturing_ || marker_depth_exceeds_maximum) {
+    }
+    state.markers.emplace_back(std::move(marker));
+
+    if (!is_capturing || marker_depth_exceeds_maximum) {
       return;
     }
 
     uint32_t slot_index;
-    if (RecordTimestamp(command_buffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, &slot_index)) {
-      CHECK(command_buffer_to_state_.contains(command_buffer));
-      CommandBufferState& state = command_buffer_to_state_.at(command_buffer);
+    if (RecordTimestamp(command_buffer, tracked_command_buffer->device,
+                        VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, &slot_index,
+                        &num_dropped_debug_marker_timestamps_)) {
       state.markers.back().slot_index = std::make_optional(slot_index);
     }
   }
 
   void MarkDebugMarkerEnd(VkCommandBuffer command_buffer) {
-    absl::WriterMutexLock lock(&mutex_);
-    bool marker_depth_exceeds_maximum;
-
-    if (!command_buffer_to_state_.contains(command_buffer)) {
+    TrackedCommandBuffer* tracked_command_buffer = GetTrackedCommandBuffer(command_buffer);
+    absl::MutexLock lock(&tracked_command_buffer->mutex);
+    if (!tracked_command_buffer->state.has_value()) {
       ERROR_ONCE(
           "Calling vkCmdDebugMarkerEndEXT/vkCmdEndDebugUtilsLabelEXT on a command buffer "
           "that is in the initial state (i.e. either freshly allocated or reset with "
           "vkResetCommandBuffer).");
       return;
     }
-    CHECK(command_buffer_to_state_.contains(command_buffer));
-    CommandBufferState& state = command_buffer_to_state_.at(command_buffer);
-    marker_depth_exceeds_maximum =
-        state.local_marker_stack_size > max_local_marker_depth_per_command_buffer_;
+    CommandBufferState& state = tracked_command_buffer->state.value();
+    bool marker_depth_exceeds_maximum =
+        state.local_marker_stack_size >
+        max_local_marker_depth_per_command_buffer_.load(std::memory_order_relaxed);
     Marker marker{.type = MarkerType::kDebugMarkerEnd, .cut_off = marker_depth_exceeds_maximum};
     state.markers.emplace_back(std::move(marker));
     // We might see more "ends" than "begins", as the "begins" can be on a different command
@@ -326,14 +359,14 @@ class SubmissionTracker : public VulkanLayerProducer::CaptureStatusListener {
       --state.local_marker_stack_size;
     }
 
-    if (!is_capturing_ || marker_depth_exceeds_maximum) {
+    if (!is_capturing_.load() || marker_depth_exceeds_maximum) {
       return;
     }
 
     uint32_t slot_index;
-    if (RecordTimestamp(command_buffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, &slot_index)) {
-      CHECK(command_buffer_to_state_.contains(command_buffer));
-      CommandBufferState& state = command_buffer_to_state_.at(command_buffer);
+    if (RecordTimestamp(command_buffer, tracked_command_buffer->device,
+                        VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, &slot_index,
+                        &num_dropped_debug_marker_timestamps_)) {
       state.markers.back().slot_index = std::make_optional(slot_index);
     }
   }
@@ -349,8 +382,7 @@ class SubmissionTracker : public VulkanLayerProducer::CaptureStatusListener {
   // This allows us to map submissions from the Vulkan layer to the driver submissions.
   [[nodiscard]] std::optional<QueueSubmission> PersistCommandBuffersOnSubmit(
       VkQueue queue, uint32_t submit_count, const VkSubmitInfo* submits) {
-    absl::WriterMutexLock lock(&mutex_);
-    if (!is_capturing_) {
+    if (!is_capturing_.load()) {
       // `OnCaptureFinished` has already been called and has taken care of resetting slots.
       return std::nullopt;
     }
@@ -375,7 +407,11 @@ class SubmissionTracker : public VulkanLayerProducer::CaptureStatusListener {
       for (uint32_t command_buffer_index = 0; command_buffer_index < submit_info.commandBufferCount;
            ++command_buffer_index) {
         VkCommandBuffer command_buffer = submit_info.pCommandBuffers[command_buffer_index];
-        PersistSingleCommandBufferOnSubmit(device, command_buffer, &queue_submission,
+        TrackedCommandBuffer* tracked_command_buffer = GetTrackedCommandBuffer(command_buffer);
+        if (device == VK_NULL_HANDLE) {
+          device = tracked_command_buffer->device;
+        }
+        PersistSingleCommandBufferOnSubmit(tracked_command_buffer, &queue_submission,
                                            &submitted_submit_info, &query_slots_not_needed_to_read);
       }
     }
@@ -394,7 +430,7 @@ class SubmissionTracker : public VulkanLayerProducer::CaptureStatusListener {
   // This method is supposed to be called right after the driver call of `vkQueuePresent`.
   // At that point in time we can complete the submission meta information (add the timestamp) and
   // know the order of the debug markers across command buffers. We will maintain the debug marker
-  // stack in `queue_to_markers_` and if capturing also write the information about completed debug
+  // stack of the `QueueState` and if capturing also write the information about completed debug
   // markers into the `QueueSubmission`, to make it persistent across submissions and such that it
   // can be picked up later (on a vkQueuePresentKHR) to retrieve the timer results and send the data
   // to the client.
@@ -406,12 +442,9 @@ class SubmissionTracker : public VulkanLayerProducer::CaptureStatusListener {
   void PersistDebugMarkersOnSubmit(VkQueue queue, uint32_t submit_count,
                                    const VkSubmitInfo* submits,
                                    std::optional<QueueSubmission> queue_submission_optional) {
-    absl::WriterMutexLock lock(&mutex_);
-    if (!queue_to_markers_.contains(queue)) {
-      queue_to_markers_[queue] = {};
-    }
-    CHECK(queue_to_markers_.contains(queue));
-    QueueMarkerState& markers = queue_to_markers_.at(queue);
+    QueueState* queue_state = GetOrCreateQueueState(queue);
+    absl::MutexLock lock(&queue_state->mutex);
+    QueueMarkerState& markers = queue_state->markers;
 
     // If we consider that we are still capturing, take a cpu timestamp as "post submission" such
     // that the submission "meta information" is complete. We can then attach that also to each
@@ -428,12 +461,13 @@ class SubmissionTracker : public VulkanLayerProducer::CaptureStatusListener {
       for (uint32_t command_buffer_index = 0; command_buffer_index < submit_info.commandBufferCount;
            ++command_buffer_index) {
         VkCommandBuffer command_buffer = submit_info.pCommandBuffers[command_buffer_index];
+        TrackedCommandBuffer* tracked_command_buffer = GetTrackedCommandBuffer(command_buffer);
         if (device == VK_NULL_HANDLE) {
-          CHECK(command_buffer_to_device_.contains(command_buffer));
-          device = command_buffer_to_device_.at(command_buffer);
+          device = tracked_command_buffer->device;
         }
-        PersistDebugMarkersOfASingleCommandBufferOnSubmit(
-            command_buffer, &queue_submission_optional, &markers, &marker_slots_not_needed_to_read);
+        PersistDebugMarkersOfASingleCommandBufferOnSubmit(tracked_command_buffer,
+                                                          &queue_submission_optional, &markers,
+                                                          &marker_slots_not_needed_to_read);
       }
     }
 
@@ -445,106 +479,89 @@ class SubmissionTracker : public VulkanLayerProducer::CaptureStatusListener {
       return;
     }
 
-    if (!queue_to_submission_priority_queue_.contains(queue)) {
-      queue_to_submission_priority_queue_.emplace(queue, kPreSubmissionCpuTimestampComparator);
-    }
-
-    queue_to_submission_priority_queue_.at(queue).emplace(
-        std::move(queue_submission_optional.value()));
+    // Submissions to a queue are externally synchronized, so the new submission is typically the
+    // most recent one. Still, keep the pending submissions sorted by the CPU timestamp.
+    auto& submissions = queue_state->submissions;
+    auto insertion_point =
+        std::upper_bound(submissions.begin(), submissions.end(), queue_submission_optional.value(),
+                         kPreSubmissionCpuTimestampComparator);
+    submissions.insert(insertion_point, std::move(queue_submission_optional.value()));
   }
 
   // This method is responsible for retrieving all the timestamps for the "completed" submissions,
   // for transforming the information of those submissions (in particular about the command buffers
-  // and debug markers) into the `GpuQueueSubmission` proto, and for sending it to the
-  // `VulkanLayerProducer`. We consider a submission to be "completed" when all timestamps that are
-  // associated with this submission are ready.
-  // We maintain a priority queue (for every `VkQueue`) `submissions_queue_` and process submissions
-  // with the oldest CPU timestamp, until we encounter the first "incomplete" submission.
-  // This way, we ensure that we will send the submission information per queue ordered by the
-  // CPU timestamp.
-  // Beside the timestamps of command buffers and the meta information of the submission, the proto
+  // and debug markers) into a flat `GpuQueueSubmissionEvent`, and for sending it to the
+  // `VulkanLayerProducer`, which only builds the `GpuQueueSubmission` proto when forwarding it.
+  // We consider a submission to be "completed" when all timestamps that are associated with this
+  // submission are ready.
+  // We maintain the pending submissions of every `VkQueue` sorted by the CPU timestamp and process
+  // submissions with the oldest CPU timestamp, until we encounter the first "incomplete"
+  // submission. This way, we ensure that we will send the submission information per queue ordered
+  // by the CPU timestamp.
+  // Beside the timestamps of command buffers and the meta information of the submission, the event
   // also contains the debug markers, "begin" (even if submitted in a different submission) and
   // "end", that got completed in this submission.
-  // See also `WriteMetaInfo`, `WriteCommandBufferTimings` and `WriteDebugMarkers`.
-  // This method also resets all the timer slots that have been read.
+  // The timestamps of all pending submissions are read back in one batch, with a single call to
+  // `vkGetQueryPoolResults` per range of contiguous query slots (see `QueryGpuTimestampsNs`).
+  // See also `CreateMetaInfoRecord`, `WriteCommandBufferTimings` and `WriteDebugMarkers`.
+  // This method also releases all the timer slots that have been read, and resets the content of
+  // all released slots in the `TimerQueryPool`.
   // It is assumed to be called periodically, e.g. on `vkQueuePresentKHR`.
   void CompleteSubmits(VkDevice device) {
-    absl::WriterMutexLock lock(&mutex_);
-    VkQueryPool query_pool = timer_query_pool_->GetQueryPool(device);
+    // Only this method marks slots of pending submissions as done reading. Serializing it ensures
+    // that the slots collected below can't be released and reused before their results are used.
+    absl::MutexLock complete_submits_lock(&complete_submits_mutex_);
 
-    if (queue_to_submission_priority_queue_.empty()) {
-      return;
+    std::vector<QueueState*> queue_states;
+    {
+      absl::ReaderMutexLock lock(&queues_mutex_);
+      queue_states.reserve(queue_to_state_.size());
+      for (const auto& [unused_queue, queue_state] : queue_to_state_) {
+        queue_states.push_back(queue_state.get());
+      }
     }
 
-    VkPhysicalDevice physical_device = device_manager_->GetPhysicalDeviceOfLogicalDevice(device);
-    const float timestamp_period =
-        device_manager_->GetPhysicalDeviceProperties(physical_device).limits.timestampPeriod;
-
-    std::vector<uint32_t> query_slots_done_reading = {};
-    std::vector<QueueSubmission> submissions_to_send = {};
-
-    // The submits of a specific queue in `submissions_queue_` are sorted by "pre submission CPU"
-    // timestamp and we want to make sure we send events to the client in that order. Therefore, we
-    // stop as soon as a query failed.
-    for (auto& [unused_queue, submissions] : queue_to_submission_priority_queue_) {
-      while (!submissions.empty()) {
-        QueueSubmission completed_submission = submissions.top();
-        submissions.pop();
-        bool command_buffer_queries_succeeded = QueryCommandBufferTimestamps(
-            &completed_submission, &query_slots_done_reading, device, query_pool, timestamp_period);
-
-        // We only need to read the debug marker timestamps, if querying the command buffers
-        // succeeded.
-        bool marker_queries_succeeded = false;
-        if (command_buffer_queries_succeeded) {
-          marker_queries_succeeded =
-              QueryDebugMarkerTimestamps(&completed_submission, &query_slots_done_reading, device,
-                                         query_pool, timestamp_period);
-        }
-
-        if (command_buffer_queries_succeeded && marker_queries_succeeded) {
-          submissions_to_send.emplace_back(std::move(completed_submission));
-        } else {
-          submissions.emplace(std::move(completed_submission));
-          break;
-        }
+    std::vector<uint32_t> pending_query_slots;
+    for (QueueState* queue_state : queue_states) {
+      absl::MutexLock lock(&queue_state->mutex);
+      for (const QueueSubmission& submission : queue_state->submissions) {
+        CollectPendingQuerySlots(submission, &pending_query_slots);
       }
     }
 
-    for (const auto& completed_submission : submissions_to_send) {
-      orbit_grpc_protos::ProducerCaptureEvent capture_event;
-      orbit_grpc_protos::GpuQueueSubmission* submission_proto =
-          capture_event.mutable_gpu_queue_submission();
-
-      WriteMetaInfo(completed_submission.meta_information, submission_proto->mutable_meta_info());
-      bool has_command_buffer_timestamps =
-          WriteCommandBufferTimings(completed_submission, submission_proto);
-      bool has_debug_marker_timestamps = WriteDebugMarkers(completed_submission, submission_proto);
-
-      if (vulkan_layer_producer_ != nullptr &&
-          (has_command_buffer_timestamps || has_debug_marker_timestamps)) {
-        vulkan_layer_producer_->EnqueueCaptureEvent(std::move(capture_event));
+    std::vector<uint32_t> query_slots_done_reading = {};
+    if (!pending_query_slots.empty()) {
+      absl::flat_hash_map<uint32_t, uint64_t> slot_to_timestamp_ns =
+          QueryGpuTimestampsNs(device, std::move(pending_query_slots));
+
+      for (QueueState* queue_state : queue_states) {
+        // The lock is held until the events of this queue are enqueued, such that concurrent calls
+        // (e.g. from presents on different queues) can not reorder the submissions of a queue.
+        absl::MutexLock lock(&queue_state->mutex);
+        CompleteSubmitsOfQueue(queue_state, slot_to_timestamp_ns, &query_slots_done_reading);
       }
     }
 
     if (!query_slots_done_reading.empty()) {
       timer_query_pool_->MarkQuerySlotsDoneReading(device, query_slots_done_reading);
     }
+    timer_query_pool_->ResetReleasedQuerySlots(device);
+    ReportDroppedTimestamps();
   }
 
   void ResetCommandBuffer(VkCommandBuffer command_buffer) {
-    absl::WriterMutexLock lock(&mutex_);
-    ResetCommandBufferUnsafe(command_buffer);
+    TrackedCommandBuffer* tracked_command_buffer = GetTrackedCommandBuffer(command_buffer);
+    absl::MutexLock lock(&tracked_command_buffer->mutex);
+    ResetCommandBufferLocked(tracked_command_buffer);
   }
 
   void ResetCommandPool(VkCommandPool command_pool) {
     absl::flat_hash_set<VkCommandBuffer> command_buffers;
     {
-      absl::ReaderMutexLock lock(&mutex_);
+      absl::MutexLock lock(&command_pools_mutex_);
       if (!pool_to_command_buffers_.contains(command_pool)) {
         return;
       }
-      CHECK(pool_to_command_buffers_.contains(command_pool));
       command_buffers = pool_to_command_buffers_.at(command_pool);
     }
     for (const auto& command_buffer : command_buffers) {
@@ -553,59 +570,69 @@ class SubmissionTracker : public VulkanLayerProducer::CaptureStatusListener {
   }
 
   void OnCaptureStart(orbit_grpc_protos::CaptureOptions capture_options) override {
-    absl::WriterMutexLock lock(&mutex_);
     SetMaxLocalMarkerDepthPerCommandBuffer(
         capture_options.max_local_marker_depth_per_command_buffer());
-    is_capturing_ = true;
+    // Don't report timestamps that were dropped in a previous capture.
+    num_dropped_command_buffer_timestamps_.store(0, std::memory_order_relaxed);
+    num_dropped_debug_marker_timestamps_.store(0, std::memory_order_relaxed);
+    is_capturing_.store(true);
   }
 
-  void OnCaptureStop() override {}
+  void OnCaptureStop() override { ReportDroppedTimestamps(); }
 
   void OnCaptureFinished() override {
-    absl::WriterMutexLock lock(&mutex_);
-    std::vector<uint32_t> slots_not_needed_to_read_anymore;
-
-    VkDevice device = VK_NULL_HANDLE;
-
-    for (auto& [command_buffer, command_buffer_state] : command_buffer_to_state_) {
-      if (command_buffer_state.pre_submission_cpu_timestamp.has_value()) continue;
-      if (device == VK_NULL_HANDLE) {
-        CHECK(command_buffer_to_device_.contains(command_buffer));
-        device = command_buffer_to_device_.at(command_buffer);
-      }
-      if (command_buffer_state.command_buffer_begin_slot_index.has_value()) {
-        slots_not_needed_to_read_anymore.push_back(
-            command_buffer_state.command_buffer_begin_slot_index.value());
-        command_buffer_state.command_buffer_begin_slot_index.reset();
-      }
+    // Set this first: Every command buffer that acquires its lock after we have visited it below
+    // will observe that we are not capturing anymore and will not record timestamps.
+    is_capturing_.store(false);
+
+    absl::flat_hash_map<VkDevice, std::vector<uint32_t>> slots_not_needed_to_read_anymore;
+    for (CommandBufferShard& shard : command_buffer_shards_) {
+      absl::ReaderMutexLock shard_lock(&shard.mutex);
+      for (auto& [unused_command_buffer, tracked_command_buffer] : shard.command_buffers) {
+        absl::MutexLock lock(&tracked_command_buffer->mutex);
+        if (!tracked_command_buffer->state.has_value()) continue;
+        CommandBufferState& command_buffer_state = tracked_command_buffer->state.value();
+        if (command_buffer_state.pre_submission_cpu_timestamp.has_value()) continue;
+        std::vector<uint32_t>& device_slots =
+            slots_not_needed_to_read_anymore[tracked_command_buffer->device];
+
+        if (command_buffer_state.command_buffer_begin_slot_index.has_value()) {
+          device_slots.push_back(command_buffer_state.command_buffer_begin_slot_index.value());
+          command_buffer_state.command_buffer_begin_slot_index.reset();
+        }
 
-      if (command_buffer_state.command_buffer_end_slot_index.has_value()) {
-        slots_not_needed_to_read_anymore.push_back(
-            command_buffer_state.command_buffer_end_slot_index.value());
-        command_buffer_state.command_buffer_end_slot_index.reset();
-      }
+        if (command_buffer_state.command_buffer_end_slot_index.has_value()) {
+          device_slots.push_back(command_buffer_state.command_buffer_end_slot_index.value());
+          command_buffer_state.command_buffer_end_slot_index.reset();
+        }
 
-      for (Marker& marker : command_buffer_state.markers) {
-        if (marker.slot_index.has_value()) {
-          slots_not_needed_to_read_anymore.push_back(marker.slot_index.value());
-          marker.slot_index.reset();
+        for (Marker& marker : command_buffer_state.markers) {
+          if (marker.slot_index.has_value()) {
+            device_slots.push_back(marker.slot_index.value());
+            marker.slot_index.reset();
+          }
         }
       }
     }
-    if (!slots_not_needed_to_read_anymore.empty()) {
-      timer_query_pool_->MarkQuerySlotsDoneReading(device, slots_not_needed_to_read_anymore);
-    }
 
-    is_capturing_ = false;
+    for (const auto& [device, slots] : slots_not_needed_to_read_anymore) {
+      if (!slots.empty()) {
+        timer_query_pool_->MarkQuerySlotsDoneReading(device, slots);
+      }
+    }
   }
 
  private:
   enum class MarkerType { kDebugMarkerBegin = 0, kDebugMarkerEnd };
 
+  // For begin markers recorded while capturing, the label is interned right away and only its key
+  // is carried along. Otherwise, the label itself is kept until a submission while capturing, as
+  // its key is only valid once the producer has sent the interned string in the current capture.
   struct Marker {
     MarkerType type;
     std::optional<uint32_t> slot_index;
-    std::optional<std::string> label_name;
+    std::optional<uint64_t> label_key;
+    std::string label_name;
     std::optional<Color> color;
     bool cut_off;
   };
@@ -622,6 +649,8 @@ class SubmissionTracker : public VulkanLayerProducer::CaptureStatusListener {
   // Submission 2: End("Bar"), End("Foo") -- We now know that the first end needs to be thrown away.
   struct MarkerState {
     std::optional<SubmittedMarker> begin_info;
+    // Same as in `Marker`.
+    std::optional<uint64_t> label_key;
     std::string label_name;
     Color color;
     size_t depth;
@@ -637,64 +666,262 @@ class SubmissionTracker : public VulkanLayerProducer::CaptureStatusListener {
     std::optional<uint32_t> command_buffer_end_slot_index;
     std::optional<uint64_t> pre_submission_cpu_timestamp;
     std::vector<Marker> markers;
-    uint32_t local_marker_stack_size;
+    uint32_t local_marker_stack_size = 0;
+  };
+
+  // A command buffer between its allocation and its destruction. `state` is empty while the command
+  // buffer is in the initial state. Vulkan requires the application to externally synchronize the
+  // recording into, the submission and the reset of a command buffer, so `mutex` is effectively
+  // owned by the thread that currently works with the command buffer. Other threads only take it
+  // in `OnCaptureFinished`.
+  struct TrackedCommandBuffer {
+    explicit TrackedCommandBuffer(VkDevice device) : device(device) {}
+
+    const VkDevice device;
+    absl::Mutex mutex;
+    std::optional<CommandBufferState> state;
+  };
+
+  // The maps from command buffer to `TrackedCommandBuffer` are split into shards to avoid that all
+  // recording threads contend on the same lock when looking up their command buffer. The lock of a
+  // shard is only taken for writing on (de-)allocation of command buffers.
+  static constexpr size_t kNumCommandBufferShards = 64;
+  struct alignas(64) CommandBufferShard {
+    absl::Mutex mutex;
+    absl::flat_hash_map<VkCommandBuffer, std::unique_ptr<TrackedCommandBuffer>> command_buffers;
+  };
+
+  static constexpr auto kPreSubmissionCpuTimestampComparator =
+      [](const QueueSubmission& lhs, const QueueSubmission& rhs) -> bool {
+    return lhs.meta_information.pre_submission_cpu_timestamp <
+           rhs.meta_information.pre_submission_cpu_timestamp;
   };
 
-  bool RecordTimestamp(VkCommandBuffer command_buffer, VkPipelineStageFlagBits pipeline_stage_flags,
-                       uint32_t* slot_index) {
-    mutex_.AssertReaderHeld();
-    VkDevice device;
+  // The debug marker stack and the pending submissions of a queue. `PersistDebugMarkersOnSubmit`
+  // is called with the queue externally synchronized, so `mutex` is only contended by
+  // `CompleteSubmits`. `submissions` is sorted by `kPreSubmissionCpuTimestampComparator`.
+  struct QueueState {
+    absl::Mutex mutex;
+    QueueMarkerState markers;
+    std::deque<QueueSubmission> submissions;
+  };
+
+  [[nodiscard]] CommandBufferShard& GetCommandBufferShard(VkCommandBuffer command_buffer) {
+    return command_buffer_shards_[absl::Hash<VkCommandBuffer>{}(command_buffer) %
+                                  kNumCommandBufferShards];
+  }
+
+  // The returned pointer stays valid until the command buffer gets untracked, which, per Vulkan
+  // specification, can't happen while the command buffer is still in use.
+  [[nodiscard]] TrackedCommandBuffer* GetTrackedCommandBuffer(VkCommandBuffer command_buffer) {
+    CommandBufferShard& shard = GetCommandBufferShard(command_buffer);
+    absl::ReaderMutexLock lock(&shard.mutex);
+    auto it = shard.command_buffers.find(command_buffer);
+    CHECK(it != shard.command_buffers.end());
+    return it->second.get();
+  }
+
+  [[nodiscard]] QueueState* GetOrCreateQueueState(VkQueue queue) {
     {
-      CHECK(command_buffer_to_device_.contains(command_buffer));
-      device = command_buffer_to_device_.at(command_buffer);
+      absl::ReaderMutexLock lock(&queues_mutex_);
+      auto it = queue_to_state_.find(queue);
+      if (it != queue_to_state_.end()) {
+        return it->second.get();
+      }
     }
+    absl::WriterMutexLock lock(&queues_mutex_);
+    auto [it, unused_inserted] = queue_to_state_.try_emplace(queue, std::make_unique<QueueState>());
+    return it->second.get();
+  }
 
-    VkQueryPool query_pool = timer_query_pool_->GetQueryPool(device);
-
+  // Writes a timestamp into a newly acquired query slot. If all slots are occupied, the timestamp
+  // is dropped and counted in `num_dropped_timestamps`, to be reported by
+  // `ReportDroppedTimestamps`.
+  bool RecordTimestamp(VkCommandBuffer command_buffer, VkDevice device,
+                       VkPipelineStageFlagBits pipeline_stage_flags, uint32_t* slot_index,
+                       std::atomic<uint64_t>* num_dropped_timestamps) {
     if (!timer_query_pool_->NextReadyQuerySlot(device, slot_index)) {
+      num_dropped_timestamps->fetch_add(1, std::memory_order_relaxed);
       return false;
     }
-    dispatch_table_->CmdWriteTimestamp(command_buffer)(command_buffer, pipeline_stage_flags,
-                                                       query_pool, *slot_index);
+    VkQueryPool query_pool = timer_query_pool_->GetQueryPool(device, *slot_index);
+    dispatch_table_->CmdWriteTimestamp(command_buffer)(
+        command_buffer, pipeline_stage_flags, query_pool,
+        timer_query_pool_->GetQueryIndexInPool(*slot_index));
 
     return true;
   }
 
-  std::optional<uint64_t> QueryGpuTimestampNs(VkDevice device, VkQueryPool query_pool,
-                                              uint32_t slot_index, float timestamp_period) {
-    static constexpr VkDeviceSize kResultStride = sizeof(uint64_t);
+  // Sends a `GpuQuerySlotsExhaustedEvent` if timestamps were dropped since the last call, as the
+  // GPU timings of the capture are incomplete in that case.
+  void ReportDroppedTimestamps() {
+    uint64_t num_dropped_command_buffer_timestamps =
+        num_dropped_command_buffer_timestamps_.exchange(0, std::memory_order_relaxed);
+    uint64_t num_dropped_debug_marker_timestamps =
+        num_dropped_debug_marker_timestamps_.exchange(0, std::memory_order_relaxed);
+    if (num_dropped_command_buffer_timestamps == 0 && num_dropped_debug_marker_timestamps == 0) {
+      return;
+    }
+    ERROR_ONCE("Ran out of timestamp query slots, GPU timings of this capture are incomplete");
+    if (vulkan_layer_producer_ == nullptr) {
+      return;
+    }
+
+    orbit_grpc_protos::ProducerCaptureEvent capture_event;
+    orbit_grpc_protos::GpuQuerySlotsExhaustedEvent* exhausted_event =
+        capture_event.mutable_gpu_query_slots_exhausted_event();
+    exhausted_event->set_pid(orbit_base::GetCurrentProcessId());
+    exhausted_event->set_timestamp_ns(orbit_base::CaptureTimestampNs());
+    exhausted_event->set_num_dropped_command_buffer_timestamps(
+        num_dropped_command_buffer_timestamps);
+    exhausted_event->set_num_dropped_debug_marker_timestamps(num_dropped_debug_marker_timestamps);
+    vulkan_layer_producer_->EnqueueCaptureEvent(std::move(capture_event));
+  }
+
+  // Reads the timestamps of the given query slots. Slots with contiguous indices in the same
+  // `VkQueryPool` are read with a single call to `vkGetQueryPoolResults`, which also reports the
+  // availability of each slot, such that one slot that is not yet available does not fail the whole
+  // range. Returns the timestamps, converted to nanoseconds, of all slots that were available.
+  [[nodiscard]] absl::flat_hash_map<uint32_t, uint64_t> QueryGpuTimestampsNs(
+      VkDevice device, std::vector<uint32_t> slot_indices) {
+    VkPhysicalDevice physical_device = device_manager_->GetPhysicalDeviceOfLogicalDevice(device);
+    const float timestamp_period =
+        device_manager_->GetPhysicalDeviceProperties(physical_device).limits.timestampPeriod;
 
-    uint64_t timestamp = 0;
-    VkResult result_status = dispatch_table_->GetQueryPoolResults(device)(
-        device, query_pool, slot_index, 1, sizeof(timestamp), &timestamp, kResultStride,
-        VK_QUERY_RESULT_64_BIT);
+    std::sort(slot_indices.begin(), slot_indices.end());
+    slot_indices.erase(std::unique(slot_indices.begin(), slot_indices.end()), slot_indices.end());
+
+    // Each result consists of the timestamp followed by its availability.
+    static constexpr VkDeviceSize kResultStride = 2 * sizeof(uint64_t);
+    absl::flat_hash_map<uint32_t, uint64_t> slot_to_timestamp_ns;
+    std::vector<uint64_t> results;
+    size_t range_begin = 0;
+    while (range_begin < slot_indices.size()) {
+      size_t range_end = range_begin + 1;
+      while (range_end < slot_indices.size() &&
+             slot_indices[range_end] == slot_indices[range_end - 1] + 1 &&
+             timer_query_pool_->GetQueryIndexInPool(slot_indices[range_end]) != 0) {
+        ++range_end;
+      }
+      const uint32_t first_slot_index = slot_indices[range_begin];
+      const uint32_t slot_count = static_cast<uint32_t>(range_end - range_begin);
+      range_begin = range_end;
+
+      results.assign(2 * static_cast<size_t>(slot_count), 0);
+      VkResult result_status = dispatch_table_->GetQueryPoolResults(device)(
+          device, timer_query_pool_->GetQueryPool(device, first_slot_index),
+          timer_query_pool_->GetQueryIndexInPool(first_slot_index), slot_count,
+          results.size() * sizeof(uint64_t), results.data(), kResultStride,
+          VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WITH_AVAILABILITY_BIT);
+      // `VK_NOT_READY` means that some of the slots in the range are not yet available.
+      if (result_status != VK_SUCCESS && result_status != VK_NOT_READY) {
+        continue;
+      }
 
-    if (result_status != VK_SUCCESS) {
-      return std::nullopt;
+      for (uint32_t i = 0; i < slot_count; ++i) {
+        if (results[2 * i + 1] == 0) continue;
+        slot_to_timestamp_ns.emplace(
+            first_slot_index + i,
+            static_cast<uint64_t>(static_cast<double>(results[2 * i]) * timestamp_period));
+      }
+    }
+    return slot_to_timestamp_ns;
+  }
+
+  // Appends the slots of all timestamps of `submission` that were not read yet.
+  static void CollectPendingQuerySlots(const QueueSubmission& submission,
+                                       std::vector<uint32_t>* query_slots) {
+    for (const auto& submit_info : submission.submit_infos) {
+      for (const auto& command_buffer : submit_info.command_buffers) {
+        if (!command_buffer.end_timestamp.has_value()) {
+          CHECK(command_buffer.command_buffer_end_slot_index.has_value());
+          query_slots->push_back(command_buffer.command_buffer_end_slot_index.value());
+        }
+        if (command_buffer.command_buffer_begin_slot_index.has_value() &&
+            !command_buffer.begin_timestamp.has_value()) {
+          query_slots->push_back(command_buffer.command_buffer_begin_slot_index.value());
+        }
+      }
     }
+    for (const auto& marker_slice : submission.completed_markers) {
+      if (!marker_slice.end_info.timestamp.has_value()) {
+        query_slots->push_back(marker_slice.end_info.slot_index);
+      }
+      if (marker_slice.begin_info.has_value() && !marker_slice.begin_info->timestamp.has_value()) {
+        query_slots->push_back(marker_slice.begin_info->slot_index);
+      }
+    }
+  }
+
+  // Sends the completed submissions of a queue in the order of their CPU timestamp, using the
+  // timestamps read by `QueryGpuTimestampsNs`.
+  void CompleteSubmitsOfQueue(QueueState* queue_state,
+                              const absl::flat_hash_map<uint32_t, uint64_t>& slot_to_timestamp_ns,
+                              std::vector<uint32_t>* query_slots_done_reading)
+      ABSL_EXCLUSIVE_LOCKS_REQUIRED(queue_state->mutex, complete_submits_mutex_) {
+    // The submits of a specific queue in `submissions` are sorted by "pre submission CPU"
+    // timestamp and we want to make sure we send events to the client in that order. Therefore,
+    // we stop as soon as a query failed.
+    auto& submissions = queue_state->submissions;
+    while (!submissions.empty()) {
+      QueueSubmission& completed_submission = submissions.front();
+      bool command_buffer_queries_succeeded = QueryCommandBufferTimestamps(
+          &completed_submission, query_slots_done_reading, slot_to_timestamp_ns);
+
+      // We only need to read the debug marker timestamps, if querying the command buffers
+      // succeeded.
+      bool marker_queries_succeeded = false;
+      if (command_buffer_queries_succeeded) {
+        marker_queries_succeeded = QueryDebugMarkerTimestamps(
+            &completed_submission, query_slots_done_reading, slot_to_timestamp_ns);
+      }
+
+      if (!command_buffer_queries_succeeded || !marker_queries_succeeded) {
+        break;
+      }
+
+      // The event is reused for all submissions, so that no allocation is needed once its vectors
+      // have grown large enough.
+      GpuQueueSubmissionEvent& event = gpu_queue_submission_event_;
+      event.Clear();
+      event.meta_info = CreateMetaInfoRecord(completed_submission.meta_information);
+      bool has_command_buffer_timestamps = WriteCommandBufferTimings(completed_submission, &event);
+      bool has_debug_marker_timestamps = WriteDebugMarkers(completed_submission, &event);
 
-    return static_cast<uint64_t>(static_cast<double>(timestamp) * timestamp_period);
+      if (vulkan_layer_producer_ != nullptr &&
+          (has_command_buffer_timestamps || has_debug_marker_timestamps)) {
+        vulkan_layer_producer_->EnqueueGpuQueueSubmission(event);
+      }
+      submissions.pop_front();
+    }
+  }
+
+  [[nodiscard]] static std::optional<uint64_t> LookupTimestampNs(
+      const absl::flat_hash_map<uint32_t, uint64_t>& slot_to_timestamp_ns, uint32_t slot_index) {
+    auto it = slot_to_timestamp_ns.find(slot_index);
+    if (it == slot_to_timestamp_ns.end()) {
+      return std::nullopt;
+    }
+    return it->second;
   }
 
-  static void WriteMetaInfo(const SubmissionMetaInformation& meta_info,
-                            orbit_grpc_protos::GpuQueueSubmissionMetaInfo* target_proto) {
-    target_proto->set_tid(meta_info.thread_id);
-    target_proto->set_pid(meta_info.process_id);
-    target_proto->set_pre_submission_cpu_timestamp(meta_info.pre_submission_cpu_timestamp);
-    target_proto->set_post_submission_cpu_timestamp(meta_info.post_submission_cpu_timestamp);
+  [[nodiscard]] static orbit_producer_side_channel::GpuQueueSubmissionMetaInfoRecord
+  CreateMetaInfoRecord(const SubmissionMetaInformation& meta_info) {
+    return orbit_producer_side_channel::GpuQueueSubmissionMetaInfoRecord{
+        meta_info.process_id, meta_info.thread_id, meta_info.pre_submission_cpu_timestamp,
+        meta_info.post_submission_cpu_timestamp};
   }
 
-  [[nodiscard]] bool QuerySingleCommandBufferTimestamps(SubmittedCommandBuffer* command_buffer,
-                                                        std::vector<uint32_t>* query_slots_to_reset,
-                                                        VkDevice device, VkQueryPool query_pool,
-                                                        float timestamp_period) {
+  [[nodiscard]] static bool QuerySingleCommandBufferTimestamps(
+      SubmittedCommandBuffer* command_buffer,
+      std::vector<uint32_t>* query_slots_to_reset,
+      const absl::flat_hash_map<uint32_t, uint64_t>& slot_to_timestamp_ns) {
     CHECK(command_buffer != nullptr);
 
     if (!command_buffer->end_timestamp.has_value()) {
       CHECK(command_buffer->command_buffer_end_slot_index.has_value());
       uint32_t slot_index = command_buffer->command_buffer_end_slot_index.value();
-      std::optional<uint64_t> end_timestamp =
-          QueryGpuTimestampNs(device, query_pool, slot_index, timestamp_period);
+      std::optional<uint64_t> end_timestamp = LookupTimestampNs(slot_to_timestamp_ns, slot_index);
       if (end_timestamp.has_value()) {
         command_buffer->end_timestamp = end_timestamp;
         query_slots_to_reset->push_back(slot_index);
@@ -711,8 +938,7 @@ class SubmissionTracker : public VulkanLayerProducer::CaptureStatusListener {
 
     if (!command_buffer->begin_timestamp.has_value()) {
       uint32_t slot_index = command_buffer->command_buffer_begin_slot_index.value();
-      std::optional<uint64_t> begin_timestamp =
-          QueryGpuTimestampNs(device, query_pool, slot_index, timestamp_period);
+      std::optional<uint64_t> begin_timestamp = LookupTimestampNs(slot_to_timestamp_ns, slot_index);
       if (begin_timestamp.has_value()) {
         command_buffer->begin_timestamp = begin_timestamp;
         query_slots_to_reset->push_back(slot_index);
@@ -724,29 +950,27 @@ class SubmissionTracker : public VulkanLayerProducer::CaptureStatusListener {
     return true;
   }
 
-  [[nodiscard]] bool QueryCommandBufferTimestamps(QueueSubmission* completed_submission,
-                                                  std::vector<uint32_t>* query_slots_to_reset,
-                                                  VkDevice device, VkQueryPool query_pool,
-                                                  float timestamp_period) {
+  [[nodiscard]] static bool QueryCommandBufferTimestamps(
+      QueueSubmission* completed_submission, std::vector<uint32_t>* query_slots_to_reset,
+      const absl::flat_hash_map<uint32_t, uint64_t>& slot_to_timestamp_ns) {
     for (auto& completed_submit : completed_submission->submit_infos) {
       for (auto& completed_command_buffer : completed_submit.command_buffers) {
         bool queries_succeeded = QuerySingleCommandBufferTimestamps(
-            &completed_command_buffer, query_slots_to_reset, device, query_pool, timestamp_period);
+            &completed_command_buffer, query_slots_to_reset, slot_to_timestamp_ns);
         if (!queries_succeeded) return false;
       }
     }
     return true;
   }
 
-  [[nodiscard]] bool QuerySingleDebugMarkerTimestamps(SubmittedMarkerSlice* marker_slice,
-                                                      std::vector<uint32_t>* query_slots_to_reset,
-                                                      VkDevice device, VkQueryPool query_pool,
-                                                      float timestamp_period) {
+  [[nodiscard]] static bool QuerySingleDebugMarkerTimestamps(
+      SubmittedMarkerSlice* marker_slice, std::vector<uint32_t>* query_slots_to_reset,
+      const absl::flat_hash_map<uint32_t, uint64_t>& slot_to_timestamp_ns) {
     CHECK(marker_slice != nullptr);
 
     if (!marker_slice->end_info.timestamp.has_value()) {
-      std::optional<uint64_t> end_timestamp = QueryGpuTimestampNs(
-          device, query_pool, marker_slice->end_info.slot_index, timestamp_period);
+      std::optional<uint64_t> end_timestamp =
+          LookupTimestampNs(slot_to_timestamp_ns, marker_slice->end_info.slot_index);
       if (end_timestamp.has_value()) {
         marker_slice->end_info.timestamp = end_timestamp;
         query_slots_to_reset->push_back(marker_slice->end_info.slot_index);
@@ -760,8 +984,8 @@ class SubmissionTracker : public VulkanLayerProducer::CaptureStatusListener {
     }
 
     if (!marker_slice->begin_info->timestamp.has_value()) {
-      std::optional<uint64_t> begin_timestamp = QueryGpuTimestampNs(
-          device, query_pool, marker_slice->begin_info->slot_index, timestamp_period);
+      std::optional<uint64_t> begin_timestamp =
+          LookupTimestampNs(slot_to_timestamp_ns, marker_slice->begin_info->slot_index);
       if (begin_timestamp.has_value()) {
         marker_slice->begin_info->timestamp = begin_timestamp;
         query_slots_to_reset->push_back(marker_slice->begin_info->slot_index);
@@ -772,41 +996,40 @@ class SubmissionTracker : public VulkanLayerProducer::CaptureStatusListener {
     return true;
   }
 
-  [[nodiscard]] bool QueryDebugMarkerTimestamps(QueueSubmission* completed_submission,
-                                                std::vector<uint32_t>* query_slots_to_reset,
-                                                VkDevice device, VkQueryPool query_pool,
-                                                float timestamp_period) {
+  [[nodiscard]] static bool QueryDebugMarkerTimestamps(
+      QueueSubmission* completed_submission, std::vector<uint32_t>* query_slots_to_reset,
+      const absl::flat_hash_map<uint32_t, uint64_t>& slot_to_timestamp_ns) {
     for (auto& marker_slice : completed_submission->completed_markers) {
-      bool queries_succeeded = QuerySingleDebugMarkerTimestamps(
-          &marker_slice, query_slots_to_reset, device, query_pool, timestamp_period);
+      bool queries_succeeded = QuerySingleDebugMarkerTimestamps(&marker_slice, query_slots_to_reset,
+                                                                slot_to_timestamp_ns);
       if (!queries_succeeded) return false;
     }
     return true;
   }
 
-  [[nodiscard]] bool WriteCommandBufferTimings(
-      const QueueSubmission& completed_submission,
-      orbit_grpc_protos::GpuQueueSubmission* submission_proto) {
+  [[nodiscard]] static bool WriteCommandBufferTimings(const QueueSubmission& completed_submission,
+                                                      GpuQueueSubmissionEvent* event) {
     bool has_at_least_one_timestamp = false;
     for (const auto& completed_submit : completed_submission.submit_infos) {
-      orbit_grpc_protos::GpuSubmitInfo* submit_info_proto = submission_proto->add_submit_infos();
+      event->command_buffer_counts.push_back(
+          static_cast<uint32_t>(completed_submit.command_buffers.size()));
       for (const auto& completed_command_buffer : completed_submit.command_buffers) {
-        orbit_grpc_protos::GpuCommandBuffer* command_buffer_proto =
-            submit_info_proto->add_command_buffers();
+        orbit_producer_side_channel::GpuCommandBufferRecord& command_buffer_record =
+            event->command_buffers.emplace_back();
+        command_buffer_record = {};
 
         if (completed_command_buffer.command_buffer_begin_slot_index.has_value()) {
           // This function must only be called once queries have actually succeeded. If this command
           // buffer has a slot index for the begin timestamp, we must have a value here.
           CHECK(completed_command_buffer.begin_timestamp.has_value());
-          command_buffer_proto->set_begin_gpu_timestamp_ns(
-              completed_command_buffer.begin_timestamp.value());
+          command_buffer_record.begin_gpu_timestamp_ns =
+              completed_command_buffer.begin_timestamp.value();
         }
 
         // Similarly here, this function must only be called once timestamp queries have succeeded,
         // and therefore we must have an end timestamp here.
         CHECK(completed_command_buffer.end_timestamp.has_value());
-        command_buffer_proto->set_end_gpu_timestamp_ns(
-            completed_command_buffer.end_timestamp.value());
+        command_buffer_record.end_gpu_timestamp_ns = completed_command_buffer.end_timestamp.value();
 
         has_at_least_one_timestamp = true;
       }
@@ -814,20 +1037,27 @@ class SubmissionTracker : public VulkanLayerProducer::CaptureStatusListener {
     return has_at_least_one_timestamp;
   }
 
+  // Makes sure the producer sends `label_name` as interned string in the current capture.
+  [[nodiscard]] uint64_t InternMarkerLabel(std::string_view label_name) {
+    if (vulkan_layer_producer_ == nullptr) {
+      return 0;
+    }
+    return vulkan_layer_producer_->InternStringIfNecessaryAndGetKey(label_name);
+  }
+
   [[nodiscard]] bool WriteDebugMarkers(const QueueSubmission& completed_submission,
-                                       orbit_grpc_protos::GpuQueueSubmission* submission_proto) {
-    submission_proto->set_num_begin_markers(completed_submission.num_begin_markers);
+                                       GpuQueueSubmissionEvent* event) {
+    using orbit_producer_side_channel::GpuDebugMarkerRecord;
+    event->num_begin_markers = static_cast<int32_t>(completed_submission.num_begin_markers);
     bool has_at_least_one_timestamp = false;
     for (const auto& marker_state : completed_submission.completed_markers) {
       CHECK(marker_state.end_info.timestamp.has_value());
       uint64_t end_timestamp = marker_state.end_info.timestamp.value();
       has_at_least_one_timestamp = true;
 
-      orbit_grpc_protos::GpuDebugMarker* marker_proto = submission_proto->add_completed_markers();
-      if (vulkan_layer_producer_ != nullptr) {
-        marker_proto->set_text_key(
-            vulkan_layer_producer_->InternStringIfNecessaryAndGetKey(marker_state.label_name));
-      }
+      GpuDebugMarkerRecord& marker_record = event->completed_markers.emplace_back();
+      marker_record = {};
+      marker_record.text_key = marker_state.label_key;
 
       auto quantize = [](float value) { return static_cast<uint8_t>(value * 255.f); };
 
@@ -836,42 +1066,39 @@ class SubmissionTracker : public VulkanLayerProducer::CaptureStatusListener {
       // color.
       if (quantize(marker_state.color.red) != 0 || quantize(marker_state.color.green) != 0 ||
           quantize(marker_state.color.blue) != 0 || quantize(marker_state.color.alpha) != 0) {
-        auto* color = marker_proto->mutable_color();
-        color->set_red(marker_state.color.red);
-        color->set_green(marker_state.color.green);
-        color->set_blue(marker_state.color.blue);
-        color->set_alpha(marker_state.color.alpha);
+        marker_record.flags |= GpuDebugMarkerRecord::kHasColor;
+        marker_record.color_red = marker_state.color.red;
+        marker_record.color_green = marker_state.color.green;
+        marker_record.color_blue = marker_state.color.blue;
+        marker_record.color_alpha = marker_state.color.alpha;
       }
-      marker_proto->set_depth(marker_state.depth);
-      marker_proto->set_end_gpu_timestamp_ns(end_timestamp);
+      marker_record.depth = static_cast<int32_t>(marker_state.depth);
+      marker_record.end_gpu_timestamp_ns = end_timestamp;
 
       // If we haven't captured the begin marker, we'll leave the optional begin_marker empty.
       if (!marker_state.begin_info.has_value()) {
         continue;
       }
-      orbit_grpc_protos::GpuDebugMarkerBeginInfo* begin_debug_marker_proto =
-          marker_proto->mutable_begin_marker();
-      WriteMetaInfo(marker_state.begin_info->meta_information,
-                    begin_debug_marker_proto->mutable_meta_info());
+      marker_record.flags |= GpuDebugMarkerRecord::kHasBeginMarker;
+      marker_record.begin_meta_info =
+          CreateMetaInfoRecord(marker_state.begin_info->meta_information);
 
       CHECK(marker_state.begin_info->timestamp.has_value());
-      uint64_t begin_timestamp = marker_state.begin_info->timestamp.value();
-      begin_debug_marker_proto->set_gpu_timestamp_ns(begin_timestamp);
+      marker_record.begin_gpu_timestamp_ns = marker_state.begin_info->timestamp.value();
     }
 
     return has_at_least_one_timestamp;
   }
 
-  // This method does not acquire a lock and MUST NOT be called without holding the `mutex_`.
-  void ResetCommandBufferUnsafe(VkCommandBuffer command_buffer) {
-    mutex_.AssertHeld();
-    if (!command_buffer_to_state_.contains(command_buffer)) {
+  // This method does not acquire a lock and MUST NOT be called without holding the `mutex` of the
+  // `tracked_command_buffer`.
+  void ResetCommandBufferLocked(TrackedCommandBuffer* tracked_command_buffer) {
+    tracked_command_buffer->mutex.AssertHeld();
+    if (!tracked_command_buffer->state.has_value()) {
       return;
     }
-    CHECK(command_buffer_to_state_.contains(command_buffer));
-    CommandBufferState& state = command_buffer_to_state_.at(command_buffer);
-    CHECK(command_buffer_to_device_.contains(command_buffer));
-    VkDevice device = command_buffer_to_device_.at(command_buffer);
+    const CommandBufferState& state = tracked_command_buffer->state.value();
+    VkDevice device = tracked_command_buffer->device;
     std::vector<uint32_t> query_slots_to_reset{};
     if (state.command_buffer_begin_slot_index.has_value()) {
       query_slots_to_reset.push_back(state.command_buffer_begin_slot_index.value());
@@ -890,26 +1117,26 @@ class SubmissionTracker : public VulkanLayerProducer::CaptureStatusListener {
       timer_query_pool_->RollbackPendingQuerySlots(device, query_slots_to_reset);
     }
 
-    command_buffer_to_state_.erase(command_buffer);
+    tracked_command_buffer->state.reset();
   }
 
-  void PersistSingleCommandBufferOnSubmit(VkDevice device, VkCommandBuffer command_buffer,
+  void PersistSingleCommandBufferOnSubmit(TrackedCommandBuffer* tracked_command_buffer,
                                           QueueSubmission* queue_submission,
                                           SubmitInfo* submitted_submit_info,
                                           std::vector<uint32_t>* query_slots_not_needed_to_read) {
-    mutex_.AssertHeld();
+    CHECK(tracked_command_buffer != nullptr);
     CHECK(queue_submission != nullptr);
     CHECK(submitted_submit_info != nullptr);
     CHECK(query_slots_not_needed_to_read != nullptr);
 
-    if (!command_buffer_to_state_.contains(command_buffer)) {
+    absl::MutexLock lock(&tracked_command_buffer->mutex);
+    if (!tracked_command_buffer->state.has_value()) {
       ERROR_ONCE(
           "Calling vkQueueSubmit on a command buffer that is in the initial state (i.e. "
           "either freshly allocated or reset with vkResetCommandBuffer).");
       return;
     }
-    CHECK(command_buffer_to_state_.contains(command_buffer));
-    CommandBufferState& state = command_buffer_to_state_.at(command_buffer);
+    CommandBufferState& state = tracked_command_buffer->state.value();
     bool has_been_submitted_before = state.pre_submission_cpu_timestamp.has_value();
 
     // Mark that this command buffer in the current state was already submitted. If the command
@@ -923,10 +1150,6 @@ class SubmissionTracker : public VulkanLayerProducer::CaptureStatusListener {
     state.pre_submission_cpu_timestamp =
         queue_submission->meta_information.pre_submission_cpu_timestamp;
 
-    if (device == VK_NULL_HANDLE) {
-      device = command_buffer_to_device_.at(command_buffer);
-    }
-
     // If we haven't recorded neither the end nor the begin of a command buffer, we have no
     // information to send.
     if (!state.command_buffer_end_slot_index.has_value()) {
@@ -952,21 +1175,22 @@ class SubmissionTracker : public VulkanLayerProducer::CaptureStatusListener {
   }
 
   void PersistDebugMarkersOfASingleCommandBufferOnSubmit(
-      VkCommandBuffer command_buffer, std::optional<QueueSubmission>* queue_submission_optional,
-      QueueMarkerState* markers, std::vector<uint32_t>* marker_slots_not_needed_to_read) {
-    mutex_.AssertHeld();
+      TrackedCommandBuffer* tracked_command_buffer,
+      std::optional<QueueSubmission>* queue_submission_optional, QueueMarkerState* markers,
+      std::vector<uint32_t>* marker_slots_not_needed_to_read) {
+    CHECK(tracked_command_buffer != nullptr);
     CHECK(queue_submission_optional != nullptr);
     CHECK(markers != nullptr);
     CHECK(marker_slots_not_needed_to_read != nullptr);
 
-    if (!command_buffer_to_state_.contains(command_buffer)) {
+    absl::MutexLock lock(&tracked_command_buffer->mutex);
+    if (!tracked_command_buffer->state.has_value()) {
       ERROR_ONCE(
           "Calling vkQueueSubmit on a command buffer that is in the initial state (i.e. "
           "either freshly allocated or reset with vkResetCommandBuffer).");
       return;
     }
-    CHECK(command_buffer_to_state_.contains(command_buffer));
-    const CommandBufferState& state = command_buffer_to_state_.at(command_buffer);
+    const CommandBufferState& state = tracked_command_buffer->state.value();
 
     for (const Marker& marker : state.markers) {
       std::optional<SubmittedMarker> submitted_marker = std::nullopt;
@@ -984,19 +1208,25 @@ class SubmissionTracker : public VulkanLayerProducer::CaptureStatusListener {
           if (queue_submission_optional->has_value() && marker.slot_index.has_value()) {
             ++queue_submission_optional->value().num_begin_markers;
           }
-          CHECK(marker.label_name.has_value());
           CHECK(marker.color.has_value());
           MarkerState marker_state{.begin_info = submitted_marker,
-                                   .label_name = marker.label_name.value(),
+                                   .label_key = marker.label_key,
                                    .color = marker.color.value(),
                                    .depth = markers->marker_stack.size(),
                                    .depth_exceeds_maximum = marker.cut_off};
+          if (!marker_state.label_key.has_value() && !marker.cut_off) {
+            if (queue_submission_optional->has_value()) {
+              marker_state.label_key = InternMarkerLabel(marker.label_name);
+            } else {
+              marker_state.label_name = marker.label_name;
+            }
+          }
           markers->marker_stack.push(std::move(marker_state));
           break;
         }
 
         case MarkerType::kDebugMarkerEnd: {
-          MarkerState marker_state = markers->marker_stack.top();
+          MarkerState marker_state = std::move(markers->marker_stack.top());
           markers->marker_stack.pop();
 
           // If there is a begin marker slot from a previous submission, this is our chance to
@@ -1016,10 +1246,14 @@ class SubmissionTracker : public VulkanLayerProducer::CaptureStatusListener {
           if (queue_submission_optional->has_value() && marker.slot_index.has_value() &&
               !marker_state.depth_exceeds_maximum) {
             CHECK(submitted_marker.has_value());
+            // The begin marker may have been submitted before the capture started.
+            const uint64_t label_key = marker_state.label_key.has_value()
+                                           ? marker_state.label_key.value()
+                                           : InternMarkerLabel(marker_state.label_name);
             queue_submission_optional->value().completed_markers.emplace_back(
                 SubmittedMarkerSlice{.begin_info = marker_state.begin_info,
                                      .end_info = submitted_marker.value(),
-                                     .label_name = std::move(marker_state.label_name),
+                                     .label_key = label_key,
                                      .color = marker_state.color,
                                      .depth = marker_state.depth});
           }
@@ -1030,23 +1264,22 @@ class SubmissionTracker : public VulkanLayerProducer::CaptureStatusListener {
     }
   }
 
-  absl::Mutex mutex_;
+  absl::Mutex command_pools_mutex_;
   absl::flat_hash_map<VkCommandPool, absl::flat_hash_set<VkCommandBuffer>> pool_to_command_buffers_;
-  absl::flat_hash_map<VkCommandBuffer, VkDevice> command_buffer_to_device_;
 
-  absl::flat_hash_map<VkCommandBuffer, CommandBufferState> command_buffer_to_state_;
+  std::array<CommandBufferShard, kNumCommandBufferShards> command_buffer_shards_;
 
-  static constexpr auto kPreSubmissionCpuTimestampComparator =
-      [](const QueueSubmission& lhs, const QueueSubmission& rhs) -> bool {
-    return lhs.meta_information.pre_submission_cpu_timestamp >
-           rhs.meta_information.pre_submission_cpu_timestamp;
-  };
-  absl::flat_hash_map<VkQueue,
-                      std::priority_queue<QueueSubmission, std::vector<QueueSubmission>,
-                                          std::function<bool(QueueSubmission, QueueSubmission)>>>
-      queue_to_submission_priority_queue_;
+  absl::Mutex queues_mutex_;
+  absl::flat_hash_map<VkQueue, std::unique_ptr<QueueState>> queue_to_state_;
+
+  absl::Mutex complete_submits_mutex_;
+
+  // Only used in `CompleteSubmitsOfQueue`, to build the events without allocating.
+  GpuQueueSubmissionEvent gpu_queue_submission_event_ ABSL_GUARDED_BY(complete_submits_mutex_);
 
-  absl::flat_hash_map<VkQueue, QueueMarkerState> queue_to_markers_;
+  // Timestamps that could not be recorded because all query slots were occupied.
+  std::atomic<uint64_t> num_dropped_command_buffer_timestamps_ = 0;
+  std::atomic<uint64_t> num_dropped_debug_marker_timestamps_ = 0;
 
   DispatchTable* dispatch_table_;
   TimerQueryPool* timer_query_pool_;
@@ -1054,7 +1287,8 @@ class SubmissionTracker : public VulkanLayerProducer::CaptureStatusListener {
 
   // We use std::numeric_limits<uint32_t>::max() to disable filtering of markers and 0 to discard
   // all debug markers.
-  uint32_t max_local_marker_depth_per_command_buffer_ = std::numeric_limits<uint32_t>::max();
+  std::atomic<uint32_t> max_local_marker_depth_per_command_buffer_ =
+      std::numeric_limits<uint32_t>::max();
   VulkanLayerProducer* vulkan_layer_producer_ = nullptr;
 
   // This boolean is precisely true between a call to OnCaptureStart and OnCaptureFinished. In
@@ -1063,7 +1297,8 @@ class SubmissionTracker : public VulkanLayerProducer::CaptureStatusListener {
   // command buffers and debug markers. A consistent state allows proper cleanup of query slots
   // either in OnCaptureFinished or when completing submits. Note that calling
   // vulkan_layer_producer_->IsCapturing() is not a correct replacement for checking this boolean.
-  bool is_capturing_ = false;
+  // It is read by the recording threads while holding the lock of the respective command buffer.
+  std::atomic<bool> is_capturing_ = false;
 };
 
 }  // namespace orbit_vulkan_layer
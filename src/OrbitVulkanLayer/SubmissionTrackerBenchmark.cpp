@@ -0,0 +1,219 @@
+// Copyright (c) 2021 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <absl/base/casts.h>
+#include <benchmark/benchmark.h>
+#include <vulkan/vulkan.h>
+
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <optional>
+#include <vector>
+
+#include "SubmissionTracker.h"
+#include "TimerQueryPool.h"
+
+// These benchmarks exercise `SubmissionTracker` and `TimerQueryPool` from multiple threads, as
+// engines do when recording command buffers in parallel. Both classes are templated on the
+// Vulkan dispatch, so fakes that do not call into any driver allow to run this without a GPU.
+
+namespace orbit_vulkan_layer {
+
+namespace {
+
+class FakeDispatchTable {
+ public:
+  PFN_vkCreateQueryPool CreateQueryPool(VkDevice /*device*/) {
+    return +[](VkDevice /*device*/, const VkQueryPoolCreateInfo* /*create_info*/,
+               const VkAllocationCallbacks* /*allocator*/, VkQueryPool* query_pool) -> VkResult {
+      *query_pool = absl::bit_cast<VkQueryPool>(uintptr_t{1});
+      return VK_SUCCESS;
+    };
+  }
+
+  PFN_vkResetQueryPoolEXT ResetQueryPoolEXT(VkDevice /*device*/) {
+    return +[](VkDevice /*device*/, VkQueryPool /*query_pool*/, uint32_t /*first_query*/,
+               uint32_t /*query_count*/) {};
+  }
+
+  PFN_vkDestroyQueryPool DestroyQueryPool(VkDevice /*device*/) {
+    return +[](VkDevice /*device*/, VkQueryPool /*query_pool*/,
+               const VkAllocationCallbacks* /*allocator*/) {};
+  }
+
+  PFN_vkCmdWriteTimestamp CmdWriteTimestamp(VkCommandBuffer /*command_buffer*/) {
+    return +[](VkCommandBuffer /*command_buffer*/, VkPipelineStageFlagBits /*pipeline_stage*/,
+               VkQueryPool /*query_pool*/, uint32_t /*query*/) {};
+  }
+
+  PFN_vkGetQueryPoolResults GetQueryPoolResults(VkDevice /*device*/) {
+    return +[](VkDevice /*device*/, VkQueryPool /*query_pool*/, uint32_t first_query,
+               uint32_t query_count, size_t /*data_size*/, void* data, VkDeviceSize /*stride*/,
+               VkQueryResultFlags /*flags*/) -> VkResult {
+      // Every timestamp is followed by its availability.
+      auto* results = static_cast<uint64_t*>(data);
+      for (uint32_t i = 0; i < query_count; ++i) {
+        results[2 * i] = first_query + i;
+        results[2 * i + 1] = 1;
+      }
+      return VK_SUCCESS;
+    };
+  }
+};
+
+class FakeDeviceManager {
+ public:
+  VkPhysicalDevice GetPhysicalDeviceOfLogicalDevice(VkDevice /*device*/) { return {}; }
+
+  VkPhysicalDeviceProperties GetPhysicalDeviceProperties(VkPhysicalDevice /*physical_device*/) {
+    VkPhysicalDeviceProperties properties{};
+    properties.limits.timestampPeriod = 1.f;
+    return properties;
+  }
+};
+
+using FakeTimerQueryPool = TimerQueryPool<FakeDispatchTable>;
+using FakeSubmissionTracker =
+    SubmissionTracker<FakeDispatchTable, FakeDeviceManager, FakeTimerQueryPool>;
+
+constexpr uint32_t kNumTimerQuerySlots = 65536;
+constexpr size_t kCommandBuffersPerThread = 4;
+constexpr size_t kDebugMarkersPerCommandBuffer = 8;
+constexpr int kMaxNumThreads = 16;
+
+// Shared by all threads of a benchmark run. Set up and torn down by the thread with index 0.
+struct Fixture {
+  Fixture()
+      : timer_query_pool(&dispatch_table, kNumTimerQuerySlots),
+        submission_tracker(&dispatch_table, &timer_query_pool, &device_manager,
+                           std::numeric_limits<uint32_t>::max()) {
+    timer_query_pool.InitializeTimerQueryPool(device);
+    command_buffers.resize(static_cast<size_t>(kMaxNumThreads) * kCommandBuffersPerThread);
+    for (size_t i = 0; i < command_buffers.size(); ++i) {
+      command_buffers[i] = absl::bit_cast<VkCommandBuffer>(uintptr_t{0x1000} + i * 8);
+    }
+    submission_tracker.TrackCommandBuffers(device, command_pool, command_buffers.data(),
+                                           static_cast<uint32_t>(command_buffers.size()));
+    submission_tracker.OnCaptureStart(orbit_grpc_protos::CaptureOptions{});
+  }
+
+  ~Fixture() {
+    submission_tracker.OnCaptureFinished();
+    submission_tracker.UntrackCommandBuffers(device, command_pool, command_buffers.data(),
+                                             static_cast<uint32_t>(command_buffers.size()));
+    timer_query_pool.DestroyTimerQueryPool(device);
+  }
+
+  [[nodiscard]] VkCommandBuffer GetCommandBuffer(int thread_index, size_t i) const {
+    return command_buffers[static_cast<size_t>(thread_index) * kCommandBuffersPerThread + i];
+  }
+
+  FakeDispatchTable dispatch_table;
+  FakeDeviceManager device_manager;
+  FakeTimerQueryPool timer_query_pool;
+  FakeSubmissionTracker submission_tracker;
+  VkDevice device = absl::bit_cast<VkDevice>(uintptr_t{0x10});
+  VkCommandPool command_pool = absl::bit_cast<VkCommandPool>(uintptr_t{0x20});
+  std::vector<VkCommandBuffer> command_buffers;
+};
+
+std::unique_ptr<Fixture> fixture;
+
+void RecordCommandBuffer(FakeSubmissionTracker* submission_tracker,
+                         VkCommandBuffer command_buffer) {
+  submission_tracker->MarkCommandBufferBegin(command_buffer);
+  for (size_t i = 0; i < kDebugMarkersPerCommandBuffer; ++i) {
+    submission_tracker->MarkDebugMarkerBegin(command_buffer, "Marker", {});
+    submission_tracker->MarkDebugMarkerEnd(command_buffer);
+  }
+  submission_tracker->MarkCommandBufferEnd(command_buffer);
+}
+
+// Each thread records its own command buffers and resets them again, without submitting them.
+// This is dominated by looking up the command buffer state and by allocating query slots.
+void BM_RecordAndResetCommandBuffers(benchmark::State& state) {
+  if (state.thread_index() == 0) {
+    fixture = std::make_unique<Fixture>();
+  }
+
+  for (auto _ : state) {
+    for (size_t i = 0; i < kCommandBuffersPerThread; ++i) {
+      VkCommandBuffer command_buffer = fixture->GetCommandBuffer(state.thread_index(), i);
+      RecordCommandBuffer(&fixture->submission_tracker, command_buffer);
+      fixture->submission_tracker.ResetCommandBuffer(command_buffer);
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * kCommandBuffersPerThread);
+
+  if (state.thread_index() == 0) {
+    fixture.reset();
+  }
+}
+
+// Each thread records its own command buffers and submits them to its own queue, as e.g. a
+// render thread and an async compute thread would do. Submissions are completed right away, which
+// releases the query slots once the command buffers are recorded again.
+void BM_RecordSubmitAndCompleteCommandBuffers(benchmark::State& state) {
+  if (state.thread_index() == 0) {
+    fixture = std::make_unique<Fixture>();
+  }
+  VkQueue queue =
+      absl::bit_cast<VkQueue>(uintptr_t{0x100} + static_cast<uintptr_t>(state.thread_index()) * 8);
+
+  for (auto _ : state) {
+    std::vector<VkCommandBuffer> command_buffers;
+    for (size_t i = 0; i < kCommandBuffersPerThread; ++i) {
+      VkCommandBuffer command_buffer = fixture->GetCommandBuffer(state.thread_index(), i);
+      RecordCommandBuffer(&fixture->submission_tracker, command_buffer);
+      command_buffers.push_back(command_buffer);
+    }
+
+    VkSubmitInfo submit_info{};
+    submit_info.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+    submit_info.commandBufferCount = static_cast<uint32_t>(command_buffers.size());
+    submit_info.pCommandBuffers = command_buffers.data();
+    std::optional<FakeSubmissionTracker::QueueSubmission> queue_submission =
+        fixture->submission_tracker.PersistCommandBuffersOnSubmit(queue, 1, &submit_info);
+    fixture->submission_tracker.PersistDebugMarkersOnSubmit(queue, 1, &submit_info,
+                                                            std::move(queue_submission));
+    fixture->submission_tracker.CompleteSubmits(fixture->device);
+  }
+  state.SetItemsProcessed(state.iterations() * kCommandBuffersPerThread);
+
+  if (state.thread_index() == 0) {
+    fixture.reset();
+  }
+}
+
+// Isolates the slot allocation of `TimerQueryPool`, which all recording threads share.
+void BM_NextReadyQuerySlotAndRollback(benchmark::State& state) {
+  if (state.thread_index() == 0) {
+    fixture = std::make_unique<Fixture>();
+  }
+
+  std::vector<uint32_t> slots(kDebugMarkersPerCommandBuffer);
+  for (auto _ : state) {
+    for (uint32_t& slot : slots) {
+      bool found_slot = fixture->timer_query_pool.NextReadyQuerySlot(fixture->device, &slot);
+      benchmark::DoNotOptimize(found_slot);
+    }
+    fixture->timer_query_pool.RollbackPendingQuerySlots(fixture->device, slots);
+  }
+  state.SetItemsProcessed(state.iterations() * kDebugMarkersPerCommandBuffer);
+
+  if (state.thread_index() == 0) {
+    fixture.reset();
+  }
+}
+
+}  // namespace
+
+BENCHMARK(BM_RecordAndResetCommandBuffers)->ThreadRange(1, kMaxNumThreads)->UseRealTime();
+BENCHMARK(BM_RecordSubmitAndCompleteCommandBuffers)->ThreadRange(1, kMaxNumThreads)->UseRealTime();
+BENCHMARK(BM_NextReadyQuerySlotAndRollback)->ThreadRange(1, kMaxNumThreads)->UseRealTime();
+
+}  // namespace orbit_vulkan_layer
+
+BENCHMARK_MAIN();
@@ -7,9 +7,11 @@
 #include <gtest/gtest.h>
 
 #include <array>
+#include <optional>
 
 #include "OrbitBase/ThreadUtils.h"
 #include "SubmissionTracker.h"
+#include "TimerQueryPool.h"
 #include "VulkanLayerProducer.h"
 
 using ::testing::ElementsAre;
@@ -32,11 +34,13 @@ PFN_vkCmdWriteTimestamp dummy_write_timestamp_function =
 
 class MockTimerQueryPool {
  public:
-  MOCK_METHOD(VkQueryPool, GetQueryPool, (VkDevice), ());
+  MOCK_METHOD(VkQueryPool, GetQueryPool, (VkDevice, uint32_t), ());
+  MOCK_METHOD(uint32_t, GetQueryIndexInPool, (uint32_t), (const));
   MOCK_METHOD(void, MarkQuerySlotsForReset, (VkDevice, const std::vector<uint32_t>&), ());
   MOCK_METHOD(void, MarkQuerySlotsDoneReading, (VkDevice, const std::vector<uint32_t>&), ());
   MOCK_METHOD(void, RollbackPendingQuerySlots, (VkDevice, const std::vector<uint32_t>&), ());
   MOCK_METHOD(bool, NextReadyQuerySlot, (VkDevice, uint32_t*), ());
+  MOCK_METHOD(void, ResetReleasedQuerySlots, (VkDevice), ());
   MOCK_METHOD(void, PrintStats, (), ());
 };
 
@@ -49,10 +53,18 @@ class MockDeviceManager {
 class MockVulkanLayerProducer : public VulkanLayerProducer {
  public:
   MOCK_METHOD(bool, IsCapturing, (), (override));
-  MOCK_METHOD(uint64_t, InternStringIfNecessaryAndGetKey, (std::string), (override));
+  MOCK_METHOD(uint64_t, InternStringIfNecessaryAndGetKey, (std::string_view), (override));
   MOCK_METHOD(bool, EnqueueCaptureEvent, (orbit_grpc_protos::ProducerCaptureEvent && capture_event),
               (override));
 
+  // GpuQueueSubmissionEvents are translated to the proto they will eventually be sent as, and
+  // passed on to EnqueueCaptureEvent, so that all events can be verified in the same way.
+  bool EnqueueGpuQueueSubmission(const GpuQueueSubmissionEvent& event) override {
+    orbit_grpc_protos::ProducerCaptureEvent capture_event;
+    FillGpuQueueSubmissionProto(event, capture_event.mutable_gpu_queue_submission());
+    return EnqueueCaptureEvent(std::move(capture_event));
+  }
+
   MOCK_METHOD(void, BringUp, (const std::shared_ptr<grpc::Channel>& channel), (override));
   MOCK_METHOD(void, TakeDown, (), (override));
 
@@ -106,6 +118,8 @@ class SubmissionTrackerTest : public ::testing::Test {
     auto is_capturing_function = [this]() -> bool { return producer_->is_capturing_; };
     EXPECT_CALL(*producer_, IsCapturing).WillRepeatedly(Invoke(is_capturing_function));
     EXPECT_CALL(timer_query_pool_, GetQueryPool).WillRepeatedly(Return(query_pool_));
+    EXPECT_CALL(timer_query_pool_, GetQueryIndexInPool).WillRepeatedly(testing::ReturnArg<0>());
+    EXPECT_CALL(timer_query_pool_, ResetReleasedQuerySlots).Times(testing::AnyNumber());
     EXPECT_CALL(device_manager_, GetPhysicalDeviceOfLogicalDevice)
         .WillRepeatedly(Return(physical_device_));
     EXPECT_CALL(device_manager_, GetPhysicalDeviceProperties)
@@ -193,38 +207,65 @@ class SubmissionTrackerTest : public ::testing::Test {
   static constexpr uint64_t kTimestamp6 = 16;
   static constexpr uint64_t kTimestamp7 = 17;
 
-  const PFN_vkGetQueryPoolResults mock_get_query_pool_results_function_all_ready_ =
-      +[](VkDevice /*device*/, VkQueryPool /*queryPool*/, uint32_t first_query,
-          uint32_t query_count, size_t /*dataSize*/, void* data, VkDeviceSize /*stride*/,
-          VkQueryResultFlags flags) -> VkResult {
-    EXPECT_EQ(query_count, 1);
-    EXPECT_NE((flags & VK_QUERY_RESULT_64_BIT), 0);
-    switch (first_query) {
+  static uint64_t TimestampOfSlot(uint32_t slot_index) {
+    switch (slot_index) {
       case kSlotIndex1:
-        *absl::bit_cast<uint64_t*>(data) = kTimestamp1;
-        break;
+        return kTimestamp1;
       case kSlotIndex2:
-        *absl::bit_cast<uint64_t*>(data) = kTimestamp2;
-        break;
+        return kTimestamp2;
       case kSlotIndex3:
-        *absl::bit_cast<uint64_t*>(data) = kTimestamp3;
-        break;
+        return kTimestamp3;
       case kSlotIndex4:
-        *absl::bit_cast<uint64_t*>(data) = kTimestamp4;
-        break;
+        return kTimestamp4;
       case kSlotIndex5:
-        *absl::bit_cast<uint64_t*>(data) = kTimestamp5;
-        break;
+        return kTimestamp5;
       case kSlotIndex6:
-        *absl::bit_cast<uint64_t*>(data) = kTimestamp6;
-        break;
+        return kTimestamp6;
       case kSlotIndex7:
-        *absl::bit_cast<uint64_t*>(data) = kTimestamp7;
-        break;
+        return kTimestamp7;
       default:
         UNREACHABLE();
     }
-    return VK_SUCCESS;
+  }
+
+  // Writes the timestamps of the queried range of slots, each followed by its availability, as
+  // requested by `VK_QUERY_RESULT_WITH_AVAILABILITY_BIT`. `unavailable_slot` is not written.
+  static VkResult WriteQueryPoolResults(uint32_t first_query, uint32_t query_count,
+                                        size_t data_size, void* data, VkDeviceSize stride,
+                                        VkQueryResultFlags flags,
+                                        std::optional<uint32_t> unavailable_slot) {
+    EXPECT_NE((flags & VK_QUERY_RESULT_64_BIT), 0);
+    EXPECT_NE((flags & VK_QUERY_RESULT_WITH_AVAILABILITY_BIT), 0);
+    EXPECT_EQ(stride, 2 * sizeof(uint64_t));
+    EXPECT_EQ(data_size, query_count * stride);
+    auto* results = static_cast<uint64_t*>(data);
+    VkResult result = VK_SUCCESS;
+    for (uint32_t i = 0; i < query_count; ++i) {
+      uint32_t slot_index = first_query + i;
+      if (slot_index == unavailable_slot) {
+        result = VK_NOT_READY;
+        continue;
+      }
+      results[2 * i] = TimestampOfSlot(slot_index);
+      results[2 * i + 1] = 1;
+    }
+    return result;
+  }
+
+  const PFN_vkGetQueryPoolResults mock_get_query_pool_results_function_all_ready_ =
+      +[](VkDevice /*device*/, VkQueryPool /*queryPool*/, uint32_t first_query,
+          uint32_t query_count, size_t data_size, void* data, VkDeviceSize stride,
+          VkQueryResultFlags flags) -> VkResult {
+    return WriteQueryPoolResults(first_query, query_count, data_size, data, stride, flags,
+                                 std::nullopt);
+  };
+
+  const PFN_vkGetQueryPoolResults mock_get_query_pool_results_function_slot3_not_ready_ =
+      +[](VkDevice /*device*/, VkQueryPool /*queryPool*/, uint32_t first_query,
+          uint32_t query_count, size_t data_size, void* data, VkDeviceSize stride,
+          VkQueryResultFlags flags) -> VkResult {
+    return WriteQueryPoolResults(first_query, query_count, data_size, data, stride, flags,
+                                 kSlotIndex3);
   };
 
   const PFN_vkGetQueryPoolResults mock_get_query_pool_results_function_not_ready_ =
@@ -577,13 +618,11 @@ TEST_F(SubmissionTrackerTest, WillRetryCompletingSubmissionsWhenTimestampQueryFa
   // second attempt.
 
   ExpectFourNextReadyQuerySlotCalls();
+  // All four slots are contiguous and thus read with a single call per `CompleteSubmits`.
   EXPECT_CALL(dispatch_table_, GetQueryPoolResults)
-      // The first two calls should succeed to complete the first submission.
-      .WillOnce(Return(mock_get_query_pool_results_function_all_ready_))
-      .WillOnce(Return(mock_get_query_pool_results_function_all_ready_))
-      // Fail on the second submission so that we retry on the second call.
-      .WillOnce(Return(mock_get_query_pool_results_function_all_ready_))
-      .WillOnce(Return(mock_get_query_pool_results_function_not_ready_))
+      // The timestamps of the first submission are available, but one of the second is not, so
+      // that we retry on the second call.
+      .WillOnce(Return(mock_get_query_pool_results_function_slot3_not_ready_))
       .WillRepeatedly(Return(mock_get_query_pool_results_function_all_ready_));
 
   std::vector<uint32_t> actual_slots_done_reading1;
@@ -649,9 +688,9 @@ TEST_F(SubmissionTrackerTest, WillRetryCompletingSubmissionsWhenTimestampQueryFa
 
   EXPECT_THAT(actual_slots_done_reading1,
               UnorderedElementsAre(kSlotIndex1, kSlotIndex2, kSlotIndex4));
-  // We failed on the 4th GetQuerySlots call above, which belongs to the "begin" timestamp of the
-  // second command buffer (note that the order of calls when querying for timestamps is to query
-  // for the end timestamp first). Therefore, this must be kSlotIndex3.
+  // kSlotIndex3 was not available above, which belongs to the "begin" timestamp of the second
+  // command buffer (note that the end timestamp is processed first). Therefore, only kSlotIndex3
+  // is read on the retry.
   EXPECT_THAT(actual_slots_done_reading2, UnorderedElementsAre(kSlotIndex3));
 
   ExpectSingleCommandBufferSubmissionEq(actual_capture_events[0], pre_submit_times[0],
@@ -1030,8 +1069,8 @@ TEST_F(SubmissionTrackerTest, CanRetrieveDebugMarkerTimestampsForACompleteSubmis
 
   const char* text = "Text";
   constexpr uint64_t expected_text_key = 111;
-  auto mock_intern_string_if_necessary_and_get_key = [&text](std::string str) {
-    EXPECT_STREQ(text, str.c_str());
+  auto mock_intern_string_if_necessary_and_get_key = [&text](std::string_view str) {
+    EXPECT_EQ(text, str);
     return expected_text_key;
   };
   EXPECT_CALL(*producer_, InternStringIfNecessaryAndGetKey)
@@ -1090,8 +1129,8 @@ TEST_F(SubmissionTrackerTest, CanRetrieveDebugMarkerEndEvenWhenBeginNotCaptured)
 
   const char* text = "Text";
   constexpr uint64_t expected_text_key = 111;
-  auto mock_intern_string_if_necessary_and_get_key = [&text](std::string str) {
-    EXPECT_STREQ(text, str.c_str());
+  auto mock_intern_string_if_necessary_and_get_key = [&text](std::string_view str) {
+    EXPECT_EQ(text, str);
     return expected_text_key;
   };
   EXPECT_CALL(*producer_, InternStringIfNecessaryAndGetKey)
@@ -1146,7 +1185,8 @@ TEST_F(SubmissionTrackerTest, CanRetrieveNestedDebugMarkerTimestampsForAComplete
   const std::string text_inner = "Inner";
   constexpr uint64_t expected_text_key_outer = 111;
   constexpr uint64_t expected_text_key_inner = 112;
-  auto mock_intern_string_if_necessary_and_get_key = [&text_outer, &text_inner](std::string str) {
+  auto mock_intern_string_if_necessary_and_get_key = [&text_outer,
+                                                       &text_inner](std::string_view str) {
     if (str == text_outer) {
       return expected_text_key_outer;
     }
@@ -1225,7 +1265,8 @@ TEST_F(SubmissionTrackerTest,
   const std::string text_inner = "Inner";
   constexpr uint64_t expected_text_key_outer = 111;
   constexpr uint64_t expected_text_key_inner = 112;
-  auto mock_intern_string_if_necessary_and_get_key = [&text_outer, &text_inner](std::string str) {
+  auto mock_intern_string_if_necessary_and_get_key = [&text_outer,
+                                                       &text_inner](std::string_view str) {
     if (str == text_outer) {
       return expected_text_key_outer;
     }
@@ -1307,8 +1348,8 @@ TEST_F(SubmissionTrackerTest, CanRetrieveDebugMarkerAcrossTwoSubmissions) {
 
   const char* text = "Text";
   constexpr uint64_t expected_text_key = 111;
-  auto mock_intern_string_if_necessary_and_get_key = [&text](std::string str) {
-    EXPECT_STREQ(text, str.c_str());
+  auto mock_intern_string_if_necessary_and_get_key = [&text](std::string_view str) {
+    EXPECT_EQ(text, str);
     return expected_text_key;
   };
   EXPECT_CALL(*producer_, InternStringIfNecessaryAndGetKey)
@@ -1402,8 +1443,8 @@ TEST_F(SubmissionTrackerTest, CanRetrieveDebugMarkerAcrossTwoSubmissionsEvenWhen
 
   const char* text = "Text";
   constexpr uint64_t expected_text_key = 111;
-  auto mock_intern_string_if_necessary_and_get_key = [&text](std::string str) {
-    EXPECT_STREQ(text, str.c_str());
+  auto mock_intern_string_if_necessary_and_get_key = [&text](std::string_view str) {
+    EXPECT_EQ(text, str);
     return expected_text_key;
   };
   EXPECT_CALL(*producer_, InternStringIfNecessaryAndGetKey)
@@ -1464,6 +1505,64 @@ TEST_F(SubmissionTrackerTest, CanRetrieveDebugMarkerAcrossTwoSubmissionsEvenWhen
   EXPECT_FALSE(actual_debug_marker.has_begin_marker());
 }
 
+TEST_F(SubmissionTrackerTest, InternsLabelOfDebugMarkerBeginSubmittedBeforeCaptureOnCompletion) {
+  ExpectThreeNextReadyQuerySlotCalls();
+  EXPECT_CALL(dispatch_table_, GetQueryPoolResults)
+      .WillRepeatedly(Return(mock_get_query_pool_results_function_all_ready_));
+  orbit_grpc_protos::ProducerCaptureEvent actual_capture_event;
+  auto mock_enqueue_capture_event =
+      [&actual_capture_event](orbit_grpc_protos::ProducerCaptureEvent&& capture_event) {
+        actual_capture_event = std::move(capture_event);
+        return true;
+      };
+
+  const char* text = "Text";
+  constexpr uint64_t expected_text_key = 111;
+  auto mock_intern_string_if_necessary_and_get_key = [&text](std::string_view str) {
+    EXPECT_EQ(text, str);
+    return expected_text_key;
+  };
+  EXPECT_CALL(*producer_, EnqueueCaptureEvent)
+      .Times(1)
+      .WillOnce(Invoke(mock_enqueue_capture_event));
+
+  Color expected_color{1.f, 0.8f, 0.6f, 0.4f};
+
+  tracker_.TrackCommandBuffers(device_, command_pool_, &command_buffer_, 1);
+  tracker_.MarkCommandBufferBegin(command_buffer_);
+  tracker_.MarkDebugMarkerBegin(command_buffer_, text, expected_color);
+  tracker_.MarkCommandBufferEnd(command_buffer_);
+  std::optional<QueueSubmission> queue_submission_optional_1 =
+      tracker_.PersistCommandBuffersOnSubmit(queue_, 1, &submit_info_);
+  tracker_.PersistDebugMarkersOnSubmit(queue_, 1, &submit_info_, queue_submission_optional_1);
+  tracker_.ResetCommandBuffer(command_buffer_);
+
+  // Neither the begin nor its submission happened during a capture, so the label can only be
+  // interned when the end completes the marker.
+  EXPECT_CALL(*producer_, InternStringIfNecessaryAndGetKey)
+      .Times(1)
+      .WillOnce(Invoke(mock_intern_string_if_necessary_and_get_key));
+  producer_->StartCapture();
+  tracker_.MarkCommandBufferBegin(command_buffer_);
+  tracker_.MarkDebugMarkerEnd(command_buffer_);
+  tracker_.MarkCommandBufferEnd(command_buffer_);
+  std::optional<QueueSubmission> queue_submission_optional_2 =
+      tracker_.PersistCommandBuffersOnSubmit(queue_, 1, &submit_info_);
+  tracker_.PersistDebugMarkersOnSubmit(queue_, 1, &submit_info_, queue_submission_optional_2);
+  tracker_.CompleteSubmits(device_);
+
+  EXPECT_TRUE(actual_capture_event.has_gpu_queue_submission());
+  const orbit_grpc_protos::GpuQueueSubmission& actual_queue_submission =
+      actual_capture_event.gpu_queue_submission();
+  EXPECT_EQ(actual_queue_submission.num_begin_markers(), 0);
+  ASSERT_EQ(actual_queue_submission.completed_markers_size(), 1);
+  const orbit_grpc_protos::GpuDebugMarker& actual_debug_marker =
+      actual_queue_submission.completed_markers(0);
+
+  ExpectDebugMarkerEndEq(actual_debug_marker, kTimestamp2, expected_text_key, expected_color, 0);
+  EXPECT_FALSE(actual_debug_marker.has_begin_marker());
+}
+
 TEST_F(SubmissionTrackerTest, ResetSlotsOnDebugMarkerAcrossTwoSubmissionsWhenEndNotCaptured) {
   ExpectThreeNextReadyQuerySlotCalls();
   EXPECT_CALL(dispatch_table_, GetQueryPoolResults)
@@ -1488,7 +1587,8 @@ TEST_F(SubmissionTrackerTest, ResetSlotsOnDebugMarkerAcrossTwoSubmissionsWhenEnd
       };
 
   const char* text = "Text";
-  EXPECT_CALL(*producer_, InternStringIfNecessaryAndGetKey).Times(0);
+  // The label is interned when the begin marker is recorded, even if the end is never captured.
+  EXPECT_CALL(*producer_, InternStringIfNecessaryAndGetKey).Times(1);
   EXPECT_CALL(*producer_, EnqueueCaptureEvent)
       .Times(1)
       .WillOnce(Invoke(mock_enqueue_capture_event));
@@ -1575,7 +1675,7 @@ TEST_F(SubmissionTrackerTest, CanLimitNestedDebugMarkerDepthPerCommandBuffer) {
   const std::string text_outer = "Outer";
   const std::string text_inner = "Inner";
   constexpr uint64_t expected_text_key_outer = 111;
-  auto mock_intern_string_if_necessary_and_get_key = [&text_outer](std::string str) {
+  auto mock_intern_string_if_necessary_and_get_key = [&text_outer](std::string_view str) {
     if (str == text_outer) {
       return expected_text_key_outer;
     }
@@ -1659,7 +1759,7 @@ TEST_F(SubmissionTrackerTest, CanLimitNestedDebugMarkerDepthPerCommandBufferAcro
   const std::string text_outer = "Outer";
   const std::string text_inner = "Inner";
   constexpr uint64_t expected_outer_text_key = 111;
-  auto mock_intern_string_if_necessary_and_get_key = [&text_outer](std::string str) {
+  auto mock_intern_string_if_necessary_and_get_key = [&text_outer](std::string_view str) {
     EXPECT_EQ(text_outer, str);
     return expected_outer_text_key;
   };
@@ -1863,4 +1963,155 @@ TEST_F(SubmissionTrackerTest, WillWriteTimestampEvenWhenCommandBufferIsNotInInit
 
   EXPECT_THAT(actual_slots_to_reset, UnorderedElementsAre(kSlotIndex1, kSlotIndex2));
 }
+
+TEST_F(SubmissionTrackerTest, ReportsDroppedTimestampsWhenQuerySlotsAreExhausted) {
+  EXPECT_CALL(timer_query_pool_, NextReadyQuerySlot).WillRepeatedly(Return(false));
+  EXPECT_CALL(dispatch_table_, CmdWriteTimestamp).Times(0);
+  std::vector<orbit_grpc_protos::ProducerCaptureEvent> actual_capture_events;
+  auto mock_enqueue_capture_event =
+      [&actual_capture_events](orbit_grpc_protos::ProducerCaptureEvent&& capture_event) {
+        actual_capture_events.emplace_back(std::move(capture_event));
+        return true;
+      };
+  EXPECT_CALL(*producer_, EnqueueCaptureEvent).WillRepeatedly(Invoke(mock_enqueue_capture_event));
+  EXPECT_CALL(*producer_, InternStringIfNecessaryAndGetKey).WillRepeatedly(Return(1));
+
+  producer_->StartCapture();
+  tracker_.TrackCommandBuffers(device_, command_pool_, &command_buffer_, 1);
+  tracker_.MarkCommandBufferBegin(command_buffer_);
+  tracker_.MarkDebugMarkerBegin(command_buffer_, "Marker", {});
+  tracker_.MarkDebugMarkerEnd(command_buffer_);
+  tracker_.MarkCommandBufferEnd(command_buffer_);
+  std::optional<QueueSubmission> queue_submission_optional =
+      tracker_.PersistCommandBuffersOnSubmit(queue_, 1, &submit_info_);
+  tracker_.PersistDebugMarkersOnSubmit(queue_, 1, &submit_info_, queue_submission_optional);
+  tracker_.CompleteSubmits(device_);
+  // The dropped timestamps were already reported, so stopping the capture must not report them
+  // again.
+  producer_->StopCapture();
+
+  std::vector<orbit_grpc_protos::GpuQuerySlotsExhaustedEvent> exhausted_events;
+  for (const orbit_grpc_protos::ProducerCaptureEvent& capture_event : actual_capture_events) {
+    if (capture_event.has_gpu_query_slots_exhausted_event()) {
+      exhausted_events.push_back(capture_event.gpu_query_slots_exhausted_event());
+    }
+  }
+  ASSERT_EQ(exhausted_events.size(), 1);
+  EXPECT_EQ(exhausted_events[0].pid(), orbit_base::GetCurrentProcessId());
+  EXPECT_EQ(exhausted_events[0].num_dropped_command_buffer_timestamps(), 2);
+  EXPECT_EQ(exhausted_events[0].num_dropped_debug_marker_timestamps(), 2);
+}
+
+namespace {
+// Counts the calls into the driver that read back or reset timestamp queries, such that the
+// `SubmissionTracker` can be tested together with the actual `TimerQueryPool`.
+class CountingDispatchTable {
+ public:
+  PFN_vkCreateQueryPool CreateQueryPool(VkDevice /*device*/) {
+    return +[](VkDevice /*device*/, const VkQueryPoolCreateInfo* /*create_info*/,
+               const VkAllocationCallbacks* /*allocator*/, VkQueryPool* query_pool) -> VkResult {
+      *query_pool = {};
+      return VK_SUCCESS;
+    };
+  }
+
+  PFN_vkDestroyQueryPool DestroyQueryPool(VkDevice /*device*/) {
+    return +[](VkDevice /*device*/, VkQueryPool /*query_pool*/,
+               const VkAllocationCallbacks* /*allocator*/) {};
+  }
+
+  PFN_vkResetQueryPoolEXT ResetQueryPoolEXT(VkDevice /*device*/) {
+    return +[](VkDevice /*device*/, VkQueryPool /*query_pool*/, uint32_t /*first_query*/,
+               uint32_t /*query_count*/) { ++reset_query_pool_call_count; };
+  }
+
+  PFN_vkCmdWriteTimestamp CmdWriteTimestamp(VkCommandBuffer /*command_buffer*/) {
+    return dummy_write_timestamp_function;
+  }
+
+  PFN_vkGetQueryPoolResults GetQueryPoolResults(VkDevice /*device*/) {
+    return +[](VkDevice /*device*/, VkQueryPool /*query_pool*/, uint32_t first_query,
+               uint32_t query_count, size_t /*data_size*/, void* data, VkDeviceSize /*stride*/,
+               VkQueryResultFlags /*flags*/) -> VkResult {
+      ++get_query_pool_results_call_count;
+      auto* results = static_cast<uint64_t*>(data);
+      for (uint32_t i = 0; i < query_count; ++i) {
+        results[2 * i] = first_query + i;
+        results[2 * i + 1] = 1;
+      }
+      return VK_SUCCESS;
+    };
+  }
+
+  static inline uint32_t reset_query_pool_call_count = 0;
+  static inline uint32_t get_query_pool_results_call_count = 0;
+};
+}  // namespace
+
+TEST(SubmissionTrackerWithTimerQueryPool, TimestampQueriesAndResetsAreBatchedPerFrame) {
+  static constexpr uint32_t kNumCommandBuffers = 4;
+  CountingDispatchTable dispatch_table;
+  MockDeviceManager device_manager;
+  VkPhysicalDeviceProperties physical_device_properties = {.limits = {.timestampPeriod = 1.f}};
+  EXPECT_CALL(device_manager, GetPhysicalDeviceOfLogicalDevice)
+      .WillRepeatedly(Return(VkPhysicalDevice{}));
+  EXPECT_CALL(device_manager, GetPhysicalDeviceProperties)
+      .WillRepeatedly(Return(physical_device_properties));
+
+  TimerQueryPool<CountingDispatchTable> timer_query_pool(&dispatch_table, 1024);
+  SubmissionTracker<CountingDispatchTable, MockDeviceManager, TimerQueryPool<CountingDispatchTable>>
+      tracker(&dispatch_table, &timer_query_pool, &device_manager,
+              std::numeric_limits<uint32_t>::max());
+
+  VkDevice device = {};
+  VkCommandPool command_pool = {};
+  VkQueue queue = {};
+  timer_query_pool.InitializeTimerQueryPool(device);
+  std::array<VkCommandBuffer, kNumCommandBuffers> command_buffers{};
+  for (size_t i = 0; i < command_buffers.size(); ++i) {
+    command_buffers[i] = absl::bit_cast<VkCommandBuffer>(static_cast<uintptr_t>(i + 1));
+  }
+  tracker.TrackCommandBuffers(device, command_pool, command_buffers.data(), kNumCommandBuffers);
+  tracker.OnCaptureStart(orbit_grpc_protos::CaptureOptions{});
+
+  VkSubmitInfo submit_info = {.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO,
+                              .pNext = nullptr,
+                              .commandBufferCount = kNumCommandBuffers,
+                              .pCommandBuffers = command_buffers.data()};
+  // Each frame uses four timestamp queries per command buffer, i.e. 16 queries.
+  auto record_and_submit_frame = [&] {
+    for (VkCommandBuffer command_buffer : command_buffers) {
+      tracker.ResetCommandBuffer(command_buffer);
+      tracker.MarkCommandBufferBegin(command_buffer);
+      tracker.MarkDebugMarkerBegin(command_buffer, "Marker", {});
+      tracker.MarkDebugMarkerEnd(command_buffer);
+      tracker.MarkCommandBufferEnd(command_buffer);
+    }
+    auto queue_submission_optional = tracker.PersistCommandBuffersOnSubmit(queue, 1, &submit_info);
+    tracker.PersistDebugMarkersOnSubmit(queue, 1, &submit_info, queue_submission_optional);
+  };
+
+  CountingDispatchTable::reset_query_pool_call_count = 0;
+  CountingDispatchTable::get_query_pool_results_call_count = 0;
+  record_and_submit_frame();
+  tracker.CompleteSubmits(device);
+  // All queries of the frame are read at once. Their slots are not released before the command
+  // buffers get reset.
+  EXPECT_EQ(CountingDispatchTable::get_query_pool_results_call_count, 1);
+  EXPECT_EQ(CountingDispatchTable::reset_query_pool_call_count, 0);
+
+  CountingDispatchTable::reset_query_pool_call_count = 0;
+  CountingDispatchTable::get_query_pool_results_call_count = 0;
+  record_and_submit_frame();
+  tracker.CompleteSubmits(device);
+  // Resetting the command buffers released the slots of the previous frame, which are reset at
+  // once.
+  EXPECT_EQ(CountingDispatchTable::get_query_pool_results_call_count, 1);
+  EXPECT_EQ(CountingDispatchTable::reset_query_pool_call_count, 1);
+
+  tracker.OnCaptureFinished();
+  tracker.UntrackCommandBuffers(device, command_pool, command_buffers.data(), kNumCommandBuffers);
+  timer_query_pool.DestroyTimerQueryPool(device);
+}
+
 }  // namespace orbit_vulkan_layer
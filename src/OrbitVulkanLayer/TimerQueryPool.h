@@ -6,12 +6,13 @@
 #define ORBIT_VULKAN_LAYER_TIMER_QUERY_POOL_H_
 
 #include <absl/container/flat_hash_map.h>
-#include <absl/container/flat_hash_set.h>
 #include <absl/synchronization/mutex.h>
 #include <vulkan/vulkan.h>
 
-#include <fstream>
-#include <numeric>
+#include <algorithm>
+#include <atomic>
+#include <limits>
+#include <memory>
 #include <vector>
 
 #include "OrbitBase/Logging.h"
@@ -24,6 +25,14 @@ namespace orbit_vulkan_layer {
 // indices.
 // In order to do so, it stores the internal `SlotState` for each index.
 //
+// A device starts with a single `VkQueryPool` of `num_slots_per_query_pool` slots. If all slots are
+// occupied, further pools of the same size are created on demand, up to `max_num_query_pools`.
+// The slots of all pools of a device form one ring of slot indices, where slot index `i` refers
+// to query `i % num_slots_per_query_pool` of the pool `i / num_slots_per_query_pool` (see
+// `GetQueryPool` and `GetQueryIndexInPool`). Slots are handed out walking along that ring, so
+// that consecutively requested slots tend to have contiguous indices. This keeps the number of
+// ranges small when reading back and resetting the queries of a frame.
+//
 // Slots can be requested using `NextReadyQuerySlot, which will block them until being reset again.
 // If the command buffer storing the slot index gets reset before it was even submitted,
 // `RollbackPendingQuerySlots` can be called to mark the slot as being free (ready) again without
@@ -31,116 +40,139 @@ namespace orbit_vulkan_layer {
 // Once submitted, the slot is baked into the command buffer (until the command buffer is being
 // reset again). In order to free that slot, two things need to happen:
 // 1. The client (this Vulkan layer) needs to communicate that it will not do any attempts to read
-//    that slot anymore (done by calling `MarkSlotDoneReading`).
+//    that slot anymore (done by calling `MarkQuerySlotsDoneReading`).
 // 2. The command buffer needs to reset, to ensure that the slot index is not baked into it anymore
-//    (done by calling `MarkSlotForReset`).
+//    (done by calling `MarkQuerySlotsForReset`).
+// The slot is then released, but its content still needs to be reset on the device. Resets are
+// deferred until `ResetReleasedQuerySlots` is called (once per frame), which resets all released
+// slots with one call per range of contiguous slot indices, instead of one call per slot.
 //
 // The following state machine represents the allowed calls.
 //
 // MarkQuerySlotForReset                  MarkQuerySlotDoneReading
 //           ------------- kDoneReading <--------------
 //          |                                          |
+//          v                                          |
+//      kReleased                                      |
 //          |                                          |
-//          |           NextReadyQuerySlot             |
-//          v          --------------------->          |
-// kReadyForQueryIssue                        kQueryPendingOnGpu
+//          | ResetReleasedQuerySlots                  |
+//          v          NextReadyQuerySlot              |
+// kReadyForQueryIssue --------------------->  kQueryPendingOnGpu
 //          ^          <---------------------          |
 //          |         RollbackPendingQuerySlots        |
+//          | ResetReleasedQuerySlots                  |
 //          |                                          |
+//      kReleased                                      |
+//          ^                                          |
 //          |                                          |
 //           ------------ kResetRequested <------------
 // MarkQuerySlotDoneReading                   MarkQuerySlotForReset
 //
 //
-// Thread-Safety: This class is internally synchronized (using read/write locks) and can be safely
-// accessed from different threads.
+// Thread-Safety: This class is internally synchronized and can be safely accessed from different
+// threads. Requesting and releasing slots is lock-free: the state of each slot is an atomic that is
+// only advanced with compare-and-swap, the position in the ring is an atomic counter, and the
+// released slots of a device form a lock-free stack. Only `InitializeTimerQueryPool`,
+// `DestroyTimerQueryPool` and the creation of additional pools take a lock. The former two publish
+// an immutable snapshot of the per-device pools, so that looking up the pool of a device does not
+// need one.
 template <class DispatchTable>
 class TimerQueryPool {
  public:
-  explicit TimerQueryPool(DispatchTable* dispatch_table, uint32_t num_timer_query_slots)
-      : dispatch_table_(dispatch_table), num_timer_query_slots_(num_timer_query_slots) {}
+  explicit TimerQueryPool(DispatchTable* dispatch_table, uint32_t num_slots_per_query_pool,
+                          uint32_t max_num_query_pools = 1)
+      : dispatch_table_(dispatch_table),
+        num_slots_per_query_pool_(num_slots_per_query_pool),
+        max_num_query_pools_(max_num_query_pools) {
+    CHECK(num_slots_per_query_pool_ > 0);
+    CHECK(max_num_query_pools_ > 0);
+    CHECK(static_cast<uint64_t>(num_slots_per_query_pool_) * max_num_query_pools_ < kNoSlot);
+    PublishDeviceSnapshot();
+  }
 
-  // Creates and resets a vulkan `VkQueryPool`, ready to use for timestamp queries.
+  // Creates and resets the first vulkan `VkQueryPool` of the device, ready to use for timestamp
+  // queries.
   void InitializeTimerQueryPool(VkDevice device) {
-    VkQueryPool query_pool;
-
-    VkQueryPoolCreateInfo create_info = {.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO,
-                                         .pNext = nullptr,
-                                         .flags = 0,
-                                         .queryType = VK_QUERY_TYPE_TIMESTAMP,
-                                         .queryCount = num_timer_query_slots_,
-                                         .pipelineStatistics = 0};
-
-    VkResult result =
-        dispatch_table_->CreateQueryPool(device)(device, &create_info, nullptr, &query_pool);
-    CHECK(result == VK_SUCCESS);
+    auto device_query_pool = std::make_unique<DeviceQueryPool>(max_num_query_pools_);
+    AddQueryPool(device, device_query_pool.get());
 
-    dispatch_table_->ResetQueryPoolEXT(device)(device, query_pool, 0, num_timer_query_slots_);
-
-    {
-      absl::WriterMutexLock lock(&mutex_);
-      CHECK(!device_to_query_pool_.contains(device));
-      device_to_query_pool_[device] = query_pool;
-      std::vector<SlotState> slots{num_timer_query_slots_};
-      std::fill(slots.begin(), slots.end(), SlotState::kReadyForQueryIssue);
-      device_to_query_slots_[device] = slots;
-      std::vector<uint32_t> free_slots(num_timer_query_slots_);
-      // At the beginning all slot indices in [0, num_timer_query_slots) are free.
-      std::iota(free_slots.begin(), free_slots.end(), 0);
-      device_to_free_slots_[device] = free_slots;
-    }
+    absl::MutexLock lock(&mutex_);
+    CHECK(!device_to_query_pool_.contains(device));
+    device_to_query_pool_.emplace(device, std::move(device_query_pool));
+    PublishDeviceSnapshot();
   }
 
-  // Destroys the VkQueryPool for the given device
+  // Destroys all VkQueryPools for the given device
   void DestroyTimerQueryPool(VkDevice device) {
-    absl::WriterMutexLock lock(&mutex_);
+    absl::MutexLock lock(&mutex_);
     CHECK(device_to_query_pool_.contains(device));
-    VkQueryPool query_pool = device_to_query_pool_.at(device);
-    device_to_query_slots_.erase(device);
-    device_to_free_slots_.erase(device);
+    DeviceQueryPool* device_query_pool = device_to_query_pool_.at(device).get();
 
-    dispatch_table_->DestroyQueryPool(device)(device, query_pool, nullptr);
+    uint32_t num_query_pools = device_query_pool->num_query_pools.load(std::memory_order_acquire);
+    for (uint32_t pool_index = 0; pool_index < num_query_pools; ++pool_index) {
+      dispatch_table_->DestroyQueryPool(device)(
+          device, device_query_pool->query_pools[pool_index].load()->query_pool, nullptr);
+    }
 
+    // Vulkan requires that all uses of a device have completed when it gets destroyed. So no other
+    // thread can still be working on the state of this pool, even if it still sees it in an older
+    // snapshot.
     device_to_query_pool_.erase(device);
+    PublishDeviceSnapshot();
   }
 
-  // Retrieves the query pool for a given device. Note that the pool must be initialized using
-  // `InitializeTimerQueryPool` before.
-  [[nodiscard]] VkQueryPool GetQueryPool(VkDevice device) {
-    absl::ReaderMutexLock lock(&mutex_);
-    CHECK(device_to_query_pool_.contains(device));
-    return device_to_query_pool_.at(device);
+  // Retrieves the query pool of a given device that holds the given slot. Note that the pool must
+  // be initialized using `InitializeTimerQueryPool` before, and that the slot must be a result of
+  // `NextReadyQuerySlot`.
+  [[nodiscard]] VkQueryPool GetQueryPool(VkDevice device, uint32_t slot_index) {
+    return GetQueryPoolOfSlot(GetDeviceQueryPool(device), slot_index)->query_pool;
+  }
+
+  // Returns the index of the query in its `VkQueryPool` (see `GetQueryPool`) that corresponds to
+  // the given slot.
+  [[nodiscard]] uint32_t GetQueryIndexInPool(uint32_t slot_index) const {
+    return slot_index % num_slots_per_query_pool_;
   }
 
-  // Returns a free query slot from the device's pool if one still exists. It returns `false` if all
-  // slots are occupied and true otherwise. If successful, the index will be written to the given
-  // `allocated_index`.
+  // Returns a free query slot from the device's pools if one still exists. If all slots are
+  // occupied, it creates an additional pool, unless there are already `max_num_query_pools`. It
+  // returns `false` if no slot could be found and true otherwise. If successful, the index will be
+  // written to the given `allocated_index`.
   //
   // Note that the pool must be initialized using `InitializeTimerQueryPool` before.
-  // See also `ResetQuerySlots` to make occupied slots available again.
+  // See also `MarkQuerySlotsDoneReading`, `MarkQuerySlotsForReset` and
+  // `ResetReleasedQuerySlots` to make occupied slots available again.
   [[nodiscard]] bool NextReadyQuerySlot(VkDevice device, uint32_t* allocated_index) {
-    absl::WriterMutexLock lock(&mutex_);
-    CHECK(device_to_free_slots_.contains(device));
-    CHECK(device_to_query_slots_.contains(device));
-    std::vector<uint32_t>& free_slots = device_to_free_slots_.at(device);
-    if (free_slots.empty()) {
-      return false;
+    DeviceQueryPool* device_query_pool = GetDeviceQueryPool(device);
+    while (!ReserveReadySlot(device_query_pool)) {
+      if (!AddQueryPool(device, device_query_pool)) {
+        return false;
+      }
     }
-    *allocated_index = free_slots.back();
-    free_slots.pop_back();
 
-    CHECK(device_to_query_slots_.at(device)[*allocated_index] == SlotState::kReadyForQueryIssue);
-    device_to_query_slots_.at(device)[*allocated_index] = SlotState::kQueryPendingOnGpu;
-    return true;
+    // A ready slot was reserved, so walking along the ring is guaranteed to find one. Other
+    // threads might take the ready slots we pass by, but each of them also reserved one.
+    while (true) {
+      uint32_t num_slots = GetNumSlots(device_query_pool);
+      uint32_t slot_index = static_cast<uint32_t>(
+          device_query_pool->ring_position.fetch_add(1, std::memory_order_relaxed) % num_slots);
+      SlotState expected_state = SlotState::kReadyForQueryIssue;
+      if (GetSlotState(device_query_pool, slot_index)
+              ->compare_exchange_strong(expected_state, SlotState::kQueryPendingOnGpu,
+                                        std::memory_order_acq_rel)) {
+        *allocated_index = slot_index;
+        return true;
+      }
+    }
   }
 
   // Marks for the given slots that the Vulkan layer will not do any attempts to read the underlying
   // slots anymore after this call.
   //
   // If for a given slot `MarkQuerySlotsForReset` was already called (i.e. `vkResetCommandBuffer`
-  // was called on the command buffers using the slot), it resets an occupied slot to be ready for
-  // queries again. In this case it will also call to Vulkan to reset the content of that slot
-  // (in contrast to `RollbackPendingQuerySlots`).
+  // was called on the command buffers using the slot), it releases the slot. Its content will be
+  // reset on the next call to `ResetReleasedQuerySlots` (in contrast to
+  // `RollbackPendingQuerySlots`), which makes it ready for queries again.
   //
   // Note that the pool must be initialized using `InitializeTimerQueryPool` before.
   // Further, the given slots must be in the `kReadyForQueryIssue` state, i.e. must be a result
@@ -149,23 +181,17 @@ class TimerQueryPool {
     if (slot_indices.empty()) {
       return;
     }
-    absl::WriterMutexLock lock(&mutex_);
-    CHECK(device_to_query_slots_.contains(device));
-    std::vector<SlotState>& slot_states = device_to_query_slots_.at(device);
-    CHECK(device_to_free_slots_.contains(device));
-    std::vector<uint32_t>& free_slots = device_to_free_slots_.at(device);
+    DeviceQueryPool* device_query_pool = GetDeviceQueryPool(device);
     for (uint32_t slot_index : slot_indices) {
-      CHECK(slot_index < num_timer_query_slots_);
-      const SlotState& current_state = slot_states[slot_index];
-      if (current_state == SlotState::kQueryPendingOnGpu) {
-        slot_states[slot_index] = SlotState::kDoneReading;
+      CHECK(slot_index < GetNumSlots(device_query_pool));
+      SlotState current_state = SlotState::kQueryPendingOnGpu;
+      if (GetSlotState(device_query_pool, slot_index)
+              ->compare_exchange_strong(current_state, SlotState::kDoneReading,
+                                        std::memory_order_acq_rel)) {
         continue;
       }
       CHECK(current_state == SlotState::kResetRequested);
-      slot_states[slot_index] = SlotState::kReadyForQueryIssue;
-      free_slots.push_back(slot_index);
-      VkQueryPool query_pool = device_to_query_pool_.at(device);
-      dispatch_table_->ResetQueryPoolEXT(device)(device, query_pool, slot_index, 1);
+      ReleaseSlot(device_query_pool, slot_index);
     }
   }
 
@@ -173,9 +199,9 @@ class TimerQueryPool {
   // (i.e. `vkResetCommandBuffer` was called on the command buffers using the slots).
   //
   // If for a given slot `MarkQuerySlotsDoneReading` was already called (i.e. the layer will not do
-  // any attempt to read the slot), it resets an occupied slot to be ready for queries again.
-  // In this case it will also call to Vulkan to reset the content of that slot
-  // (in contrast to `RollbackPendingQuerySlots`).
+  // any attempt to read the slot), it releases the slot. Its content will be reset on the next call
+  // to `ResetReleasedQuerySlots` (in contrast to `RollbackPendingQuerySlots`), which makes it ready
+  // for queries again.
   //
   // Note that the pool must be initialized using `InitializeTimerQueryPool` before.
   // Further, the given slots must be in the `kReadyForQueryIssue` state, i.e. must be a result
@@ -184,23 +210,17 @@ class TimerQueryPool {
     if (slot_indices.empty()) {
       return;
     }
-    absl::WriterMutexLock lock(&mutex_);
-    CHECK(device_to_query_slots_.contains(device));
-    std::vector<SlotState>& slot_states = device_to_query_slots_.at(device);
-    CHECK(device_to_free_slots_.contains(device));
-    std::vector<uint32_t>& free_slots = device_to_free_slots_.at(device);
+    DeviceQueryPool* device_query_pool = GetDeviceQueryPool(device);
     for (uint32_t slot_index : slot_indices) {
-      CHECK(slot_index < num_timer_query_slots_);
-      const SlotState& current_state = slot_states[slot_index];
-      if (current_state == SlotState::kQueryPendingOnGpu) {
-        slot_states[slot_index] = SlotState::kResetRequested;
+      CHECK(slot_index < GetNumSlots(device_query_pool));
+      SlotState current_state = SlotState::kQueryPendingOnGpu;
+      if (GetSlotState(device_query_pool, slot_index)
+              ->compare_exchange_strong(current_state, SlotState::kResetRequested,
+                                        std::memory_order_acq_rel)) {
         continue;
       }
       CHECK(current_state == SlotState::kDoneReading);
-      slot_states[slot_index] = SlotState::kReadyForQueryIssue;
-      free_slots.push_back(slot_index);
-      VkQueryPool query_pool = device_to_query_pool_.at(device);
-      dispatch_table_->ResetQueryPoolEXT(device)(device, query_pool, slot_index, 1);
+      ReleaseSlot(device_query_pool, slot_index);
     }
   }
 
@@ -216,18 +236,64 @@ class TimerQueryPool {
     if (slot_indices.empty()) {
       return;
     }
-    absl::WriterMutexLock lock(&mutex_);
-    CHECK(device_to_query_slots_.contains(device));
-    std::vector<SlotState>& slot_states = device_to_query_slots_.at(device);
-    CHECK(device_to_free_slots_.contains(device));
-    std::vector<uint32_t>& free_slots = device_to_free_slots_.at(device);
+    DeviceQueryPool* device_query_pool = GetDeviceQueryPool(device);
     for (uint32_t slot_index : slot_indices) {
-      CHECK(slot_index < num_timer_query_slots_);
-      const SlotState& current_state = slot_states[slot_index];
-      CHECK(current_state == SlotState::kQueryPendingOnGpu);
-      slot_states[slot_index] = SlotState::kReadyForQueryIssue;
-      free_slots.push_back(slot_index);
+      CHECK(slot_index < GetNumSlots(device_query_pool));
+      SlotState current_state = SlotState::kQueryPendingOnGpu;
+      CHECK(GetSlotState(device_query_pool, slot_index)
+                ->compare_exchange_strong(current_state, SlotState::kReadyForQueryIssue,
+                                          std::memory_order_acq_rel));
     }
+    device_query_pool->num_ready_slots.fetch_add(static_cast<uint32_t>(slot_indices.size()),
+                                                 std::memory_order_release);
+  }
+
+  // Resets the content of all slots released by `MarkQuerySlotsDoneReading` and
+  // `MarkQuerySlotsForReset` since the last call and makes them ready for queries again. Slots with
+  // contiguous indices in the same `VkQueryPool` are reset with a single call to Vulkan. This is
+  // supposed to be called once per frame, e.g. on `vkQueuePresentKHR`.
+  //
+  // Note that the pool must be initialized using `InitializeTimerQueryPool` before.
+  void ResetReleasedQuerySlots(VkDevice device) {
+    DeviceQueryPool* device_query_pool = GetDeviceQueryPool(device);
+    // Take the whole stack of released slots at once. From then on, no other thread can access
+    // the links of these slots.
+    uint64_t head =
+        device_query_pool->released_slots_head.exchange(kNoSlot, std::memory_order_acquire);
+    std::vector<uint32_t> released_slots;
+    for (uint32_t slot_index = SlotOfHead(head); slot_index != kNoSlot;
+         slot_index = GetNextReleasedSlot(device_query_pool, slot_index)
+                          ->load(std::memory_order_relaxed)) {
+      released_slots.push_back(slot_index);
+    }
+    if (released_slots.empty()) {
+      return;
+    }
+    std::sort(released_slots.begin(), released_slots.end());
+
+    size_t range_begin = 0;
+    while (range_begin < released_slots.size()) {
+      size_t range_end = range_begin + 1;
+      while (range_end < released_slots.size() &&
+             released_slots[range_end] == released_slots[range_end - 1] + 1 &&
+             GetQueryIndexInPool(released_slots[range_end]) != 0) {
+        ++range_end;
+      }
+      uint32_t first_slot_index = released_slots[range_begin];
+      dispatch_table_->ResetQueryPoolEXT(device)(
+          device, GetQueryPoolOfSlot(device_query_pool, first_slot_index)->query_pool,
+          GetQueryIndexInPool(first_slot_index), static_cast<uint32_t>(range_end - range_begin));
+      range_begin = range_end;
+    }
+
+    for (uint32_t slot_index : released_slots) {
+      SlotState previous_state = GetSlotState(device_query_pool, slot_index)
+                                     ->exchange(SlotState::kReadyForQueryIssue,
+                                                std::memory_order_acq_rel);
+      CHECK(previous_state == SlotState::kReleased);
+    }
+    device_query_pool->num_ready_slots.fetch_add(static_cast<uint32_t>(released_slots.size()),
+                                                 std::memory_order_release);
   }
 
  private:
@@ -235,17 +301,193 @@ class TimerQueryPool {
     kReadyForQueryIssue = 0,
     kQueryPendingOnGpu = 1,
     kDoneReading = 2,
-    kResetRequested = 3
+    kResetRequested = 3,
+    kReleased = 4
+  };
+
+  // Marks the end of the list of released slots.
+  static constexpr uint32_t kNoSlot = std::numeric_limits<uint32_t>::max();
+
+  // A single `VkQueryPool` and the state of its slots.
+  struct QueryPool {
+    QueryPool(VkQueryPool query_pool, uint32_t num_slots)
+        : query_pool(query_pool),
+          slot_states(std::make_unique<std::atomic<SlotState>[]>(num_slots)),
+          next_released_slot(std::make_unique<std::atomic<uint32_t>[]>(num_slots)) {
+      for (uint32_t slot_index = 0; slot_index < num_slots; ++slot_index) {
+        slot_states[slot_index].store(SlotState::kReadyForQueryIssue, std::memory_order_relaxed);
+      }
+    }
+
+    const VkQueryPool query_pool;
+    std::unique_ptr<std::atomic<SlotState>[]> slot_states;
+    std::unique_ptr<std::atomic<uint32_t>[]> next_released_slot;
+  };
+
+  // The state of all `VkQueryPool`s of a single device. `query_pools` has room for the maximum
+  // number of pools, such that it never needs to be reallocated while other threads read it. Only
+  // the first `num_query_pools` entries are set, and each entry is set before `num_query_pools` is
+  // increased.
+  // `num_ready_slots` counts the slots in the `kReadyForQueryIssue` state that are not yet reserved
+  // by a call to `NextReadyQuerySlot`. This allows to detect that all slots are occupied without
+  // walking along the whole ring.
+  // The released slots (waiting for `ResetReleasedQuerySlots`) are a singly-linked stack threaded
+  // through `next_released_slot`. The head packs the index of the top slot into the lower 32 bits
+  // and a counter, that is incremented on every update, into the upper 32 bits. The released slots
+  // are only ever taken all at once.
+  struct DeviceQueryPool {
+    explicit DeviceQueryPool(uint32_t max_num_query_pools)
+        : query_pools(std::make_unique<std::atomic<QueryPool*>[]>(max_num_query_pools)) {}
+
+    std::unique_ptr<std::atomic<QueryPool*>[]> query_pools;
+    std::atomic<uint32_t> num_query_pools = 0;
+    std::atomic<uint32_t> num_ready_slots = 0;
+    std::atomic<uint64_t> ring_position = 0;
+    std::atomic<uint64_t> released_slots_head = kNoSlot;
+
+    // Guards the creation of additional pools and owns them.
+    absl::Mutex add_query_pool_mutex;
+    std::vector<std::unique_ptr<QueryPool>> owned_query_pools;
   };
 
+  using DeviceSnapshot = absl::flat_hash_map<VkDevice, DeviceQueryPool*>;
+
+  [[nodiscard]] static uint32_t SlotOfHead(uint64_t head) { return static_cast<uint32_t>(head); }
+
+  [[nodiscard]] static uint64_t NextHead(uint64_t head, uint32_t slot_index) {
+    uint64_t counter = (head >> 32) + 1;
+    return (counter << 32) | slot_index;
+  }
+
+  [[nodiscard]] uint32_t GetNumSlots(DeviceQueryPool* device_query_pool) const {
+    return device_query_pool->num_query_pools.load(std::memory_order_acquire) *
+           num_slots_per_query_pool_;
+  }
+
+  [[nodiscard]] QueryPool* GetQueryPoolOfSlot(DeviceQueryPool* device_query_pool,
+                                              uint32_t slot_index) const {
+    uint32_t pool_index = slot_index / num_slots_per_query_pool_;
+    CHECK(pool_index < device_query_pool->num_query_pools.load(std::memory_order_acquire));
+    return device_query_pool->query_pools[pool_index].load(std::memory_order_acquire);
+  }
+
+  [[nodiscard]] std::atomic<SlotState>* GetSlotState(DeviceQueryPool* device_query_pool,
+                                                     uint32_t slot_index) const {
+    return &GetQueryPoolOfSlot(device_query_pool, slot_index)
+                ->slot_states[GetQueryIndexInPool(slot_index)];
+  }
+
+  [[nodiscard]] std::atomic<uint32_t>* GetNextReleasedSlot(DeviceQueryPool* device_query_pool,
+                                                           uint32_t slot_index) const {
+    return &GetQueryPoolOfSlot(device_query_pool, slot_index)
+                ->next_released_slot[GetQueryIndexInPool(slot_index)];
+  }
+
+  // Decrements `num_ready_slots`, if it is not zero already.
+  [[nodiscard]] static bool ReserveReadySlot(DeviceQueryPool* device_query_pool) {
+    uint32_t num_ready_slots = device_query_pool->num_ready_slots.load(std::memory_order_acquire);
+    while (num_ready_slots > 0) {
+      if (device_query_pool->num_ready_slots.compare_exchange_weak(
+              num_ready_slots, num_ready_slots - 1, std::memory_order_acq_rel,
+              std::memory_order_acquire)) {
+        return true;
+      }
+    }
+    return false;
+  }
+
+  // Creates and resets an additional `VkQueryPool` for the device and makes its slots available.
+  // Returns false if the device already has the maximum number of pools. As other threads might
+  // run out of slots at the same time, only the first one creates a pool, while the others return
+  // true without creating one if a ready slot became available in the meantime.
+  bool AddQueryPool(VkDevice device, DeviceQueryPool* device_query_pool) {
+    absl::MutexLock lock(&device_query_pool->add_query_pool_mutex);
+    if (device_query_pool->num_ready_slots.load(std::memory_order_acquire) > 0) {
+      return true;
+    }
+    uint32_t num_query_pools = device_query_pool->num_query_pools.load(std::memory_order_relaxed);
+    if (num_query_pools == max_num_query_pools_) {
+      return false;
+    }
+
+    VkQueryPool query_pool;
+    VkQueryPoolCreateInfo create_info = {.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO,
+                                         .pNext = nullptr,
+                                         .flags = 0,
+                                         .queryType = VK_QUERY_TYPE_TIMESTAMP,
+                                         .queryCount = num_slots_per_query_pool_,
+                                         .pipelineStatistics = 0};
+
+    VkResult result =
+        dispatch_table_->CreateQueryPool(device)(device, &create_info, nullptr, &query_pool);
+    if (num_query_pools == 0) {
+      CHECK(result == VK_SUCCESS);
+    } else if (result != VK_SUCCESS) {
+      ERROR("Unable to create an additional query pool with %u timestamp queries",
+            num_slots_per_query_pool_);
+      return false;
+    }
+
+    dispatch_table_->ResetQueryPoolEXT(device)(device, query_pool, 0, num_slots_per_query_pool_);
+
+    device_query_pool->owned_query_pools.push_back(
+        std::make_unique<QueryPool>(query_pool, num_slots_per_query_pool_));
+    device_query_pool->query_pools[num_query_pools].store(
+        device_query_pool->owned_query_pools.back().get(), std::memory_order_release);
+    // Publish the pool before its slots can be reserved.
+    device_query_pool->num_query_pools.store(num_query_pools + 1, std::memory_order_release);
+    device_query_pool->num_ready_slots.fetch_add(num_slots_per_query_pool_,
+                                                 std::memory_order_release);
+    if (num_query_pools > 0) {
+      LOG("Created query pool %u of %u with %u timestamp queries", num_query_pools + 1,
+          max_num_query_pools_, num_slots_per_query_pool_);
+    }
+    return true;
+  }
+
+  // Both `MarkQuerySlotsDoneReading` and `MarkQuerySlotsForReset` need to be called for a slot
+  // before it can be reused. Only the thread that does the second of the two transitions (and thus
+  // observes the state set by the other one) gets here, so the slot is released exactly once.
+  void ReleaseSlot(DeviceQueryPool* device_query_pool, uint32_t slot_index) {
+    GetSlotState(device_query_pool, slot_index)
+        ->store(SlotState::kReleased, std::memory_order_release);
+    std::atomic<uint32_t>* next_released_slot = GetNextReleasedSlot(device_query_pool, slot_index);
+    uint64_t head = device_query_pool->released_slots_head.load(std::memory_order_relaxed);
+    do {
+      next_released_slot->store(SlotOfHead(head), std::memory_order_relaxed);
+    } while (!device_query_pool->released_slots_head.compare_exchange_weak(
+        head, NextHead(head, slot_index), std::memory_order_release, std::memory_order_relaxed));
+  }
+
+  [[nodiscard]] DeviceQueryPool* GetDeviceQueryPool(VkDevice device) {
+    const DeviceSnapshot* snapshot = device_snapshot_.load(std::memory_order_acquire);
+    auto it = snapshot->find(device);
+    CHECK(it != snapshot->end());
+    return it->second;
+  }
+
+  // Publishes the current content of `device_to_query_pool_` for lock-free lookups. Threads might
+  // still read a previous snapshot, so those are kept alive for the lifetime of this object. As
+  // devices are rarely created or destroyed, this does not add up to a notable amount of memory.
+  void PublishDeviceSnapshot() {
+    auto snapshot = std::make_unique<DeviceSnapshot>();
+    for (const auto& [device, device_query_pool] : device_to_query_pool_) {
+      snapshot->emplace(device, device_query_pool.get());
+    }
+    device_snapshot_.store(snapshot.get(), std::memory_order_release);
+    published_snapshots_.push_back(std::move(snapshot));
+  }
+
   DispatchTable* dispatch_table_;
-  const uint32_t num_timer_query_slots_;
+  const uint32_t num_slots_per_query_pool_;
+  const uint32_t max_num_query_pools_;
 
+  // Guards the creation and destruction of device pools, not the access to slots.
   absl::Mutex mutex_;
+  absl::flat_hash_map<VkDevice, std::unique_ptr<DeviceQueryPool>> device_to_query_pool_;
+  std::vector<std::unique_ptr<DeviceSnapshot>> published_snapshots_;
 
-  absl::flat_hash_map<VkDevice, VkQueryPool> device_to_query_pool_;
-  absl::flat_hash_map<VkDevice, std::vector<SlotState>> device_to_query_slots_;
-  absl::flat_hash_map<VkDevice, std::vector<uint32_t>> device_to_free_slots_;
+  std::atomic<const DeviceSnapshot*> device_snapshot_ = nullptr;
 };
 }  // namespace orbit_vulkan_layer
 
@@ -6,6 +6,13 @@
 #include <gmock/gmock.h>
 #include <gtest/gtest.h>
 
+#include <array>
+#include <atomic>
+#include <thread>
+#include <tuple>
+#include <utility>
+#include <vector>
+
 #include "TimerQueryPool.h"
 
 using ::testing::Return;
@@ -41,7 +48,7 @@ TEST(TimerQueryPool, ATimerQueryPoolMustGetInitialized) {
 
   uint32_t slot_index = 32;
   std::vector<uint32_t> reset_slots;
-  EXPECT_DEATH({ (void)query_pool.GetQueryPool(device); }, "");
+  EXPECT_DEATH({ (void)query_pool.GetQueryPool(device, 0); }, "");
   EXPECT_DEATH({ (void)query_pool.NextReadyQuerySlot(device, &slot_index); }, "");
   reset_slots.push_back(slot_index);
   EXPECT_DEATH({ (void)query_pool.MarkQuerySlotsDoneReading(device, reset_slots); }, "");
@@ -133,7 +140,7 @@ TEST(TimerQueryPool, QueryPoolCanBeRetrievedAfterInitialization) {
 
   query_pool.InitializeTimerQueryPool(device);
 
-  VkQueryPool vulkan_query_pool = query_pool.GetQueryPool(device);
+  VkQueryPool vulkan_query_pool = query_pool.GetQueryPool(device, 0);
   EXPECT_EQ(vulkan_query_pool, expected_vulkan_query_pool);
 }
 
@@ -273,7 +280,12 @@ TEST(TimerQueryPool, MarkSlotsDoneReadingAndReadForResetMakesThemReady) {
   query_pool.MarkQuerySlotsDoneReading(device, reset_slots);
   query_pool.MarkQuerySlotsForReset(device, reset_slots);
 
+  // The slot is released, but its content still needs to be reset.
   bool found_slot = query_pool.NextReadyQuerySlot(device, &slot);
+  ASSERT_FALSE(found_slot);
+
+  query_pool.ResetReleasedQuerySlots(device);
+  found_slot = query_pool.NextReadyQuerySlot(device, &slot);
   ASSERT_TRUE(found_slot);
 }
 
@@ -330,6 +342,112 @@ TEST(TimerQueryPool, ResettingSlotsDoesResetOnVulkan) {
 
   query_pool.MarkQuerySlotsDoneReading(device, reset_slots);
   query_pool.MarkQuerySlotsForReset(device, reset_slots);
+  query_pool.ResetReleasedQuerySlots(device);
+}
+
+TEST(TimerQueryPool, ReleasedSlotsAreResetInContiguousRanges) {
+  MockDispatchTable dispatch_table;
+  static constexpr uint32_t kNumSlots = 8;
+  TimerQueryPool<MockDispatchTable> query_pool(&dispatch_table, kNumSlots);
+  VkDevice device = {};
+  EXPECT_CALL(dispatch_table, CreateQueryPool)
+      .WillRepeatedly(Return(dummy_create_query_pool_function));
+
+  static std::vector<std::pair<uint32_t, uint32_t>> actual_reset_ranges;
+  actual_reset_ranges.clear();
+  PFN_vkResetQueryPoolEXT mock_reset_query_pool_function =
+      +[](VkDevice /*device*/, VkQueryPool /*query_pool*/, uint32_t first_query,
+          uint32_t query_count) { actual_reset_ranges.emplace_back(first_query, query_count); };
+
+  EXPECT_CALL(dispatch_table, ResetQueryPoolEXT)
+      .WillOnce(Return(dummy_reset_query_pool_function))
+      .WillRepeatedly(Return(mock_reset_query_pool_function));
+
+  query_pool.InitializeTimerQueryPool(device);
+  std::vector<uint32_t> slots(kNumSlots);
+  for (uint32_t& slot : slots) {
+    ASSERT_TRUE(query_pool.NextReadyQuerySlot(device, &slot));
+  }
+
+  // Release all slots but one, in an order different from the one of the indices.
+  std::vector<uint32_t> released_slots = {slots[6], slots[0], slots[2], slots[1],
+                                          slots[4], slots[5], slots[7]};
+  query_pool.MarkQuerySlotsForReset(device, released_slots);
+  EXPECT_TRUE(actual_reset_ranges.empty());
+  query_pool.MarkQuerySlotsDoneReading(device, released_slots);
+  EXPECT_TRUE(actual_reset_ranges.empty());
+
+  query_pool.ResetReleasedQuerySlots(device);
+  std::vector<std::pair<uint32_t, uint32_t>> expected_reset_ranges = {{0, 3}, {4, 4}};
+  EXPECT_EQ(actual_reset_ranges, expected_reset_ranges);
+
+  // Nothing was released since the last call.
+  query_pool.ResetReleasedQuerySlots(device);
+  EXPECT_EQ(actual_reset_ranges, expected_reset_ranges);
+}
+
+TEST(TimerQueryPool, GrowsByAdditionalQueryPoolsUpToTheMaximum) {
+  MockDispatchTable dispatch_table;
+  static constexpr uint32_t kNumSlotsPerQueryPool = 2;
+  static constexpr uint32_t kMaxNumQueryPools = 2;
+  TimerQueryPool<MockDispatchTable> query_pool(&dispatch_table, kNumSlotsPerQueryPool,
+                                               kMaxNumQueryPools);
+  VkDevice device = {};
+
+  static uint64_t num_created_query_pools;
+  num_created_query_pools = 0;
+  PFN_vkCreateQueryPool mock_create_query_pool_function =
+      +[](VkDevice /*device*/, const VkQueryPoolCreateInfo* /*create_info*/,
+          const VkAllocationCallbacks* /*allocator*/, VkQueryPool* query_pool_out) -> VkResult {
+    *query_pool_out = reinterpret_cast<VkQueryPool>(++num_created_query_pools);
+    return VK_SUCCESS;
+  };
+  static std::vector<std::tuple<VkQueryPool, uint32_t, uint32_t>> actual_reset_ranges;
+  actual_reset_ranges.clear();
+  PFN_vkResetQueryPoolEXT mock_reset_query_pool_function =
+      +[](VkDevice /*device*/, VkQueryPool query_pool, uint32_t first_query,
+          uint32_t query_count) {
+        actual_reset_ranges.emplace_back(query_pool, first_query, query_count);
+      };
+  EXPECT_CALL(dispatch_table, CreateQueryPool)
+      .Times(kMaxNumQueryPools)
+      .WillRepeatedly(Return(mock_create_query_pool_function));
+  EXPECT_CALL(dispatch_table, ResetQueryPoolEXT)
+      .WillRepeatedly(Return(mock_reset_query_pool_function));
+
+  query_pool.InitializeTimerQueryPool(device);
+  EXPECT_EQ(num_created_query_pools, 1);
+
+  std::vector<uint32_t> slots(kNumSlotsPerQueryPool * kMaxNumQueryPools);
+  for (uint32_t& slot : slots) {
+    ASSERT_TRUE(query_pool.NextReadyQuerySlot(device, &slot));
+  }
+  EXPECT_EQ(num_created_query_pools, kMaxNumQueryPools);
+  EXPECT_THAT(slots, ::testing::UnorderedElementsAre(0, 1, 2, 3));
+  uint32_t slot_index;
+  EXPECT_FALSE(query_pool.NextReadyQuerySlot(device, &slot_index));
+
+  VkQueryPool first_vulkan_query_pool = reinterpret_cast<VkQueryPool>(1);
+  VkQueryPool second_vulkan_query_pool = reinterpret_cast<VkQueryPool>(2);
+  EXPECT_EQ(query_pool.GetQueryPool(device, 1), first_vulkan_query_pool);
+  EXPECT_EQ(query_pool.GetQueryPool(device, 2), second_vulkan_query_pool);
+  EXPECT_EQ(query_pool.GetQueryIndexInPool(1), 1);
+  EXPECT_EQ(query_pool.GetQueryIndexInPool(2), 0);
+
+  // Resetting the released slots must not cross the boundary between the two query pools.
+  actual_reset_ranges.clear();
+  query_pool.MarkQuerySlotsDoneReading(device, slots);
+  query_pool.MarkQuerySlotsForReset(device, slots);
+  query_pool.ResetReleasedQuerySlots(device);
+  std::vector<std::tuple<VkQueryPool, uint32_t, uint32_t>> expected_reset_ranges = {
+      {first_vulkan_query_pool, 0, 2}, {second_vulkan_query_pool, 0, 2}};
+  EXPECT_EQ(actual_reset_ranges, expected_reset_ranges);
+
+  // All slots of both pools are available again, without creating another pool.
+  for (uint32_t& slot : slots) {
+    ASSERT_TRUE(query_pool.NextReadyQuerySlot(device, &slot));
+  }
+  EXPECT_EQ(num_created_query_pools, kMaxNumQueryPools);
 }
 
 TEST(TimerQueryPool, CannotRollbackReadySlots) {
@@ -413,10 +531,72 @@ TEST(TimerQueryPool, CanRepeatadlyRetrieveAndResetSlots) {
     if (i % 2 == 0) {
       query_pool.MarkQuerySlotsDoneReading(device, reset_slots);
       query_pool.MarkQuerySlotsForReset(device, reset_slots);
+      query_pool.ResetReleasedQuerySlots(device);
     } else {
       query_pool.RollbackPendingQuerySlots(device, reset_slots);
     }
   }
 }
 
+TEST(TimerQueryPool, SlotsAreNotHandedOutTwiceWhenUsedFromMultipleThreads) {
+  MockDispatchTable dispatch_table;
+  static constexpr uint32_t kNumSlots = 32;
+  static constexpr size_t kNumThreads = 8;
+  TimerQueryPool<MockDispatchTable> query_pool(&dispatch_table, kNumSlots);
+  VkDevice device = {};
+  EXPECT_CALL(dispatch_table, CreateQueryPool)
+      .WillRepeatedly(Return(dummy_create_query_pool_function));
+  EXPECT_CALL(dispatch_table, ResetQueryPoolEXT)
+      .WillRepeatedly(Return(dummy_reset_query_pool_function));
+
+  query_pool.InitializeTimerQueryPool(device);
+
+  std::array<std::atomic<bool>, kNumSlots> slot_in_use{};
+  std::atomic<bool> slot_handed_out_twice = false;
+  std::vector<std::thread> threads;
+  for (size_t thread_index = 0; thread_index < kNumThreads; ++thread_index) {
+    threads.emplace_back([&, thread_index] {
+      for (int i = 0; i < 5000; ++i) {
+        // Every thread holds at most two slots at a time, but released slots of other threads
+        // might not have been reset yet.
+        std::vector<uint32_t> slots(2);
+        for (uint32_t& slot : slots) {
+          while (!query_pool.NextReadyQuerySlot(device, &slot)) {
+            query_pool.ResetReleasedQuerySlots(device);
+          }
+        }
+        for (uint32_t slot : slots) {
+          if (slot_in_use[slot].exchange(true)) {
+            slot_handed_out_twice = true;
+          }
+        }
+        for (uint32_t slot : slots) {
+          slot_in_use[slot] = false;
+        }
+
+        if ((i + thread_index) % 2 == 0) {
+          query_pool.MarkQuerySlotsDoneReading(device, slots);
+          query_pool.MarkQuerySlotsForReset(device, slots);
+          query_pool.ResetReleasedQuerySlots(device);
+        } else {
+          query_pool.RollbackPendingQuerySlots(device, slots);
+        }
+      }
+    });
+  }
+  for (std::thread& thread : threads) {
+    thread.join();
+  }
+  EXPECT_FALSE(slot_handed_out_twice);
+  query_pool.ResetReleasedQuerySlots(device);
+
+  // All slots must be available again.
+  for (uint32_t i = 0; i < kNumSlots; ++i) {
+    uint32_t slot_index;
+    EXPECT_TRUE(query_pool.NextReadyQuerySlot(device, &slot_index));
+  }
+  uint32_t slot_index;
+  EXPECT_FALSE(query_pool.NextReadyQuerySlot(device, &slot_index));
+}
+
 }  // namespace orbit_vulkan_layer
@@ -49,7 +49,8 @@ class VulkanLayerController {
 
   VulkanLayerController()
       : device_manager_(&dispatch_table_),
-        timer_query_pool_(&dispatch_table_, kNumTimerQuerySlots),
+        timer_query_pool_(&dispatch_table_, kNumTimerQuerySlotsPerQueryPool,
+                          kMaxNumTimerQueryPools),
         submission_tracker_(&dispatch_table_, &timer_query_pool_, &device_manager_,
                             std::numeric_limits<uint32_t>::max()) {}
 
@@ -721,8 +722,11 @@ class VulkanLayerController {
   QueueManager queue_manager_;
   VulkanWrapper vulkan_wrapper_;
 
-  // The number of timer query slots is chosen arbitrary such that it is large enough.
-  static constexpr uint32_t kNumTimerQuerySlots = 131072;
+  // The number of timer query slots is chosen arbitrary such that it is large enough for most
+  // applications. Only if all slots of a query pool are occupied, an additional query pool is
+  // created, up to the maximum number of pools.
+  static constexpr uint32_t kNumTimerQuerySlotsPerQueryPool = 65536;
+  static constexpr uint32_t kMaxNumTimerQueryPools = 16;
 };
 
 }  // namespace orbit_vulkan_layer
@@ -91,7 +91,9 @@ class MockQueueManager {
 
 class MockTimerQueryPool {
  public:
-  explicit MockTimerQueryPool(MockDispatchTable* /*dispatch_table*/, uint32_t /*num_slots*/) {}
+  explicit MockTimerQueryPool(MockDispatchTable* /*dispatch_table*/,
+                              uint32_t /*num_slots_per_query_pool*/,
+                              uint32_t /*max_num_query_pools*/) {}
   MOCK_METHOD(void, InitializeTimerQueryPool, (VkDevice));
   MOCK_METHOD(void, DestroyTimerQueryPool, (VkDevice));
 };
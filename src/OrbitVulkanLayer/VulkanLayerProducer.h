@@ -7,6 +7,9 @@
 
 #include <grpcpp/grpcpp.h>
 
+#include <string_view>
+
+#include "GpuQueueSubmissionEvent.h"
 #include "capture.pb.h"
 
 namespace orbit_vulkan_layer {
@@ -35,9 +38,15 @@ class VulkanLayerProducer {
   // is in progress.
   virtual bool EnqueueCaptureEvent(orbit_grpc_protos::ProducerCaptureEvent&& capture_event) = 0;
 
+  // Use this method to enqueue a GpuQueueSubmission to be sent to OrbitService. The event is
+  // copied, so the caller can reuse `event` (and the capacity of its vectors) for the next one.
+  // Returns true if the event was enqueued as the capture is in progress, false otherwise.
+  virtual bool EnqueueGpuQueueSubmission(const GpuQueueSubmissionEvent& event) = 0;
+
   // This method enqueues an InternedString to be sent to OrbitService the first time the string
   // passed as argument is seen. In all cases, it returns the key corresponding to the string.
-  [[nodiscard]] virtual uint64_t InternStringIfNecessaryAndGetKey(std::string str) = 0;
+  // The string is only copied the first time it is seen.
+  [[nodiscard]] virtual uint64_t InternStringIfNecessaryAndGetKey(std::string_view str) = 0;
 
   class CaptureStatusListener {
    public:
@@ -4,9 +4,92 @@
 
 #include "VulkanLayerProducerImpl.h"
 
+#include <string.h>
+
+#include <utility>
+
+#include "ProducerSideChannel/SharedMemoryRecords.h"
+
 namespace orbit_vulkan_layer {
 
-uint64_t VulkanLayerProducerImpl::InternStringIfNecessaryAndGetKey(std::string str) {
+using orbit_producer_side_channel::InternedStringRecord;
+using orbit_producer_side_channel::SharedMemoryRecordType;
+using orbit_producer_side_channel::SharedMemoryRingBuffer;
+
+orbit_grpc_protos::ProducerCaptureEvent*
+VulkanLayerProducerImpl::LockFreeBufferVulkanLayerProducer::TranslateIntermediateEvent(
+    IntermediateEvent&& intermediate_event, google::protobuf::Arena* arena) {
+  auto* capture_event =
+      google::protobuf::Arena::CreateMessage<orbit_grpc_protos::ProducerCaptureEvent>(arena);
+  if (auto* submission = std::get_if<GpuQueueSubmissionEvent>(&intermediate_event)) {
+    FillGpuQueueSubmissionProto(*submission, capture_event->mutable_gpu_queue_submission());
+    outer_->RecycleGpuQueueSubmissionEvent(std::move(*submission));
+    return capture_event;
+  }
+
+  // Note that, as capture_event is in the Arena and intermediate_event is on the heap, this
+  // std::move will actually end up being a copy, as it will use CopyFrom internally.
+  // This is fine performance-wise, as only rare events (e.g. InternedStrings) are enqueued as
+  // ProducerCaptureEvents.
+  *capture_event = std::move(std::get<orbit_grpc_protos::ProducerCaptureEvent>(intermediate_event));
+  return capture_event;
+}
+
+void VulkanLayerProducerImpl::LockFreeBufferVulkanLayerProducer::
+    WriteIntermediateEventToSharedMemoryBuffer(IntermediateEvent&& intermediate_event,
+                                               SharedMemoryRingBuffer* shared_memory_buffer,
+                                               google::protobuf::Arena* arena) {
+  if (auto* submission = std::get_if<GpuQueueSubmissionEvent>(&intermediate_event)) {
+    // Dropped records are counted by the buffer itself.
+    (void)WriteGpuQueueSubmissionRecord(*submission, shared_memory_buffer);
+    outer_->RecycleGpuQueueSubmissionEvent(std::move(*submission));
+    return;
+  }
+
+  auto& capture_event = std::get<orbit_grpc_protos::ProducerCaptureEvent>(intermediate_event);
+  if (capture_event.event_case() != orbit_grpc_protos::ProducerCaptureEvent::kInternedString) {
+    LockFreeBufferCaptureEventProducer::WriteIntermediateEventToSharedMemoryBuffer(
+        std::move(intermediate_event), shared_memory_buffer, arena);
+    return;
+  }
+
+  const orbit_grpc_protos::InternedString& interned_string = capture_event.interned_string();
+  const uint64_t payload_size = sizeof(InternedStringRecord) + interned_string.intern().size();
+  if (payload_size > shared_memory_buffer->GetMaxPayloadSize()) {
+    ERROR("Record of %u bytes is too large for the shared memory buffer", payload_size);
+    return;
+  }
+  uint8_t* payload = shared_memory_buffer->AllocateRecord(
+      static_cast<uint32_t>(SharedMemoryRecordType::kInternedString), payload_size);
+  if (payload == nullptr) {
+    return;
+  }
+  InternedStringRecord record{interned_string.key()};
+  memcpy(payload, &record, sizeof(record));
+  memcpy(payload + sizeof(record), interned_string.intern().data(),
+         interned_string.intern().size());
+  shared_memory_buffer->CommitRecord();
+}
+
+bool VulkanLayerProducerImpl::EnqueueGpuQueueSubmission(const GpuQueueSubmissionEvent& event) {
+  return lock_free_producer_.EnqueueIntermediateEventIfCapturing([this, &event] {
+    GpuQueueSubmissionEvent copy;
+    // If a consumed event is available, copy-assigning to it reuses the capacity of its vectors.
+    recycled_gpu_queue_submission_events_.try_dequeue(copy);
+    copy = event;
+    return IntermediateEvent{std::move(copy)};
+  });
+}
+
+void VulkanLayerProducerImpl::RecycleGpuQueueSubmissionEvent(GpuQueueSubmissionEvent&& event) {
+  if (recycled_gpu_queue_submission_events_.size_approx() >= kMaxRecycledGpuQueueSubmissionEvents) {
+    return;
+  }
+  event.Clear();
+  recycled_gpu_queue_submission_events_.enqueue(std::move(event));
+}
+
+uint64_t VulkanLayerProducerImpl::InternStringIfNecessaryAndGetKey(std::string_view str) {
   uint64_t key = ComputeStringKey(str);
   {
     absl::MutexLock lock{&string_keys_sent_mutex_};
@@ -17,7 +100,7 @@ uint64_t VulkanLayerProducerImpl::InternStringIfNecessaryAndGetKey(std::string s
 
     orbit_grpc_protos::ProducerCaptureEvent event;
     event.mutable_interned_string()->set_key(key);
-    event.mutable_interned_string()->set_intern(std::move(str));
+    event.mutable_interned_string()->set_intern(std::string{str});
     if (!EnqueueCaptureEvent(std::move(event))) {
       // If the interned string wasn't actually sent because we are no longer capturing,
       // remove it from string_keys_sent_.
@@ -8,14 +8,22 @@
 #include <absl/container/flat_hash_set.h>
 #include <google/protobuf/arena.h>
 
+#include <string_view>
+#include <variant>
+
+#include "GpuQueueSubmissionEvent.h"
 #include "OrbitProducer/LockFreeBufferCaptureEventProducer.h"
 #include "VulkanLayerProducer.h"
+#include "concurrentqueue.h"
 
 namespace orbit_vulkan_layer {
 
 // This class provides the implementation of VulkanLayerProducer,
 // delegating most methods to LockFreeBufferCaptureEventProducer
 // while also handling interning of strings.
+// GpuQueueSubmissions are enqueued as flat GpuQueueSubmissionEvents, which are only translated to
+// protobufs on the forwarder thread. Consumed GpuQueueSubmissionEvents are recycled, so that
+// enqueuing a GpuQueueSubmission doesn't allocate once enough capacity has been built up.
 class VulkanLayerProducerImpl : public VulkanLayerProducer {
  public:
   void BringUp(const std::shared_ptr<grpc::Channel>& channel) override {
@@ -28,17 +36,21 @@ class VulkanLayerProducerImpl : public VulkanLayerProducer {
 
   bool EnqueueCaptureEvent(orbit_grpc_protos::ProducerCaptureEvent&& capture_event) override {
     return lock_free_producer_.EnqueueIntermediateEventIfCapturing(
-        [&capture_event] { return capture_event; });
+        [&capture_event] { return IntermediateEvent{std::move(capture_event)}; });
   }
 
-  [[nodiscard]] uint64_t InternStringIfNecessaryAndGetKey(std::string str) override;
+  bool EnqueueGpuQueueSubmission(const GpuQueueSubmissionEvent& event) override;
+
+  [[nodiscard]] uint64_t InternStringIfNecessaryAndGetKey(std::string_view str) override;
 
   void SetCaptureStatusListener(CaptureStatusListener* listener) override { listener_ = listener; }
 
  private:
+  using IntermediateEvent =
+      std::variant<orbit_grpc_protos::ProducerCaptureEvent, GpuQueueSubmissionEvent>;
+
   class LockFreeBufferVulkanLayerProducer
-      : public orbit_producer::LockFreeBufferCaptureEventProducer<
-            orbit_grpc_protos::ProducerCaptureEvent> {
+      : public orbit_producer::LockFreeBufferCaptureEventProducer<IntermediateEvent> {
    public:
     explicit LockFreeBufferVulkanLayerProducer(VulkanLayerProducerImpl* outer) : outer_{outer} {}
 
@@ -67,26 +79,26 @@ class VulkanLayerProducerImpl : public VulkanLayerProducer {
     }
 
     orbit_grpc_protos::ProducerCaptureEvent* TranslateIntermediateEvent(
-        orbit_grpc_protos::ProducerCaptureEvent&& intermediate_event,
-        google::protobuf::Arena* arena) override {
-      auto* capture_event =
-          google::protobuf::Arena::CreateMessage<orbit_grpc_protos::ProducerCaptureEvent>(arena);
-      // Note that, as capture_event is in the Arena and intermediate_event is on the heap, this
-      // std::move will actually end up being a copy, as it will use CopyFrom internally.
-      // For the amount of events that this Vulkan layer produces, this is fine performance-wise.
-      // This is also in line with the principle of this method, which in general expects a
-      // transformation from any type that intermediate_event could be to the ProducerCaptureEvent
-      // protobuf.
-      *capture_event = std::move(intermediate_event);
-      return capture_event;
-    }
+        IntermediateEvent&& intermediate_event, google::protobuf::Arena* arena) override;
+
+    // InternedStrings and GpuQueueSubmissions are written as fixed-layout records, so that these
+    // don't need to be serialized when using the shared memory buffer.
+    void WriteIntermediateEventToSharedMemoryBuffer(
+        IntermediateEvent&& intermediate_event,
+        orbit_producer_side_channel::SharedMemoryRingBuffer* shared_memory_buffer,
+        google::protobuf::Arena* arena) override;
 
    private:
     VulkanLayerProducerImpl* outer_;
   };
 
  private:
-  static uint64_t ComputeStringKey(const std::string& str) { return std::hash<std::string>{}(str); }
+  // std::hash<std::string_view> yields the same value as std::hash<std::string>.
+  static uint64_t ComputeStringKey(std::string_view str) {
+    return std::hash<std::string_view>{}(str);
+  }
+
+  void RecycleGpuQueueSubmissionEvent(GpuQueueSubmissionEvent&& event);
 
   void ClearStringInternPool() {
     absl::MutexLock lock{&string_keys_sent_mutex_};
@@ -99,6 +111,10 @@ class VulkanLayerProducerImpl : public VulkanLayerProducer {
   absl::flat_hash_set<uint64_t> string_keys_sent_;
   absl::Mutex string_keys_sent_mutex_;
 
+  // Consumed GpuQueueSubmissionEvents, whose vectors are reused by EnqueueGpuQueueSubmission.
+  moodycamel::ConcurrentQueue<GpuQueueSubmissionEvent> recycled_gpu_queue_submission_events_;
+  static constexpr size_t kMaxRecycledGpuQueueSubmissionEvents = 256;
+
   CaptureStatusListener* listener_ = nullptr;
 };
 
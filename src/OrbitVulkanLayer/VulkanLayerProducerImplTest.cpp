@@ -230,6 +230,65 @@ TEST_F(VulkanLayerProducerImplTest, EnqueueCaptureEvent) {
   EXPECT_FALSE(producer_->EnqueueCaptureEvent(orbit_grpc_protos::ProducerCaptureEvent()));
 }
 
+TEST_F(VulkanLayerProducerImplTest, EnqueueGpuQueueSubmission) {
+  GpuQueueSubmissionEvent event;
+  event.meta_info.pid = 42;
+  event.command_buffer_counts = {1};
+  event.command_buffers = {{1, 2}};
+
+  EXPECT_CALL(*fake_service_, OnCaptureEventsReceived).Times(0);
+  EXPECT_FALSE(producer_->EnqueueGpuQueueSubmission(event));
+  std::this_thread::sleep_for(kWaitMessagesSentDuration);
+
+  ::testing::Mock::VerifyAndClearExpectations(&*fake_service_);
+
+  EXPECT_CALL(mock_listener_, OnCaptureStart(CaptureOptionsEq(kFakeCaptureOptions))).Times(1);
+  fake_service_->SendStartCaptureCommand(kFakeCaptureOptions);
+  std::this_thread::sleep_for(kWaitMessagesSentDuration);
+
+  ::testing::Mock::VerifyAndClearExpectations(&mock_listener_);
+
+  std::vector<orbit_grpc_protos::ProducerCaptureEvent> events_received;
+  EXPECT_CALL(*fake_service_, OnCaptureEventsReceived)
+      .Times(::testing::Between(1, 2))
+      .WillRepeatedly(
+          [&events_received](const std::vector<orbit_grpc_protos::ProducerCaptureEvent>& events) {
+            events_received.insert(events_received.end(), events.begin(), events.end());
+          });
+  EXPECT_TRUE(producer_->EnqueueGpuQueueSubmission(event));
+  // The event was copied, so it can be reused right away.
+  event.command_buffers[0].end_gpu_timestamp_ns = 3;
+  EXPECT_TRUE(producer_->EnqueueGpuQueueSubmission(event));
+  std::this_thread::sleep_for(kWaitMessagesSentDuration);
+
+  ASSERT_EQ(events_received.size(), 2);
+  for (size_t i = 0; i < events_received.size(); ++i) {
+    ASSERT_EQ(events_received[i].event_case(),
+              orbit_grpc_protos::ProducerCaptureEvent::kGpuQueueSubmission);
+    const orbit_grpc_protos::GpuQueueSubmission& submission =
+        events_received[i].gpu_queue_submission();
+    EXPECT_EQ(submission.meta_info().pid(), 42);
+    ASSERT_EQ(submission.submit_infos_size(), 1);
+    ASSERT_EQ(submission.submit_infos(0).command_buffers_size(), 1);
+    EXPECT_EQ(submission.submit_infos(0).command_buffers(0).begin_gpu_timestamp_ns(), 1);
+    EXPECT_EQ(submission.submit_infos(0).command_buffers(0).end_gpu_timestamp_ns(), 2 + i);
+  }
+
+  ::testing::Mock::VerifyAndClearExpectations(&*fake_service_);
+
+  EXPECT_CALL(mock_listener_, OnCaptureStop).Times(1);
+  EXPECT_CALL(*fake_service_, OnCaptureEventsReceived).Times(0);
+  EXPECT_CALL(*fake_service_, OnAllEventsSentReceived).Times(1);
+  fake_service_->SendStopCaptureCommand();
+  std::this_thread::sleep_for(kWaitMessagesSentDuration);
+
+  ::testing::Mock::VerifyAndClearExpectations(&mock_listener_);
+  ::testing::Mock::VerifyAndClearExpectations(&*fake_service_);
+
+  EXPECT_CALL(mock_listener_, OnCaptureFinished).Times(1);
+  fake_service_->SendCaptureFinishedCommand();
+}
+
 static void ExpectInternedStrings(
     const std::vector<orbit_grpc_protos::ProducerCaptureEvent>& actual_events,
     const std::vector<std::pair<std::string, uint64_t>>& expected_interns) {
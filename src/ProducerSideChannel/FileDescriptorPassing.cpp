@@ -0,0 +1,99 @@
+// Copyright (c) 2021 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "ProducerSideChannel/FileDescriptorPassing.h"
+
+#include <absl/strings/str_format.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#include <string_view>
+#include <utility>
+
+#include "OrbitBase/SafeStrerror.h"
+
+namespace orbit_producer_side_channel {
+
+ErrorMessageOr<void> SendFileDescriptor(int socket_fd, uint64_t token, int fd) {
+  iovec iov{&token, sizeof(token)};
+
+  alignas(cmsghdr) char control[CMSG_SPACE(sizeof(int))] = {};
+  msghdr message{};
+  message.msg_iov = &iov;
+  message.msg_iovlen = 1;
+  message.msg_control = control;
+  message.msg_controllen = sizeof(control);
+
+  cmsghdr* control_message = CMSG_FIRSTHDR(&message);
+  control_message->cmsg_level = SOL_SOCKET;
+  control_message->cmsg_type = SCM_RIGHTS;
+  control_message->cmsg_len = CMSG_LEN(sizeof(int));
+  memcpy(CMSG_DATA(control_message), &fd, sizeof(int));
+
+  ssize_t sent_size = sendmsg(socket_fd, &message, MSG_NOSIGNAL);
+  if (sent_size != static_cast<ssize_t>(sizeof(token))) {
+    return ErrorMessage{absl::StrFormat("sendmsg: %s", SafeStrerror(errno))};
+  }
+  return outcome::success();
+}
+
+ErrorMessageOr<void> ConnectAndSendFileDescriptor(std::string_view socket_path, uint64_t token,
+                                                  int fd) {
+  sockaddr_un address{};
+  address.sun_family = AF_UNIX;
+  if (socket_path.size() >= sizeof(address.sun_path)) {
+    return ErrorMessage{absl::StrFormat("Socket path \"%s\" is too long", socket_path)};
+  }
+  memcpy(address.sun_path, socket_path.data(), socket_path.size());
+
+  orbit_base::unique_fd socket_fd{socket(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0)};
+  if (!socket_fd.valid()) {
+    return ErrorMessage{absl::StrFormat("socket: %s", SafeStrerror(errno))};
+  }
+  if (connect(socket_fd.get(), reinterpret_cast<const sockaddr*>(&address), sizeof(address)) != 0) {
+    return ErrorMessage{
+        absl::StrFormat("Unable to connect to \"%s\": %s", socket_path, SafeStrerror(errno))};
+  }
+  return SendFileDescriptor(socket_fd.get(), token, fd);
+}
+
+ErrorMessageOr<TokenAndFileDescriptor> ReceiveFileDescriptor(int socket_fd) {
+  uint64_t token = 0;
+  iovec iov{&token, sizeof(token)};
+
+  alignas(cmsghdr) char control[CMSG_SPACE(sizeof(int))] = {};
+  msghdr message{};
+  message.msg_iov = &iov;
+  message.msg_iovlen = 1;
+  message.msg_control = control;
+  message.msg_controllen = sizeof(control);
+
+  ssize_t received_size = recvmsg(socket_fd, &message, MSG_CMSG_CLOEXEC);
+  if (received_size < 0) {
+    return ErrorMessage{absl::StrFormat("recvmsg: %s", SafeStrerror(errno))};
+  }
+
+  // Take ownership of the received file descriptor first, so that it is closed on every error.
+  orbit_base::unique_fd fd;
+  cmsghdr* control_message = CMSG_FIRSTHDR(&message);
+  if (control_message != nullptr && control_message->cmsg_level == SOL_SOCKET &&
+      control_message->cmsg_type == SCM_RIGHTS &&
+      control_message->cmsg_len == CMSG_LEN(sizeof(int))) {
+    int received_fd;
+    memcpy(&received_fd, CMSG_DATA(control_message), sizeof(int));
+    fd = orbit_base::unique_fd{received_fd};
+  }
+
+  if ((message.msg_flags & (MSG_TRUNC | MSG_CTRUNC)) != 0 ||
+      received_size != static_cast<ssize_t>(sizeof(token))) {
+    return ErrorMessage{"Received malformed message"};
+  }
+  if (!fd.valid()) {
+    return ErrorMessage{"Received message without a file descriptor"};
+  }
+  return TokenAndFileDescriptor{token, std::move(fd)};
+}
+
+}  // namespace orbit_producer_side_channel
@@ -0,0 +1,61 @@
+// Copyright (c) 2021 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <gtest/gtest.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "OrbitBase/File.h"
+#include "ProducerSideChannel/FileDescriptorPassing.h"
+
+namespace orbit_producer_side_channel {
+
+TEST(FileDescriptorPassing, ReceivesTheSentFileDescriptorAndToken) {
+  int sockets[2];
+  ASSERT_EQ(socketpair(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0, sockets), 0);
+  orbit_base::unique_fd sender{sockets[0]};
+  orbit_base::unique_fd receiver{sockets[1]};
+
+  int pipe_fds[2];
+  ASSERT_EQ(pipe(pipe_fds), 0);
+  orbit_base::unique_fd pipe_read_end{pipe_fds[0]};
+  orbit_base::unique_fd pipe_write_end{pipe_fds[1]};
+
+  constexpr uint64_t kToken = 0x0123456789abcdef;
+  ASSERT_FALSE(SendFileDescriptor(sender.get(), kToken, pipe_read_end.get()).has_error());
+  ErrorMessageOr<TokenAndFileDescriptor> received_or_error = ReceiveFileDescriptor(receiver.get());
+  ASSERT_FALSE(received_or_error.has_error()) << received_or_error.error().message();
+  EXPECT_EQ(received_or_error.value().token, kToken);
+
+  // The received file descriptor is a new one that refers to the same pipe.
+  const int received_fd = received_or_error.value().fd.get();
+  EXPECT_NE(received_fd, pipe_read_end.get());
+  struct stat sent_stat {};
+  struct stat received_stat {};
+  ASSERT_EQ(fstat(pipe_read_end.get(), &sent_stat), 0);
+  ASSERT_EQ(fstat(received_fd, &received_stat), 0);
+  EXPECT_EQ(received_stat.st_dev, sent_stat.st_dev);
+  EXPECT_EQ(received_stat.st_ino, sent_stat.st_ino);
+}
+
+TEST(FileDescriptorPassing, ReceiveFailsWithoutFileDescriptor) {
+  int sockets[2];
+  ASSERT_EQ(socketpair(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0, sockets), 0);
+  orbit_base::unique_fd sender{sockets[0]};
+  orbit_base::unique_fd receiver{sockets[1]};
+
+  constexpr uint64_t kToken = 42;
+  ASSERT_EQ(send(sender.get(), &kToken, sizeof(kToken), 0), static_cast<ssize_t>(sizeof(kToken)));
+  EXPECT_TRUE(ReceiveFileDescriptor(receiver.get()).has_error());
+}
+
+TEST(FileDescriptorPassing, ConnectFailsWithoutListeningSocket) {
+  EXPECT_TRUE(
+      ConnectAndSendFileDescriptor("/tmp/orbit-file-descriptor-passing-test-nonexistent", 42,
+                                   STDIN_FILENO)
+          .has_error());
+}
+
+}  // namespace orbit_producer_side_channel
@@ -0,0 +1,241 @@
+// Copyright (c) 2021 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "ProducerSideChannel/SharedMemoryRingBuffer.h"
+
+#include <absl/strings/str_format.h>
+#include <fcntl.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <utility>
+
+#include "OrbitBase/Logging.h"
+#include "OrbitBase/SafeStrerror.h"
+
+namespace orbit_producer_side_channel {
+
+namespace {
+
+constexpr uint64_t kSharedMemoryRingBufferMagic = 0x4f52424954534842;  // "ORBITSHB"
+
+// The seals that the memfd of a buffer needs to have: its size can't change anymore.
+constexpr int kRequiredSeals = F_SEAL_SHRINK | F_SEAL_GROW | F_SEAL_SEAL;
+
+// The header takes the whole first page, so that the data is page-aligned.
+constexpr uint64_t kHeaderRegionSize = 4096;
+static_assert(sizeof(SharedMemoryRingBufferHeader) <= kHeaderRegionSize);
+
+[[nodiscard]] constexpr uint64_t AlignUp(uint64_t value) {
+  return (value + kSharedMemoryRecordAlignment - 1) & ~(kSharedMemoryRecordAlignment - 1);
+}
+
+[[nodiscard]] constexpr uint64_t GetRecordSize(uint32_t payload_size) {
+  return AlignUp(sizeof(SharedMemoryRecordHeader) + payload_size);
+}
+
+[[nodiscard]] bool IsValidDataSize(uint64_t data_size) {
+  return data_size >= kHeaderRegionSize && data_size % kHeaderRegionSize == 0 &&
+         __builtin_popcountl(data_size) == 1;
+}
+
+[[nodiscard]] ErrorMessageOr<void*> MapSharedMemory(const orbit_base::unique_fd& fd,
+                                                    uint64_t mapping_size) {
+  void* mapping = mmap(nullptr, mapping_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd.get(), 0);
+  if (mapping == MAP_FAILED) {
+    return ErrorMessage{absl::StrFormat("mmap: %s", SafeStrerror(errno))};
+  }
+  return mapping;
+}
+
+}  // namespace
+
+SharedMemoryRingBuffer::SharedMemoryRingBuffer(orbit_base::unique_fd fd, void* mapping,
+                                               uint64_t data_size)
+    : fd_{std::move(fd)},
+      mapping_{mapping},
+      data_size_{data_size},
+      header_{static_cast<SharedMemoryRingBufferHeader*>(mapping)},
+      data_{static_cast<uint8_t*>(mapping) + kHeaderRegionSize} {}
+
+SharedMemoryRingBuffer::~SharedMemoryRingBuffer() {
+  if (munmap(mapping_, kHeaderRegionSize + data_size_) != 0) {
+    ERROR("munmap: %s", SafeStrerror(errno));
+  }
+}
+
+ErrorMessageOr<std::unique_ptr<SharedMemoryRingBuffer>> SharedMemoryRingBuffer::Create(
+    uint64_t data_size) {
+  CHECK(IsValidDataSize(data_size));
+
+  orbit_base::unique_fd fd{
+      memfd_create("orbit-producer-side-buffer", MFD_CLOEXEC | MFD_ALLOW_SEALING)};
+  if (!fd.valid()) {
+    return ErrorMessage{absl::StrFormat("memfd_create: %s", SafeStrerror(errno))};
+  }
+
+  const uint64_t mapping_size = kHeaderRegionSize + data_size;
+  if (ftruncate(fd.get(), mapping_size) != 0) {
+    return ErrorMessage{absl::StrFormat("ftruncate: %s", SafeStrerror(errno))};
+  }
+  if (fcntl(fd.get(), F_ADD_SEALS, kRequiredSeals) != 0) {
+    return ErrorMessage{absl::StrFormat("Adding seals: %s", SafeStrerror(errno))};
+  }
+
+  OUTCOME_TRY(mapping, MapSharedMemory(fd, mapping_size));
+
+  // The memory of a new memfd is zero-initialized, so only the non-zero fields need to be set.
+  auto* header = static_cast<SharedMemoryRingBufferHeader*>(mapping);
+  header->data_size = data_size;
+  header->magic = kSharedMemoryRingBufferMagic;
+
+  return std::unique_ptr<SharedMemoryRingBuffer>(
+      new SharedMemoryRingBuffer{std::move(fd), mapping, data_size});
+}
+
+ErrorMessageOr<std::unique_ptr<SharedMemoryRingBuffer>>
+SharedMemoryRingBuffer::OpenFromFileDescriptor(orbit_base::unique_fd fd) {
+  CHECK(fd.valid());
+  // Only a memfd can be sealed. The seals guarantee that the producer can't shrink the memory while
+  // it is mapped, which would make accessing it raise SIGBUS.
+  const int seals = fcntl(fd.get(), F_GET_SEALS);
+  if (seals == -1) {
+    return ErrorMessage{absl::StrFormat("File descriptor is not a memfd: %s", SafeStrerror(errno))};
+  }
+  if ((seals & kRequiredSeals) != kRequiredSeals) {
+    return ErrorMessage{"The memfd of the shared memory buffer is not sealed"};
+  }
+
+  struct stat stat_buf {};
+  if (fstat(fd.get(), &stat_buf) != 0) {
+    return ErrorMessage{absl::StrFormat("fstat: %s", SafeStrerror(errno))};
+  }
+  // Derive the size from the file and not from the header, which the producer could change.
+  const uint64_t mapping_size = stat_buf.st_size;
+  if (mapping_size < kHeaderRegionSize || !IsValidDataSize(mapping_size - kHeaderRegionSize)) {
+    return ErrorMessage{
+        absl::StrFormat("Unexpected size %u for a shared memory buffer", mapping_size)};
+  }
+  const uint64_t data_size = mapping_size - kHeaderRegionSize;
+
+  OUTCOME_TRY(mapping, MapSharedMemory(fd, mapping_size));
+  auto buffer = std::unique_ptr<SharedMemoryRingBuffer>(
+      new SharedMemoryRingBuffer{std::move(fd), mapping, data_size});
+
+  if (buffer->header_->magic != kSharedMemoryRingBufferMagic ||
+      buffer->header_->data_size != data_size) {
+    return ErrorMessage{"The memfd does not contain a shared memory buffer"};
+  }
+  return buffer;
+}
+
+uint64_t SharedMemoryRingBuffer::GetMaxPayloadSize() const {
+  // Limiting records to half of the buffer guarantees that a record always fits in an empty buffer,
+  // no matter how much padding is needed to wrap around.
+  return data_size_ / 2 - sizeof(SharedMemoryRecordHeader);
+}
+
+uint8_t* SharedMemoryRingBuffer::TryAllocateRecord(uint32_t type, uint32_t payload_size) {
+  CHECK(!record_pending_);
+  CHECK(type != kSharedMemoryPaddingRecordType);
+  CHECK(payload_size <= GetMaxPayloadSize());
+
+  const uint64_t write_offset = header_->write_offset.load(std::memory_order_relaxed);
+  const uint64_t read_offset = header_->read_offset.load(std::memory_order_acquire);
+  const uint64_t free_size = data_size_ - (write_offset - read_offset);
+
+  const uint64_t record_size = GetRecordSize(payload_size);
+  uint64_t record_position = write_offset % data_size_;
+  uint64_t padding_size = 0;
+  if (record_position + record_size > data_size_) {
+    padding_size = data_size_ - record_position;
+  }
+  if (padding_size + record_size > free_size) {
+    return nullptr;
+  }
+
+  if (padding_size > 0) {
+    SharedMemoryRecordHeader padding_header{
+        kSharedMemoryPaddingRecordType,
+        static_cast<uint32_t>(padding_size - sizeof(SharedMemoryRecordHeader))};
+    memcpy(data_ + record_position, &padding_header, sizeof(padding_header));
+    record_position = 0;
+  }
+
+  SharedMemoryRecordHeader record_header{type, payload_size};
+  memcpy(data_ + record_position, &record_header, sizeof(record_header));
+
+  pending_write_offset_ = write_offset + padding_size + record_size;
+  record_pending_ = true;
+  return data_ + record_position + sizeof(SharedMemoryRecordHeader);
+}
+
+uint8_t* SharedMemoryRingBuffer::AllocateRecord(uint32_t type, uint32_t payload_size) {
+  uint8_t* payload = TryAllocateRecord(type, payload_size);
+  if (payload == nullptr) {
+    header_->dropped_record_count.fetch_add(1, std::memory_order_relaxed);
+  }
+  return payload;
+}
+
+void SharedMemoryRingBuffer::CommitRecord() {
+  CHECK(record_pending_);
+  header_->write_offset.store(pending_write_offset_, std::memory_order_release);
+  record_pending_ = false;
+}
+
+bool SharedMemoryRingBuffer::WriteRecord(uint32_t type, const void* payload,
+                                         uint32_t payload_size) {
+  uint8_t* destination = AllocateRecord(type, payload_size);
+  if (destination == nullptr) {
+    return false;
+  }
+  memcpy(destination, payload, payload_size);
+  CommitRecord();
+  return true;
+}
+
+uint64_t SharedMemoryRingBuffer::ReadAvailableRecords(const RecordConsumer& consumer) {
+  uint64_t read_offset = header_->read_offset.load(std::memory_order_relaxed);
+  const uint64_t write_offset = header_->write_offset.load(std::memory_order_acquire);
+  if (write_offset - read_offset > data_size_) {
+    ERROR("Shared memory buffer is corrupted: write offset %u, read offset %u", write_offset,
+          read_offset);
+    header_->read_offset.store(write_offset, std::memory_order_release);
+    return 0;
+  }
+
+  uint64_t record_count = 0;
+  while (read_offset < write_offset) {
+    const uint64_t record_position = read_offset % data_size_;
+    SharedMemoryRecordHeader record_header;
+    memcpy(&record_header, data_ + record_position, sizeof(record_header));
+
+    const uint64_t record_size = GetRecordSize(record_header.payload_size);
+    if (record_position + record_size > data_size_ || read_offset + record_size > write_offset) {
+      ERROR("Shared memory buffer contains a record with invalid size %u",
+            record_header.payload_size);
+      read_offset = write_offset;
+      break;
+    }
+
+    if (record_header.type != kSharedMemoryPaddingRecordType) {
+      consumer(record_header.type, data_ + record_position + sizeof(SharedMemoryRecordHeader),
+               record_header.payload_size);
+      ++record_count;
+    }
+    read_offset += record_size;
+  }
+
+  header_->read_offset.store(read_offset, std::memory_order_release);
+  return record_count;
+}
+
+uint64_t SharedMemoryRingBuffer::GetDroppedRecordCount() const {
+  return header_->dropped_record_count.load(std::memory_order_relaxed);
+}
+
+}  // namespace orbit_producer_side_channel
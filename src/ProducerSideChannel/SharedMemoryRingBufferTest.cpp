@@ -0,0 +1,164 @@
+// Copyright (c) 2021 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <fcntl.h>
+#include <gtest/gtest.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include <memory>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "OrbitBase/File.h"
+#include "ProducerSideChannel/SharedMemoryRingBuffer.h"
+
+namespace orbit_producer_side_channel {
+
+namespace {
+
+constexpr uint64_t kDataSize = 4096;
+constexpr uint32_t kTestRecordType = 42;
+
+std::unique_ptr<SharedMemoryRingBuffer> CreateBufferOrDie(uint64_t data_size = kDataSize) {
+  auto buffer_or_error = SharedMemoryRingBuffer::Create(data_size);
+  EXPECT_FALSE(buffer_or_error.has_error()) << buffer_or_error.error().message();
+  return std::move(buffer_or_error.value());
+}
+
+std::unique_ptr<SharedMemoryRingBuffer> OpenDuplicateOrDie(const SharedMemoryRingBuffer& buffer) {
+  auto buffer_or_error = SharedMemoryRingBuffer::OpenFromFileDescriptor(
+      orbit_base::unique_fd{dup(buffer.GetFileDescriptor())});
+  EXPECT_FALSE(buffer_or_error.has_error()) << buffer_or_error.error().message();
+  return std::move(buffer_or_error.value());
+}
+
+std::vector<std::string> ReadAllStrings(SharedMemoryRingBuffer* buffer) {
+  std::vector<std::string> strings;
+  buffer->ReadAvailableRecords([&strings](uint32_t type, const uint8_t* payload,
+                                          uint32_t payload_size) {
+    EXPECT_EQ(type, kTestRecordType);
+    strings.emplace_back(reinterpret_cast<const char*>(payload), payload_size);
+  });
+  return strings;
+}
+
+bool WriteString(SharedMemoryRingBuffer* buffer, const std::string& str) {
+  return buffer->WriteRecord(kTestRecordType, str.data(), str.size());
+}
+
+}  // namespace
+
+TEST(SharedMemoryRingBuffer, RecordsAreReadInOrderFromOtherMapping) {
+  std::unique_ptr<SharedMemoryRingBuffer> producer_buffer = CreateBufferOrDie();
+  std::unique_ptr<SharedMemoryRingBuffer> consumer_buffer = OpenDuplicateOrDie(*producer_buffer);
+  EXPECT_EQ(consumer_buffer->GetDataSize(), kDataSize);
+
+  EXPECT_TRUE(ReadAllStrings(consumer_buffer.get()).empty());
+
+  EXPECT_TRUE(WriteString(producer_buffer.get(), "first"));
+  EXPECT_TRUE(WriteString(producer_buffer.get(), ""));
+  EXPECT_TRUE(WriteString(producer_buffer.get(), "third record"));
+
+  EXPECT_EQ(ReadAllStrings(consumer_buffer.get()),
+            (std::vector<std::string>{"first", "", "third record"}));
+  EXPECT_TRUE(ReadAllStrings(consumer_buffer.get()).empty());
+}
+
+TEST(SharedMemoryRingBuffer, UncommittedRecordIsNotVisible) {
+  std::unique_ptr<SharedMemoryRingBuffer> buffer = CreateBufferOrDie();
+
+  uint8_t* payload = buffer->TryAllocateRecord(kTestRecordType, 3);
+  ASSERT_NE(payload, nullptr);
+  memcpy(payload, "abc", 3);
+  EXPECT_TRUE(ReadAllStrings(buffer.get()).empty());
+
+  buffer->CommitRecord();
+  EXPECT_EQ(ReadAllStrings(buffer.get()), std::vector<std::string>{"abc"});
+}
+
+TEST(SharedMemoryRingBuffer, FullBufferRejectsRecordsAndCountsDrops) {
+  std::unique_ptr<SharedMemoryRingBuffer> buffer = CreateBufferOrDie();
+  const std::string record(1000, 'x');
+
+  uint64_t written_count = 0;
+  while (WriteString(buffer.get(), record)) {
+    ++written_count;
+  }
+  EXPECT_EQ(written_count, kDataSize / (sizeof(SharedMemoryRecordHeader) + record.size()));
+  EXPECT_EQ(buffer->GetDroppedRecordCount(), 1);
+
+  EXPECT_EQ(ReadAllStrings(buffer.get()).size(), written_count);
+  EXPECT_TRUE(WriteString(buffer.get(), record));
+}
+
+TEST(SharedMemoryRingBuffer, RecordsWrapAround) {
+  std::unique_ptr<SharedMemoryRingBuffer> buffer = CreateBufferOrDie(2 * kDataSize);
+  const std::string record(1500, 'y');
+
+  // Each iteration leaves a different amount of space at the end of the buffer, so that both
+  // padded and unpadded wrap-arounds happen.
+  for (size_t i = 0; i < 100; ++i) {
+    std::string first = record.substr(0, i * 13);
+    std::string second = record.substr(0, 1500 - i * 7);
+    ASSERT_TRUE(WriteString(buffer.get(), first));
+    ASSERT_TRUE(WriteString(buffer.get(), second));
+    EXPECT_EQ(ReadAllStrings(buffer.get()), (std::vector<std::string>{first, second}));
+  }
+  EXPECT_EQ(buffer->GetDroppedRecordCount(), 0);
+}
+
+TEST(SharedMemoryRingBuffer, ConcurrentProducerAndConsumer) {
+  std::unique_ptr<SharedMemoryRingBuffer> producer_buffer = CreateBufferOrDie();
+  std::unique_ptr<SharedMemoryRingBuffer> consumer_buffer = OpenDuplicateOrDie(*producer_buffer);
+
+  constexpr uint64_t kRecordCount = 100'000;
+  std::thread producer_thread{[&producer_buffer] {
+    for (uint64_t i = 0; i < kRecordCount; ++i) {
+      // Retry instead of dropping the record when the consumer is behind.
+      uint8_t* payload;
+      while ((payload = producer_buffer->TryAllocateRecord(kTestRecordType, sizeof(i))) ==
+             nullptr) {
+        std::this_thread::yield();
+      }
+      memcpy(payload, &i, sizeof(i));
+      producer_buffer->CommitRecord();
+    }
+  }};
+
+  uint64_t expected = 0;
+  while (expected < kRecordCount) {
+    consumer_buffer->ReadAvailableRecords(
+        [&expected](uint32_t type, const uint8_t* payload, uint32_t payload_size) {
+          EXPECT_EQ(type, kTestRecordType);
+          ASSERT_EQ(payload_size, sizeof(uint64_t));
+          uint64_t value;
+          memcpy(&value, payload, sizeof(value));
+          EXPECT_EQ(value, expected);
+          ++expected;
+        });
+  }
+
+  producer_thread.join();
+  EXPECT_EQ(producer_buffer->GetDroppedRecordCount(), 0);
+}
+
+TEST(SharedMemoryRingBuffer, OpenFromFileDescriptorFailsForOtherFiles) {
+  orbit_base::unique_fd dev_null{open("/dev/null", O_RDWR | O_CLOEXEC)};
+  ASSERT_TRUE(dev_null.valid());
+  EXPECT_TRUE(SharedMemoryRingBuffer::OpenFromFileDescriptor(std::move(dev_null)).has_error());
+
+  // A memfd of the right size that is not sealed could still be shrunk by the producer.
+  constexpr uint64_t kHeaderRegionSize = 4096;
+  orbit_base::unique_fd unsealed_memfd{memfd_create("test", MFD_CLOEXEC)};
+  ASSERT_TRUE(unsealed_memfd.valid());
+  ASSERT_EQ(ftruncate(unsealed_memfd.get(), kHeaderRegionSize + kDataSize), 0);
+  EXPECT_TRUE(
+      SharedMemoryRingBuffer::OpenFromFileDescriptor(std::move(unsealed_memfd)).has_error());
+}
+
+}  // namespace orbit_producer_side_channel
@@ -0,0 +1,41 @@
+// Copyright (c) 2021 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef ORBIT_PRODUCER_SIDE_CHANNEL_FILE_DESCRIPTOR_PASSING_H_
+#define ORBIT_PRODUCER_SIDE_CHANNEL_FILE_DESCRIPTOR_PASSING_H_
+
+#include <stdint.h>
+
+#include <string_view>
+
+#include "OrbitBase/File.h"
+#include "OrbitBase/Result.h"
+
+namespace orbit_producer_side_channel {
+
+// These functions pass a file descriptor from a producer to OrbitService over a Unix domain socket
+// (with SCM_RIGHTS), together with a token that OrbitService uses to associate the file descriptor
+// with the connection of the producer. This way OrbitService never needs to open a file of another
+// process by itself, e.g., through /proc/<pid>/fd/<fd>.
+
+// Sends `fd` and `token` over the connected Unix domain socket `socket_fd`.
+[[nodiscard]] ErrorMessageOr<void> SendFileDescriptor(int socket_fd, uint64_t token, int fd);
+
+// Connects to the Unix domain socket at `socket_path` and sends `fd` and `token` with
+// SendFileDescriptor.
+[[nodiscard]] ErrorMessageOr<void> ConnectAndSendFileDescriptor(std::string_view socket_path,
+                                                                uint64_t token, int fd);
+
+struct TokenAndFileDescriptor {
+  uint64_t token;
+  orbit_base::unique_fd fd;
+};
+
+// Receives a file descriptor and its token sent with SendFileDescriptor over the connected Unix
+// domain socket `socket_fd`.
+[[nodiscard]] ErrorMessageOr<TokenAndFileDescriptor> ReceiveFileDescriptor(int socket_fd);
+
+}  // namespace orbit_producer_side_channel
+
+#endif  // ORBIT_PRODUCER_SIDE_CHANNEL_FILE_DESCRIPTOR_PASSING_H_
@@ -0,0 +1,100 @@
+// Copyright (c) 2021 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef ORBIT_PRODUCER_SIDE_CHANNEL_SHARED_MEMORY_RECORDS_H_
+#define ORBIT_PRODUCER_SIDE_CHANNEL_SHARED_MEMORY_RECORDS_H_
+
+#include <stdint.h>
+
+#include <type_traits>
+
+#include "ProducerSideChannel/SharedMemoryRingBuffer.h"
+
+namespace orbit_producer_side_channel {
+
+// These are the types of the records that producers write into a SharedMemoryRingBuffer and that
+// OrbitService converts to ProducerCaptureEvents. The layouts below are shared between the
+// producer and OrbitService, so they can only be extended by adding new record types.
+enum class SharedMemoryRecordType : uint32_t {
+  // kSharedMemoryPaddingRecordType is 0.
+  // The payload is a serialized ProducerCaptureEvent. This allows producers to send events that
+  // don't have a fixed-layout record (yet).
+  kSerializedProducerCaptureEvent = 1,
+  // The payload is an InternedStringRecord followed by the characters of the string.
+  kInternedString = 2,
+  // The payload is a GpuQueueSubmissionRecord followed by
+  // - num_submit_infos uint32_t with the number of command buffers of each submit info, padded to
+  //   kSharedMemoryRecordAlignment;
+  // - num_command_buffers GpuCommandBufferRecords, in the order of the submit infos;
+  // - num_completed_markers GpuDebugMarkerRecords.
+  kGpuQueueSubmission = 3,
+};
+
+struct InternedStringRecord {
+  uint64_t key;
+};
+
+struct GpuQueueSubmissionMetaInfoRecord {
+  int32_t pid;
+  int32_t tid;
+  uint64_t pre_submission_cpu_timestamp;
+  uint64_t post_submission_cpu_timestamp;
+};
+
+struct GpuQueueSubmissionRecord {
+  GpuQueueSubmissionMetaInfoRecord meta_info;
+  int32_t num_begin_markers;
+  uint32_t num_submit_infos;
+  uint32_t num_command_buffers;
+  uint32_t num_completed_markers;
+};
+
+struct GpuCommandBufferRecord {
+  uint64_t begin_gpu_timestamp_ns;
+  uint64_t end_gpu_timestamp_ns;
+};
+
+struct GpuDebugMarkerRecord {
+  static constexpr uint32_t kHasBeginMarker = 1u << 0;
+  static constexpr uint32_t kHasColor = 1u << 1;
+
+  GpuQueueSubmissionMetaInfoRecord begin_meta_info;
+  uint64_t begin_gpu_timestamp_ns;
+  uint64_t end_gpu_timestamp_ns;
+  uint64_t text_key;
+  int32_t depth;
+  uint32_t flags;
+  float color_red;
+  float color_green;
+  float color_blue;
+  float color_alpha;
+};
+
+static_assert(std::is_trivially_copyable_v<InternedStringRecord> &&
+              std::is_trivially_copyable_v<GpuQueueSubmissionRecord> &&
+              std::is_trivially_copyable_v<GpuCommandBufferRecord> &&
+              std::is_trivially_copyable_v<GpuDebugMarkerRecord>);
+static_assert(sizeof(GpuQueueSubmissionRecord) % kSharedMemoryRecordAlignment == 0 &&
+              sizeof(GpuCommandBufferRecord) % kSharedMemoryRecordAlignment == 0 &&
+              sizeof(GpuDebugMarkerRecord) % kSharedMemoryRecordAlignment == 0);
+
+// Size of the array of command buffer counts in a kGpuQueueSubmission record.
+[[nodiscard]] constexpr uint64_t GetGpuQueueSubmissionCommandBufferCountsSize(
+    uint32_t num_submit_infos) {
+  return (num_submit_infos * sizeof(uint32_t) + kSharedMemoryRecordAlignment - 1) &
+         ~(kSharedMemoryRecordAlignment - 1);
+}
+
+[[nodiscard]] constexpr uint64_t GetGpuQueueSubmissionPayloadSize(uint32_t num_submit_infos,
+                                                                  uint32_t num_command_buffers,
+                                                                  uint32_t num_completed_markers) {
+  return sizeof(GpuQueueSubmissionRecord) +
+         GetGpuQueueSubmissionCommandBufferCountsSize(num_submit_infos) +
+         num_command_buffers * sizeof(GpuCommandBufferRecord) +
+         num_completed_markers * sizeof(GpuDebugMarkerRecord);
+}
+
+}  // namespace orbit_producer_side_channel
+
+#endif  // ORBIT_PRODUCER_SIDE_CHANNEL_SHARED_MEMORY_RECORDS_H_
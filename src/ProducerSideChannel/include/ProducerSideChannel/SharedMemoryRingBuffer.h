@@ -0,0 +1,115 @@
+// Copyright (c) 2021 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef ORBIT_PRODUCER_SIDE_CHANNEL_SHARED_MEMORY_RING_BUFFER_H_
+#define ORBIT_PRODUCER_SIDE_CHANNEL_SHARED_MEMORY_RING_BUFFER_H_
+
+#include <stdint.h>
+
+#include <atomic>
+#include <functional>
+#include <memory>
+
+#include "OrbitBase/File.h"
+#include "OrbitBase/Result.h"
+
+namespace orbit_producer_side_channel {
+
+// This is the layout of the first page of the shared memory region, before the actual data.
+// write_offset and read_offset increase monotonically and are only reduced modulo the data size
+// when accessing the data, so that write_offset - read_offset is the number of bytes in use.
+struct SharedMemoryRingBufferHeader {
+  uint64_t magic;
+  uint64_t data_size;
+  // Written by the producer, read by the consumer.
+  alignas(64) std::atomic<uint64_t> write_offset;
+  std::atomic<uint64_t> dropped_record_count;
+  // Written by the consumer, read by the producer.
+  alignas(64) std::atomic<uint64_t> read_offset;
+};
+
+static_assert(std::atomic<uint64_t>::is_always_lock_free,
+              "The atomics in shared memory must not need a lock");
+
+// Every record starts with this header and is aligned to kSharedMemoryRecordAlignment.
+// The payload immediately follows the header.
+struct SharedMemoryRecordHeader {
+  uint32_t type;
+  uint32_t payload_size;
+};
+
+// Records of this type are never passed to consumers: they fill the space at the end of the
+// buffer when the next record doesn't fit there and needs to start again from the beginning.
+constexpr uint32_t kSharedMemoryPaddingRecordType = 0;
+
+constexpr uint64_t kSharedMemoryRecordAlignment = 8;
+
+// This class implements a single-producer/single-consumer ring buffer of variable-size records in
+// a memory region backed by a memfd, to be shared between a producer of CaptureEvents (in the
+// target process) and OrbitService.
+// The producer creates the buffer with Create and passes the file descriptor returned by
+// GetFileDescriptor to OrbitService (see FileDescriptorPassing.h). OrbitService then maps the same
+// memory with OpenFromFileDescriptor. The memfd is sealed, so that its size can't change.
+// The producer writes records with AllocateRecord/CommitRecord (or WriteRecord), which never
+// involve a syscall. The consumer polls for them with ReadAvailableRecords.
+// As the memory is writable by the target process, the consumer validates every record header
+// before passing the record on.
+class SharedMemoryRingBuffer {
+ public:
+  ~SharedMemoryRingBuffer();
+
+  SharedMemoryRingBuffer(const SharedMemoryRingBuffer&) = delete;
+  SharedMemoryRingBuffer& operator=(const SharedMemoryRingBuffer&) = delete;
+  SharedMemoryRingBuffer(SharedMemoryRingBuffer&&) = delete;
+  SharedMemoryRingBuffer& operator=(SharedMemoryRingBuffer&&) = delete;
+
+  // data_size needs to be a power of two and a multiple of the page size.
+  [[nodiscard]] static ErrorMessageOr<std::unique_ptr<SharedMemoryRingBuffer>> Create(
+      uint64_t data_size);
+  // Fails unless `fd` is a sealed memfd that was set up by Create.
+  [[nodiscard]] static ErrorMessageOr<std::unique_ptr<SharedMemoryRingBuffer>>
+  OpenFromFileDescriptor(orbit_base::unique_fd fd);
+
+  [[nodiscard]] int GetFileDescriptor() const { return fd_.get(); }
+  [[nodiscard]] uint64_t GetDataSize() const { return data_size_; }
+  [[nodiscard]] uint64_t GetMaxPayloadSize() const;
+
+  // Producer side.
+  // Reserves space for a record with the specified type and payload size and returns a pointer to
+  // where the payload has to be written, or nullptr if the buffer is full. The record only becomes
+  // visible to the consumer after CommitRecord. Only one record can be pending at a time.
+  [[nodiscard]] uint8_t* TryAllocateRecord(uint32_t type, uint32_t payload_size);
+  // Like TryAllocateRecord, but counts a dropped record if the buffer is full. This never waits for
+  // the consumer: blocking the producer, which runs in the target process, is worse than losing
+  // the record, and the consumer reports the dropped records.
+  [[nodiscard]] uint8_t* AllocateRecord(uint32_t type, uint32_t payload_size);
+  void CommitRecord();
+  [[nodiscard]] bool WriteRecord(uint32_t type, const void* payload, uint32_t payload_size);
+
+  // Consumer side.
+  // Calls consumer for all records that have been committed so far, in order, and then releases
+  // their space to the producer. Returns the number of records passed to consumer.
+  using RecordConsumer =
+      std::function<void(uint32_t type, const uint8_t* payload, uint32_t payload_size)>;
+  uint64_t ReadAvailableRecords(const RecordConsumer& consumer);
+
+  [[nodiscard]] uint64_t GetDroppedRecordCount() const;
+
+ private:
+  SharedMemoryRingBuffer(orbit_base::unique_fd fd, void* mapping, uint64_t data_size);
+
+  orbit_base::unique_fd fd_;
+  void* mapping_;
+  uint64_t data_size_;
+  SharedMemoryRingBufferHeader* header_;
+  uint8_t* data_;
+
+  // Only used by the producer, to remember the end of the record being allocated.
+  uint64_t pending_write_offset_ = 0;
+  bool record_pending_ = false;
+};
+
+}  // namespace orbit_producer_side_channel
+
+#endif  // ORBIT_PRODUCER_SIDE_CHANNEL_SHARED_MEMORY_RING_BUFFER_H_
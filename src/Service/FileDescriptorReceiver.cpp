@@ -0,0 +1,158 @@
+// Copyright (c) 2021 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "FileDescriptorReceiver.h"
+
+#include <absl/strings/str_format.h>
+#include <errno.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <random>
+#include <utility>
+
+#include "OrbitBase/Logging.h"
+#include "OrbitBase/SafeStrerror.h"
+#include "OrbitBase/ThreadUtils.h"
+#include "ProducerSideChannel/FileDescriptorPassing.h"
+
+namespace orbit_service {
+
+ErrorMessageOr<std::unique_ptr<FileDescriptorReceiver>> FileDescriptorReceiver::Create(
+    std::string socket_path) {
+  sockaddr_un address{};
+  address.sun_family = AF_UNIX;
+  if (socket_path.size() >= sizeof(address.sun_path)) {
+    return ErrorMessage{absl::StrFormat("Socket path \"%s\" is too long", socket_path)};
+  }
+  memcpy(address.sun_path, socket_path.data(), socket_path.size());
+
+  orbit_base::unique_fd listening_socket{socket(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0)};
+  if (!listening_socket.valid()) {
+    return ErrorMessage{absl::StrFormat("socket: %s", SafeStrerror(errno))};
+  }
+
+  // Remove the socket left behind by a previous instance, if any.
+  if (unlink(socket_path.c_str()) != 0 && errno != ENOENT) {
+    return ErrorMessage{
+        absl::StrFormat("Unable to remove \"%s\": %s", socket_path, SafeStrerror(errno))};
+  }
+  if (bind(listening_socket.get(), reinterpret_cast<const sockaddr*>(&address),
+           sizeof(address)) != 0) {
+    return ErrorMessage{
+        absl::StrFormat("Unable to bind to \"%s\": %s", socket_path, SafeStrerror(errno))};
+  }
+  // When OrbitService runs as root, also allow non-root producers (e.g., the game) to connect.
+  if (chmod(socket_path.c_str(), 0777) != 0) {
+    return ErrorMessage{absl::StrFormat("Changing mode bits to 777 of \"%s\": %s", socket_path,
+                                        SafeStrerror(errno))};
+  }
+  if (listen(listening_socket.get(), SOMAXCONN) != 0) {
+    return ErrorMessage{absl::StrFormat("listen: %s", SafeStrerror(errno))};
+  }
+
+  return std::unique_ptr<FileDescriptorReceiver>(
+      new FileDescriptorReceiver{std::move(socket_path), std::move(listening_socket)});
+}
+
+FileDescriptorReceiver::FileDescriptorReceiver(std::string socket_path,
+                                               orbit_base::unique_fd listening_socket)
+    : socket_path_{std::move(socket_path)},
+      listening_socket_{std::move(listening_socket)},
+      accept_thread_{&FileDescriptorReceiver::AcceptThread, this} {}
+
+FileDescriptorReceiver::~FileDescriptorReceiver() {
+  // This makes the blocking accept in AcceptThread fail.
+  if (shutdown(listening_socket_.get(), SHUT_RDWR) != 0) {
+    ERROR("shutdown: %s", SafeStrerror(errno));
+  }
+  CHECK(accept_thread_.joinable());
+  accept_thread_.join();
+  if (unlink(socket_path_.c_str()) != 0) {
+    ERROR("Removing \"%s\": %s", socket_path_, SafeStrerror(errno));
+  }
+}
+
+uint64_t FileDescriptorReceiver::RegisterNewToken() {
+  // The token must not be guessable by other processes, so don't use a pseudo-random generator.
+  std::random_device random_device;
+  absl::MutexLock lock{&mutex_};
+  while (true) {
+    const uint64_t token = (static_cast<uint64_t>(random_device()) << 32) | random_device();
+    if (file_descriptors_by_token_.try_emplace(token).second) {
+      return token;
+    }
+  }
+}
+
+void FileDescriptorReceiver::UnregisterToken(uint64_t token) {
+  absl::MutexLock lock{&mutex_};
+  file_descriptors_by_token_.erase(token);
+}
+
+std::optional<orbit_base::unique_fd> FileDescriptorReceiver::TakeFileDescriptor(
+    uint64_t token, absl::Duration timeout) {
+  absl::MutexLock lock{&mutex_};
+  auto is_received_or_unregistered = [this, token]() {
+    auto it = file_descriptors_by_token_.find(token);
+    return it == file_descriptors_by_token_.end() || it->second.valid();
+  };
+  mutex_.AwaitWithTimeout(absl::Condition(&is_received_or_unregistered), timeout);
+
+  auto it = file_descriptors_by_token_.find(token);
+  if (it == file_descriptors_by_token_.end() || !it->second.valid()) {
+    return std::nullopt;
+  }
+  // This leaves an invalid file descriptor in the map, so the token stays registered.
+  return std::move(it->second);
+}
+
+void FileDescriptorReceiver::AcceptThread() {
+  orbit_base::SetCurrentThreadName("PSSI::FdRecv");
+
+  while (true) {
+    orbit_base::unique_fd connection{
+        accept4(listening_socket_.get(), nullptr, nullptr, SOCK_CLOEXEC)};
+    if (!connection.valid()) {
+      if (errno == EINTR || errno == ECONNABORTED) {
+        continue;
+      }
+      // This is expected when the destructor shuts the socket down.
+      LOG("Stopped accepting file descriptors on \"%s\": %s", socket_path_, SafeStrerror(errno));
+      return;
+    }
+    ReceiveFromConnection(connection.get());
+  }
+}
+
+void FileDescriptorReceiver::ReceiveFromConnection(int connection_fd) {
+  // Producers send right after connecting: don't let one that doesn't block all others.
+  constexpr timeval kReceiveTimeout{1, 0};
+  if (setsockopt(connection_fd, SOL_SOCKET, SO_RCVTIMEO, &kReceiveTimeout,
+                 sizeof(kReceiveTimeout)) != 0) {
+    ERROR("Setting receive timeout: %s", SafeStrerror(errno));
+    return;
+  }
+
+  ErrorMessageOr<orbit_producer_side_channel::TokenAndFileDescriptor> received_or_error =
+      orbit_producer_side_channel::ReceiveFileDescriptor(connection_fd);
+  if (received_or_error.has_error()) {
+    ERROR("Receiving file descriptor from producer: %s", received_or_error.error().message());
+    return;
+  }
+
+  absl::MutexLock lock{&mutex_};
+  auto it = file_descriptors_by_token_.find(received_or_error.value().token);
+  if (it == file_descriptors_by_token_.end()) {
+    ERROR("Received file descriptor with unknown token");
+    return;
+  }
+  it->second = std::move(received_or_error.value().fd);
+}
+
+}  // namespace orbit_service
@@ -0,0 +1,74 @@
+// Copyright (c) 2021 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef ORBIT_SERVICE_FILE_DESCRIPTOR_RECEIVER_H_
+#define ORBIT_SERVICE_FILE_DESCRIPTOR_RECEIVER_H_
+
+#include <absl/container/flat_hash_map.h>
+#include <absl/synchronization/mutex.h>
+#include <absl/time/time.h>
+#include <stdint.h>
+
+#include <memory>
+#include <optional>
+#include <string>
+#include <thread>
+
+#include "OrbitBase/File.h"
+#include "OrbitBase/Result.h"
+
+namespace orbit_service {
+
+// This class listens on a Unix domain socket for file descriptors that producers pass to
+// OrbitService with orbit_producer_side_channel::ConnectAndSendFileDescriptor, e.g., the memfd of
+// a SharedMemoryRingBuffer.
+// Each file descriptor comes with a token, which OrbitService generates with RegisterNewToken and
+// sends to a single producer over its gRPC stream. File descriptors with a token that is not
+// registered are closed right away, so that only connected producers can pass file descriptors,
+// and only to their own connection.
+class FileDescriptorReceiver {
+ public:
+  // Creates the socket at `socket_path`, replacing any existing file, and starts accepting
+  // connections on a separate thread.
+  [[nodiscard]] static ErrorMessageOr<std::unique_ptr<FileDescriptorReceiver>> Create(
+      std::string socket_path);
+  ~FileDescriptorReceiver();
+
+  FileDescriptorReceiver(const FileDescriptorReceiver&) = delete;
+  FileDescriptorReceiver& operator=(const FileDescriptorReceiver&) = delete;
+  FileDescriptorReceiver(FileDescriptorReceiver&&) = delete;
+  FileDescriptorReceiver& operator=(FileDescriptorReceiver&&) = delete;
+
+  [[nodiscard]] const std::string& GetSocketPath() const { return socket_path_; }
+
+  // Generates a random token and accepts file descriptors with it until UnregisterToken.
+  [[nodiscard]] uint64_t RegisterNewToken();
+  void UnregisterToken(uint64_t token);
+
+  // Returns the last file descriptor received with `token`, waiting for at most `timeout` if none
+  // has been received yet, as the producer passes it independently of its gRPC stream. Returns
+  // std::nullopt if the token is not registered or if nothing was received.
+  [[nodiscard]] std::optional<orbit_base::unique_fd> TakeFileDescriptor(uint64_t token,
+                                                                        absl::Duration timeout);
+
+ private:
+  FileDescriptorReceiver(std::string socket_path, orbit_base::unique_fd listening_socket);
+
+  void AcceptThread();
+  void ReceiveFromConnection(int connection_fd);
+
+  std::string socket_path_;
+  orbit_base::unique_fd listening_socket_;
+
+  // An invalid file descriptor means that the token is registered but nothing was received yet.
+  absl::flat_hash_map<uint64_t, orbit_base::unique_fd> file_descriptors_by_token_
+      ABSL_GUARDED_BY(mutex_);
+  absl::Mutex mutex_;
+
+  std::thread accept_thread_;
+};
+
+}  // namespace orbit_service
+
+#endif  // ORBIT_SERVICE_FILE_DESCRIPTOR_RECEIVER_H_
@@ -0,0 +1,83 @@
+// Copyright (c) 2021 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <absl/strings/str_format.h>
+#include <absl/time/time.h>
+#include <fcntl.h>
+#include <gtest/gtest.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <memory>
+#include <optional>
+#include <string>
+#include <utility>
+
+#include "FileDescriptorReceiver.h"
+#include "OrbitBase/File.h"
+#include "OrbitBase/Logging.h"
+#include "ProducerSideChannel/FileDescriptorPassing.h"
+
+namespace orbit_service {
+
+namespace {
+
+std::unique_ptr<FileDescriptorReceiver> CreateFileDescriptorReceiverOrDie() {
+  auto file_descriptor_receiver_or_error = FileDescriptorReceiver::Create(absl::StrFormat(
+      "/tmp/orbit-file-descriptor-receiver-test-%d", static_cast<int>(getpid())));
+  CHECK(!file_descriptor_receiver_or_error.has_error());
+  return std::move(file_descriptor_receiver_or_error.value());
+}
+
+ino_t GetInode(int fd) {
+  struct stat stat_buf {};
+  CHECK(fstat(fd, &stat_buf) == 0);
+  return stat_buf.st_ino;
+}
+
+}  // namespace
+
+TEST(FileDescriptorReceiver, ReceivesFileDescriptorWithRegisteredToken) {
+  std::unique_ptr<FileDescriptorReceiver> receiver = CreateFileDescriptorReceiverOrDie();
+  const uint64_t token = receiver->RegisterNewToken();
+
+  orbit_base::unique_fd sent_fd{open("/dev/null", O_RDONLY | O_CLOEXEC)};
+  ASSERT_TRUE(sent_fd.valid());
+  ASSERT_FALSE(orbit_producer_side_channel::ConnectAndSendFileDescriptor(
+                   receiver->GetSocketPath(), token, sent_fd.get())
+                   .has_error());
+
+  std::optional<orbit_base::unique_fd> received_fd =
+      receiver->TakeFileDescriptor(token, absl::Seconds(1));
+  ASSERT_TRUE(received_fd.has_value());
+  ASSERT_TRUE(received_fd->valid());
+  EXPECT_NE(received_fd->get(), sent_fd.get());
+  EXPECT_EQ(GetInode(received_fd->get()), GetInode(sent_fd.get()));
+
+  // The file descriptor can only be taken once.
+  EXPECT_FALSE(receiver->TakeFileDescriptor(token, absl::ZeroDuration()).has_value());
+}
+
+TEST(FileDescriptorReceiver, DropsFileDescriptorWithUnregisteredToken) {
+  std::unique_ptr<FileDescriptorReceiver> receiver = CreateFileDescriptorReceiverOrDie();
+  const uint64_t token = receiver->RegisterNewToken();
+  receiver->UnregisterToken(token);
+
+  orbit_base::unique_fd sent_fd{open("/dev/null", O_RDONLY | O_CLOEXEC)};
+  ASSERT_TRUE(sent_fd.valid());
+  ASSERT_FALSE(orbit_producer_side_channel::ConnectAndSendFileDescriptor(
+                   receiver->GetSocketPath(), token, sent_fd.get())
+                   .has_error());
+
+  EXPECT_FALSE(receiver->TakeFileDescriptor(token, absl::Milliseconds(100)).has_value());
+}
+
+TEST(FileDescriptorReceiver, TakeFileDescriptorTimesOut) {
+  std::unique_ptr<FileDescriptorReceiver> receiver = CreateFileDescriptorReceiverOrDie();
+  const uint64_t token = receiver->RegisterNewToken();
+
+  EXPECT_FALSE(receiver->TakeFileDescriptor(token, absl::Milliseconds(10)).has_value());
+}
+
+}  // namespace orbit_service
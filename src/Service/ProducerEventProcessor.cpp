@@ -24,6 +24,7 @@ using orbit_grpc_protos::FullTracepointEvent;
 using orbit_grpc_protos::FunctionCall;
 using orbit_grpc_protos::GpuDebugMarker;
 using orbit_grpc_protos::GpuJob;
+using orbit_grpc_protos::GpuQuerySlotsExhaustedEvent;
 using orbit_grpc_protos::GpuQueueSubmission;
 using orbit_grpc_protos::InternedCallstack;
 using orbit_grpc_protos::InternedString;
@@ -76,6 +77,8 @@ class ProducerEventProcessorImpl : public ProducerEventProcessor {
   void ProcessFullCallstackSample(FullCallstackSample* full_callstack_sample);
   void ProcessFunctionCall(FunctionCall* function_call);
   void ProcessFullGpuJob(FullGpuJob* full_gpu_job_event);
+  void ProcessGpuQuerySlotsExhaustedEvent(
+      GpuQuerySlotsExhaustedEvent* gpu_query_slots_exhausted_event);
   void ProcessGpuQueueSubmission(uint64_t producer_id, GpuQueueSubmission* gpu_queue_submission);
   // ProcessInterned* functions remap producer intern_ids to the id space used in the client.
   // They keep track of these mappings in producer_interned_callstack_id_to_client_callstack_id_
@@ -318,6 +321,13 @@ void ProducerEventProcessorImpl::ProcessSystemMemoryUsage(SystemMemoryUsage* sys
   capture_event_buffer_->AddEvent(std::move(event));
 }
 
+void ProducerEventProcessorImpl::ProcessGpuQuerySlotsExhaustedEvent(
+    GpuQuerySlotsExhaustedEvent* gpu_query_slots_exhausted_event) {
+  ClientCaptureEvent event;
+  *event.mutable_gpu_query_slots_exhausted_event() = std::move(*gpu_query_slots_exhausted_event);
+  capture_event_buffer_->AddEvent(std::move(event));
+}
+
 void ProducerEventProcessorImpl::ProcessEvent(uint64_t producer_id, ProducerCaptureEvent event) {
   switch (event.event_case()) {
     case ProducerCaptureEvent::kInternedCallstack:
@@ -347,6 +357,9 @@ void ProducerEventProcessorImpl::ProcessEvent(uint64_t producer_id, ProducerCapt
     case ProducerCaptureEvent::kGpuQueueSubmission:
       ProcessGpuQueueSubmission(producer_id, event.mutable_gpu_queue_submission());
       break;
+    case ProducerCaptureEvent::kGpuQuerySlotsExhaustedEvent:
+      ProcessGpuQuerySlotsExhaustedEvent(event.mutable_gpu_query_slots_exhausted_event());
+      break;
     case ProducerCaptureEvent::kThreadName:
       ProcessThreadName(event.mutable_thread_name());
       break;
@@ -26,6 +26,7 @@ using orbit_grpc_protos::FunctionCall;
 using orbit_grpc_protos::GpuCommandBuffer;
 using orbit_grpc_protos::GpuDebugMarker;
 using orbit_grpc_protos::GpuJob;
+using orbit_grpc_protos::GpuQuerySlotsExhaustedEvent;
 using orbit_grpc_protos::GpuQueueSubmission;
 using orbit_grpc_protos::GpuSubmitInfo;
 using orbit_grpc_protos::InternedCallstack;
@@ -1182,6 +1183,34 @@ TEST(ProducerEventProcessor, ModuleUpdateEventSmoke) {
   EXPECT_EQ(module_update.module().load_bias(), 0x2000);
 }
 
+TEST(ProducerEventProcessor, GpuQuerySlotsExhaustedEventSmoke) {
+  MockCaptureEventBuffer buffer;
+  auto producer_event_processor = ProducerEventProcessor::Create(&buffer);
+
+  ProducerCaptureEvent producer_event;
+  {
+    GpuQuerySlotsExhaustedEvent* exhausted_event =
+        producer_event.mutable_gpu_query_slots_exhausted_event();
+    exhausted_event->set_pid(kPid1);
+    exhausted_event->set_timestamp_ns(kTimestampNs1);
+    exhausted_event->set_num_dropped_command_buffer_timestamps(3);
+    exhausted_event->set_num_dropped_debug_marker_timestamps(42);
+  }
+
+  ClientCaptureEvent event;
+
+  EXPECT_CALL(buffer, AddEvent).Times(1).WillOnce(SaveArg<0>(&event));
+
+  producer_event_processor->ProcessEvent(1, producer_event);
+
+  ASSERT_EQ(event.event_case(), ClientCaptureEvent::kGpuQuerySlotsExhaustedEvent);
+  const GpuQuerySlotsExhaustedEvent& exhausted_event = event.gpu_query_slots_exhausted_event();
+  EXPECT_EQ(exhausted_event.pid(), kPid1);
+  EXPECT_EQ(exhausted_event.timestamp_ns(), kTimestampNs1);
+  EXPECT_EQ(exhausted_event.num_dropped_command_buffer_timestamps(), 3);
+  EXPECT_EQ(exhausted_event.num_dropped_debug_marker_timestamps(), 42);
+}
+
 TEST(ProducerEventProcessor, FullAddressInfoSmoke) {
   MockCaptureEventBuffer buffer;
   auto producer_event_processor = ProducerEventProcessor::Create(&buffer);
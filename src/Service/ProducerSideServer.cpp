@@ -12,6 +12,7 @@
 #include <sys/stat.h>
 
 #include <string>
+#include <utility>
 
 #include "OrbitBase/Logging.h"
 #include "OrbitBase/SafeStrerror.h"
@@ -22,6 +23,17 @@ namespace orbit_service {
 bool ProducerSideServer::BuildAndStart(std::string_view unix_domain_socket_path) {
   CHECK(server_ == nullptr);
 
+  // Producers can still send their CaptureEvents over gRPC if this fails.
+  ErrorMessageOr<std::unique_ptr<FileDescriptorReceiver>> file_descriptor_receiver_or_error =
+      FileDescriptorReceiver::Create(absl::StrFormat("%s-fds", unix_domain_socket_path));
+  if (file_descriptor_receiver_or_error.has_error()) {
+    ERROR("Creating socket for shared memory buffers of producers: %s",
+          file_descriptor_receiver_or_error.error().message());
+  } else {
+    file_descriptor_receiver_ = std::move(file_descriptor_receiver_or_error.value());
+    producer_side_service_.SetFileDescriptorReceiver(file_descriptor_receiver_.get());
+  }
+
   grpc::ServerBuilder builder;
   builder.AddListeningPort(absl::StrFormat("unix:%s", unix_domain_socket_path),
                            grpc::InsecureServerCredentials());
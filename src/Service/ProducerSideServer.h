@@ -10,6 +10,7 @@
 
 #include "CaptureEventBuffer.h"
 #include "CaptureStartStopListener.h"
+#include "FileDescriptorReceiver.h"
 #include "OrbitBase/Logging.h"
 #include "ProducerSideServiceImpl.h"
 #include "capture.pb.h"
@@ -19,6 +20,8 @@ namespace orbit_service {
 
 // Wrapper around a grpc::Server that registers the service ProducerSideServiceImpl
 // and listens on a Unix domain socket.
+// It also receives the memfds of the shared memory buffers of producers on a second Unix domain
+// socket, whose path is the one of the first with "-fds" appended.
 class ProducerSideServer final : public CaptureStartStopListener {
  public:
   bool BuildAndStart(std::string_view unix_domain_socket_path);
@@ -29,6 +32,8 @@ class ProducerSideServer final : public CaptureStartStopListener {
   void OnCaptureStopRequested() override;
 
  private:
+  // Declared before producer_side_service_, which uses it, so that it is destroyed after it.
+  std::unique_ptr<FileDescriptorReceiver> file_descriptor_receiver_;
   ProducerSideServiceImpl producer_side_service_;
   std::unique_ptr<grpc::Server> server_;
 };
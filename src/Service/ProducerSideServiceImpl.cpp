@@ -7,16 +7,22 @@
 #include <absl/synchronization/mutex.h>
 #include <absl/time/time.h>
 
+#include <memory>
+#include <optional>
 #include <thread>
 #include <utility>
 
+#include "OrbitBase/File.h"
 #include "OrbitBase/Logging.h"
 #include "OrbitBase/ThreadUtils.h"
+#include "ProducerSideChannel/SharedMemoryRingBuffer.h"
+#include "SharedMemoryBufferConsumer.h"
 #include "capture.pb.h"
 
 namespace orbit_service {
 
 using orbit_grpc_protos::ProducerCaptureEvent;
+using orbit_producer_side_channel::SharedMemoryRingBuffer;
 
 void ProducerSideServiceImpl::OnCaptureStartRequested(
     orbit_grpc_protos::CaptureOptions capture_options,
@@ -108,12 +114,20 @@ grpc::Status ProducerSideServiceImpl::ReceiveCommandsAndSendEvents(
 
   std::atomic<bool> receive_events_thread_exited = false;
 
+  // Only this producer learns this token, so only this producer can pass the memfd of its shared
+  // memory buffer for this connection.
+  std::optional<uint64_t> shared_memory_buffer_token;
+  if (file_descriptor_receiver_ != nullptr) {
+    shared_memory_buffer_token = file_descriptor_receiver_->RegisterNewToken();
+  }
+
   // This thread is responsible for writing on stream, and specifically for
   // sending StartCaptureCommands and StopCaptureCommands to the connected producer.
   std::thread send_commands_thread{&ProducerSideServiceImpl::SendCommandsThread,
                                    this,
                                    context,
                                    stream,
+                                   shared_memory_buffer_token,
                                    &all_events_sent_received,
                                    &receive_events_thread_exited};
 
@@ -124,6 +138,7 @@ grpc::Status ProducerSideServiceImpl::ReceiveCommandsAndSendEvents(
                                     context,
                                     stream,
                                     producer_id_counter_++,
+                                    shared_memory_buffer_token,
                                     &all_events_sent_received};
   receive_events_thread.join();
 
@@ -132,6 +147,10 @@ grpc::Status ProducerSideServiceImpl::ReceiveCommandsAndSendEvents(
   receive_events_thread_exited = true;
   send_commands_thread.join();
 
+  if (shared_memory_buffer_token.has_value()) {
+    file_descriptor_receiver_->UnregisterToken(shared_memory_buffer_token.value());
+  }
+
   {
     absl::MutexLock lock{&server_contexts_mutex_};
     server_contexts_.erase(context);
@@ -145,9 +164,18 @@ static bool SendStartCaptureCommand(
     grpc::ServerContext* context,
     grpc::ServerReaderWriter<orbit_grpc_protos::ReceiveCommandsAndSendEventsResponse,
                              orbit_grpc_protos::ReceiveCommandsAndSendEventsRequest>* stream,
-    orbit_grpc_protos::CaptureOptions capture_options) {
+    orbit_grpc_protos::CaptureOptions capture_options,
+    const FileDescriptorReceiver* file_descriptor_receiver,
+    std::optional<uint64_t> shared_memory_buffer_token) {
   orbit_grpc_protos::ReceiveCommandsAndSendEventsResponse command;
   *command.mutable_start_capture_command()->mutable_capture_options() = std::move(capture_options);
+  if (shared_memory_buffer_token.has_value()) {
+    CHECK(file_descriptor_receiver != nullptr);
+    command.mutable_start_capture_command()->set_shared_memory_buffer_socket_path(
+        file_descriptor_receiver->GetSocketPath());
+    command.mutable_start_capture_command()->set_shared_memory_buffer_token(
+        shared_memory_buffer_token.value());
+  }
   if (!stream->Write(command)) {
     ERROR("Sending StartCaptureCommand to CaptureEventProducer");
     LOG("Terminating call to ReceiveCommandsAndSendEvents as Write failed");
@@ -197,7 +225,8 @@ void ProducerSideServiceImpl::SendCommandsThread(
     grpc::ServerContext* context,
     grpc::ServerReaderWriter<orbit_grpc_protos::ReceiveCommandsAndSendEventsResponse,
                              orbit_grpc_protos::ReceiveCommandsAndSendEventsRequest>* stream,
-    bool* all_events_sent_received, std::atomic<bool>* receive_events_thread_exited) {
+    std::optional<uint64_t> shared_memory_buffer_token, bool* all_events_sent_received,
+    std::atomic<bool>* receive_events_thread_exited) {
   // As a result of initializing prev_capture_status to kCaptureFinished,
   // an initial StartCaptureCommand is sent
   // if service_state_.capture_status is actually CaptureStatus::kCaptureStarted,
@@ -299,12 +328,14 @@ void ProducerSideServiceImpl::SendCommandsThread(
       case CaptureStatus::kCaptureStarted: {
         CHECK(curr_capture_options.has_value());
         if (prev_capture_status == CaptureStatus::kCaptureFinished) {
-          if (!SendStartCaptureCommand(context, stream, curr_capture_options.value())) {
+          if (!SendStartCaptureCommand(context, stream, curr_capture_options.value(),
+                                       file_descriptor_receiver_, shared_memory_buffer_token)) {
             return;
           }
         } else if (prev_capture_status == CaptureStatus::kCaptureStopping) {
           if (!SendCaptureFinishedCommand(context, stream) ||
-              !SendStartCaptureCommand(context, stream, curr_capture_options.value())) {
+              !SendStartCaptureCommand(context, stream, curr_capture_options.value(),
+                                       file_descriptor_receiver_, shared_memory_buffer_token)) {
             return;
           }
         } else {
@@ -319,7 +350,8 @@ void ProducerSideServiceImpl::SendCommandsThread(
             return;
           }
         } else if (prev_capture_status == CaptureStatus::kCaptureFinished) {
-          if (!SendStartCaptureCommand(context, stream, curr_capture_options.value()) ||
+          if (!SendStartCaptureCommand(context, stream, curr_capture_options.value(),
+                                       file_descriptor_receiver_, shared_memory_buffer_token) ||
               !SendStopCaptureCommand(context, stream)) {
             return;
           }
@@ -353,9 +385,15 @@ void ProducerSideServiceImpl::ReceiveEventsThread(
     grpc::ServerContext* /*context*/,
     grpc::ServerReaderWriter<orbit_grpc_protos::ReceiveCommandsAndSendEventsResponse,
                              orbit_grpc_protos::ReceiveCommandsAndSendEventsRequest>* stream,
-    uint64_t producer_id, bool* all_events_sent_received) {
+    uint64_t producer_id, std::optional<uint64_t> shared_memory_buffer_token,
+    bool* all_events_sent_received) {
   orbit_base::SetCurrentThreadName("PSSI::RcvEvents");
 
+  // This is only set while the producer sends its CaptureEvents through a shared memory buffer,
+  // i.e., from when it announces the buffer during a capture until it sends AllEventsSent, so that
+  // the buffer is not polled between captures.
+  std::unique_ptr<SharedMemoryBufferConsumer> shared_memory_buffer_consumer;
+
   orbit_grpc_protos::ReceiveCommandsAndSendEventsRequest request;
   while (stream->Read(&request)) {
     {
@@ -381,8 +419,50 @@ void ProducerSideServiceImpl::ReceiveEventsThread(
         }
       } break;
 
+      case orbit_grpc_protos::ReceiveCommandsAndSendEventsRequest::kSharedMemoryBufferCreated: {
+        LOG("CaptureEventProducer created shared memory buffer");
+        if (!shared_memory_buffer_token.has_value() ||
+            request.shared_memory_buffer_created().token() != shared_memory_buffer_token.value()) {
+          ERROR("CaptureEventProducer sent SharedMemoryBufferCreated with unexpected token");
+          break;
+        }
+        // The producer passes the memfd before sending this message, but through another socket.
+        static constexpr absl::Duration kMaxWaitForSharedMemoryBufferFd = absl::Seconds(1);
+        std::optional<orbit_base::unique_fd> fd = file_descriptor_receiver_->TakeFileDescriptor(
+            shared_memory_buffer_token.value(), kMaxWaitForSharedMemoryBufferFd);
+        if (!fd.has_value()) {
+          ERROR("CaptureEventProducer didn't pass the memfd of its shared memory buffer");
+          break;
+        }
+        // Stop consuming a buffer from a previous capture for which AllEventsSent never arrived,
+        // as a SharedMemoryRingBuffer only supports one reader.
+        shared_memory_buffer_consumer.reset();
+        ErrorMessageOr<std::unique_ptr<SharedMemoryRingBuffer>> buffer_or_error =
+            SharedMemoryRingBuffer::OpenFromFileDescriptor(std::move(fd.value()));
+        if (buffer_or_error.has_error()) {
+          ERROR("Opening shared memory buffer of CaptureEventProducer: %s",
+                buffer_or_error.error().message());
+          break;
+        }
+        shared_memory_buffer_consumer = std::make_unique<SharedMemoryBufferConsumer>(
+            std::move(buffer_or_error.value()), [this, producer_id](ProducerCaptureEvent event) {
+              // See the comment for kBufferedCaptureEvents.
+              absl::ReaderMutexLock lock{&producer_event_processor_mutex_};
+              if (producer_event_processor_ != nullptr) {
+                producer_event_processor_->ProcessEvent(producer_id, std::move(event));
+              }
+            });
+      } break;
+
       case orbit_grpc_protos::ReceiveCommandsAndSendEventsRequest::kAllEventsSent: {
         LOG("Received AllEventsSent from CaptureEventProducer");
+        // The producer has written all its records before sending AllEventsSent: make sure they
+        // are all processed before the capture can be considered finished.
+        if (shared_memory_buffer_consumer != nullptr) {
+          shared_memory_buffer_consumer->Drain();
+          // The producer announces the buffer again in the next capture.
+          shared_memory_buffer_consumer.reset();
+        }
         absl::MutexLock lock{&service_state_mutex_};
         switch (service_state_.capture_status) {
           case CaptureStatus::kCaptureStarted: {
@@ -11,9 +11,11 @@
 #include <stdint.h>
 
 #include <atomic>
+#include <optional>
 
 #include "CaptureEventBuffer.h"
 #include "CaptureStartStopListener.h"
+#include "FileDescriptorReceiver.h"
 #include "GrpcProtos/Constants.h"
 #include "ProducerEventProcessor.h"
 #include "capture.pb.h"
@@ -50,6 +52,13 @@ class ProducerSideServiceImpl final : public orbit_grpc_protos::ProducerSideServ
   // until all CaptureEvents have been sent by the producers. The default is 10 seconds.
   void SetMaxWaitForAllCaptureEventsMs(uint64_t ms) { max_wait_for_all_events_sent_ms_ = ms; }
 
+  // If set, producers are offered to send their CaptureEvents through a shared memory buffer,
+  // whose memfd they pass to `file_descriptor_receiver`. This needs to be called before any
+  // producer connects, and `file_descriptor_receiver` needs to outlive this object.
+  void SetFileDescriptorReceiver(FileDescriptorReceiver* file_descriptor_receiver) {
+    file_descriptor_receiver_ = file_descriptor_receiver;
+  }
+
   // This method forces to disconnect from connected producers and to terminate running threads.
   // It doesn't cause StopCaptureCommand to be sent, but producers will be able to handle
   // the fact that the connection was interrupted.
@@ -67,13 +76,15 @@ class ProducerSideServiceImpl final : public orbit_grpc_protos::ProducerSideServ
       grpc::ServerContext* context,
       grpc::ServerReaderWriter<orbit_grpc_protos::ReceiveCommandsAndSendEventsResponse,
                                orbit_grpc_protos::ReceiveCommandsAndSendEventsRequest>* stream,
-      bool* all_events_sent_received, std::atomic<bool>* receive_events_thread_exited);
+      std::optional<uint64_t> shared_memory_buffer_token, bool* all_events_sent_received,
+      std::atomic<bool>* receive_events_thread_exited);
 
   void ReceiveEventsThread(
       grpc::ServerContext* context,
       grpc::ServerReaderWriter<orbit_grpc_protos::ReceiveCommandsAndSendEventsResponse,
                                orbit_grpc_protos::ReceiveCommandsAndSendEventsRequest>* stream,
-      uint64_t producer_id, bool* all_events_sent_received);
+      uint64_t producer_id, std::optional<uint64_t> shared_memory_buffer_token,
+      bool* all_events_sent_received);
 
  private:
   absl::flat_hash_set<grpc::ServerContext*> server_contexts_;
@@ -94,6 +105,8 @@ class ProducerSideServiceImpl final : public orbit_grpc_protos::ProducerSideServ
   std::atomic<uint64_t> producer_id_counter_ = orbit_grpc_protos::kExternalProducerStartingId;
 
   uint64_t max_wait_for_all_events_sent_ms_ = 10'000;
+
+  FileDescriptorReceiver* file_descriptor_receiver_ = nullptr;
 };
 
 }  // namespace orbit_service
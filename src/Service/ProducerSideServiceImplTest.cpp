@@ -2,20 +2,28 @@
 // Use of this source code is governed by a BSD-style license that can be
 // found in the LICENSE file.
 
+#include <absl/strings/str_format.h>
+#include <absl/synchronization/mutex.h>
 #include <gmock/gmock.h>
 #include <grpcpp/grpcpp.h>
 #include <grpcpp/server_impl.h>
 #include <grpcpp/support/channel_arguments.h>
 #include <gtest/gtest.h>
 #include <stdint.h>
+#include <unistd.h>
 
 #include <chrono>
 #include <functional>
 #include <memory>
 #include <optional>
+#include <string>
 #include <thread>
 
 #include "CaptureEventBuffer.h"
+#include "FileDescriptorReceiver.h"
+#include "ProducerSideChannel/FileDescriptorPassing.h"
+#include "ProducerSideChannel/SharedMemoryRecords.h"
+#include "ProducerSideChannel/SharedMemoryRingBuffer.h"
 #include "ProducerSideServiceImpl.h"
 #include "capture.pb.h"
 #include "grpcpp/grpcpp.h"
@@ -48,9 +56,16 @@ class FakeProducer {
         EXPECT_NE(response.command_case(),
                   orbit_grpc_protos::ReceiveCommandsAndSendEventsResponse::COMMAND_NOT_SET);
         switch (response.command_case()) {
-          case orbit_grpc_protos::ReceiveCommandsAndSendEventsResponse::kStartCaptureCommand:
-            OnStartCaptureCommandReceived(response.start_capture_command().capture_options());
-            break;
+          case orbit_grpc_protos::ReceiveCommandsAndSendEventsResponse::kStartCaptureCommand: {
+            const auto& start_capture_command = response.start_capture_command();
+            {
+              absl::MutexLock lock{&shared_memory_buffer_offer_mutex_};
+              shared_memory_buffer_socket_path_ =
+                  start_capture_command.shared_memory_buffer_socket_path();
+              shared_memory_buffer_token_ = start_capture_command.shared_memory_buffer_token();
+            }
+            OnStartCaptureCommandReceived(start_capture_command.capture_options());
+          } break;
           case orbit_grpc_protos::ReceiveCommandsAndSendEventsResponse::kStopCaptureCommand:
             OnStopCaptureCommandReceived();
             break;
@@ -75,6 +90,28 @@ class FakeProducer {
     EXPECT_TRUE(written);
   }
 
+  // Passes `fd` to the service as offered by the last StartCaptureCommand, then announces it,
+  // optionally with the wrong token.
+  void SendSharedMemoryBufferCreated(int fd, bool use_wrong_token = false) {
+    ASSERT_NE(stream_, nullptr);
+    std::string socket_path;
+    uint64_t token;
+    {
+      absl::MutexLock lock{&shared_memory_buffer_offer_mutex_};
+      socket_path = shared_memory_buffer_socket_path_;
+      token = use_wrong_token ? shared_memory_buffer_token_ + 1 : shared_memory_buffer_token_;
+    }
+    ASSERT_FALSE(socket_path.empty());
+    EXPECT_FALSE(
+        orbit_producer_side_channel::ConnectAndSendFileDescriptor(socket_path, token, fd)
+            .has_error());
+
+    orbit_grpc_protos::ReceiveCommandsAndSendEventsRequest request;
+    request.mutable_shared_memory_buffer_created()->set_token(token);
+    bool written = stream_->Write(request);
+    EXPECT_TRUE(written);
+  }
+
   void SendAllEventsSent() {
     ASSERT_NE(stream_, nullptr);
     orbit_grpc_protos::ReceiveCommandsAndSendEventsRequest request;
@@ -106,6 +143,10 @@ class FakeProducer {
                                            orbit_grpc_protos::ReceiveCommandsAndSendEventsResponse>>
       stream_;
   std::thread read_thread_;
+
+  std::string shared_memory_buffer_socket_path_ ABSL_GUARDED_BY(shared_memory_buffer_offer_mutex_);
+  uint64_t shared_memory_buffer_token_ ABSL_GUARDED_BY(shared_memory_buffer_offer_mutex_) = 0;
+  absl::Mutex shared_memory_buffer_offer_mutex_;
 };
 
 class MockProducerEventProcessor : public ProducerEventProcessor {
@@ -117,7 +158,14 @@ class MockProducerEventProcessor : public ProducerEventProcessor {
 class ProducerSideServiceImplTest : public ::testing::Test {
  protected:
   void SetUp() override {
+    auto file_descriptor_receiver_or_error = FileDescriptorReceiver::Create(absl::StrFormat(
+        "/tmp/orbit-producer-side-service-impl-test-%d-fds", static_cast<int>(getpid())));
+    ASSERT_FALSE(file_descriptor_receiver_or_error.has_error())
+        << file_descriptor_receiver_or_error.error().message();
+    file_descriptor_receiver_ = std::move(file_descriptor_receiver_or_error.value());
+
     service_.emplace();
+    service_->SetFileDescriptorReceiver(file_descriptor_receiver_.get());
 
     grpc::ServerBuilder builder;
     builder.RegisterService(&*service_);
@@ -146,8 +194,10 @@ class ProducerSideServiceImplTest : public ::testing::Test {
 
     service_.reset();
     fake_server_.reset();
+    file_descriptor_receiver_.reset();
   }
 
+  std::unique_ptr<FileDescriptorReceiver> file_descriptor_receiver_;
   std::optional<ProducerSideServiceImpl> service_;
   std::unique_ptr<grpc::Server> fake_server_;
   std::optional<FakeProducer> fake_producer_;
@@ -208,6 +258,130 @@ TEST_F(ProducerSideServiceImplTest, OneCapture) {
                           2 * kSendAllEventsDelayMs);
 }
 
+TEST_F(ProducerSideServiceImplTest, OneCaptureThroughSharedMemoryBuffer) {
+  MockProducerEventProcessor mock_processor;
+
+  EXPECT_CALL(*fake_producer_, OnStartCaptureCommandReceived(CaptureOptionsEq(kFakeCaptureOptions)))
+      .Times(1);
+  service_->OnCaptureStartRequested(kFakeCaptureOptions, &mock_processor);
+  std::this_thread::sleep_for(kWaitMessagesSentDuration);
+
+  ::testing::Mock::VerifyAndClearExpectations(&*fake_producer_);
+
+  auto buffer_or_error = orbit_producer_side_channel::SharedMemoryRingBuffer::Create(64 * 1024);
+  ASSERT_FALSE(buffer_or_error.has_error());
+  std::unique_ptr<orbit_producer_side_channel::SharedMemoryRingBuffer> buffer =
+      std::move(buffer_or_error.value());
+  fake_producer_->SendSharedMemoryBufferCreated(buffer->GetFileDescriptor());
+
+  const std::string serialized_event = [] {
+    orbit_grpc_protos::ProducerCaptureEvent event;
+    event.mutable_interned_string()->set_key(42);
+    return event.SerializeAsString();
+  }();
+  auto write_event = [&buffer, &serialized_event] {
+    EXPECT_TRUE(buffer->WriteRecord(
+        static_cast<uint32_t>(
+            orbit_producer_side_channel::SharedMemoryRecordType::kSerializedProducerCaptureEvent),
+        serialized_event.data(), serialized_event.size()));
+  };
+
+  EXPECT_CALL(mock_processor, ProcessEvent).Times(3);
+  write_event();
+  write_event();
+  write_event();
+  std::this_thread::sleep_for(kWaitMessagesSentDuration);
+
+  ::testing::Mock::VerifyAndClearExpectations(&mock_processor);
+
+  // Records written right before AllEventsSent must still be processed before the capture stops.
+  EXPECT_CALL(mock_processor, ProcessEvent).Times(2);
+  ON_CALL(*fake_producer_, OnStopCaptureCommandReceived).WillByDefault([this, &write_event] {
+    write_event();
+    write_event();
+    fake_producer_->SendAllEventsSent();
+  });
+  {
+    ::testing::InSequence in_sequence;
+    EXPECT_CALL(*fake_producer_, OnStopCaptureCommandReceived).Times(1);
+    EXPECT_CALL(*fake_producer_, OnCaptureFinishedCommandReceived).Times(1);
+  }
+  service_->OnCaptureStopRequested();
+
+  ::testing::Mock::VerifyAndClearExpectations(&*fake_producer_);
+  ::testing::Mock::VerifyAndClearExpectations(&mock_processor);
+
+  // The buffer is not consumed between captures.
+  write_event();
+  std::this_thread::sleep_for(kWaitMessagesSentDuration);
+  EXPECT_EQ(buffer->ReadAvailableRecords(
+                [](uint32_t /*type*/, const uint8_t* /*payload*/, uint32_t /*payload_size*/) {}),
+            1);
+
+  // The producer announces the buffer again for the next capture.
+  EXPECT_CALL(*fake_producer_, OnStartCaptureCommandReceived(CaptureOptionsEq(kFakeCaptureOptions)))
+      .Times(1);
+  service_->OnCaptureStartRequested(kFakeCaptureOptions, &mock_processor);
+  std::this_thread::sleep_for(kWaitMessagesSentDuration);
+  fake_producer_->SendSharedMemoryBufferCreated(buffer->GetFileDescriptor());
+
+  EXPECT_CALL(mock_processor, ProcessEvent).Times(1);
+  write_event();
+  std::this_thread::sleep_for(kWaitMessagesSentDuration);
+
+  ::testing::Mock::VerifyAndClearExpectations(&mock_processor);
+
+  ON_CALL(*fake_producer_, OnStopCaptureCommandReceived).WillByDefault([this] {
+    fake_producer_->SendAllEventsSent();
+  });
+  {
+    ::testing::InSequence in_sequence;
+    EXPECT_CALL(*fake_producer_, OnStopCaptureCommandReceived).Times(1);
+    EXPECT_CALL(*fake_producer_, OnCaptureFinishedCommandReceived).Times(1);
+  }
+  service_->OnCaptureStopRequested();
+}
+
+TEST_F(ProducerSideServiceImplTest, SharedMemoryBufferWithWrongTokenIsIgnored) {
+  MockProducerEventProcessor mock_processor;
+
+  EXPECT_CALL(*fake_producer_, OnStartCaptureCommandReceived(CaptureOptionsEq(kFakeCaptureOptions)))
+      .Times(1);
+  service_->OnCaptureStartRequested(kFakeCaptureOptions, &mock_processor);
+  std::this_thread::sleep_for(kWaitMessagesSentDuration);
+
+  ::testing::Mock::VerifyAndClearExpectations(&*fake_producer_);
+
+  auto buffer_or_error = orbit_producer_side_channel::SharedMemoryRingBuffer::Create(64 * 1024);
+  ASSERT_FALSE(buffer_or_error.has_error());
+  std::unique_ptr<orbit_producer_side_channel::SharedMemoryRingBuffer> buffer =
+      std::move(buffer_or_error.value());
+  fake_producer_->SendSharedMemoryBufferCreated(buffer->GetFileDescriptor(),
+                                                /*use_wrong_token=*/true);
+
+  const std::string serialized_event = [] {
+    orbit_grpc_protos::ProducerCaptureEvent event;
+    event.mutable_interned_string()->set_key(42);
+    return event.SerializeAsString();
+  }();
+  EXPECT_CALL(mock_processor, ProcessEvent).Times(0);
+  EXPECT_TRUE(buffer->WriteRecord(
+      static_cast<uint32_t>(
+          orbit_producer_side_channel::SharedMemoryRecordType::kSerializedProducerCaptureEvent),
+      serialized_event.data(), serialized_event.size()));
+  std::this_thread::sleep_for(kWaitMessagesSentDuration);
+
+  ON_CALL(*fake_producer_, OnStopCaptureCommandReceived).WillByDefault([this] {
+    fake_producer_->SendAllEventsSent();
+  });
+  {
+    ::testing::InSequence in_sequence;
+    EXPECT_CALL(*fake_producer_, OnStopCaptureCommandReceived).Times(1);
+    EXPECT_CALL(*fake_producer_, OnCaptureFinishedCommandReceived).Times(1);
+  }
+  service_->OnCaptureStopRequested();
+}
+
 TEST_F(ProducerSideServiceImplTest, TwoCaptures) {
   MockProducerEventProcessor mock_processor;
 
@@ -0,0 +1,201 @@
+// Copyright (c) 2021 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "SharedMemoryBufferConsumer.h"
+
+#include <string.h>
+
+#include <chrono>
+#include <utility>
+#include <vector>
+
+#include "OrbitBase/Logging.h"
+#include "OrbitBase/ThreadUtils.h"
+#include "ProducerSideChannel/SharedMemoryRecords.h"
+
+namespace orbit_service {
+
+using orbit_grpc_protos::ProducerCaptureEvent;
+using orbit_producer_side_channel::GpuCommandBufferRecord;
+using orbit_producer_side_channel::GpuDebugMarkerRecord;
+using orbit_producer_side_channel::GpuQueueSubmissionMetaInfoRecord;
+using orbit_producer_side_channel::GpuQueueSubmissionRecord;
+using orbit_producer_side_channel::InternedStringRecord;
+using orbit_producer_side_channel::SharedMemoryRecordType;
+using orbit_producer_side_channel::SharedMemoryRingBuffer;
+
+namespace {
+
+template <typename T>
+[[nodiscard]] T ReadRecordAt(const uint8_t* address) {
+  // The payload is aligned, but use memcpy anyway, as this is memory shared with another process.
+  T record;
+  memcpy(&record, address, sizeof(T));
+  return record;
+}
+
+void FillMetaInfo(const GpuQueueSubmissionMetaInfoRecord& record,
+                  orbit_grpc_protos::GpuQueueSubmissionMetaInfo* meta_info) {
+  meta_info->set_pid(record.pid);
+  meta_info->set_tid(record.tid);
+  meta_info->set_pre_submission_cpu_timestamp(record.pre_submission_cpu_timestamp);
+  meta_info->set_post_submission_cpu_timestamp(record.post_submission_cpu_timestamp);
+}
+
+[[nodiscard]] std::optional<ProducerCaptureEvent> TranslateSerializedProducerCaptureEvent(
+    const uint8_t* payload, uint32_t payload_size) {
+  // Parse a copy, as the producer could modify the shared memory while the parser reads it.
+  std::vector<uint8_t> serialized_event(payload, payload + payload_size);
+  ProducerCaptureEvent event;
+  if (!event.ParseFromArray(serialized_event.data(), static_cast<int>(serialized_event.size()))) {
+    return std::nullopt;
+  }
+  return event;
+}
+
+[[nodiscard]] std::optional<ProducerCaptureEvent> TranslateInternedString(const uint8_t* payload,
+                                                                        uint32_t payload_size) {
+  if (payload_size < sizeof(InternedStringRecord)) {
+    return std::nullopt;
+  }
+  auto record = ReadRecordAt<InternedStringRecord>(payload);
+  ProducerCaptureEvent event;
+  event.mutable_interned_string()->set_key(record.key);
+  event.mutable_interned_string()->set_intern(
+      reinterpret_cast<const char*>(payload + sizeof(InternedStringRecord)),
+      payload_size - sizeof(InternedStringRecord));
+  return event;
+}
+
+[[nodiscard]] std::optional<ProducerCaptureEvent> TranslateGpuQueueSubmission(
+    const uint8_t* payload, uint32_t payload_size) {
+  if (payload_size < sizeof(GpuQueueSubmissionRecord)) {
+    return std::nullopt;
+  }
+  auto record = ReadRecordAt<GpuQueueSubmissionRecord>(payload);
+  if (payload_size != orbit_producer_side_channel::GetGpuQueueSubmissionPayloadSize(
+                          record.num_submit_infos, record.num_command_buffers,
+                          record.num_completed_markers)) {
+    return std::nullopt;
+  }
+
+  const uint8_t* counts_address = payload + sizeof(GpuQueueSubmissionRecord);
+  std::vector<uint32_t> command_buffer_counts(record.num_submit_infos);
+  memcpy(command_buffer_counts.data(), counts_address,
+         command_buffer_counts.size() * sizeof(uint32_t));
+  uint64_t total_command_buffer_count = 0;
+  for (uint32_t command_buffer_count : command_buffer_counts) {
+    total_command_buffer_count += command_buffer_count;
+  }
+  if (total_command_buffer_count != record.num_command_buffers) {
+    return std::nullopt;
+  }
+
+  ProducerCaptureEvent event;
+  orbit_grpc_protos::GpuQueueSubmission* submission = event.mutable_gpu_queue_submission();
+  FillMetaInfo(record.meta_info, submission->mutable_meta_info());
+  submission->set_num_begin_markers(record.num_begin_markers);
+
+  const uint8_t* command_buffer_address =
+      counts_address + orbit_producer_side_channel::GetGpuQueueSubmissionCommandBufferCountsSize(
+                           record.num_submit_infos);
+  for (uint32_t command_buffer_count : command_buffer_counts) {
+    orbit_grpc_protos::GpuSubmitInfo* submit_info = submission->add_submit_infos();
+    for (uint32_t i = 0; i < command_buffer_count; ++i) {
+      auto command_buffer_record = ReadRecordAt<GpuCommandBufferRecord>(command_buffer_address);
+      command_buffer_address += sizeof(GpuCommandBufferRecord);
+      orbit_grpc_protos::GpuCommandBuffer* command_buffer = submit_info->add_command_buffers();
+      command_buffer->set_begin_gpu_timestamp_ns(command_buffer_record.begin_gpu_timestamp_ns);
+      command_buffer->set_end_gpu_timestamp_ns(command_buffer_record.end_gpu_timestamp_ns);
+    }
+  }
+
+  const uint8_t* marker_address = command_buffer_address;
+  for (uint32_t i = 0; i < record.num_completed_markers; ++i) {
+    auto marker_record = ReadRecordAt<GpuDebugMarkerRecord>(marker_address);
+    marker_address += sizeof(GpuDebugMarkerRecord);
+    orbit_grpc_protos::GpuDebugMarker* marker = submission->add_completed_markers();
+    if ((marker_record.flags & GpuDebugMarkerRecord::kHasBeginMarker) != 0) {
+      FillMetaInfo(marker_record.begin_meta_info,
+                   marker->mutable_begin_marker()->mutable_meta_info());
+      marker->mutable_begin_marker()->set_gpu_timestamp_ns(marker_record.begin_gpu_timestamp_ns);
+    }
+    marker->set_end_gpu_timestamp_ns(marker_record.end_gpu_timestamp_ns);
+    marker->set_text_key(marker_record.text_key);
+    marker->set_depth(marker_record.depth);
+    if ((marker_record.flags & GpuDebugMarkerRecord::kHasColor) != 0) {
+      marker->mutable_color()->set_red(marker_record.color_red);
+      marker->mutable_color()->set_green(marker_record.color_green);
+      marker->mutable_color()->set_blue(marker_record.color_blue);
+      marker->mutable_color()->set_alpha(marker_record.color_alpha);
+    }
+  }
+
+  return event;
+}
+
+}  // namespace
+
+std::optional<ProducerCaptureEvent> TranslateSharedMemoryRecord(uint32_t type,
+                                                                const uint8_t* payload,
+                                                                uint32_t payload_size) {
+  switch (static_cast<SharedMemoryRecordType>(type)) {
+    case SharedMemoryRecordType::kSerializedProducerCaptureEvent:
+      return TranslateSerializedProducerCaptureEvent(payload, payload_size);
+    case SharedMemoryRecordType::kInternedString:
+      return TranslateInternedString(payload, payload_size);
+    case SharedMemoryRecordType::kGpuQueueSubmission:
+      return TranslateGpuQueueSubmission(payload, payload_size);
+  }
+  return std::nullopt;
+}
+
+SharedMemoryBufferConsumer::SharedMemoryBufferConsumer(
+    std::unique_ptr<SharedMemoryRingBuffer> shared_memory_buffer,
+    CaptureEventConsumer capture_event_consumer)
+    : shared_memory_buffer_{std::move(shared_memory_buffer)},
+      capture_event_consumer_{std::move(capture_event_consumer)} {
+  CHECK(shared_memory_buffer_ != nullptr);
+  poll_thread_ = std::thread{&SharedMemoryBufferConsumer::PollThread, this};
+}
+
+SharedMemoryBufferConsumer::~SharedMemoryBufferConsumer() {
+  exit_requested_ = true;
+  CHECK(poll_thread_.joinable());
+  poll_thread_.join();
+}
+
+void SharedMemoryBufferConsumer::Drain() {
+  absl::MutexLock lock{&shared_memory_buffer_mutex_};
+  shared_memory_buffer_->ReadAvailableRecords(
+      [this](uint32_t type, const uint8_t* payload, uint32_t payload_size) {
+        std::optional<ProducerCaptureEvent> event =
+            TranslateSharedMemoryRecord(type, payload, payload_size);
+        if (!event.has_value()) {
+          ERROR("Received invalid record of type %u from shared memory buffer", type);
+          return;
+        }
+        capture_event_consumer_(std::move(event.value()));
+      });
+
+  uint64_t dropped_record_count = shared_memory_buffer_->GetDroppedRecordCount();
+  if (dropped_record_count != reported_dropped_record_count_) {
+    ERROR("CaptureEventProducer dropped %u records as the shared memory buffer was full",
+          dropped_record_count - reported_dropped_record_count_);
+    reported_dropped_record_count_ = dropped_record_count;
+  }
+}
+
+void SharedMemoryBufferConsumer::PollThread() {
+  orbit_base::SetCurrentThreadName("PSSI::ShmEvents");
+
+  while (!exit_requested_) {
+    Drain();
+
+    static constexpr std::chrono::duration kPollInterval = std::chrono::microseconds{1000};
+    std::this_thread::sleep_for(kPollInterval);
+  }
+}
+
+}  // namespace orbit_service
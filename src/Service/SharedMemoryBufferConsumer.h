@@ -0,0 +1,61 @@
+// Copyright (c) 2021 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef ORBIT_SERVICE_SHARED_MEMORY_BUFFER_CONSUMER_H_
+#define ORBIT_SERVICE_SHARED_MEMORY_BUFFER_CONSUMER_H_
+
+#include <absl/synchronization/mutex.h>
+#include <stdint.h>
+
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <thread>
+
+#include "ProducerSideChannel/SharedMemoryRingBuffer.h"
+#include "capture.pb.h"
+
+namespace orbit_service {
+
+// Converts a record written by a producer into a SharedMemoryRingBuffer to the corresponding
+// ProducerCaptureEvent. Returns std::nullopt if the record is of an unknown type or malformed.
+[[nodiscard]] std::optional<orbit_grpc_protos::ProducerCaptureEvent> TranslateSharedMemoryRecord(
+    uint32_t type, const uint8_t* payload, uint32_t payload_size);
+
+// This class polls the SharedMemoryRingBuffer of one producer on a separate thread, converts its
+// records to ProducerCaptureEvents and passes them to the specified callback, in order.
+// Drain allows to synchronously consume all records committed so far, e.g., when the producer
+// notifies that it has sent all its CaptureEvents.
+class SharedMemoryBufferConsumer {
+ public:
+  using CaptureEventConsumer = std::function<void(orbit_grpc_protos::ProducerCaptureEvent)>;
+
+  SharedMemoryBufferConsumer(
+      std::unique_ptr<orbit_producer_side_channel::SharedMemoryRingBuffer> shared_memory_buffer,
+      CaptureEventConsumer capture_event_consumer);
+  ~SharedMemoryBufferConsumer();
+
+  SharedMemoryBufferConsumer(const SharedMemoryBufferConsumer&) = delete;
+  SharedMemoryBufferConsumer& operator=(const SharedMemoryBufferConsumer&) = delete;
+  SharedMemoryBufferConsumer(SharedMemoryBufferConsumer&&) = delete;
+  SharedMemoryBufferConsumer& operator=(SharedMemoryBufferConsumer&&) = delete;
+
+  void Drain();
+
+ private:
+  void PollThread();
+
+  std::unique_ptr<orbit_producer_side_channel::SharedMemoryRingBuffer> shared_memory_buffer_;
+  absl::Mutex shared_memory_buffer_mutex_;
+  CaptureEventConsumer capture_event_consumer_;
+  uint64_t reported_dropped_record_count_ = 0;
+
+  std::atomic<bool> exit_requested_ = false;
+  std::thread poll_thread_;
+};
+
+}  // namespace orbit_service
+
+#endif  // ORBIT_SERVICE_SHARED_MEMORY_BUFFER_CONSUMER_H_
@@ -0,0 +1,224 @@
+// Copyright (c) 2021 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <absl/synchronization/mutex.h>
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "OrbitBase/File.h"
+#include "ProducerSideChannel/SharedMemoryRecords.h"
+#include "ProducerSideChannel/SharedMemoryRingBuffer.h"
+#include "SharedMemoryBufferConsumer.h"
+#include "capture.pb.h"
+
+namespace orbit_service {
+
+namespace {
+
+using orbit_grpc_protos::ProducerCaptureEvent;
+using orbit_producer_side_channel::GpuCommandBufferRecord;
+using orbit_producer_side_channel::GpuDebugMarkerRecord;
+using orbit_producer_side_channel::GpuQueueSubmissionRecord;
+using orbit_producer_side_channel::InternedStringRecord;
+using orbit_producer_side_channel::SharedMemoryRecordType;
+using orbit_producer_side_channel::SharedMemoryRingBuffer;
+
+std::vector<uint8_t> CreateInternedStringPayload(uint64_t key, const std::string& str) {
+  std::vector<uint8_t> payload(sizeof(InternedStringRecord) + str.size());
+  InternedStringRecord record{key};
+  memcpy(payload.data(), &record, sizeof(record));
+  memcpy(payload.data() + sizeof(record), str.data(), str.size());
+  return payload;
+}
+
+std::vector<uint8_t> CreateGpuQueueSubmissionPayload() {
+  constexpr uint32_t kNumSubmitInfos = 2;
+  constexpr uint32_t kNumCommandBuffers = 3;
+  constexpr uint32_t kNumCompletedMarkers = 2;
+  std::vector<uint8_t> payload(orbit_producer_side_channel::GetGpuQueueSubmissionPayloadSize(
+      kNumSubmitInfos, kNumCommandBuffers, kNumCompletedMarkers));
+  uint8_t* address = payload.data();
+
+  GpuQueueSubmissionRecord record{};
+  record.meta_info = {1, 2, 3, 4};
+  record.num_begin_markers = 5;
+  record.num_submit_infos = kNumSubmitInfos;
+  record.num_command_buffers = kNumCommandBuffers;
+  record.num_completed_markers = kNumCompletedMarkers;
+  memcpy(address, &record, sizeof(record));
+  address += sizeof(record);
+
+  uint32_t command_buffer_counts[kNumSubmitInfos] = {1, 2};
+  memcpy(address, command_buffer_counts, sizeof(command_buffer_counts));
+  address +=
+      orbit_producer_side_channel::GetGpuQueueSubmissionCommandBufferCountsSize(kNumSubmitInfos);
+
+  for (uint64_t i = 0; i < kNumCommandBuffers; ++i) {
+    GpuCommandBufferRecord command_buffer{10 * i, 10 * i + 5};
+    memcpy(address, &command_buffer, sizeof(command_buffer));
+    address += sizeof(command_buffer);
+  }
+
+  GpuDebugMarkerRecord marker_with_begin{};
+  marker_with_begin.begin_meta_info = {6, 7, 8, 9};
+  marker_with_begin.begin_gpu_timestamp_ns = 100;
+  marker_with_begin.end_gpu_timestamp_ns = 200;
+  marker_with_begin.text_key = 42;
+  marker_with_begin.depth = 1;
+  marker_with_begin.flags = GpuDebugMarkerRecord::kHasBeginMarker | GpuDebugMarkerRecord::kHasColor;
+  marker_with_begin.color_red = 0.25f;
+  marker_with_begin.color_green = 0.5f;
+  marker_with_begin.color_blue = 0.75f;
+  marker_with_begin.color_alpha = 1.0f;
+  memcpy(address, &marker_with_begin, sizeof(marker_with_begin));
+  address += sizeof(marker_with_begin);
+
+  GpuDebugMarkerRecord marker_without_begin{};
+  marker_without_begin.end_gpu_timestamp_ns = 300;
+  marker_without_begin.text_key = 43;
+  memcpy(address, &marker_without_begin, sizeof(marker_without_begin));
+
+  return payload;
+}
+
+}  // namespace
+
+TEST(TranslateSharedMemoryRecord, SerializedProducerCaptureEvent) {
+  ProducerCaptureEvent expected;
+  expected.mutable_thread_name()->set_tid(42);
+  expected.mutable_thread_name()->set_name("thread");
+  std::string serialized = expected.SerializeAsString();
+
+  std::optional<ProducerCaptureEvent> actual = TranslateSharedMemoryRecord(
+      static_cast<uint32_t>(SharedMemoryRecordType::kSerializedProducerCaptureEvent),
+      reinterpret_cast<const uint8_t*>(serialized.data()), serialized.size());
+  ASSERT_TRUE(actual.has_value());
+  EXPECT_EQ(actual->SerializeAsString(), serialized);
+}
+
+TEST(TranslateSharedMemoryRecord, InternedString) {
+  std::vector<uint8_t> payload = CreateInternedStringPayload(42, "interned");
+
+  std::optional<ProducerCaptureEvent> actual = TranslateSharedMemoryRecord(
+      static_cast<uint32_t>(SharedMemoryRecordType::kInternedString), payload.data(),
+      payload.size());
+  ASSERT_TRUE(actual.has_value());
+  ASSERT_EQ(actual->event_case(), ProducerCaptureEvent::kInternedString);
+  EXPECT_EQ(actual->interned_string().key(), 42);
+  EXPECT_EQ(actual->interned_string().intern(), "interned");
+}
+
+TEST(TranslateSharedMemoryRecord, GpuQueueSubmission) {
+  std::vector<uint8_t> payload = CreateGpuQueueSubmissionPayload();
+
+  std::optional<ProducerCaptureEvent> actual = TranslateSharedMemoryRecord(
+      static_cast<uint32_t>(SharedMemoryRecordType::kGpuQueueSubmission), payload.data(),
+      payload.size());
+  ASSERT_TRUE(actual.has_value());
+  ASSERT_EQ(actual->event_case(), ProducerCaptureEvent::kGpuQueueSubmission);
+  const orbit_grpc_protos::GpuQueueSubmission& submission = actual->gpu_queue_submission();
+
+  EXPECT_EQ(submission.meta_info().pid(), 1);
+  EXPECT_EQ(submission.meta_info().tid(), 2);
+  EXPECT_EQ(submission.meta_info().pre_submission_cpu_timestamp(), 3);
+  EXPECT_EQ(submission.meta_info().post_submission_cpu_timestamp(), 4);
+  EXPECT_EQ(submission.num_begin_markers(), 5);
+
+  ASSERT_EQ(submission.submit_infos_size(), 2);
+  ASSERT_EQ(submission.submit_infos(0).command_buffers_size(), 1);
+  EXPECT_EQ(submission.submit_infos(0).command_buffers(0).begin_gpu_timestamp_ns(), 0);
+  EXPECT_EQ(submission.submit_infos(0).command_buffers(0).end_gpu_timestamp_ns(), 5);
+  ASSERT_EQ(submission.submit_infos(1).command_buffers_size(), 2);
+  EXPECT_EQ(submission.submit_infos(1).command_buffers(0).begin_gpu_timestamp_ns(), 10);
+  EXPECT_EQ(submission.submit_infos(1).command_buffers(1).end_gpu_timestamp_ns(), 25);
+
+  ASSERT_EQ(submission.completed_markers_size(), 2);
+  const orbit_grpc_protos::GpuDebugMarker& marker_with_begin = submission.completed_markers(0);
+  ASSERT_TRUE(marker_with_begin.has_begin_marker());
+  EXPECT_EQ(marker_with_begin.begin_marker().meta_info().pid(), 6);
+  EXPECT_EQ(marker_with_begin.begin_marker().meta_info().post_submission_cpu_timestamp(), 9);
+  EXPECT_EQ(marker_with_begin.begin_marker().gpu_timestamp_ns(), 100);
+  EXPECT_EQ(marker_with_begin.end_gpu_timestamp_ns(), 200);
+  EXPECT_EQ(marker_with_begin.text_key(), 42);
+  EXPECT_EQ(marker_with_begin.depth(), 1);
+  ASSERT_TRUE(marker_with_begin.has_color());
+  EXPECT_EQ(marker_with_begin.color().blue(), 0.75f);
+
+  const orbit_grpc_protos::GpuDebugMarker& marker_without_begin = submission.completed_markers(1);
+  EXPECT_FALSE(marker_without_begin.has_begin_marker());
+  EXPECT_FALSE(marker_without_begin.has_color());
+  EXPECT_EQ(marker_without_begin.end_gpu_timestamp_ns(), 300);
+  EXPECT_EQ(marker_without_begin.text_key(), 43);
+}
+
+TEST(TranslateSharedMemoryRecord, RejectsMalformedRecords) {
+  std::vector<uint8_t> payload = CreateGpuQueueSubmissionPayload();
+  EXPECT_FALSE(TranslateSharedMemoryRecord(
+                   static_cast<uint32_t>(SharedMemoryRecordType::kGpuQueueSubmission),
+                   payload.data(), payload.size() - sizeof(GpuDebugMarkerRecord))
+                   .has_value());
+
+  // Claim more command buffers in the first submit info than in the whole submission.
+  uint32_t wrong_count = 3;
+  memcpy(payload.data() + sizeof(GpuQueueSubmissionRecord), &wrong_count, sizeof(wrong_count));
+  EXPECT_FALSE(TranslateSharedMemoryRecord(
+                   static_cast<uint32_t>(SharedMemoryRecordType::kGpuQueueSubmission),
+                   payload.data(), payload.size())
+                   .has_value());
+
+  EXPECT_FALSE(TranslateSharedMemoryRecord(
+                   static_cast<uint32_t>(SharedMemoryRecordType::kInternedString), payload.data(),
+                   sizeof(InternedStringRecord) - 1)
+                   .has_value());
+  EXPECT_FALSE(TranslateSharedMemoryRecord(12345, payload.data(), payload.size()).has_value());
+}
+
+TEST(SharedMemoryBufferConsumer, ConsumesRecordsInOrder) {
+  constexpr uint64_t kDataSize = 64 * 1024;
+  auto producer_buffer_or_error = SharedMemoryRingBuffer::Create(kDataSize);
+  ASSERT_FALSE(producer_buffer_or_error.has_error());
+  std::unique_ptr<SharedMemoryRingBuffer> producer_buffer =
+      std::move(producer_buffer_or_error.value());
+  auto consumer_buffer_or_error = SharedMemoryRingBuffer::OpenFromFileDescriptor(
+      orbit_base::unique_fd{dup(producer_buffer->GetFileDescriptor())});
+  ASSERT_FALSE(consumer_buffer_or_error.has_error());
+
+  absl::Mutex keys_mutex;
+  std::vector<uint64_t> keys;
+  SharedMemoryBufferConsumer consumer{std::move(consumer_buffer_or_error.value()),
+                                      [&keys, &keys_mutex](ProducerCaptureEvent event) {
+                                        absl::MutexLock lock{&keys_mutex};
+                                        keys.push_back(event.interned_string().key());
+                                      }};
+
+  constexpr uint64_t kRecordCount = 10'000;
+  for (uint64_t key = 0; key < kRecordCount; ++key) {
+    std::vector<uint8_t> payload = CreateInternedStringPayload(key, "string");
+    // The buffer is smaller than all the records: wait for the consumer instead of dropping any.
+    uint8_t* destination;
+    while ((destination = producer_buffer->TryAllocateRecord(
+                static_cast<uint32_t>(SharedMemoryRecordType::kInternedString),
+                payload.size())) == nullptr) {
+      std::this_thread::yield();
+    }
+    memcpy(destination, payload.data(), payload.size());
+    producer_buffer->CommitRecord();
+  }
+  consumer.Drain();
+
+  absl::MutexLock lock{&keys_mutex};
+  ASSERT_EQ(keys.size(), kRecordCount);
+  for (uint64_t key = 0; key < kRecordCount; ++key) {
+    EXPECT_EQ(keys[key], key);
+  }
+}
+
+}  // namespace orbit_service